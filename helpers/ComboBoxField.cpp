@@ -0,0 +1,256 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "ComboBoxField.h"
+
+CComboBoxField::CComboBoxField():
+    _pSource(NULL),
+    _fStarted(false),
+    _dwSelectedItem(0)
+{
+    ZeroMemory(&_view, sizeof(_view));
+}
+
+CComboBoxField::~CComboBoxField()
+{
+    if (_pSource != NULL)
+    {
+        _pSource->Release();
+        _pSource = NULL;
+    }
+}
+
+void CComboBoxField::Initialize(__in CComboBoxSource* pSource)
+{
+    if (_pSource != NULL)
+    {
+        _pSource->Release();
+    }
+    _pSource = pSource;
+    _pSource->AddRef();
+    _pSource->ResetView(&_view);
+    _fStarted = false;
+    _dwSelectedItem = 0;
+}
+
+// The combobox starts with the first page of whatever the view matches.
+void CComboBoxField::_ShowFirstPage()
+{
+    const DWORD cMatches = _pSource->GetMatchCount(&_view);
+    _view.cShown = (cMatches < COMBOBOX_PAGE_ITEMS) ? cMatches : COMBOBOX_PAGE_ITEMS;
+    _fStarted = true;
+}
+
+// Copies the text of a match for LogonUI, which frees it with CoTaskMemFree.
+HRESULT CComboBoxField::_CopyMatch(__in DWORD iMatch, __deref_out PWSTR* ppwsz)
+{
+    HRESULT hr = S_OK;
+
+    DWORD cch;
+    const WCHAR* pch = _pSource->GetItem(_pSource->GetMatch(&_view, iMatch), &cch);
+    *ppwsz = static_cast<PWSTR>(CoTaskMemAlloc((cch + 1) * sizeof(WCHAR)));
+    if (*ppwsz != NULL)
+    {
+        CopyMemory(*ppwsz, pch, cch * sizeof(WCHAR));
+        (*ppwsz)[cch] = L'\0';
+    }
+    else
+    {
+        hr = E_OUTOFMEMORY;
+    }
+    return hr;
+}
+
+// Appends the next page of matches after the ones already shown, then
+// "More..." if there are still others.
+HRESULT CComboBoxField::_AppendPage(
+    __in ICredentialProviderCredential* pcpc,
+    __in ICredentialProviderCredentialEvents* pcpce,
+    __in DWORD dwFieldID
+    )
+{
+    HRESULT hr = S_OK;
+
+    const DWORD cMatches = _pSource->GetMatchCount(&_view);
+    DWORD cPage = cMatches - _view.cShown;
+    if (cPage > COMBOBOX_PAGE_ITEMS)
+    {
+        cPage = COMBOBOX_PAGE_ITEMS;
+    }
+
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < cPage); i++)
+    {
+        PWSTR pwszItem;
+        hr = _CopyMatch(_view.cShown, &pwszItem);
+        if (SUCCEEDED(hr))
+        {
+            hr = pcpce->AppendFieldComboBoxItem(pcpc, dwFieldID, pwszItem);
+            CoTaskMemFree(pwszItem);
+        }
+        if (SUCCEEDED(hr))
+        {
+            _view.cShown++;
+        }
+    }
+
+    if (SUCCEEDED(hr) && _HasMore())
+    {
+        hr = pcpce->AppendFieldComboBoxItem(pcpc, dwFieldID, COMBOBOX_MORE_ITEM);
+    }
+
+    return hr;
+}
+
+HRESULT CComboBoxField::GetValueCount(__out DWORD* pcItems, __out DWORD* pdwSelectedItem)
+{
+    if (!_fStarted)
+    {
+        _ShowFirstPage();
+    }
+
+    *pcItems = _view.cShown + (_HasMore() ? 1 : 0);
+    *pdwSelectedItem = (_dwSelectedItem < _view.cShown) ? _dwSelectedItem : 0;
+    return S_OK;
+}
+
+HRESULT CComboBoxField::GetValueAt(__in DWORD dwItem, __deref_out PWSTR* ppwszItem)
+{
+    HRESULT hr;
+
+    if (dwItem < _view.cShown)
+    {
+        hr = _CopyMatch(dwItem, ppwszItem);
+    }
+    else if ((dwItem == _view.cShown) && _HasMore())
+    {
+        hr = SHStrDupW(COMBOBOX_MORE_ITEM, ppwszItem);
+    }
+    else
+    {
+        hr = E_INVALIDARG;
+    }
+
+    return hr;
+}
+
+HRESULT CComboBoxField::SetSelectedValue(
+    __in ICredentialProviderCredential* pcpc,
+    __in_opt ICredentialProviderCredentialEvents* pcpce,
+    __in DWORD dwFieldID,
+    __in DWORD dwSelectedItem
+    )
+{
+    HRESULT hr = S_OK;
+
+    if (dwSelectedItem < _view.cShown)
+    {
+        _dwSelectedItem = dwSelectedItem;
+    }
+    else if ((dwSelectedItem == _view.cShown) && _HasMore())
+    {
+        // Swap "More..." for the next page and select the first item of it.
+        // Without a callback the combobox can't grow, so the selection stays.
+        if (pcpce != NULL)
+        {
+            const DWORD dwFirstNew = _view.cShown;
+            hr = pcpce->DeleteFieldComboBoxItem(pcpc, dwFieldID, dwFirstNew);
+            if (SUCCEEDED(hr))
+            {
+                hr = _AppendPage(pcpc, pcpce, dwFieldID);
+            }
+            if (SUCCEEDED(hr))
+            {
+                _dwSelectedItem = dwFirstNew;
+                hr = pcpce->SetFieldComboBoxSelectedItem(pcpc, dwFieldID, dwFirstNew);
+            }
+        }
+    }
+    else
+    {
+        hr = E_INVALIDARG;
+    }
+
+    return hr;
+}
+
+HRESULT CComboBoxField::SetFilter(
+    __in ICredentialProviderCredential* pcpc,
+    __in_opt ICredentialProviderCredentialEvents* pcpce,
+    __in DWORD dwFieldID,
+    __in PCWSTR pwszPrefix
+    )
+{
+    HRESULT hr = S_OK;
+
+    const DWORD cOld = _view.cShown + (_HasMore() ? 1 : 0);
+    if (_pSource->Filter(&_view, pwszPrefix, lstrlenW(pwszPrefix)))
+    {
+        _dwSelectedItem = 0;
+        if (_fStarted && (pcpce != NULL))
+        {
+            // Delete from the end, so no item moves before it goes.
+            for (DWORD i = cOld; SUCCEEDED(hr) && (i > 0); i--)
+            {
+                hr = pcpce->DeleteFieldComboBoxItem(pcpc, dwFieldID, i - 1);
+            }
+            if (SUCCEEDED(hr))
+            {
+                hr = _AppendPage(pcpc, pcpce, dwFieldID);
+            }
+            if (SUCCEEDED(hr) && (_view.cShown > 0))
+            {
+                hr = pcpce->SetFieldComboBoxSelectedItem(pcpc, dwFieldID, 0);
+            }
+        }
+        else
+        {
+            // LogonUI hasn't asked for the items yet, or can't be told about
+            // new ones; either way it gets the first page when it asks.
+            _fStarted = false;
+        }
+    }
+
+    return hr;
+}
+
+HRESULT ComboBoxSourceOpenFromRegistry(
+    __in PCWSTR pszKey,
+    __in PCWSTR pszValue,
+    __deref_out CComboBoxSource** ppSource
+    )
+{
+    *ppSource = NULL;
+
+    // RRF_RT_REG_SZ also takes REG_EXPAND_SZ, and expands it.
+    WCHAR szPath[MAX_PATH];
+    DWORD cb = sizeof(szPath);
+    HRESULT hr = HRESULT_FROM_WIN32(RegGetValueW(HKEY_LOCAL_MACHINE, pszKey, pszValue, RRF_RT_REG_SZ, NULL, szPath, &cb));
+    if (SUCCEEDED(hr))
+    {
+        CComboBoxSource* pSource = new CComboBoxSource();
+        if (pSource != NULL)
+        {
+            hr = pSource->Open(szPath);
+            if (SUCCEEDED(hr))
+            {
+                *ppSource = pSource;
+            }
+            else
+            {
+                pSource->Release();
+            }
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
+    return hr;
+}
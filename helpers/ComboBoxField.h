@@ -0,0 +1,84 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CComboBoxField is the state behind one credential's combobox when its
+// items come from a CComboBoxSource.  LogonUI asks for every item of a
+// combobox when it shows the tile, which at tens of thousands of items is
+// far too many, so the combobox is given a page of them at a time with a
+// "More..." item after the last.  Selecting "More..." appends the next page
+// through ICredentialProviderCredentialEvents.
+//
+// Filtering, typically on each keystroke in a username field, narrows the
+// items to those starting with what was typed and replaces the combobox's
+// items with the first page of them.
+
+#pragma once
+
+#include "helpers.h"
+#include "ComboBoxSource.h"
+
+// How many items the combobox is given at a time.
+#define COMBOBOX_PAGE_ITEMS     50
+
+#define COMBOBOX_MORE_ITEM      L"More..."
+
+class CComboBoxField
+{
+  public:
+    CComboBoxField();
+    ~CComboBoxField();
+
+    // Takes a reference on the source.
+    void Initialize(__in CComboBoxSource* pSource);
+
+    bool IsInitialized() const
+    {
+        return (_pSource != NULL);
+    }
+
+    HRESULT GetValueCount(__out DWORD* pcItems, __out DWORD* pdwSelectedItem);
+    HRESULT GetValueAt(__in DWORD dwItem, __deref_out PWSTR* ppwszItem);
+
+    // Records the selection, or shows the next page if it is "More...".
+    HRESULT SetSelectedValue(__in ICredentialProviderCredential* pcpc,
+                             __in_opt ICredentialProviderCredentialEvents* pcpce,
+                             __in DWORD dwFieldID,
+                             __in DWORD dwSelectedItem);
+
+    // Shows only the items starting with pwszPrefix, ignoring case.
+    HRESULT SetFilter(__in ICredentialProviderCredential* pcpc,
+                      __in_opt ICredentialProviderCredentialEvents* pcpce,
+                      __in DWORD dwFieldID,
+                      __in PCWSTR pwszPrefix);
+
+  private:
+    bool _HasMore() const
+    {
+        return (_view.cShown < _pSource->GetMatchCount(&_view));
+    }
+
+    void _ShowFirstPage();
+    HRESULT _AppendPage(__in ICredentialProviderCredential* pcpc,
+                        __in ICredentialProviderCredentialEvents* pcpce,
+                        __in DWORD dwFieldID);
+    HRESULT _CopyMatch(__in DWORD iMatch, __deref_out PWSTR* ppwsz);
+
+  private:
+    CComboBoxSource*    _pSource;
+    COMBOBOX_VIEW       _view;
+    bool                _fStarted;          // Whether LogonUI has been given the first page.
+    DWORD               _dwSelectedItem;
+};
+
+// Opens the combobox source named by a REG_SZ or REG_EXPAND_SZ value, which
+// is how a provider finds its item file.  Fails if there's no value.
+HRESULT ComboBoxSourceOpenFromRegistry(
+    __in PCWSTR pszKey,
+    __in PCWSTR pszValue,
+    __deref_out CComboBoxSource** ppSource
+    );
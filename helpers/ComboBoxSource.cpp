@@ -0,0 +1,328 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "ComboBoxSource.h"
+
+#include <string.h>
+
+// The sort works on the first four folded characters of each item packed
+// into one integer, so most comparisons never touch the mapped text.
+struct SORT_ENTRY
+{
+    ULONGLONG   ullKey;
+    DWORD       iItem;
+};
+
+CComboBoxSource::CComboBoxSource():
+    _cRef(1),
+    _rgiLine(NULL),
+    _cItems(0),
+    _rgiSorted(NULL)
+{
+}
+
+CComboBoxSource::~CComboBoxSource()
+{
+    delete [] _rgiSorted;
+    delete [] _rgiLine;
+}
+
+LONG CComboBoxSource::AddRef()
+{
+#ifdef _WIN32
+    return InterlockedIncrement(&_cRef);
+#else
+    return __sync_add_and_fetch(&_cRef, 1);
+#endif
+}
+
+LONG CComboBoxSource::Release()
+{
+#ifdef _WIN32
+    LONG cRef = InterlockedDecrement(&_cRef);
+#else
+    LONG cRef = __sync_sub_and_fetch(&_cRef, 1);
+#endif
+    if (!cRef)
+    {
+        delete this;
+    }
+    return cRef;
+}
+
+HRESULT CComboBoxSource::Open(LINE_FILE_PATH pszPath)
+{
+    HRESULT hr = _file.Open(pszPath);
+    if (SUCCEEDED(hr))
+    {
+        hr = _Index();
+    }
+    return hr;
+}
+
+// Folds case for the index.  Only ASCII and Latin-1 letters are folded; it
+// needs to be cheap and the same on every system more than it needs to be
+// complete.
+WCHAR CComboBoxSource::_Fold(WCHAR ch)
+{
+    if ((ch >= L'A') && (ch <= L'Z'))
+    {
+        ch = (WCHAR)(ch + (L'a' - L'A'));
+    }
+    else if ((ch >= 0xC0) && (ch <= 0xDE) && (ch != 0xD7))
+    {
+        ch = (WCHAR)(ch + 0x20);
+    }
+    return ch;
+}
+
+static ULONGLONG _SortKey(const WCHAR* pch, DWORD cch, WCHAR (*pfnFold)(WCHAR))
+{
+    ULONGLONG ullKey = 0;
+    for (DWORD i = 0; i < 4; i++)
+    {
+        ullKey <<= 16;
+        if (i < cch)
+        {
+            ullKey |= pfnFold(pch[i]);
+        }
+    }
+    return ullKey;
+}
+
+// Collects the file's non-empty lines as items, then sorts their indexes
+// into _rgiSorted.
+HRESULT CComboBoxSource::_Index()
+{
+    HRESULT hr = S_OK;
+
+    _rgiLine = new DWORD[_file.GetCount() + 1];
+    if (_rgiLine == NULL)
+    {
+        hr = E_OUTOFMEMORY;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        for (DWORD iLine = 0; iLine < _file.GetCount(); iLine++)
+        {
+            DWORD cch;
+            _file.GetLine(iLine, &cch);
+            if (cch > 0)
+            {
+                _rgiLine[_cItems++] = iLine;
+            }
+        }
+    }
+
+    SORT_ENTRY* rgEntry = NULL;
+    if (SUCCEEDED(hr))
+    {
+        _rgiSorted = new DWORD[_cItems + 1];
+        rgEntry = new SORT_ENTRY[_cItems + 1];
+        if ((_rgiSorted == NULL) || (rgEntry == NULL))
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        for (DWORD i = 0; i < _cItems; i++)
+        {
+            DWORD cch;
+            const WCHAR* pch = GetItem(i, &cch);
+            rgEntry[i].ullKey = _SortKey(pch, cch, _Fold);
+            rgEntry[i].iItem = i;
+        }
+
+        // Heapsort, so a hostile file can't make it quadratic.  Ties go to
+        // the earlier line, so duplicates keep the file's order.
+        DWORD cHeap = _cItems;
+        for (DWORD iStart = cHeap / 2; iStart > 0; iStart--)
+        {
+            _SiftDown(rgEntry, iStart - 1, cHeap);
+        }
+        while (cHeap > 1)
+        {
+            cHeap--;
+            SORT_ENTRY entry = rgEntry[0];
+            rgEntry[0] = rgEntry[cHeap];
+            rgEntry[cHeap] = entry;
+            _SiftDown(rgEntry, 0, cHeap);
+        }
+
+        for (DWORD i = 0; i < _cItems; i++)
+        {
+            _rgiSorted[i] = rgEntry[i].iItem;
+        }
+    }
+
+    delete [] rgEntry;
+    return hr;
+}
+
+// Orders two entries by their folded text, then by line.
+int CComboBoxSource::_CompareEntries(const SORT_ENTRY& a, const SORT_ENTRY& b) const
+{
+    int iResult = 0;
+    if (a.ullKey != b.ullKey)
+    {
+        iResult = (a.ullKey < b.ullKey) ? -1 : 1;
+    }
+    else
+    {
+        // The keys hold the first four characters, so only the rest are left.
+        DWORD cchA;
+        DWORD cchB;
+        const WCHAR* pchA = GetItem(a.iItem, &cchA);
+        const WCHAR* pchB = GetItem(b.iItem, &cchB);
+        const DWORD cchMin = (cchA < cchB) ? cchA : cchB;
+        for (DWORD i = 4; (i < cchMin) && (iResult == 0); i++)
+        {
+            WCHAR chA = _Fold(pchA[i]);
+            WCHAR chB = _Fold(pchB[i]);
+            if (chA != chB)
+            {
+                iResult = (chA < chB) ? -1 : 1;
+            }
+        }
+        if ((iResult == 0) && (cchA != cchB))
+        {
+            iResult = (cchA < cchB) ? -1 : 1;
+        }
+        if ((iResult == 0) && (a.iItem != b.iItem))
+        {
+            iResult = (a.iItem < b.iItem) ? -1 : 1;
+        }
+    }
+    return iResult;
+}
+
+void CComboBoxSource::_SiftDown(SORT_ENTRY* rgEntry, DWORD iRoot, DWORD cEntries) const
+{
+    SORT_ENTRY entry = rgEntry[iRoot];
+    DWORD iChild = 2 * iRoot + 1;
+    while (iChild < cEntries)
+    {
+        if ((iChild + 1 < cEntries) && (_CompareEntries(rgEntry[iChild], rgEntry[iChild + 1]) < 0))
+        {
+            iChild++;
+        }
+        if (_CompareEntries(entry, rgEntry[iChild]) >= 0)
+        {
+            break;
+        }
+        rgEntry[iRoot] = rgEntry[iChild];
+        iRoot = iChild;
+        iChild = 2 * iRoot + 1;
+    }
+    rgEntry[iRoot] = entry;
+}
+
+// Compares the start of an item with a folded prefix: less than zero if the
+// item sorts before every item starting with it, zero if the item starts
+// with it, and more than zero if the item sorts after them.
+int CComboBoxSource::_ComparePrefix(DWORD iItem, const WCHAR* pch, DWORD cch) const
+{
+    DWORD cchItem;
+    const WCHAR* pchItem = GetItem(iItem, &cchItem);
+    int iResult = 0;
+    for (DWORD i = 0; (i < cch) && (iResult == 0); i++)
+    {
+        if (i == cchItem)
+        {
+            iResult = -1;
+        }
+        else
+        {
+            WCHAR ch = _Fold(pchItem[i]);
+            if (ch != pch[i])
+            {
+                iResult = (ch < pch[i]) ? -1 : 1;
+            }
+        }
+    }
+    return iResult;
+}
+
+void CComboBoxSource::ResetView(COMBOBOX_VIEW* pView) const
+{
+    pView->iFirst = 0;
+    pView->iLast = _cItems;
+    pView->cShown = 0;
+    pView->cchPrefix = 0;
+}
+
+bool CComboBoxSource::Filter(COMBOBOX_VIEW* pView, const WCHAR* pch, DWORD cch) const
+{
+    if (cch > COMBOBOX_PREFIX_MAX)
+    {
+        cch = COMBOBOX_PREFIX_MAX;
+    }
+
+    WCHAR rgchPrefix[COMBOBOX_PREFIX_MAX];
+    for (DWORD i = 0; i < cch; i++)
+    {
+        rgchPrefix[i] = _Fold(pch[i]);
+    }
+
+    // A prefix that extends the view's can only match items the view already
+    // does, so only its run needs searching.  Anything else starts over.
+    DWORD iLow = 0;
+    DWORD iHigh = _cItems;
+    if ((cch >= pView->cchPrefix) && (memcmp(rgchPrefix, pView->rgchPrefix, pView->cchPrefix * sizeof(WCHAR)) == 0))
+    {
+        iLow = pView->iFirst;
+        iHigh = pView->iLast;
+    }
+
+    // The first item that doesn't sort before the prefix...
+    DWORD iFirst = iLow;
+    DWORD iEnd = iHigh;
+    while (iFirst < iEnd)
+    {
+        DWORD iMid = iFirst + (iEnd - iFirst) / 2;
+        if (_ComparePrefix(_rgiSorted[iMid], rgchPrefix, cch) < 0)
+        {
+            iFirst = iMid + 1;
+        }
+        else
+        {
+            iEnd = iMid;
+        }
+    }
+
+    // ...and the first after it that sorts after the prefix.
+    DWORD iLast = iFirst;
+    iEnd = iHigh;
+    while (iLast < iEnd)
+    {
+        DWORD iMid = iLast + (iEnd - iLast) / 2;
+        if (_ComparePrefix(_rgiSorted[iMid], rgchPrefix, cch) <= 0)
+        {
+            iLast = iMid + 1;
+        }
+        else
+        {
+            iEnd = iMid;
+        }
+    }
+
+    const bool fChanged = (iFirst != pView->iFirst) || (iLast != pView->iLast);
+    pView->iFirst = iFirst;
+    pView->iLast = iLast;
+    pView->cchPrefix = cch;
+    memcpy(pView->rgchPrefix, rgchPrefix, cch * sizeof(WCHAR));
+    if (fChanged)
+    {
+        pView->cShown = 0;
+    }
+    return fChanged;
+}
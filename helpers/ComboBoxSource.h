@@ -0,0 +1,104 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CComboBoxSource holds the items for a combobox that is too long to keep
+// in a static array: tens of thousands of databases, cost centres or
+// domains.  The items are read from a UTF-16LE file, one per line, which
+// is mapped rather than read (CLineFile), so an item's text is never copied
+// until it is handed to LogonUI.
+//
+// Opening the file also builds a prefix index: the items sorted by their
+// case-folded text.  The items starting with a given prefix are then a
+// single run of that order, found by binary search, and each keystroke
+// typed onto a prefix only has to search the run the shorter prefix left.
+// A COMBOBOX_VIEW remembers that run for one combobox, along with how many
+// of its items the combobox has been given so far.
+//
+// A source is shared by every credential showing it, so it is reference
+// counted.  It has no COM or LogonUI dependencies, and on other systems
+// maps the file with mmap, so the index can be measured without LogonUI.
+
+#pragma once
+
+#include "LineFile.h"
+
+// Longest prefix a view filters on; anything typed past it is ignored, which
+// can only leave more items in the view, never fewer.
+#define COMBOBOX_PREFIX_MAX     64
+
+struct SORT_ENTRY;
+
+// The items of a source starting with a prefix, in sorted order.  Start one
+// with CComboBoxSource::ResetView.
+struct COMBOBOX_VIEW
+{
+    DWORD       iFirst;                             // The run of the sorted order
+    DWORD       iLast;                              // [iFirst, iLast) that matches.
+    DWORD       cShown;                             // How many of the run the combobox has.
+    DWORD       cchPrefix;
+    WCHAR       rgchPrefix[COMBOBOX_PREFIX_MAX];    // Folded.
+};
+
+class CComboBoxSource
+{
+  public:
+    CComboBoxSource();
+
+    LONG AddRef();
+    LONG Release();
+
+    // Maps the file and indexes it.  Empty lines are skipped.
+    HRESULT Open(LINE_FILE_PATH pszPath);
+
+    DWORD GetCount() const
+    {
+        return _cItems;
+    }
+
+    // The text of an item in file order.  It isn't NUL-terminated.
+    const WCHAR* GetItem(DWORD iItem, DWORD* pcch) const
+    {
+        return _file.GetLine(_rgiLine[iItem], pcch);
+    }
+
+    // Starts a view that matches every item.
+    void ResetView(COMBOBOX_VIEW* pView) const;
+
+    // Narrows, or widens, a view to the items starting with the prefix,
+    // ignoring case.  Returns true if the view now matches different items,
+    // in which case cShown is back to 0.
+    bool Filter(COMBOBOX_VIEW* pView, const WCHAR* pch, DWORD cch) const;
+
+    DWORD GetMatchCount(const COMBOBOX_VIEW* pView) const
+    {
+        return pView->iLast - pView->iFirst;
+    }
+
+    // The i'th match of a view, as an item index for GetItem.
+    DWORD GetMatch(const COMBOBOX_VIEW* pView, DWORD i) const
+    {
+        return _rgiSorted[pView->iFirst + i];
+    }
+
+  private:
+    ~CComboBoxSource();
+
+    HRESULT _Index();
+    int _CompareEntries(const SORT_ENTRY& a, const SORT_ENTRY& b) const;
+    void _SiftDown(SORT_ENTRY* rgEntry, DWORD iRoot, DWORD cEntries) const;
+    int _ComparePrefix(DWORD iItem, const WCHAR* pch, DWORD cch) const;
+
+    static WCHAR _Fold(WCHAR ch);
+
+  private:
+    LONG            _cRef;
+    CLineFile       _file;
+    DWORD*          _rgiLine;           // The line of each item; empty lines aren't items.
+    DWORD           _cItems;
+    DWORD*          _rgiSorted;         // Item indexes sorted by folded text.
+};
@@ -0,0 +1,142 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "FieldStateRules.h"
+
+#include <string.h>
+
+CFieldStateRules::CFieldStateRules():
+    _cFields(0),
+    _dwRuled(0),
+    _dwDirty(0),
+    _fApplied(false)
+{
+    memset(_rgdwReaders, 0, sizeof(_rgdwReaders));
+    memset(_rgpRule, 0, sizeof(_rgpRule));
+    memset(_rgdwValue, 0, sizeof(_rgdwValue));
+    memset(_rgcpfs, 0, sizeof(_rgcpfs));
+    memset(_rgcpfis, 0, sizeof(_rgcpfis));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+HRESULT CFieldStateRules::Initialize(const FIELD_STATE_RULE* rgRules, DWORD cRules, DWORD cFields)
+{
+    HRESULT hr = (cFields <= FIELD_STATE_RULES_MAX) ? S_OK : E_INVALIDARG;
+    const DWORD dwFields = (cFields < FIELD_STATE_RULES_MAX) ? (FIELD_STATE_INPUT(cFields) - 1) : 0xFFFFFFFF;
+
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < cRules); i++)
+    {
+        const FIELD_STATE_RULE& rule = rgRules[i];
+        if ((rule.dwFieldID < cFields) && !(rule.dwInputs & ~dwFields) && (_rgpRule[rule.dwFieldID] == NULL))
+        {
+            _rgpRule[rule.dwFieldID] = &rule;
+            _dwRuled |= FIELD_STATE_INPUT(rule.dwFieldID);
+            for (DWORD dwInput = 0; dwInput < cFields; dwInput++)
+            {
+                if (rule.dwInputs & FIELD_STATE_INPUT(dwInput))
+                {
+                    _rgdwReaders[dwInput] |= FIELD_STATE_INPUT(rule.dwFieldID);
+                }
+            }
+        }
+        else
+        {
+            hr = E_INVALIDARG;
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        _cFields = cFields;
+        _dwDirty = _dwRuled;
+    }
+    return hr;
+}
+
+void CFieldStateRules::SetValue(DWORD dwFieldID, DWORD dwValue)
+{
+    if (dwFieldID < _cFields)
+    {
+        _stats.cValuesSet++;
+        if (_rgdwValue[dwFieldID] != dwValue)
+        {
+            _rgdwValue[dwFieldID] = dwValue;
+            _dwDirty |= _rgdwReaders[dwFieldID];
+            _stats.cValuesChanged++;
+        }
+    }
+}
+
+HRESULT CFieldStateRules::Apply(CFieldStateSink* pSink)
+{
+    HRESULT hr = S_OK;
+    const bool fSend = _fApplied && (pSink != NULL);
+
+    // Clear the marks first, so a sink that sets a value while it's being
+    // told about a change only marks what has to run next time.
+    DWORD dwDirty = _dwDirty;
+    _dwDirty = 0;
+
+    for (DWORD dwFieldID = 0; dwDirty != 0; dwFieldID++, dwDirty >>= 1)
+    {
+        if (dwDirty & 1)
+        {
+            CREDENTIAL_PROVIDER_FIELD_STATE cpfs = _rgcpfs[dwFieldID];
+            CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis = _rgcpfis[dwFieldID];
+            _rgpRule[dwFieldID]->pfn(_rgdwValue, &cpfs, &cpfis);
+            _stats.cEvaluations++;
+
+            if (cpfs != _rgcpfs[dwFieldID])
+            {
+                _rgcpfs[dwFieldID] = cpfs;
+                if (fSend)
+                {
+                    HRESULT hrSink = pSink->SetFieldState(dwFieldID, cpfs);
+                    hr = SUCCEEDED(hr) ? hrSink : hr;
+                    _stats.cEvents++;
+                }
+            }
+            else if (fSend)
+            {
+                _stats.cEventsSaved++;
+            }
+
+            if (cpfis != _rgcpfis[dwFieldID])
+            {
+                _rgcpfis[dwFieldID] = cpfis;
+                if (fSend)
+                {
+                    HRESULT hrSink = pSink->SetFieldInteractiveState(dwFieldID, cpfis);
+                    hr = SUCCEEDED(hr) ? hrSink : hr;
+                    _stats.cEvents++;
+                }
+            }
+            else if (fSend)
+            {
+                _stats.cEventsSaved++;
+            }
+        }
+    }
+
+    _fApplied = true;
+    return hr;
+}
+
+bool CFieldStateRules::GetState(DWORD dwFieldID,
+                                CREDENTIAL_PROVIDER_FIELD_STATE* pcpfs,
+                                CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE* pcpfis) const
+{
+    bool fRuled = (dwFieldID < _cFields) && (_dwRuled & FIELD_STATE_INPUT(dwFieldID));
+    if (fRuled)
+    {
+        *pcpfs = _rgcpfs[dwFieldID];
+        *pcpfis = _rgcpfis[dwFieldID];
+    }
+    return fRuled;
+}
@@ -0,0 +1,175 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CFieldStateRules works out a credential's field states from its field
+// values, so a credential declares which fields show or are enabled when,
+// rather than calling SetFieldState and SetFieldInteractiveState from each
+// handler that could change them.
+//
+// Each rule computes the state pair of one field from the values of the
+// fields named in its input mask.  A field's value is whatever DWORD the
+// credential says it is: whether a checkbox is checked, which combobox item
+// is selected, whether an edit field is empty.  When a value changes only
+// the rules that read it are marked, and Apply runs just those, sending an
+// event for each half of a state pair that came out different.  An
+// unchanged value marks nothing, so a keystroke that doesn't empty or fill
+// an edit field costs nothing past the comparison.
+//
+// Events go to a CFieldStateSink rather than straight to LogonUI.  The
+// credential passes a CCredentialEventsSink, and anything else can pass its
+// own, so the rules have no COM or LogonUI dependencies.
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#include <credentialprovider.h>
+
+#else
+#include <stdint.h>
+#include <stddef.h>
+
+// Just enough of the Windows and LogonUI types for the rules.
+typedef int32_t HRESULT;
+typedef uint32_t DWORD;
+
+#define S_OK            ((HRESULT)0)
+#define E_INVALIDARG    ((HRESULT)0x80070057)
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+
+enum CREDENTIAL_PROVIDER_FIELD_STATE
+{
+    CPFS_HIDDEN = 0,
+    CPFS_DISPLAY_IN_SELECTED_TILE,
+    CPFS_DISPLAY_IN_DESELECTED_TILE,
+    CPFS_DISPLAY_IN_BOTH,
+};
+
+enum CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE
+{
+    CPFIS_NONE = 0,
+    CPFIS_READONLY,
+    CPFIS_DISABLED,
+    CPFIS_FOCUSED,
+};
+#endif
+
+// Field IDs have to be below this, so a rule's inputs fit in a mask.
+#define FIELD_STATE_RULES_MAX   32
+
+#define FIELD_STATE_INPUT(dwFieldID)    ((DWORD)1 << (dwFieldID))
+
+// Computes one field's state pair from the values of every field, of which
+// it may only read those in its rule's input mask.
+typedef void (*PFN_FIELD_STATE_RULE)(const DWORD* rgdwValue,
+                                     CREDENTIAL_PROVIDER_FIELD_STATE* pcpfs,
+                                     CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE* pcpfis);
+
+struct FIELD_STATE_RULE
+{
+    DWORD                   dwFieldID;  // The field whose state this decides.
+    DWORD                   dwInputs;   // FIELD_STATE_INPUT of each field it reads.
+    PFN_FIELD_STATE_RULE    pfn;
+};
+
+struct FIELD_STATE_RULES_STATS
+{
+    DWORD   cValuesSet;
+    DWORD   cValuesChanged;
+    DWORD   cEvaluations;               // Rules run.
+    DWORD   cEvents;                    // Events sent to the sink.
+    DWORD   cEventsSaved;               // Halves of state pairs a rule left as they were.
+};
+
+// Where the changed states go.
+class CFieldStateSink
+{
+  public:
+    virtual HRESULT SetFieldState(DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_STATE cpfs) = 0;
+    virtual HRESULT SetFieldInteractiveState(DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis) = 0;
+};
+
+#ifdef _WIN32
+// Sends the changed states to LogonUI on behalf of one credential.
+class CCredentialEventsSink : public CFieldStateSink
+{
+  public:
+    CCredentialEventsSink(ICredentialProviderCredential* pcpc, ICredentialProviderCredentialEvents* pcpce):
+        _pcpc(pcpc),
+        _pcpce(pcpce)
+    {
+    }
+
+    HRESULT SetFieldState(DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_STATE cpfs)
+    {
+        return _pcpce->SetFieldState(_pcpc, dwFieldID, cpfs);
+    }
+
+    HRESULT SetFieldInteractiveState(DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis)
+    {
+        return _pcpce->SetFieldInteractiveState(_pcpc, dwFieldID, cpfis);
+    }
+
+  private:
+    ICredentialProviderCredential*          _pcpc;
+    ICredentialProviderCredentialEvents*    _pcpce;
+};
+#endif
+
+class CFieldStateRules
+{
+  public:
+    CFieldStateRules();
+
+    // The rules aren't copied, so they have to outlive the object; a static
+    // table is usual.  At most one rule per field.  Every value starts at
+    // zero, and every rule is marked to run at the first Apply.
+    HRESULT Initialize(const FIELD_STATE_RULE* rgRules, DWORD cRules, DWORD cFields);
+
+    // Records a field's value, marking the rules that read it if it changed.
+    void SetValue(DWORD dwFieldID, DWORD dwValue);
+
+    // Runs the marked rules and sends what changed to pSink, which may be
+    // NULL if nothing has advised yet; the states are updated either way.
+    // The first Apply sends nothing, since LogonUI gets the starting states
+    // from GetFieldState.  Returns the first failure from the sink but still
+    // runs every marked rule.
+    HRESULT Apply(CFieldStateSink* pSink);
+
+    HRESULT Update(DWORD dwFieldID, DWORD dwValue, CFieldStateSink* pSink)
+    {
+        SetValue(dwFieldID, dwValue);
+        return Apply(pSink);
+    }
+
+    // Gets the state a rule gave a field.  False if no rule decides it, in
+    // which case the credential's own state for it stands.
+    bool GetState(DWORD dwFieldID,
+                  CREDENTIAL_PROVIDER_FIELD_STATE* pcpfs,
+                  CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE* pcpfis) const;
+
+    void GetStats(FIELD_STATE_RULES_STATS* pStats) const
+    {
+        *pStats = _stats;
+    }
+
+  private:
+    DWORD                       _cFields;
+    DWORD                       _dwRuled;                               // The fields a rule decides.
+    DWORD                       _rgdwReaders[FIELD_STATE_RULES_MAX];    // The fields whose rules read each field.
+    const FIELD_STATE_RULE*     _rgpRule[FIELD_STATE_RULES_MAX];        // The rule for each field.
+    DWORD                       _rgdwValue[FIELD_STATE_RULES_MAX];
+    DWORD                       _dwDirty;                               // The fields whose rules have to run.
+    bool                        _fApplied;                              // Whether the states have been worked out once.
+
+    CREDENTIAL_PROVIDER_FIELD_STATE             _rgcpfs[FIELD_STATE_RULES_MAX];
+    CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE _rgcpfis[FIELD_STATE_RULES_MAX];
+
+    FIELD_STATE_RULES_STATS     _stats;
+};
@@ -0,0 +1,119 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "KerbLogonView.h"
+
+#include <string.h>
+
+// A packed KERB_INTERACTIVE_UNLOCK_LOGON is a KERB_INTERACTIVE_LOGON (the
+// message type, then the domain, username and password UNICODE_STRINGs)
+// and a LUID, with each UNICODE_STRING's Buffer holding the offset of its
+// characters from the start of the blob.  Where each field sits depends
+// only on the size of a pointer.
+static const DWORD s_cbLuid = 8;
+
+static DWORD _UnicodeStringSize(DWORD cbPointer)
+{
+    // Length and MaximumLength, padded out to a pointer, then Buffer.
+    return 2 * cbPointer;
+}
+
+CKerbLogonView::CKerbLogonView():
+    _dwMessageType(0)
+{
+    _spanDomain.pch = NULL;
+    _spanDomain.cch = 0;
+    _spanUsername = _spanDomain;
+    _spanPassword = _spanDomain;
+}
+
+// Reads the UNICODE_STRING at ibString and checks that its characters are
+// inside the blob, after the header, and aligned.
+HRESULT CKerbLogonView::_ReadString(const BYTE* rgb, DWORD cb, DWORD cbHeader, DWORD ibString, bool fPacked32, COUNTED_SPAN* pspan)
+{
+    HRESULT hr = S_OK;
+
+    USHORT cbLength;
+    USHORT cbMaximumLength;
+    memcpy(&cbLength, rgb + ibString, sizeof(cbLength));
+    memcpy(&cbMaximumLength, rgb + ibString + sizeof(cbLength), sizeof(cbMaximumLength));
+
+    unsigned long long ullOffset = 0;
+    if (fPacked32)
+    {
+        DWORD dwOffset;
+        memcpy(&dwOffset, rgb + ibString + 4, sizeof(dwOffset));
+        ullOffset = dwOffset;
+    }
+    else
+    {
+        memcpy(&ullOffset, rgb + ibString + 8, sizeof(ullOffset));
+    }
+
+    pspan->pch = NULL;
+    pspan->cch = 0;
+    if ((cbLength % sizeof(WCHAR)) || (cbLength > cbMaximumLength))
+    {
+        hr = E_INVALIDARG;
+    }
+    else if (cbLength != 0)
+    {
+        if ((ullOffset < cbHeader) || (ullOffset > cb) || (cbLength > cb - ullOffset) ||
+            (((size_t)rgb + (size_t)ullOffset) % sizeof(WCHAR)))
+        {
+            hr = E_INVALIDARG;
+        }
+        else
+        {
+            pspan->pch = (const WCHAR*)(rgb + ullOffset);
+            pspan->cch = cbLength / sizeof(WCHAR);
+        }
+    }
+
+    return hr;
+}
+
+HRESULT CKerbLogonView::Initialize(const BYTE* rgb, DWORD cb, bool fPacked32)
+{
+    HRESULT hr = S_OK;
+
+    const DWORD cbPointer = fPacked32 ? 4 : (DWORD)sizeof(void*);
+    if (cbPointer == 4)
+    {
+        fPacked32 = true;
+    }
+
+    // The message type is padded out to a pointer before the strings.
+    const DWORD ibDomain = cbPointer;
+    const DWORD ibUsername = ibDomain + _UnicodeStringSize(cbPointer);
+    const DWORD ibPassword = ibUsername + _UnicodeStringSize(cbPointer);
+    DWORD cbHeader = ibPassword + _UnicodeStringSize(cbPointer) + s_cbLuid;
+    cbHeader = (cbHeader + cbPointer - 1) & ~(cbPointer - 1);
+
+    if ((rgb == NULL) || (cb < cbHeader))
+    {
+        hr = E_INVALIDARG;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        memcpy(&_dwMessageType, rgb, sizeof(_dwMessageType));
+        hr = _ReadString(rgb, cb, cbHeader, ibDomain, fPacked32, &_spanDomain);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = _ReadString(rgb, cb, cbHeader, ibUsername, fPacked32, &_spanUsername);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = _ReadString(rgb, cb, cbHeader, ibPassword, fPacked32, &_spanPassword);
+    }
+
+    return hr;
+}
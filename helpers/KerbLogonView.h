@@ -0,0 +1,88 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CKerbLogonView reads a packed KERB_INTERACTIVE_UNLOCK_LOGON, as passed to
+// SetSerialization, where it lies: in the caller's buffer.  Nothing is
+// copied or unpacked in place.  Initialize checks that the header fits and
+// that each string's offset and length fall inside the buffer, and the
+// domain, username and password are then handed out as counted spans into
+// it, which are only good for as long as the buffer is.  A provider that
+// needs them later copies just those, not the whole blob.
+//
+// The layout is read field by field, so a blob packed by a 32-bit caller
+// (CREDUIWIN_PACK_32_WOW) is read as it is, without repacking it first.  It
+// has no Windows dependencies, so it also builds elsewhere.
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+
+#else
+#include <stdint.h>
+#include <stddef.h>
+
+// Just enough of the Windows types to read the blob.
+typedef int32_t HRESULT;
+typedef uint8_t BYTE;
+typedef uint16_t WCHAR;
+typedef uint16_t USHORT;
+typedef uint32_t DWORD;
+
+#define S_OK            ((HRESULT)0)
+#define E_INVALIDARG    ((HRESULT)0x80070057)
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+#endif
+
+// A counted string in the caller's buffer.  It isn't NUL-terminated.
+struct COUNTED_SPAN
+{
+    const WCHAR*    pch;
+    DWORD           cch;
+};
+
+class CKerbLogonView
+{
+  public:
+    CKerbLogonView();
+
+    // Checks the blob and finds its strings.  fPacked32 is for a blob laid
+    // out with 32-bit pointers, whatever this process's are.
+    HRESULT Initialize(const BYTE* rgb, DWORD cb, bool fPacked32);
+
+    // A KERB_LOGON_SUBMIT_TYPE.
+    DWORD GetMessageType() const
+    {
+        return _dwMessageType;
+    }
+
+    const COUNTED_SPAN& GetDomain() const
+    {
+        return _spanDomain;
+    }
+
+    const COUNTED_SPAN& GetUsername() const
+    {
+        return _spanUsername;
+    }
+
+    const COUNTED_SPAN& GetPassword() const
+    {
+        return _spanPassword;
+    }
+
+  private:
+    HRESULT _ReadString(const BYTE* rgb, DWORD cb, DWORD cbHeader, DWORD ibString, bool fPacked32, COUNTED_SPAN* pspan);
+
+  private:
+    DWORD           _dwMessageType;
+    COUNTED_SPAN    _spanDomain;
+    COUNTED_SPAN    _spanUsername;
+    COUNTED_SPAN    _spanPassword;
+};
@@ -0,0 +1,208 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "LineFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+CLineFile::CLineFile():
+#ifdef _WIN32
+    _hFile(INVALID_HANDLE_VALUE),
+    _hMapping(NULL),
+#else
+    _fd(-1),
+#endif
+    _pvView(NULL),
+    _cbView(0),
+    _pch(NULL),
+    _rgLine(NULL),
+    _cLines(0)
+{
+}
+
+CLineFile::~CLineFile()
+{
+    delete [] _rgLine;
+
+#ifdef _WIN32
+    if (_pvView != NULL)
+    {
+        UnmapViewOfFile(_pvView);
+    }
+    if (_hMapping != NULL)
+    {
+        CloseHandle(_hMapping);
+    }
+    if (_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(_hFile);
+    }
+#else
+    if (_pvView != NULL)
+    {
+        munmap(_pvView, _cbView);
+    }
+    if (_fd != -1)
+    {
+        close(_fd);
+    }
+#endif
+}
+
+HRESULT CLineFile::Open(LINE_FILE_PATH pszPath)
+{
+    HRESULT hr = S_OK;
+
+#ifdef _WIN32
+    _hFile = CreateFileW(pszPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (_hFile == INVALID_HANDLE_VALUE)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    LARGE_INTEGER liSize;
+    if (SUCCEEDED(hr))
+    {
+        if (!GetFileSizeEx(_hFile, &liSize))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else if (liSize.HighPart != 0)
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+        }
+    }
+
+    // An empty file can't be mapped; it just has no lines.
+    if (SUCCEEDED(hr) && (liSize.LowPart != 0))
+    {
+        _hMapping = CreateFileMappingW(_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (_hMapping == NULL)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            _pvView = MapViewOfFile(_hMapping, FILE_MAP_READ, 0, 0, 0);
+            if (_pvView == NULL)
+            {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+            }
+            else
+            {
+                _cbView = liSize.LowPart;
+            }
+        }
+    }
+#else
+    _fd = open(pszPath, O_RDONLY | O_CLOEXEC);
+    if (_fd == -1)
+    {
+        hr = E_FAIL;
+    }
+
+    struct stat st;
+    if (SUCCEEDED(hr))
+    {
+        if (fstat(_fd, &st) != 0)
+        {
+            hr = E_FAIL;
+        }
+        else if ((ULONGLONG)st.st_size > 0xFFFFFFFF)
+        {
+            hr = E_INVALIDARG;
+        }
+    }
+
+    if (SUCCEEDED(hr) && (st.st_size != 0))
+    {
+        void* pv = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+        if (pv == MAP_FAILED)
+        {
+            hr = E_FAIL;
+        }
+        else
+        {
+            _pvView = pv;
+            _cbView = (size_t)st.st_size;
+        }
+    }
+#endif
+
+    if (SUCCEEDED(hr))
+    {
+        hr = _Index();
+    }
+
+    return hr;
+}
+
+// Finds where each line starts and how long it is.
+HRESULT CLineFile::_Index()
+{
+    HRESULT hr = S_OK;
+
+    const WCHAR* pch = (const WCHAR*)_pvView;
+    DWORD cch = (DWORD)(_cbView / sizeof(WCHAR));
+    if ((cch > 0) && (pch[0] == 0xFEFF))
+    {
+        pch++;
+        cch--;
+    }
+    _pch = pch;
+
+    // A line ends at a line feed or the end of the file, but a line feed at
+    // the very end doesn't start another.
+    DWORD cMax = ((cch > 0) && (pch[cch - 1] != L'\n')) ? 1 : 0;
+    for (DWORD ich = 0; ich < cch; ich++)
+    {
+        if (pch[ich] == L'\n')
+        {
+            cMax++;
+        }
+    }
+    if (cMax > LINE_FILE_LINES_MAX)
+    {
+        cMax = LINE_FILE_LINES_MAX;
+    }
+
+    _rgLine = new LINE[cMax + 1];
+    if (_rgLine == NULL)
+    {
+        hr = E_OUTOFMEMORY;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        DWORD ichStart = 0;
+        for (DWORD ich = 0; (ich <= cch) && (_cLines < cMax); ich++)
+        {
+            if ((ich == cch) || (pch[ich] == L'\n'))
+            {
+                DWORD ichEnd = ich;
+                if ((ichEnd > ichStart) && (pch[ichEnd - 1] == L'\r'))
+                {
+                    ichEnd--;
+                }
+                _rgLine[_cLines].ich = ichStart;
+                _rgLine[_cLines].cch = ichEnd - ichStart;
+                _cLines++;
+                ichStart = ich + 1;
+            }
+        }
+    }
+
+    return hr;
+}
@@ -0,0 +1,94 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CLineFile maps a UTF-16LE text file and finds where each of its lines
+// starts, so a line can be read in place without copying it.  A byte order
+// mark at the start is skipped and a carriage return before each line feed
+// is left out of the line.  Empty lines are kept, so line numbers match the
+// file.
+//
+// It has no COM or LogonUI dependencies, and on other systems maps the file
+// with mmap, so what's built on it can be measured without LogonUI.
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef PCWSTR LINE_FILE_PATH;
+
+#else
+#include <stdint.h>
+#include <stddef.h>
+
+// Just enough of the Windows types for these helpers.
+typedef int32_t HRESULT;
+typedef uint16_t WCHAR;
+typedef uint16_t USHORT;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint64_t ULONGLONG;
+
+#define S_OK            ((HRESULT)0)
+#define S_FALSE         ((HRESULT)1)
+#define E_FAIL          ((HRESULT)0x80004005)
+#define E_OUTOFMEMORY   ((HRESULT)0x8007000E)
+#define E_INVALIDARG    ((HRESULT)0x80070057)
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+
+typedef const char* LINE_FILE_PATH;
+#endif
+
+// Most lines read from one file; any after it are ignored.
+#define LINE_FILE_LINES_MAX     (4 * 1024 * 1024)
+
+class CLineFile
+{
+  public:
+    CLineFile();
+    ~CLineFile();
+
+    // Maps the file and finds its lines.  Call it once.
+    HRESULT Open(LINE_FILE_PATH pszPath);
+
+    DWORD GetCount() const
+    {
+        return _cLines;
+    }
+
+    // The text of a line.  It isn't NUL-terminated.
+    const WCHAR* GetLine(DWORD iLine, DWORD* pcch) const
+    {
+        *pcch = _rgLine[iLine].cch;
+        return _pch + _rgLine[iLine].ich;
+    }
+
+  private:
+    HRESULT _Index();
+
+  private:
+    struct LINE
+    {
+        DWORD   ich;                    // Offset into the mapping.
+        DWORD   cch;
+    };
+
+#ifdef _WIN32
+    HANDLE          _hFile;
+    HANDLE          _hMapping;
+#else
+    int             _fd;
+#endif
+    void*           _pvView;
+    size_t          _cbView;
+
+    const WCHAR*    _pch;               // The mapped text, past any byte order mark.
+    LINE*           _rgLine;
+    DWORD           _cLines;
+};
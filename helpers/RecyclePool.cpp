@@ -0,0 +1,200 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "RecyclePool.h"
+
+#include <string.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+CRecyclePool::CRecyclePool(PFN_RECYCLE_RESET pfnReset, PFN_RECYCLE_DESTROY pfnDestroy):
+    _cRef(1),
+    _pfnReset(pfnReset),
+    _pfnDestroy(pfnDestroy),
+    _fClosed(false),
+    _cEntries(0)
+{
+#ifdef _WIN32
+    InitializeCriticalSection(&_cs);
+#else
+    pthread_mutex_init(&_mutex, NULL);
+#endif
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+CRecyclePool::~CRecyclePool()
+{
+#ifdef _WIN32
+    DeleteCriticalSection(&_cs);
+#else
+    pthread_mutex_destroy(&_mutex);
+#endif
+}
+
+HRESULT CRecyclePool::CreateInstance(PFN_RECYCLE_RESET pfnReset, PFN_RECYCLE_DESTROY pfnDestroy, CRecyclePool** ppPool)
+{
+    HRESULT hr = S_OK;
+    *ppPool = new CRecyclePool(pfnReset, pfnDestroy);
+    if (*ppPool == NULL)
+    {
+        hr = E_OUTOFMEMORY;
+    }
+    return hr;
+}
+
+LONG CRecyclePool::AddRef()
+{
+#ifdef _WIN32
+    return InterlockedIncrement(&_cRef);
+#else
+    return __sync_add_and_fetch(&_cRef, 1);
+#endif
+}
+
+LONG CRecyclePool::Release()
+{
+#ifdef _WIN32
+    LONG cRef = InterlockedDecrement(&_cRef);
+#else
+    LONG cRef = __sync_sub_and_fetch(&_cRef, 1);
+#endif
+    if (!cRef)
+    {
+        delete this;
+    }
+    return cRef;
+}
+
+void CRecyclePool::_Lock()
+{
+#ifdef _WIN32
+    EnterCriticalSection(&_cs);
+#else
+    pthread_mutex_lock(&_mutex);
+#endif
+}
+
+void CRecyclePool::_Unlock()
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&_cs);
+#else
+    pthread_mutex_unlock(&_mutex);
+#endif
+}
+
+ULONGLONG CRecyclePool::_GetTimeNs()
+{
+#ifdef _WIN32
+    LARGE_INTEGER liFrequency;
+    LARGE_INTEGER liCounter;
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liCounter);
+    const ULONGLONG ullFrequency = (ULONGLONG)liFrequency.QuadPart;
+    const ULONGLONG ullCounter = (ULONGLONG)liCounter.QuadPart;
+    return (ullCounter / ullFrequency) * 1000000000 + (ullCounter % ullFrequency) * 1000000000 / ullFrequency;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ULONGLONG)ts.tv_sec * 1000000000 + (ULONGLONG)ts.tv_nsec;
+#endif
+}
+
+// The most recently returned object goes out first, since it's the likeliest
+// to still be in the cache.
+void* CRecyclePool::Take()
+{
+    void* pv = NULL;
+
+    _Lock();
+    if (_cEntries > 0)
+    {
+        _cEntries--;
+        pv = _rgEntry[_cEntries].pv;
+        _stats.cHits++;
+        _stats.cAllocationsAvoided += 1 + _rgEntry[_cEntries].cKept;
+    }
+    else
+    {
+        _stats.cMisses++;
+    }
+    _Unlock();
+
+    return pv;
+}
+
+void CRecyclePool::Return(void* pv)
+{
+    _Lock();
+    bool fKeep = !_fClosed && (_cEntries < RECYCLE_POOL_MAX);
+    _Unlock();
+
+    // The reset can free memory and wait on the object's own work, so it
+    // runs outside the lock, and the pool may have filled or closed by the
+    // time it's done.
+    if (fKeep)
+    {
+        const ULONGLONG ullStart = _GetTimeNs();
+        const DWORD cKept = _pfnReset(pv);
+        const ULONGLONG ullResetNs = _GetTimeNs() - ullStart;
+
+        _Lock();
+        fKeep = !_fClosed && (_cEntries < RECYCLE_POOL_MAX);
+        if (fKeep)
+        {
+            _rgEntry[_cEntries].pv = pv;
+            _rgEntry[_cEntries].cKept = cKept;
+            _cEntries++;
+            _stats.cRecycled++;
+        }
+        _stats.ullResetNs += ullResetNs;
+        if (ullResetNs > _stats.ullMaxResetNs)
+        {
+            _stats.ullMaxResetNs = ullResetNs;
+        }
+        _Unlock();
+    }
+
+    // The object's reference on the pool may be the last one, so nothing
+    // here can touch the pool once it's destroyed.
+    if (!fKeep)
+    {
+        _Lock();
+        _stats.cDestroyed++;
+        _Unlock();
+        _pfnDestroy(pv);
+    }
+}
+
+void CRecyclePool::Close()
+{
+    ENTRY rgEntry[RECYCLE_POOL_MAX];
+
+    _Lock();
+    _fClosed = true;
+    const DWORD cEntries = _cEntries;
+    memcpy(rgEntry, _rgEntry, cEntries * sizeof(rgEntry[0]));
+    _cEntries = 0;
+    _stats.cDestroyed += cEntries;
+    _Unlock();
+
+    // The caller still holds its own reference, so the pool outlives these.
+    for (DWORD i = 0; i < cEntries; i++)
+    {
+        _pfnDestroy(rgEntry[i].pv);
+    }
+}
+
+void CRecyclePool::GetStats(RECYCLE_POOL_STATS* pStats)
+{
+    _Lock();
+    *pStats = _stats;
+    _Unlock();
+}
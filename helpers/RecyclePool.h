@@ -0,0 +1,112 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CRecyclePool keeps objects whose last reference has gone so they can be
+// handed out again instead of allocated.  A provider that recreates its
+// credentials every time SetUsageScenario is called owns one, and its
+// credentials go back to it from Release rather than deleting themselves.
+//
+// The pool doesn't know what it holds.  It calls the reset function it was
+// created with on each object it keeps, which wipes whatever the object
+// held for its last user but may keep storage that doesn't change, such as
+// its copies of the field descriptors, and says how many allocations it
+// kept.  It calls the destroy function on objects it won't keep: when it is
+// full, and once it has been closed.
+//
+// Each object holds a reference on the pool, so the pool outlives every
+// object that can come back to it, even after its provider is gone.  It has
+// no COM or LogonUI dependencies, so it can be exercised without LogonUI.
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+
+#else
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// Just enough of the Windows types for the pool.
+typedef int32_t HRESULT;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint64_t ULONGLONG;
+
+#define S_OK            ((HRESULT)0)
+#define E_OUTOFMEMORY   ((HRESULT)0x8007000E)
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+#endif
+
+// Most objects kept at once; any more are destroyed as they come back.
+#define RECYCLE_POOL_MAX        8
+
+// Wipes an object for reuse and returns how many of its allocations it kept.
+typedef DWORD (*PFN_RECYCLE_RESET)(void* pv);
+typedef void (*PFN_RECYCLE_DESTROY)(void* pv);
+
+struct RECYCLE_POOL_STATS
+{
+    DWORD       cHits;                  // Takes served from the pool.
+    DWORD       cMisses;                // Takes the caller had to allocate for.
+    DWORD       cRecycled;              // Objects reset and kept.
+    DWORD       cDestroyed;             // Objects destroyed instead.
+    ULONGLONG   cAllocationsAvoided;    // The objects themselves, plus what they kept.
+    ULONGLONG   ullResetNs;             // Time spent resetting.
+    ULONGLONG   ullMaxResetNs;
+};
+
+class CRecyclePool
+{
+  public:
+    static HRESULT CreateInstance(PFN_RECYCLE_RESET pfnReset, PFN_RECYCLE_DESTROY pfnDestroy, CRecyclePool** ppPool);
+
+    LONG AddRef();
+    LONG Release();
+
+    // An object from the pool, or NULL if the caller has to allocate one.
+    void* Take();
+
+    // Takes back an object with no references left.  It is reset and kept,
+    // or destroyed if the pool is full or closed.
+    void Return(void* pv);
+
+    // Destroys the objects held, and every object returned from now on.
+    void Close();
+
+    void GetStats(RECYCLE_POOL_STATS* pStats);
+
+  private:
+    CRecyclePool(PFN_RECYCLE_RESET pfnReset, PFN_RECYCLE_DESTROY pfnDestroy);
+    ~CRecyclePool();
+
+    void _Lock();
+    void _Unlock();
+    static ULONGLONG _GetTimeNs();
+
+  private:
+    struct ENTRY
+    {
+        void*   pv;
+        DWORD   cKept;                  // What the reset said it kept.
+    };
+
+    LONG                    _cRef;
+    PFN_RECYCLE_RESET       _pfnReset;
+    PFN_RECYCLE_DESTROY     _pfnDestroy;
+#ifdef _WIN32
+    CRITICAL_SECTION        _cs;
+#else
+    pthread_mutex_t         _mutex;
+#endif
+    bool                    _fClosed;
+    ENTRY                   _rgEntry[RECYCLE_POOL_MAX];
+    DWORD                   _cEntries;
+    RECYCLE_POOL_STATS      _stats;
+};
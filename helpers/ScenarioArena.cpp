@@ -0,0 +1,187 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "ScenarioArena.h"
+
+#include <string.h>
+
+// Every allocation starts on a multiple of this, which is enough for any of
+// the types a credential keeps.
+#define ARENA_ALIGN     8
+#define ARENA_ROUND(cb) (((cb) + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1))
+
+// Rounded up so the first allocation in a block is aligned too.
+#define ARENA_HEADER_CB ARENA_ROUND(sizeof(BLOCK))
+
+CScenarioArena::CScenarioArena():
+    _cRef(1),
+    _pBlock(NULL),
+    _ibNext(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+CScenarioArena::~CScenarioArena()
+{
+    while (_pBlock != NULL)
+    {
+        BLOCK* pNext = _pBlock->pNext;
+        delete [] (unsigned char*)_pBlock;
+        _pBlock = pNext;
+    }
+}
+
+HRESULT CScenarioArena::CreateInstance(CScenarioArena** ppArena)
+{
+    HRESULT hr = S_OK;
+    *ppArena = new CScenarioArena();
+    if (*ppArena == NULL)
+    {
+        hr = E_OUTOFMEMORY;
+    }
+    return hr;
+}
+
+// Only the provider calls this, so a count of one can't go up behind its back:
+// every other reference belongs to a credential, and credentials don't share
+// their references.
+HRESULT CScenarioArena::Renew(CScenarioArena** ppArena)
+{
+    HRESULT hr = S_OK;
+    if (*ppArena == NULL)
+    {
+        hr = CreateInstance(ppArena);
+    }
+    else if ((*ppArena)->_cRef == 1)
+    {
+        (*ppArena)->_Reset();
+    }
+    else
+    {
+        (*ppArena)->Release();
+        hr = CreateInstance(ppArena);
+    }
+    return hr;
+}
+
+LONG CScenarioArena::AddRef()
+{
+#ifdef _WIN32
+    return InterlockedIncrement(&_cRef);
+#else
+    return __sync_add_and_fetch(&_cRef, 1);
+#endif
+}
+
+LONG CScenarioArena::Release()
+{
+#ifdef _WIN32
+    LONG cRef = InterlockedDecrement(&_cRef);
+#else
+    LONG cRef = __sync_sub_and_fetch(&_cRef, 1);
+#endif
+    if (!cRef)
+    {
+        delete this;
+    }
+    return cRef;
+}
+
+// Keeps the oldest block, which is a standard one unless the first thing ever
+// allocated was large, and frees the rest; a scenario needs about as much as
+// the one before it, so most never need a second block.
+void CScenarioArena::_Reset()
+{
+    while ((_pBlock != NULL) && (_pBlock->pNext != NULL))
+    {
+        BLOCK* pNext = _pBlock->pNext;
+        _stats.cbReserved -= ARENA_HEADER_CB + _pBlock->cb;
+        delete [] (unsigned char*)_pBlock;
+        _pBlock = pNext;
+    }
+    _ibNext = 0;
+    _stats.cbRequested = 0;
+    _stats.cResets++;
+}
+
+// Links a new block with room for at least cb bytes in.  A large request's
+// block goes behind the current one, so what's left of the current one isn't
+// lost.
+void* CScenarioArena::_AllocBlock(size_t cb)
+{
+    const bool fLarge = (cb > SCENARIO_ARENA_BLOCK_CB / 4);
+    const size_t cbBlock = fLarge ? cb : SCENARIO_ARENA_BLOCK_CB;
+
+    void* pv = NULL;
+    BLOCK* pBlock = (BLOCK*)new unsigned char[ARENA_HEADER_CB + cbBlock];
+    if (pBlock != NULL)
+    {
+        pBlock->cb = cbBlock;
+        _stats.cBlocks++;
+        _stats.cbReserved += ARENA_HEADER_CB + cbBlock;
+
+        pv = (unsigned char*)pBlock + ARENA_HEADER_CB;
+        if (fLarge && (_pBlock != NULL))
+        {
+            pBlock->pNext = _pBlock->pNext;
+            _pBlock->pNext = pBlock;
+        }
+        else
+        {
+            pBlock->pNext = _pBlock;
+            _pBlock = pBlock;
+            _ibNext = cb;
+        }
+    }
+    return pv;
+}
+
+void* CScenarioArena::Alloc(size_t cb)
+{
+    const size_t cbRounded = ARENA_ROUND(cb ? cb : 1);
+
+    void* pv = NULL;
+    if ((_pBlock != NULL) && (_pBlock->cb - _ibNext >= cbRounded))
+    {
+        pv = (unsigned char*)_pBlock + ARENA_HEADER_CB + _ibNext;
+        _ibNext += cbRounded;
+    }
+    else
+    {
+        pv = _AllocBlock(cbRounded);
+    }
+
+    if (pv != NULL)
+    {
+        _stats.cAllocs++;
+        _stats.cbRequested += cb;
+    }
+    return pv;
+}
+
+HRESULT CScenarioArena::StrDup(const WCHAR* pwz, WCHAR** ppwz)
+{
+    size_t cch = 0;
+    while (pwz[cch] != 0)
+    {
+        cch++;
+    }
+
+    HRESULT hr = S_OK;
+    *ppwz = (WCHAR*)Alloc((cch + 1) * sizeof(WCHAR));
+    if (*ppwz != NULL)
+    {
+        memcpy(*ppwz, pwz, (cch + 1) * sizeof(WCHAR));
+    }
+    else
+    {
+        hr = E_OUTOFMEMORY;
+    }
+    return hr;
+}
@@ -0,0 +1,101 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CScenarioArena hands out memory for things that all die when a usage
+// scenario does: a credential's field strings and its copies of the field
+// descriptors.  Allocating is bumping an offset in the current block, and
+// nothing is freed on its own; the whole arena is freed, or reset to its
+// first block, at once.  A string that's replaced stays in the arena until
+// then, so it suits strings written once, not an edit field's value.
+//
+// The provider owns one per scenario and each credential created in it
+// holds a reference, so a credential LogonUI keeps past the end of its
+// scenario still has its strings.  Renew is called when a new scenario
+// starts: it resets the arena in place if the provider is the only holder,
+// and otherwise leaves it to the credentials and starts a new one.
+//
+// Nothing secret goes in an arena, since nothing in it is wiped before it's
+// reused, and neither does anything handed to LogonUI, which frees what it
+// gets with CoTaskMemFree.  It has no COM or LogonUI dependencies.
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+
+#else
+#include <stdint.h>
+#include <stddef.h>
+
+// Just enough of the Windows types for the arena.
+typedef int32_t HRESULT;
+typedef uint16_t WCHAR;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint64_t ULONGLONG;
+
+#define S_OK            ((HRESULT)0)
+#define E_OUTOFMEMORY   ((HRESULT)0x8007000E)
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+#endif
+
+// The size of a block.  A request of more than a quarter of it gets a block
+// of its own, so a large one doesn't waste the rest of the current block.
+#define SCENARIO_ARENA_BLOCK_CB     4096
+
+struct SCENARIO_ARENA_STATS
+{
+    DWORD       cAllocs;
+    DWORD       cBlocks;                // Blocks allocated from the heap.
+    DWORD       cResets;
+    ULONGLONG   cbRequested;            // Since the last reset.
+    ULONGLONG   cbReserved;             // Held in blocks right now.
+};
+
+class CScenarioArena
+{
+  public:
+    static HRESULT CreateInstance(CScenarioArena** ppArena);
+
+    // Readies *ppArena for a new scenario, in place or by replacing it.
+    static HRESULT Renew(CScenarioArena** ppArena);
+
+    LONG AddRef();
+    LONG Release();
+
+    // Aligned for any type.  NULL if the heap is out of memory.
+    void* Alloc(size_t cb);
+
+    // Copies a NUL-terminated string into the arena.
+    HRESULT StrDup(const WCHAR* pwz, WCHAR** ppwz);
+
+    void GetStats(SCENARIO_ARENA_STATS* pStats) const
+    {
+        *pStats = _stats;
+    }
+
+  private:
+    CScenarioArena();
+    ~CScenarioArena();
+
+    void _Reset();
+    void* _AllocBlock(size_t cb);
+
+  private:
+    struct BLOCK
+    {
+        BLOCK*  pNext;                  // The block filled before this one.
+        size_t  cb;                     // Usable bytes after the header.
+    };
+
+    LONG                    _cRef;
+    BLOCK*                  _pBlock;    // The block being filled.
+    size_t                  _ibNext;    // Offset of the next allocation in it.
+    SCENARIO_ARENA_STATS    _stats;
+};
@@ -0,0 +1,113 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "StatusCatalog.h"
+#include "StatusCatalogEntries.h"
+#include "StatusCatalogTable.h"
+
+#define STATUS_CATALOG_COUNT    (sizeof(s_rgStatusCatalog) / sizeof(s_rgStatusCatalog[0]))
+
+CStatusCatalog::CStatusCatalog():
+    _fOpen(false)
+{
+}
+
+HRESULT CStatusCatalog::Open(LINE_FILE_PATH pszPath)
+{
+    HRESULT hr = _file.Open(pszPath);
+    if (SUCCEEDED(hr))
+    {
+        _fOpen = true;
+    }
+    return hr;
+}
+
+// Finds the one entry a key can be at, if any.
+static DWORD _Find(LONG ntsStatus, LONG ntsSubstatus)
+{
+    const ULONGLONG ullHash = CStatusCatalog::Hash(ntsStatus, ntsSubstatus);
+    const DWORD dwSeed = s_rgwStatusCatalogSeed[CStatusCatalog::Bucket(ullHash)];
+    const DWORD iSlot = s_rgwStatusCatalogSlot[CStatusCatalog::Slot(ullHash, dwSeed)];
+
+    DWORD iEntry = STATUS_CATALOG_NONE;
+    if (iSlot != 0)
+    {
+        const STATUS_CATALOG_ENTRY& entry = s_rgStatusCatalog[iSlot - 1];
+        if ((entry.ntsStatus == ntsStatus) && (entry.ntsSubstatus == ntsSubstatus))
+        {
+            iEntry = iSlot - 1;
+        }
+    }
+    return iEntry;
+}
+
+DWORD CStatusCatalog::Lookup(LONG ntsStatus, LONG ntsSubstatus)
+{
+    DWORD iEntry = _Find(ntsStatus, ntsSubstatus);
+    if ((iEntry == STATUS_CATALOG_NONE) && (ntsSubstatus != 0))
+    {
+        iEntry = _Find(ntsStatus, 0);
+    }
+    return iEntry;
+}
+
+DWORD CStatusCatalog::GetCount()
+{
+    return STATUS_CATALOG_COUNT;
+}
+
+const STATUS_CATALOG_ENTRY& CStatusCatalog::GetEntry(DWORD iEntry)
+{
+    return s_rgStatusCatalog[iEntry];
+}
+
+const WCHAR* CStatusCatalog::GetText(DWORD iEntry, DWORD* pcch) const
+{
+    const WCHAR* pch = NULL;
+    *pcch = 0;
+    if (_fOpen && (iEntry < _file.GetCount()))
+    {
+        pch = _file.GetLine(iEntry, pcch);
+    }
+
+    if (*pcch == 0)
+    {
+        pch = s_rgStatusCatalog[iEntry].pwzMessage;
+        while (pch[*pcch] != 0)
+        {
+            (*pcch)++;
+        }
+    }
+    return pch;
+}
+
+bool CStatusCatalog::Verify()
+{
+    bool fValid = (sizeof(s_rgwStatusCatalogSeed) / sizeof(s_rgwStatusCatalogSeed[0]) == STATUS_CATALOG_BUCKETS) &&
+                  (sizeof(s_rgwStatusCatalogSlot) / sizeof(s_rgwStatusCatalogSlot[0]) == STATUS_CATALOG_SLOTS);
+
+    // Each entry has to be found where it is, which also means no two of
+    // them share a key.
+    for (DWORD i = 0; fValid && (i < STATUS_CATALOG_COUNT); i++)
+    {
+        fValid = (_Find(s_rgStatusCatalog[i].ntsStatus, s_rgStatusCatalog[i].ntsSubstatus) == i);
+    }
+
+    // And every slot in use has to belong to one of them.
+    DWORD cUsed = 0;
+    for (DWORD i = 0; fValid && (i < STATUS_CATALOG_SLOTS); i++)
+    {
+        if (s_rgwStatusCatalogSlot[i] != 0)
+        {
+            cUsed++;
+            fValid = (s_rgwStatusCatalogSlot[i] <= STATUS_CATALOG_COUNT);
+        }
+    }
+    return fValid && (cUsed == STATUS_CATALOG_COUNT);
+}
@@ -0,0 +1,108 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CStatusCatalog maps the NTSTATUS and substatus of a failed logon to the
+// message and icon ReportResult shows for it.  The entries are in
+// StatusCatalogEntries.h, and StatusCatalogTable.h holds a perfect hash of
+// their keys that StatusCatalogGen.cpp generates from them, so a lookup
+// hashes the key once, reads one slot and compares one entry, whatever the
+// size of the catalog.  A pair that isn't in the catalog falls back to the
+// status on its own.
+//
+// The English messages are built in.  A localized catalog is a UTF-16 text
+// file whose line i is the message for entry i; it is mapped with CLineFile
+// and read in place, and an empty or missing line keeps the English one.
+//
+// Like CLineFile it has no COM or LogonUI dependencies, so lookups can be
+// measured and the table checked without LogonUI.
+
+#pragma once
+
+#include "LineFile.h"
+
+#ifdef _WIN32
+#define STATUS_CATALOG_TEXT(s)  L##s
+#else
+#define STATUS_CATALOG_TEXT(s)  ((const WCHAR*)u##s)
+#endif
+
+// The icons, with the values of CREDENTIAL_PROVIDER_STATUS_ICON.
+#define STATUS_CATALOG_ICON_NONE        0
+#define STATUS_CATALOG_ICON_ERROR       1
+#define STATUS_CATALOG_ICON_WARNING     2
+#define STATUS_CATALOG_ICON_SUCCESS     3
+
+// What Lookup returns for a status that isn't in the catalog.
+#define STATUS_CATALOG_NONE             ((DWORD)-1)
+
+// The shape of the hash; StatusCatalogGen.cpp has to be rerun if these change.
+#define STATUS_CATALOG_BUCKETS          64
+#define STATUS_CATALOG_SLOTS            256
+
+struct STATUS_CATALOG_ENTRY
+{
+    LONG            ntsStatus;
+    LONG            ntsSubstatus;
+    DWORD           dwIcon;
+    const WCHAR*    pwzMessage;         // English.
+};
+
+class CStatusCatalog
+{
+  public:
+    CStatusCatalog();
+
+    // Maps a localized catalog.  Without one, the English messages are used.
+    HRESULT Open(LINE_FILE_PATH pszPath);
+
+    // The entry for the status and substatus, or else for the status with a
+    // substatus of STATUS_SUCCESS, or else STATUS_CATALOG_NONE.
+    static DWORD Lookup(LONG ntsStatus, LONG ntsSubstatus);
+
+    static DWORD GetCount();
+    static const STATUS_CATALOG_ENTRY& GetEntry(DWORD iEntry);
+
+    // The message for an entry, localized if the catalog file has it.  It
+    // may not be NUL-terminated.
+    const WCHAR* GetText(DWORD iEntry, DWORD* pcch) const;
+
+    // Checks that every entry's key is unique and that Lookup finds each
+    // one at its own index, so the table matches the entries.
+    static bool Verify();
+
+    // The hash is shared with StatusCatalogGen.cpp.  It mixes the status and
+    // substatus into one well-spread value; the bucket comes from its high
+    // half, and the slot from it and the bucket's seed.
+    static ULONGLONG Hash(LONG ntsStatus, LONG ntsSubstatus)
+    {
+        ULONGLONG ull = ((ULONGLONG)(DWORD)ntsStatus << 32) | (DWORD)ntsSubstatus;
+        ull ^= ull >> 33;
+        ull *= 0xFF51AFD7ED558CCDULL;
+        ull ^= ull >> 33;
+        ull *= 0xC4CEB9FE1A85EC53ULL;
+        ull ^= ull >> 33;
+        return ull;
+    }
+
+    static DWORD Bucket(ULONGLONG ullHash)
+    {
+        return (DWORD)(ullHash >> 32) & (STATUS_CATALOG_BUCKETS - 1);
+    }
+    static DWORD Slot(ULONGLONG ullHash, DWORD dwSeed)
+    {
+        ULONGLONG ull = ullHash + dwSeed * 0x9E3779B97F4A7C15ULL;
+        ull ^= ull >> 29;
+        ull *= 0xBF58476D1CE4E5B9ULL;
+        ull ^= ull >> 32;
+        return (DWORD)ull & (STATUS_CATALOG_SLOTS - 1);
+    }
+
+  private:
+    CLineFile   _file;
+    bool        _fOpen;
+};
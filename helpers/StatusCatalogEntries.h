@@ -0,0 +1,155 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The entries of the status catalog.  The codes are written out rather than
+// taken from ntstatus.h so the catalog also builds elsewhere.  A localized
+// catalog file is indexed by position, so add new entries at the end, and
+// rerun StatusCatalogGen.cpp afterwards to rebuild StatusCatalogTable.h.
+//
+// The substatuses under STATUS_LOGON_FAILURE and STATUS_ACCOUNT_RESTRICTION
+// are also listed on their own, since some packages report them that way.
+
+#pragma once
+
+static const STATUS_CATALOG_ENTRY s_rgStatusCatalog[] =
+{
+    { (LONG)0xC000006D, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("Incorrect password or username.") },  // STATUS_LOGON_FAILURE, STATUS_SUCCESS
+    { (LONG)0xC000006D, (LONG)0xC0000064, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("Incorrect password or username.") },  // STATUS_LOGON_FAILURE, STATUS_NO_SUCH_USER
+    { (LONG)0xC000006D, (LONG)0xC000006A, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("Incorrect password or username.") },  // STATUS_LOGON_FAILURE, STATUS_WRONG_PASSWORD
+    { (LONG)0xC000006D, (LONG)0xC000006F, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your account has time restrictions that keep you from signing in right now.") },  // STATUS_LOGON_FAILURE, STATUS_INVALID_LOGON_HOURS
+    { (LONG)0xC000006D, (LONG)0xC0000070, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your account isn't allowed to sign in from this computer.") },  // STATUS_LOGON_FAILURE, STATUS_INVALID_WORKSTATION
+    { (LONG)0xC000006D, (LONG)0xC0000071, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your password has expired and must be changed.") },  // STATUS_LOGON_FAILURE, STATUS_PASSWORD_EXPIRED
+    { (LONG)0xC000006D, (LONG)0xC0000072, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("The account is disabled.") },  // STATUS_LOGON_FAILURE, STATUS_ACCOUNT_DISABLED
+    { (LONG)0xC000006D, (LONG)0xC0000193, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your account has expired. Contact your administrator.") },  // STATUS_LOGON_FAILURE, STATUS_ACCOUNT_EXPIRED
+    { (LONG)0xC000006D, (LONG)0xC0000224, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("You must change your password before signing in for the first time.") },  // STATUS_LOGON_FAILURE, STATUS_PASSWORD_MUST_CHANGE
+    { (LONG)0xC000006D, (LONG)0xC0000234, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The account is locked out. Try again later or contact your administrator.") },  // STATUS_LOGON_FAILURE, STATUS_ACCOUNT_LOCKED_OUT
+    { (LONG)0xC000006D, (LONG)0xC000015B, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("The sign-in method you're trying to use isn't allowed for this account.") },  // STATUS_LOGON_FAILURE, STATUS_LOGON_TYPE_NOT_GRANTED
+    { (LONG)0xC000006D, (LONG)0xC0000155, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("You haven't been granted the right to sign in to this computer.") },  // STATUS_LOGON_FAILURE, STATUS_LOGON_NOT_GRANTED
+    { (LONG)0xC000006D, (LONG)0xC000006C, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("The password doesn't meet the password policy requirements.") },  // STATUS_LOGON_FAILURE, STATUS_PASSWORD_RESTRICTION
+    { (LONG)0xC000006D, (LONG)0xC000030C, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your password must be changed before you can sign in.") },  // STATUS_LOGON_FAILURE, STATUS_PASSWORD_CHANGE_REQUIRED
+    { (LONG)0xC000006D, (LONG)0xC0000133, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This computer's clock is out of sync with the domain controller's.") },  // STATUS_LOGON_FAILURE, STATUS_TIME_DIFFERENCE_AT_DC
+    { (LONG)0xC000006D, (LONG)0xC0000413, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This computer is protected by an authentication firewall that doesn't allow this account.") },  // STATUS_LOGON_FAILURE, STATUS_AUTHENTICATION_FIREWALL_FAILED
+    { (LONG)0xC000006D, (LONG)0xC00000DF, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The domain isn't available.") },  // STATUS_LOGON_FAILURE, STATUS_NO_SUCH_DOMAIN
+    { (LONG)0xC000006D, (LONG)0xC000005E, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("There are no logon servers available to service the sign-in request.") },  // STATUS_LOGON_FAILURE, STATUS_NO_LOGON_SERVERS
+    { (LONG)0xC000006D, (LONG)0xC0000233, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("A domain controller for the domain couldn't be found.") },  // STATUS_LOGON_FAILURE, STATUS_DOMAIN_CONTROLLER_NOT_FOUND
+    { (LONG)0xC000006D, (LONG)0xC0000062, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The user name isn't valid.") },  // STATUS_LOGON_FAILURE, STATUS_INVALID_ACCOUNT_NAME
+    { (LONG)0xC000006D, (LONG)0xC0000073, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The user name couldn't be found.") },  // STATUS_LOGON_FAILURE, STATUS_NONE_MAPPED
+    { (LONG)0xC000006D, (LONG)0xC000018B, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This computer doesn't have an account in the domain.") },  // STATUS_LOGON_FAILURE, STATUS_NO_TRUST_SAM_ACCOUNT
+    { (LONG)0xC000006D, (LONG)0xC000018C, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The trust relationship between the primary domain and the trusted domain failed.") },  // STATUS_LOGON_FAILURE, STATUS_TRUSTED_DOMAIN_FAILURE
+    { (LONG)0xC000006D, (LONG)0xC000018D, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The trust relationship between this computer and the primary domain failed.") },  // STATUS_LOGON_FAILURE, STATUS_TRUSTED_RELATIONSHIP_FAILURE
+    { (LONG)0xC000006D, (LONG)0xC0000198, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This is an interdomain trust account. Use your user account to sign in.") },  // STATUS_LOGON_FAILURE, STATUS_NOLOGON_INTERDOMAIN_TRUST_ACCOUNT
+    { (LONG)0xC000006D, (LONG)0xC0000199, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This is a computer trust account. Use your user account to sign in.") },  // STATUS_LOGON_FAILURE, STATUS_NOLOGON_WORKSTATION_TRUST_ACCOUNT
+    { (LONG)0xC000006D, (LONG)0xC000019A, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This is a server trust account. Use your user account to sign in.") },  // STATUS_LOGON_FAILURE, STATUS_NOLOGON_SERVER_TRUST_ACCOUNT
+    { (LONG)0xC000006D, (LONG)0xC0000192, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The Netlogon service isn't running, so domain accounts can't sign in.") },  // STATUS_LOGON_FAILURE, STATUS_NETLOGON_NOT_STARTED
+    { (LONG)0xC000006E, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Account restrictions are keeping you from signing in.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_SUCCESS
+    { (LONG)0xC000006E, (LONG)0xC0000064, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("Incorrect password or username.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_NO_SUCH_USER
+    { (LONG)0xC000006E, (LONG)0xC000006A, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("Incorrect password or username.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_WRONG_PASSWORD
+    { (LONG)0xC000006E, (LONG)0xC000006F, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your account has time restrictions that keep you from signing in right now.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_INVALID_LOGON_HOURS
+    { (LONG)0xC000006E, (LONG)0xC0000070, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your account isn't allowed to sign in from this computer.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_INVALID_WORKSTATION
+    { (LONG)0xC000006E, (LONG)0xC0000071, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your password has expired and must be changed.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_PASSWORD_EXPIRED
+    { (LONG)0xC000006E, (LONG)0xC0000072, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("The account is disabled.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_ACCOUNT_DISABLED
+    { (LONG)0xC000006E, (LONG)0xC0000193, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your account has expired. Contact your administrator.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_ACCOUNT_EXPIRED
+    { (LONG)0xC000006E, (LONG)0xC0000224, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("You must change your password before signing in for the first time.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_PASSWORD_MUST_CHANGE
+    { (LONG)0xC000006E, (LONG)0xC0000234, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The account is locked out. Try again later or contact your administrator.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_ACCOUNT_LOCKED_OUT
+    { (LONG)0xC000006E, (LONG)0xC000015B, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("The sign-in method you're trying to use isn't allowed for this account.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_LOGON_TYPE_NOT_GRANTED
+    { (LONG)0xC000006E, (LONG)0xC0000155, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("You haven't been granted the right to sign in to this computer.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_LOGON_NOT_GRANTED
+    { (LONG)0xC000006E, (LONG)0xC000006C, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("The password doesn't meet the password policy requirements.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_PASSWORD_RESTRICTION
+    { (LONG)0xC000006E, (LONG)0xC000030C, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your password must be changed before you can sign in.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_PASSWORD_CHANGE_REQUIRED
+    { (LONG)0xC000006E, (LONG)0xC0000133, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This computer's clock is out of sync with the domain controller's.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_TIME_DIFFERENCE_AT_DC
+    { (LONG)0xC000006E, (LONG)0xC0000413, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This computer is protected by an authentication firewall that doesn't allow this account.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_AUTHENTICATION_FIREWALL_FAILED
+    { (LONG)0xC000006E, (LONG)0xC00000DF, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The domain isn't available.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_NO_SUCH_DOMAIN
+    { (LONG)0xC000006E, (LONG)0xC000005E, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("There are no logon servers available to service the sign-in request.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_NO_LOGON_SERVERS
+    { (LONG)0xC000006E, (LONG)0xC0000233, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("A domain controller for the domain couldn't be found.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_DOMAIN_CONTROLLER_NOT_FOUND
+    { (LONG)0xC000006E, (LONG)0xC0000062, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The user name isn't valid.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_INVALID_ACCOUNT_NAME
+    { (LONG)0xC000006E, (LONG)0xC0000073, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The user name couldn't be found.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_NONE_MAPPED
+    { (LONG)0xC000006E, (LONG)0xC000018B, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This computer doesn't have an account in the domain.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_NO_TRUST_SAM_ACCOUNT
+    { (LONG)0xC000006E, (LONG)0xC000018C, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The trust relationship between the primary domain and the trusted domain failed.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_TRUSTED_DOMAIN_FAILURE
+    { (LONG)0xC000006E, (LONG)0xC000018D, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The trust relationship between this computer and the primary domain failed.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_TRUSTED_RELATIONSHIP_FAILURE
+    { (LONG)0xC000006E, (LONG)0xC0000198, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This is an interdomain trust account. Use your user account to sign in.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_NOLOGON_INTERDOMAIN_TRUST_ACCOUNT
+    { (LONG)0xC000006E, (LONG)0xC0000199, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This is a computer trust account. Use your user account to sign in.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_NOLOGON_WORKSTATION_TRUST_ACCOUNT
+    { (LONG)0xC000006E, (LONG)0xC000019A, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This is a server trust account. Use your user account to sign in.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_NOLOGON_SERVER_TRUST_ACCOUNT
+    { (LONG)0xC000006E, (LONG)0xC0000192, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The Netlogon service isn't running, so domain accounts can't sign in.") },  // STATUS_ACCOUNT_RESTRICTION, STATUS_NETLOGON_NOT_STARTED
+    { (LONG)0xC0000064, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("Incorrect password or username.") },  // STATUS_NO_SUCH_USER, STATUS_SUCCESS
+    { (LONG)0xC000006A, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("Incorrect password or username.") },  // STATUS_WRONG_PASSWORD, STATUS_SUCCESS
+    { (LONG)0xC000006F, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your account has time restrictions that keep you from signing in right now.") },  // STATUS_INVALID_LOGON_HOURS, STATUS_SUCCESS
+    { (LONG)0xC0000070, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your account isn't allowed to sign in from this computer.") },  // STATUS_INVALID_WORKSTATION, STATUS_SUCCESS
+    { (LONG)0xC0000071, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your password has expired and must be changed.") },  // STATUS_PASSWORD_EXPIRED, STATUS_SUCCESS
+    { (LONG)0xC0000072, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("The account is disabled.") },  // STATUS_ACCOUNT_DISABLED, STATUS_SUCCESS
+    { (LONG)0xC0000193, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your account has expired. Contact your administrator.") },  // STATUS_ACCOUNT_EXPIRED, STATUS_SUCCESS
+    { (LONG)0xC0000224, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("You must change your password before signing in for the first time.") },  // STATUS_PASSWORD_MUST_CHANGE, STATUS_SUCCESS
+    { (LONG)0xC0000234, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The account is locked out. Try again later or contact your administrator.") },  // STATUS_ACCOUNT_LOCKED_OUT, STATUS_SUCCESS
+    { (LONG)0xC000015B, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("The sign-in method you're trying to use isn't allowed for this account.") },  // STATUS_LOGON_TYPE_NOT_GRANTED, STATUS_SUCCESS
+    { (LONG)0xC0000155, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("You haven't been granted the right to sign in to this computer.") },  // STATUS_LOGON_NOT_GRANTED, STATUS_SUCCESS
+    { (LONG)0xC000006C, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("The password doesn't meet the password policy requirements.") },  // STATUS_PASSWORD_RESTRICTION, STATUS_SUCCESS
+    { (LONG)0xC000030C, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Your password must be changed before you can sign in.") },  // STATUS_PASSWORD_CHANGE_REQUIRED, STATUS_SUCCESS
+    { (LONG)0xC0000133, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This computer's clock is out of sync with the domain controller's.") },  // STATUS_TIME_DIFFERENCE_AT_DC, STATUS_SUCCESS
+    { (LONG)0xC0000413, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This computer is protected by an authentication firewall that doesn't allow this account.") },  // STATUS_AUTHENTICATION_FIREWALL_FAILED, STATUS_SUCCESS
+    { (LONG)0xC00000DF, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The domain isn't available.") },  // STATUS_NO_SUCH_DOMAIN, STATUS_SUCCESS
+    { (LONG)0xC000005E, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("There are no logon servers available to service the sign-in request.") },  // STATUS_NO_LOGON_SERVERS, STATUS_SUCCESS
+    { (LONG)0xC0000233, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("A domain controller for the domain couldn't be found.") },  // STATUS_DOMAIN_CONTROLLER_NOT_FOUND, STATUS_SUCCESS
+    { (LONG)0xC0000062, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The user name isn't valid.") },  // STATUS_INVALID_ACCOUNT_NAME, STATUS_SUCCESS
+    { (LONG)0xC0000073, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The user name couldn't be found.") },  // STATUS_NONE_MAPPED, STATUS_SUCCESS
+    { (LONG)0xC000018B, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This computer doesn't have an account in the domain.") },  // STATUS_NO_TRUST_SAM_ACCOUNT, STATUS_SUCCESS
+    { (LONG)0xC000018C, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The trust relationship between the primary domain and the trusted domain failed.") },  // STATUS_TRUSTED_DOMAIN_FAILURE, STATUS_SUCCESS
+    { (LONG)0xC000018D, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The trust relationship between this computer and the primary domain failed.") },  // STATUS_TRUSTED_RELATIONSHIP_FAILURE, STATUS_SUCCESS
+    { (LONG)0xC0000198, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This is an interdomain trust account. Use your user account to sign in.") },  // STATUS_NOLOGON_INTERDOMAIN_TRUST_ACCOUNT, STATUS_SUCCESS
+    { (LONG)0xC0000199, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This is a computer trust account. Use your user account to sign in.") },  // STATUS_NOLOGON_WORKSTATION_TRUST_ACCOUNT, STATUS_SUCCESS
+    { (LONG)0xC000019A, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This is a server trust account. Use your user account to sign in.") },  // STATUS_NOLOGON_SERVER_TRUST_ACCOUNT, STATUS_SUCCESS
+    { (LONG)0xC0000192, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The Netlogon service isn't running, so domain accounts can't sign in.") },  // STATUS_NETLOGON_NOT_STARTED, STATUS_SUCCESS
+    { (LONG)0xC0000380, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The PIN is incorrect.") },  // STATUS_SMARTCARD_WRONG_PIN, STATUS_SUCCESS
+    { (LONG)0xC0000381, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card is blocked. Contact your administrator.") },  // STATUS_SMARTCARD_CARD_BLOCKED, STATUS_SUCCESS
+    { (LONG)0xC0000382, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card wasn't authenticated. Enter your PIN.") },  // STATUS_SMARTCARD_CARD_NOT_AUTHENTICATED, STATUS_SUCCESS
+    { (LONG)0xC0000383, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("No smart card was found. Insert your smart card.") },  // STATUS_SMARTCARD_NO_CARD, STATUS_SUCCESS
+    { (LONG)0xC0000384, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card has no key container.") },  // STATUS_SMARTCARD_NO_KEY_CONTAINER, STATUS_SUCCESS
+    { (LONG)0xC0000385, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card has no certificate that can be used to sign in.") },  // STATUS_SMARTCARD_NO_CERTIFICATE, STATUS_SUCCESS
+    { (LONG)0xC0000386, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card has no keyset.") },  // STATUS_SMARTCARD_NO_KEYSET, STATUS_SUCCESS
+    { (LONG)0xC0000387, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card couldn't be read. Reinsert it and try again.") },  // STATUS_SMARTCARD_IO_ERROR, STATUS_SUCCESS
+    { (LONG)0xC0000388, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("A security downgrade was detected while signing in.") },  // STATUS_DOWNGRADE_DETECTED, STATUS_SUCCESS
+    { (LONG)0xC0000389, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card certificate has been revoked.") },  // STATUS_SMARTCARD_CERT_REVOKED, STATUS_SUCCESS
+    { (LONG)0xC000038A, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card certificate was issued by an authority that isn't trusted.") },  // STATUS_ISSUING_CA_UNTRUSTED, STATUS_SUCCESS
+    { (LONG)0xC000038B, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The revocation status of the smart card certificate couldn't be checked.") },  // STATUS_REVOCATION_OFFLINE_C, STATUS_SUCCESS
+    { (LONG)0xC000038C, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card certificate isn't trusted by the domain controller.") },  // STATUS_PKINIT_CLIENT_FAILURE, STATUS_SUCCESS
+    { (LONG)0xC000038D, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card certificate has expired.") },  // STATUS_SMARTCARD_CERT_EXPIRED, STATUS_SUCCESS
+    { (LONG)0xC0000320, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("Smart card sign-in failed.") },  // STATUS_PKINIT_FAILURE, STATUS_SUCCESS
+    { (LONG)0xC0000321, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card subsystem isn't working.") },  // STATUS_SMARTCARD_SUBSYSTEM_FAILURE, STATUS_SUCCESS
+    { (LONG)0xC0000322, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The account has no key to sign in with.") },  // STATUS_NO_KERB_KEY, STATUS_SUCCESS
+    { (LONG)0xC00002F9, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The smart card certificate doesn't match the user name.") },  // STATUS_PKINIT_NAME_MISMATCH, STATUS_SUCCESS
+    { (LONG)0xC00002FA, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("This account must sign in with a smart card.") },  // STATUS_SMARTCARD_LOGON_REQUIRED, STATUS_SUCCESS
+    { (LONG)0xC000006B, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The password isn't in a valid form.") },  // STATUS_ILL_FORMED_PASSWORD, STATUS_SUCCESS
+    { (LONG)0xC000005F, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The sign-in session no longer exists.") },  // STATUS_NO_SUCH_LOGON_SESSION, STATUS_SUCCESS
+    { (LONG)0xC0000061, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The account doesn't have the privilege this requires.") },  // STATUS_PRIVILEGE_NOT_HELD, STATUS_SUCCESS
+    { (LONG)0xC00000FE, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The authentication package isn't available.") },  // STATUS_NO_SUCH_PACKAGE, STATUS_SUCCESS
+    { (LONG)0xC00000A7, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The sign-in request isn't valid for this authentication package.") },  // STATUS_BAD_VALIDATION_CLASS, STATUS_SUCCESS
+    { (LONG)0xC0000132, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The logon server had a conflict. Try again.") },  // STATUS_LOGON_SERVER_CONFLICT, STATUS_SUCCESS
+    { (LONG)0xC00000DC, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The security server is in a state that doesn't allow sign-in.") },  // STATUS_INVALID_SERVER_STATE, STATUS_SUCCESS
+    { (LONG)0xC00000DD, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The domain is in a state that doesn't allow sign-in.") },  // STATUS_INVALID_DOMAIN_STATE, STATUS_SUCCESS
+    { (LONG)0xC00000DE, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The domain's role doesn't allow this sign-in.") },  // STATUS_INVALID_DOMAIN_ROLE, STATUS_SUCCESS
+    { (LONG)0xC0000190, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The domain trust failed.") },  // STATUS_TRUST_FAILURE, STATUS_SUCCESS
+    { (LONG)0xC000019B, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The domain trust information is inconsistent.") },  // STATUS_DOMAIN_TRUST_INCONSISTENT, STATUS_SUCCESS
+    { (LONG)0xC000018A, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This computer's domain trust secret is missing.") },  // STATUS_NO_TRUST_LSA_SECRET, STATUS_SUCCESS
+    { (LONG)0xC0000158, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The security database has an internal error.") },  // STATUS_INTERNAL_DB_ERROR, STATUS_SUCCESS
+    { (LONG)0xC00000CC, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The network name couldn't be found.") },  // STATUS_BAD_NETWORK_NAME, STATUS_SUCCESS
+    { (LONG)0xC000020C, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The network connection was lost.") },  // STATUS_CONNECTION_DISCONNECTED, STATUS_SUCCESS
+    { (LONG)0xC000023C, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The network can't be reached.") },  // STATUS_NETWORK_UNREACHABLE, STATUS_SUCCESS
+    { (LONG)0xC000023D, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The server can't be reached.") },  // STATUS_HOST_UNREACHABLE, STATUS_SUCCESS
+    { (LONG)0xC0000241, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The network connection was aborted.") },  // STATUS_CONNECTION_ABORTED, STATUS_SUCCESS
+    { (LONG)0xC0000236, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The server refused the connection.") },  // STATUS_CONNECTION_REFUSED, STATUS_SUCCESS
+    { (LONG)0xC00000B5, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The request timed out.") },  // STATUS_IO_TIMEOUT, STATUS_SUCCESS
+    { (LONG)0xC0000203, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The remote session was closed.") },  // STATUS_USER_SESSION_DELETED, STATUS_SUCCESS
+    { (LONG)0xC000035C, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The network session has expired. Sign in again.") },  // STATUS_NETWORK_SESSION_EXPIRED, STATUS_SUCCESS
+    { (LONG)0xC0000350, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The server is down.") },  // STATUS_HOST_DOWN, STATUS_SUCCESS
+    { (LONG)0xC0000106, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The name is too long.") },  // STATUS_NAME_TOO_LONG, STATUS_SUCCESS
+    { (LONG)0xC0000120, (LONG)0x00000000, STATUS_CATALOG_ICON_WARNING, STATUS_CATALOG_TEXT("Signing in was canceled.") },  // STATUS_CANCELLED, STATUS_SUCCESS
+    { (LONG)0xC0000017, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("There isn't enough memory to sign in.") },  // STATUS_NO_MEMORY, STATUS_SUCCESS
+    { (LONG)0xC000009A, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("There aren't enough system resources to sign in.") },  // STATUS_INSUFFICIENT_RESOURCES, STATUS_SUCCESS
+    { (LONG)0xC0000022, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("Access is denied.") },  // STATUS_ACCESS_DENIED, STATUS_SUCCESS
+    { (LONG)0xC00000BB, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("This sign-in request isn't supported.") },  // STATUS_NOT_SUPPORTED, STATUS_SUCCESS
+    { (LONG)0xC000000D, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("The sign-in request was malformed.") },  // STATUS_INVALID_PARAMETER, STATUS_SUCCESS
+    { (LONG)0xC00000E5, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("An internal error occurred while signing in.") },  // STATUS_INTERNAL_ERROR, STATUS_SUCCESS
+    { (LONG)0xC0000001, (LONG)0x00000000, STATUS_CATALOG_ICON_ERROR,   STATUS_CATALOG_TEXT("Signing in didn't succeed.") },  // STATUS_UNSUCCESSFUL, STATUS_SUCCESS
+};
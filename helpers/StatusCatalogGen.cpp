@@ -0,0 +1,128 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Writes StatusCatalogTable.h, the perfect hash of the keys in
+// StatusCatalogEntries.h, to stdout.  It isn't part of the Helpers project;
+// build and run it by hand after changing the entries:
+//
+//     cl /EHsc StatusCatalogGen.cpp
+//     StatusCatalogGen > StatusCatalogTable.h
+//
+// The keys are split into STATUS_CATALOG_BUCKETS buckets, and the buckets
+// are placed largest first, each with the first seed that puts all of its
+// keys in slots that are still free.
+
+#include "StatusCatalog.h"
+#include "StatusCatalogEntries.h"
+
+#include <stdio.h>
+
+#define STATUS_CATALOG_COUNT    (sizeof(s_rgStatusCatalog) / sizeof(s_rgStatusCatalog[0]))
+#define SEED_MAX                0xFFFF
+
+static USHORT s_rgwSeed[STATUS_CATALOG_BUCKETS];
+static USHORT s_rgwSlot[STATUS_CATALOG_SLOTS];
+
+// Tries to place the keys of one bucket with a seed, and leaves the slots as
+// they were if it can't.
+static bool _Place(const DWORD* rgiEntry, DWORD cEntries, DWORD dwSeed)
+{
+    DWORD rgiSlot[STATUS_CATALOG_SLOTS];
+    bool fPlaced = true;
+    DWORD cPlaced = 0;
+    for (; cPlaced < cEntries; cPlaced++)
+    {
+        const STATUS_CATALOG_ENTRY& entry = s_rgStatusCatalog[rgiEntry[cPlaced]];
+        const DWORD iSlot = CStatusCatalog::Slot(CStatusCatalog::Hash(entry.ntsStatus, entry.ntsSubstatus), dwSeed);
+        if (s_rgwSlot[iSlot] != 0)
+        {
+            fPlaced = false;
+            break;
+        }
+        s_rgwSlot[iSlot] = (USHORT)(rgiEntry[cPlaced] + 1);
+        rgiSlot[cPlaced] = iSlot;
+    }
+
+    if (!fPlaced)
+    {
+        for (DWORD i = 0; i < cPlaced; i++)
+        {
+            s_rgwSlot[rgiSlot[i]] = 0;
+        }
+    }
+    return fPlaced;
+}
+
+int main()
+{
+    int iResult = 0;
+
+    static DWORD s_rgiBucket[STATUS_CATALOG_BUCKETS][STATUS_CATALOG_SLOTS];
+    static DWORD s_rgcBucket[STATUS_CATALOG_BUCKETS];
+
+    if (STATUS_CATALOG_COUNT >= STATUS_CATALOG_SLOTS)
+    {
+        fprintf(stderr, "%u entries don't fit in %u slots.\n", (unsigned)STATUS_CATALOG_COUNT, STATUS_CATALOG_SLOTS);
+        iResult = 1;
+    }
+
+    for (DWORD i = 0; (iResult == 0) && (i < STATUS_CATALOG_COUNT); i++)
+    {
+        const DWORD iBucket = CStatusCatalog::Bucket(CStatusCatalog::Hash(s_rgStatusCatalog[i].ntsStatus, s_rgStatusCatalog[i].ntsSubstatus));
+        s_rgiBucket[iBucket][s_rgcBucket[iBucket]++] = i;
+    }
+
+    // Place the largest buckets first, while most slots are free.
+    for (DWORD cEntries = STATUS_CATALOG_SLOTS; (iResult == 0) && (cEntries > 0); cEntries--)
+    {
+        for (DWORD iBucket = 0; (iResult == 0) && (iBucket < STATUS_CATALOG_BUCKETS); iBucket++)
+        {
+            if (s_rgcBucket[iBucket] == cEntries)
+            {
+                DWORD dwSeed = 0;
+                while ((dwSeed <= SEED_MAX) && !_Place(s_rgiBucket[iBucket], cEntries, dwSeed))
+                {
+                    dwSeed++;
+                }
+                if (dwSeed > SEED_MAX)
+                {
+                    fprintf(stderr, "No seed places bucket %u; two entries may share a key.\n", iBucket);
+                    iResult = 1;
+                }
+                else
+                {
+                    s_rgwSeed[iBucket] = (USHORT)dwSeed;
+                }
+            }
+        }
+    }
+
+    if (iResult == 0)
+    {
+        printf("//\n");
+        printf("// Generated by StatusCatalogGen.cpp from StatusCatalogEntries.h; don't edit.\n");
+        printf("//\n\n");
+        printf("#pragma once\n\n");
+        printf("// The seed of each bucket.\n");
+        printf("static const USHORT s_rgwStatusCatalogSeed[STATUS_CATALOG_BUCKETS] =\n{");
+        for (DWORD i = 0; i < STATUS_CATALOG_BUCKETS; i++)
+        {
+            printf("%s%5u,", (i % 8) ? " " : "\n    ", s_rgwSeed[i]);
+        }
+        printf("\n};\n\n");
+        printf("// The entry in each slot, plus one; zero is an empty slot.\n");
+        printf("static const USHORT s_rgwStatusCatalogSlot[STATUS_CATALOG_SLOTS] =\n{");
+        for (DWORD i = 0; i < STATUS_CATALOG_SLOTS; i++)
+        {
+            printf("%s%3u,", (i % 16) ? " " : "\n    ", s_rgwSlot[i]);
+        }
+        printf("\n};\n");
+    }
+
+    return iResult;
+}
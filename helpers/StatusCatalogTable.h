@@ -0,0 +1,39 @@
+//
+// Generated by StatusCatalogGen.cpp from StatusCatalogEntries.h; don't edit.
+//
+
+#pragma once
+
+// The seed of each bucket.
+static const USHORT s_rgwStatusCatalogSeed[STATUS_CATALOG_BUCKETS] =
+{
+        1,     3,     1,     1,     0,     0,     0,     0,
+        1,     1,     0,     0,     0,     0,     0,     1,
+        0,     0,     7,     1,     3,     0,     0,     1,
+        0,     0,     0,     1,     1,     0,     0,     2,
+        0,     0,     0,     0,     0,     0,     0,     2,
+        3,     1,     0,     0,     0,     0,     1,     0,
+        1,     2,     3,     4,     1,     2,     0,     0,
+        1,     0,     2,     0,     0,     5,     0,     7,
+};
+
+// The entry in each slot, plus one; zero is an empty slot.
+static const USHORT s_rgwStatusCatalogSlot[STATUS_CATALOG_SLOTS] =
+{
+    121,  56,   0,   0,  64,   0,   0,  95, 127,   0,  76,   0, 123,  79,  10,   0,
+      0,   0,   0,  69,   0, 129,   0,   0,  65,   0,   0,  63, 130,  81,   9,   0,
+      0,  67,   2,  27,  53,  85,   0,   0,  11, 100,   0,  28,  66, 132,   0, 113,
+     62,   0,   0,   0,   0,  29,  50,  74,   0,   0,  98,   0,   0,   0,  78,  57,
+      0,   0,   0,  26,   0,   0,   0,  44,  40,  73,   0,   0,   0,  93,   0,   0,
+      0,  48,   0,  97,   0, 112,  33,   0, 116, 131,   0,  34,   0, 102,   0,   6,
+      0,   0,  13,   0,   0,  55,  25,  70,  32,  54,  59,   3,  77,   0, 107,  68,
+      0,  80,   0,   0,  45,   0, 117, 133,   0, 134,   0,   0,   8,  19,   0, 103,
+    115,  99,  22,  46,   0,   7, 128,   0,   0,  31,  51,  39,   0,   0,   0, 114,
+      0,   0,   0,  86,  49,  42, 109,   0,   0,  89,   0,  87,   0,   0,   0,   0,
+     58, 110,  36,  12,  88, 122,  92,   1,   4,  23,   0,  61,   0,  82, 120, 124,
+      0,   0,  35,   0,   0,  47, 118,  37,  30,   0,  14,   0,   0,  83,   0,   0,
+    106,   0,  84,   5,   0,   0, 111,   0,  90,   0,   0,   0,  18, 125,  38, 104,
+     91,   0,   0,  43,   0, 108,  15,  17,  20,   0, 119,   0,  72,   0,  16,   0,
+    126,   0,   0,   0, 101,   0,   0,   0,   0,   0,  71,   0, 105,  52,   0,   0,
+      0,   0,   0,   0,  41,   0,  75,  21,  60,  24,  96,   0,   0,   0,  94,   0,
+};
@@ -11,6 +11,7 @@
 
 
 #include "helpers.h"
+#include "StatusCatalog.h"
 #include <intsafe.h>
 #include <wincred.h>
 
@@ -643,3 +644,174 @@ HRESULT DomainUsernameStringAlloc(
 
     return hr;
 }
+
+// HRESULT_FROM_NT maps STATUS_SUCCESS to a success code other than S_OK, which
+// callers comparing against S_OK would misread.  Fold every success to S_OK first.
+HRESULT HResultFromNtStatus(
+    __in NTSTATUS ntsStatus
+    )
+{
+    return (ntsStatus >= 0) ? S_OK : HRESULT_FROM_NT(ntsStatus);
+}
+
+//
+// Copies cch characters at pch into a new NUL-terminated string from CoTaskMemAlloc.
+//
+static HRESULT _CountedStringAlloc(
+    __in_ecount(cch) const WCHAR* pch,
+    __in DWORD cch,
+    __deref_out PWSTR* ppwz
+    )
+{
+    HRESULT hr;
+    size_t cb;
+
+    *ppwz = NULL;
+    hr = SizeTMult((size_t)cch + 1, sizeof(WCHAR), &cb);
+    if (SUCCEEDED(hr))
+    {
+        *ppwz = (PWSTR)CoTaskMemAlloc(cb);
+        if (*ppwz)
+        {
+            CopyMemory(*ppwz, pch, cch * sizeof(WCHAR));
+            (*ppwz)[cch] = L'\0';
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
+    return hr;
+}
+
+//
+// Copies a counted string that may hold a secret, so it must be freed with
+// SecretStringFree, which wipes it first.  The string is preceded by its
+// length, so the wipe covers all of it even if it holds an embedded NUL.
+//
+HRESULT SecretStringAlloc(
+    __in_ecount(cch) const WCHAR* pch,
+    __in DWORD cch,
+    __deref_out PWSTR* ppwz
+    )
+{
+    HRESULT hr;
+    size_t cb;
+
+    *ppwz = NULL;
+    hr = SizeTMult((size_t)cch + 1, sizeof(WCHAR), &cb);
+    if (SUCCEEDED(hr))
+    {
+        hr = SizeTAdd(cb, sizeof(size_t), &cb);
+    }
+    if (SUCCEEDED(hr))
+    {
+        size_t* pcch = (size_t*)CoTaskMemAlloc(cb);
+        if (pcch)
+        {
+            *pcch = cch;
+            *ppwz = (PWSTR)(pcch + 1);
+            CopyMemory(*ppwz, pch, cch * sizeof(WCHAR));
+            (*ppwz)[cch] = L'\0';
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
+    return hr;
+}
+
+void SecretStringFree(
+    __in_opt PWSTR pwz
+    )
+{
+    if (pwz)
+    {
+        size_t* pcch = (size_t*)pwz - 1;
+        SecureZeroMemory(pwz, *pcch * sizeof(*pwz));
+        *pcch = 0;
+        CoTaskMemFree(pcch);
+    }
+}
+
+// The localized status catalog is opened once per process, the first time a
+// result that's in the catalog is reported.
+static CStatusCatalog s_statusCatalog;
+static INIT_ONCE s_ioStatusCatalog = INIT_ONCE_STATIC_INIT;
+
+//
+// Maps <directory of this dll>\<UI language>\StatusCatalog.txt, if there is one.  Without
+// it the catalog's English messages are used, so this can't fail.
+//
+static BOOL CALLBACK _OpenStatusCatalog(
+    __inout PINIT_ONCE pio,
+    __inout_opt PVOID pvParameter,
+    __out_opt PVOID* ppvContext
+    )
+{
+    UNREFERENCED_PARAMETER(pio);
+    UNREFERENCED_PARAMETER(pvParameter);
+    UNREFERENCED_PARAMETER(ppvContext);
+
+    HMODULE hModule;
+    WCHAR szPath[MAX_PATH];
+    WCHAR szLocale[LOCALE_NAME_MAX_LENGTH];
+    DWORD cchPath = 0;
+    if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                           (LPCWSTR)&s_statusCatalog, &hModule))
+    {
+        cchPath = GetModuleFileNameW(hModule, szPath, ARRAYSIZE(szPath));
+    }
+
+    PWSTR pszSlash = ((cchPath > 0) && (cchPath < ARRAYSIZE(szPath))) ? wcsrchr(szPath, L'\\') : NULL;
+    if (pszSlash &&
+        LCIDToLocaleName(MAKELCID(GetUserDefaultUILanguage(), SORT_DEFAULT), szLocale, ARRAYSIZE(szLocale), 0))
+    {
+        pszSlash[1] = L'\0';
+        if (SUCCEEDED(StringCchCatW(szPath, ARRAYSIZE(szPath), szLocale)) &&
+            SUCCEEDED(StringCchCatW(szPath, ARRAYSIZE(szPath), L"\\StatusCatalog.txt")))
+        {
+            s_statusCatalog.Open(szPath);
+        }
+    }
+
+    return TRUE;
+}
+
+//
+// Looks up the message and icon for a logon result in the status catalog.  The lookup
+// itself doesn't allocate; the only allocation is the copy of the message handed back,
+// which the caller (LogonUI, through ReportResult) frees with CoTaskMemFree.  A result
+// that isn't in the catalog gets no message, as ReportResult allows.
+//
+HRESULT StatusCatalogReportResult(
+    __in NTSTATUS ntsStatus,
+    __in NTSTATUS ntsSubstatus,
+    __deref_out_opt PWSTR* ppwszOptionalStatusText,
+    __out CREDENTIAL_PROVIDER_STATUS_ICON* pcpsiOptionalStatusIcon
+    )
+{
+    HRESULT hr = S_OK;
+
+    *ppwszOptionalStatusText = NULL;
+    *pcpsiOptionalStatusIcon = CPSI_NONE;
+
+    DWORD iEntry = CStatusCatalog::Lookup(ntsStatus, ntsSubstatus);
+    if (STATUS_CATALOG_NONE != iEntry)
+    {
+        InitOnceExecuteOnce(&s_ioStatusCatalog, _OpenStatusCatalog, NULL, NULL);
+
+        DWORD cch;
+        const WCHAR* pch = s_statusCatalog.GetText(iEntry, &cch);
+        hr = _CountedStringAlloc(pch, cch, ppwszOptionalStatusText);
+        if (SUCCEEDED(hr))
+        {
+            *pcpsiOptionalStatusIcon = (CREDENTIAL_PROVIDER_STATUS_ICON)CStatusCatalog::GetEntry(iEntry).dwIcon;
+        }
+    }
+
+    return hr;
+}
@@ -87,3 +87,31 @@ HRESULT DomainUsernameStringAlloc(
     __in PCWSTR pwszUsername,
     __deref_out PWSTR* ppwszDomainUsername
     );
+
+//maps an NTSTATUS (such as the result of a BCrypt call) to an HRESULT, folding every success code to S_OK
+HRESULT HResultFromNtStatus(
+    __in NTSTATUS ntsStatus
+    );
+
+//copies a counted string, such as a span of a serialized credential, into a NUL-terminated
+//string that is zeroed when freed with SecretStringFree; it may only be freed that way
+HRESULT SecretStringAlloc(
+    __in_ecount(cch) const WCHAR* pch,
+    __in DWORD cch,
+    __deref_out PWSTR* ppwz
+    );
+
+//zeroes all the characters SecretStringAlloc copied, embedded NULs and all, and frees the
+//string; NULL is allowed
+void SecretStringFree(
+    __in_opt PWSTR pwz
+    );
+
+//looks up the (localized) message and icon for a logon result in the status catalog,
+//for ReportResult; a result that isn't in the catalog gets neither
+HRESULT StatusCatalogReportResult(
+    __in NTSTATUS ntsStatus,
+    __in NTSTATUS ntsSubstatus,
+    __deref_out_opt PWSTR* ppwszOptionalStatusText,
+    __out CREDENTIAL_PROVIDER_STATUS_ICON* pcpsiOptionalStatusIcon
+    );
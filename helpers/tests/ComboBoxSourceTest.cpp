@@ -0,0 +1,425 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Writes a UTF-16LE file of 100,000 combobox items, database, cost-centre
+// and domain names in mixed case with some Latin-1 letters, a byte order
+// mark, CRLF line ends and empty lines, and opens it with CComboBoxSource.
+// Every item must come back as written, and the matches for random
+// prefixes, typed one keystroke at a time, backspaced, and longer than
+// COMBOBOX_PREFIX_MAX, must be exactly those a scan of every item finds,
+// in sorted order.  Then times opening the file and each keystroke's filter
+// and first page against that scan.  Prints a line per check, and the
+// timings, and returns nonzero if any failed.
+
+#include "ComboBoxSource.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ITEMS               100000
+#define ITEM_CCH_MAX        (COMBOBOX_PREFIX_MAX + 16)
+#define EMPTY_LINE_EVERY    997
+#define RANDOM_PREFIXES     2000
+#define SESSIONS            400
+#define PAGE_ITEMS          50
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, const char* pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static DWORD s_dwRandom = 0x2545F491;
+
+static DWORD NextRandom()
+{
+    s_dwRandom ^= s_dwRandom << 13;
+    s_dwRandom ^= s_dwRandom >> 17;
+    s_dwRandom ^= s_dwRandom << 5;
+    return s_dwRandom;
+}
+
+static double NowUs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// The folding CComboBoxSource documents: ASCII and Latin-1 capitals.
+static WCHAR Fold(WCHAR ch)
+{
+    if ((ch >= 'A') && (ch <= 'Z'))
+    {
+        ch = (WCHAR)(ch + ('a' - 'A'));
+    }
+    else if ((ch >= 0xC0) && (ch <= 0xDE) && (ch != 0xD7))
+    {
+        ch = (WCHAR)(ch + 0x20);
+    }
+    return ch;
+}
+
+struct ITEM
+{
+    WCHAR   rgch[ITEM_CCH_MAX];
+    DWORD   cch;
+};
+
+static ITEM s_rgItem[ITEMS];
+static char s_rgfMatch[ITEMS];
+
+static const char* const c_rgszWord[] =
+{
+    "sales", "Sales", "SALES", "payroll", "Payroll", "north", "North", "south",
+    "ledger", "Ledger", "hr", "HR", "corp", "Corp", "eu", "EU", "na", "apac",
+    "finance", "Finance", "archive", "test", "prod", "Prod", "dev", "stage",
+};
+
+// Letters outside ASCII that fold: a capital, its small letter, and the
+// multiplication sign, which doesn't.
+static const WCHAR c_rgchLatin1[] = { 0xC9, 0xE9, 0xD6, 0xF6, 0xC5, 0xE5, 0xD7 };
+
+static void AppendAscii(ITEM* pItem, const char* psz)
+{
+    while (*psz && (pItem->cch < ITEM_CCH_MAX))
+    {
+        pItem->rgch[pItem->cch++] = (WCHAR)*psz++;
+    }
+}
+
+static void MakeItem(ITEM* pItem, DWORD i)
+{
+    const DWORD cWords = sizeof(c_rgszWord) / sizeof(c_rgszWord[0]);
+    pItem->cch = 0;
+    DWORD cParts = 1 + NextRandom() % 3;
+    for (DWORD j = 0; j < cParts; j++)
+    {
+        if (j)
+        {
+            AppendAscii(pItem, (NextRandom() % 2) ? "-" : ".");
+        }
+        AppendAscii(pItem, c_rgszWord[NextRandom() % cWords]);
+        if ((NextRandom() % 8) == 0)
+        {
+            pItem->rgch[pItem->cch++] = c_rgchLatin1[NextRandom() % (sizeof(c_rgchLatin1) / sizeof(c_rgchLatin1[0]))];
+        }
+    }
+
+    // A few run past the longest prefix a view filters on.
+    if ((i % 500) == 0)
+    {
+        while (pItem->cch < COMBOBOX_PREFIX_MAX + 8)
+        {
+            AppendAscii(pItem, "x");
+        }
+    }
+    else
+    {
+        char szNumber[16];
+        snprintf(szNumber, sizeof(szNumber), "%u", i);
+        AppendAscii(pItem, szNumber);
+    }
+}
+
+static bool WriteItems(const char* pszPath)
+{
+    FILE* pFile = fopen(pszPath, "wb");
+    if (!pFile)
+    {
+        return false;
+    }
+
+    const WCHAR chBom = 0xFEFF;
+    const WCHAR rgchCrLf[] = { '\r', '\n' };
+    fwrite(&chBom, sizeof(chBom), 1, pFile);
+    for (DWORD i = 0; i < ITEMS; i++)
+    {
+        if ((i % EMPTY_LINE_EVERY) == 0)
+        {
+            fwrite(rgchCrLf, sizeof(rgchCrLf), 1, pFile);
+        }
+        fwrite(s_rgItem[i].rgch, sizeof(WCHAR), s_rgItem[i].cch, pFile);
+        fwrite(rgchCrLf, sizeof(rgchCrLf), 1, pFile);
+    }
+    return (fclose(pFile) == 0);
+}
+
+static bool StartsWith(const ITEM* pItem, const WCHAR* pch, DWORD cch)
+{
+    if (cch > COMBOBOX_PREFIX_MAX)
+    {
+        cch = COMBOBOX_PREFIX_MAX;
+    }
+    if (cch > pItem->cch)
+    {
+        return false;
+    }
+    for (DWORD i = 0; i < cch; i++)
+    {
+        if (Fold(pItem->rgch[i]) != Fold(pch[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Marks the items a scan finds for a prefix, and returns how many.
+static DWORD ScanItems(const WCHAR* pch, DWORD cch)
+{
+    DWORD cMatches = 0;
+    for (DWORD i = 0; i < ITEMS; i++)
+    {
+        s_rgfMatch[i] = StartsWith(&s_rgItem[i], pch, cch);
+        cMatches += s_rgfMatch[i];
+    }
+    return cMatches;
+}
+
+// Folded comparison of two items, the order a view's matches come in.
+static int CompareFolded(const WCHAR* pchA, DWORD cchA, const WCHAR* pchB, DWORD cchB)
+{
+    for (DWORD i = 0; (i < cchA) && (i < cchB); i++)
+    {
+        WCHAR chA = Fold(pchA[i]);
+        WCHAR chB = Fold(pchB[i]);
+        if (chA != chB)
+        {
+            return (chA < chB) ? -1 : 1;
+        }
+    }
+    return (cchA == cchB) ? 0 : ((cchA < cchB) ? -1 : 1);
+}
+
+// True if the view holds exactly the items ScanItems last marked, in order.
+static bool ViewMatchesScan(const CComboBoxSource* pSource, const COMBOBOX_VIEW* pView, DWORD cScanned)
+{
+    DWORD cMatches = pSource->GetMatchCount(pView);
+    bool fSame = (cMatches == cScanned);
+    const WCHAR* pchPrevious = NULL;
+    DWORD cchPrevious = 0;
+    for (DWORD i = 0; fSame && (i < cMatches); i++)
+    {
+        DWORD iItem = pSource->GetMatch(pView, i);
+        DWORD cch;
+        const WCHAR* pch = pSource->GetItem(iItem, &cch);
+        fSame = (iItem < ITEMS) && s_rgfMatch[iItem];
+        if (fSame && pchPrevious)
+        {
+            fSame = (CompareFolded(pchPrevious, cchPrevious, pch, cch) <= 0);
+        }
+        pchPrevious = pch;
+        cchPrevious = cch;
+    }
+    return fSame;
+}
+
+// A prefix of a random item, sometimes with its case changed or a letter
+// replaced so it matches nothing.
+static DWORD RandomPrefix(WCHAR* pch)
+{
+    const ITEM* pItem = &s_rgItem[NextRandom() % ITEMS];
+    DWORD cch = 1 + NextRandom() % pItem->cch;
+    for (DWORD i = 0; i < cch; i++)
+    {
+        WCHAR ch = pItem->rgch[i];
+        if ((NextRandom() % 4) == 0)
+        {
+            if ((ch >= 'a') && (ch <= 'z'))
+            {
+                ch = (WCHAR)(ch - ('a' - 'A'));
+            }
+            else if ((ch >= 0xE0) && (ch <= 0xFE) && (ch != 0xF7))
+            {
+                ch = (WCHAR)(ch - 0x20);
+            }
+        }
+        pch[i] = ch;
+    }
+    if ((NextRandom() % 10) == 0)
+    {
+        pch[NextRandom() % cch] = 'q';
+    }
+    return cch;
+}
+
+// Stands in for CComboBoxField giving LogonUI the first page of a view.
+static DWORD ShowFirstPage(const CComboBoxSource* pSource, COMBOBOX_VIEW* pView)
+{
+    DWORD cch = 0;
+    DWORD cMatches = pSource->GetMatchCount(pView);
+    while ((pView->cShown < cMatches) && (pView->cShown < PAGE_ITEMS))
+    {
+        DWORD cchItem;
+        pSource->GetItem(pSource->GetMatch(pView, pView->cShown), &cchItem);
+        cch += cchItem;
+        pView->cShown++;
+    }
+    return cch;
+}
+
+int main()
+{
+    for (DWORD i = 0; i < ITEMS; i++)
+    {
+        MakeItem(&s_rgItem[i], i);
+    }
+
+    char szPath[64];
+    snprintf(szPath, sizeof(szPath), "/tmp/ComboBoxSourceTest.%d.txt", (int)getpid());
+    Check(WriteItems(szPath), "the item file is written");
+
+    CComboBoxSource* pSource = new CComboBoxSource();
+    double usStart = NowUs();
+    HRESULT hr = pSource->Open(szPath);
+    double usOpen = NowUs() - usStart;
+    unlink(szPath);
+    Check(SUCCEEDED(hr), "the source opens");
+    if (FAILED(hr))
+    {
+        pSource->Release();
+        printf("%u failed\n", s_cFailed);
+        return 1;
+    }
+
+    Check(pSource->GetCount() == ITEMS, "empty lines aren't items and the rest are");
+
+    bool fSame = true;
+    for (DWORD i = 0; fSame && (i < ITEMS); i++)
+    {
+        DWORD cch;
+        const WCHAR* pch = pSource->GetItem(i, &cch);
+        fSame = (cch == s_rgItem[i].cch) && (memcmp(pch, s_rgItem[i].rgch, cch * sizeof(WCHAR)) == 0);
+    }
+    Check(fSame, "each item reads back as written, without BOM or CR");
+
+    // The sorted index must be a permutation of the items.
+    COMBOBOX_VIEW view;
+    pSource->ResetView(&view);
+    memset(s_rgfMatch, 1, sizeof(s_rgfMatch));
+    Check(ViewMatchesScan(pSource, &view, ITEMS), "a reset view holds every item in folded order");
+    fSame = true;
+    memset(s_rgfMatch, 0, sizeof(s_rgfMatch));
+    for (DWORD i = 0; fSame && (i < ITEMS); i++)
+    {
+        DWORD iItem = pSource->GetMatch(&view, i);
+        fSame = !s_rgfMatch[iItem];
+        s_rgfMatch[iItem] = 1;
+    }
+    Check(fSame, "a reset view holds each item once");
+
+    // Random prefixes on a fresh view each.
+    WCHAR rgchPrefix[ITEM_CCH_MAX];
+    fSame = true;
+    for (DWORD i = 0; fSame && (i < RANDOM_PREFIXES); i++)
+    {
+        DWORD cch = RandomPrefix(rgchPrefix);
+        DWORD cScanned = ScanItems(rgchPrefix, cch);
+        pSource->ResetView(&view);
+        pSource->Filter(&view, rgchPrefix, cch);
+        fSame = ViewMatchesScan(pSource, &view, cScanned);
+    }
+    Check(fSame, "random prefixes match what a scan finds, ignoring case");
+
+    // Typing one keystroke at a time, and backspacing, on the same view.
+    bool fChangedRight = true;
+    fSame = true;
+    for (DWORD i = 0; fSame && (i < RANDOM_PREFIXES / 4); i++)
+    {
+        DWORD cchTarget = RandomPrefix(rgchPrefix);
+        pSource->ResetView(&view);
+        DWORD cch = 0;
+        while (fSame && (cch < cchTarget))
+        {
+            if ((cch > 1) && ((NextRandom() % 5) == 0))
+            {
+                cch -= 1 + NextRandom() % 2;
+            }
+            else
+            {
+                cch++;
+            }
+            DWORD iFirst = view.iFirst;
+            DWORD iLast = view.iLast;
+            view.cShown = 1;
+            bool fChanged = pSource->Filter(&view, rgchPrefix, cch);
+            bool fDiffers = (view.iFirst != iFirst) || (view.iLast != iLast);
+            fChangedRight = fChangedRight && (fChanged == fDiffers) && (view.cShown == (fChanged ? 0u : 1u));
+            fSame = ViewMatchesScan(pSource, &view, ScanItems(rgchPrefix, cch));
+        }
+    }
+    Check(fSame, "typing and backspacing match a fresh filter at every keystroke");
+    Check(fChangedRight, "Filter reports a change, and resets cShown, only when the matches change");
+
+    // Past COMBOBOX_PREFIX_MAX the rest is ignored.
+    const ITEM* pLong = &s_rgItem[500];
+    DWORD cScanned = ScanItems(pLong->rgch, COMBOBOX_PREFIX_MAX);
+    pSource->ResetView(&view);
+    pSource->Filter(&view, pLong->rgch, pLong->cch);
+    bool fLong = ViewMatchesScan(pSource, &view, cScanned) && (cScanned > 0);
+    memcpy(rgchPrefix, pLong->rgch, pLong->cch * sizeof(WCHAR));
+    rgchPrefix[COMBOBOX_PREFIX_MAX + 2] = 'q';
+    bool fChanged = pSource->Filter(&view, rgchPrefix, pLong->cch);
+    Check(fLong && !fChanged && ViewMatchesScan(pSource, &view, cScanned), "characters past COMBOBOX_PREFIX_MAX are ignored");
+
+    // Typing sessions: each keystroke filters and builds the first page.
+    DWORD cKeystrokes = 0;
+    double usFilter = 0;
+    double usWorst = 0;
+    DWORD cchShown = 0;
+    for (DWORD i = 0; i < SESSIONS; i++)
+    {
+        DWORD cchTarget = RandomPrefix(rgchPrefix);
+        pSource->ResetView(&view);
+        for (DWORD cch = 1; cch <= cchTarget; cch++)
+        {
+            double usKey = NowUs();
+            if (pSource->Filter(&view, rgchPrefix, cch))
+            {
+                cchShown += ShowFirstPage(pSource, &view);
+            }
+            usKey = NowUs() - usKey;
+            usFilter += usKey;
+            usWorst = (usKey > usWorst) ? usKey : usWorst;
+            cKeystrokes++;
+        }
+    }
+
+    // Some of the same keystrokes again, scanning every item instead.
+    DWORD cScanKeystrokes = 0;
+    double usScan = 0;
+    for (DWORD i = 0; i < SESSIONS / 10; i++)
+    {
+        DWORD cchTarget = RandomPrefix(rgchPrefix);
+        for (DWORD cch = 1; cch <= cchTarget; cch++)
+        {
+            double usKey = NowUs();
+            ScanItems(rgchPrefix, cch);
+            usScan += NowUs() - usKey;
+            cScanKeystrokes++;
+        }
+    }
+
+    printf("      %u items: open and index %.1f ms\n", ITEMS, usOpen / 1000);
+    printf("      %u keystrokes: filter and first page %.2f us mean, %.1f us worst, %u characters shown\n",
+        cKeystrokes, usFilter / cKeystrokes, usWorst, cchShown);
+    printf("      scanning every item instead: %.0f us per keystroke\n", usScan / cScanKeystrokes);
+    Check((usFilter / cKeystrokes) < 100, "a keystroke filters in under 100 us on average");
+
+    pSource->Release();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
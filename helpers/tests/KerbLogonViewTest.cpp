@@ -0,0 +1,436 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Reads KERB_INTERACTIVE_UNLOCK_LOGON blobs, packed by
+// KerbInteractiveUnlockLogonPack and by hand in the 32-bit (WOW) layout,
+// through CKerbLogonView, and checks the spans it hands out.  Then copies
+// the username and password as SetSerialization does, with a malloc spy
+// registered, and counts the bytes allocated against what the old path
+// copied: the whole blob (unpacked and repacked native first, for WOW) and
+// the two strings.  The spy also checks, just before each free, that
+// SecretStringFree wiped every character, including after an embedded NUL.
+// Last, corrupts and truncates blobs at random: each must be rejected or
+// read with every span inside the blob.  Prints a line per check, and the
+// byte counts, and returns nonzero if any failed.
+
+#include <windows.h>
+#include <ntsecapi.h>
+#include <credentialprovider.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "helpers.h"
+#include "KerbLogonView.h"
+
+#define CORRUPT_BLOBS       200000
+#define TIMED_VIEWS         1000000
+#define BLOCKS_MAX          16
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, PCSTR pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static DWORD s_dwRandom = 0x2545F491;
+
+static DWORD NextRandom()
+{
+    s_dwRandom ^= s_dwRandom << 13;
+    s_dwRandom ^= s_dwRandom >> 17;
+    s_dwRandom ^= s_dwRandom << 5;
+    return s_dwRandom;
+}
+
+// Counts what CoTaskMemAlloc hands out and, before each block is freed,
+// whether any of it is still nonzero.
+class CWipeSpy : public IMallocSpy
+{
+  public:
+    CWipeSpy():
+        cbAllocated(0),
+        cFrees(0),
+        cUnwiped(0),
+        _cRef(1),
+        _cBlocks(0),
+        _cbPending(0)
+    {
+    }
+
+    IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv)
+    {
+        static const QITAB qit[] =
+        {
+            QITABENT(CWipeSpy, IMallocSpy),
+            {0},
+        };
+        return QISearch(this, qit, riid, ppv);
+    }
+
+    IFACEMETHODIMP_(ULONG) AddRef()
+    {
+        return ++_cRef;
+    }
+
+    IFACEMETHODIMP_(ULONG) Release()
+    {
+        return --_cRef;
+    }
+
+    IFACEMETHODIMP_(SIZE_T) PreAlloc(SIZE_T cbRequest)
+    {
+        cbAllocated += cbRequest;
+        _cbPending = cbRequest;
+        return cbRequest;
+    }
+
+    IFACEMETHODIMP_(void*) PostAlloc(void* pActual)
+    {
+        if (pActual && (_cBlocks < BLOCKS_MAX))
+        {
+            _rgBlock[_cBlocks].pv = pActual;
+            _rgBlock[_cBlocks].cb = _cbPending;
+            _cBlocks++;
+        }
+        return pActual;
+    }
+
+    IFACEMETHODIMP_(void*) PreFree(void* pRequest, BOOL)
+    {
+        for (DWORD i = 0; i < _cBlocks; i++)
+        {
+            if (_rgBlock[i].pv == pRequest)
+            {
+                const BYTE* pb = (const BYTE*)pRequest;
+                for (SIZE_T ib = 0; ib < _rgBlock[i].cb; ib++)
+                {
+                    if (pb[ib])
+                    {
+                        cUnwiped++;
+                        break;
+                    }
+                }
+                _rgBlock[i] = _rgBlock[--_cBlocks];
+                cFrees++;
+                break;
+            }
+        }
+        return pRequest;
+    }
+
+    IFACEMETHODIMP_(void) PostFree(BOOL)
+    {
+    }
+
+    IFACEMETHODIMP_(SIZE_T) PreRealloc(void* pRequest, SIZE_T cbRequest, void** ppNewRequest, BOOL)
+    {
+        *ppNewRequest = pRequest;
+        return cbRequest;
+    }
+
+    IFACEMETHODIMP_(void*) PostRealloc(void* pActual, BOOL)
+    {
+        return pActual;
+    }
+
+    IFACEMETHODIMP_(void*) PreGetSize(void* pRequest, BOOL)
+    {
+        return pRequest;
+    }
+
+    IFACEMETHODIMP_(SIZE_T) PostGetSize(SIZE_T cbActual, BOOL)
+    {
+        return cbActual;
+    }
+
+    IFACEMETHODIMP_(void*) PreDidAlloc(void* pRequest, BOOL)
+    {
+        return pRequest;
+    }
+
+    IFACEMETHODIMP_(int) PostDidAlloc(void*, BOOL, int fActual)
+    {
+        return fActual;
+    }
+
+    IFACEMETHODIMP_(void) PreHeapMinimize()
+    {
+    }
+
+    IFACEMETHODIMP_(void) PostHeapMinimize()
+    {
+    }
+
+  public:
+    SIZE_T      cbAllocated;
+    DWORD       cFrees;
+    DWORD       cUnwiped;
+
+  private:
+    struct BLOCK
+    {
+        void*   pv;
+        SIZE_T  cb;
+    };
+
+    ULONG       _cRef;
+    BLOCK       _rgBlock[BLOCKS_MAX];
+    DWORD       _cBlocks;
+    SIZE_T      _cbPending;
+};
+
+struct LOGON_CASE
+{
+    PCSTR   pszName;
+    PCWSTR  pwzDomain;
+    PCWSTR  pwzUsername;
+    PCWSTR  pwzPassword;
+    DWORD   cchPassword;        // The password can hold an embedded NUL.
+};
+
+static const LOGON_CASE c_rgCase[] =
+{
+    { "WORKSTATION-42\\Administrator", L"WORKSTATION-42", L"Administrator", L"Tr0ub4dor&3", 11 },
+    { "corp.example.com\\alice.longname", L"corp.example.com", L"alice.longname", L"correct horse battery staple", 28 },
+    { "\\guest", L"", L"guest", L"", 0 },
+    { "embedded NUL in the password", L"CONTOSO", L"bob", L"pass\0word!", 10 },
+};
+
+// Packs a logon in the 32-bit layout: a 4-byte message type, three
+// UNICODE_STRINGs with 4-byte offsets, and the LUID, then the strings.
+static DWORD PackWow(const LOGON_CASE* pCase, BYTE* rgb)
+{
+    const DWORD cbHeader = 4 + 3 * 8 + 8;
+    const WCHAR* rgpch[3] = { pCase->pwzDomain, pCase->pwzUsername, pCase->pwzPassword };
+    const DWORD rgcch[3] = { (DWORD)wcslen(pCase->pwzDomain), (DWORD)wcslen(pCase->pwzUsername), pCase->cchPassword };
+
+    ZeroMemory(rgb, cbHeader);
+    DWORD dwMessageType = KerbInteractiveLogon;
+    CopyMemory(rgb, &dwMessageType, sizeof(dwMessageType));
+    DWORD ib = cbHeader;
+    for (DWORD i = 0; i < 3; i++)
+    {
+        USHORT cb = (USHORT)(rgcch[i] * sizeof(WCHAR));
+        CopyMemory(rgb + 4 + i * 8, &cb, sizeof(cb));
+        CopyMemory(rgb + 4 + i * 8 + 2, &cb, sizeof(cb));
+        CopyMemory(rgb + 4 + i * 8 + 4, &ib, sizeof(ib));
+        CopyMemory(rgb + ib, rgpch[i], cb);
+        ib += cb;
+    }
+    return ib;
+}
+
+// Packs a logon natively with KerbInteractiveUnlockLogonPack.  The password
+// is set by length, so an embedded NUL survives.
+static HRESULT PackNative(const LOGON_CASE* pCase, BYTE** prgb, DWORD* pcb)
+{
+    KERB_INTERACTIVE_UNLOCK_LOGON kiul;
+    HRESULT hr = KerbInteractiveUnlockLogonInit((PWSTR)pCase->pwzDomain, (PWSTR)pCase->pwzUsername,
+        (PWSTR)pCase->pwzPassword, CPUS_LOGON, &kiul);
+    if (SUCCEEDED(hr))
+    {
+        kiul.Logon.Password.Length = (USHORT)(pCase->cchPassword * sizeof(WCHAR));
+        kiul.Logon.Password.MaximumLength = kiul.Logon.Password.Length;
+        hr = KerbInteractiveUnlockLogonPack(kiul, prgb, pcb);
+    }
+    return hr;
+}
+
+static bool SpanIs(const COUNTED_SPAN& span, PCWSTR pwz, DWORD cch)
+{
+    return (span.cch == cch) && ((cch == 0) || (memcmp(span.pch, pwz, cch * sizeof(WCHAR)) == 0));
+}
+
+static bool SpanInside(const COUNTED_SPAN& span, const BYTE* rgb, DWORD cb)
+{
+    return (span.cch == 0) ||
+        (((const BYTE*)span.pch >= rgb) && ((const BYTE*)(span.pch + span.cch) <= rgb + cb));
+}
+
+static bool ViewIs(const CKerbLogonView& view, const LOGON_CASE* pCase)
+{
+    return SpanIs(view.GetDomain(), pCase->pwzDomain, (DWORD)wcslen(pCase->pwzDomain)) &&
+        SpanIs(view.GetUsername(), pCase->pwzUsername, (DWORD)wcslen(pCase->pwzUsername)) &&
+        SpanIs(view.GetPassword(), pCase->pwzPassword, pCase->cchPassword) &&
+        (view.GetMessageType() == KerbInteractiveLogon);
+}
+
+// Copies the username and password as SetSerialization now does.
+static bool CopyAndFree(const CKerbLogonView& view, const LOGON_CASE* pCase)
+{
+    PWSTR pwzUsername = NULL;
+    PWSTR pwzPassword = NULL;
+    HRESULT hr = SecretStringAlloc(view.GetUsername().pch, view.GetUsername().cch, &pwzUsername);
+    if (SUCCEEDED(hr))
+    {
+        hr = SecretStringAlloc(view.GetPassword().pch, view.GetPassword().cch, &pwzPassword);
+    }
+    bool fCopied = SUCCEEDED(hr) &&
+        (wcscmp(pwzUsername, pCase->pwzUsername) == 0) &&
+        (memcmp(pwzPassword, pCase->pwzPassword, pCase->cchPassword * sizeof(WCHAR)) == 0) &&
+        (pwzPassword[pCase->cchPassword] == L'\0');
+    SecretStringFree(pwzUsername);
+    SecretStringFree(pwzPassword);
+    return fCopied;
+}
+
+// What the old SetSerialization and _EnumerateSetSerialization copied: the
+// blob, and for WOW the domain\username and password CredUnPack unpacked and
+// the native blob CredPack repacked, then each string into a stack buffer
+// with its NUL.
+static DWORD OldBytesCopied(const LOGON_CASE* pCase, DWORD cbBlob, bool fWow)
+{
+    const DWORD cchDomain = (DWORD)wcslen(pCase->pwzDomain);
+    const DWORD cchUsername = (DWORD)wcslen(pCase->pwzUsername);
+    DWORD cb = cbBlob;
+    if (fWow)
+    {
+        const DWORD cbNative = sizeof(KERB_INTERACTIVE_UNLOCK_LOGON) +
+            (cchDomain + cchUsername + pCase->cchPassword) * sizeof(WCHAR);
+        cb += (cchDomain + 1 + cchUsername + 1 + pCase->cchPassword + 1) * sizeof(WCHAR) + cbNative;
+    }
+    return cb + (cchUsername + 1 + pCase->cchPassword + 1) * sizeof(WCHAR);
+}
+
+int main()
+{
+    CWipeSpy spy;
+    BYTE rgbWow[1024];
+    bool fRead = true;
+    bool fCopied = true;
+    bool fWiped = true;
+
+    printf("      case                                   before   after\n");
+    for (DWORD i = 0; i < ARRAYSIZE(c_rgCase); i++)
+    {
+        const LOGON_CASE* pCase = &c_rgCase[i];
+        for (int iLayout = 0; iLayout < 2; iLayout++)
+        {
+            const bool fWow = (iLayout == 1);
+            BYTE* rgb = NULL;
+            DWORD cb = 0;
+            if (fWow)
+            {
+                cb = PackWow(pCase, rgbWow);
+                rgb = rgbWow;
+            }
+            else if (FAILED(PackNative(pCase, &rgb, &cb)))
+            {
+                fRead = false;
+                continue;
+            }
+
+            CKerbLogonView view;
+            fRead = fRead && SUCCEEDED(view.Initialize(rgb, cb, fWow)) && ViewIs(view, pCase);
+
+            CoRegisterMallocSpy(&spy);
+            spy.cbAllocated = 0;
+            spy.cFrees = 0;
+            spy.cUnwiped = 0;
+            fCopied = CopyAndFree(view, pCase) && fCopied;
+            CoRevokeMallocSpy();
+            fWiped = fWiped && (spy.cFrees == 2) && (spy.cUnwiped == 0);
+
+            char szName[64];
+            snprintf(szName, sizeof(szName), "%s%s", pCase->pszName, fWow ? " (WOW)" : "");
+            printf("      %-38s %6u %7u\n", szName, OldBytesCopied(pCase, cb, fWow), (DWORD)spy.cbAllocated);
+
+            if (!fWow)
+            {
+                CoTaskMemFree(rgb);
+            }
+        }
+    }
+    Check(fRead, "native and WOW blobs read back the domain, username and password");
+    Check(fCopied, "the username and password copy out whole, embedded NUL included");
+    Check(fWiped, "SecretStringFree wipes every character before it frees");
+
+    // A blob one byte short of its header, or with a string past its end,
+    // is rejected.
+    DWORD cb = PackWow(&c_rgCase[0], rgbWow);
+    CKerbLogonView view;
+    Check(FAILED(view.Initialize(rgbWow, 4 + 3 * 8 + 8 - 1, true)), "a WOW blob shorter than its header is rejected");
+    Check(FAILED(view.Initialize(rgbWow, cb - 1, true)), "a WOW blob cut inside its password is rejected");
+    Check(FAILED(view.Initialize(NULL, 0, false)), "no blob is rejected");
+
+    // Random corruption of header bytes and lengths.
+    DWORD cRejected = 0;
+    bool fInside = true;
+    for (DWORD i = 0; i < CORRUPT_BLOBS; i++)
+    {
+        const LOGON_CASE* pCase = &c_rgCase[NextRandom() % ARRAYSIZE(c_rgCase)];
+        const bool fWow = (NextRandom() % 2) == 0;
+        BYTE* rgbPacked = NULL;
+        DWORD cbPacked = 0;
+        if (fWow)
+        {
+            cbPacked = PackWow(pCase, rgbWow);
+            rgbPacked = rgbWow;
+        }
+        else if (FAILED(PackNative(pCase, &rgbPacked, &cbPacked)))
+        {
+            fInside = false;
+            break;
+        }
+
+        // An exact-size copy, so a read past the end is a read past the block.
+        DWORD cbCorrupt = cbPacked - ((NextRandom() % 4) ? 0 : NextRandom() % (cbPacked + 1));
+        BYTE* rgbCorrupt = (BYTE*)malloc(cbCorrupt ? cbCorrupt : 1);
+        memcpy(rgbCorrupt, rgbPacked, cbCorrupt);
+        DWORD cFlips = NextRandom() % 4;
+        for (DWORD j = 0; (j < cFlips) && cbCorrupt; j++)
+        {
+            rgbCorrupt[NextRandom() % cbCorrupt] = (BYTE)NextRandom();
+        }
+
+        CKerbLogonView viewCorrupt;
+        if (FAILED(viewCorrupt.Initialize(rgbCorrupt, cbCorrupt, fWow)))
+        {
+            cRejected++;
+        }
+        else
+        {
+            fInside = fInside && SpanInside(viewCorrupt.GetDomain(), rgbCorrupt, cbCorrupt) &&
+                SpanInside(viewCorrupt.GetUsername(), rgbCorrupt, cbCorrupt) &&
+                SpanInside(viewCorrupt.GetPassword(), rgbCorrupt, cbCorrupt);
+        }
+        free(rgbCorrupt);
+        if (!fWow)
+        {
+            CoTaskMemFree(rgbPacked);
+        }
+    }
+    printf("      %u corrupted or truncated blobs, %u rejected\n", CORRUPT_BLOBS, cRejected);
+    Check(fInside, "corrupted blobs are rejected or read inside the blob");
+
+    // How long Initialize takes.
+    BYTE* rgbNative = NULL;
+    DWORD cbNative = 0;
+    PackNative(&c_rgCase[1], &rgbNative, &cbNative);
+    timespec tsStart;
+    timespec tsEnd;
+    DWORD cRead = 0;
+    clock_gettime(CLOCK_MONOTONIC, &tsStart);
+    for (DWORD i = 0; i < TIMED_VIEWS; i++)
+    {
+        CKerbLogonView viewTimed;
+        cRead += SUCCEEDED(viewTimed.Initialize(rgbNative, cbNative, false)) ? viewTimed.GetPassword().cch : 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &tsEnd);
+    double dblNs = ((tsEnd.tv_sec - tsStart.tv_sec) * 1e9 + (tsEnd.tv_nsec - tsStart.tv_nsec)) / TIMED_VIEWS;
+    printf("      Initialize: %.1f ns (%u)\n", dblNs, cRead / TIMED_VIEWS);
+    CoTaskMemFree(rgbNative);
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
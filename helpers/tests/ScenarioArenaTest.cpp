@@ -0,0 +1,497 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Counts the heap allocations behind CScenarioArena with an operator new[]
+// that counts, and checks that allocations are aligned and don't overlap,
+// that a large request gets a block of its own without wasting the current
+// one, that a reset frees every block but the first, and that Renew leaves
+// an arena a credential still holds to that credential, strings and all.
+// Then runs 20,000 scenarios the way the all-controls sample does, with its
+// labels and field strings in an arena and keystrokes in the edit and
+// password fields, against the same scenarios with every string on the heap.
+// Prints a line per check, the allocation counts, the arena's used and
+// reserved bytes, and the timings, and returns nonzero if any failed.
+
+#include "ScenarioArena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+
+#define SCENARIOS           20000
+#define KEYSTROKES          12      // Into the edit field, then the password.
+#define SMALL_ALLOCS        2000
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, const char* pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static DWORD s_dwRandom = 0x2545F491;
+
+static DWORD NextRandom()
+{
+    s_dwRandom ^= s_dwRandom << 13;
+    s_dwRandom ^= s_dwRandom >> 17;
+    s_dwRandom ^= s_dwRandom << 5;
+    return s_dwRandom;
+}
+
+static double NowUs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// The arena's blocks, and the heap strings below, come from new[].
+static DWORD s_cNewArray = 0;
+static DWORD s_cDeleteArray = 0;
+
+void* operator new[](size_t cb)
+{
+    void* pv = malloc(cb ? cb : 1);
+    if (pv == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    s_cNewArray++;
+    return pv;
+}
+
+void operator delete[](void* pv) noexcept
+{
+    if (pv != NULL)
+    {
+        s_cDeleteArray++;
+        free(pv);
+    }
+}
+
+void operator delete[](void* pv, size_t) noexcept
+{
+    operator delete[](pv);
+}
+
+// The all-controls sample's labels and the strings it sets once per scenario.
+static const char* s_rgpszLabels[] =
+{
+    "Image", "LargeText", "SmallText", "EditText", "Password",
+    "Submit", "Checkbox", "Combobox", "CommandLink",
+};
+
+static const char* s_rgpszFieldStrings[] =
+{
+    "Large Text", "Small Text", "Submit", "Checkbox", "Combobox", "Command Link",
+};
+
+#define LABELS          (sizeof(s_rgpszLabels) / sizeof(s_rgpszLabels[0]))
+#define FIELD_STRINGS   (sizeof(s_rgpszFieldStrings) / sizeof(s_rgpszFieldStrings[0]))
+#define TEXT_CCH_MAX    64
+
+static void Widen(const char* psz, WCHAR* pwz)
+{
+    do
+    {
+        *pwz++ = (unsigned char)*psz;
+    } while (*psz++ != 0);
+}
+
+static bool TextIs(const WCHAR* pwz, const char* psz)
+{
+    while ((*psz != 0) && (*pwz == (unsigned char)*psz))
+    {
+        pwz++;
+        psz++;
+    }
+    return (*pwz == 0) && (*psz == 0);
+}
+
+static WCHAR* HeapDup(const WCHAR* pwz)
+{
+    size_t cch = 0;
+    while (pwz[cch] != 0)
+    {
+        cch++;
+    }
+    WCHAR* pwzCopy = new WCHAR[cch + 1];
+    memcpy(pwzCopy, pwz, (cch + 1) * sizeof(WCHAR));
+    return pwzCopy;
+}
+
+// What a credential keeps, whichever way its strings are allocated.
+struct CREDENTIAL
+{
+    CScenarioArena* pArena;
+    WCHAR*          rgpwzLabels[LABELS];
+    WCHAR*          rgpwzFieldStrings[FIELD_STRINGS];
+    WCHAR*          pwzEdit;
+    size_t          cchEdit;
+    WCHAR*          pwzPassword;
+};
+
+// The sample's way: labels and write-once strings in the arena, the edit value in a buffer
+// that doubles, and the password on the heap so it can be freed as soon as it's replaced.
+static bool ArenaInitialize(CREDENTIAL* pcred, CScenarioArena* pArena)
+{
+    WCHAR wsz[TEXT_CCH_MAX];
+    bool fOk = true;
+
+    memset(pcred, 0, sizeof(*pcred));
+    pcred->pArena = pArena;
+    pArena->AddRef();
+    for (DWORD i = 0; fOk && (i < LABELS); i++)
+    {
+        Widen(s_rgpszLabels[i], wsz);
+        fOk = SUCCEEDED(pArena->StrDup(wsz, &pcred->rgpwzLabels[i]));
+    }
+    for (DWORD i = 0; fOk && (i < FIELD_STRINGS); i++)
+    {
+        Widen(s_rgpszFieldStrings[i], wsz);
+        fOk = SUCCEEDED(pArena->StrDup(wsz, &pcred->rgpwzFieldStrings[i]));
+    }
+    return fOk;
+}
+
+static void ArenaSetEdit(CREDENTIAL* pcred, const WCHAR* pwz)
+{
+    size_t cch = 0;
+    while (pwz[cch++] != 0)
+    {
+    }
+    if (cch > pcred->cchEdit)
+    {
+        size_t cchNew = (cch > 2 * pcred->cchEdit) ? cch : 2 * pcred->cchEdit;
+        delete [] pcred->pwzEdit;
+        pcred->pwzEdit = new WCHAR[cchNew];
+        pcred->cchEdit = cchNew;
+    }
+    memcpy(pcred->pwzEdit, pwz, cch * sizeof(WCHAR));
+}
+
+static void ArenaUninitialize(CREDENTIAL* pcred)
+{
+    delete [] pcred->pwzEdit;
+    delete [] pcred->pwzPassword;
+    pcred->pArena->Release();
+}
+
+// The way it was before the arena: every string a heap copy, and a new copy of the edit
+// value on every keystroke.
+static void HeapInitialize(CREDENTIAL* pcred)
+{
+    WCHAR wsz[TEXT_CCH_MAX];
+
+    memset(pcred, 0, sizeof(*pcred));
+    for (DWORD i = 0; i < LABELS; i++)
+    {
+        Widen(s_rgpszLabels[i], wsz);
+        pcred->rgpwzLabels[i] = HeapDup(wsz);
+    }
+    for (DWORD i = 0; i < FIELD_STRINGS; i++)
+    {
+        Widen(s_rgpszFieldStrings[i], wsz);
+        pcred->rgpwzFieldStrings[i] = HeapDup(wsz);
+    }
+}
+
+static void HeapSetEdit(CREDENTIAL* pcred, const WCHAR* pwz)
+{
+    delete [] pcred->pwzEdit;
+    pcred->pwzEdit = HeapDup(pwz);
+}
+
+static void HeapUninitialize(CREDENTIAL* pcred)
+{
+    for (DWORD i = 0; i < LABELS; i++)
+    {
+        delete [] pcred->rgpwzLabels[i];
+    }
+    for (DWORD i = 0; i < FIELD_STRINGS; i++)
+    {
+        delete [] pcred->rgpwzFieldStrings[i];
+    }
+    delete [] pcred->pwzEdit;
+    delete [] pcred->pwzPassword;
+}
+
+// Sets the password, then types KEYSTROKES characters into the edit field and the password.
+// Both ways replace the password the same way, so it's counted in both.
+static void Type(CREDENTIAL* pcred, void (*pfnSetEdit)(CREDENTIAL*, const WCHAR*))
+{
+    WCHAR wsz[TEXT_CCH_MAX];
+
+    Widen("Edit Text", wsz);
+    pfnSetEdit(pcred, wsz);
+    wsz[0] = 0;
+    pcred->pwzPassword = HeapDup(wsz);
+
+    size_t cch = 0;
+    Widen("Edit Text ", wsz);
+    while (wsz[cch] != 0)
+    {
+        cch++;
+    }
+    for (DWORD i = 0; i < KEYSTROKES; i++)
+    {
+        wsz[cch++] = 'a' + NextRandom() % 26;
+        wsz[cch] = 0;
+        pfnSetEdit(pcred, wsz);
+    }
+
+    WCHAR wszPassword[KEYSTROKES + 1];
+    for (DWORD i = 0; i < KEYSTROKES; i++)
+    {
+        wszPassword[i] = 'A' + NextRandom() % 26;
+        wszPassword[i + 1] = 0;
+        delete [] pcred->pwzPassword;
+        pcred->pwzPassword = HeapDup(wszPassword);
+    }
+}
+
+static bool IsAligned(const void* pv)
+{
+    return ((size_t)pv % 8) == 0;
+}
+
+static void CheckSmallAllocs()
+{
+    CScenarioArena* pArena;
+    CScenarioArena::CreateInstance(&pArena);
+
+    // Every allocation is aligned and filled with its own byte; none may be overwritten by a
+    // later one.  Zero bytes still gets a pointer of its own.
+    unsigned char* rgpb[SMALL_ALLOCS];
+    size_t rgcb[SMALL_ALLOCS];
+    bool fAligned = true;
+    bool fIntact = true;
+    bool fDistinct = true;
+    for (DWORD i = 0; i < SMALL_ALLOCS; i++)
+    {
+        rgcb[i] = NextRandom() % 65;
+        rgpb[i] = (unsigned char*)pArena->Alloc(rgcb[i]);
+        fAligned = fAligned && (rgpb[i] != NULL) && IsAligned(rgpb[i]);
+        fDistinct = fDistinct && ((i == 0) || (rgpb[i] != rgpb[i - 1]));
+        memset(rgpb[i], (int)(i & 0xFF), rgcb[i]);
+    }
+    for (DWORD i = 0; i < SMALL_ALLOCS; i++)
+    {
+        for (size_t ib = 0; ib < rgcb[i]; ib++)
+        {
+            fIntact = fIntact && (rgpb[i][ib] == (unsigned char)(i & 0xFF));
+        }
+    }
+    Check(fAligned, "every allocation is 8-byte aligned");
+    Check(fIntact, "no allocation overlaps another");
+    Check(fDistinct, "zero-byte allocations get pointers of their own");
+
+    SCENARIO_ARENA_STATS stats;
+    pArena->GetStats(&stats);
+    printf("      %u allocations of up to 64 bytes took %u blocks, %llu of %llu bytes used\n",
+        stats.cAllocs, stats.cBlocks, (unsigned long long)stats.cbRequested,
+        (unsigned long long)stats.cbReserved);
+    Check((SMALL_ALLOCS == stats.cAllocs) && (stats.cBlocks > 1),
+        "small allocations overflow into new blocks");
+
+    // Renew on the only reference resets in place: the arena stays, the first block stays,
+    // and every other block is freed.
+    const DWORD cDeletes = s_cDeleteArray;
+    const DWORD cBlocks = stats.cBlocks;
+    CScenarioArena* pArenaBefore = pArena;
+    CScenarioArena::Renew(&pArena);
+    pArena->GetStats(&stats);
+    Check(pArena == pArenaBefore, "Renew resets an arena no credential holds in place");
+    Check((s_cDeleteArray - cDeletes == cBlocks - 1) && (1 == stats.cResets),
+        "a reset frees every block but the first");
+    Check((0 == stats.cbRequested) && (stats.cbReserved >= SCENARIO_ARENA_BLOCK_CB) &&
+        (stats.cbReserved < SCENARIO_ARENA_BLOCK_CB + 64), "a reset leaves one block reserved");
+
+    const DWORD cNews = s_cNewArray;
+    void* pv = pArena->Alloc(16);
+    Check((pv != NULL) && (s_cNewArray == cNews), "after a reset, the first block is reused");
+    pArena->Release();
+}
+
+static void CheckLargeAlloc()
+{
+    CScenarioArena* pArena;
+    CScenarioArena::CreateInstance(&pArena);
+
+    // A large request that doesn't fit in what's left of the current block goes in a block of
+    // its own, behind the current one, so the next small one lands right after the last.
+    for (DWORD i = 0; i < 3; i++)
+    {
+        pArena->Alloc(SCENARIO_ARENA_BLOCK_CB / 4);
+    }
+    unsigned char* pbFirst = (unsigned char*)pArena->Alloc(24);
+    unsigned char* pbLarge = (unsigned char*)pArena->Alloc(SCENARIO_ARENA_BLOCK_CB / 2);
+    unsigned char* pbNext = (unsigned char*)pArena->Alloc(24);
+    unsigned char* pbHuge = (unsigned char*)pArena->Alloc(3 * SCENARIO_ARENA_BLOCK_CB);
+
+    SCENARIO_ARENA_STATS stats;
+    pArena->GetStats(&stats);
+    Check((pbLarge != NULL) && IsAligned(pbLarge) && (pbHuge != NULL) && IsAligned(pbHuge),
+        "large allocations are aligned");
+    Check(pbNext == pbFirst + 24, "a large allocation doesn't waste the rest of the current block");
+    Check(3 == stats.cBlocks, "each large allocation that doesn't fit gets a block of its own");
+    memset(pbHuge, 0x5A, 3 * SCENARIO_ARENA_BLOCK_CB);
+    memset(pbLarge, 0xA5, SCENARIO_ARENA_BLOCK_CB / 2);
+    Check((pbNext[0] != 0x5A) && (pbNext[0] != 0xA5) && (pbFirst[0] != 0xA5),
+        "a large allocation doesn't overlap the small ones");
+
+    const DWORD cDeletes = s_cDeleteArray;
+    CScenarioArena::Renew(&pArena);
+    pArena->GetStats(&stats);
+    Check((s_cDeleteArray - cDeletes == 2) && (stats.cbReserved < SCENARIO_ARENA_BLOCK_CB + 64),
+        "a reset frees the large blocks");
+    pArena->Release();
+
+    // When the first thing ever allocated is large, that block is the one a reset keeps.
+    CScenarioArena::CreateInstance(&pArena);
+    pArena->Alloc(2 * SCENARIO_ARENA_BLOCK_CB);
+    pArena->Alloc(8);
+    CScenarioArena::Renew(&pArena);
+    pArena->GetStats(&stats);
+    Check((2 == stats.cBlocks) && (stats.cbReserved < 2 * SCENARIO_ARENA_BLOCK_CB + 64),
+        "a reset keeps the oldest block, large or not");
+    pArena->Release();
+}
+
+static void CheckHeldCredential()
+{
+    // The provider's arena, and a credential from its first scenario that LogonUI holds past
+    // the start of the second.
+    CScenarioArena* pArena = NULL;
+    CScenarioArena::Renew(&pArena);
+    CREDENTIAL credHeld;
+    ArenaInitialize(&credHeld, pArena);
+    Type(&credHeld, ArenaSetEdit);
+
+    CScenarioArena* pArenaBefore = pArena;
+    CScenarioArena::Renew(&pArena);
+    Check(pArena != pArenaBefore, "Renew starts a new arena while a credential holds the old one");
+
+    CREDENTIAL cred;
+    ArenaInitialize(&cred, pArena);
+    Type(&cred, ArenaSetEdit);
+
+    bool fIntact = true;
+    for (DWORD i = 0; i < LABELS; i++)
+    {
+        fIntact = fIntact && TextIs(credHeld.rgpwzLabels[i], s_rgpszLabels[i]) &&
+            (credHeld.rgpwzLabels[i] != cred.rgpwzLabels[i]);
+    }
+    for (DWORD i = 0; i < FIELD_STRINGS; i++)
+    {
+        fIntact = fIntact && TextIs(credHeld.rgpwzFieldStrings[i], s_rgpszFieldStrings[i]);
+    }
+    Check(fIntact, "the held credential keeps its strings through the next scenario");
+
+    // Letting go of the held credential frees the old arena; the new one is untouched.
+    const DWORD cDeletes = s_cDeleteArray;
+    ArenaUninitialize(&credHeld);
+    Check(s_cDeleteArray - cDeletes == 3, "releasing the held credential frees its arena's block");
+    ArenaUninitialize(&cred);
+
+    SCENARIO_ARENA_STATS stats;
+    pArena->GetStats(&stats);
+    Check((1 == stats.cBlocks) && (0 == stats.cResets), "the new arena starts with one block");
+    pArena->Release();
+}
+
+// Runs SCENARIOS scenarios one way or the other, releasing each credential before the next
+// scenario as LogonUI usually does.  Returns the microseconds it took.
+static double RunScenarios(bool fArena, CScenarioArena** ppArena)
+{
+    const double dStart = NowUs();
+    for (DWORD i = 0; i < SCENARIOS; i++)
+    {
+        CREDENTIAL cred;
+        if (fArena)
+        {
+            CScenarioArena::Renew(ppArena);
+            ArenaInitialize(&cred, *ppArena);
+            Type(&cred, ArenaSetEdit);
+            ArenaUninitialize(&cred);
+        }
+        else
+        {
+            HeapInitialize(&cred);
+            Type(&cred, HeapSetEdit);
+            HeapUninitialize(&cred);
+        }
+    }
+    return NowUs() - dStart;
+}
+
+static void CheckScenarios()
+{
+    CScenarioArena* pArena = NULL;
+
+    // Once to warm up, then counted and timed.
+    RunScenarios(false, NULL);
+    RunScenarios(true, &pArena);
+
+    DWORD cNews = s_cNewArray;
+    const double dHeapUs = RunScenarios(false, NULL);
+    const DWORD cHeapNews = s_cNewArray - cNews;
+
+    SCENARIO_ARENA_STATS statsBefore;
+    pArena->GetStats(&statsBefore);
+    cNews = s_cNewArray;
+    const double dArenaUs = RunScenarios(true, &pArena);
+    const DWORD cArenaNews = s_cNewArray - cNews;
+
+    SCENARIO_ARENA_STATS stats;
+    pArena->GetStats(&stats);
+
+    const DWORD cStrings = LABELS + FIELD_STRINGS;
+    const DWORD cPasswordNews = 1 + KEYSTROKES;
+    printf("      %u scenarios of %u labels and field strings and %u keystrokes each\n",
+        SCENARIOS, cStrings, 2 * KEYSTROKES);
+    printf("      heap:  %.1f allocations per scenario, %.0f ns per scenario\n",
+        (double)cHeapNews / SCENARIOS, dHeapUs * 1000 / SCENARIOS);
+    printf("      arena: %.1f allocations per scenario, %.0f ns per scenario\n",
+        (double)cArenaNews / SCENARIOS, dArenaUs * 1000 / SCENARIOS);
+    printf("      arena: %u blocks allocated in %u scenarios, %llu of %llu bytes used\n",
+        stats.cBlocks - statsBefore.cBlocks, SCENARIOS, (unsigned long long)stats.cbRequested,
+        (unsigned long long)stats.cbReserved);
+
+    Check(cHeapNews == SCENARIOS * (cStrings + 1 + KEYSTROKES + cPasswordNews),
+        "the heap way allocates every string and every keystroke");
+    Check(stats.cBlocks == statsBefore.cBlocks, "the arena allocates no blocks once warm");
+    Check(stats.cResets - statsBefore.cResets == SCENARIOS, "each scenario resets the arena");
+
+    // What's left on the heap is the password, which is freed as soon as it's replaced, and the
+    // edit buffer's doublings.
+    Check(cArenaNews < SCENARIOS * (cPasswordNews + 4),
+        "with the arena, only the password and edit buffer use the heap");
+    Check(stats.cbRequested <= stats.cbReserved, "a scenario fits in one block");
+    pArena->Release();
+}
+
+int main()
+{
+    CheckSmallAllocs();
+    CheckLargeAlloc();
+    CheckHeldCredential();
+    CheckScenarios();
+
+    Check(s_cNewArray == s_cDeleteArray, "every block and string is freed");
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
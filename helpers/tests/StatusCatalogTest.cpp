@@ -0,0 +1,301 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Checks the status catalog's keys: that StatusCatalogTable.h matches the
+// entries, that every substatus listed under STATUS_LOGON_FAILURE is also
+// listed under STATUS_ACCOUNT_RESTRICTION and on its own, and that Lookup
+// agrees with a linear scan of the entries, fallback included, for every
+// key and for random statuses that aren't in the catalog.  Then reads a
+// localized catalog file with missing and empty lines, and times Lookup
+// against the linear scan on a mix of hits and misses.  Prints a line per
+// check, and the timings, and returns nonzero if any failed.
+
+#include "StatusCatalog.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STATUS_LOGON_FAILURE        ((LONG)0xC000006D)
+#define STATUS_ACCOUNT_RESTRICTION  ((LONG)0xC000006E)
+#define STATUS_ACCOUNT_DISABLED     ((LONG)0xC0000072)
+
+#define RANDOM_KEYS         1000000
+#define TIMED_KEYS          4096
+#define TIMED_PASSES        1000
+#define LOCALIZED_LINES     10
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, const char* pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static DWORD s_dwRandom = 0x2545F491;
+
+static DWORD NextRandom()
+{
+    s_dwRandom ^= s_dwRandom << 13;
+    s_dwRandom ^= s_dwRandom >> 17;
+    s_dwRandom ^= s_dwRandom << 5;
+    return s_dwRandom;
+}
+
+static double NowNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// What Lookup should return, the slow way.
+static DWORD ScanEntries(LONG ntsStatus, LONG ntsSubstatus)
+{
+    DWORD iFallback = STATUS_CATALOG_NONE;
+    for (DWORD i = 0; i < CStatusCatalog::GetCount(); i++)
+    {
+        const STATUS_CATALOG_ENTRY& entry = CStatusCatalog::GetEntry(i);
+        if (entry.ntsStatus == ntsStatus)
+        {
+            if (entry.ntsSubstatus == ntsSubstatus)
+            {
+                return i;
+            }
+            if (entry.ntsSubstatus == 0)
+            {
+                iFallback = i;
+            }
+        }
+    }
+    return iFallback;
+}
+
+static bool IsListed(LONG ntsStatus, LONG ntsSubstatus)
+{
+    const DWORD iEntry = ScanEntries(ntsStatus, ntsSubstatus);
+    return (iEntry != STATUS_CATALOG_NONE) && (CStatusCatalog::GetEntry(iEntry).ntsSubstatus == ntsSubstatus);
+}
+
+// A key near the catalog's: an error status, often one of the catalog's
+// with a substatus that may or may not be listed under it.
+static void RandomKey(LONG* pntsStatus, LONG* pntsSubstatus)
+{
+    const STATUS_CATALOG_ENTRY& entry = CStatusCatalog::GetEntry(NextRandom() % CStatusCatalog::GetCount());
+    const STATUS_CATALOG_ENTRY& other = CStatusCatalog::GetEntry(NextRandom() % CStatusCatalog::GetCount());
+    switch (NextRandom() % 4)
+    {
+    case 0:
+        *pntsStatus = entry.ntsStatus;
+        *pntsSubstatus = entry.ntsSubstatus;
+        break;
+    case 1:
+        *pntsStatus = entry.ntsStatus;
+        *pntsSubstatus = other.ntsStatus;
+        break;
+    case 2:
+        *pntsStatus = entry.ntsStatus;
+        *pntsSubstatus = (LONG)(0xC0000000 | (NextRandom() & 0xFFFF));
+        break;
+    default:
+        *pntsStatus = (LONG)(0xC0000000 | (NextRandom() & 0xFFFF));
+        *pntsSubstatus = (NextRandom() % 2) ? 0 : (LONG)NextRandom();
+        break;
+    }
+}
+
+static bool WriteLocalized(const char* pszPath)
+{
+    FILE* pFile = fopen(pszPath, "wb");
+    if (!pFile)
+    {
+        return false;
+    }
+
+    // Every other line is translated; the rest are left empty, and the file
+    // stops well short of the catalog.
+    const WCHAR chBom = 0xFEFF;
+    const WCHAR rgchCrLf[] = { '\r', '\n' };
+    fwrite(&chBom, sizeof(chBom), 1, pFile);
+    for (DWORD i = 0; i < LOCALIZED_LINES; i++)
+    {
+        if ((i % 2) == 0)
+        {
+            char szLine[32];
+            int cch = snprintf(szLine, sizeof(szLine), "Nachricht %u", i);
+            for (int j = 0; j < cch; j++)
+            {
+                WCHAR ch = (WCHAR)szLine[j];
+                fwrite(&ch, sizeof(ch), 1, pFile);
+            }
+        }
+        fwrite(rgchCrLf, sizeof(rgchCrLf), 1, pFile);
+    }
+    return (fclose(pFile) == 0);
+}
+
+static bool TextIs(const WCHAR* pch, DWORD cch, const WCHAR* pwzExpected)
+{
+    DWORD cchExpected = 0;
+    while (pwzExpected[cchExpected] != 0)
+    {
+        cchExpected++;
+    }
+    return (cch == cchExpected) && (memcmp(pch, pwzExpected, cch * sizeof(WCHAR)) == 0);
+}
+
+int main()
+{
+    const DWORD cEntries = CStatusCatalog::GetCount();
+    Check(CStatusCatalog::Verify(), "StatusCatalogTable.h matches the entries");
+
+    bool fUnique = true;
+    bool fWellFormed = true;
+    for (DWORD i = 0; i < cEntries; i++)
+    {
+        const STATUS_CATALOG_ENTRY& entry = CStatusCatalog::GetEntry(i);
+        for (DWORD j = i + 1; j < cEntries; j++)
+        {
+            const STATUS_CATALOG_ENTRY& other = CStatusCatalog::GetEntry(j);
+            fUnique = fUnique && ((entry.ntsStatus != other.ntsStatus) || (entry.ntsSubstatus != other.ntsSubstatus));
+        }
+        fWellFormed = fWellFormed && (((DWORD)entry.ntsStatus >> 30) == 3) &&
+            (entry.dwIcon >= STATUS_CATALOG_ICON_ERROR) && (entry.dwIcon <= STATUS_CATALOG_ICON_SUCCESS) &&
+            (entry.pwzMessage != NULL) && (entry.pwzMessage[0] != 0);
+    }
+    printf("      %u entries\n", cEntries);
+    Check(fUnique, "no two entries share a key");
+    Check(fWellFormed, "each entry is an error status with an icon and a message");
+
+    // The substatuses packages report under STATUS_LOGON_FAILURE are also
+    // reported under STATUS_ACCOUNT_RESTRICTION and on their own.
+    bool fCovered = true;
+    DWORD cSubstatuses = 0;
+    for (DWORD i = 0; i < cEntries; i++)
+    {
+        const STATUS_CATALOG_ENTRY& entry = CStatusCatalog::GetEntry(i);
+        if ((entry.ntsStatus == STATUS_LOGON_FAILURE) && (entry.ntsSubstatus != 0))
+        {
+            cSubstatuses++;
+            if (!IsListed(STATUS_ACCOUNT_RESTRICTION, entry.ntsSubstatus) || !IsListed(entry.ntsSubstatus, 0))
+            {
+                printf("      substatus 0x%08X isn't listed everywhere\n", (DWORD)entry.ntsSubstatus);
+                fCovered = false;
+            }
+        }
+    }
+    printf("      %u substatuses under STATUS_LOGON_FAILURE\n", cSubstatuses);
+    Check(fCovered && (cSubstatuses > 0), "each substatus is listed under both statuses and on its own");
+
+    // What the samples' old two-entry tables covered is still covered.
+    Check(IsListed(STATUS_LOGON_FAILURE, 0) && IsListed(STATUS_ACCOUNT_RESTRICTION, STATUS_ACCOUNT_DISABLED),
+        "the samples' old ReportResult keys are listed");
+
+    bool fFound = true;
+    for (DWORD i = 0; i < cEntries; i++)
+    {
+        const STATUS_CATALOG_ENTRY& entry = CStatusCatalog::GetEntry(i);
+        fFound = fFound && (CStatusCatalog::Lookup(entry.ntsStatus, entry.ntsSubstatus) == i);
+    }
+    Check(fFound, "Lookup finds every entry at its own index");
+
+    bool fAgrees = true;
+    DWORD cHits = 0;
+    DWORD cFallbacks = 0;
+    for (DWORD i = 0; fAgrees && (i < RANDOM_KEYS); i++)
+    {
+        LONG ntsStatus;
+        LONG ntsSubstatus;
+        RandomKey(&ntsStatus, &ntsSubstatus);
+        const DWORD iEntry = CStatusCatalog::Lookup(ntsStatus, ntsSubstatus);
+        fAgrees = (iEntry == ScanEntries(ntsStatus, ntsSubstatus));
+        if (iEntry != STATUS_CATALOG_NONE)
+        {
+            cHits++;
+            cFallbacks += (CStatusCatalog::GetEntry(iEntry).ntsSubstatus != ntsSubstatus);
+        }
+    }
+    printf("      %u random keys: %u found, %u of them by falling back to the status\n", RANDOM_KEYS, cHits, cFallbacks);
+    Check(fAgrees, "Lookup agrees with a scan, fallback and misses included");
+
+    // A localized catalog overrides only the lines it has.
+    char szPath[64];
+    snprintf(szPath, sizeof(szPath), "/tmp/StatusCatalogTest.%d.txt", (int)getpid());
+    CStatusCatalog catalog;
+    bool fLocalized = WriteLocalized(szPath) && SUCCEEDED(catalog.Open(szPath));
+    unlink(szPath);
+    for (DWORD i = 0; fLocalized && (i < cEntries); i++)
+    {
+        DWORD cch;
+        const WCHAR* pch = catalog.GetText(i, &cch);
+        if ((i < LOCALIZED_LINES) && ((i % 2) == 0))
+        {
+            char szLine[32];
+            int cchLine = snprintf(szLine, sizeof(szLine), "Nachricht %u", i);
+            fLocalized = (cch == (DWORD)cchLine);
+            for (int j = 0; fLocalized && (j < cchLine); j++)
+            {
+                fLocalized = (pch[j] == (WCHAR)szLine[j]);
+            }
+        }
+        else
+        {
+            fLocalized = TextIs(pch, cch, CStatusCatalog::GetEntry(i).pwzMessage);
+        }
+    }
+    Check(fLocalized, "a localized catalog is used where it has a line, and English elsewhere");
+
+    CStatusCatalog english;
+    const bool fMissing = FAILED(english.Open("/nonexistent/StatusCatalog.txt"));
+    DWORD cch;
+    const WCHAR* pch = english.GetText(0, &cch);
+    Check(fMissing && TextIs(pch, cch, CStatusCatalog::GetEntry(0).pwzMessage),
+        "without a catalog file the English messages are used");
+
+    // Lookup against the scan, on the same mix of hits and misses.
+    static LONG s_rgntsStatus[TIMED_KEYS];
+    static LONG s_rgntsSubstatus[TIMED_KEYS];
+    for (DWORD i = 0; i < TIMED_KEYS; i++)
+    {
+        RandomKey(&s_rgntsStatus[i], &s_rgntsSubstatus[i]);
+    }
+
+    DWORD cLookupMisses = 0;
+    double nsStart = NowNs();
+    for (DWORD j = 0; j < TIMED_PASSES; j++)
+    {
+        for (DWORD i = 0; i < TIMED_KEYS; i++)
+        {
+            cLookupMisses += (CStatusCatalog::Lookup(s_rgntsStatus[i], s_rgntsSubstatus[i]) == STATUS_CATALOG_NONE);
+        }
+    }
+    const double nsLookup = (NowNs() - nsStart) / ((double)TIMED_PASSES * TIMED_KEYS);
+
+    DWORD cScanMisses = 0;
+    nsStart = NowNs();
+    for (DWORD j = 0; j < TIMED_PASSES / 10; j++)
+    {
+        for (DWORD i = 0; i < TIMED_KEYS; i++)
+        {
+            cScanMisses += (ScanEntries(s_rgntsStatus[i], s_rgntsSubstatus[i]) == STATUS_CATALOG_NONE);
+        }
+    }
+    const double nsScan = (NowNs() - nsStart) / ((double)(TIMED_PASSES / 10) * TIMED_KEYS);
+
+    printf("      %u keys, %u of them misses: Lookup %.1f ns, linear scan %.1f ns per key\n",
+        TIMED_KEYS, cLookupMisses / TIMED_PASSES, nsLookup, nsScan);
+    Check(cLookupMisses / TIMED_PASSES == cScanMisses / (TIMED_PASSES / 10), "the timed keys miss as often either way");
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
@@ -0,0 +1,260 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "CallStats.h"
+#include <shlwapi.h>
+
+// Names for the report, in HOST_CALL_ID order.
+static const char* s_rgpszCallName[HCI_NUM_CALLS] =
+{
+    "DllGetClassObject",
+    "CreateInstance",
+    "SetUsageScenario",
+    "Advise",
+    "GetFieldDescriptorCount",
+    "GetFieldDescriptorAt",
+    "GetCredentialCount",
+    "GetCredentialAt",
+    "Credential::Advise",
+    "GetFieldState",
+    "GetStringValue",
+    "GetBitmapValue",
+    "GetCheckboxValue",
+    "GetSubmitButtonValue",
+    "GetComboBoxValueCount",
+    "GetComboBoxValueAt",
+    "SetSelected",
+    "SetStringValue",
+    "GetSerialization",
+    "ReportResult",
+    "SetDeselected",
+    "Credential::UnAdvise",
+    "UnAdvise",
+    "Release",
+};
+
+CAllocationSpy::CAllocationSpy():
+    _cRef(1)
+{
+    ZeroMemory(&_counts, sizeof(_counts));
+}
+
+HRESULT CAllocationSpy::QueryInterface(__in REFIID riid, __deref_out void** ppv)
+{
+    static const QITAB qit[] =
+    {
+        QITABENT(CAllocationSpy, IMallocSpy),
+        {0},
+    };
+    return QISearch(this, qit, riid, ppv);
+}
+
+ULONG CAllocationSpy::AddRef()
+{
+    return InterlockedIncrement(&_cRef);
+}
+
+ULONG CAllocationSpy::Release()
+{
+    LONG cRef = InterlockedDecrement(&_cRef);
+    if (!cRef)
+    {
+        delete this;
+    }
+    return cRef;
+}
+
+SIZE_T CAllocationSpy::PreAlloc(SIZE_T cbRequest)
+{
+    _counts.cAllocs++;
+    _counts.cbAllocated += cbRequest;
+    return cbRequest;
+}
+
+void* CAllocationSpy::PostAlloc(void* pActual)
+{
+    return pActual;
+}
+
+void* CAllocationSpy::PreFree(void* pRequest, BOOL fSpyed)
+{
+    UNREFERENCED_PARAMETER(fSpyed);
+    if (pRequest != NULL)
+    {
+        _counts.cFrees++;
+    }
+    return pRequest;
+}
+
+void CAllocationSpy::PostFree(BOOL fSpyed)
+{
+    UNREFERENCED_PARAMETER(fSpyed);
+}
+
+// A realloc of NULL is an allocation and one to zero bytes is a free, as
+// far as the counts go; anything else moves a block without changing them.
+SIZE_T CAllocationSpy::PreRealloc(void* pRequest, SIZE_T cbRequest, void** ppNewRequest, BOOL fSpyed)
+{
+    UNREFERENCED_PARAMETER(fSpyed);
+    if (pRequest == NULL)
+    {
+        _counts.cAllocs++;
+    }
+    else if (cbRequest == 0)
+    {
+        _counts.cFrees++;
+    }
+    _counts.cbAllocated += cbRequest;
+    *ppNewRequest = pRequest;
+    return cbRequest;
+}
+
+void* CAllocationSpy::PostRealloc(void* pActual, BOOL fSpyed)
+{
+    UNREFERENCED_PARAMETER(fSpyed);
+    return pActual;
+}
+
+void* CAllocationSpy::PreGetSize(void* pRequest, BOOL fSpyed)
+{
+    UNREFERENCED_PARAMETER(fSpyed);
+    return pRequest;
+}
+
+SIZE_T CAllocationSpy::PostGetSize(SIZE_T cbActual, BOOL fSpyed)
+{
+    UNREFERENCED_PARAMETER(fSpyed);
+    return cbActual;
+}
+
+void* CAllocationSpy::PreDidAlloc(void* pRequest, BOOL fSpyed)
+{
+    UNREFERENCED_PARAMETER(fSpyed);
+    return pRequest;
+}
+
+int CAllocationSpy::PostDidAlloc(void* pRequest, BOOL fSpyed, int fActual)
+{
+    UNREFERENCED_PARAMETER(pRequest);
+    UNREFERENCED_PARAMETER(fSpyed);
+    return fActual;
+}
+
+void CAllocationSpy::PreHeapMinimize()
+{
+}
+
+void CAllocationSpy::PostHeapMinimize()
+{
+}
+
+CCallStats::CCallStats(__in_opt CAllocationSpy* pSpy):
+    _pSpy(pSpy)
+{
+    LARGE_INTEGER liFrequency;
+    QueryPerformanceFrequency(&liFrequency);
+    _llFrequency = liFrequency.QuadPart;
+    ZeroMemory(_rgStats, sizeof(_rgStats));
+}
+
+const char* CCallStats::GetCallName(HOST_CALL_ID hci)
+{
+    return s_rgpszCallName[hci];
+}
+
+void CCallStats::_GetCounts(__out ALLOCATION_COUNTS* pCounts)
+{
+    if (_pSpy != NULL)
+    {
+        _pSpy->GetCounts(pCounts);
+    }
+    else
+    {
+        ZeroMemory(pCounts, sizeof(*pCounts));
+    }
+}
+
+void CCallStats::Begin(__out LONGLONG* pllStart, __out ALLOCATION_COUNTS* pCountsStart)
+{
+    _GetCounts(pCountsStart);
+
+    LARGE_INTEGER liStart;
+    QueryPerformanceCounter(&liStart);
+    *pllStart = liStart.QuadPart;
+}
+
+void CCallStats::End(HOST_CALL_ID hci, HRESULT hr, LONGLONG llStart, __in const ALLOCATION_COUNTS* pCountsStart)
+{
+    LARGE_INTEGER liEnd;
+    QueryPerformanceCounter(&liEnd);
+
+    ALLOCATION_COUNTS countsEnd;
+    _GetCounts(&countsEnd);
+
+    CALL_STATS& stats = _rgStats[hci];
+    const LONGLONG llTicks = liEnd.QuadPart - llStart;
+    stats.cCalls++;
+    stats.cFailed += FAILED(hr) ? 1 : 0;
+    stats.llTicks += llTicks;
+    stats.llTicksMax = (llTicks > stats.llTicksMax) ? llTicks : stats.llTicksMax;
+    stats.allocs.cAllocs += countsEnd.cAllocs - pCountsStart->cAllocs;
+    stats.allocs.cFrees += countsEnd.cFrees - pCountsStart->cFrees;
+    stats.allocs.cbAllocated += countsEnd.cbAllocated - pCountsStart->cbAllocated;
+}
+
+void CCallStats::Print(__in FILE* pfile, DWORD cIterations)
+{
+    fprintf(pfile, "%-24s %10s %7s %11s %11s %11s %9s %9s %11s\n",
+            "call", "calls", "failed", "mean ns", "max ns", "total us", "allocs", "frees", "bytes");
+
+    ULONGLONG ullTotalNs = 0;
+    for (DWORD i = 0; i < HCI_NUM_CALLS; i++)
+    {
+        const CALL_STATS& stats = _rgStats[i];
+        if (stats.cCalls != 0)
+        {
+            const ULONGLONG ullNs = TicksToNs(stats.llTicks);
+            const ULONGLONG ullMaxNs = TicksToNs(stats.llTicksMax);
+            ullTotalNs += ullNs;
+            fprintf(pfile, "%-24s %10llu %7llu %11llu %11llu %11llu %9llu %9llu %11llu\n",
+                    GetCallName((HOST_CALL_ID)i),
+                    stats.cCalls,
+                    stats.cFailed,
+                    ullNs / stats.cCalls,
+                    ullMaxNs,
+                    ullNs / 1000,
+                    stats.allocs.cAllocs,
+                    stats.allocs.cFrees,
+                    stats.allocs.cbAllocated);
+        }
+    }
+
+    ALLOCATION_COUNTS counts;
+    _GetCounts(&counts);
+    fprintf(pfile, "\n%u iterations, %llu us in the provider, %llu us per iteration\n",
+            cIterations, ullTotalNs / 1000, cIterations ? ullTotalNs / 1000 / cIterations : 0);
+    fprintf(pfile, "task allocator: %llu allocs, %llu frees, %llu bytes, %lld outstanding\n",
+            counts.cAllocs, counts.cFrees, counts.cbAllocated, (LONGLONG)(counts.cAllocs - counts.cFrees));
+}
+
+void CCallStats::Add(__in const CCallStats* pOther)
+{
+    for (DWORD i = 0; i < HCI_NUM_CALLS; i++)
+    {
+        CALL_STATS& stats = _rgStats[i];
+        const CALL_STATS& other = pOther->_rgStats[i];
+        stats.cCalls += other.cCalls;
+        stats.cFailed += other.cFailed;
+        stats.llTicks += other.llTicks;
+        stats.llTicksMax = (other.llTicksMax > stats.llTicksMax) ? other.llTicksMax : stats.llTicksMax;
+        stats.allocs.cAllocs += other.allocs.cAllocs;
+        stats.allocs.cFrees += other.allocs.cFrees;
+        stats.allocs.cbAllocated += other.allocs.cbAllocated;
+    }
+}
@@ -0,0 +1,176 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// What the host measures about each call it makes into a provider: how many
+// times it was made, how long it took, and how many CoTaskMem blocks the
+// provider allocated and freed during it.
+//
+// The allocations are counted by an IMallocSpy, so only the task allocator
+// is seen; that is what a provider hands strings and serializations back in,
+// and what LogonUI has to free.  Blocks allocated and never freed by the end
+// of a run are reported as outstanding, which is how a leak of a returned
+// string or of a credential shows up.
+
+#pragma once
+
+#include <windows.h>
+#include <stdio.h>
+
+// The calls the host times, in the order it makes them.
+enum HOST_CALL_ID
+{
+    HCI_DLLGETCLASSOBJECT = 0,
+    HCI_CREATEINSTANCE,
+    HCI_SETUSAGESCENARIO,
+    HCI_ADVISE,
+    HCI_GETFIELDDESCRIPTORCOUNT,
+    HCI_GETFIELDDESCRIPTORAT,
+    HCI_GETCREDENTIALCOUNT,
+    HCI_GETCREDENTIALAT,
+    HCI_CREDENTIAL_ADVISE,
+    HCI_GETFIELDSTATE,
+    HCI_GETSTRINGVALUE,
+    HCI_GETBITMAPVALUE,
+    HCI_GETCHECKBOXVALUE,
+    HCI_GETSUBMITBUTTONVALUE,
+    HCI_GETCOMBOBOXVALUECOUNT,
+    HCI_GETCOMBOBOXVALUEAT,
+    HCI_SETSELECTED,
+    HCI_SETSTRINGVALUE,
+    HCI_GETSERIALIZATION,
+    HCI_REPORTRESULT,
+    HCI_SETDESELECTED,
+    HCI_CREDENTIAL_UNADVISE,
+    HCI_UNADVISE,
+    HCI_RELEASE,
+    HCI_NUM_CALLS,      // Keep last.
+};
+
+struct ALLOCATION_COUNTS
+{
+    ULONGLONG   cAllocs;
+    ULONGLONG   cFrees;
+    ULONGLONG   cbAllocated;
+};
+
+struct CALL_STATS
+{
+    ULONGLONG           cCalls;
+    ULONGLONG           cFailed;
+    LONGLONG            llTicks;        // Total, in QueryPerformanceCounter ticks.
+    LONGLONG            llTicksMax;
+    ALLOCATION_COUNTS   allocs;
+};
+
+// Counts the task allocator's allocations while it's registered.  The host
+// is the only caller while a call is timed, so the counts between two
+// snapshots are the provider's.
+class CAllocationSpy : public IMallocSpy
+{
+  public:
+    CAllocationSpy();
+
+    // IUnknown
+    IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv);
+    IFACEMETHODIMP_(ULONG) AddRef();
+    IFACEMETHODIMP_(ULONG) Release();
+
+    // IMallocSpy
+    IFACEMETHODIMP_(SIZE_T) PreAlloc(SIZE_T cbRequest);
+    IFACEMETHODIMP_(void*) PostAlloc(void* pActual);
+    IFACEMETHODIMP_(void*) PreFree(void* pRequest, BOOL fSpyed);
+    IFACEMETHODIMP_(void) PostFree(BOOL fSpyed);
+    IFACEMETHODIMP_(SIZE_T) PreRealloc(void* pRequest, SIZE_T cbRequest, void** ppNewRequest, BOOL fSpyed);
+    IFACEMETHODIMP_(void*) PostRealloc(void* pActual, BOOL fSpyed);
+    IFACEMETHODIMP_(void*) PreGetSize(void* pRequest, BOOL fSpyed);
+    IFACEMETHODIMP_(SIZE_T) PostGetSize(SIZE_T cbActual, BOOL fSpyed);
+    IFACEMETHODIMP_(void*) PreDidAlloc(void* pRequest, BOOL fSpyed);
+    IFACEMETHODIMP_(int) PostDidAlloc(void* pRequest, BOOL fSpyed, int fActual);
+    IFACEMETHODIMP_(void) PreHeapMinimize();
+    IFACEMETHODIMP_(void) PostHeapMinimize();
+
+    void GetCounts(__out ALLOCATION_COUNTS* pCounts)
+    {
+        *pCounts = _counts;
+    }
+
+  private:
+    virtual ~CAllocationSpy()
+    {
+    }
+
+    LONG                _cRef;
+    ALLOCATION_COUNTS   _counts;
+};
+
+class CCallStats
+{
+  public:
+    // pSpy may be NULL, leaving the allocation counts at zero; the spy's
+    // counts aren't per thread, so a host running several threads has none.
+    CCallStats(__in_opt CAllocationSpy* pSpy);
+
+    // Starts timing a call, snapshotting the allocation counts.
+    void Begin(__out LONGLONG* pllStart, __out ALLOCATION_COUNTS* pCountsStart);
+
+    // Charges the time and allocations since Begin to a call.
+    void End(HOST_CALL_ID hci, HRESULT hr, LONGLONG llStart, __in const ALLOCATION_COUNTS* pCountsStart);
+
+    // Prints a line per call made, then the allocations still outstanding.
+    void Print(__in FILE* pfile, DWORD cIterations);
+
+    // Adds another thread's stats to these.
+    void Add(__in const CCallStats* pOther);
+
+    const CALL_STATS* GetCallStats(HOST_CALL_ID hci) const
+    {
+        return &_rgStats[hci];
+    }
+
+    // Converts ticks to nanoseconds.
+    ULONGLONG TicksToNs(LONGLONG llTicks) const
+    {
+        return (ULONGLONG)(llTicks * 1e9 / _llFrequency);
+    }
+
+    static const char* GetCallName(HOST_CALL_ID hci);
+
+  private:
+    void _GetCounts(__out ALLOCATION_COUNTS* pCounts);
+
+    CAllocationSpy*     _pSpy;
+    LONGLONG            _llFrequency;
+    CALL_STATS          _rgStats[HCI_NUM_CALLS];
+};
+
+// Times one call from construction to Stop, for example:
+//
+//     CCallTimer timer(&stats, HCI_GETFIELDSTATE);
+//     hr = pcpc->GetFieldState(dwFieldID, &cpfs, &cpfis);
+//     timer.Stop(hr);
+class CCallTimer
+{
+  public:
+    CCallTimer(__in CCallStats* pStats, HOST_CALL_ID hci):
+        _pStats(pStats),
+        _hci(hci)
+    {
+        _pStats->Begin(&_llStart, &_countsStart);
+    }
+
+    void Stop(HRESULT hr)
+    {
+        _pStats->End(_hci, hr, _llStart, &_countsStart);
+    }
+
+  private:
+    CCallStats*         _pStats;
+    HOST_CALL_ID        _hci;
+    LONGLONG            _llStart;
+    ALLOCATION_COUNTS   _countsStart;
+};
@@ -0,0 +1,201 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "HostEvents.h"
+#include <shlwapi.h>
+
+// Names for the report, in HOST_EVENT_ID order.
+static const char* s_rgpszEventName[HEI_NUM_EVENTS] =
+{
+    "CredentialsChanged",
+    "SetFieldState",
+    "SetFieldInteractiveState",
+    "SetFieldString",
+    "SetFieldCheckbox",
+    "SetFieldBitmap",
+    "SetFieldComboBoxSelectedItem",
+    "DeleteFieldComboBoxItem",
+    "AppendFieldComboBoxItem",
+    "SetFieldSubmitButton",
+    "OnCreatingWindow",
+};
+
+void CHostEventCounts::Print(__in FILE* pfile)
+{
+    fprintf(pfile, "%-30s %10s\n", "event", "count");
+    for (DWORD i = 0; i < HEI_NUM_EVENTS; i++)
+    {
+        if (_rgcEvents[i] != 0)
+        {
+            fprintf(pfile, "%-30s %10llu\n", s_rgpszEventName[i], _rgcEvents[i]);
+        }
+    }
+}
+
+CHostProviderEvents::CHostProviderEvents(__in CHostEventCounts* pCounts):
+    _cRef(1),
+    _pCounts(pCounts)
+{
+}
+
+HRESULT CHostProviderEvents::QueryInterface(__in REFIID riid, __deref_out void** ppv)
+{
+    static const QITAB qit[] =
+    {
+        QITABENT(CHostProviderEvents, ICredentialProviderEvents),
+        {0},
+    };
+    return QISearch(this, qit, riid, ppv);
+}
+
+ULONG CHostProviderEvents::AddRef()
+{
+    return InterlockedIncrement(&_cRef);
+}
+
+ULONG CHostProviderEvents::Release()
+{
+    LONG cRef = InterlockedDecrement(&_cRef);
+    if (!cRef)
+    {
+        delete this;
+    }
+    return cRef;
+}
+
+// LogonUI would enumerate the credentials again; the host picks that up at
+// its next iteration.
+HRESULT CHostProviderEvents::CredentialsChanged(UINT_PTR upAdviseContext)
+{
+    UNREFERENCED_PARAMETER(upAdviseContext);
+    _pCounts->Count(HEI_CREDENTIALSCHANGED);
+    return S_OK;
+}
+
+CHostCredentialEvents::CHostCredentialEvents(__in CHostEventCounts* pCounts):
+    _cRef(1),
+    _pCounts(pCounts)
+{
+}
+
+HRESULT CHostCredentialEvents::QueryInterface(__in REFIID riid, __deref_out void** ppv)
+{
+    static const QITAB qit[] =
+    {
+        QITABENT(CHostCredentialEvents, ICredentialProviderCredentialEvents),
+        {0},
+    };
+    return QISearch(this, qit, riid, ppv);
+}
+
+ULONG CHostCredentialEvents::AddRef()
+{
+    return InterlockedIncrement(&_cRef);
+}
+
+ULONG CHostCredentialEvents::Release()
+{
+    LONG cRef = InterlockedDecrement(&_cRef);
+    if (!cRef)
+    {
+        delete this;
+    }
+    return cRef;
+}
+
+HRESULT CHostCredentialEvents::SetFieldState(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_STATE cpfs)
+{
+    UNREFERENCED_PARAMETER(pcpc);
+    UNREFERENCED_PARAMETER(dwFieldID);
+    UNREFERENCED_PARAMETER(cpfs);
+    _pCounts->Count(HEI_SETFIELDSTATE);
+    return S_OK;
+}
+
+HRESULT CHostCredentialEvents::SetFieldInteractiveState(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis)
+{
+    UNREFERENCED_PARAMETER(pcpc);
+    UNREFERENCED_PARAMETER(dwFieldID);
+    UNREFERENCED_PARAMETER(cpfis);
+    _pCounts->Count(HEI_SETFIELDINTERACTIVESTATE);
+    return S_OK;
+}
+
+HRESULT CHostCredentialEvents::SetFieldString(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, __in LPCWSTR psz)
+{
+    UNREFERENCED_PARAMETER(pcpc);
+    UNREFERENCED_PARAMETER(dwFieldID);
+    UNREFERENCED_PARAMETER(psz);
+    _pCounts->Count(HEI_SETFIELDSTRING);
+    return S_OK;
+}
+
+HRESULT CHostCredentialEvents::SetFieldCheckbox(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, BOOL bChecked, __in LPCWSTR pszLabel)
+{
+    UNREFERENCED_PARAMETER(pcpc);
+    UNREFERENCED_PARAMETER(dwFieldID);
+    UNREFERENCED_PARAMETER(bChecked);
+    UNREFERENCED_PARAMETER(pszLabel);
+    _pCounts->Count(HEI_SETFIELDCHECKBOX);
+    return S_OK;
+}
+
+HRESULT CHostCredentialEvents::SetFieldBitmap(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, __in HBITMAP hbmp)
+{
+    UNREFERENCED_PARAMETER(pcpc);
+    UNREFERENCED_PARAMETER(dwFieldID);
+    UNREFERENCED_PARAMETER(hbmp);
+    _pCounts->Count(HEI_SETFIELDBITMAP);
+    return S_OK;
+}
+
+HRESULT CHostCredentialEvents::SetFieldComboBoxSelectedItem(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, DWORD dwSelectedItem)
+{
+    UNREFERENCED_PARAMETER(pcpc);
+    UNREFERENCED_PARAMETER(dwFieldID);
+    UNREFERENCED_PARAMETER(dwSelectedItem);
+    _pCounts->Count(HEI_SETFIELDCOMBOBOXSELECTEDITEM);
+    return S_OK;
+}
+
+HRESULT CHostCredentialEvents::DeleteFieldComboBoxItem(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, DWORD dwItem)
+{
+    UNREFERENCED_PARAMETER(pcpc);
+    UNREFERENCED_PARAMETER(dwFieldID);
+    UNREFERENCED_PARAMETER(dwItem);
+    _pCounts->Count(HEI_DELETEFIELDCOMBOBOXITEM);
+    return S_OK;
+}
+
+HRESULT CHostCredentialEvents::AppendFieldComboBoxItem(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, __in LPCWSTR pszItem)
+{
+    UNREFERENCED_PARAMETER(pcpc);
+    UNREFERENCED_PARAMETER(dwFieldID);
+    UNREFERENCED_PARAMETER(pszItem);
+    _pCounts->Count(HEI_APPENDFIELDCOMBOBOXITEM);
+    return S_OK;
+}
+
+HRESULT CHostCredentialEvents::SetFieldSubmitButton(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, DWORD dwAdjacentTo)
+{
+    UNREFERENCED_PARAMETER(pcpc);
+    UNREFERENCED_PARAMETER(dwFieldID);
+    UNREFERENCED_PARAMETER(dwAdjacentTo);
+    _pCounts->Count(HEI_SETFIELDSUBMITBUTTON);
+    return S_OK;
+}
+
+// There's no window to parent anything to, so a provider that wants one
+// gets NULL, as it would under a LogonUI with no tile showing.
+HRESULT CHostCredentialEvents::OnCreatingWindow(__out HWND* phwndOwner)
+{
+    _pCounts->Count(HEI_ONCREATINGWINDOW);
+    *phwndOwner = NULL;
+    return S_OK;
+}
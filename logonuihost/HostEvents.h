@@ -0,0 +1,117 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The event sinks the host advises providers and credentials with.  Where
+// LogonUI would redraw a tile, these just count what they were told, so a
+// run shows how chatty a provider is; a credential that sends a state it
+// already reported costs LogonUI a redraw for nothing.
+
+#pragma once
+
+#include <windows.h>
+#include <credentialprovider.h>
+#include <stdio.h>
+
+enum HOST_EVENT_ID
+{
+    HEI_CREDENTIALSCHANGED = 0,
+    HEI_SETFIELDSTATE,
+    HEI_SETFIELDINTERACTIVESTATE,
+    HEI_SETFIELDSTRING,
+    HEI_SETFIELDCHECKBOX,
+    HEI_SETFIELDBITMAP,
+    HEI_SETFIELDCOMBOBOXSELECTEDITEM,
+    HEI_DELETEFIELDCOMBOBOXITEM,
+    HEI_APPENDFIELDCOMBOBOXITEM,
+    HEI_SETFIELDSUBMITBUTTON,
+    HEI_ONCREATINGWINDOW,
+    HEI_NUM_EVENTS,     // Keep last.
+};
+
+// Shared by both sinks, so the counts cover the whole run.
+class CHostEventCounts
+{
+  public:
+    CHostEventCounts()
+    {
+        ZeroMemory(_rgcEvents, sizeof(_rgcEvents));
+    }
+
+    void Count(HOST_EVENT_ID hei)
+    {
+        _rgcEvents[hei]++;
+    }
+
+    // Prints a line per event received.
+    void Print(__in FILE* pfile);
+
+    // Adds another thread's counts to these.
+    void Add(__in const CHostEventCounts* pOther)
+    {
+        for (DWORD i = 0; i < HEI_NUM_EVENTS; i++)
+        {
+            _rgcEvents[i] += pOther->_rgcEvents[i];
+        }
+    }
+
+  private:
+    ULONGLONG   _rgcEvents[HEI_NUM_EVENTS];
+};
+
+class CHostProviderEvents : public ICredentialProviderEvents
+{
+  public:
+    CHostProviderEvents(__in CHostEventCounts* pCounts);
+
+    // IUnknown
+    IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv);
+    IFACEMETHODIMP_(ULONG) AddRef();
+    IFACEMETHODIMP_(ULONG) Release();
+
+    // ICredentialProviderEvents
+    IFACEMETHODIMP CredentialsChanged(UINT_PTR upAdviseContext);
+
+  private:
+    virtual ~CHostProviderEvents()
+    {
+    }
+
+    LONG                _cRef;
+    CHostEventCounts*   _pCounts;
+};
+
+class CHostCredentialEvents : public ICredentialProviderCredentialEvents
+{
+  public:
+    CHostCredentialEvents(__in CHostEventCounts* pCounts);
+
+    // IUnknown
+    IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv);
+    IFACEMETHODIMP_(ULONG) AddRef();
+    IFACEMETHODIMP_(ULONG) Release();
+
+    // ICredentialProviderCredentialEvents
+    IFACEMETHODIMP SetFieldState(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_STATE cpfs);
+    IFACEMETHODIMP SetFieldInteractiveState(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis);
+    IFACEMETHODIMP SetFieldString(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, __in LPCWSTR psz);
+    IFACEMETHODIMP SetFieldCheckbox(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, BOOL bChecked, __in LPCWSTR pszLabel);
+    IFACEMETHODIMP SetFieldBitmap(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, __in HBITMAP hbmp);
+    IFACEMETHODIMP SetFieldComboBoxSelectedItem(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, DWORD dwSelectedItem);
+    IFACEMETHODIMP DeleteFieldComboBoxItem(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, DWORD dwItem);
+    IFACEMETHODIMP AppendFieldComboBoxItem(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, __in LPCWSTR pszItem);
+    IFACEMETHODIMP SetFieldSubmitButton(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, DWORD dwAdjacentTo);
+    IFACEMETHODIMP OnCreatingWindow(__out HWND* phwndOwner);
+
+  private:
+    virtual ~CHostCredentialEvents()
+    {
+    }
+
+    LONG                _cRef;
+    CHostEventCounts*   _pCounts;
+};
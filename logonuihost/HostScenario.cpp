@@ -0,0 +1,427 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#ifndef WIN32_NO_STATUS
+#include <ntstatus.h>
+#define WIN32_NO_STATUS
+#endif
+#include "HostScenario.h"
+#include <strsafe.h>
+#include <stdio.h>
+#include <string.h>
+
+// LogonUI doesn't limit this, but no sample comes near it.
+#define HOST_FIELDS_MAX     32
+
+// The field types, in field ID order, from the descriptors.
+struct HOST_FIELDS
+{
+    DWORD                               cFields;
+    CREDENTIAL_PROVIDER_FIELD_TYPE      rgcpft[HOST_FIELDS_MAX];
+};
+
+const char c_szHostScenarioUsage[] =
+    "  -scenario logon|unlock|changepassword|credui   (default logon)\n"
+    "  -user <name>                                   (default user)\n"
+    "  -password <password>                           (default password)\n"
+    "  -fail                                          report a failed logon\n";
+
+void HostWiden(__in const char* psz, __out_ecount(cch) WCHAR* pwz, size_t cch)
+{
+    size_t i = 0;
+    for (; (psz[i] != 0) && (i + 1 < cch); i++)
+    {
+        pwz[i] = (WCHAR)(unsigned char)psz[i];
+    }
+    pwz[i] = 0;
+}
+
+void HostInitScenario(__out HOST_SCENARIO* pScenario)
+{
+    ZeroMemory(pScenario, sizeof(*pScenario));
+    pScenario->cpus = CPUS_LOGON;
+    pScenario->ntsResult = STATUS_SUCCESS;
+    HostWiden("user", pScenario->wszUser, ARRAYSIZE(pScenario->wszUser));
+    HostWiden("password", pScenario->wszPassword, ARRAYSIZE(pScenario->wszPassword));
+}
+
+HRESULT HostParseScenarioOption(int argc, __in_ecount(argc) char* argv[], __inout int* pi, __inout HOST_SCENARIO* pScenario)
+{
+    HRESULT hr = S_OK;
+    const char* pszOption = argv[*pi];
+    const bool fValue = (*pi + 1 < argc);
+    if (!strcmp(pszOption, "-scenario") && fValue)
+    {
+        const char* pszScenario = argv[++*pi];
+        if (!strcmp(pszScenario, "logon"))
+        {
+            pScenario->cpus = CPUS_LOGON;
+        }
+        else if (!strcmp(pszScenario, "unlock"))
+        {
+            pScenario->cpus = CPUS_UNLOCK_WORKSTATION;
+        }
+        else if (!strcmp(pszScenario, "changepassword"))
+        {
+            pScenario->cpus = CPUS_CHANGE_PASSWORD;
+        }
+        else if (!strcmp(pszScenario, "credui"))
+        {
+            pScenario->cpus = CPUS_CREDUI;
+        }
+        else
+        {
+            hr = E_INVALIDARG;
+        }
+    }
+    else if (!strcmp(pszOption, "-user") && fValue)
+    {
+        HostWiden(argv[++*pi], pScenario->wszUser, ARRAYSIZE(pScenario->wszUser));
+    }
+    else if (!strcmp(pszOption, "-password") && fValue)
+    {
+        HostWiden(argv[++*pi], pScenario->wszPassword, ARRAYSIZE(pScenario->wszPassword));
+    }
+    else if (!strcmp(pszOption, "-fail"))
+    {
+        pScenario->ntsResult = STATUS_LOGON_FAILURE;
+    }
+    else
+    {
+        hr = S_FALSE;
+    }
+    return hr;
+}
+
+HRESULT HostCreateProvider(__in PFN_DLLGETCLASSOBJECT pfnDllGetClassObject, __in REFCLSID rclsid, __in CCallStats* pStats,
+                           __deref_out ICredentialProvider** ppcp)
+{
+    *ppcp = NULL;
+
+    IClassFactory* pcf = NULL;
+    CCallTimer timer(pStats, HCI_DLLGETCLASSOBJECT);
+    HRESULT hr = pfnDllGetClassObject(rclsid, IID_IClassFactory, (void**)&pcf);
+    timer.Stop(hr);
+    if (SUCCEEDED(hr))
+    {
+        CCallTimer timerCreate(pStats, HCI_CREATEINSTANCE);
+        hr = pcf->CreateInstance(NULL, IID_ICredentialProvider, (void**)ppcp);
+        timerCreate.Stop(hr);
+        pcf->Release();
+    }
+    return hr;
+}
+
+static HRESULT _GetFields(__in ICredentialProvider* pcp, __in CCallStats* pStats, __out HOST_FIELDS* pFields)
+{
+    ZeroMemory(pFields, sizeof(*pFields));
+
+    DWORD cFields = 0;
+    CCallTimer timer(pStats, HCI_GETFIELDDESCRIPTORCOUNT);
+    HRESULT hr = pcp->GetFieldDescriptorCount(&cFields);
+    timer.Stop(hr);
+    if (SUCCEEDED(hr))
+    {
+        hr = (cFields <= HOST_FIELDS_MAX) ? S_OK : E_UNEXPECTED;
+    }
+
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < cFields); i++)
+    {
+        CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR* pcpfd = NULL;
+        CCallTimer timerAt(pStats, HCI_GETFIELDDESCRIPTORAT);
+        hr = pcp->GetFieldDescriptorAt(i, &pcpfd);
+        timerAt.Stop(hr);
+        if (SUCCEEDED(hr))
+        {
+            hr = (pcpfd->dwFieldID < HOST_FIELDS_MAX) ? S_OK : E_UNEXPECTED;
+            if (SUCCEEDED(hr))
+            {
+                pFields->rgcpft[pcpfd->dwFieldID] = pcpfd->cpft;
+            }
+            CoTaskMemFree(pcpfd->pszLabel);
+            CoTaskMemFree(pcpfd);
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        pFields->cFields = cFields;
+    }
+    return hr;
+}
+
+// Reads every field the way LogonUI does when it draws a tile, freeing what
+// comes back as LogonUI would.
+static HRESULT _ReadFields(__in ICredentialProviderCredential* pcpc, __in const HOST_FIELDS* pFields, __in CCallStats* pStats)
+{
+    HRESULT hr = S_OK;
+    for (DWORD dwFieldID = 0; SUCCEEDED(hr) && (dwFieldID < pFields->cFields); dwFieldID++)
+    {
+        CREDENTIAL_PROVIDER_FIELD_STATE cpfs;
+        CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis;
+        CCallTimer timerState(pStats, HCI_GETFIELDSTATE);
+        hr = pcpc->GetFieldState(dwFieldID, &cpfs, &cpfis);
+        timerState.Stop(hr);
+
+        if (SUCCEEDED(hr))
+        {
+            switch (pFields->rgcpft[dwFieldID])
+            {
+            case CPFT_LARGE_TEXT:
+            case CPFT_SMALL_TEXT:
+            case CPFT_COMMAND_LINK:
+            case CPFT_EDIT_TEXT:
+            case CPFT_PASSWORD_TEXT:
+                {
+                    PWSTR psz = NULL;
+                    CCallTimer timer(pStats, HCI_GETSTRINGVALUE);
+                    hr = pcpc->GetStringValue(dwFieldID, &psz);
+                    timer.Stop(hr);
+                    CoTaskMemFree(psz);
+                }
+                break;
+
+            case CPFT_TILE_IMAGE:
+                {
+                    HBITMAP hbmp = NULL;
+                    CCallTimer timer(pStats, HCI_GETBITMAPVALUE);
+                    hr = pcpc->GetBitmapValue(dwFieldID, &hbmp);
+                    timer.Stop(hr);
+                    if (hbmp != NULL)
+                    {
+                        DeleteObject(hbmp);
+                    }
+                }
+                break;
+
+            case CPFT_CHECKBOX:
+                {
+                    BOOL bChecked;
+                    PWSTR pszLabel = NULL;
+                    CCallTimer timer(pStats, HCI_GETCHECKBOXVALUE);
+                    hr = pcpc->GetCheckboxValue(dwFieldID, &bChecked, &pszLabel);
+                    timer.Stop(hr);
+                    CoTaskMemFree(pszLabel);
+                }
+                break;
+
+            case CPFT_SUBMIT_BUTTON:
+                {
+                    DWORD dwAdjacentTo;
+                    CCallTimer timer(pStats, HCI_GETSUBMITBUTTONVALUE);
+                    hr = pcpc->GetSubmitButtonValue(dwFieldID, &dwAdjacentTo);
+                    timer.Stop(hr);
+                }
+                break;
+
+            case CPFT_COMBOBOX:
+                {
+                    DWORD cItems = 0;
+                    DWORD dwSelectedItem;
+                    CCallTimer timer(pStats, HCI_GETCOMBOBOXVALUECOUNT);
+                    hr = pcpc->GetComboBoxValueCount(dwFieldID, &cItems, &dwSelectedItem);
+                    timer.Stop(hr);
+                    for (DWORD dwItem = 0; SUCCEEDED(hr) && (dwItem < cItems); dwItem++)
+                    {
+                        PWSTR pszItem = NULL;
+                        CCallTimer timerAt(pStats, HCI_GETCOMBOBOXVALUEAT);
+                        hr = pcpc->GetComboBoxValueAt(dwFieldID, dwItem, &pszItem);
+                        timerAt.Stop(hr);
+                        CoTaskMemFree(pszItem);
+                    }
+                }
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+    return hr;
+}
+
+// Sends the string one more character at a time, as LogonUI does as each key
+// is pressed.
+static HRESULT _TypeString(__in ICredentialProviderCredential* pcpc, DWORD dwFieldID, __in PCWSTR pwz, __in CCallStats* pStats)
+{
+    WCHAR wszTyped[HOST_STRING_CCH];
+    HRESULT hr = S_OK;
+    for (size_t cch = 1; SUCCEEDED(hr) && (pwz[cch - 1] != 0) && (cch < ARRAYSIZE(wszTyped)); cch++)
+    {
+        hr = StringCchCopyNW(wszTyped, ARRAYSIZE(wszTyped), pwz, cch);
+        if (SUCCEEDED(hr))
+        {
+            CCallTimer timer(pStats, HCI_SETSTRINGVALUE);
+            hr = pcpc->SetStringValue(dwFieldID, wszTyped);
+            timer.Stop(hr);
+        }
+    }
+    SecureZeroMemory(wszTyped, sizeof(wszTyped));
+    return hr;
+}
+
+// Selects the credential, fills in the first edit field and the first
+// password field it has, submits it and reports how the logon went.
+static HRESULT _Submit(__in ICredentialProviderCredential* pcpc, __in const HOST_FIELDS* pFields, __in const HOST_SCENARIO* pScenario,
+                       __in CCallStats* pStats, bool fVerbose)
+{
+    BOOL bAutoLogon = FALSE;
+    CCallTimer timerSelected(pStats, HCI_SETSELECTED);
+    HRESULT hr = pcpc->SetSelected(&bAutoLogon);
+    timerSelected.Stop(hr);
+
+    bool fUser = false;
+    bool fPassword = false;
+    for (DWORD dwFieldID = 0; SUCCEEDED(hr) && (dwFieldID < pFields->cFields); dwFieldID++)
+    {
+        if ((pFields->rgcpft[dwFieldID] == CPFT_EDIT_TEXT) && !fUser)
+        {
+            hr = _TypeString(pcpc, dwFieldID, pScenario->wszUser, pStats);
+            fUser = true;
+        }
+        else if ((pFields->rgcpft[dwFieldID] == CPFT_PASSWORD_TEXT) && !fPassword)
+        {
+            hr = _TypeString(pcpc, dwFieldID, pScenario->wszPassword, pStats);
+            fPassword = true;
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        CREDENTIAL_PROVIDER_GET_SERIALIZATION_RESPONSE cpgsr = CPGSR_NO_CREDENTIAL_NOT_FINISHED;
+        CREDENTIAL_PROVIDER_CREDENTIAL_SERIALIZATION cpcs;
+        PWSTR pszStatus = NULL;
+        CREDENTIAL_PROVIDER_STATUS_ICON cpsi = CPSI_NONE;
+        ZeroMemory(&cpcs, sizeof(cpcs));
+
+        CCallTimer timer(pStats, HCI_GETSERIALIZATION);
+        hr = pcpc->GetSerialization(&cpgsr, &cpcs, &pszStatus, &cpsi);
+        timer.Stop(hr);
+        if (fVerbose)
+        {
+            printf("GetSerialization: hr 0x%08X, response %d, package %u, %u bytes\n",
+                   (unsigned int)hr, (int)cpgsr, (unsigned int)cpcs.ulAuthenticationPackage, (unsigned int)cpcs.cbSerialization);
+        }
+        if (cpcs.rgbSerialization != NULL)
+        {
+            SecureZeroMemory(cpcs.rgbSerialization, cpcs.cbSerialization);
+            CoTaskMemFree(cpcs.rgbSerialization);
+        }
+        CoTaskMemFree(pszStatus);
+
+        // LogonUI only reports back once it has tried the credential.
+        if (SUCCEEDED(hr) && (cpgsr == CPGSR_RETURN_CREDENTIAL_FINISHED))
+        {
+            pszStatus = NULL;
+            CCallTimer timerResult(pStats, HCI_REPORTRESULT);
+            hr = pcpc->ReportResult(pScenario->ntsResult, STATUS_SUCCESS, &pszStatus, &cpsi);
+            timerResult.Stop(hr);
+            CoTaskMemFree(pszStatus);
+        }
+    }
+
+    CCallTimer timerDeselected(pStats, HCI_SETDESELECTED);
+    HRESULT hrDeselected = pcpc->SetDeselected();
+    timerDeselected.Stop(hrDeselected);
+    return SUCCEEDED(hr) ? hrDeselected : hr;
+}
+
+// One scenario from start to finish: the provider is told the scenario,
+// every credential is read, and the default one is submitted.
+HRESULT HostRunScenario(__in ICredentialProvider* pcp, __in const HOST_SCENARIO* pScenario, __in CCallStats* pStats,
+                        __in CHostEventCounts* pCounts, bool fVerbose)
+{
+    CCallTimer timerScenario(pStats, HCI_SETUSAGESCENARIO);
+    HRESULT hr = pcp->SetUsageScenario(pScenario->cpus, 0);
+    timerScenario.Stop(hr);
+
+    // A provider that never changes its credentials needn't take events, so
+    // failing Advise isn't an error; it just isn't UnAdvised.
+    CHostProviderEvents* pcpe = NULL;
+    bool fAdvised = false;
+    if (SUCCEEDED(hr))
+    {
+        pcpe = new CHostProviderEvents(pCounts);
+        hr = pcpe ? S_OK : E_OUTOFMEMORY;
+    }
+    if (SUCCEEDED(hr))
+    {
+        CCallTimer timer(pStats, HCI_ADVISE);
+        HRESULT hrAdvise = pcp->Advise(pcpe, 0);
+        timer.Stop(hrAdvise);
+        fAdvised = SUCCEEDED(hrAdvise);
+    }
+
+    HOST_FIELDS fields;
+    if (SUCCEEDED(hr))
+    {
+        hr = _GetFields(pcp, pStats, &fields);
+    }
+
+    DWORD cCredentials = 0;
+    DWORD dwDefault = CREDENTIAL_PROVIDER_NO_DEFAULT;
+    BOOL bAutoLogonWithDefault = FALSE;
+    if (SUCCEEDED(hr))
+    {
+        CCallTimer timer(pStats, HCI_GETCREDENTIALCOUNT);
+        hr = pcp->GetCredentialCount(&cCredentials, &dwDefault, &bAutoLogonWithDefault);
+        timer.Stop(hr);
+    }
+    if (SUCCEEDED(hr) && fVerbose)
+    {
+        printf("%u fields, %u credentials, default %d\n", (unsigned int)fields.cFields, (unsigned int)cCredentials, (int)dwDefault);
+    }
+
+    // With no default LogonUI would wait for a click; the host picks the first.
+    const DWORD dwSubmit = (dwDefault != CREDENTIAL_PROVIDER_NO_DEFAULT) ? dwDefault : 0;
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < cCredentials); i++)
+    {
+        ICredentialProviderCredential* pcpc = NULL;
+        CCallTimer timer(pStats, HCI_GETCREDENTIALAT);
+        hr = pcp->GetCredentialAt(i, &pcpc);
+        timer.Stop(hr);
+        if (SUCCEEDED(hr))
+        {
+            CHostCredentialEvents* pcpce = new CHostCredentialEvents(pCounts);
+            hr = pcpce ? S_OK : E_OUTOFMEMORY;
+            if (SUCCEEDED(hr))
+            {
+                CCallTimer timerAdvise(pStats, HCI_CREDENTIAL_ADVISE);
+                hr = pcpc->Advise(pcpce);
+                timerAdvise.Stop(hr);
+                if (SUCCEEDED(hr))
+                {
+                    hr = _ReadFields(pcpc, &fields, pStats);
+                    if (SUCCEEDED(hr) && (i == dwSubmit))
+                    {
+                        hr = _Submit(pcpc, &fields, pScenario, pStats, fVerbose);
+                    }
+
+                    CCallTimer timerUnAdvise(pStats, HCI_CREDENTIAL_UNADVISE);
+                    HRESULT hrUnAdvise = pcpc->UnAdvise();
+                    timerUnAdvise.Stop(hrUnAdvise);
+                }
+                pcpce->Release();
+            }
+            pcpc->Release();
+        }
+    }
+
+    if (fAdvised)
+    {
+        CCallTimer timer(pStats, HCI_UNADVISE);
+        HRESULT hrUnAdvise = pcp->UnAdvise();
+        timer.Stop(hrUnAdvise);
+    }
+    if (pcpe != NULL)
+    {
+        pcpe->Release();
+    }
+    return hr;
+}
@@ -0,0 +1,58 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The calls LogonUI makes into a provider for one logon, shared by
+// LogonUIHost, which plays them once at a time, and LogonLoad, which plays
+// them on many threads at once.  Each call is timed into the CCallStats the
+// caller passes, and the events the provider sends back are counted in its
+// CHostEventCounts; a caller that runs several threads gives each its own.
+
+#pragma once
+
+#include <windows.h>
+#include <credentialprovider.h>
+
+#include "CallStats.h"
+#include "HostEvents.h"
+
+typedef HRESULT (STDAPICALLTYPE *PFN_DLLGETCLASSOBJECT)(REFCLSID rclsid, REFIID riid, void** ppv);
+typedef HRESULT (STDAPICALLTYPE *PFN_DLLCANUNLOADNOW)();
+
+#define HOST_STRING_CCH     128
+
+// What the user does in a scenario.
+struct HOST_SCENARIO
+{
+    CREDENTIAL_PROVIDER_USAGE_SCENARIO  cpus;
+    NTSTATUS                            ntsResult;      // What ReportResult is told the logon did.
+    WCHAR                               wszUser[HOST_STRING_CCH];
+    WCHAR                               wszPassword[HOST_STRING_CCH];
+};
+
+// The arguments are ASCII, so widening doesn't need the code page.
+void HostWiden(__in const char* psz, __out_ecount(cch) WCHAR* pwz, size_t cch);
+
+// A logon with the default user name and password.
+void HostInitScenario(__out HOST_SCENARIO* pScenario);
+
+// Takes -scenario, -user, -password or -fail and its value from argv[*pi],
+// moving *pi past them.  S_FALSE if argv[*pi] is none of those.
+HRESULT HostParseScenarioOption(int argc, __in_ecount(argc) char* argv[], __inout int* pi, __inout HOST_SCENARIO* pScenario);
+
+// The usage lines for the options HostParseScenarioOption takes.
+extern const char c_szHostScenarioUsage[];
+
+// Creates a provider as LogonUI does, through its class factory.
+HRESULT HostCreateProvider(__in PFN_DLLGETCLASSOBJECT pfnDllGetClassObject, __in REFCLSID rclsid, __in CCallStats* pStats,
+                           __deref_out ICredentialProvider** ppcp);
+
+// One scenario from start to finish: the provider is told the scenario,
+// every credential is read, and the default one is submitted.  With
+// fVerbose, what the provider enumerated and serialized is printed.
+HRESULT HostRunScenario(__in ICredentialProvider* pcp, __in const HOST_SCENARIO* pScenario, __in CCallStats* pStats,
+                        __in CHostEventCounts* pCounts, bool fVerbose);
@@ -0,0 +1,505 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// A load generator for a credential provider, for the question a terminal
+// server asks: how many logons a second can it get through, and what stops
+// that growing with the cores.  Each session is a provider of its own,
+// created through the class factory, that plays the scenario LogonUIHost
+// plays one or more times and is then released.  A thread pool works
+// through the sessions, and the same sessions are run with one thread, two,
+// four and so on up to the number asked for, so the logons a second at each
+// can be set against the one thread rate.
+//
+// Every thread times its calls into stats of its own, which are added up
+// when the run ends, so the timing itself shares nothing.  The calls whose
+// mean time grows most from one thread to the most are printed as the hot
+// spots: those are the ones waiting on something the threads share, the
+// module's reference count in CreateInstance and Release or LSA in
+// GetSerialization.
+//
+// Elsewhere than Windows, LSA is the shim's stand-in, which can be given a
+// latency and which counts how often its lock was fought over; see
+// readme.txt.
+
+#include <windows.h>
+#include <credentialprovider.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HostScenario.h"
+
+struct LOAD_OPTIONS
+{
+    const char*     pszProvider;
+    CLSID           clsid;
+    DWORD           cThreadsMax;
+    DWORD           cSessions;      // Per run.
+    DWORD           cCycles;        // Scenarios each session plays.
+    DWORD           dwLsaRoundTripUs;
+    DWORD           dwLsaLockedUs;
+    HOST_SCENARIO   scenario;
+};
+
+// What every thread in a run shares.
+struct LOAD_RUN
+{
+    const LOAD_OPTIONS*     pOptions;
+    PFN_DLLGETCLASSOBJECT   pfnDllGetClassObject;
+    HANDLE                  hStart;
+    DWORD                   cSessions;
+    LONG volatile           cSessionsStarted;
+};
+
+// What a run did, once its threads' stats are added up.
+struct LOAD_RESULT
+{
+    DWORD           cThreads;
+    ULONGLONG       cLogons;
+    LONGLONG        llTicks;
+    HRESULT         hr;
+    CCallStats*     pStats;
+    CHostEventCounts* pCounts;
+#ifdef WIN32_SHIM
+    SHIM_LSA_STATS  lsaStats;
+#endif
+};
+
+// One thread of a run.  Its stats are its own until the run ends.
+class CLoadWorker
+{
+  public:
+    CLoadWorker(__in LOAD_RUN* pRun):
+        _pRun(pRun),
+        _stats(NULL),
+        _cLogons(0),
+        _hr(S_OK)
+    {
+    }
+
+    static DWORD WINAPI ThreadProc(__in LPVOID pv)
+    {
+        static_cast<CLoadWorker*>(pv)->_Run();
+        return 0;
+    }
+
+    void AddTo(__inout LOAD_RESULT* pResult)
+    {
+        pResult->pStats->Add(&_stats);
+        pResult->pCounts->Add(&_counts);
+        pResult->cLogons += _cLogons;
+        if (SUCCEEDED(pResult->hr))
+        {
+            pResult->hr = _hr;
+        }
+    }
+
+  private:
+    void _Run();
+
+    LOAD_RUN*           _pRun;
+    CCallStats          _stats;
+    CHostEventCounts    _counts;
+    ULONGLONG           _cLogons;
+    HRESULT             _hr;
+};
+
+// Each thread is its own apartment, as each session's LogonUI is.
+void CLoadWorker::_Run()
+{
+    const LOAD_OPTIONS* pOptions = _pRun->pOptions;
+    HRESULT hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+    if (SUCCEEDED(hr))
+    {
+        WaitForSingleObject(_pRun->hStart, INFINITE);
+        while (SUCCEEDED(hr) && ((DWORD)InterlockedIncrement(&_pRun->cSessionsStarted) <= _pRun->cSessions))
+        {
+            ICredentialProvider* pcp = NULL;
+            hr = HostCreateProvider(_pRun->pfnDllGetClassObject, pOptions->clsid, &_stats, &pcp);
+            for (DWORD i = 0; SUCCEEDED(hr) && (i < pOptions->cCycles); i++)
+            {
+                hr = HostRunScenario(pcp, &pOptions->scenario, &_stats, &_counts, false);
+                _cLogons += SUCCEEDED(hr) ? 1 : 0;
+            }
+            if (pcp != NULL)
+            {
+                CCallTimer timer(&_stats, HCI_RELEASE);
+                pcp->Release();
+                timer.Stop(S_OK);
+            }
+        }
+        CoUninitialize();
+    }
+    _hr = hr;
+}
+
+static void _PrintUsage()
+{
+    fprintf(stderr,
+            "usage: LogonLoad <provider dll> <{clsid}> [options]\n"
+            "  -threads <n>                                   (default the number of processors)\n"
+            "  -sessions <n>                                  (default 10000)\n"
+            "  -cycles <n>                                    scenarios per session (default 1)\n"
+#ifdef WIN32_SHIM
+            "  -lsa <round trip us> <locked us>               (default 0 0)\n"
+#endif
+            "%s", c_szHostScenarioUsage);
+}
+
+static HRESULT _ParseCount(int argc, __in_ecount(argc) char* argv[], __inout int* pi, __out DWORD* pdw)
+{
+    HRESULT hr = (*pi + 1 < argc) ? S_OK : E_INVALIDARG;
+    if (SUCCEEDED(hr))
+    {
+        *pdw = strtoul(argv[++*pi], NULL, 10);
+        hr = (*pdw > 0) ? S_OK : E_INVALIDARG;
+    }
+    return hr;
+}
+
+static HRESULT _ParseOptions(int argc, __in_ecount(argc) char* argv[], __out LOAD_OPTIONS* pOptions)
+{
+    ZeroMemory(pOptions, sizeof(*pOptions));
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    pOptions->cThreadsMax = si.dwNumberOfProcessors;
+    pOptions->cSessions = 10000;
+    pOptions->cCycles = 1;
+    HostInitScenario(&pOptions->scenario);
+
+    HRESULT hr = (argc >= 3) ? S_OK : E_INVALIDARG;
+    if (SUCCEEDED(hr))
+    {
+        WCHAR wszClsid[64];
+        HostWiden(argv[2], wszClsid, ARRAYSIZE(wszClsid));
+        pOptions->pszProvider = argv[1];
+        hr = CLSIDFromString(wszClsid, &pOptions->clsid);
+    }
+
+    for (int i = 3; SUCCEEDED(hr) && (i < argc); i++)
+    {
+        hr = HostParseScenarioOption(argc, argv, &i, &pOptions->scenario);
+        if (hr == S_FALSE)
+        {
+            if (!strcmp(argv[i], "-threads"))
+            {
+                hr = _ParseCount(argc, argv, &i, &pOptions->cThreadsMax);
+            }
+            else if (!strcmp(argv[i], "-sessions"))
+            {
+                hr = _ParseCount(argc, argv, &i, &pOptions->cSessions);
+            }
+            else if (!strcmp(argv[i], "-cycles"))
+            {
+                hr = _ParseCount(argc, argv, &i, &pOptions->cCycles);
+            }
+#ifdef WIN32_SHIM
+            else if (!strcmp(argv[i], "-lsa") && (i + 2 < argc))
+            {
+                pOptions->dwLsaRoundTripUs = strtoul(argv[++i], NULL, 10);
+                pOptions->dwLsaLockedUs = strtoul(argv[++i], NULL, 10);
+                hr = S_OK;
+            }
+#endif
+            else
+            {
+                hr = E_INVALIDARG;
+            }
+        }
+    }
+    return hr;
+}
+
+// Runs every session once on cThreads threads.  The clock starts when the
+// threads are all created and stops when the last one is done.
+static HRESULT _RunLoad(__in LOAD_RUN* pRun, DWORD cThreads, __inout LOAD_RESULT* pResult)
+{
+    pResult->cThreads = cThreads;
+    pResult->cLogons = 0;
+    pResult->llTicks = 0;
+    pResult->hr = S_OK;
+    pRun->cSessionsStarted = 0;
+#ifdef WIN32_SHIM
+    ShimResetLsaStats();
+#endif
+
+    CLoadWorker** rgpWorker = new CLoadWorker*[cThreads];
+    HANDLE* rghThread = new HANDLE[cThreads];
+    HRESULT hr = (rgpWorker && rghThread) ? S_OK : E_OUTOFMEMORY;
+    DWORD cStarted = 0;
+    if (SUCCEEDED(hr))
+    {
+        pRun->hStart = CreateEvent(NULL, TRUE, FALSE, NULL);
+        hr = pRun->hStart ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    while (SUCCEEDED(hr) && (cStarted < cThreads))
+    {
+        rgpWorker[cStarted] = new CLoadWorker(pRun);
+        hr = rgpWorker[cStarted] ? S_OK : E_OUTOFMEMORY;
+        if (SUCCEEDED(hr))
+        {
+            rghThread[cStarted] = CreateThread(NULL, 0, CLoadWorker::ThreadProc, rgpWorker[cStarted], 0, NULL);
+            hr = rghThread[cStarted] ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+            if (SUCCEEDED(hr))
+            {
+                cStarted++;
+            }
+            else
+            {
+                delete rgpWorker[cStarted];
+            }
+        }
+    }
+
+    // A run that couldn't start all its threads still lets those it did
+    // start finish, with nothing left for them to do.
+    if (FAILED(hr))
+    {
+        pRun->cSessionsStarted = pRun->cSessions;
+    }
+
+    LARGE_INTEGER liStart;
+    LARGE_INTEGER liEnd;
+    QueryPerformanceCounter(&liStart);
+    if (pRun->hStart != NULL)
+    {
+        SetEvent(pRun->hStart);
+    }
+    for (DWORD i = 0; i < cStarted; i++)
+    {
+        WaitForSingleObject(rghThread[i], INFINITE);
+    }
+    QueryPerformanceCounter(&liEnd);
+    pResult->llTicks = liEnd.QuadPart - liStart.QuadPart;
+#ifdef WIN32_SHIM
+    ShimGetLsaStats(&pResult->lsaStats);
+#endif
+
+    for (DWORD i = 0; i < cStarted; i++)
+    {
+        CloseHandle(rghThread[i]);
+        rgpWorker[i]->AddTo(pResult);
+        delete rgpWorker[i];
+    }
+    if (pRun->hStart != NULL)
+    {
+        CloseHandle(pRun->hStart);
+        pRun->hStart = NULL;
+    }
+    delete [] rghThread;
+    delete [] rgpWorker;
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pResult->hr;
+    }
+    return hr;
+}
+
+static double _LogonsPerSecond(__in const LOAD_RESULT* pResult, double dFrequency)
+{
+    return (pResult->llTicks > 0) ? (pResult->cLogons * dFrequency / pResult->llTicks) : 0;
+}
+
+static void _PrintRunHeader()
+{
+    printf("threads      logons   seconds    logons/s   speedup  efficiency");
+#ifdef WIN32_SHIM
+    printf("   lsa calls  contended  wait us/logon");
+#endif
+    printf("\n");
+}
+
+// Efficiency is the speedup over one thread per thread: 1.00 is perfect
+// scaling, and less is the share of each added core that went to waiting.
+static void _PrintRun(__in const LOAD_RESULT* pResult, __in const LOAD_RESULT* pBase, double dFrequency)
+{
+    const double dRate = _LogonsPerSecond(pResult, dFrequency);
+    const double dBaseRate = _LogonsPerSecond(pBase, dFrequency);
+    const double dSpeedup = (dBaseRate > 0) ? (dRate / dBaseRate) : 0;
+    printf("%7u  %10llu  %8.3f  %10.0f  %8.2f  %10.2f",
+           pResult->cThreads,
+           pResult->cLogons,
+           pResult->llTicks / dFrequency,
+           dRate,
+           dSpeedup,
+           dSpeedup / pResult->cThreads);
+#ifdef WIN32_SHIM
+    const SHIM_LSA_STATS& lsa = pResult->lsaStats;
+    printf("  %10llu  %8.1f%%  %13.2f",
+           lsa.cCalls,
+           lsa.cCalls ? (100.0 * lsa.cContended / lsa.cCalls) : 0,
+           pResult->cLogons ? (lsa.llWaitTicks * 1e6 / dFrequency / pResult->cLogons) : 0);
+#endif
+    printf("\n");
+}
+
+struct LOAD_HOT_SPOT
+{
+    HOST_CALL_ID    hci;
+    ULONGLONG       ullMeanNs;
+    ULONGLONG       ullBaseMeanNs;
+    double          dExtraNsPerLogon;
+};
+
+static int __cdecl _CompareHotSpots(const void* pv1, const void* pv2)
+{
+    const double d1 = static_cast<const LOAD_HOT_SPOT*>(pv1)->dExtraNsPerLogon;
+    const double d2 = static_cast<const LOAD_HOT_SPOT*>(pv2)->dExtraNsPerLogon;
+    return (d1 < d2) ? 1 : ((d1 > d2) ? -1 : 0);
+}
+
+// Each call's mean time with one thread and with the most, ordered by how
+// much longer it makes a logon take: a call that slows down as threads are
+// added is waiting on something they share.
+static void _PrintHotSpots(__in const LOAD_RESULT* pResult, __in const LOAD_RESULT* pBase)
+{
+    LOAD_HOT_SPOT rghs[HCI_NUM_CALLS];
+    DWORD cHotSpots = 0;
+    for (DWORD i = 0; i < HCI_NUM_CALLS; i++)
+    {
+        const CALL_STATS* pcs = pResult->pStats->GetCallStats((HOST_CALL_ID)i);
+        const CALL_STATS* pcsBase = pBase->pStats->GetCallStats((HOST_CALL_ID)i);
+        if ((pcs->cCalls > 0) && (pcsBase->cCalls > 0) && (pResult->cLogons > 0))
+        {
+            LOAD_HOT_SPOT& hs = rghs[cHotSpots++];
+            hs.hci = (HOST_CALL_ID)i;
+            hs.ullMeanNs = pResult->pStats->TicksToNs(pcs->llTicks) / pcs->cCalls;
+            hs.ullBaseMeanNs = pBase->pStats->TicksToNs(pcsBase->llTicks) / pcsBase->cCalls;
+            hs.dExtraNsPerLogon = ((double)hs.ullMeanNs - (double)hs.ullBaseMeanNs) * pcs->cCalls / pResult->cLogons;
+        }
+    }
+    qsort(rghs, cHotSpots, sizeof(rghs[0]), _CompareHotSpots);
+
+    printf("call                      mean ns @1  mean ns @%-3u  slowdown  extra ns/logon\n", pResult->cThreads);
+    for (DWORD i = 0; i < cHotSpots; i++)
+    {
+        const LOAD_HOT_SPOT& hs = rghs[i];
+        printf("%-24s  %10llu  %12llu  %8.2f  %14.0f\n",
+               CCallStats::GetCallName(hs.hci),
+               hs.ullBaseMeanNs,
+               hs.ullMeanNs,
+               hs.ullBaseMeanNs ? ((double)hs.ullMeanNs / hs.ullBaseMeanNs) : 0,
+               hs.dExtraNsPerLogon);
+    }
+}
+
+int __cdecl main(int argc, __in_ecount(argc) char* argv[])
+{
+    LOAD_OPTIONS options;
+    HRESULT hr = _ParseOptions(argc, argv, &options);
+    if (FAILED(hr))
+    {
+        _PrintUsage();
+        return 2;
+    }
+#ifdef WIN32_SHIM
+    ShimSetLsaLatency(options.dwLsaRoundTripUs, options.dwLsaLockedUs);
+#endif
+
+    // One thread, then twice as many each run, ending at the most asked for.
+    DWORD rgcThreads[32];
+    DWORD cRuns = 0;
+    for (DWORD cThreads = 1; (cThreads < options.cThreadsMax) && (cRuns < ARRAYSIZE(rgcThreads) - 1); cThreads *= 2)
+    {
+        rgcThreads[cRuns++] = cThreads;
+    }
+    rgcThreads[cRuns++] = options.cThreadsMax;
+
+    LOAD_RESULT rgResult[ARRAYSIZE(rgcThreads)];
+    ZeroMemory(rgResult, sizeof(rgResult));
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < cRuns); i++)
+    {
+        rgResult[i].pStats = new CCallStats(NULL);
+        rgResult[i].pCounts = new CHostEventCounts();
+        hr = (rgResult[i].pStats && rgResult[i].pCounts) ? S_OK : E_OUTOFMEMORY;
+    }
+
+    LARGE_INTEGER liFrequency;
+    QueryPerformanceFrequency(&liFrequency);
+    const double dFrequency = (double)liFrequency.QuadPart;
+
+    DWORD cRunsDone = 0;
+    HMODULE hModule = NULL;
+    if (SUCCEEDED(hr))
+    {
+        hModule = LoadLibraryA(options.pszProvider);
+        hr = hModule ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+    }
+    if (SUCCEEDED(hr))
+    {
+        LOAD_RUN run;
+        ZeroMemory(&run, sizeof(run));
+        run.pOptions = &options;
+        run.pfnDllGetClassObject = (PFN_DLLGETCLASSOBJECT)(void (*)(void))GetProcAddress(hModule, "DllGetClassObject");
+        hr = run.pfnDllGetClassObject ? S_OK : HRESULT_FROM_WIN32(ERROR_PROC_NOT_FOUND);
+
+        // A short run first, so the first measured one doesn't pay for
+        // faulting in the provider and warming the heap.
+        if (SUCCEEDED(hr))
+        {
+            CCallStats statsWarm(NULL);
+            CHostEventCounts countsWarm;
+            LOAD_RESULT resultWarm;
+            ZeroMemory(&resultWarm, sizeof(resultWarm));
+            resultWarm.pStats = &statsWarm;
+            resultWarm.pCounts = &countsWarm;
+            run.cSessions = (options.cSessions + 9) / 10;
+            hr = _RunLoad(&run, 1, &resultWarm);
+        }
+
+        run.cSessions = options.cSessions;
+        if (SUCCEEDED(hr))
+        {
+            _PrintRunHeader();
+        }
+        while (SUCCEEDED(hr) && (cRunsDone < cRuns))
+        {
+            LOAD_RESULT* pResult = &rgResult[cRunsDone];
+            hr = _RunLoad(&run, rgcThreads[cRunsDone], pResult);
+            if (SUCCEEDED(hr))
+            {
+                _PrintRun(pResult, &rgResult[0], dFrequency);
+                fflush(stdout);
+                cRunsDone++;
+            }
+        }
+
+        // Every session's provider has been released, so a provider that
+        // still holds a reference has leaked one.
+        PFN_DLLCANUNLOADNOW pfnDllCanUnloadNow = (PFN_DLLCANUNLOADNOW)(void (*)(void))GetProcAddress(hModule, "DllCanUnloadNow");
+        if ((pfnDllCanUnloadNow != NULL) && (pfnDllCanUnloadNow() != S_OK))
+        {
+            printf("DllCanUnloadNow: the provider still holds references\n");
+        }
+        FreeLibrary(hModule);
+    }
+
+    if (FAILED(hr))
+    {
+        printf("failed: 0x%08X\n", (unsigned int)hr);
+    }
+    if (cRunsDone > 1)
+    {
+        printf("\n");
+        _PrintHotSpots(&rgResult[cRunsDone - 1], &rgResult[0]);
+    }
+    if (cRunsDone > 0)
+    {
+        printf("\n");
+        rgResult[cRunsDone - 1].pCounts->Print(stdout);
+    }
+
+    for (DWORD i = 0; i < cRuns; i++)
+    {
+        delete rgResult[i].pStats;
+        delete rgResult[i].pCounts;
+    }
+    return SUCCEEDED(hr) ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// A headless stand-in for LogonUI.  It loads a credential provider through
+// DllGetClassObject and plays the calls LogonUI makes for one logon: set the
+// usage scenario, advise, read the field descriptors, enumerate the
+// credentials and read every field of each, select the default one, type a
+// user name and password into it a keystroke at a time, get its
+// serialization and report the result.  Each call is timed and the task
+// allocations made during it are counted, and the totals are printed when
+// the run ends.
+//
+// Nothing is drawn and nothing is sent to LSA, so a run measures the
+// provider alone.  On Windows the host uses the real system.  Elsewhere it is
+// built, with the provider, against the headers in the shim directory, which
+// stand in for just enough of COM and Win32 to run the samples; see
+// readme.txt.
+
+#include <windows.h>
+#include <credentialprovider.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HostScenario.h"
+
+struct HOST_OPTIONS
+{
+    const char*     pszProvider;
+    CLSID           clsid;
+    DWORD           cIterations;
+    HOST_SCENARIO   scenario;
+};
+
+static void _PrintUsage()
+{
+    fprintf(stderr,
+            "usage: LogonUIHost <provider dll> <{clsid}> [options]\n"
+            "  -iterations <n>                                (default 1)\n"
+            "%s", c_szHostScenarioUsage);
+}
+
+static HRESULT _ParseOptions(int argc, __in_ecount(argc) char* argv[], __out HOST_OPTIONS* pOptions)
+{
+    ZeroMemory(pOptions, sizeof(*pOptions));
+    pOptions->cIterations = 1;
+    HostInitScenario(&pOptions->scenario);
+
+    HRESULT hr = (argc >= 3) ? S_OK : E_INVALIDARG;
+    if (SUCCEEDED(hr))
+    {
+        WCHAR wszClsid[64];
+        HostWiden(argv[2], wszClsid, ARRAYSIZE(wszClsid));
+        pOptions->pszProvider = argv[1];
+        hr = CLSIDFromString(wszClsid, &pOptions->clsid);
+    }
+
+    for (int i = 3; SUCCEEDED(hr) && (i < argc); i++)
+    {
+        hr = HostParseScenarioOption(argc, argv, &i, &pOptions->scenario);
+        if (hr == S_FALSE)
+        {
+            if (!strcmp(argv[i], "-iterations") && (i + 1 < argc))
+            {
+                pOptions->cIterations = strtoul(argv[++i], NULL, 10);
+                hr = (pOptions->cIterations > 0) ? S_OK : E_INVALIDARG;
+            }
+            else
+            {
+                hr = E_INVALIDARG;
+            }
+        }
+    }
+    return hr;
+}
+
+int __cdecl main(int argc, __in_ecount(argc) char* argv[])
+{
+    HOST_OPTIONS options;
+    HRESULT hr = _ParseOptions(argc, argv, &options);
+    if (FAILED(hr))
+    {
+        _PrintUsage();
+        return 2;
+    }
+
+    hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+    if (SUCCEEDED(hr))
+    {
+        CAllocationSpy* pSpy = new CAllocationSpy();
+        hr = pSpy ? CoRegisterMallocSpy(pSpy) : E_OUTOFMEMORY;
+        if (SUCCEEDED(hr))
+        {
+            CCallStats stats(pSpy);
+            CHostEventCounts counts;
+            DWORD cIterations = 0;
+
+            HMODULE hModule = LoadLibraryA(options.pszProvider);
+            hr = hModule ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+            if (SUCCEEDED(hr))
+            {
+                ICredentialProvider* pcp = NULL;
+                PFN_DLLGETCLASSOBJECT pfnDllGetClassObject = (PFN_DLLGETCLASSOBJECT)(void (*)(void))GetProcAddress(hModule, "DllGetClassObject");
+                hr = pfnDllGetClassObject ? HostCreateProvider(pfnDllGetClassObject, options.clsid, &stats, &pcp)
+                                          : HRESULT_FROM_WIN32(ERROR_PROC_NOT_FOUND);
+                while (SUCCEEDED(hr) && (cIterations < options.cIterations))
+                {
+                    hr = HostRunScenario(pcp, &options.scenario, &stats, &counts, (cIterations == 0));
+                    cIterations += SUCCEEDED(hr) ? 1 : 0;
+                }
+                if (pcp != NULL)
+                {
+                    CCallTimer timer(&stats, HCI_RELEASE);
+                    pcp->Release();
+                    timer.Stop(S_OK);
+                }
+
+                // Every credential and factory has been released, so a
+                // provider that still holds a reference has leaked one.
+                PFN_DLLCANUNLOADNOW pfnDllCanUnloadNow = (PFN_DLLCANUNLOADNOW)(void (*)(void))GetProcAddress(hModule, "DllCanUnloadNow");
+                if ((pfnDllCanUnloadNow != NULL) && (pfnDllCanUnloadNow() != S_OK))
+                {
+                    printf("DllCanUnloadNow: the provider still holds references\n");
+                }
+                FreeLibrary(hModule);
+            }
+
+            if (FAILED(hr))
+            {
+                printf("failed: 0x%08X\n", (unsigned int)hr);
+            }
+            printf("\n");
+            stats.Print(stdout, cIterations);
+            printf("\n");
+            counts.Print(stdout);
+
+            CoRevokeMallocSpy();
+        }
+        if (pSpy != NULL)
+        {
+            pSpy->Release();
+        }
+        CoUninitialize();
+    }
+    return SUCCEEDED(hr) ? 0 : 1;
+}
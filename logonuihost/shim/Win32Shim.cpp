@@ -0,0 +1,2161 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The functions Win32Shim.h declares.  This is linked into the host, which
+// is built with -rdynamic so the providers it loads use these too, and so
+// share one heap spy, one last error per thread and one LSA.
+
+#include <dlfcn.h>
+#include <link.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+#include "Win32Shim.h"
+#include "ntstatus.h"
+
+// GUIDs ///////////////////////////////////////////////////////////////////
+
+EXTERN_C const GUID g_ShimGuidNull = { 0x00000000, 0x0000, 0x0000, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } };
+
+EXTERN_C const IID IID_IUnknown = { 0x00000000, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+EXTERN_C const IID IID_IClassFactory = { 0x00000001, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+EXTERN_C const IID IID_IMallocSpy = { 0x0000001D, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+EXTERN_C const IID IID_ICredentialProvider = { 0xD27C3481, 0x5A1C, 0x45B2, { 0x8A, 0xAA, 0xC2, 0x0E, 0xBB, 0xE8, 0x22, 0x9E } };
+EXTERN_C const IID IID_ICredentialProviderCredential = { 0x63913A93, 0x40C1, 0x481A, { 0x81, 0x8D, 0x40, 0x72, 0xFF, 0x8C, 0x70, 0xCC } };
+EXTERN_C const IID IID_ICredentialProviderCredentialEvents = { 0xFA6FA76B, 0x66B7, 0x4B11, { 0x95, 0xF1, 0x86, 0x17, 0x11, 0x18, 0xE8, 0x16 } };
+EXTERN_C const IID IID_ICredentialProviderEvents = { 0x34201E5A, 0xA787, 0x41A3, { 0xA5, 0xA4, 0xBD, 0x6D, 0xCF, 0x2A, 0x85, 0x4E } };
+
+// Errors //////////////////////////////////////////////////////////////////
+
+static __thread DWORD s_dwLastError = ERROR_SUCCESS;
+
+DWORD GetLastError()
+{
+    return s_dwLastError;
+}
+
+void SetLastError(DWORD dwErrCode)
+{
+    s_dwLastError = dwErrCode;
+}
+
+// Handles /////////////////////////////////////////////////////////////////
+
+enum SHIM_HANDLE_TYPE
+{
+    SHT_THREAD,
+    SHT_EVENT,
+    SHT_LSA,
+};
+
+struct SHIM_HANDLE
+{
+    SHIM_HANDLE_TYPE        type;
+
+    // SHT_THREAD
+    pthread_t               thread;
+    LPTHREAD_START_ROUTINE  pfnStart;
+    LPVOID                  pvParameter;
+    bool                    fJoined;
+
+    // SHT_EVENT
+    pthread_mutex_t         mutex;
+    pthread_cond_t          cond;
+    bool                    fManualReset;
+    bool                    fSignaled;
+};
+
+static SHIM_HANDLE* _HandleAlloc(SHIM_HANDLE_TYPE type)
+{
+    SHIM_HANDLE* ph = new (std::nothrow) SHIM_HANDLE();
+    if (ph != NULL)
+    {
+        ph->type = type;
+    }
+    return ph;
+}
+
+// COM /////////////////////////////////////////////////////////////////////
+
+static IMallocSpy* s_pMallocSpy = NULL;
+
+HRESULT CoInitializeEx(LPVOID pvReserved, DWORD dwCoInit)
+{
+    UNREFERENCED_PARAMETER(pvReserved);
+    UNREFERENCED_PARAMETER(dwCoInit);
+    return S_OK;
+}
+
+void CoUninitialize()
+{
+}
+
+HRESULT CoRegisterMallocSpy(IMallocSpy* pMallocSpy)
+{
+    HRESULT hr;
+    if (pMallocSpy == NULL)
+    {
+        hr = E_INVALIDARG;
+    }
+    else if (s_pMallocSpy != NULL)
+    {
+        hr = _HRESULT_TYPEDEF_(0x800401FB);     // CO_E_OBJISREG
+    }
+    else
+    {
+        pMallocSpy->AddRef();
+        s_pMallocSpy = pMallocSpy;
+        hr = S_OK;
+    }
+    return hr;
+}
+
+HRESULT CoRevokeMallocSpy()
+{
+    HRESULT hr = _HRESULT_TYPEDEF_(0x800401FC); // CO_E_OBJNOTREG
+    if (s_pMallocSpy != NULL)
+    {
+        s_pMallocSpy->Release();
+        s_pMallocSpy = NULL;
+        hr = S_OK;
+    }
+    return hr;
+}
+
+LPVOID CoTaskMemAlloc(SIZE_T cb)
+{
+    IMallocSpy* pSpy = s_pMallocSpy;
+    if (pSpy != NULL)
+    {
+        cb = pSpy->PreAlloc(cb);
+    }
+    void* pv = malloc(cb ? cb : 1);
+    if (pSpy != NULL)
+    {
+        pv = pSpy->PostAlloc(pv);
+    }
+    return pv;
+}
+
+LPVOID CoTaskMemRealloc(LPVOID pv, SIZE_T cb)
+{
+    IMallocSpy* pSpy = s_pMallocSpy;
+    if (pSpy != NULL)
+    {
+        void* pvNew = NULL;
+        cb = pSpy->PreRealloc(pv, cb, &pvNew, TRUE);
+        pv = pvNew;
+    }
+    void* pvResult = realloc(pv, cb ? cb : 1);
+    if (pSpy != NULL)
+    {
+        pvResult = pSpy->PostRealloc(pvResult, TRUE);
+    }
+    return pvResult;
+}
+
+void CoTaskMemFree(LPVOID pv)
+{
+    if (pv != NULL)
+    {
+        IMallocSpy* pSpy = s_pMallocSpy;
+        if (pSpy != NULL)
+        {
+            pv = pSpy->PreFree(pv, TRUE);
+        }
+        free(pv);
+        if (pSpy != NULL)
+        {
+            pSpy->PostFree(TRUE);
+        }
+    }
+}
+
+static bool _ParseHex(LPCOLESTR* ppsz, DWORD cDigits, uint32_t* pul)
+{
+    *pul = 0;
+    for (DWORD i = 0; i < cDigits; i++)
+    {
+        const WCHAR wch = (*ppsz)[i];
+        DWORD dwDigit;
+        if (wch >= L'0' && wch <= L'9')
+        {
+            dwDigit = wch - L'0';
+        }
+        else if (wch >= L'a' && wch <= L'f')
+        {
+            dwDigit = wch - L'a' + 10;
+        }
+        else if (wch >= L'A' && wch <= L'F')
+        {
+            dwDigit = wch - L'A' + 10;
+        }
+        else
+        {
+            return false;
+        }
+        *pul = (*pul << 4) | dwDigit;
+    }
+    *ppsz += cDigits;
+    return true;
+}
+
+static bool _ParseChar(LPCOLESTR* ppsz, WCHAR wch)
+{
+    bool fMatch = (**ppsz == wch);
+    if (fMatch)
+    {
+        (*ppsz)++;
+    }
+    return fMatch;
+}
+
+HRESULT CLSIDFromString(LPCOLESTR lpsz, LPCLSID pclsid)
+{
+    uint32_t rgul[11];
+    bool fValid = (lpsz != NULL) &&
+                  _ParseChar(&lpsz, L'{') &&
+                  _ParseHex(&lpsz, 8, &rgul[0]) && _ParseChar(&lpsz, L'-') &&
+                  _ParseHex(&lpsz, 4, &rgul[1]) && _ParseChar(&lpsz, L'-') &&
+                  _ParseHex(&lpsz, 4, &rgul[2]) && _ParseChar(&lpsz, L'-') &&
+                  _ParseHex(&lpsz, 2, &rgul[3]) && _ParseHex(&lpsz, 2, &rgul[4]) && _ParseChar(&lpsz, L'-');
+    for (DWORD i = 5; fValid && (i < 11); i++)
+    {
+        fValid = _ParseHex(&lpsz, 2, &rgul[i]);
+    }
+    fValid = fValid && _ParseChar(&lpsz, L'}') && (*lpsz == 0);
+
+    HRESULT hr = CO_E_CLASSSTRING;
+    if (fValid)
+    {
+        pclsid->Data1 = rgul[0];
+        pclsid->Data2 = (uint16_t)rgul[1];
+        pclsid->Data3 = (uint16_t)rgul[2];
+        for (DWORD i = 0; i < 8; i++)
+        {
+            pclsid->Data4[i] = (uint8_t)rgul[3 + i];
+        }
+        hr = S_OK;
+    }
+    return hr;
+}
+
+HRESULT QISearch(void* that, LPCQITAB pqit, REFIID riid, void** ppv)
+{
+    HRESULT hr = E_NOINTERFACE;
+    *ppv = NULL;
+
+    // IUnknown is the first interface in the table.
+    if (riid == IID_IUnknown)
+    {
+        *ppv = (BYTE*)that + pqit->dwOffset;
+    }
+    for (; (*ppv == NULL) && (pqit->piid != NULL); pqit++)
+    {
+        if (riid == *pqit->piid)
+        {
+            *ppv = (BYTE*)that + pqit->dwOffset;
+        }
+    }
+
+    if (*ppv != NULL)
+    {
+        ((IUnknown*)*ppv)->AddRef();
+        hr = S_OK;
+    }
+    return hr;
+}
+
+HRESULT SHStrDupW(LPCWSTR psz, LPWSTR* ppwsz)
+{
+    HRESULT hr = E_INVALIDARG;
+    *ppwsz = NULL;
+    if (psz != NULL)
+    {
+        const size_t cb = (ShimWcslen(psz) + 1) * sizeof(WCHAR);
+        *ppwsz = (LPWSTR)CoTaskMemAlloc(cb);
+        if (*ppwsz != NULL)
+        {
+            memcpy(*ppwsz, psz, cb);
+            hr = S_OK;
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+    return hr;
+}
+
+// Wide strings ////////////////////////////////////////////////////////////
+
+size_t ShimWcslen(const WCHAR* pwz)
+{
+    size_t cch = 0;
+    while (pwz[cch] != 0)
+    {
+        cch++;
+    }
+    return cch;
+}
+
+WCHAR* ShimWcsrchr(const WCHAR* pwz, WCHAR wch)
+{
+    const WCHAR* pwzFound = NULL;
+    for (;; pwz++)
+    {
+        if (*pwz == wch)
+        {
+            pwzFound = pwz;
+        }
+        if (*pwz == 0)
+        {
+            break;
+        }
+    }
+    return (WCHAR*)pwzFound;
+}
+
+WCHAR* ShimWcschr(const WCHAR* pwz, WCHAR wch)
+{
+    for (;; pwz++)
+    {
+        if (*pwz == wch)
+        {
+            return (WCHAR*)pwz;
+        }
+        if (*pwz == 0)
+        {
+            return NULL;
+        }
+    }
+}
+
+int ShimWcscmp(const WCHAR* pwz1, const WCHAR* pwz2)
+{
+    while ((*pwz1 != 0) && (*pwz1 == *pwz2))
+    {
+        pwz1++;
+        pwz2++;
+    }
+    return (int)*pwz1 - (int)*pwz2;
+}
+
+static WCHAR _ToLower(WCHAR wch)
+{
+    return ((wch >= L'A') && (wch <= L'Z')) ? (WCHAR)(wch - L'A' + L'a') : wch;
+}
+
+int ShimWcsnicmp(const WCHAR* pwz1, const WCHAR* pwz2, size_t cch)
+{
+    int iResult = 0;
+    for (size_t i = 0; (iResult == 0) && (i < cch); i++)
+    {
+        iResult = (int)_ToLower(pwz1[i]) - (int)_ToLower(pwz2[i]);
+        if (pwz1[i] == 0)
+        {
+            break;
+        }
+    }
+    return iResult;
+}
+
+int ShimWcsicmp(const WCHAR* pwz1, const WCHAR* pwz2)
+{
+    return ShimWcsnicmp(pwz1, pwz2, (size_t)-1);
+}
+
+void ShimWideToNarrow(const WCHAR* pwz, char* psz, size_t cch)
+{
+    size_t i = 0;
+    for (; (pwz != NULL) && (pwz[i] != 0) && (i + 1 < cch); i++)
+    {
+        psz[i] = (pwz[i] < 0x80) ? (char)pwz[i] : '?';
+    }
+    if (cch > 0)
+    {
+        psz[i] = 0;
+    }
+}
+
+void ShimNarrowToWide(const char* psz, WCHAR* pwz, size_t cch)
+{
+    size_t i = 0;
+    for (; (psz != NULL) && (psz[i] != 0) && (i + 1 < cch); i++)
+    {
+        pwz[i] = ((unsigned char)psz[i] < 0x80) ? (WCHAR)psz[i] : L'?';
+    }
+    if (cch > 0)
+    {
+        pwz[i] = 0;
+    }
+}
+
+// strsafe /////////////////////////////////////////////////////////////////
+
+// Appends to a buffer, remembering if anything didn't fit.
+struct SHIM_OUTPUT
+{
+    LPWSTR  pszDest;
+    size_t  cchDest;
+    size_t  ich;
+    bool    fTruncated;
+};
+
+static void _Put(SHIM_OUTPUT* pout, WCHAR wch)
+{
+    if (pout->ich + 1 < pout->cchDest)
+    {
+        pout->pszDest[pout->ich++] = wch;
+    }
+    else
+    {
+        pout->fTruncated = true;
+    }
+}
+
+static HRESULT _Finish(SHIM_OUTPUT* pout)
+{
+    pout->pszDest[pout->ich] = 0;
+    return pout->fTruncated ? STRSAFE_E_INSUFFICIENT_BUFFER : S_OK;
+}
+
+HRESULT StringCchCopyNW(LPWSTR pszDest, size_t cchDest, LPCWSTR pszSrc, size_t cchToCopy)
+{
+    HRESULT hr = STRSAFE_E_INVALID_PARAMETER;
+    if ((cchDest != 0) && (cchDest <= STRSAFE_MAX_CCH))
+    {
+        SHIM_OUTPUT out = { pszDest, cchDest, 0, false };
+        for (size_t i = 0; (i < cchToCopy) && (pszSrc[i] != 0); i++)
+        {
+            _Put(&out, pszSrc[i]);
+        }
+        hr = _Finish(&out);
+    }
+    return hr;
+}
+
+HRESULT StringCchCopyW(LPWSTR pszDest, size_t cchDest, LPCWSTR pszSrc)
+{
+    return StringCchCopyNW(pszDest, cchDest, pszSrc, STRSAFE_MAX_CCH);
+}
+
+HRESULT StringCchCatW(LPWSTR pszDest, size_t cchDest, LPCWSTR pszSrc)
+{
+    size_t cchUsed;
+    HRESULT hr = StringCchLengthW(pszDest, cchDest, &cchUsed);
+    if (SUCCEEDED(hr))
+    {
+        hr = StringCchCopyW(pszDest + cchUsed, cchDest - cchUsed, pszSrc);
+    }
+    return hr;
+}
+
+HRESULT StringCchLengthW(LPCWSTR psz, size_t cchMax, size_t* pcchLength)
+{
+    HRESULT hr = STRSAFE_E_INVALID_PARAMETER;
+    size_t cch = 0;
+    if ((psz != NULL) && (cchMax <= STRSAFE_MAX_CCH))
+    {
+        while ((cch < cchMax) && (psz[cch] != 0))
+        {
+            cch++;
+        }
+        hr = (cch < cchMax) ? S_OK : STRSAFE_E_INVALID_PARAMETER;
+    }
+    if (pcchLength != NULL)
+    {
+        *pcchLength = SUCCEEDED(hr) ? cch : 0;
+    }
+    return hr;
+}
+
+HRESULT StringCchVPrintfW(LPWSTR pszDest, size_t cchDest, LPCWSTR pszFormat, va_list argList)
+{
+    if ((cchDest == 0) || (cchDest > STRSAFE_MAX_CCH))
+    {
+        return STRSAFE_E_INVALID_PARAMETER;
+    }
+
+    SHIM_OUTPUT out = { pszDest, cchDest, 0, false };
+    for (LPCWSTR pch = pszFormat; *pch != 0; pch++)
+    {
+        if (*pch != L'%')
+        {
+            _Put(&out, *pch);
+            continue;
+        }
+        pch++;
+        if (*pch == L'%')
+        {
+            _Put(&out, L'%');
+            continue;
+        }
+
+        // Flags, width and precision go to snprintf as they are.
+        char szSpec[32] = "%";
+        size_t ichSpec = 1;
+        bool fLeft = false;
+        while ((*pch == L'-') || (*pch == L'+') || (*pch == L' ') || (*pch == L'#') || (*pch == L'0'))
+        {
+            fLeft = fLeft || (*pch == L'-');
+            szSpec[ichSpec++] = (char)*pch++;
+        }
+        int cchWidth = 0;
+        if (*pch == L'*')
+        {
+            cchWidth = va_arg(argList, int);
+            pch++;
+        }
+        else
+        {
+            while ((*pch >= L'0') && (*pch <= L'9'))
+            {
+                cchWidth = cchWidth * 10 + (*pch++ - L'0');
+            }
+        }
+        int cchPrecision = -1;
+        if (*pch == L'.')
+        {
+            pch++;
+            cchPrecision = 0;
+            if (*pch == L'*')
+            {
+                cchPrecision = va_arg(argList, int);
+                pch++;
+            }
+            else
+            {
+                while ((*pch >= L'0') && (*pch <= L'9'))
+                {
+                    cchPrecision = cchPrecision * 10 + (*pch++ - L'0');
+                }
+            }
+        }
+
+        // Sizes, as Windows reads them: l is 32 bits, I64 and ll are 64, I is a pointer.
+        enum { SIZE_INT, SIZE_LONGLONG, SIZE_PTR, SIZE_SHORT } size = SIZE_INT;
+        bool fNarrow = false;
+        if ((pch[0] == L'I') && (pch[1] == L'6') && (pch[2] == L'4'))
+        {
+            size = SIZE_LONGLONG;
+            pch += 3;
+        }
+        else if ((pch[0] == L'l') && (pch[1] == L'l'))
+        {
+            size = SIZE_LONGLONG;
+            pch += 2;
+        }
+        else if ((pch[0] == L'I') || (pch[0] == L'z'))
+        {
+            size = SIZE_PTR;
+            pch++;
+        }
+        else if (pch[0] == L'l')
+        {
+            pch++;
+        }
+        else if (pch[0] == L'h')
+        {
+            size = SIZE_SHORT;
+            fNarrow = true;
+            pch++;
+        }
+
+        const WCHAR wchConversion = *pch;
+        if ((wchConversion == L's') || (wchConversion == L'S') || (wchConversion == L'c') || (wchConversion == L'C'))
+        {
+            // Strings are wide for %s and narrow for %S and %hs.
+            WCHAR wszChar[2] = { 0, 0 };
+            const WCHAR* pwz = NULL;
+            const char* psz = NULL;
+            if ((wchConversion == L'c') || (wchConversion == L'C'))
+            {
+                wszChar[0] = (WCHAR)va_arg(argList, int);
+                pwz = wszChar;
+            }
+            else if (fNarrow || (wchConversion == L'S'))
+            {
+                psz = va_arg(argList, const char*);
+                psz = (psz != NULL) ? psz : "(null)";
+            }
+            else
+            {
+                pwz = va_arg(argList, const WCHAR*);
+                pwz = (pwz != NULL) ? pwz : L"(null)";
+            }
+
+            int cch = 0;
+            while (((cchPrecision < 0) || (cch < cchPrecision)) && (pwz ? pwz[cch] : psz[cch]) != 0)
+            {
+                cch++;
+            }
+            for (int i = cch; !fLeft && (i < cchWidth); i++)
+            {
+                _Put(&out, L' ');
+            }
+            for (int i = 0; i < cch; i++)
+            {
+                _Put(&out, pwz ? pwz[i] : (WCHAR)(unsigned char)psz[i]);
+            }
+            for (int i = cch; fLeft && (i < cchWidth); i++)
+            {
+                _Put(&out, L' ');
+            }
+        }
+        else if ((wchConversion == L'd') || (wchConversion == L'i') || (wchConversion == L'u') ||
+                 (wchConversion == L'x') || (wchConversion == L'X') || (wchConversion == L'o') || (wchConversion == L'p'))
+        {
+            char szNumber[80];
+            ichSpec += snprintf(szSpec + ichSpec, sizeof(szSpec) - ichSpec, cchWidth ? "%d" : "", cchWidth);
+            if (cchPrecision >= 0)
+            {
+                ichSpec += snprintf(szSpec + ichSpec, sizeof(szSpec) - ichSpec, ".%d", cchPrecision);
+            }
+
+            const bool fSigned = (wchConversion == L'd') || (wchConversion == L'i');
+            if (wchConversion == L'p')
+            {
+                snprintf(szSpec + ichSpec, sizeof(szSpec) - ichSpec, "p");
+                snprintf(szNumber, sizeof(szNumber), szSpec, va_arg(argList, void*));
+            }
+            else if ((size == SIZE_LONGLONG) || (size == SIZE_PTR))
+            {
+                snprintf(szSpec + ichSpec, sizeof(szSpec) - ichSpec, "ll%c", (char)wchConversion);
+                long long ll = (size == SIZE_PTR) ? (long long)va_arg(argList, intptr_t) : va_arg(argList, long long);
+                snprintf(szNumber, sizeof(szNumber), szSpec, ll);
+            }
+            else
+            {
+                snprintf(szSpec + ichSpec, sizeof(szSpec) - ichSpec, "%c", (char)wchConversion);
+                int i = va_arg(argList, int);
+                if (size == SIZE_SHORT)
+                {
+                    i = fSigned ? (short)i : (unsigned short)i;
+                }
+                snprintf(szNumber, sizeof(szNumber), szSpec, i);
+            }
+
+            for (const char* psz = szNumber; *psz != 0; psz++)
+            {
+                _Put(&out, (WCHAR)*psz);
+            }
+        }
+        else
+        {
+            // Nothing the providers use; copy it so the mistake shows.
+            _Put(&out, L'%');
+            if (wchConversion == 0)
+            {
+                break;
+            }
+            _Put(&out, wchConversion);
+        }
+    }
+    return _Finish(&out);
+}
+
+HRESULT StringCchPrintfW(LPWSTR pszDest, size_t cchDest, LPCWSTR pszFormat, ...)
+{
+    va_list argList;
+    va_start(argList, pszFormat);
+    HRESULT hr = StringCchVPrintfW(pszDest, cchDest, pszFormat, argList);
+    va_end(argList);
+    return hr;
+}
+
+HRESULT StringCbCopyW(LPWSTR pszDest, size_t cbDest, LPCWSTR pszSrc)
+{
+    return StringCchCopyW(pszDest, cbDest / sizeof(WCHAR), pszSrc);
+}
+
+HRESULT StringCbCopyNW(LPWSTR pszDest, size_t cbDest, LPCWSTR pszSrc, size_t cbToCopy)
+{
+    return StringCchCopyNW(pszDest, cbDest / sizeof(WCHAR), pszSrc, cbToCopy / sizeof(WCHAR));
+}
+
+HRESULT StringCbCatW(LPWSTR pszDest, size_t cbDest, LPCWSTR pszSrc)
+{
+    return StringCchCatW(pszDest, cbDest / sizeof(WCHAR), pszSrc);
+}
+
+HRESULT StringCbLengthW(LPCWSTR psz, size_t cbMax, size_t* pcbLength)
+{
+    size_t cch;
+    HRESULT hr = StringCchLengthW(psz, cbMax / sizeof(WCHAR), &cch);
+    if (pcbLength != NULL)
+    {
+        *pcbLength = cch * sizeof(WCHAR);
+    }
+    return hr;
+}
+
+HRESULT StringCbPrintfW(LPWSTR pszDest, size_t cbDest, LPCWSTR pszFormat, ...)
+{
+    va_list argList;
+    va_start(argList, pszFormat);
+    HRESULT hr = StringCchVPrintfW(pszDest, cbDest / sizeof(WCHAR), pszFormat, argList);
+    va_end(argList);
+    return hr;
+}
+
+HRESULT StringCchPrintfA(LPSTR pszDest, size_t cchDest, LPCSTR pszFormat, ...)
+{
+    HRESULT hr = STRSAFE_E_INVALID_PARAMETER;
+    if ((cchDest != 0) && (cchDest <= STRSAFE_MAX_CCH))
+    {
+        va_list argList;
+        va_start(argList, pszFormat);
+        int cch = vsnprintf(pszDest, cchDest, pszFormat, argList);
+        va_end(argList);
+        hr = ((cch >= 0) && ((size_t)cch < cchDest)) ? S_OK : STRSAFE_E_INSUFFICIENT_BUFFER;
+    }
+    return hr;
+}
+
+// Memory //////////////////////////////////////////////////////////////////
+
+HANDLE GetProcessHeap()
+{
+    static int s_heap;
+    return &s_heap;
+}
+
+LPVOID HeapAlloc(HANDLE hHeap, DWORD dwFlags, SIZE_T cb)
+{
+    UNREFERENCED_PARAMETER(hHeap);
+    return (dwFlags & HEAP_ZERO_MEMORY) ? calloc(1, cb ? cb : 1) : malloc(cb ? cb : 1);
+}
+
+LPVOID HeapReAlloc(HANDLE hHeap, DWORD dwFlags, LPVOID pv, SIZE_T cb)
+{
+    UNREFERENCED_PARAMETER(hHeap);
+    UNREFERENCED_PARAMETER(dwFlags);
+    return realloc(pv, cb ? cb : 1);
+}
+
+BOOL HeapFree(HANDLE hHeap, DWORD dwFlags, LPVOID pv)
+{
+    UNREFERENCED_PARAMETER(hHeap);
+    UNREFERENCED_PARAMETER(dwFlags);
+    free(pv);
+    return TRUE;
+}
+
+HLOCAL LocalAlloc(UINT uFlags, SIZE_T uBytes)
+{
+    return (uFlags & LMEM_ZEROINIT) ? calloc(1, uBytes ? uBytes : 1) : malloc(uBytes ? uBytes : 1);
+}
+
+HLOCAL LocalFree(HLOCAL hMem)
+{
+    free(hMem);
+    return NULL;
+}
+
+// Synchronization /////////////////////////////////////////////////////////
+
+void InitializeCriticalSection(LPCRITICAL_SECTION pcs)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&pcs->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+BOOL InitializeCriticalSectionAndSpinCount(LPCRITICAL_SECTION pcs, DWORD dwSpinCount)
+{
+    UNREFERENCED_PARAMETER(dwSpinCount);
+    InitializeCriticalSection(pcs);
+    return TRUE;
+}
+
+void DeleteCriticalSection(LPCRITICAL_SECTION pcs)
+{
+    pthread_mutex_destroy(&pcs->mutex);
+}
+
+void EnterCriticalSection(LPCRITICAL_SECTION pcs)
+{
+    pthread_mutex_lock(&pcs->mutex);
+}
+
+BOOL TryEnterCriticalSection(LPCRITICAL_SECTION pcs)
+{
+    return (pthread_mutex_trylock(&pcs->mutex) == 0);
+}
+
+void LeaveCriticalSection(LPCRITICAL_SECTION pcs)
+{
+    pthread_mutex_unlock(&pcs->mutex);
+}
+
+// One lock for every INIT_ONCE; they're rare and run once.
+static pthread_mutex_t s_mutexInitOnce = PTHREAD_MUTEX_INITIALIZER;
+
+BOOL InitOnceExecuteOnce(PINIT_ONCE InitOnce, PINIT_ONCE_FN InitFn, PVOID Parameter, LPVOID* Context)
+{
+    BOOL fResult = TRUE;
+    if (__atomic_load_n(&InitOnce->Ptr, __ATOMIC_ACQUIRE) == NULL)
+    {
+        pthread_mutex_lock(&s_mutexInitOnce);
+        if (InitOnce->Ptr == NULL)
+        {
+            PVOID pvContext = NULL;
+            fResult = InitFn(InitOnce, Parameter, &pvContext);
+            if (fResult)
+            {
+                __atomic_store_n(&InitOnce->Ptr, (PVOID)((ULONG_PTR)pvContext | 1), __ATOMIC_RELEASE);
+            }
+        }
+        pthread_mutex_unlock(&s_mutexInitOnce);
+    }
+    if (fResult && (Context != NULL))
+    {
+        *Context = (PVOID)((ULONG_PTR)InitOnce->Ptr & ~(ULONG_PTR)3);
+    }
+    return fResult;
+}
+
+static void* _ThreadStart(void* pv)
+{
+    SHIM_HANDLE* ph = (SHIM_HANDLE*)pv;
+    return (void*)(ULONG_PTR)ph->pfnStart(ph->pvParameter);
+}
+
+HANDLE CreateThread(LPSECURITY_ATTRIBUTES lpThreadAttributes, SIZE_T dwStackSize, LPTHREAD_START_ROUTINE lpStartAddress,
+                    LPVOID lpParameter, DWORD dwCreationFlags, LPDWORD lpThreadId)
+{
+    UNREFERENCED_PARAMETER(lpThreadAttributes);
+    UNREFERENCED_PARAMETER(dwCreationFlags);
+
+    SHIM_HANDLE* ph = _HandleAlloc(SHT_THREAD);
+    if (ph != NULL)
+    {
+        ph->pfnStart = lpStartAddress;
+        ph->pvParameter = lpParameter;
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (dwStackSize != 0)
+        {
+            pthread_attr_setstacksize(&attr, dwStackSize);
+        }
+        if (pthread_create(&ph->thread, &attr, _ThreadStart, ph) != 0)
+        {
+            delete ph;
+            ph = NULL;
+            SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        }
+        pthread_attr_destroy(&attr);
+    }
+
+    if ((ph != NULL) && (lpThreadId != NULL))
+    {
+        *lpThreadId = (DWORD)(ULONG_PTR)ph;
+    }
+    return ph;
+}
+
+HANDLE CreateEventW(LPSECURITY_ATTRIBUTES lpEventAttributes, BOOL bManualReset, BOOL bInitialState, LPCWSTR lpName)
+{
+    UNREFERENCED_PARAMETER(lpEventAttributes);
+    UNREFERENCED_PARAMETER(lpName);
+
+    SHIM_HANDLE* ph = _HandleAlloc(SHT_EVENT);
+    if (ph != NULL)
+    {
+        pthread_mutex_init(&ph->mutex, NULL);
+        pthread_cond_init(&ph->cond, NULL);
+        ph->fManualReset = !!bManualReset;
+        ph->fSignaled = !!bInitialState;
+    }
+    return ph;
+}
+
+BOOL SetEvent(HANDLE hEvent)
+{
+    SHIM_HANDLE* ph = (SHIM_HANDLE*)hEvent;
+    pthread_mutex_lock(&ph->mutex);
+    ph->fSignaled = true;
+    pthread_cond_broadcast(&ph->cond);
+    pthread_mutex_unlock(&ph->mutex);
+    return TRUE;
+}
+
+BOOL ResetEvent(HANDLE hEvent)
+{
+    SHIM_HANDLE* ph = (SHIM_HANDLE*)hEvent;
+    pthread_mutex_lock(&ph->mutex);
+    ph->fSignaled = false;
+    pthread_mutex_unlock(&ph->mutex);
+    return TRUE;
+}
+
+DWORD WaitForSingleObject(HANDLE hHandle, DWORD dwMilliseconds)
+{
+    SHIM_HANDLE* ph = (SHIM_HANDLE*)hHandle;
+    DWORD dwResult = WAIT_FAILED;
+    if (ph->type == SHT_THREAD)
+    {
+        // Only an infinite wait is supported for a thread, which is all a host needs.
+        if (!ph->fJoined)
+        {
+            pthread_join(ph->thread, NULL);
+            ph->fJoined = true;
+        }
+        dwResult = WAIT_OBJECT_0;
+    }
+    else if (ph->type == SHT_EVENT)
+    {
+        struct timespec tsDeadline;
+        clock_gettime(CLOCK_REALTIME, &tsDeadline);
+        tsDeadline.tv_sec += dwMilliseconds / 1000;
+        tsDeadline.tv_nsec += (long)(dwMilliseconds % 1000) * 1000000;
+        if (tsDeadline.tv_nsec >= 1000000000)
+        {
+            tsDeadline.tv_sec++;
+            tsDeadline.tv_nsec -= 1000000000;
+        }
+
+        pthread_mutex_lock(&ph->mutex);
+        int iError = 0;
+        while (!ph->fSignaled && (iError == 0))
+        {
+            iError = (dwMilliseconds == INFINITE) ? pthread_cond_wait(&ph->cond, &ph->mutex)
+                                                  : pthread_cond_timedwait(&ph->cond, &ph->mutex, &tsDeadline);
+        }
+        if (ph->fSignaled)
+        {
+            dwResult = WAIT_OBJECT_0;
+            if (!ph->fManualReset)
+            {
+                ph->fSignaled = false;
+            }
+        }
+        else
+        {
+            dwResult = WAIT_TIMEOUT;
+        }
+        pthread_mutex_unlock(&ph->mutex);
+    }
+    return dwResult;
+}
+
+BOOL CloseHandle(HANDLE hObject)
+{
+    SHIM_HANDLE* ph = (SHIM_HANDLE*)hObject;
+    BOOL fResult = (ph != NULL) && (ph != INVALID_HANDLE_VALUE);
+    if (fResult)
+    {
+        if (ph->type == SHT_THREAD)
+        {
+            if (!ph->fJoined)
+            {
+                pthread_detach(ph->thread);
+            }
+        }
+        else if (ph->type == SHT_EVENT)
+        {
+            pthread_cond_destroy(&ph->cond);
+            pthread_mutex_destroy(&ph->mutex);
+        }
+        delete ph;
+    }
+    else
+    {
+        SetLastError(ERROR_INVALID_HANDLE);
+    }
+    return fResult;
+}
+
+void Sleep(DWORD dwMilliseconds)
+{
+    usleep((useconds_t)dwMilliseconds * 1000);
+}
+
+DWORD GetCurrentThreadId()
+{
+    return (DWORD)syscall(SYS_gettid);
+}
+
+void GetSystemInfo(LPSYSTEM_INFO lpSystemInfo)
+{
+    long cProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+    lpSystemInfo->dwNumberOfProcessors = (cProcessors > 0) ? (DWORD)cProcessors : 1;
+}
+
+// Time ////////////////////////////////////////////////////////////////////
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* lpPerformanceCount)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    lpPerformanceCount->QuadPart = (LONGLONG)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* lpFrequency)
+{
+    lpFrequency->QuadPart = 1000000000;
+    return TRUE;
+}
+
+DWORD GetTickCount()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (DWORD)((ULONGLONG)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+// FILETIME counts 100ns intervals from 1601, the Unix epoch 11644473600
+// seconds later.
+void GetSystemTimeAsFileTime(LPFILETIME lpSystemTimeAsFileTime)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ULONGLONG ull = ((ULONGLONG)ts.tv_sec + 11644473600ULL) * 10000000 + ts.tv_nsec / 100;
+    lpSystemTimeAsFileTime->dwLowDateTime = (DWORD)ull;
+    lpSystemTimeAsFileTime->dwHighDateTime = (DWORD)(ull >> 32);
+}
+
+// Modules, files and the registry /////////////////////////////////////////
+
+typedef BOOL (*PFN_DLLMAIN)(HINSTANCE hinstDll, DWORD dwReason, void* pvReserved);
+
+// The modules loaded, so DllMain runs once per load rather than once per call.
+#define SHIM_MODULES_MAX    16
+
+struct SHIM_MODULE
+{
+    void*   pvHandle;
+    LONG    cLoads;
+};
+
+static SHIM_MODULE s_rgModule[SHIM_MODULES_MAX];
+static pthread_mutex_t s_mutexModules = PTHREAD_MUTEX_INITIALIZER;
+
+static void _CallDllMain(void* pvHandle, DWORD dwReason)
+{
+    PFN_DLLMAIN pfnDllMain = (PFN_DLLMAIN)dlsym(pvHandle, "DllMain");
+    Dl_info info;
+    if ((pfnDllMain != NULL) && dladdr((const void*)pfnDllMain, &info))
+    {
+        pfnDllMain((HINSTANCE)info.dli_fbase, dwReason, NULL);
+    }
+}
+
+HMODULE LoadLibraryA(LPCSTR lpLibFileName)
+{
+    void* pv = dlopen(lpLibFileName, RTLD_NOW | RTLD_LOCAL);
+    if (pv != NULL)
+    {
+        pthread_mutex_lock(&s_mutexModules);
+        SHIM_MODULE* pModule = NULL;
+        SHIM_MODULE* pFree = NULL;
+        for (DWORD i = 0; (pModule == NULL) && (i < SHIM_MODULES_MAX); i++)
+        {
+            if (s_rgModule[i].pvHandle == pv)
+            {
+                pModule = &s_rgModule[i];
+            }
+            else if ((pFree == NULL) && (s_rgModule[i].pvHandle == NULL))
+            {
+                pFree = &s_rgModule[i];
+            }
+        }
+        if ((pModule == NULL) && (pFree != NULL))
+        {
+            pModule = pFree;
+            pModule->pvHandle = pv;
+            _CallDllMain(pv, DLL_PROCESS_ATTACH);
+        }
+        if (pModule != NULL)
+        {
+            pModule->cLoads++;
+        }
+        pthread_mutex_unlock(&s_mutexModules);
+    }
+    else
+    {
+        fprintf(stderr, "LoadLibrary: %s\n", dlerror());
+        SetLastError(ERROR_MOD_NOT_FOUND);
+    }
+    return (HMODULE)pv;
+}
+
+HMODULE LoadLibraryW(LPCWSTR lpLibFileName)
+{
+    char szPath[MAX_PATH * 4];
+    ShimWideToNarrow(lpLibFileName, szPath, ARRAYSIZE(szPath));
+    return LoadLibraryA(szPath);
+}
+
+FARPROC GetProcAddress(HMODULE hModule, LPCSTR lpProcName)
+{
+    FARPROC pfn = (FARPROC)dlsym(hModule, lpProcName);
+    if (pfn == NULL)
+    {
+        SetLastError(ERROR_PROC_NOT_FOUND);
+    }
+    return pfn;
+}
+
+BOOL FreeLibrary(HMODULE hLibModule)
+{
+    pthread_mutex_lock(&s_mutexModules);
+    for (DWORD i = 0; i < SHIM_MODULES_MAX; i++)
+    {
+        if ((s_rgModule[i].pvHandle == hLibModule) && (--s_rgModule[i].cLoads == 0))
+        {
+            _CallDllMain(hLibModule, DLL_PROCESS_DETACH);
+            s_rgModule[i].pvHandle = NULL;
+        }
+    }
+    pthread_mutex_unlock(&s_mutexModules);
+    return (dlclose(hLibModule) == 0);
+}
+
+BOOL DisableThreadLibraryCalls(HMODULE hLibModule)
+{
+    UNREFERENCED_PARAMETER(hLibModule);
+    return TRUE;
+}
+
+// A module is the base address it's loaded at, which dladdr maps back to a file.
+BOOL GetModuleHandleExW(DWORD dwFlags, LPCWSTR lpModuleName, HMODULE* phModule)
+{
+    BOOL fResult = FALSE;
+    *phModule = NULL;
+    Dl_info info;
+    if ((dwFlags & GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS) && dladdr((const void*)lpModuleName, &info))
+    {
+        *phModule = (HMODULE)info.dli_fbase;
+        fResult = TRUE;
+    }
+    else
+    {
+        SetLastError(ERROR_MOD_NOT_FOUND);
+    }
+    return fResult;
+}
+
+DWORD GetModuleFileNameW(HMODULE hModule, LPWSTR lpFilename, DWORD nSize)
+{
+    char szPath[MAX_PATH * 4] = "";
+    Dl_info info;
+    if (hModule == NULL)
+    {
+        ssize_t cb = readlink("/proc/self/exe", szPath, sizeof(szPath) - 1);
+        szPath[(cb > 0) ? cb : 0] = 0;
+    }
+    else if (dladdr((const void*)hModule, &info) && (info.dli_fname != NULL))
+    {
+        snprintf(szPath, sizeof(szPath), "%s", info.dli_fname);
+    }
+    else
+    {
+        // Not a base address, so a handle from LoadLibrary.
+        struct link_map* plm = NULL;
+        if ((dlinfo(hModule, RTLD_DI_LINKMAP, &plm) == 0) && (plm != NULL))
+        {
+            snprintf(szPath, sizeof(szPath), "%s", plm->l_name);
+        }
+    }
+
+    DWORD cch = 0;
+    if (nSize > 0)
+    {
+        ShimNarrowToWide(szPath, lpFilename, nSize);
+        cch = (DWORD)ShimWcslen(lpFilename);
+        if (strlen(szPath) >= nSize)
+        {
+            SetLastError(ERROR_INSUFFICIENT_BUFFER);
+            cch = nSize;
+        }
+    }
+    return cch;
+}
+
+HANDLE CreateFileW(LPCWSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes,
+                   DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile)
+{
+    UNREFERENCED_PARAMETER(lpFileName);
+    UNREFERENCED_PARAMETER(dwDesiredAccess);
+    UNREFERENCED_PARAMETER(dwShareMode);
+    UNREFERENCED_PARAMETER(lpSecurityAttributes);
+    UNREFERENCED_PARAMETER(dwCreationDisposition);
+    UNREFERENCED_PARAMETER(dwFlagsAndAttributes);
+    UNREFERENCED_PARAMETER(hTemplateFile);
+    SetLastError(ERROR_FILE_NOT_FOUND);
+    return INVALID_HANDLE_VALUE;
+}
+
+BOOL GetFileSizeEx(HANDLE hFile, PLARGE_INTEGER lpFileSize)
+{
+    UNREFERENCED_PARAMETER(hFile);
+    lpFileSize->QuadPart = 0;
+    SetLastError(ERROR_INVALID_HANDLE);
+    return FALSE;
+}
+
+HANDLE CreateFileMappingW(HANDLE hFile, LPSECURITY_ATTRIBUTES lpAttributes, DWORD flProtect,
+                          DWORD dwMaximumSizeHigh, DWORD dwMaximumSizeLow, LPCWSTR lpName)
+{
+    UNREFERENCED_PARAMETER(hFile);
+    UNREFERENCED_PARAMETER(lpAttributes);
+    UNREFERENCED_PARAMETER(flProtect);
+    UNREFERENCED_PARAMETER(dwMaximumSizeHigh);
+    UNREFERENCED_PARAMETER(dwMaximumSizeLow);
+    UNREFERENCED_PARAMETER(lpName);
+    SetLastError(ERROR_INVALID_HANDLE);
+    return NULL;
+}
+
+LPVOID MapViewOfFile(HANDLE hFileMappingObject, DWORD dwDesiredAccess, DWORD dwFileOffsetHigh,
+                     DWORD dwFileOffsetLow, SIZE_T dwNumberOfBytesToMap)
+{
+    UNREFERENCED_PARAMETER(hFileMappingObject);
+    UNREFERENCED_PARAMETER(dwDesiredAccess);
+    UNREFERENCED_PARAMETER(dwFileOffsetHigh);
+    UNREFERENCED_PARAMETER(dwFileOffsetLow);
+    UNREFERENCED_PARAMETER(dwNumberOfBytesToMap);
+    SetLastError(ERROR_INVALID_HANDLE);
+    return NULL;
+}
+
+BOOL UnmapViewOfFile(LPCVOID lpBaseAddress)
+{
+    UNREFERENCED_PARAMETER(lpBaseAddress);
+    return FALSE;
+}
+
+struct SHIM_REG_VALUE
+{
+    HKEY    hkey;
+    WCHAR   szSubKey[MAX_PATH];
+    WCHAR   szValue[MAX_PATH];
+    DWORD   dwType;
+    DWORD   cbData;
+    BYTE    rgbData[SHIM_REG_VALUE_CB_MAX];
+};
+
+static pthread_mutex_t s_mutexRegistry = PTHREAD_MUTEX_INITIALIZER;
+static SHIM_REG_VALUE s_rgRegValues[SHIM_REG_VALUES_MAX];
+static DWORD s_cRegValues = 0;
+
+// Call with s_mutexRegistry held.  Key and value names are case insensitive.
+static SHIM_REG_VALUE* _RegFind(HKEY hkey, LPCWSTR lpSubKey, LPCWSTR lpValue)
+{
+    for (DWORD i = 0; i < s_cRegValues; i++)
+    {
+        SHIM_REG_VALUE* pValue = &s_rgRegValues[i];
+        if ((pValue->hkey == hkey) &&
+            (0 == ShimWcsicmp(pValue->szSubKey, lpSubKey ? lpSubKey : L"")) &&
+            (0 == ShimWcsicmp(pValue->szValue, lpValue ? lpValue : L"")))
+        {
+            return pValue;
+        }
+    }
+    return NULL;
+}
+
+LONG ShimSetRegValue(HKEY hkey, LPCWSTR lpSubKey, LPCWSTR lpValue, DWORD dwType, const void* pvData, DWORD cbData)
+{
+    if (cbData > SHIM_REG_VALUE_CB_MAX)
+    {
+        return ERROR_INVALID_PARAMETER;
+    }
+
+    LONG lResult = ERROR_SUCCESS;
+    pthread_mutex_lock(&s_mutexRegistry);
+    SHIM_REG_VALUE* pValue = _RegFind(hkey, lpSubKey, lpValue);
+    if (pvData == NULL)
+    {
+        if (pValue != NULL)
+        {
+            *pValue = s_rgRegValues[--s_cRegValues];
+        }
+    }
+    else
+    {
+        if (pValue == NULL)
+        {
+            if (s_cRegValues < ARRAYSIZE(s_rgRegValues))
+            {
+                pValue = &s_rgRegValues[s_cRegValues++];
+                pValue->hkey = hkey;
+                StringCchCopyW(pValue->szSubKey, ARRAYSIZE(pValue->szSubKey), lpSubKey ? lpSubKey : L"");
+                StringCchCopyW(pValue->szValue, ARRAYSIZE(pValue->szValue), lpValue ? lpValue : L"");
+            }
+            else
+            {
+                lResult = ERROR_OUTOFMEMORY;
+            }
+        }
+        if (pValue != NULL)
+        {
+            pValue->dwType = dwType;
+            pValue->cbData = cbData;
+            memcpy(pValue->rgbData, pvData, cbData);
+        }
+    }
+    pthread_mutex_unlock(&s_mutexRegistry);
+    return lResult;
+}
+
+// The RRF_RT_* flag for each type is the bit of the same number.
+LONG RegGetValueW(HKEY hkey, LPCWSTR lpSubKey, LPCWSTR lpValue, DWORD dwFlags, LPDWORD pdwType, PVOID pvData, LPDWORD pcbData)
+{
+    LONG lResult;
+    pthread_mutex_lock(&s_mutexRegistry);
+    const SHIM_REG_VALUE* pValue = _RegFind(hkey, lpSubKey, lpValue);
+    if (pValue == NULL)
+    {
+        lResult = ERROR_FILE_NOT_FOUND;
+    }
+    else if (0 == (dwFlags & (1 << pValue->dwType)))
+    {
+        lResult = ERROR_UNSUPPORTED_TYPE;
+    }
+    else
+    {
+        if (pdwType != NULL)
+        {
+            *pdwType = pValue->dwType;
+        }
+
+        lResult = ERROR_SUCCESS;
+        if (pvData != NULL)
+        {
+            if ((pcbData == NULL) || (*pcbData < pValue->cbData))
+            {
+                lResult = ERROR_MORE_DATA;
+            }
+            else
+            {
+                memcpy(pvData, pValue->rgbData, pValue->cbData);
+            }
+        }
+        if (pcbData != NULL)
+        {
+            *pcbData = pValue->cbData;
+        }
+    }
+    pthread_mutex_unlock(&s_mutexRegistry);
+    return lResult;
+}
+
+// Locales and the machine /////////////////////////////////////////////////
+
+LANGID GetUserDefaultUILanguage()
+{
+    return 0x0409;
+}
+
+int LCIDToLocaleName(LCID Locale, LPWSTR lpName, int cchName, DWORD dwFlags)
+{
+    UNREFERENCED_PARAMETER(Locale);
+    UNREFERENCED_PARAMETER(dwFlags);
+    const WCHAR wszName[] = L"en-US";
+    int cch = 0;
+    if ((lpName == NULL) || (cchName == 0))
+    {
+        cch = ARRAYSIZE(wszName);
+    }
+    else if (SUCCEEDED(StringCchCopyW(lpName, cchName, wszName)))
+    {
+        cch = ARRAYSIZE(wszName);
+    }
+    else
+    {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+    }
+    return cch;
+}
+
+// The host name up to its first dot, in capitals and cut to NetBIOS length.
+BOOL GetComputerNameW(LPWSTR lpBuffer, LPDWORD nSize)
+{
+    char szHost[256] = "LOCALHOST";
+    gethostname(szHost, sizeof(szHost) - 1);
+    szHost[sizeof(szHost) - 1] = 0;
+
+    DWORD cch = 0;
+    while ((szHost[cch] != 0) && (szHost[cch] != '.') && (cch < MAX_COMPUTERNAME_LENGTH))
+    {
+        szHost[cch] = (char)toupper((unsigned char)szHost[cch]);
+        cch++;
+    }
+    szHost[cch] = 0;
+
+    BOOL fResult = FALSE;
+    if (*nSize > cch)
+    {
+        ShimNarrowToWide(szHost, lpBuffer, *nSize);
+        *nSize = cch;
+        fResult = TRUE;
+    }
+    else
+    {
+        *nSize = cch + 1;
+        SetLastError(ERROR_BUFFER_OVERFLOW);
+    }
+    return fResult;
+}
+
+void OutputDebugStringA(LPCSTR lpOutputString)
+{
+    fputs(lpOutputString, stderr);
+}
+
+void OutputDebugStringW(LPCWSTR lpOutputString)
+{
+    char sz[1024];
+    ShimWideToNarrow(lpOutputString, sz, ARRAYSIZE(sz));
+    OutputDebugStringA(sz);
+}
+
+// User and GDI ////////////////////////////////////////////////////////////
+
+int MessageBoxW(HWND hWnd, LPCWSTR lpText, LPCWSTR lpCaption, UINT uType)
+{
+    UNREFERENCED_PARAMETER(hWnd);
+    UNREFERENCED_PARAMETER(uType);
+    char szText[512];
+    char szCaption[128];
+    ShimWideToNarrow(lpText, szText, ARRAYSIZE(szText));
+    ShimWideToNarrow(lpCaption, szCaption, ARRAYSIZE(szCaption));
+    fprintf(stderr, "MessageBox: %s: %s\n", szCaption, szText);
+    return IDOK;
+}
+
+HBITMAP LoadBitmapW(HINSTANCE hInstance, LPCWSTR lpBitmapName)
+{
+    UNREFERENCED_PARAMETER(hInstance);
+    UNREFERENCED_PARAMETER(lpBitmapName);
+    return new (std::nothrow) HBITMAP__();
+}
+
+BOOL DeleteObject(HGDIOBJ ho)
+{
+    delete (HBITMAP)ho;
+    return (ho != NULL);
+}
+
+// CNG /////////////////////////////////////////////////////////////////////
+
+// SHA-256 and SHA-512 (FIPS 180-4) share everything but the word size, so
+// both keep their state in 64 bit words and SHA-256 uses the low halves.
+struct SHIM_ALG
+{
+    bool    fSha512;
+    bool    fHmac;
+};
+
+struct SHIM_HASH
+{
+    bool        fSha512;
+    bool        fHmac;
+    bool        fAllocated;             // The object is ours to free.
+    ULONGLONG   rgullState[8];
+    BYTE        rgbBlock[128];
+    DWORD       cbBlock;
+    ULONGLONG   ullLength;
+    BYTE        rgbKey[128];            // HMAC key, padded to a block.
+};
+
+static const uint32_t c_rgulSha256K[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static const ULONGLONG c_rgullSha512K[80] =
+{
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL,
+};
+
+static const ULONGLONG c_rgullSha256Init[8] =
+{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static const ULONGLONG c_rgullSha512Init[8] =
+{
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+static inline uint32_t _Ror32(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline ULONGLONG _Ror64(ULONGLONG x, int n)
+{
+    return (x >> n) | (x << (64 - n));
+}
+
+static void _Sha256Block(ULONGLONG* rgullState, const BYTE* pb)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = ((uint32_t)pb[4 * i] << 24) | ((uint32_t)pb[4 * i + 1] << 16) | ((uint32_t)pb[4 * i + 2] << 8) | pb[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = _Ror32(w[i - 15], 7) ^ _Ror32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = _Ror32(w[i - 2], 17) ^ _Ror32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t v[8];
+    for (int i = 0; i < 8; i++)
+    {
+        v[i] = (uint32_t)rgullState[i];
+    }
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = v[7] + (_Ror32(v[4], 6) ^ _Ror32(v[4], 11) ^ _Ror32(v[4], 25)) + ((v[4] & v[5]) ^ (~v[4] & v[6]))
+                      + c_rgulSha256K[i] + w[i];
+        uint32_t t2 = (_Ror32(v[0], 2) ^ _Ror32(v[0], 13) ^ _Ror32(v[0], 22)) + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(&v[1], &v[0], 7 * sizeof(v[0]));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        rgullState[i] = (uint32_t)(rgullState[i] + v[i]);
+    }
+}
+
+static void _Sha512Block(ULONGLONG* rgullState, const BYTE* pb)
+{
+    ULONGLONG w[80];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = 0;
+        for (int j = 0; j < 8; j++)
+        {
+            w[i] = (w[i] << 8) | pb[8 * i + j];
+        }
+    }
+    for (int i = 16; i < 80; i++)
+    {
+        ULONGLONG s0 = _Ror64(w[i - 15], 1) ^ _Ror64(w[i - 15], 8) ^ (w[i - 15] >> 7);
+        ULONGLONG s1 = _Ror64(w[i - 2], 19) ^ _Ror64(w[i - 2], 61) ^ (w[i - 2] >> 6);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    ULONGLONG v[8];
+    memcpy(v, rgullState, sizeof(v));
+    for (int i = 0; i < 80; i++)
+    {
+        ULONGLONG t1 = v[7] + (_Ror64(v[4], 14) ^ _Ror64(v[4], 18) ^ _Ror64(v[4], 41)) + ((v[4] & v[5]) ^ (~v[4] & v[6]))
+                       + c_rgullSha512K[i] + w[i];
+        ULONGLONG t2 = (_Ror64(v[0], 28) ^ _Ror64(v[0], 34) ^ _Ror64(v[0], 39)) + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(&v[1], &v[0], 7 * sizeof(v[0]));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        rgullState[i] += v[i];
+    }
+}
+
+static DWORD _HashBlockSize(const SHIM_HASH* ph)
+{
+    return ph->fSha512 ? 128 : 64;
+}
+
+static DWORD _HashDigestSize(bool fSha512)
+{
+    return fSha512 ? 64 : 32;
+}
+
+static void _HashUpdate(SHIM_HASH* ph, const BYTE* pb, SIZE_T cb)
+{
+    const DWORD cbBlockSize = _HashBlockSize(ph);
+    ph->ullLength += cb;
+    while (cb > 0)
+    {
+        DWORD cbCopy = cbBlockSize - ph->cbBlock;
+        if (cbCopy > cb)
+        {
+            cbCopy = (DWORD)cb;
+        }
+        memcpy(ph->rgbBlock + ph->cbBlock, pb, cbCopy);
+        ph->cbBlock += cbCopy;
+        pb += cbCopy;
+        cb -= cbCopy;
+        if (ph->cbBlock == cbBlockSize)
+        {
+            if (ph->fSha512)
+            {
+                _Sha512Block(ph->rgullState, ph->rgbBlock);
+            }
+            else
+            {
+                _Sha256Block(ph->rgullState, ph->rgbBlock);
+            }
+            ph->cbBlock = 0;
+        }
+    }
+}
+
+// Starts a hash, and for HMAC feeds it the key xored with the inner pad.
+static void _HashStart(SHIM_HASH* ph)
+{
+    memcpy(ph->rgullState, ph->fSha512 ? c_rgullSha512Init : c_rgullSha256Init, sizeof(ph->rgullState));
+    ph->cbBlock = 0;
+    ph->ullLength = 0;
+    if (ph->fHmac)
+    {
+        BYTE rgbPad[128];
+        for (DWORD i = 0; i < _HashBlockSize(ph); i++)
+        {
+            rgbPad[i] = ph->rgbKey[i] ^ 0x36;
+        }
+        _HashUpdate(ph, rgbPad, _HashBlockSize(ph));
+    }
+}
+
+// Pads the message, and writes the big endian digest to pbDigest.
+static void _HashEnd(SHIM_HASH* ph, BYTE* pbDigest)
+{
+    const DWORD cbBlockSize = _HashBlockSize(ph);
+    const DWORD cbLength = ph->fSha512 ? 16 : 8;
+    const ULONGLONG ullBits = ph->ullLength * 8;
+
+    BYTE rgbPad[128 + 16] = { 0x80 };
+    DWORD cbPad = cbBlockSize - (ph->cbBlock % cbBlockSize);
+    if (cbPad < 1 + cbLength)
+    {
+        cbPad += cbBlockSize;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        rgbPad[cbPad - 1 - i] = (BYTE)(ullBits >> (8 * i));
+    }
+    _HashUpdate(ph, rgbPad, cbPad);
+
+    const DWORD cbWord = ph->fSha512 ? 8 : 4;
+    for (DWORD i = 0; i < _HashDigestSize(ph->fSha512); i++)
+    {
+        pbDigest[i] = (BYTE)(ph->rgullState[i / cbWord] >> (8 * (cbWord - 1 - i % cbWord)));
+    }
+}
+
+NTSTATUS BCryptOpenAlgorithmProvider(BCRYPT_ALG_HANDLE* phAlgorithm, LPCWSTR pszAlgId, LPCWSTR pszImplementation, ULONG dwFlags)
+{
+    UNREFERENCED_PARAMETER(pszImplementation);
+    *phAlgorithm = NULL;
+
+    bool fSha512;
+    if (0 == ShimWcscmp(pszAlgId, BCRYPT_SHA512_ALGORITHM))
+    {
+        fSha512 = true;
+    }
+    else if (0 == ShimWcscmp(pszAlgId, BCRYPT_SHA256_ALGORITHM))
+    {
+        fSha512 = false;
+    }
+    else
+    {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    SHIM_ALG* pAlg = new (std::nothrow) SHIM_ALG();
+    if (pAlg == NULL)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+    pAlg->fSha512 = fSha512;
+    pAlg->fHmac = (0 != (dwFlags & BCRYPT_ALG_HANDLE_HMAC_FLAG));
+    *phAlgorithm = pAlg;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS BCryptCloseAlgorithmProvider(BCRYPT_ALG_HANDLE hAlgorithm, ULONG dwFlags)
+{
+    UNREFERENCED_PARAMETER(dwFlags);
+    delete (SHIM_ALG*)hAlgorithm;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS BCryptGetProperty(BCRYPT_HANDLE hObject, LPCWSTR pszProperty, PUCHAR pbOutput, ULONG cbOutput, ULONG* pcbResult, ULONG dwFlags)
+{
+    UNREFERENCED_PARAMETER(dwFlags);
+    DWORD dwValue;
+    if (0 == ShimWcscmp(pszProperty, BCRYPT_OBJECT_LENGTH))
+    {
+        dwValue = sizeof(SHIM_HASH);
+    }
+    else if (0 == ShimWcscmp(pszProperty, BCRYPT_HASH_LENGTH))
+    {
+        dwValue = _HashDigestSize(((SHIM_ALG*)hObject)->fSha512);
+    }
+    else
+    {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    *pcbResult = sizeof(dwValue);
+    if (cbOutput < sizeof(dwValue))
+    {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+    memcpy(pbOutput, &dwValue, sizeof(dwValue));
+    return STATUS_SUCCESS;
+}
+
+// Every hash is reusable, as one opened with BCRYPT_HASH_REUSABLE_FLAG is.
+NTSTATUS BCryptCreateHash(BCRYPT_ALG_HANDLE hAlgorithm, BCRYPT_HASH_HANDLE* phHash, PUCHAR pbHashObject, ULONG cbHashObject,
+                          PUCHAR pbSecret, ULONG cbSecret, ULONG dwFlags)
+{
+    UNREFERENCED_PARAMETER(dwFlags);
+    *phHash = NULL;
+
+    const SHIM_ALG* pAlg = (SHIM_ALG*)hAlgorithm;
+    SHIM_HASH* ph;
+    if (pbHashObject == NULL)
+    {
+        ph = new (std::nothrow) SHIM_HASH();
+        if (ph == NULL)
+        {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+        ph->fAllocated = true;
+    }
+    else if (cbHashObject < sizeof(SHIM_HASH))
+    {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+    else
+    {
+        ph = new (pbHashObject) SHIM_HASH();
+    }
+
+    ph->fSha512 = pAlg->fSha512;
+    ph->fHmac = pAlg->fHmac;
+    if (ph->fHmac)
+    {
+        // A key longer than a block is hashed down first.
+        if (cbSecret > _HashBlockSize(ph))
+        {
+            ph->fHmac = false;
+            _HashStart(ph);
+            _HashUpdate(ph, pbSecret, cbSecret);
+            _HashEnd(ph, ph->rgbKey);
+            ph->fHmac = true;
+        }
+        else if (cbSecret > 0)
+        {
+            memcpy(ph->rgbKey, pbSecret, cbSecret);
+        }
+    }
+    _HashStart(ph);
+    *phHash = ph;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS BCryptHashData(BCRYPT_HASH_HANDLE hHash, PUCHAR pbInput, ULONG cbInput, ULONG dwFlags)
+{
+    UNREFERENCED_PARAMETER(dwFlags);
+    _HashUpdate((SHIM_HASH*)hHash, pbInput, cbInput);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS BCryptFinishHash(BCRYPT_HASH_HANDLE hHash, PUCHAR pbOutput, ULONG cbOutput, ULONG dwFlags)
+{
+    UNREFERENCED_PARAMETER(dwFlags);
+    SHIM_HASH* ph = (SHIM_HASH*)hHash;
+    if (cbOutput != _HashDigestSize(ph->fSha512))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    _HashEnd(ph, pbOutput);
+    if (ph->fHmac)
+    {
+        // Outer hash: H((key ^ opad) || inner digest).
+        BYTE rgbPad[128];
+        for (DWORD i = 0; i < _HashBlockSize(ph); i++)
+        {
+            rgbPad[i] = ph->rgbKey[i] ^ 0x5c;
+        }
+        ph->fHmac = false;
+        _HashStart(ph);
+        _HashUpdate(ph, rgbPad, _HashBlockSize(ph));
+        _HashUpdate(ph, pbOutput, cbOutput);
+        _HashEnd(ph, pbOutput);
+        ph->fHmac = true;
+    }
+    _HashStart(ph);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS BCryptDestroyHash(BCRYPT_HASH_HANDLE hHash)
+{
+    SHIM_HASH* ph = (SHIM_HASH*)hHash;
+    if (ph->fAllocated)
+    {
+        delete ph;
+    }
+    else
+    {
+        ph->~SHIM_HASH();
+    }
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS BCryptGenRandom(BCRYPT_ALG_HANDLE hAlgorithm, PUCHAR pbBuffer, ULONG cbBuffer, ULONG dwFlags)
+{
+    UNREFERENCED_PARAMETER(hAlgorithm);
+    UNREFERENCED_PARAMETER(dwFlags);
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return STATUS_UNSUCCESSFUL;
+    }
+    NTSTATUS status = STATUS_SUCCESS;
+    while ((cbBuffer > 0) && (status == STATUS_SUCCESS))
+    {
+        ssize_t cbRead = read(fd, pbBuffer, cbBuffer);
+        if (cbRead > 0)
+        {
+            pbBuffer += cbRead;
+            cbBuffer -= (ULONG)cbRead;
+        }
+        else if ((cbRead < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        else
+        {
+            status = STATUS_UNSUCCESSFUL;
+        }
+    }
+    close(fd);
+    return status;
+}
+
+// CryptoAPI ///////////////////////////////////////////////////////////////
+
+static int _Base64Value(char ch)
+{
+    if ((ch >= 'A') && (ch <= 'Z')) return ch - 'A';
+    if ((ch >= 'a') && (ch <= 'z')) return ch - 'a' + 26;
+    if ((ch >= '0') && (ch <= '9')) return ch - '0' + 52;
+    if (ch == '+') return 62;
+    if (ch == '/') return 63;
+    return -1;
+}
+
+// Skips whitespace and stops at the first '=', as CRYPT_STRING_BASE64 does.
+BOOL CryptStringToBinaryA(LPCSTR pszString, DWORD cchString, DWORD dwFlags, BYTE* pbBinary,
+                          DWORD* pcbBinary, DWORD* pdwSkip, DWORD* pdwFlags)
+{
+    if ((CRYPT_STRING_BASE64 != dwFlags) || !pszString || !pcbBinary)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+    if (0 == cchString)
+    {
+        cchString = (DWORD)strlen(pszString);
+    }
+
+    DWORD cb = 0;
+    DWORD dwBits = 0;
+    DWORD cBits = 0;
+    bool fTooSmall = false;
+    for (DWORD i = 0; (i < cchString) && (pszString[i] != '='); i++)
+    {
+        char ch = pszString[i];
+        if ((ch == ' ') || (ch == '\t') || (ch == '\r') || (ch == '\n'))
+        {
+            continue;
+        }
+        int nValue = _Base64Value(ch);
+        if (nValue < 0)
+        {
+            SetLastError(ERROR_INVALID_DATA);
+            return FALSE;
+        }
+        dwBits = (dwBits << 6) | (DWORD)nValue;
+        cBits += 6;
+        if (cBits >= 8)
+        {
+            cBits -= 8;
+            if (pbBinary && (cb < *pcbBinary))
+            {
+                pbBinary[cb] = (BYTE)(dwBits >> cBits);
+            }
+            else if (pbBinary)
+            {
+                fTooSmall = true;
+            }
+            cb++;
+        }
+    }
+
+    *pcbBinary = cb;
+    if (pdwSkip)
+    {
+        *pdwSkip = 0;
+    }
+    if (pdwFlags)
+    {
+        *pdwFlags = CRYPT_STRING_BASE64;
+    }
+    if (fTooSmall)
+    {
+        SetLastError(ERROR_MORE_DATA);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// LSA and credentials /////////////////////////////////////////////////////
+
+static pthread_mutex_t s_mutexLsa = PTHREAD_MUTEX_INITIALIZER;
+static DWORD s_dwLsaRoundTripUs = 0;
+static DWORD s_dwLsaLockedUs = 0;
+static SHIM_LSA_STATS s_lsaStats = {};
+
+static void _SleepUs(DWORD dwMicroseconds)
+{
+    if (dwMicroseconds > 0)
+    {
+        struct timespec ts;
+        ts.tv_sec = dwMicroseconds / 1000000;
+        ts.tv_nsec = (long)(dwMicroseconds % 1000000) * 1000;
+        nanosleep(&ts, NULL);
+    }
+}
+
+// Every LSA call is bracketed by these, which play the latency and count
+// how often the lock was fought over.
+static void _LsaEnter()
+{
+    _SleepUs(__atomic_load_n(&s_dwLsaRoundTripUs, __ATOMIC_RELAXED));
+
+    __atomic_add_fetch(&s_lsaStats.cCalls, 1, __ATOMIC_RELAXED);
+    if (pthread_mutex_trylock(&s_mutexLsa) != 0)
+    {
+        LARGE_INTEGER liStart;
+        LARGE_INTEGER liEnd;
+        QueryPerformanceCounter(&liStart);
+        pthread_mutex_lock(&s_mutexLsa);
+        QueryPerformanceCounter(&liEnd);
+        __atomic_add_fetch(&s_lsaStats.cContended, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&s_lsaStats.llWaitTicks, liEnd.QuadPart - liStart.QuadPart, __ATOMIC_RELAXED);
+    }
+}
+
+static void _LsaLeave()
+{
+    _SleepUs(__atomic_load_n(&s_dwLsaLockedUs, __ATOMIC_RELAXED));
+    pthread_mutex_unlock(&s_mutexLsa);
+}
+
+void ShimSetLsaLatency(DWORD dwRoundTripUs, DWORD dwLockedUs)
+{
+    __atomic_store_n(&s_dwLsaRoundTripUs, dwRoundTripUs, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_dwLsaLockedUs, dwLockedUs, __ATOMIC_RELAXED);
+}
+
+void ShimGetLsaStats(SHIM_LSA_STATS* pStats)
+{
+    pStats->cCalls = __atomic_load_n(&s_lsaStats.cCalls, __ATOMIC_RELAXED);
+    pStats->cContended = __atomic_load_n(&s_lsaStats.cContended, __ATOMIC_RELAXED);
+    pStats->llWaitTicks = __atomic_load_n(&s_lsaStats.llWaitTicks, __ATOMIC_RELAXED);
+}
+
+void ShimResetLsaStats()
+{
+    __atomic_store_n(&s_lsaStats.cCalls, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_lsaStats.cContended, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_lsaStats.llWaitTicks, 0, __ATOMIC_RELAXED);
+}
+
+NTSTATUS LsaConnectUntrusted(PHANDLE LsaHandle)
+{
+    _LsaEnter();
+    *LsaHandle = _HandleAlloc(SHT_LSA);
+    _LsaLeave();
+    return (*LsaHandle != NULL) ? STATUS_SUCCESS : STATUS_INSUFFICIENT_RESOURCES;
+}
+
+// The package IDs are only stand-ins; a provider just passes them back.
+NTSTATUS LsaLookupAuthenticationPackage(HANDLE LsaHandle, PLSA_STRING PackageName, PULONG AuthenticationPackage)
+{
+    static const struct
+    {
+        const char* pszName;
+        ULONG       ulPackage;
+    }
+    s_rgPackage[] =
+    {
+        { NEGOSSP_NAME_A, 0 },
+        { MSV1_0_PACKAGE_NAME, 1 },
+        { MICROSOFT_KERBEROS_NAME_A, 2 },
+    };
+
+    NTSTATUS status = STATUS_INVALID_PARAMETER;
+    if ((LsaHandle != NULL) && (((SHIM_HANDLE*)LsaHandle)->type == SHT_LSA))
+    {
+        _LsaEnter();
+        status = STATUS_NO_SUCH_PACKAGE;
+        for (DWORD i = 0; i < ARRAYSIZE(s_rgPackage); i++)
+        {
+            if ((strlen(s_rgPackage[i].pszName) == PackageName->Length) &&
+                !strncmp(s_rgPackage[i].pszName, PackageName->Buffer, PackageName->Length))
+            {
+                *AuthenticationPackage = s_rgPackage[i].ulPackage;
+                status = STATUS_SUCCESS;
+            }
+        }
+        _LsaLeave();
+    }
+    return status;
+}
+
+NTSTATUS LsaDeregisterLogonProcess(HANDLE LsaHandle)
+{
+    _LsaEnter();
+    _LsaLeave();
+    CloseHandle(LsaHandle);
+    return STATUS_SUCCESS;
+}
+
+ULONG LsaNtStatusToWinError(NTSTATUS Status)
+{
+    ULONG ulError;
+    switch (Status)
+    {
+    case STATUS_SUCCESS:
+        ulError = ERROR_SUCCESS;
+        break;
+    case STATUS_INSUFFICIENT_RESOURCES:
+        ulError = ERROR_NOT_ENOUGH_MEMORY;
+        break;
+    case STATUS_INVALID_PARAMETER:
+        ulError = ERROR_INVALID_PARAMETER;
+        break;
+    case STATUS_ACCESS_DENIED:
+        ulError = ERROR_ACCESS_DENIED;
+        break;
+    case STATUS_NOT_SUPPORTED:
+        ulError = ERROR_NOT_SUPPORTED;
+        break;
+    case STATUS_LOGON_FAILURE:
+        ulError = 1326;                         // ERROR_LOGON_FAILURE
+        break;
+    default:
+        ulError = 317;                          // ERROR_MR_MID_NOT_FOUND
+        break;
+    }
+    return ulError;
+}
+
+#define PROTECTED_PREFIX        L"@@D"
+#define PROTECTED_PREFIX_CCH    3
+
+BOOL CredProtectW(BOOL fAsSelf, LPWSTR pszCredentials, DWORD cchCredentials, LPWSTR pszProtectedCredentials,
+                  DWORD* pcchMaxChars, CRED_PROTECTION_TYPE* ProtectionType)
+{
+    UNREFERENCED_PARAMETER(fAsSelf);
+
+    BOOL fResult = FALSE;
+    const DWORD cchNeeded = PROTECTED_PREFIX_CCH + cchCredentials;
+    if ((pszProtectedCredentials == NULL) || (*pcchMaxChars < cchNeeded))
+    {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+    }
+    else
+    {
+        memcpy(pszProtectedCredentials, PROTECTED_PREFIX, PROTECTED_PREFIX_CCH * sizeof(WCHAR));
+        memcpy(pszProtectedCredentials + PROTECTED_PREFIX_CCH, pszCredentials, cchCredentials * sizeof(WCHAR));
+        if (ProtectionType != NULL)
+        {
+            *ProtectionType = CredUserProtection;
+        }
+        fResult = TRUE;
+    }
+    *pcchMaxChars = cchNeeded;
+    return fResult;
+}
+
+BOOL CredIsProtectedW(LPWSTR pszProtectedCredentials, CRED_PROTECTION_TYPE* pProtectionType)
+{
+    *pProtectionType = ShimWcsnicmp(pszProtectedCredentials, PROTECTED_PREFIX, PROTECTED_PREFIX_CCH) ? CredUnprotected : CredUserProtection;
+    return TRUE;
+}
+
+BOOL CredPackAuthenticationBufferW(DWORD dwFlags, LPWSTR pszUserName, LPWSTR pszPassword,
+                                   PBYTE pPackedCredentials, DWORD* pcbPackedCredentials)
+{
+    UNREFERENCED_PARAMETER(dwFlags);
+    UNREFERENCED_PARAMETER(pszUserName);
+    UNREFERENCED_PARAMETER(pszPassword);
+    UNREFERENCED_PARAMETER(pPackedCredentials);
+    UNREFERENCED_PARAMETER(pcbPackedCredentials);
+    SetLastError(ERROR_NOT_SUPPORTED);
+    return FALSE;
+}
+
+BOOL CredUnPackAuthenticationBufferW(DWORD dwFlags, PVOID pAuthBuffer, DWORD cbAuthBuffer,
+                                     LPWSTR pszUserName, DWORD* pcchMaxUserName,
+                                     LPWSTR pszDomainName, DWORD* pcchMaxDomainName,
+                                     LPWSTR pszPassword, DWORD* pcchMaxPassword)
+{
+    UNREFERENCED_PARAMETER(dwFlags);
+    UNREFERENCED_PARAMETER(pAuthBuffer);
+    UNREFERENCED_PARAMETER(cbAuthBuffer);
+    UNREFERENCED_PARAMETER(pszUserName);
+    UNREFERENCED_PARAMETER(pcchMaxUserName);
+    UNREFERENCED_PARAMETER(pszDomainName);
+    UNREFERENCED_PARAMETER(pcchMaxDomainName);
+    UNREFERENCED_PARAMETER(pszPassword);
+    UNREFERENCED_PARAMETER(pcchMaxPassword);
+    SetLastError(ERROR_NOT_SUPPORTED);
+    return FALSE;
+}
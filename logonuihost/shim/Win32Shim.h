@@ -0,0 +1,1066 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Just enough of Win32, COM and the credential provider headers for the
+// providers and LogonUIHost to build and run on other systems.  Every
+// Windows header they include is a file in this directory that includes
+// this one, so the sources build unchanged with
+//
+//     -D_WIN32 -fshort-wchar -I logonuihost/shim
+//
+// WCHAR is wchar_t, two bytes with -fshort-wchar, so L"" strings are UTF-16
+// as they are on Windows; the C library's wide functions assume four, so
+// the few the providers use are replaced below.
+//
+// Win32Shim.cpp, linked into the host, implements the functions.  Things
+// that have no meaning off Windows behave as they would on a machine where
+// they find nothing: the registry has no values, files can't be opened,
+// and resources load as placeholders.  LSA and CredProtect are stand-ins
+// that accept what a provider gives them.  CoTaskMemAlloc calls a
+// registered IMallocSpy as COM does, so a host counts allocations the same
+// way on both systems.
+
+#pragma once
+
+// Lets code that runs on both systems use the few Shim* extensions.
+#define WIN32_SHIM
+
+// Everything from the C and C++ libraries comes first, since they use some
+// of the names the SAL annotations below take over.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <wchar.h>
+#include <time.h>
+#include <new>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#ifndef UNICODE
+#define UNICODE
+#endif
+
+// The compiler's target macros, under the names code written for Visual C++ tests.
+#if defined(__x86_64__)
+#define _M_X64      100
+#define _M_AMD64    100
+#elif defined(__i386__)
+#define _M_IX86     600
+#elif defined(__aarch64__)
+#define _M_ARM64    1
+#endif
+
+// Calling conventions and declarations ////////////////////////////////////
+
+#define WINAPI
+#define STDMETHODCALLTYPE
+#define STDAPICALLTYPE
+#define CALLBACK
+#define __stdcall
+#define __cdecl
+#define FAR
+#define NEAR
+#define CONST               const
+#define DECLSPEC_NOTHROW
+#define DECLSPEC_UUID(x)
+#define DECLSPEC_NOVTABLE
+#define MIDL_INTERFACE(x)   struct
+#define interface           struct
+
+#define EXTERN_C            extern "C"
+#define STDAPI              EXTERN_C HRESULT
+#define STDAPI_(type)       EXTERN_C type
+#define STDMETHOD(method)           virtual HRESULT method
+#define STDMETHOD_(type, method)    virtual type method
+#define STDMETHODIMP                HRESULT
+#define STDMETHODIMP_(type)         type
+#define IFACEMETHODIMP              STDMETHODIMP
+#define IFACEMETHODIMP_(type)       STDMETHODIMP_(type)
+#define PURE                        = 0
+
+// SAL annotations.
+#define __in
+#define __in_opt
+#define __out
+#define __out_opt
+#define __inout
+#define __inout_opt
+#define __deref_out
+#define __deref_out_opt
+#define __deref_inout
+#define __reserved
+#define __override
+#define __in_bcount(x)
+#define __in_ecount(x)
+#define __out_bcount(x)
+#define __out_ecount(x)
+#define __out_bcount_opt(x)
+#define __out_ecount_opt(x)
+#define __out_bcount_part(x, y)
+#define __out_ecount_part(x, y)
+#define __inout_bcount(x)
+#define __inout_ecount(x)
+#define __deref_out_bcount(x)
+#define __deref_out_ecount(x)
+#define __out_range(x, y)
+#define __in_range(x, y)
+#define __success(x)
+#define __checkReturn
+#define __drv_freesMem(x)
+#define __drv_allocatesMem(x)
+
+// Types ///////////////////////////////////////////////////////////////////
+
+typedef int                 BOOL;
+typedef unsigned char       BYTE;
+typedef unsigned char       UCHAR;
+typedef char                CHAR;
+typedef uint16_t            WORD;
+typedef uint16_t            USHORT;
+typedef int16_t             SHORT;
+typedef unsigned int        UINT;
+typedef int                 INT;
+typedef uint32_t            DWORD;
+typedef uint32_t            ULONG;
+typedef int32_t             LONG;
+typedef long long           LONGLONG;
+typedef unsigned long long  ULONGLONG;
+typedef uint64_t            DWORD64;
+typedef uintptr_t           ULONG_PTR;
+typedef uintptr_t           DWORD_PTR;
+typedef uintptr_t           UINT_PTR;
+typedef intptr_t            LONG_PTR;
+typedef intptr_t            INT_PTR;
+typedef size_t              SIZE_T;
+typedef int32_t             HRESULT;
+typedef LONG                NTSTATUS;
+typedef DWORD               LCID;
+typedef WORD                LANGID;
+typedef BYTE                BOOLEAN;
+typedef wchar_t             WCHAR;
+typedef WCHAR               TCHAR;
+typedef WCHAR               OLECHAR;
+typedef void                VOID;
+
+typedef void*               PVOID;
+typedef void*               LPVOID;
+typedef const void*         LPCVOID;
+typedef BYTE*               PBYTE;
+typedef BYTE*               LPBYTE;
+typedef BOOL*               PBOOL;
+typedef BOOL*               LPBOOL;
+typedef DWORD*              PDWORD;
+typedef DWORD*              LPDWORD;
+typedef ULONG*              PULONG;
+typedef LONG*               PLONG;
+typedef USHORT*             PUSHORT;
+typedef CHAR*               PCHAR;
+typedef UCHAR*              PUCHAR;
+typedef CHAR*               PSTR;
+typedef CHAR*               LPSTR;
+typedef const CHAR*         PCSTR;
+typedef const CHAR*         LPCSTR;
+typedef WCHAR*              PWCHAR;
+typedef WCHAR*              PWSTR;
+typedef WCHAR*              LPWSTR;
+typedef const WCHAR*        PCWSTR;
+typedef const WCHAR*        LPCWSTR;
+typedef const WCHAR*        LPCTSTR;
+typedef WCHAR*              LPTSTR;
+typedef const OLECHAR*      LPCOLESTR;
+typedef OLECHAR*            LPOLESTR;
+
+typedef void*               HANDLE;
+typedef HANDLE*             PHANDLE;
+typedef HANDLE*             LPHANDLE;
+
+#define DECLARE_HANDLE(name)    struct name##__ { int unused; }; typedef struct name##__* name
+DECLARE_HANDLE(HINSTANCE);
+DECLARE_HANDLE(HWND);
+DECLARE_HANDLE(HKEY);
+DECLARE_HANDLE(HBITMAP);
+DECLARE_HANDLE(HICON);
+DECLARE_HANDLE(HDC);
+typedef HINSTANCE           HMODULE;
+typedef HANDLE              HGDIOBJ;
+typedef HANDLE              HLOCAL;
+typedef HKEY*               PHKEY;
+typedef INT_PTR (*FARPROC)();
+
+typedef union _LARGE_INTEGER
+{
+    struct
+    {
+        DWORD   LowPart;
+        LONG    HighPart;
+    };
+    LONGLONG    QuadPart;
+} LARGE_INTEGER, *PLARGE_INTEGER;
+
+typedef union _ULARGE_INTEGER
+{
+    struct
+    {
+        DWORD   LowPart;
+        DWORD   HighPart;
+    };
+    ULONGLONG   QuadPart;
+} ULARGE_INTEGER, *PULARGE_INTEGER;
+
+typedef struct _LUID
+{
+    DWORD   LowPart;
+    LONG    HighPart;
+} LUID, *PLUID;
+
+typedef struct _SECURITY_ATTRIBUTES
+{
+    DWORD   nLength;
+    LPVOID  lpSecurityDescriptor;
+    BOOL    bInheritHandle;
+} SECURITY_ATTRIBUTES, *LPSECURITY_ATTRIBUTES;
+
+// Constants and macros ////////////////////////////////////////////////////
+
+#define TRUE                1
+#define FALSE               0
+#define INFINITE            0xFFFFFFFF
+#define MAX_PATH            260
+#define MAX_COMPUTERNAME_LENGTH 15
+#define INVALID_HANDLE_VALUE    ((HANDLE)(LONG_PTR)-1)
+#define MAXDWORD            0xFFFFFFFF
+#define MAXULONGLONG        ((ULONGLONG)~((ULONGLONG)0))
+
+#define ARRAYSIZE(a)        (sizeof(a) / sizeof((a)[0]))
+#define _countof(a)         ARRAYSIZE(a)
+#define UNREFERENCED_PARAMETER(p)   ((void)(p))
+#define C_ASSERT(e)         static_assert(e, #e)
+#define FIELD_OFFSET(type, field)   ((LONG)offsetof(type, field))
+#define MAKEINTRESOURCE(i)  ((LPWSTR)(ULONG_PTR)(WORD)(i))
+#define LOWORD(l)           ((WORD)((DWORD_PTR)(l) & 0xFFFF))
+#define HIWORD(l)           ((WORD)(((DWORD_PTR)(l) >> 16) & 0xFFFF))
+#define MAKELANGID(p, s)    ((((WORD)(s)) << 10) | (WORD)(p))
+#define MAKELCID(lgid, srtid)   ((DWORD)((((DWORD)((WORD)(srtid))) << 16) | ((DWORD)((WORD)(lgid)))))
+#define SORT_DEFAULT        0
+
+#define ZeroMemory(p, cb)           memset((p), 0, (cb))
+#define FillMemory(p, cb, b)        memset((p), (b), (cb))
+#define CopyMemory(d, s, cb)        memcpy((d), (s), (cb))
+#define MoveMemory(d, s, cb)        memmove((d), (s), (cb))
+#define RtlZeroMemory(p, cb)        memset((p), 0, (cb))
+#define RtlCopyMemory(d, s, cb)     memcpy((d), (s), (cb))
+
+// HRESULTs and errors /////////////////////////////////////////////////////
+
+#define _HRESULT_TYPEDEF_(x)    ((HRESULT)(x))
+#define S_OK                    _HRESULT_TYPEDEF_(0)
+#define S_FALSE                 _HRESULT_TYPEDEF_(1)
+#define E_NOTIMPL               _HRESULT_TYPEDEF_(0x80004001)
+#define E_NOINTERFACE           _HRESULT_TYPEDEF_(0x80004002)
+#define E_POINTER               _HRESULT_TYPEDEF_(0x80004003)
+#define E_ABORT                 _HRESULT_TYPEDEF_(0x80004004)
+#define E_FAIL                  _HRESULT_TYPEDEF_(0x80004005)
+#define E_UNEXPECTED            _HRESULT_TYPEDEF_(0x8000FFFF)
+#define E_ACCESSDENIED          _HRESULT_TYPEDEF_(0x80070005)
+#define E_HANDLE                _HRESULT_TYPEDEF_(0x80070006)
+#define E_OUTOFMEMORY           _HRESULT_TYPEDEF_(0x8007000E)
+#define E_INVALIDARG            _HRESULT_TYPEDEF_(0x80070057)
+#define E_NOT_SUFFICIENT_BUFFER _HRESULT_TYPEDEF_(0x8007007A)
+#define CLASS_E_NOAGGREGATION   _HRESULT_TYPEDEF_(0x80040110)
+#define CLASS_E_CLASSNOTAVAILABLE   _HRESULT_TYPEDEF_(0x80040111)
+#define CO_E_CLASSSTRING        _HRESULT_TYPEDEF_(0x800401F3)
+#define NTE_BAD_KEY             _HRESULT_TYPEDEF_(0x80090003)
+
+#define SUCCEEDED(hr)           (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)              (((HRESULT)(hr)) < 0)
+#define HRESULT_CODE(hr)        ((hr) & 0xFFFF)
+#define FACILITY_WIN32          7
+#define FACILITY_NT_BIT         0x10000000
+#define HRESULT_FROM_NT(x)      ((HRESULT)((x) | FACILITY_NT_BIT))
+
+inline HRESULT HRESULT_FROM_WIN32(unsigned long x)
+{
+    return (HRESULT)(x) <= 0 ? (HRESULT)(x) : (HRESULT)(((x) & 0x0000FFFF) | (FACILITY_WIN32 << 16) | 0x80000000);
+}
+
+#define ERROR_SUCCESS               0L
+#define NO_ERROR                    0L
+#define ERROR_FILE_NOT_FOUND        2L
+#define ERROR_PATH_NOT_FOUND        3L
+#define ERROR_ACCESS_DENIED         5L
+#define ERROR_INVALID_HANDLE        6L
+#define ERROR_NOT_ENOUGH_MEMORY     8L
+#define ERROR_INVALID_DATA          13L
+#define ERROR_OUTOFMEMORY           14L
+#define ERROR_NOT_SUPPORTED         50L
+#define ERROR_INVALID_PARAMETER     87L
+#define ERROR_BUFFER_OVERFLOW       111L
+#define ERROR_INSUFFICIENT_BUFFER   122L
+#define ERROR_MOD_NOT_FOUND         126L
+#define ERROR_PROC_NOT_FOUND        127L
+#define ERROR_FILE_TOO_LARGE        223L
+#define ERROR_MORE_DATA             234L
+#define ERROR_ARITHMETIC_OVERFLOW   534L
+#define ERROR_NOT_FOUND             1168L
+#define ERROR_NO_UNICODE_TRANSLATION 1113L
+#define ERROR_UNSUPPORTED_TYPE      1630L
+#define ERROR_CANCELLED             1223L
+#define WAIT_OBJECT_0               0L
+#define WAIT_TIMEOUT                258L
+#define WAIT_FAILED                 0xFFFFFFFF
+
+#define STATUS_WAIT_0               ((NTSTATUS)0x00000000L)
+
+EXTERN_C DWORD GetLastError();
+EXTERN_C void SetLastError(DWORD dwErrCode);
+
+// GUIDs and COM ///////////////////////////////////////////////////////////
+
+typedef struct _GUID
+{
+    uint32_t    Data1;
+    uint16_t    Data2;
+    uint16_t    Data3;
+    uint8_t     Data4[8];
+} GUID;
+
+typedef GUID            IID;
+typedef GUID            CLSID;
+typedef GUID*           LPGUID;
+typedef CLSID*          LPCLSID;
+typedef const GUID&     REFGUID;
+typedef const IID&      REFIID;
+typedef const CLSID&    REFCLSID;
+
+inline bool IsEqualGUID(REFGUID rguid1, REFGUID rguid2)
+{
+    return !memcmp(&rguid1, &rguid2, sizeof(GUID));
+}
+#define IsEqualIID(riid1, riid2)        IsEqualGUID(riid1, riid2)
+#define IsEqualCLSID(rclsid1, rclsid2)  IsEqualGUID(rclsid1, rclsid2)
+
+inline bool operator==(REFGUID rguid1, REFGUID rguid2)
+{
+    return IsEqualGUID(rguid1, rguid2);
+}
+
+inline bool operator!=(REFGUID rguid1, REFGUID rguid2)
+{
+    return !IsEqualGUID(rguid1, rguid2);
+}
+
+// initguid.h redefines this to define the GUID rather than declare it.
+#define DEFINE_GUID(name, l, w1, w2, b1, b2, b3, b4, b5, b6, b7, b8) \
+    EXTERN_C const GUID name
+
+#define GUID_NULL   (*(const GUID*)&g_ShimGuidNull)
+EXTERN_C const GUID g_ShimGuidNull;
+
+EXTERN_C const IID IID_IUnknown;
+EXTERN_C const IID IID_IClassFactory;
+EXTERN_C const IID IID_IMallocSpy;
+EXTERN_C const IID IID_ICredentialProvider;
+EXTERN_C const IID IID_ICredentialProviderCredential;
+EXTERN_C const IID IID_ICredentialProviderCredentialEvents;
+EXTERN_C const IID IID_ICredentialProviderEvents;
+
+interface IUnknown
+{
+    STDMETHOD(QueryInterface)(REFIID riid, void** ppvObject) PURE;
+    STDMETHOD_(ULONG, AddRef)() PURE;
+    STDMETHOD_(ULONG, Release)() PURE;
+};
+typedef IUnknown* LPUNKNOWN;
+
+interface IClassFactory : public IUnknown
+{
+    STDMETHOD(CreateInstance)(IUnknown* pUnkOuter, REFIID riid, void** ppvObject) PURE;
+    STDMETHOD(LockServer)(BOOL fLock) PURE;
+};
+
+interface IMallocSpy : public IUnknown
+{
+    STDMETHOD_(SIZE_T, PreAlloc)(SIZE_T cbRequest) PURE;
+    STDMETHOD_(void*, PostAlloc)(void* pActual) PURE;
+    STDMETHOD_(void*, PreFree)(void* pRequest, BOOL fSpyed) PURE;
+    STDMETHOD_(void, PostFree)(BOOL fSpyed) PURE;
+    STDMETHOD_(SIZE_T, PreRealloc)(void* pRequest, SIZE_T cbRequest, void** ppNewRequest, BOOL fSpyed) PURE;
+    STDMETHOD_(void*, PostRealloc)(void* pActual, BOOL fSpyed) PURE;
+    STDMETHOD_(void*, PreGetSize)(void* pRequest, BOOL fSpyed) PURE;
+    STDMETHOD_(SIZE_T, PostGetSize)(SIZE_T cbActual, BOOL fSpyed) PURE;
+    STDMETHOD_(void*, PreDidAlloc)(void* pRequest, BOOL fSpyed) PURE;
+    STDMETHOD_(int, PostDidAlloc)(void* pRequest, BOOL fSpyed, int fActual) PURE;
+    STDMETHOD_(void, PreHeapMinimize)() PURE;
+    STDMETHOD_(void, PostHeapMinimize)() PURE;
+};
+
+typedef enum tagCOINIT
+{
+    COINIT_APARTMENTTHREADED    = 0x2,
+    COINIT_MULTITHREADED        = 0x0,
+    COINIT_DISABLE_OLE1DDE      = 0x4,
+} COINIT;
+
+#define CLSCTX_INPROC_SERVER    0x1
+
+STDAPI CoInitializeEx(LPVOID pvReserved, DWORD dwCoInit);
+STDAPI_(void) CoUninitialize();
+STDAPI CoRegisterMallocSpy(IMallocSpy* pMallocSpy);
+STDAPI CoRevokeMallocSpy();
+STDAPI_(LPVOID) CoTaskMemAlloc(SIZE_T cb);
+STDAPI_(LPVOID) CoTaskMemRealloc(LPVOID pv, SIZE_T cb);
+STDAPI_(void) CoTaskMemFree(LPVOID pv);
+STDAPI CLSIDFromString(LPCOLESTR lpsz, LPCLSID pclsid);
+
+// shlwapi's QISearch.
+struct QITAB
+{
+    const IID*  piid;
+    DWORD       dwOffset;
+};
+typedef QITAB* LPQITAB;
+typedef const QITAB* LPCQITAB;
+
+#define OFFSETOFCLASS(base, derived) \
+    ((DWORD)(DWORD_PTR)(static_cast<base*>((derived*)8)) - 8)
+#define QITABENTMULTI(Cthis, Ifoo, Iimpl)   { &IID_##Ifoo, OFFSETOFCLASS(Iimpl, Cthis) }
+#define QITABENT(Cthis, Ifoo)               QITABENTMULTI(Cthis, Ifoo, Ifoo)
+
+STDAPI QISearch(void* that, LPCQITAB pqit, REFIID riid, void** ppv);
+STDAPI SHStrDupW(LPCWSTR psz, LPWSTR* ppwsz);
+#define SHStrDup SHStrDupW
+
+// Wide strings ////////////////////////////////////////////////////////////
+
+// The C library's wide functions assume a four-byte wchar_t.
+EXTERN_C size_t ShimWcslen(const WCHAR* pwz);
+EXTERN_C WCHAR* ShimWcsrchr(const WCHAR* pwz, WCHAR wch);
+EXTERN_C WCHAR* ShimWcschr(const WCHAR* pwz, WCHAR wch);
+EXTERN_C int ShimWcscmp(const WCHAR* pwz1, const WCHAR* pwz2);
+EXTERN_C int ShimWcsicmp(const WCHAR* pwz1, const WCHAR* pwz2);
+EXTERN_C int ShimWcsnicmp(const WCHAR* pwz1, const WCHAR* pwz2, size_t cch);
+
+#undef wcslen
+#undef wcsrchr
+#undef wcschr
+#undef wcscmp
+#define wcslen      ShimWcslen
+#define wcsrchr     ShimWcsrchr
+#define wcschr      ShimWcschr
+#define wcscmp      ShimWcscmp
+#define _wcsicmp    ShimWcsicmp
+#define _wcsnicmp   ShimWcsnicmp
+
+inline int lstrlenW(LPCWSTR pwz)
+{
+    return pwz ? (int)ShimWcslen(pwz) : 0;
+}
+
+inline int lstrlenA(LPCSTR psz)
+{
+    return psz ? (int)strlen(psz) : 0;
+}
+inline int lstrcmpA(LPCSTR psz1, LPCSTR psz2)
+{
+    return strcmp(psz1, psz2);
+}
+#define lstrlen lstrlenW
+
+// Converts for logging; anything outside ASCII comes out as '?'.
+EXTERN_C void ShimWideToNarrow(const WCHAR* pwz, char* psz, size_t cch);
+EXTERN_C void ShimNarrowToWide(const char* psz, WCHAR* pwz, size_t cch);
+
+// strsafe.  The printf functions know %s (wide), %c, %d, %i, %u, %x, %X,
+// the l, ll and I64 sizes, and widths and precisions.
+#define STRSAFE_E_INSUFFICIENT_BUFFER   _HRESULT_TYPEDEF_(0x8007007A)
+#define STRSAFE_E_INVALID_PARAMETER     _HRESULT_TYPEDEF_(0x80070057)
+#define STRSAFE_MAX_CCH                 2147483647
+
+STDAPI StringCchCopyW(LPWSTR pszDest, size_t cchDest, LPCWSTR pszSrc);
+STDAPI StringCchCopyNW(LPWSTR pszDest, size_t cchDest, LPCWSTR pszSrc, size_t cchToCopy);
+STDAPI StringCchCatW(LPWSTR pszDest, size_t cchDest, LPCWSTR pszSrc);
+STDAPI StringCchLengthW(LPCWSTR psz, size_t cchMax, size_t* pcchLength);
+STDAPI StringCchPrintfW(LPWSTR pszDest, size_t cchDest, LPCWSTR pszFormat, ...);
+STDAPI StringCchVPrintfW(LPWSTR pszDest, size_t cchDest, LPCWSTR pszFormat, va_list argList);
+STDAPI StringCbCopyW(LPWSTR pszDest, size_t cbDest, LPCWSTR pszSrc);
+STDAPI StringCbCopyNW(LPWSTR pszDest, size_t cbDest, LPCWSTR pszSrc, size_t cbToCopy);
+STDAPI StringCbCatW(LPWSTR pszDest, size_t cbDest, LPCWSTR pszSrc);
+STDAPI StringCbLengthW(LPCWSTR psz, size_t cbMax, size_t* pcbLength);
+STDAPI StringCbPrintfW(LPWSTR pszDest, size_t cbDest, LPCWSTR pszFormat, ...);
+STDAPI StringCchPrintfA(LPSTR pszDest, size_t cchDest, LPCSTR pszFormat, ...);
+#define StringCchCopy       StringCchCopyW
+#define StringCchCat        StringCchCatW
+#define StringCchPrintf     StringCchPrintfW
+#define StringCchLength     StringCchLengthW
+#define StringCbCopy        StringCbCopyW
+#define StringCbPrintf      StringCbPrintfW
+
+// intsafe.
+#define INTSAFE_E_ARITHMETIC_OVERFLOW   _HRESULT_TYPEDEF_(0x80070216)
+#define USHORT_MAX      0xFFFF
+#define DWORD_MAX       0xFFFFFFFF
+
+inline HRESULT SizeTToUShort(size_t cb, USHORT* pus)
+{
+    HRESULT hr = (cb <= USHORT_MAX) ? S_OK : INTSAFE_E_ARITHMETIC_OVERFLOW;
+    *pus = SUCCEEDED(hr) ? (USHORT)cb : 0xFFFF;
+    return hr;
+}
+
+inline HRESULT SizeTToDWord(size_t cb, DWORD* pdw)
+{
+    HRESULT hr = (cb <= DWORD_MAX) ? S_OK : INTSAFE_E_ARITHMETIC_OVERFLOW;
+    *pdw = SUCCEEDED(hr) ? (DWORD)cb : DWORD_MAX;
+    return hr;
+}
+
+inline HRESULT UShortMult(USHORT us1, USHORT us2, USHORT* pus)
+{
+    return SizeTToUShort((size_t)us1 * us2, pus);
+}
+
+inline HRESULT UShortAdd(USHORT us1, USHORT us2, USHORT* pus)
+{
+    return SizeTToUShort((size_t)us1 + us2, pus);
+}
+
+inline HRESULT DWordAdd(DWORD dw1, DWORD dw2, DWORD* pdw)
+{
+    return SizeTToDWord((size_t)dw1 + dw2, pdw);
+}
+
+inline HRESULT DWordMult(DWORD dw1, DWORD dw2, DWORD* pdw)
+{
+    return SizeTToDWord((size_t)dw1 * dw2, pdw);
+}
+
+inline HRESULT SizeTMult(size_t cb1, size_t cb2, size_t* pcb)
+{
+    HRESULT hr = (cb2 == 0 || cb1 <= SIZE_MAX / cb2) ? S_OK : INTSAFE_E_ARITHMETIC_OVERFLOW;
+    *pcb = SUCCEEDED(hr) ? cb1 * cb2 : SIZE_MAX;
+    return hr;
+}
+
+inline HRESULT SizeTAdd(size_t cb1, size_t cb2, size_t* pcb)
+{
+    HRESULT hr = (cb1 <= SIZE_MAX - cb2) ? S_OK : INTSAFE_E_ARITHMETIC_OVERFLOW;
+    *pcb = SUCCEEDED(hr) ? cb1 + cb2 : SIZE_MAX;
+    return hr;
+}
+
+// Memory //////////////////////////////////////////////////////////////////
+
+#define HEAP_ZERO_MEMORY    0x00000008
+
+EXTERN_C HANDLE GetProcessHeap();
+EXTERN_C LPVOID HeapAlloc(HANDLE hHeap, DWORD dwFlags, SIZE_T cb);
+EXTERN_C LPVOID HeapReAlloc(HANDLE hHeap, DWORD dwFlags, LPVOID pv, SIZE_T cb);
+EXTERN_C BOOL HeapFree(HANDLE hHeap, DWORD dwFlags, LPVOID pv);
+#define LMEM_FIXED          0x0000
+#define LMEM_ZEROINIT       0x0040
+#define LPTR                (LMEM_FIXED | LMEM_ZEROINIT)
+
+EXTERN_C HLOCAL LocalAlloc(UINT uFlags, SIZE_T uBytes);
+EXTERN_C HLOCAL LocalFree(HLOCAL hMem);
+
+inline PVOID SecureZeroMemory(PVOID pv, SIZE_T cb)
+{
+    volatile char* pch = (volatile char*)pv;
+    while (cb--)
+    {
+        *pch++ = 0;
+    }
+    return pv;
+}
+
+// Synchronization /////////////////////////////////////////////////////////
+
+inline LONG InterlockedIncrement(LONG volatile* pl)
+{
+    return __sync_add_and_fetch(pl, 1);
+}
+
+inline LONG InterlockedDecrement(LONG volatile* pl)
+{
+    return __sync_sub_and_fetch(pl, 1);
+}
+
+inline LONG InterlockedExchangeAdd(LONG volatile* pl, LONG l)
+{
+    return __sync_fetch_and_add(pl, l);
+}
+
+inline LONG InterlockedExchange(LONG volatile* pl, LONG l)
+{
+    return __sync_lock_test_and_set(pl, l);
+}
+
+inline LONG InterlockedCompareExchange(LONG volatile* pl, LONG lExchange, LONG lComparand)
+{
+    return __sync_val_compare_and_swap(pl, lComparand, lExchange);
+}
+
+// Windows' long is LONG; here it's wider, so code that counts in a long still works.
+inline long InterlockedIncrement(long volatile* pl)
+{
+    return __sync_add_and_fetch(pl, 1);
+}
+
+inline long InterlockedDecrement(long volatile* pl)
+{
+    return __sync_sub_and_fetch(pl, 1);
+}
+
+inline LONGLONG InterlockedIncrement64(LONGLONG volatile* pll)
+{
+    return __sync_add_and_fetch(pll, 1);
+}
+
+inline LONGLONG InterlockedExchange64(LONGLONG volatile* pll, LONGLONG ll)
+{
+    return __sync_lock_test_and_set(pll, ll);
+}
+
+inline LONGLONG InterlockedCompareExchange64(LONGLONG volatile* pll, LONGLONG llExchange, LONGLONG llComparand)
+{
+    return __sync_val_compare_and_swap(pll, llComparand, llExchange);
+}
+
+inline PVOID InterlockedCompareExchangePointer(PVOID volatile* ppv, PVOID pvExchange, PVOID pvComparand)
+{
+    return __sync_val_compare_and_swap(ppv, pvComparand, pvExchange);
+}
+
+inline PVOID InterlockedExchangePointer(PVOID volatile* ppv, PVOID pv)
+{
+    return __sync_lock_test_and_set(ppv, pv);
+}
+
+// Recursive, as a critical section is.
+typedef struct _CRITICAL_SECTION
+{
+    pthread_mutex_t mutex;
+} CRITICAL_SECTION, *LPCRITICAL_SECTION;
+
+EXTERN_C void InitializeCriticalSection(LPCRITICAL_SECTION pcs);
+EXTERN_C BOOL InitializeCriticalSectionAndSpinCount(LPCRITICAL_SECTION pcs, DWORD dwSpinCount);
+EXTERN_C void DeleteCriticalSection(LPCRITICAL_SECTION pcs);
+EXTERN_C void EnterCriticalSection(LPCRITICAL_SECTION pcs);
+EXTERN_C BOOL TryEnterCriticalSection(LPCRITICAL_SECTION pcs);
+EXTERN_C void LeaveCriticalSection(LPCRITICAL_SECTION pcs);
+
+typedef union _RTL_RUN_ONCE
+{
+    PVOID   Ptr;
+} INIT_ONCE, *PINIT_ONCE, *LPINIT_ONCE;
+#define INIT_ONCE_STATIC_INIT   { 0 }
+
+typedef BOOL (CALLBACK *PINIT_ONCE_FN)(PINIT_ONCE InitOnce, PVOID Parameter, PVOID* Context);
+EXTERN_C BOOL InitOnceExecuteOnce(PINIT_ONCE InitOnce, PINIT_ONCE_FN InitFn, PVOID Parameter, LPVOID* Context);
+
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID lpThreadParameter);
+EXTERN_C HANDLE CreateThread(LPSECURITY_ATTRIBUTES lpThreadAttributes, SIZE_T dwStackSize, LPTHREAD_START_ROUTINE lpStartAddress,
+                             LPVOID lpParameter, DWORD dwCreationFlags, LPDWORD lpThreadId);
+EXTERN_C HANDLE CreateEventW(LPSECURITY_ATTRIBUTES lpEventAttributes, BOOL bManualReset, BOOL bInitialState, LPCWSTR lpName);
+EXTERN_C BOOL SetEvent(HANDLE hEvent);
+EXTERN_C BOOL ResetEvent(HANDLE hEvent);
+EXTERN_C DWORD WaitForSingleObject(HANDLE hHandle, DWORD dwMilliseconds);
+EXTERN_C BOOL CloseHandle(HANDLE hObject);
+EXTERN_C void Sleep(DWORD dwMilliseconds);
+EXTERN_C DWORD GetCurrentThreadId();
+#define CreateEvent CreateEventW
+
+typedef struct _SYSTEM_INFO
+{
+    DWORD   dwNumberOfProcessors;
+} SYSTEM_INFO, *LPSYSTEM_INFO;
+EXTERN_C void GetSystemInfo(LPSYSTEM_INFO lpSystemInfo);
+
+// Time ////////////////////////////////////////////////////////////////////
+
+EXTERN_C BOOL QueryPerformanceCounter(LARGE_INTEGER* lpPerformanceCount);
+EXTERN_C BOOL QueryPerformanceFrequency(LARGE_INTEGER* lpFrequency);
+EXTERN_C DWORD GetTickCount();
+
+typedef struct _FILETIME
+{
+    DWORD   dwLowDateTime;
+    DWORD   dwHighDateTime;
+} FILETIME, *PFILETIME, *LPFILETIME;
+
+EXTERN_C void GetSystemTimeAsFileTime(LPFILETIME lpSystemTimeAsFileTime);
+
+// Modules, files and the registry /////////////////////////////////////////
+
+#define DLL_PROCESS_DETACH  0
+#define DLL_PROCESS_ATTACH  1
+#define DLL_THREAD_ATTACH   2
+#define DLL_THREAD_DETACH   3
+
+#define GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT    0x00000002
+#define GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS          0x00000004
+
+// LoadLibrary runs a module's DllMain when it's first loaded, as the loader
+// would, passing the base address it's loaded at as the instance; FreeLibrary
+// runs it again when the last load is freed.
+EXTERN_C HMODULE LoadLibraryW(LPCWSTR lpLibFileName);
+EXTERN_C HMODULE LoadLibraryA(LPCSTR lpLibFileName);
+EXTERN_C FARPROC GetProcAddress(HMODULE hModule, LPCSTR lpProcName);
+EXTERN_C BOOL FreeLibrary(HMODULE hLibModule);
+EXTERN_C BOOL DisableThreadLibraryCalls(HMODULE hLibModule);
+EXTERN_C BOOL GetModuleHandleExW(DWORD dwFlags, LPCWSTR lpModuleName, HMODULE* phModule);
+EXTERN_C DWORD GetModuleFileNameW(HMODULE hModule, LPWSTR lpFilename, DWORD nSize);
+#define LoadLibrary LoadLibraryW
+
+#define GENERIC_READ            0x80000000
+#define GENERIC_WRITE           0x40000000
+#define FILE_SHARE_READ         0x00000001
+#define FILE_SHARE_WRITE        0x00000002
+#define OPEN_EXISTING           3
+#define FILE_ATTRIBUTE_NORMAL   0x00000080
+#define PAGE_READONLY           0x02
+#define FILE_MAP_READ           0x0004
+
+EXTERN_C HANDLE CreateFileW(LPCWSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes,
+                            DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile);
+EXTERN_C BOOL GetFileSizeEx(HANDLE hFile, PLARGE_INTEGER lpFileSize);
+EXTERN_C HANDLE CreateFileMappingW(HANDLE hFile, LPSECURITY_ATTRIBUTES lpAttributes, DWORD flProtect,
+                                   DWORD dwMaximumSizeHigh, DWORD dwMaximumSizeLow, LPCWSTR lpName);
+EXTERN_C LPVOID MapViewOfFile(HANDLE hFileMappingObject, DWORD dwDesiredAccess, DWORD dwFileOffsetHigh,
+                              DWORD dwFileOffsetLow, SIZE_T dwNumberOfBytesToMap);
+EXTERN_C BOOL UnmapViewOfFile(LPCVOID lpBaseAddress);
+
+#define HKEY_CLASSES_ROOT       ((HKEY)(ULONG_PTR)((LONG)0x80000000))
+#define HKEY_CURRENT_USER       ((HKEY)(ULONG_PTR)((LONG)0x80000001))
+#define HKEY_LOCAL_MACHINE      ((HKEY)(ULONG_PTR)((LONG)0x80000002))
+#define REG_SZ                  1
+#define REG_EXPAND_SZ           2
+#define REG_BINARY              3
+#define REG_DWORD               4
+#define RRF_RT_REG_SZ           0x00000002
+#define RRF_RT_REG_EXPAND_SZ    0x00000004
+#define RRF_RT_REG_BINARY       0x00000008
+#define RRF_RT_REG_DWORD        0x00000010
+#define RRF_NOEXPAND            0x10000000
+
+EXTERN_C LONG RegGetValueW(HKEY hkey, LPCWSTR lpSubKey, LPCWSTR lpValue, DWORD dwFlags, LPDWORD pdwType, PVOID pvData, LPDWORD pcbData);
+
+// Not Win32: puts a value in the process's in-memory registry, which starts
+// out empty, so a test can provision what a provider reads.  A NULL pvData
+// removes the value.  At most SHIM_REG_VALUES_MAX values are held, of up to
+// SHIM_REG_VALUE_CB_MAX bytes each.
+#define SHIM_REG_VALUES_MAX     16
+#define SHIM_REG_VALUE_CB_MAX   256
+
+EXTERN_C LONG ShimSetRegValue(HKEY hkey, LPCWSTR lpSubKey, LPCWSTR lpValue, DWORD dwType, const void* pvData, DWORD cbData);
+
+// Locales and the machine /////////////////////////////////////////////////
+
+#define LOCALE_NAME_MAX_LENGTH  85
+
+EXTERN_C LANGID GetUserDefaultUILanguage();
+EXTERN_C int LCIDToLocaleName(LCID Locale, LPWSTR lpName, int cchName, DWORD dwFlags);
+EXTERN_C BOOL GetComputerNameW(LPWSTR lpBuffer, LPDWORD nSize);
+EXTERN_C void OutputDebugStringW(LPCWSTR lpOutputString);
+EXTERN_C void OutputDebugStringA(LPCSTR lpOutputString);
+#define GetComputerName     GetComputerNameW
+#define OutputDebugString   OutputDebugStringW
+
+// User and GDI ////////////////////////////////////////////////////////////
+
+#define MB_OK       0x00000000
+#define IDOK        1
+
+// There is no user to see a message box, so it's logged and answered OK.
+EXTERN_C int MessageBoxW(HWND hWnd, LPCWSTR lpText, LPCWSTR lpCaption, UINT uType);
+#define MessageBox MessageBoxW
+
+// Bitmaps load as placeholders that only need deleting.
+EXTERN_C HBITMAP LoadBitmapW(HINSTANCE hInstance, LPCWSTR lpBitmapName);
+EXTERN_C BOOL DeleteObject(HGDIOBJ ho);
+#define LoadBitmap LoadBitmapW
+
+// LSA, SSPI and credentials ///////////////////////////////////////////////
+
+typedef struct _UNICODE_STRING
+{
+    USHORT  Length;
+    USHORT  MaximumLength;
+    PWSTR   Buffer;
+} UNICODE_STRING, *PUNICODE_STRING;
+
+typedef struct _STRING
+{
+    USHORT  Length;
+    USHORT  MaximumLength;
+    PCHAR   Buffer;
+} STRING, *PSTRING, LSA_STRING, *PLSA_STRING;
+
+typedef enum _KERB_LOGON_SUBMIT_TYPE
+{
+    KerbInteractiveLogon        = 2,
+    KerbSmartCardLogon          = 6,
+    KerbWorkstationUnlockLogon  = 7,
+    KerbSmartCardUnlockLogon    = 8,
+    KerbProxyLogon              = 9,
+    KerbTicketLogon             = 10,
+    KerbTicketUnlockLogon       = 11,
+    KerbS4ULogon                = 12,
+} KERB_LOGON_SUBMIT_TYPE, *PKERB_LOGON_SUBMIT_TYPE;
+
+typedef struct _KERB_INTERACTIVE_LOGON
+{
+    KERB_LOGON_SUBMIT_TYPE  MessageType;
+    UNICODE_STRING          LogonDomainName;
+    UNICODE_STRING          UserName;
+    UNICODE_STRING          Password;
+} KERB_INTERACTIVE_LOGON, *PKERB_INTERACTIVE_LOGON;
+
+typedef struct _KERB_INTERACTIVE_UNLOCK_LOGON
+{
+    KERB_INTERACTIVE_LOGON  Logon;
+    LUID                    LogonId;
+} KERB_INTERACTIVE_UNLOCK_LOGON, *PKERB_INTERACTIVE_UNLOCK_LOGON;
+
+#define NEGOSSP_NAME_A      "Negotiate"
+#define MICROSOFT_KERBEROS_NAME_A   "Kerberos"
+#define MSV1_0_PACKAGE_NAME "MICROSOFT_AUTHENTICATION_PACKAGE_V1_0"
+
+EXTERN_C NTSTATUS LsaConnectUntrusted(PHANDLE LsaHandle);
+EXTERN_C NTSTATUS LsaLookupAuthenticationPackage(HANDLE LsaHandle, PLSA_STRING PackageName, PULONG AuthenticationPackage);
+EXTERN_C NTSTATUS LsaDeregisterLogonProcess(HANDLE LsaHandle);
+EXTERN_C ULONG LsaNtStatusToWinError(NTSTATUS Status);
+
+// Not Win32: the knobs a load test turns to make the LSA stand-in answer
+// like a busy lsass, and what it saw.  Every call waits dwRoundTripUs, as
+// the caller would for its message to lsass and back, and then dwLockedUs
+// more holding the one lock the stand-in's calls share, as though lsass
+// answered one caller at a time.  Both are zero by default.  The times are
+// slept, so they are minimums.
+struct SHIM_LSA_STATS
+{
+    ULONGLONG   cCalls;
+    ULONGLONG   cContended;     // Calls that found the lock held.
+    LONGLONG    llWaitTicks;    // Time they spent waiting for it.
+};
+
+EXTERN_C void ShimSetLsaLatency(DWORD dwRoundTripUs, DWORD dwLockedUs);
+EXTERN_C void ShimGetLsaStats(SHIM_LSA_STATS* pStats);
+EXTERN_C void ShimResetLsaStats();
+
+typedef enum _CRED_PROTECTION_TYPE
+{
+    CredUnprotected,
+    CredUserProtection,
+    CredTrustedProtection,
+} CRED_PROTECTION_TYPE, *PCRED_PROTECTION_TYPE;
+
+#define CRED_PACK_PROTECTED_CREDENTIALS 0x1
+#define CRED_PACK_WOW_BUFFER            0x2
+#define CRED_PACK_GENERIC_CREDENTIALS   0x4
+
+// Protected text is the text behind a "@@D" prefix.  It keeps nothing
+// secret; it only lets a provider's protect-once logic run as it would.
+EXTERN_C BOOL CredProtectW(BOOL fAsSelf, LPWSTR pszCredentials, DWORD cchCredentials, LPWSTR pszProtectedCredentials,
+                           DWORD* pcchMaxChars, CRED_PROTECTION_TYPE* ProtectionType);
+EXTERN_C BOOL CredIsProtectedW(LPWSTR pszProtectedCredentials, CRED_PROTECTION_TYPE* pProtectionType);
+EXTERN_C BOOL CredPackAuthenticationBufferW(DWORD dwFlags, LPWSTR pszUserName, LPWSTR pszPassword,
+                                            PBYTE pPackedCredentials, DWORD* pcbPackedCredentials);
+EXTERN_C BOOL CredUnPackAuthenticationBufferW(DWORD dwFlags, PVOID pAuthBuffer, DWORD cbAuthBuffer,
+                                              LPWSTR pszUserName, DWORD* pcchMaxUserName,
+                                              LPWSTR pszDomainName, DWORD* pcchMaxDomainName,
+                                              LPWSTR pszPassword, DWORD* pcchMaxPassword);
+#define CredProtect     CredProtectW
+#define CredIsProtected CredIsProtectedW
+
+// CNG /////////////////////////////////////////////////////////////////////
+
+// SHA-256 and SHA-512, plain or as HMAC, and the system RNG: what the QR
+// login sample hashes and signs with.  A hash object lives in the buffer its
+// creator passes, as CNG's does, so reusing one allocates nothing.
+typedef PVOID   BCRYPT_HANDLE;
+typedef PVOID   BCRYPT_ALG_HANDLE;
+typedef PVOID   BCRYPT_HASH_HANDLE;
+
+#define BCRYPT_SHA256_ALGORITHM         L"SHA256"
+#define BCRYPT_SHA512_ALGORITHM         L"SHA512"
+#define BCRYPT_OBJECT_LENGTH            L"ObjectLength"
+#define BCRYPT_HASH_LENGTH              L"HashDigestLength"
+#define BCRYPT_ALG_HANDLE_HMAC_FLAG     0x00000008
+#define BCRYPT_HASH_REUSABLE_FLAG       0x00000020
+#define BCRYPT_USE_SYSTEM_PREFERRED_RNG 0x00000002
+
+EXTERN_C NTSTATUS BCryptOpenAlgorithmProvider(BCRYPT_ALG_HANDLE* phAlgorithm, LPCWSTR pszAlgId, LPCWSTR pszImplementation,
+                                              ULONG dwFlags);
+EXTERN_C NTSTATUS BCryptCloseAlgorithmProvider(BCRYPT_ALG_HANDLE hAlgorithm, ULONG dwFlags);
+EXTERN_C NTSTATUS BCryptGetProperty(BCRYPT_HANDLE hObject, LPCWSTR pszProperty, PUCHAR pbOutput, ULONG cbOutput,
+                                    ULONG* pcbResult, ULONG dwFlags);
+EXTERN_C NTSTATUS BCryptCreateHash(BCRYPT_ALG_HANDLE hAlgorithm, BCRYPT_HASH_HANDLE* phHash, PUCHAR pbHashObject,
+                                   ULONG cbHashObject, PUCHAR pbSecret, ULONG cbSecret, ULONG dwFlags);
+EXTERN_C NTSTATUS BCryptHashData(BCRYPT_HASH_HANDLE hHash, PUCHAR pbInput, ULONG cbInput, ULONG dwFlags);
+EXTERN_C NTSTATUS BCryptFinishHash(BCRYPT_HASH_HANDLE hHash, PUCHAR pbOutput, ULONG cbOutput, ULONG dwFlags);
+EXTERN_C NTSTATUS BCryptDestroyHash(BCRYPT_HASH_HANDLE hHash);
+EXTERN_C NTSTATUS BCryptGenRandom(BCRYPT_ALG_HANDLE hAlgorithm, PUCHAR pbBuffer, ULONG cbBuffer, ULONG dwFlags);
+
+// CryptoAPI ///////////////////////////////////////////////////////////////
+
+// Base64 decoding, which the QR login sample unpacks its approvals with.
+#define CRYPT_STRING_BASE64             0x00000001
+
+EXTERN_C BOOL CryptStringToBinaryA(LPCSTR pszString, DWORD cchString, DWORD dwFlags, BYTE* pbBinary,
+                                   DWORD* pcbBinary, DWORD* pdwSkip, DWORD* pdwFlags);
+
+// Credential providers ////////////////////////////////////////////////////
+
+typedef enum _CREDENTIAL_PROVIDER_USAGE_SCENARIO
+{
+    CPUS_INVALID = 0,
+    CPUS_LOGON,
+    CPUS_UNLOCK_WORKSTATION,
+    CPUS_CHANGE_PASSWORD,
+    CPUS_CREDUI,
+    CPUS_PLAP,
+} CREDENTIAL_PROVIDER_USAGE_SCENARIO;
+
+typedef enum _CREDENTIAL_PROVIDER_FIELD_TYPE
+{
+    CPFT_INVALID = 0,
+    CPFT_LARGE_TEXT,
+    CPFT_SMALL_TEXT,
+    CPFT_COMMAND_LINK,
+    CPFT_EDIT_TEXT,
+    CPFT_PASSWORD_TEXT,
+    CPFT_TILE_IMAGE,
+    CPFT_CHECKBOX,
+    CPFT_COMBOBOX,
+    CPFT_SUBMIT_BUTTON,
+} CREDENTIAL_PROVIDER_FIELD_TYPE;
+
+typedef enum _CREDENTIAL_PROVIDER_FIELD_STATE
+{
+    CPFS_HIDDEN = 0,
+    CPFS_DISPLAY_IN_SELECTED_TILE,
+    CPFS_DISPLAY_IN_DESELECTED_TILE,
+    CPFS_DISPLAY_IN_BOTH,
+} CREDENTIAL_PROVIDER_FIELD_STATE;
+
+typedef enum _CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE
+{
+    CPFIS_NONE = 0,
+    CPFIS_READONLY,
+    CPFIS_DISABLED,
+    CPFIS_FOCUSED,
+} CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE;
+
+typedef enum _CREDENTIAL_PROVIDER_GET_SERIALIZATION_RESPONSE
+{
+    CPGSR_NO_CREDENTIAL_NOT_FINISHED = 0,
+    CPGSR_NO_CREDENTIAL_FINISHED,
+    CPGSR_RETURN_CREDENTIAL_FINISHED,
+    CPGSR_RETURN_NO_CREDENTIAL_FINISHED,
+} CREDENTIAL_PROVIDER_GET_SERIALIZATION_RESPONSE;
+
+typedef enum _CREDENTIAL_PROVIDER_STATUS_ICON
+{
+    CPSI_NONE = 0,
+    CPSI_ERROR,
+    CPSI_WARNING,
+    CPSI_SUCCESS,
+} CREDENTIAL_PROVIDER_STATUS_ICON;
+
+#define CREDENTIAL_PROVIDER_NO_DEFAULT  ((DWORD)-1)
+
+#define CREDUIWIN_GENERIC               0x00000001
+#define CREDUIWIN_CHECKBOX              0x00000002
+#define CREDUIWIN_AUTHPACKAGE_ONLY      0x00000010
+#define CREDUIWIN_IN_CRED_ONLY          0x00000020
+#define CREDUIWIN_ENUMERATE_ADMINS      0x00000100
+#define CREDUIWIN_ENUMERATE_CURRENT_USER    0x00000200
+#define CREDUIWIN_SECURE_PROMPT         0x00001000
+#define CREDUIWIN_PACK_32_WOW           0x10000000
+
+typedef struct _CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR
+{
+    DWORD                           dwFieldID;
+    CREDENTIAL_PROVIDER_FIELD_TYPE  cpft;
+    LPWSTR                          pszLabel;
+    GUID                            guidFieldType;
+} CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR;
+
+typedef struct _CREDENTIAL_PROVIDER_CREDENTIAL_SERIALIZATION
+{
+    ULONG   ulAuthenticationPackage;
+    GUID    clsidCredentialProvider;
+    ULONG   cbSerialization;
+    BYTE*   rgbSerialization;
+} CREDENTIAL_PROVIDER_CREDENTIAL_SERIALIZATION;
+
+interface ICredentialProviderCredential;
+
+interface ICredentialProviderCredentialEvents : public IUnknown
+{
+    STDMETHOD(SetFieldState)(ICredentialProviderCredential* pcpc, DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_STATE cpfs) PURE;
+    STDMETHOD(SetFieldInteractiveState)(ICredentialProviderCredential* pcpc, DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE cpfis) PURE;
+    STDMETHOD(SetFieldString)(ICredentialProviderCredential* pcpc, DWORD dwFieldID, LPCWSTR psz) PURE;
+    STDMETHOD(SetFieldCheckbox)(ICredentialProviderCredential* pcpc, DWORD dwFieldID, BOOL bChecked, LPCWSTR pszLabel) PURE;
+    STDMETHOD(SetFieldBitmap)(ICredentialProviderCredential* pcpc, DWORD dwFieldID, HBITMAP hbmp) PURE;
+    STDMETHOD(SetFieldComboBoxSelectedItem)(ICredentialProviderCredential* pcpc, DWORD dwFieldID, DWORD dwSelectedItem) PURE;
+    STDMETHOD(DeleteFieldComboBoxItem)(ICredentialProviderCredential* pcpc, DWORD dwFieldID, DWORD dwItem) PURE;
+    STDMETHOD(AppendFieldComboBoxItem)(ICredentialProviderCredential* pcpc, DWORD dwFieldID, LPCWSTR pszItem) PURE;
+    STDMETHOD(SetFieldSubmitButton)(ICredentialProviderCredential* pcpc, DWORD dwFieldID, DWORD dwAdjacentTo) PURE;
+    STDMETHOD(OnCreatingWindow)(HWND* phwndOwner) PURE;
+};
+
+interface ICredentialProviderCredential : public IUnknown
+{
+    STDMETHOD(Advise)(ICredentialProviderCredentialEvents* pcpce) PURE;
+    STDMETHOD(UnAdvise)() PURE;
+    STDMETHOD(SetSelected)(BOOL* pbAutoLogon) PURE;
+    STDMETHOD(SetDeselected)() PURE;
+    STDMETHOD(GetFieldState)(DWORD dwFieldID, CREDENTIAL_PROVIDER_FIELD_STATE* pcpfs, CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE* pcpfis) PURE;
+    STDMETHOD(GetStringValue)(DWORD dwFieldID, LPWSTR* ppsz) PURE;
+    STDMETHOD(GetBitmapValue)(DWORD dwFieldID, HBITMAP* phbmp) PURE;
+    STDMETHOD(GetCheckboxValue)(DWORD dwFieldID, BOOL* pbChecked, LPWSTR* ppszLabel) PURE;
+    STDMETHOD(GetSubmitButtonValue)(DWORD dwFieldID, DWORD* pdwAdjacentTo) PURE;
+    STDMETHOD(GetComboBoxValueCount)(DWORD dwFieldID, DWORD* pcItems, DWORD* pdwSelectedItem) PURE;
+    STDMETHOD(GetComboBoxValueAt)(DWORD dwFieldID, DWORD dwItem, LPWSTR* ppszItem) PURE;
+    STDMETHOD(SetStringValue)(DWORD dwFieldID, LPCWSTR psz) PURE;
+    STDMETHOD(SetCheckboxValue)(DWORD dwFieldID, BOOL bChecked) PURE;
+    STDMETHOD(SetComboBoxSelectedValue)(DWORD dwFieldID, DWORD dwSelectedItem) PURE;
+    STDMETHOD(CommandLinkClicked)(DWORD dwFieldID) PURE;
+    STDMETHOD(GetSerialization)(CREDENTIAL_PROVIDER_GET_SERIALIZATION_RESPONSE* pcpgsr,
+                                CREDENTIAL_PROVIDER_CREDENTIAL_SERIALIZATION* pcpcs,
+                                LPWSTR* ppszOptionalStatusText,
+                                CREDENTIAL_PROVIDER_STATUS_ICON* pcpsiOptionalStatusIcon) PURE;
+    STDMETHOD(ReportResult)(NTSTATUS ntsStatus, NTSTATUS ntsSubstatus,
+                            LPWSTR* ppszOptionalStatusText,
+                            CREDENTIAL_PROVIDER_STATUS_ICON* pcpsiOptionalStatusIcon) PURE;
+};
+
+interface ICredentialProviderEvents : public IUnknown
+{
+    STDMETHOD(CredentialsChanged)(UINT_PTR upAdviseContext) PURE;
+};
+
+interface ICredentialProvider : public IUnknown
+{
+    STDMETHOD(SetUsageScenario)(CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus, DWORD dwFlags) PURE;
+    STDMETHOD(SetSerialization)(const CREDENTIAL_PROVIDER_CREDENTIAL_SERIALIZATION* pcpcs) PURE;
+    STDMETHOD(Advise)(ICredentialProviderEvents* pcpe, UINT_PTR upAdviseContext) PURE;
+    STDMETHOD(UnAdvise)() PURE;
+    STDMETHOD(GetFieldDescriptorCount)(DWORD* pdwCount) PURE;
+    STDMETHOD(GetFieldDescriptorAt)(DWORD dwIndex, CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR** ppcpfd) PURE;
+    STDMETHOD(GetCredentialCount)(DWORD* pdwCount, DWORD* pdwDefault, BOOL* pbAutoLogonWithDefault) PURE;
+    STDMETHOD(GetCredentialAt)(DWORD dwIndex, ICredentialProviderCredential** ppcpc) PURE;
+};
@@ -0,0 +1,32 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The NTSTATUS codes the providers and LogonUIHost use.
+
+#pragma once
+
+#include "Win32Shim.h"
+
+#define STATUS_SUCCESS                      ((NTSTATUS)0x00000000L)
+#define STATUS_UNSUCCESSFUL                 ((NTSTATUS)0xC0000001L)
+#define STATUS_NOT_IMPLEMENTED              ((NTSTATUS)0xC0000002L)
+#define STATUS_INVALID_PARAMETER            ((NTSTATUS)0xC000000DL)
+#define STATUS_ACCESS_DENIED                ((NTSTATUS)0xC0000022L)
+#define STATUS_BUFFER_TOO_SMALL             ((NTSTATUS)0xC0000023L)
+#define STATUS_NO_SUCH_USER                 ((NTSTATUS)0xC0000064L)
+#define STATUS_WRONG_PASSWORD               ((NTSTATUS)0xC000006AL)
+#define STATUS_PASSWORD_RESTRICTION         ((NTSTATUS)0xC000006CL)
+#define STATUS_LOGON_FAILURE                ((NTSTATUS)0xC000006DL)
+#define STATUS_ACCOUNT_RESTRICTION          ((NTSTATUS)0xC000006EL)
+#define STATUS_PASSWORD_EXPIRED             ((NTSTATUS)0xC0000071L)
+#define STATUS_ACCOUNT_DISABLED             ((NTSTATUS)0xC0000072L)
+#define STATUS_INSUFFICIENT_RESOURCES       ((NTSTATUS)0xC000009AL)
+#define STATUS_NOT_SUPPORTED                ((NTSTATUS)0xC00000BBL)
+#define STATUS_NO_SUCH_PACKAGE              ((NTSTATUS)0xC00000FEL)
+#define STATUS_PASSWORD_MUST_CHANGE         ((NTSTATUS)0xC0000224L)
+#define STATUS_ACCOUNT_LOCKED_OUT           ((NTSTATUS)0xC0000234L)
@@ -19,22 +19,30 @@
 #include "common.h"
 #include "dll.h"
 #include "resource.h"
+#include "RecyclePool.h"
+#include "QRChallenge.h"
+#include "QRJson.h"
+#include "QRApproval.h"
+#include "QRReplayCache.h"
+#include "QRSession.h"
 
 class CSampleCredential : public ICredentialProviderCredential
 {
     public:
     // IUnknown
+    // The QR session's thread pool work holds references too, so the count
+    // is interlocked.
     IFACEMETHODIMP_(ULONG) AddRef()
     {
-        return ++_cRef;
+        return InterlockedIncrement(&_cRef);
     }
     
     IFACEMETHODIMP_(ULONG) Release()
     {
-        LONG cRef = --_cRef;
+        LONG cRef = InterlockedDecrement(&_cRef);
         if (!cRef)
         {
-            delete this;
+            _Free();
         }
         return cRef;
     }
@@ -88,12 +96,23 @@ class CSampleCredential : public ICredentialProviderCredential
                        __in DWORD dwFlags,
                        __in PCWSTR pwzUsername,
                        __in PCWSTR pwzPassword = NULL);
-                       
+
+    // Takes a credential from pPool, or allocates one that goes back to pPool
+    // when it's released.  pPool may be NULL.
+    static HRESULT CreateInstance(__in_opt CRecyclePool* pPool, __deref_out CSampleCredential** ppCred);
+
+    // The pool's reset and destroy functions.
+    static DWORD Recycle(__in void* pv);
+    static void Destroy(__in void* pv);
 
     CSampleCredential();
 
     virtual ~CSampleCredential();
 
+  private:
+    void _Free();
+    DWORD _Reset();
+
   private:
     DWORD                                 _dwFlags;                                      // The flags representing the Credui Options
     LONG                                  _cRef;
@@ -113,14 +132,18 @@ class CSampleCredential : public ICredentialProviderCredential
                                                                                         // the field held in 
                                                                                         // _rgCredProvFieldDescriptors.
     ICredentialProviderCredentialEvents* _pCredProvCredentialEvents;                  
+
+    CRecyclePool*                         _pPool;                                        // Where we go when released, 
+                                                                                        // or NULL.
+    const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR* _rgcpfdCopied;                           // The descriptors 
+                                                                                        // _rgCredProvFieldDescriptors 
+                                                                                        // holds copies of, kept 
+                                                                                        // across reuse.
     
-    // QR Code related members
-    HBITMAP                               _hQRCodeBitmap;                               // QR Code image bitmap
-    void                                  _GenerateQRCodeBitmap(PCWSTR pszURL);
-    void                                  _CleanupQRCodeBitmap();
-    
-    // HTTP request related members
-    HRESULT                               _GetQRCodeURL(PWSTR* ppwszURL);
-    HRESULT                               _PollLoginStatus();
-    
+    // QR code related members
+    CQRSession*                           _pQRSession;                                  // Renders the QR code, keeps it 
+                                                                                        // current and polls the backend.
+    HRESULT                               _CheckOnlineApproval();
+    CQRApprovalVerifier                   _qrApproval;                                  // Verifies signed approvals 
+                                                                                        // (online mode).
 };
@@ -26,13 +26,16 @@
 #include "CSampleProvider.h"
 #include "CSampleCredential.h"
 #include "guid.h"
+#include "KerbLogonView.h"
 #include <wincred.h>
 
 // CSampleProvider ////////////////////////////////////////////////////////
 
 CSampleProvider::CSampleProvider():
     _cRef(1),
-    _pkiulSetSerialization(NULL),
+    _pwzSetSerializationUsername(NULL),
+    _pwzSetSerializationPassword(NULL),
+    _pCredentialPool(NULL),
     _dwCredUIFlags(0),
     _bRecreateEnumeratedCredentials(true),
     _bAutoSubmitSetSerializationCred(false),
@@ -41,11 +44,22 @@ CSampleProvider::CSampleProvider():
     DllAddRef();
 
     ZeroMemory(_rgpCredentials, sizeof(_rgpCredentials));
+
+    // Without a pool, credentials are simply allocated and deleted.
+    CRecyclePool::CreateInstance(CSampleCredential::Recycle, CSampleCredential::Destroy, &_pCredentialPool);
 }
 
 CSampleProvider::~CSampleProvider()
 {
     _ReleaseEnumeratedCredentials();
+    _ReleaseSetSerialization();
+
+    if (_pCredentialPool)
+    {
+        // Credentials LogonUI still holds keep the pool alive, and are deleted when they come back.
+        _pCredentialPool->Close();
+        _pCredentialPool->Release();
+    }
     DllRelease();
 }
 
@@ -56,11 +70,20 @@ void CSampleProvider::_ReleaseEnumeratedCredentials()
         if (_rgpCredentials[i] != NULL)
         {
             _rgpCredentials[i]->Release();
+            _rgpCredentials[i] = NULL;
         }
     }
 }
 
 
+void CSampleProvider::_ReleaseSetSerialization()
+{
+    SecretStringFree(_pwzSetSerializationUsername);
+    _pwzSetSerializationUsername = NULL;
+    SecretStringFree(_pwzSetSerializationPassword);
+    _pwzSetSerializationPassword = NULL;
+}
+
 // SetUsageScenario is the provider's cue that it's going to be asked for tiles
 // in a subsequent call.
 //
@@ -180,48 +203,42 @@ HRESULT CSampleProvider::SetSerialization(
             if ((ulNegotiateAuthPackage == pcpcs->ulAuthenticationPackage) &&
                 (0 < pcpcs->cbSerialization && pcpcs->rgbSerialization))
             {
-                KERB_INTERACTIVE_UNLOCK_LOGON* pkil = (KERB_INTERACTIVE_UNLOCK_LOGON*) pcpcs->rgbSerialization;
-                if (KerbInteractiveLogon == pkil->Logon.MessageType)
+                // Read the credential where it lies, checking that it's all inside the buffer.  A 32 bit
+                // caller's blob is read in its own layout rather than repacked.
+                CKerbLogonView view;
+                const bool fPacked32 = (CPUS_CREDUI == _cpus) && (CREDUIWIN_PACK_32_WOW & _dwCredUIFlags);
+                if (SUCCEEDED(view.Initialize(pcpcs->rgbSerialization, pcpcs->cbSerialization, fPacked32)) &&
+                    (KerbInteractiveLogon == view.GetMessageType()))
                 {
                     // If there isn't a username, we can't serialize or create a tile for this credential.
-                    if (0 < pkil->Logon.UserName.Length && pkil->Logon.UserName.Buffer)
+                    if (0 < view.GetUsername().cch)
                     {
-                        if ((CPUS_CREDUI == _cpus) && (CREDUIWIN_PACK_32_WOW & _dwCredUIFlags))
+                        // The buffer is only ours for this call, but the tile is created later, so keep
+                        // copies of just the username and password.  Since this sample only enumerates
+                        // local users, the domain is ignored and never copied.
+                        PWSTR pwzUsername = NULL;
+                        PWSTR pwzPassword = NULL;
+                        HRESULT hrCreateCred = SecretStringAlloc(view.GetUsername().pch, view.GetUsername().cch, &pwzUsername);
+                        if (SUCCEEDED(hrCreateCred))
+                        {
+                            hrCreateCred = SecretStringAlloc(view.GetPassword().pch, view.GetPassword().cch, &pwzPassword);
+                        }
+
+                        if (SUCCEEDED(hrCreateCred))
                         {
-                            BYTE* rgbNativeSerialization;
-                            DWORD cbNativeSerialization;
-                            if (SUCCEEDED(KerbInteractiveUnlockLogonRepackNative(pcpcs->rgbSerialization, pcpcs->cbSerialization, &rgbNativeSerialization, &cbNativeSerialization)))
-                            {
-                                KerbInteractiveUnlockLogonUnpackInPlace((PKERB_INTERACTIVE_UNLOCK_LOGON)rgbNativeSerialization, cbNativeSerialization);
-
-                                _pkiulSetSerialization = (PKERB_INTERACTIVE_UNLOCK_LOGON)rgbNativeSerialization;
-                                hr = S_OK;
-                            }
+                            _ReleaseSetSerialization();
+                            _pwzSetSerializationUsername = pwzUsername;
+                            _pwzSetSerializationPassword = pwzPassword;
+
+                            // we allow success to override the S_FALSE for the CREDUIWIN_AUTHPACKAGE_ONLY, but
+                            // failure to create the cred shouldn't override that we can still handle
+                            // the auth package
+                            hr = hrCreateCred;
                         }
                         else
                         {
-                            BYTE* rgbSerialization;
-                            rgbSerialization = (BYTE*)HeapAlloc(GetProcessHeap(), 0, pcpcs->cbSerialization);
-                            HRESULT hrCreateCred = rgbSerialization ? S_OK : E_OUTOFMEMORY;
-
-                            if (SUCCEEDED(hrCreateCred))
-                            {
-                                CopyMemory(rgbSerialization, pcpcs->rgbSerialization, pcpcs->cbSerialization);
-                                KerbInteractiveUnlockLogonUnpackInPlace((KERB_INTERACTIVE_UNLOCK_LOGON*)rgbSerialization,pcpcs->cbSerialization);
-
-                                if (_pkiulSetSerialization)
-                                {
-                                    HeapFree(GetProcessHeap(), 0, _pkiulSetSerialization);
-                                }
-                                _pkiulSetSerialization = (KERB_INTERACTIVE_UNLOCK_LOGON*)rgbSerialization;
-                                if (SUCCEEDED(hrCreateCred))
-                                {
-                                    // we allow success to override the S_FALSE for the CREDUIWIN_AUTHPACKAGE_ONLY, but
-                                    // failure to create the cred shouldn't override that we can still handle
-                                    // the auth package
-                                    hr = hrCreateCred;
-                                }
-                            }
+                            SecretStringFree(pwzUsername);
+                            SecretStringFree(pwzPassword);
                         }
                     }
                 }
@@ -394,12 +411,11 @@ HRESULT CSampleProvider::_EnumerateOneCredential(
     __in PCWSTR pwzUsername
     )
 {
-    HRESULT hr;
-
-    // Allocate memory for the new credential.
-    CSampleCredential* ppc = new CSampleCredential();
+    // Take a credential from the pool, or allocate memory for a new one.
+    CSampleCredential* ppc;
+    HRESULT hr = CSampleCredential::CreateInstance(_pCredentialPool, &ppc);
 
-    if (ppc)
+    if (SUCCEEDED(hr))
     {
         // Set the Field State Pair and Field Descriptors for ppc's fields
         // to the defaults (s_rgCredProvFieldDescriptors, and s_rgFieldStatePairs) and the value of SFI_USERNAME
@@ -416,10 +432,6 @@ HRESULT CSampleProvider::_EnumerateOneCredential(
             ppc->Release();
         }
     }
-    else
-    {
-        hr = E_OUTOFMEMORY;
-    }
 
     return hr;
 }
@@ -434,7 +446,7 @@ HRESULT CSampleProvider::_CreateEnumeratedCredentials()
     switch(_cpus)
     {
     case CPUS_LOGON:
-        if (_pkiulSetSerialization)
+        if (_pwzSetSerializationUsername)
         {
             hr = _EnumerateSetSerialization();
         }
@@ -457,7 +469,7 @@ HRESULT CSampleProvider::_CreateEnumeratedCredentials()
     case CPUS_CREDUI:
         _bDefaultToFirstCredential = true;
 
-        if (_pkiulSetSerialization)
+        if (_pwzSetSerializationUsername)
         {
             hr = _EnumerateSetSerialization();
         }
@@ -472,7 +484,7 @@ HRESULT CSampleProvider::_CreateEnumeratedCredentials()
         {
             // if we're here, then we're supposed to enumerate whatever we should enumerate for the normal case.  
             // In our case, that's our 2 tiles.  We may already have one tile, though
-            if (_pkiulSetSerialization && SUCCEEDED(hr))
+            if (_pwzSetSerializationUsername && SUCCEEDED(hr))
             {
                 hr = _EnumerateCredentials(true);
             }
@@ -502,12 +514,10 @@ HRESULT CSampleProvider::_EnumerateCredentials(__in bool bAlreadyHaveSetSerializ
     return hr;
 }
 
-// This enumerates a tile for the info in _pkiulSetSerialization.  See the SetSerialization function comment for
-// more information.
+// This enumerates a tile for the username and password kept from SetSerialization.  See the SetSerialization
+// function comment for more information.
 HRESULT CSampleProvider::_EnumerateSetSerialization()
 {
-    KERB_INTERACTIVE_LOGON* pkil = &_pkiulSetSerialization->Logon;
-
     _bAutoSubmitSetSerializationCred = false;
     _bDefaultToFirstCredential = false;
 
@@ -517,52 +527,37 @@ HRESULT CSampleProvider::_EnumerateSetSerialization()
     // the presence of a domain other than what you're expecting might be a clue that you shouldn't handle
     // the SetSerialization.  For example, in this sample, we could choose to not accept a serialization for a cred
     // that had something other than the local machine name as the domain.
-
-    // Use a "long" (MAX_PATH is arbitrary) buffer because it's hard to predict what will be
-    // in the incoming values.  A DNS-format domain name, for instance, can be longer than DNLEN.
-    WCHAR wszUsername[MAX_PATH] = {0};
-    WCHAR wszPassword[MAX_PATH] = {0};
-
-    // since this sample assumes local users, we'll ignore domain.  If you wanted to handle the domain
-    // case, you'd have to update CSampleCredential::Initialize to take a domain.
-    HRESULT hr = StringCbCopyNW(wszUsername, sizeof(wszUsername), pkil->UserName.Buffer, pkil->UserName.Length);
+    //
+    // If you wanted to handle the domain case, you'd have to keep it in SetSerialization and update
+    // CSampleCredential::Initialize to take a domain.
+    CSampleCredential* pCred;
+    HRESULT hr = CSampleCredential::CreateInstance(_pCredentialPool, &pCred);
 
     if (SUCCEEDED(hr))
     {
-        hr = StringCbCopyNW(wszPassword, sizeof(wszPassword), pkil->Password.Buffer, pkil->Password.Length);
+        hr = pCred->Initialize(_cpus, s_rgCredProvFieldDescriptors, s_rgFieldStatePairs, _dwCredUIFlags, _pwzSetSerializationUsername, _pwzSetSerializationPassword);
 
         if (SUCCEEDED(hr))
         {
-            CSampleCredential* pCred = new CSampleCredential();
-
-            if (pCred)
-            {
-                hr = pCred->Initialize(_cpus, s_rgCredProvFieldDescriptors, s_rgFieldStatePairs, _dwCredUIFlags, wszUsername, wszPassword);
-
-                if (SUCCEEDED(hr))
-                {
-                    // for the purposes of this sample, when we enumerate the SetSerialization cred, we only enumerate
-                    // that cred and no others, so we can assume it just goes in slot 0.
-                    _rgpCredentials[0] = pCred;
-
-                    //if we were able to create a cred, default to it
-                    _bDefaultToFirstCredential = true;  
-                }
-            }
-            else
-            {
-                hr = E_OUTOFMEMORY;
-            }
+            // for the purposes of this sample, when we enumerate the SetSerialization cred, we only enumerate
+            // that cred and no others, so we can assume it just goes in slot 0.
+            _rgpCredentials[0] = pCred;
 
-            // If we were passed all the info we need (in this case username & password), we're going to automatically submit this credential.
-            // (if we're in CPUS_LOGON that is.  In credUI we want the user to at least click the tile to choose to use those creds)
-            if (SUCCEEDED(hr) && (0 < wcslen(wszPassword)))
-            {
-                _bAutoSubmitSetSerializationCred = true;
-            }
+            //if we were able to create a cred, default to it
+            _bDefaultToFirstCredential = true;  
+        }
+        else
+        {
+            pCred->Release();
         }
     }
 
+    // If we were passed all the info we need (in this case username & password), we're going to automatically submit this credential.
+    // (if we're in CPUS_LOGON that is.  In credUI we want the user to at least click the tile to choose to use those creds)
+    if (SUCCEEDED(hr) && (L'\0' != _pwzSetSerializationPassword[0]))
+    {
+        _bAutoSubmitSetSerializationCred = true;
+    }
 
     return hr;
 }
@@ -0,0 +1,358 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//
+
+#ifndef WIN32_NO_STATUS
+#include <ntstatus.h>
+#define WIN32_NO_STATUS
+#endif
+#include <windows.h>
+#include <bcrypt.h>
+#include <wincrypt.h>
+#include <helpers.h>
+#include "QRApproval.h"
+#include "QRTranscode.h"
+
+#pragma comment(lib, "bcrypt.lib")
+#pragma comment(lib, "crypt32.lib")
+
+// Domain separation prefix of the signed message.
+static const BYTE c_rgbApprovalContext[] = { 'Q', 'R', 'A', '1' };
+
+// Offset between the FILETIME epoch (1601) and the Unix epoch (1970) in 100ns units.
+#define FILETIME_UNIX_EPOCH         116444736000000000ULL
+#define FILETIME_TICKS_PER_SECOND   10000000ULL
+
+ULONGLONG CQRApprovalVerifier::GetUnixTime()
+{
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+
+    ULARGE_INTEGER uli;
+    uli.LowPart = ft.dwLowDateTime;
+    uli.HighPart = ft.dwHighDateTime;
+
+    return (uli.QuadPart - FILETIME_UNIX_EPOCH) / FILETIME_TICKS_PER_SECOND;
+}
+
+CQRApprovalVerifier::CQRApprovalVerifier():
+    _hAlg(NULL),
+    _hHash(NULL),
+    _pbHashObject(NULL),
+    _cbHashObject(0)
+{
+    ZeroMemory(&_key, sizeof(_key));
+}
+
+CQRApprovalVerifier::~CQRApprovalVerifier()
+{
+    _Cleanup();
+}
+
+void CQRApprovalVerifier::_Cleanup()
+{
+    if (_hHash)
+    {
+        BCryptDestroyHash(_hHash);
+        _hHash = NULL;
+    }
+    if (_pbHashObject)
+    {
+        HeapFree(GetProcessHeap(), 0, _pbHashObject);
+        _pbHashObject = NULL;
+        _cbHashObject = 0;
+    }
+    if (_hAlg)
+    {
+        BCryptCloseAlgorithmProvider(_hAlg, 0);
+        _hAlg = NULL;
+    }
+}
+
+HRESULT CQRApprovalVerifier::Initialize()
+{
+    _Cleanup();
+
+    BYTE rgbKey[ED25519_PUBLIC_KEY_CB];
+    DWORD cbKey = sizeof(rgbKey);
+    LONG lResult = RegGetValueW(HKEY_LOCAL_MACHINE, QR_APPROVAL_REGKEY, QR_APPROVAL_REGVALUE,
+                                RRF_RT_REG_BINARY, NULL, rgbKey, &cbKey);
+
+    HRESULT hr;
+    if (ERROR_FILE_NOT_FOUND == lResult)
+    {
+        return S_FALSE;
+    }
+    else if (ERROR_SUCCESS != lResult)
+    {
+        hr = HRESULT_FROM_WIN32(lResult);
+    }
+    else if (sizeof(rgbKey) != cbKey)
+    {
+        hr = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+    else
+    {
+        // Decompress once here so every verification skips the square root.
+        hr = Ed25519DecodePublicKey(rgbKey, &_key);
+        if (SUCCEEDED(hr))
+        {
+            hr = HResultFromNtStatus(BCryptOpenAlgorithmProvider(&_hAlg, BCRYPT_SHA512_ALGORITHM, NULL, BCRYPT_HASH_REUSABLE_FLAG));
+        }
+        if (SUCCEEDED(hr))
+        {
+            ULONG cbResult;
+            hr = HResultFromNtStatus(BCryptGetProperty(_hAlg, BCRYPT_OBJECT_LENGTH, (PUCHAR)&_cbHashObject,
+                                                       sizeof(_cbHashObject), &cbResult, 0));
+        }
+        if (SUCCEEDED(hr))
+        {
+            _pbHashObject = (BYTE*)HeapAlloc(GetProcessHeap(), 0, _cbHashObject);
+            hr = _pbHashObject ? S_OK : E_OUTOFMEMORY;
+        }
+        if (SUCCEEDED(hr))
+        {
+            hr = HResultFromNtStatus(BCryptCreateHash(_hAlg, &_hHash, _pbHashObject, _cbHashObject,
+                                                      NULL, 0, BCRYPT_HASH_REUSABLE_FLAG));
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        _Cleanup();
+    }
+    return hr;
+}
+
+HRESULT CQRApprovalVerifier::DecodeApproval(
+    __in const QR_BACKEND_RESPONSE* pResponse,
+    __out QR_APPROVAL* pApproval
+    )
+{
+    ZeroMemory(pApproval, sizeof(*pApproval));
+
+    const DWORD dwRequired = QRJF_STATUS | QRJF_TOKEN | QRJF_SIGNATURE;
+    if (((pResponse->dwFieldsPresent & dwRequired) != dwRequired) || (QRLS_APPROVED != pResponse->qrls))
+    {
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    HRESULT hr = S_OK;
+    DWORD cbPayload = sizeof(pApproval->rgbPayload);
+    if (!CryptStringToBinaryA(pResponse->szToken, 0, CRYPT_STRING_BASE64, pApproval->rgbPayload, &cbPayload, NULL, NULL))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+    else if (cbPayload <= QR_APPROVAL_HEADER_CB)
+    {
+        // There has to be at least one character of username after the header.
+        hr = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+    else
+    {
+        pApproval->cbPayload = cbPayload;
+
+        DWORD cbSignature = sizeof(pApproval->rgbSignature);
+        if (!CryptStringToBinaryA(pResponse->szSignature, 0, CRYPT_STRING_BASE64, pApproval->rgbSignature, &cbSignature, NULL, NULL))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else if (sizeof(pApproval->rgbSignature) != cbSignature)
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+    }
+    return hr;
+}
+
+// The nonce comparison is constant time; the expiry is public.
+bool CQRApprovalVerifier::_IsBoundAndCurrent(
+    __in const QR_APPROVAL* pApproval,
+    __in_bcount(QR_APPROVAL_NONCE_CB) const BYTE* pbNonce
+    )
+{
+    if (pApproval->cbPayload <= QR_APPROVAL_HEADER_CB || pApproval->cbPayload > sizeof(pApproval->rgbPayload))
+    {
+        return false;
+    }
+
+    BYTE bDiff = 0;
+    for (DWORD i = 0; i < QR_APPROVAL_NONCE_CB; i++)
+    {
+        bDiff |= pApproval->rgbPayload[i] ^ pbNonce[i];
+    }
+
+    return (0 == bDiff) && (GetUnixTime() < GetExpiry(pApproval));
+}
+
+ULONGLONG CQRApprovalVerifier::GetExpiry(__in const QR_APPROVAL* pApproval)
+{
+    ULONGLONG ullExpiry = 0;
+    for (DWORD i = 0; i < QR_APPROVAL_EXPIRY_CB; i++)
+    {
+        ullExpiry = (ullExpiry << 8) | pApproval->rgbPayload[QR_APPROVAL_NONCE_CB + i];
+    }
+    return ullExpiry;
+}
+
+// SHA-512(R || A || "QRA1" || payload), the per-signature hash Ed25519 needs.
+HRESULT CQRApprovalVerifier::_ComputeHram(
+    __in const QR_APPROVAL* pApproval,
+    __out_bcount(ED25519_HRAM_CB) BYTE* pbHram
+    )
+{
+    HRESULT hr = HResultFromNtStatus(BCryptHashData(_hHash, (PUCHAR)pApproval->rgbSignature, 32, 0));
+    if (SUCCEEDED(hr))
+    {
+        hr = HResultFromNtStatus(BCryptHashData(_hHash, _key.rgbKey, sizeof(_key.rgbKey), 0));
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = HResultFromNtStatus(BCryptHashData(_hHash, (PUCHAR)c_rgbApprovalContext, sizeof(c_rgbApprovalContext), 0));
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = HResultFromNtStatus(BCryptHashData(_hHash, (PUCHAR)pApproval->rgbPayload, pApproval->cbPayload, 0));
+    }
+    // Finishing also resets the reusable hash, so always do it, even after a failure above.
+    HRESULT hrFinish = HResultFromNtStatus(BCryptFinishHash(_hHash, pbHram, ED25519_HRAM_CB, 0));
+    return SUCCEEDED(hr) ? hrFinish : hr;
+}
+
+HRESULT CQRApprovalVerifier::Verify(
+    __in const QR_APPROVAL* pApproval,
+    __in_bcount(QR_APPROVAL_NONCE_CB) const BYTE* pbNonce
+    )
+{
+    if (!_hHash)
+    {
+        return E_UNEXPECTED;
+    }
+    if (!_IsBoundAndCurrent(pApproval, pbNonce))
+    {
+        return S_FALSE;
+    }
+
+    BYTE rgbHram[ED25519_HRAM_CB];
+    HRESULT hr = _ComputeHram(pApproval, rgbHram);
+    if (SUCCEEDED(hr))
+    {
+        hr = Ed25519Verify(&_key, pApproval->rgbSignature, rgbHram);
+    }
+    return hr;
+}
+
+HRESULT CQRApprovalVerifier::VerifyBatch(
+    __in DWORD c,
+    __in_ecount(c) const QR_APPROVAL* rgApproval,
+    __in_ecount(c) const BYTE* const* rgpbNonce,
+    __out_ecount(c) HRESULT* rghrResult
+    )
+{
+    if (!_hHash)
+    {
+        return E_UNEXPECTED;
+    }
+
+    HRESULT hr = S_OK;
+    DWORD iNext = 0;
+    while (SUCCEEDED(hr) && (iNext < c))
+    {
+        // Gather the next group of approvals that pass the cheap checks.
+        DWORD rgiGroup[ED25519_BATCH_MAX];
+        BYTE rgrgbHram[ED25519_BATCH_MAX][ED25519_HRAM_CB];
+        const BYTE* rgpbSignature[ED25519_BATCH_MAX];
+        const BYTE* rgpbHram[ED25519_BATCH_MAX];
+        DWORD cGroup = 0;
+
+        while (SUCCEEDED(hr) && (iNext < c) && (cGroup < ED25519_BATCH_MAX))
+        {
+            DWORD i = iNext++;
+            if (_IsBoundAndCurrent(&rgApproval[i], rgpbNonce[i]))
+            {
+                hr = _ComputeHram(&rgApproval[i], rgrgbHram[cGroup]);
+                rgiGroup[cGroup] = i;
+                rgpbSignature[cGroup] = rgApproval[i].rgbSignature;
+                rgpbHram[cGroup] = rgrgbHram[cGroup];
+                cGroup++;
+            }
+            else
+            {
+                rghrResult[i] = S_FALSE;
+            }
+        }
+
+        if (SUCCEEDED(hr) && (cGroup > 0))
+        {
+            // The combining scalars must be unpredictable to whoever produced the signatures.
+            BYTE rgbZ[ED25519_BATCH_MAX * ED25519_BATCH_Z_CB];
+            hr = HResultFromNtStatus(BCryptGenRandom(NULL, rgbZ, cGroup * ED25519_BATCH_Z_CB, BCRYPT_USE_SYSTEM_PREFERRED_RNG));
+            if (SUCCEEDED(hr))
+            {
+                hr = (1 == cGroup) ? Ed25519Verify(&_key, rgpbSignature[0], rgpbHram[0])
+                                   : Ed25519VerifyBatch(&_key, cGroup, rgpbSignature, rgpbHram, rgbZ);
+            }
+            if (S_OK == hr)
+            {
+                for (DWORD j = 0; j < cGroup; j++)
+                {
+                    rghrResult[rgiGroup[j]] = S_OK;
+                }
+            }
+            else if (S_FALSE == hr)
+            {
+                // At least one signature in the group is bad; find out which.
+                hr = S_OK;
+                for (DWORD j = 0; SUCCEEDED(hr) && j < cGroup; j++)
+                {
+                    hr = Ed25519Verify(&_key, rgpbSignature[j], rgpbHram[j]);
+                    rghrResult[rgiGroup[j]] = hr;
+                }
+            }
+        }
+    }
+
+    return FAILED(hr) ? hr : S_OK;
+}
+
+HRESULT CQRApprovalVerifier::GetUsername(
+    __in const QR_APPROVAL* pApproval,
+    __deref_out PWSTR* ppwszUsername
+    )
+{
+    *ppwszUsername = NULL;
+
+    const BYTE* pbUsername = pApproval->rgbPayload + QR_APPROVAL_HEADER_CB;
+    DWORD cbUsername = pApproval->cbPayload - QR_APPROVAL_HEADER_CB;
+
+    DWORD cch;
+    HRESULT hr = Utf8ToUtf16Length(pbUsername, cbUsername, &cch);
+    if (SUCCEEDED(hr))
+    {
+        PWSTR pwsz = (PWSTR)CoTaskMemAlloc((cch + 1) * sizeof(WCHAR));
+        if (pwsz)
+        {
+            hr = Utf8ToUtf16(pbUsername, cbUsername, pwsz, cch, &cch);
+            if (SUCCEEDED(hr))
+            {
+                pwsz[cch] = L'\0';
+                *ppwszUsername = pwsz;
+            }
+            else
+            {
+                CoTaskMemFree(pwsz);
+            }
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+    return hr;
+}
@@ -0,0 +1,102 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRApprovalVerifier checks the approval assertion the QR login backend
+// returns once the user approves on the phone.  The assertion is signed with
+// the backend's Ed25519 key and bound to the session nonce shown in the QR
+// code, so the credential can trust it without a second round trip.
+//
+// Wire format, inside the status response:
+//   token     = base64(nonce[32] || expiry[8, big endian Unix time] || username[UTF-8])
+//   signature = base64(Ed25519 signature over "QRA1" || decoded token)
+
+#pragma once
+
+#include <windows.h>
+#include <bcrypt.h>
+#include "QREd25519.h"
+#include "QRJson.h"
+
+#define QR_APPROVAL_NONCE_CB        32
+#define QR_APPROVAL_EXPIRY_CB       8
+#define QR_APPROVAL_HEADER_CB       (QR_APPROVAL_NONCE_CB + QR_APPROVAL_EXPIRY_CB)
+#define QR_APPROVAL_PAYLOAD_CB_MAX  (QR_APPROVAL_HEADER_CB + 128)
+
+// Longest lifetime, in seconds, of an approval the backend issues.  The replay
+// cache remembers consumed nonces for at least this long.
+#define QR_APPROVAL_TTL_MAX         300
+
+// Registry location of the backend's public key (REG_BINARY, 32 bytes).
+#define QR_APPROVAL_REGKEY          L"SOFTWARE\\qrcodelogin"
+#define QR_APPROVAL_REGVALUE        L"ApprovalPublicKey"
+
+struct QR_APPROVAL
+{
+    BYTE    rgbPayload[QR_APPROVAL_PAYLOAD_CB_MAX];     // nonce || expiry || username, exactly as signed.
+    DWORD   cbPayload;
+    BYTE    rgbSignature[ED25519_SIGNATURE_CB];
+};
+
+class CQRApprovalVerifier
+{
+  public:
+    CQRApprovalVerifier();
+    ~CQRApprovalVerifier();
+
+    // Loads and decompresses the backend's public key and prepares a reusable
+    // SHA-512 object.  Returns S_FALSE if no key has been provisioned.
+    HRESULT Initialize();
+
+    bool IsProvisioned() const
+    {
+        return _hHash != NULL;
+    }
+
+    // Drops the key and hash object, as if Initialize had never been called.
+    void Uninitialize()
+    {
+        _Cleanup();
+    }
+
+    // Decodes the token and signature of an approved status response.
+    static HRESULT DecodeApproval(__in const QR_BACKEND_RESPONSE* pResponse, __out QR_APPROVAL* pApproval);
+
+    // Returns S_OK if pApproval is correctly signed, bound to pbNonce and not
+    // expired, and S_FALSE if it is not.
+    HRESULT Verify(__in const QR_APPROVAL* pApproval, __in_bcount(QR_APPROVAL_NONCE_CB) const BYTE* pbNonce);
+
+    // Verifies c approvals, each against its own nonce, and stores S_OK or
+    // S_FALSE for each in rghrResult.  Signatures are checked together in
+    // groups of ED25519_BATCH_MAX; only a group that fails is re-checked one
+    // signature at a time.
+    HRESULT VerifyBatch(__in DWORD c,
+                        __in_ecount(c) const QR_APPROVAL* rgApproval,
+                        __in_ecount(c) const BYTE* const* rgpbNonce,
+                        __out_ecount(c) HRESULT* rghrResult);
+
+    // Copies the approved username out of the payload.  The caller frees
+    // *ppwszUsername with CoTaskMemFree.
+    static HRESULT GetUsername(__in const QR_APPROVAL* pApproval, __deref_out PWSTR* ppwszUsername);
+
+    // Returns the expiry of a decoded approval, in Unix seconds.
+    static ULONGLONG GetExpiry(__in const QR_APPROVAL* pApproval);
+
+    static ULONGLONG GetUnixTime();
+
+  private:
+    bool _IsBoundAndCurrent(__in const QR_APPROVAL* pApproval, __in_bcount(QR_APPROVAL_NONCE_CB) const BYTE* pbNonce);
+    HRESULT _ComputeHram(__in const QR_APPROVAL* pApproval, __out_bcount(ED25519_HRAM_CB) BYTE* pbHram);
+    void _Cleanup();
+
+  private:
+    ED25519_PUBLIC_KEY  _key;
+    BCRYPT_ALG_HANDLE   _hAlg;
+    BCRYPT_HASH_HANDLE  _hHash;          // Reusable SHA-512, NULL until a key is loaded.
+    BYTE*               _pbHashObject;
+    DWORD               _cbHashObject;
+};
@@ -0,0 +1,262 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//
+
+#ifndef WIN32_NO_STATUS
+#include <ntstatus.h>
+#define WIN32_NO_STATUS
+#endif
+#include <windows.h>
+#include <bcrypt.h>
+#include <strsafe.h>
+#include <helpers.h>
+#include "QRChallenge.h"
+
+#pragma comment(lib, "bcrypt.lib")
+
+// Base of the URL placed in the QR code.  The phone companion reads the
+// challenge (c) and the time step (t) from the query string.
+#define QR_CHALLENGE_BASE_URL       L"https://example.com/qrcode/"
+
+// Purpose bytes that keep the challenge and the approval code independent.
+#define QR_MAC_PURPOSE_CHALLENGE    'C'
+#define QR_MAC_PURPOSE_APPROVAL     'A'
+
+// Offset between the FILETIME epoch (1601) and the Unix epoch (1970) in 100ns units.
+#define FILETIME_UNIX_EPOCH         116444736000000000ULL
+#define FILETIME_TICKS_PER_SECOND   10000000ULL
+
+CQRChallenge::CQRChallenge():
+    _hAlg(NULL),
+    _hHash(NULL),
+    _pbHashObject(NULL),
+    _cbHashObject(0)
+{
+}
+
+CQRChallenge::~CQRChallenge()
+{
+    _Cleanup();
+}
+
+void CQRChallenge::_Cleanup()
+{
+    if (_hHash)
+    {
+        BCryptDestroyHash(_hHash);
+        _hHash = NULL;
+    }
+    if (_pbHashObject)
+    {
+        // The hash object holds the keyed HMAC state, so treat it like the secret itself.
+        SecureZeroMemory(_pbHashObject, _cbHashObject);
+        HeapFree(GetProcessHeap(), 0, _pbHashObject);
+        _pbHashObject = NULL;
+        _cbHashObject = 0;
+    }
+    if (_hAlg)
+    {
+        BCryptCloseAlgorithmProvider(_hAlg, 0);
+        _hAlg = NULL;
+    }
+}
+
+// Opens the HMAC-SHA256 provider once and keys a reusable hash object with the
+// device secret.  Every challenge and approval code afterwards is a single
+// BCryptHashData/BCryptFinishHash pair with no further allocation.
+HRESULT CQRChallenge::Initialize()
+{
+    _Cleanup();
+
+    BYTE rgbSecret[QR_CHALLENGE_SECRET_CB_MAX];
+    DWORD cbSecret = sizeof(rgbSecret);
+    LONG lResult = RegGetValueW(HKEY_LOCAL_MACHINE, QR_CHALLENGE_REGKEY, QR_CHALLENGE_REGVALUE,
+                                RRF_RT_REG_BINARY, NULL, rgbSecret, &cbSecret);
+
+    HRESULT hr;
+    if (ERROR_FILE_NOT_FOUND == lResult)
+    {
+        // Nothing provisioned; the caller falls back to online mode.
+        return S_FALSE;
+    }
+    else if (ERROR_SUCCESS != lResult)
+    {
+        hr = HRESULT_FROM_WIN32(lResult);
+    }
+    else if (cbSecret < QR_CHALLENGE_SECRET_CB_MIN)
+    {
+        hr = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+    else
+    {
+        hr = HResultFromNtStatus(BCryptOpenAlgorithmProvider(&_hAlg, BCRYPT_SHA256_ALGORITHM, NULL,
+                                                          BCRYPT_ALG_HANDLE_HMAC_FLAG | BCRYPT_HASH_REUSABLE_FLAG));
+        if (SUCCEEDED(hr))
+        {
+            ULONG cbResult;
+            hr = HResultFromNtStatus(BCryptGetProperty(_hAlg, BCRYPT_OBJECT_LENGTH, (PUCHAR)&_cbHashObject,
+                                                   sizeof(_cbHashObject), &cbResult, 0));
+        }
+        if (SUCCEEDED(hr))
+        {
+            _pbHashObject = (BYTE*)HeapAlloc(GetProcessHeap(), 0, _cbHashObject);
+            hr = _pbHashObject ? S_OK : E_OUTOFMEMORY;
+        }
+        if (SUCCEEDED(hr))
+        {
+            hr = HResultFromNtStatus(BCryptCreateHash(_hAlg, &_hHash, _pbHashObject, _cbHashObject,
+                                                  rgbSecret, cbSecret, BCRYPT_HASH_REUSABLE_FLAG));
+        }
+    }
+    SecureZeroMemory(rgbSecret, sizeof(rgbSecret));
+
+    if (FAILED(hr))
+    {
+        _Cleanup();
+    }
+    return hr;
+}
+
+ULONGLONG CQRChallenge::GetCurrentTimeStep()
+{
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+
+    ULARGE_INTEGER uli;
+    uli.LowPart = ft.dwLowDateTime;
+    uli.HighPart = ft.dwHighDateTime;
+
+    return ((uli.QuadPart - FILETIME_UNIX_EPOCH) / FILETIME_TICKS_PER_SECOND) / QR_CHALLENGE_TIME_STEP;
+}
+
+DWORD CQRChallenge::GetTimeStepRemainingMs()
+{
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+
+    ULARGE_INTEGER uli;
+    uli.LowPart = ft.dwLowDateTime;
+    uli.HighPart = ft.dwHighDateTime;
+
+    const ULONGLONG ullStepTicks = QR_CHALLENGE_TIME_STEP * FILETIME_TICKS_PER_SECOND;
+    const ULONGLONG ullRemaining = ullStepTicks - (uli.QuadPart - FILETIME_UNIX_EPOCH) % ullStepTicks;
+
+    // Round up so the timer lands in the new step, not at the end of the old one.
+    return (DWORD)((ullRemaining + FILETIME_TICKS_PER_SECOND / 1000 - 1) / (FILETIME_TICKS_PER_SECOND / 1000));
+}
+
+// MAC input is "QRL1", a purpose byte and the big-endian time step.
+HRESULT CQRChallenge::_ComputeMac(
+    __in BYTE bPurpose,
+    __in ULONGLONG ullTimeStep,
+    __out_bcount(32) BYTE* rgbMac
+    )
+{
+    if (!_hHash)
+    {
+        return E_UNEXPECTED;
+    }
+
+    BYTE rgbMessage[13] = { 'Q', 'R', 'L', '1', bPurpose };
+    for (int i = 0; i < 8; i++)
+    {
+        rgbMessage[5 + i] = (BYTE)(ullTimeStep >> (56 - 8 * i));
+    }
+
+    HRESULT hr = HResultFromNtStatus(BCryptHashData(_hHash, rgbMessage, sizeof(rgbMessage), 0));
+    if (SUCCEEDED(hr))
+    {
+        hr = HResultFromNtStatus(BCryptFinishHash(_hHash, rgbMac, 32, 0));
+    }
+    return hr;
+}
+
+HRESULT CQRChallenge::GetChallengeURL(
+    __in ULONGLONG ullTimeStep,
+    __deref_out PWSTR* ppwszURL
+    )
+{
+    static const WCHAR c_rgwchHex[] = L"0123456789abcdef";
+
+    *ppwszURL = NULL;
+
+    BYTE rgbMac[32];
+    HRESULT hr = _ComputeMac(QR_MAC_PURPOSE_CHALLENGE, ullTimeStep, rgbMac);
+    if (SUCCEEDED(hr))
+    {
+        WCHAR wszChallenge[QR_CHALLENGE_CB * 2 + 1];
+        for (DWORD i = 0; i < QR_CHALLENGE_CB; i++)
+        {
+            wszChallenge[2 * i] = c_rgwchHex[rgbMac[i] >> 4];
+            wszChallenge[2 * i + 1] = c_rgwchHex[rgbMac[i] & 0xf];
+        }
+        wszChallenge[QR_CHALLENGE_CB * 2] = L'\0';
+
+        // The base URL, the challenge, and a 20 digit step with room to spare.
+        const size_t cchURL = ARRAYSIZE(QR_CHALLENGE_BASE_URL) + ARRAYSIZE(wszChallenge) + 32;
+        *ppwszURL = (PWSTR)CoTaskMemAlloc(cchURL * sizeof(WCHAR));
+        if (*ppwszURL)
+        {
+            hr = StringCchPrintfW(*ppwszURL, cchURL, QR_CHALLENGE_BASE_URL L"?c=%s&t=%I64u", wszChallenge, ullTimeStep);
+            if (FAILED(hr))
+            {
+                CoTaskMemFree(*ppwszURL);
+                *ppwszURL = NULL;
+            }
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+    return hr;
+}
+
+HRESULT CQRChallenge::VerifyApprovalCode(__in PCWSTR pwzCode)
+{
+    if (!pwzCode || (QR_APPROVAL_CODE_DIGITS != lstrlenW(pwzCode)))
+    {
+        return S_FALSE;
+    }
+
+    HRESULT hr = S_OK;
+    bool fMatch = false;
+    ULONGLONG ullTimeStep = GetCurrentTimeStep();
+    for (ULONGLONG ullStep = ullTimeStep - QR_APPROVAL_STEP_WINDOW; SUCCEEDED(hr) && ullStep <= ullTimeStep; ullStep++)
+    {
+        BYTE rgbMac[32];
+        hr = _ComputeMac(QR_MAC_PURPOSE_APPROVAL, ullStep, rgbMac);
+        if (SUCCEEDED(hr))
+        {
+            // Dynamic truncation as in RFC 4226, applied to the SHA-256 output.
+            DWORD dwOffset = rgbMac[31] & 0xf;
+            DWORD dwCode = ((rgbMac[dwOffset] & 0x7f) << 24) |
+                           (rgbMac[dwOffset + 1] << 16) |
+                           (rgbMac[dwOffset + 2] << 8) |
+                           rgbMac[dwOffset + 3];
+
+            // Compare every digit so the time taken does not depend on where the
+            // first mismatch is.
+            WCHAR wchDiff = 0;
+            for (int i = QR_APPROVAL_CODE_DIGITS - 1; i >= 0; i--)
+            {
+                wchDiff |= pwzCode[i] ^ (WCHAR)(L'0' + dwCode % 10);
+                dwCode /= 10;
+            }
+            fMatch |= (0 == wchDiff);
+            SecureZeroMemory(rgbMac, sizeof(rgbMac));
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = fMatch ? S_OK : S_FALSE;
+    }
+    return hr;
+}
@@ -0,0 +1,83 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRChallenge derives the offline QR code challenge and the matching
+// approval code from a device secret that was provisioned ahead of time.
+// Both values are HMAC-SHA256 over the current time step (TOTP style), so
+// the tile can render its QR code immediately without asking a server for
+// a per-session URL.  The phone companion holds the same secret, computes
+// the approval code for the challenge it scanned, and the user types that
+// code into the tile.
+
+#pragma once
+
+#include <windows.h>
+#include <bcrypt.h>
+
+// Seconds covered by one time step.  A new challenge is shown for every step.
+#define QR_CHALLENGE_TIME_STEP      30
+
+// Number of decimal digits in an approval code.
+#define QR_APPROVAL_CODE_DIGITS     8
+
+// Number of earlier time steps whose approval code is still accepted.  This
+// covers a QR code that was scanned just before it rotated and small clock
+// skew between the phone and this machine.
+#define QR_APPROVAL_STEP_WINDOW     1
+
+// Bytes of the HMAC that are placed in the QR code as the challenge.
+#define QR_CHALLENGE_CB             16
+
+// Registry location of the provisioned device secret (REG_BINARY).
+#define QR_CHALLENGE_REGKEY         L"SOFTWARE\\qrcodelogin"
+#define QR_CHALLENGE_REGVALUE       L"DeviceSecret"
+
+#define QR_CHALLENGE_SECRET_CB_MIN  16
+#define QR_CHALLENGE_SECRET_CB_MAX  64
+
+class CQRChallenge
+{
+  public:
+    CQRChallenge();
+    ~CQRChallenge();
+
+    // Reads the device secret from the registry and prepares a reusable HMAC
+    // object.  Returns S_FALSE if no secret has been provisioned, in which
+    // case offline mode is unavailable.
+    HRESULT Initialize();
+
+    bool IsProvisioned() const
+    {
+        return _hHash != NULL;
+    }
+
+    // The time step that covers the current system time.
+    static ULONGLONG GetCurrentTimeStep();
+
+    // Milliseconds until the current time step ends.
+    static DWORD GetTimeStepRemainingMs();
+
+    // Builds the URL encoded into the QR code for ullTimeStep.  The caller
+    // frees *ppwszURL with CoTaskMemFree.
+    HRESULT GetChallengeURL(__in ULONGLONG ullTimeStep, __deref_out PWSTR* ppwszURL);
+
+    // Checks pwzCode against the approval codes for the current time step and
+    // the QR_APPROVAL_STEP_WINDOW steps before it.  Returns S_OK on a match and
+    // S_FALSE otherwise.
+    HRESULT VerifyApprovalCode(__in PCWSTR pwzCode);
+
+  private:
+    HRESULT _ComputeMac(__in BYTE bPurpose, __in ULONGLONG ullTimeStep, __out_bcount(32) BYTE* rgbMac);
+    void _Cleanup();
+
+  private:
+    BCRYPT_ALG_HANDLE   _hAlg;
+    BCRYPT_HASH_HANDLE  _hHash;          // Keyed with the device secret and reused for every MAC.
+    BYTE*               _pbHashObject;   // Backing storage for _hHash.
+    DWORD               _cbHashObject;
+};
@@ -0,0 +1,554 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Field elements are sixteen signed 16 bit limbs held in 64 bit integers, and
+// points use extended twisted Edwards coordinates (X, Y, Z, T).  The layout
+// and constants match TweetNaCl.
+
+#include <windows.h>
+#include "QREd25519.h"
+
+typedef LONGLONG FE[16];
+typedef FE ED_POINT[4];
+
+static const FE c_feZero = { 0 };
+static const FE c_feOne = { 1 };
+
+// d, 2d, the base point coordinates, and sqrt(-1).
+static const FE c_feD = { 0x78a3, 0x1359, 0x4dca, 0x75eb, 0xd8ab, 0x4141, 0x0a4d, 0x0070,
+                          0xe898, 0x7779, 0x4079, 0x8cc7, 0xfe73, 0x2b6f, 0x6cee, 0x5203 };
+static const FE c_feD2 = { 0xf159, 0x26b2, 0x9b94, 0xebd6, 0xb156, 0x8283, 0x149a, 0x00e0,
+                           0xd130, 0xeef3, 0x80f2, 0x198e, 0xfce7, 0x56df, 0xd9dc, 0x2406 };
+static const FE c_feBaseX = { 0xd51a, 0x8f25, 0x2d60, 0xc956, 0xa7b2, 0x9525, 0xc760, 0x692c,
+                              0xdc5c, 0xfdd6, 0xe231, 0xc0a4, 0x53fe, 0xcd6e, 0x36d3, 0x2169 };
+static const FE c_feBaseY = { 0x6658, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666,
+                              0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666, 0x6666 };
+static const FE c_feSqrtM1 = { 0xa0b0, 0x4a0e, 0x1b27, 0xc4ee, 0xe478, 0xad2f, 0x1806, 0x2f43,
+                               0xd7a7, 0x3dfb, 0x0099, 0x2b4d, 0xdf0b, 0x4fc1, 0x2480, 0x2b83 };
+
+// The group order L = 2^252 + 27742317777372353535851937790883648493, little endian.
+static const LONGLONG c_rgllL[32] = { 0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+                                      0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+                                      0, 0, 0, 0, 0, 0, 0, 0,
+                                      0, 0, 0, 0, 0, 0, 0, 0x10 };
+
+// Encoding of the neutral element (x = 0, y = 1).
+static const BYTE c_rgbIdentity[32] = { 1 };
+
+//
+// Field arithmetic modulo p = 2^255 - 19.
+//
+
+static void FeCopy(__out FE r, __in const FE a)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        r[i] = a[i];
+    }
+}
+
+static void FeCarry(__inout FE o)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        o[i] += (1LL << 16);
+        LONGLONG c = o[i] >> 16;
+        o[(i + 1) * (i < 15)] += c - 1 + 37 * (c - 1) * (i == 15);
+        o[i] -= c << 16;
+    }
+}
+
+static void FeSelect(__inout FE p, __inout FE q, __in int b)
+{
+    LONGLONG c = ~(LONGLONG)(b - 1);
+    for (int i = 0; i < 16; i++)
+    {
+        LONGLONG t = c & (p[i] ^ q[i]);
+        p[i] ^= t;
+        q[i] ^= t;
+    }
+}
+
+static void FePack(__out_bcount(32) BYTE* o, __in const FE n)
+{
+    FE m;
+    FE t;
+    FeCopy(t, n);
+    FeCarry(t);
+    FeCarry(t);
+    FeCarry(t);
+    for (int j = 0; j < 2; j++)
+    {
+        m[0] = t[0] - 0xffed;
+        for (int i = 1; i < 15; i++)
+        {
+            m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+            m[i - 1] &= 0xffff;
+        }
+        m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+        int b = (int)((m[15] >> 16) & 1);
+        m[14] &= 0xffff;
+        FeSelect(t, m, 1 - b);
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        o[2 * i] = (BYTE)(t[i] & 0xff);
+        o[2 * i + 1] = (BYTE)(t[i] >> 8);
+    }
+}
+
+static bool FeEqual(__in const FE a, __in const FE b)
+{
+    BYTE rgbA[32];
+    BYTE rgbB[32];
+    FePack(rgbA, a);
+    FePack(rgbB, b);
+    return 0 == memcmp(rgbA, rgbB, sizeof(rgbA));
+}
+
+static BYTE FeParity(__in const FE a)
+{
+    BYTE rgb[32];
+    FePack(rgb, a);
+    return rgb[0] & 1;
+}
+
+static void FeUnpack(__out FE o, __in_bcount(32) const BYTE* n)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        o[i] = n[2 * i] + ((LONGLONG)n[2 * i + 1] << 8);
+    }
+    o[15] &= 0x7fff;
+}
+
+static void FeAdd(__out FE o, __in const FE a, __in const FE b)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        o[i] = a[i] + b[i];
+    }
+}
+
+static void FeSub(__out FE o, __in const FE a, __in const FE b)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        o[i] = a[i] - b[i];
+    }
+}
+
+static void FeMul(__out FE o, __in const FE a, __in const FE b)
+{
+    LONGLONG t[31] = { 0 };
+    for (int i = 0; i < 16; i++)
+    {
+        for (int j = 0; j < 16; j++)
+        {
+            t[i + j] += a[i] * b[j];
+        }
+    }
+    for (int i = 0; i < 15; i++)
+    {
+        t[i] += 38 * t[i + 16];
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        o[i] = t[i];
+    }
+    FeCarry(o);
+    FeCarry(o);
+}
+
+static void FeSquare(__out FE o, __in const FE a)
+{
+    FeMul(o, a, a);
+}
+
+static void FeInvert(__out FE o, __in const FE i)
+{
+    FE c;
+    FeCopy(c, i);
+    for (int a = 253; a >= 0; a--)
+    {
+        FeSquare(c, c);
+        if (a != 2 && a != 4)
+        {
+            FeMul(c, c, i);
+        }
+    }
+    FeCopy(o, c);
+}
+
+// o = i^((p - 5) / 8), used for the square root in point decompression.
+static void FePow2523(__out FE o, __in const FE i)
+{
+    FE c;
+    FeCopy(c, i);
+    for (int a = 250; a >= 0; a--)
+    {
+        FeSquare(c, c);
+        if (a != 1)
+        {
+            FeMul(c, c, i);
+        }
+    }
+    FeCopy(o, c);
+}
+
+//
+// Point arithmetic.
+//
+
+static void PointCopy(__out ED_POINT r, __in const ED_POINT p)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        FeCopy(r[i], p[i]);
+    }
+}
+
+static void PointIdentity(__out ED_POINT p)
+{
+    FeCopy(p[0], c_feZero);
+    FeCopy(p[1], c_feOne);
+    FeCopy(p[2], c_feOne);
+    FeCopy(p[3], c_feZero);
+}
+
+static void PointBase(__out ED_POINT p)
+{
+    FeCopy(p[0], c_feBaseX);
+    FeCopy(p[1], c_feBaseY);
+    FeCopy(p[2], c_feOne);
+    FeMul(p[3], c_feBaseX, c_feBaseY);
+}
+
+// p += q.  The formula is unified, so q may equal p.
+static void PointAdd(__inout ED_POINT p, __in const ED_POINT q)
+{
+    FE a, b, c, d, t, e, f, g, h;
+
+    FeSub(a, p[1], p[0]);
+    FeSub(t, q[1], q[0]);
+    FeMul(a, a, t);
+    FeAdd(b, p[0], p[1]);
+    FeAdd(t, q[0], q[1]);
+    FeMul(b, b, t);
+    FeMul(c, p[3], q[3]);
+    FeMul(c, c, c_feD2);
+    FeMul(d, p[2], q[2]);
+    FeAdd(d, d, d);
+    FeSub(e, b, a);
+    FeSub(f, d, c);
+    FeAdd(g, d, c);
+    FeAdd(h, b, a);
+
+    FeMul(p[0], e, f);
+    FeMul(p[1], h, g);
+    FeMul(p[2], g, f);
+    FeMul(p[3], e, h);
+}
+
+static void PointDouble(__inout ED_POINT p)
+{
+    ED_POINT q;
+    PointCopy(q, p);
+    PointAdd(p, q);
+}
+
+static void PointPack(__out_bcount(32) BYTE* r, __in const ED_POINT p)
+{
+    FE tx, ty, zi;
+    FeInvert(zi, p[2]);
+    FeMul(tx, p[0], zi);
+    FeMul(ty, p[1], zi);
+    FePack(r, ty);
+    r[31] ^= FeParity(tx) << 7;
+}
+
+// Decompresses the negation of the point encoded at pb.  Rejects encodings
+// whose y is not reduced and values that are not on the curve.
+static bool PointUnpackNegated(__out ED_POINT r, __in_bcount(32) const BYTE* pb)
+{
+    // y must be below p = 2^255 - 19.
+    bool fAllOnes = ((pb[31] & 0x7f) == 0x7f);
+    for (int i = 1; fAllOnes && i < 31; i++)
+    {
+        fAllOnes = (0xff == pb[i]);
+    }
+    if (fAllOnes && (pb[0] >= 0xed))
+    {
+        return false;
+    }
+
+    FE t, chk, num, den, den2, den4, den6;
+    FeCopy(r[2], c_feOne);
+    FeUnpack(r[1], pb);
+    FeSquare(num, r[1]);
+    FeMul(den, num, c_feD);
+    FeSub(num, num, r[2]);
+    FeAdd(den, r[2], den);
+
+    FeSquare(den2, den);
+    FeSquare(den4, den2);
+    FeMul(den6, den4, den2);
+    FeMul(t, den6, num);
+    FeMul(t, t, den);
+
+    FePow2523(t, t);
+    FeMul(t, t, num);
+    FeMul(t, t, den);
+    FeMul(t, t, den);
+    FeMul(r[0], t, den);
+
+    FeSquare(chk, r[0]);
+    FeMul(chk, chk, den);
+    if (!FeEqual(chk, num))
+    {
+        FeMul(r[0], r[0], c_feSqrtM1);
+    }
+
+    FeSquare(chk, r[0]);
+    FeMul(chk, chk, den);
+    if (!FeEqual(chk, num))
+    {
+        return false;
+    }
+
+    if (FeParity(r[0]) == (pb[31] >> 7))
+    {
+        FeSub(r[0], c_feZero, r[0]);
+    }
+
+    FeMul(r[3], r[0], r[1]);
+    return true;
+}
+
+// True if [8]p is the neutral element: p is the identity or one of the
+// seven other points of small order.  Verification checks its equation this
+// way, so both paths accept the same signatures whatever torsion R and A carry.
+static bool PointHasSmallOrder(__in const ED_POINT p)
+{
+    ED_POINT q;
+    PointCopy(q, p);
+    PointDouble(q);
+    PointDouble(q);
+    PointDouble(q);
+
+    BYTE rgb[32];
+    PointPack(rgb, q);
+    return (0 == memcmp(rgb, c_rgbIdentity, sizeof(rgb)));
+}
+
+// r = sum of [rgpbScalar[j]] rgpPoint[j], one shared chain of doublings
+// (Straus).  Scalars are 32 byte little endian.
+static void PointMultiScalarMul(
+    __out ED_POINT r,
+    __in DWORD c,
+    __in_ecount(c) const ED_POINT* rgpPoint[],
+    __in_ecount(c) const BYTE* rgpbScalar[]
+    )
+{
+    PointIdentity(r);
+    for (int iBit = 255; iBit >= 0; iBit--)
+    {
+        PointDouble(r);
+        for (DWORD j = 0; j < c; j++)
+        {
+            if ((rgpbScalar[j][iBit / 8] >> (iBit & 7)) & 1)
+            {
+                PointAdd(r, *rgpPoint[j]);
+            }
+        }
+    }
+}
+
+//
+// Scalar arithmetic modulo L.
+//
+
+static void ScalarModL(__out_bcount(32) BYTE* r, __inout LONGLONG x[64])
+{
+    LONGLONG carry;
+    int i, j;
+    for (i = 63; i >= 32; --i)
+    {
+        carry = 0;
+        for (j = i - 32; j < i - 12; ++j)
+        {
+            x[j] += carry - 16 * x[i] * c_rgllL[j - (i - 32)];
+            carry = (x[j] + 128) >> 8;
+            x[j] -= carry << 8;
+        }
+        x[j] += carry;
+        x[i] = 0;
+    }
+    carry = 0;
+    for (j = 0; j < 32; j++)
+    {
+        x[j] += carry - (x[31] >> 4) * c_rgllL[j];
+        carry = x[j] >> 8;
+        x[j] &= 255;
+    }
+    for (j = 0; j < 32; j++)
+    {
+        x[j] -= carry * c_rgllL[j];
+    }
+    for (i = 0; i < 32; i++)
+    {
+        x[i + 1] += x[i] >> 8;
+        r[i] = (BYTE)(x[i] & 255);
+    }
+}
+
+// r = hram mod L.
+static void ScalarReduce(__out_bcount(32) BYTE* r, __in_bcount(64) const BYTE* pbHram)
+{
+    LONGLONG x[64];
+    for (int i = 0; i < 64; i++)
+    {
+        x[i] = pbHram[i];
+    }
+    ScalarModL(r, x);
+}
+
+// r = (r + a * b) mod L, with a cbA bytes long and b a reduced scalar.
+static void ScalarMulAdd(__inout_bcount(32) BYTE* r, __in_bcount(cbA) const BYTE* pbA, __in DWORD cbA, __in_bcount(32) const BYTE* pbB)
+{
+    LONGLONG x[64] = { 0 };
+    for (int i = 0; i < 32; i++)
+    {
+        x[i] = r[i];
+    }
+    for (DWORD i = 0; i < cbA; i++)
+    {
+        for (int j = 0; j < 32; j++)
+        {
+            x[i + j] += (LONGLONG)pbA[i] * pbB[j];
+        }
+    }
+    ScalarModL(r, x);
+}
+
+// True if the little endian scalar at pb is below L (rules out malleable S).
+static bool ScalarIsCanonical(__in_bcount(32) const BYTE* pb)
+{
+    for (int i = 31; i >= 0; i--)
+    {
+        if (pb[i] != c_rgllL[i])
+        {
+            return pb[i] < c_rgllL[i];
+        }
+    }
+    return false;
+}
+
+HRESULT Ed25519DecodePublicKey(
+    __in_bcount(ED25519_PUBLIC_KEY_CB) const BYTE* pbKey,
+    __out ED25519_PUBLIC_KEY* pKey
+    )
+{
+    ZeroMemory(pKey, sizeof(*pKey));
+
+    // A small order key verifies signatures nobody made.
+    if (!PointUnpackNegated(pKey->rgllNegA, pbKey) || PointHasSmallOrder(pKey->rgllNegA))
+    {
+        return NTE_BAD_KEY;
+    }
+    CopyMemory(pKey->rgbKey, pbKey, ED25519_PUBLIC_KEY_CB);
+    return S_OK;
+}
+
+HRESULT Ed25519Verify(
+    __in const ED25519_PUBLIC_KEY* pKey,
+    __in_bcount(ED25519_SIGNATURE_CB) const BYTE* pbSignature,
+    __in_bcount(ED25519_HRAM_CB) const BYTE* pbHram
+    )
+{
+    if (!ScalarIsCanonical(pbSignature + 32))
+    {
+        return S_FALSE;
+    }
+
+    ED_POINT ptNegR;
+    if (!PointUnpackNegated(ptNegR, pbSignature) || PointHasSmallOrder(ptNegR))
+    {
+        return S_FALSE;
+    }
+
+    BYTE rgbK[32];
+    ScalarReduce(rgbK, pbHram);
+
+    // [8]([S]B + [k](-A) + (-R)) must be the identity, the same cofactored
+    // equation Ed25519VerifyBatch checks.
+    static const BYTE c_rgbOne[32] = { 1 };
+    ED_POINT ptBase;
+    PointBase(ptBase);
+
+    const ED_POINT* rgpPoint[] = { &ptBase, &pKey->rgllNegA, &ptNegR };
+    const BYTE* rgpbScalar[] = { pbSignature + 32, rgbK, c_rgbOne };
+
+    ED_POINT ptCheck;
+    PointMultiScalarMul(ptCheck, ARRAYSIZE(rgpPoint), rgpPoint, rgpbScalar);
+    return PointHasSmallOrder(ptCheck) ? S_OK : S_FALSE;
+}
+
+HRESULT Ed25519VerifyBatch(
+    __in const ED25519_PUBLIC_KEY* pKey,
+    __in DWORD c,
+    __in_ecount(c) const BYTE* const* rgpbSignature,
+    __in_ecount(c) const BYTE* const* rgpbHram,
+    __in_bcount(c * ED25519_BATCH_Z_CB) const BYTE* pbZ
+    )
+{
+    if (c > ED25519_BATCH_MAX)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Points: B, -A, then -R_i.  Scalars: sum z_i S_i, sum z_i k_i, then z_i.
+    ED_POINT rgptNegR[ED25519_BATCH_MAX];
+    BYTE rgrgbZ[ED25519_BATCH_MAX][32];
+    BYTE rgbSumZS[32] = { 0 };
+    BYTE rgbSumZK[32] = { 0 };
+
+    for (DWORD i = 0; i < c; i++)
+    {
+        const BYTE* pbSignature = rgpbSignature[i];
+        if (!ScalarIsCanonical(pbSignature + 32) || !PointUnpackNegated(rgptNegR[i], pbSignature) ||
+            PointHasSmallOrder(rgptNegR[i]))
+        {
+            return S_FALSE;
+        }
+
+        const BYTE* pbZi = pbZ + i * ED25519_BATCH_Z_CB;
+        ZeroMemory(rgrgbZ[i], sizeof(rgrgbZ[i]));
+        CopyMemory(rgrgbZ[i], pbZi, ED25519_BATCH_Z_CB);
+
+        BYTE rgbK[32];
+        ScalarReduce(rgbK, rgpbHram[i]);
+        ScalarMulAdd(rgbSumZS, pbZi, ED25519_BATCH_Z_CB, pbSignature + 32);
+        ScalarMulAdd(rgbSumZK, pbZi, ED25519_BATCH_Z_CB, rgbK);
+    }
+
+    ED_POINT ptBase;
+    PointBase(ptBase);
+
+    const ED_POINT* rgpPoint[ED25519_BATCH_MAX + 2] = { &ptBase, &pKey->rgllNegA };
+    const BYTE* rgpbScalar[ED25519_BATCH_MAX + 2] = { rgbSumZS, rgbSumZK };
+    for (DWORD i = 0; i < c; i++)
+    {
+        rgpPoint[i + 2] = &rgptNegR[i];
+        rgpbScalar[i + 2] = rgrgbZ[i];
+    }
+
+    ED_POINT ptCheck;
+    PointMultiScalarMul(ptCheck, c + 2, rgpPoint, rgpbScalar);
+    return PointHasSmallOrder(ptCheck) ? S_OK : S_FALSE;
+}
@@ -0,0 +1,71 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Ed25519 signature verification (RFC 8032) for approval assertions signed
+// by the QR login backend.  CNG has no Ed25519 support, so the curve
+// arithmetic lives here; it follows the public domain TweetNaCl field and
+// point code.  Hashing is left to the caller, which already holds a reusable
+// CNG SHA-512 object: each function takes SHA-512(R || A || M) ("hram")
+// rather than the message itself.
+//
+// Only public values are handled, so the scalar multiplications are
+// variable time.
+
+#pragma once
+
+#include <windows.h>
+
+#define ED25519_PUBLIC_KEY_CB   32
+#define ED25519_SIGNATURE_CB    64
+#define ED25519_HRAM_CB         64
+
+// Scalars used to combine signatures in a batch are this many bytes long.
+#define ED25519_BATCH_Z_CB      16
+
+// Largest number of signatures Ed25519VerifyBatch checks in one equation.
+#define ED25519_BATCH_MAX       16
+
+// A public key decompressed once so repeated verifications skip the square
+// root.  The point is stored negated, as verification needs -A.
+struct ED25519_PUBLIC_KEY
+{
+    LONGLONG    rgllNegA[4][16];
+    BYTE        rgbKey[ED25519_PUBLIC_KEY_CB];
+};
+
+// Decodes and validates pbKey.  Fails with NTE_BAD_KEY if it is not the
+// canonical encoding of a curve point, or is a point of small order.
+HRESULT Ed25519DecodePublicKey(
+    __in_bcount(ED25519_PUBLIC_KEY_CB) const BYTE* pbKey,
+    __out ED25519_PUBLIC_KEY* pKey
+    );
+
+// Checks the cofactored equation [8][S]B == [8]R + [8][k]A, with k the
+// reduced hram, as Ed25519VerifyBatch does, so a signature is accepted alone
+// exactly when it is accepted in a batch.  S must be below L and R a point
+// that is not of small order.  Returns S_OK for a valid signature and
+// S_FALSE otherwise.
+HRESULT Ed25519Verify(
+    __in const ED25519_PUBLIC_KEY* pKey,
+    __in_bcount(ED25519_SIGNATURE_CB) const BYTE* pbSignature,
+    __in_bcount(ED25519_HRAM_CB) const BYTE* pbHram
+    );
+
+// Checks c signatures by the same key with one randomized, cofactored
+// equation: [8](sum z_i S_i)B == [8](sum z_i R_i) + [8](sum z_i k_i)A.  The
+// z_i must be fresh random values that the signer cannot predict.  The
+// checks on each S_i and R_i are those of Ed25519Verify.  Returns
+// S_OK if every signature is valid and S_FALSE if at least one is not, in
+// which case the caller verifies them one at a time to find it.
+HRESULT Ed25519VerifyBatch(
+    __in const ED25519_PUBLIC_KEY* pKey,
+    __in DWORD c,
+    __in_ecount(c) const BYTE* const* rgpbSignature,
+    __in_ecount(c) const BYTE* const* rgpbHram,
+    __in_bcount(c * ED25519_BATCH_Z_CB) const BYTE* pbZ
+    );
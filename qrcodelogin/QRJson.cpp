@@ -0,0 +1,534 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+//
+
+#include <windows.h>
+#include "QRJson.h"
+
+// Largest poll interval we accept from the server, in seconds.
+#define QR_JSON_INTERVAL_MAX    3600
+
+struct STATUS_NAME
+{
+    PCSTR           pszName;
+    QR_LOGIN_STATUS qrls;
+};
+
+static const STATUS_NAME s_rgStatusNames[] =
+{
+    { "pending",  QRLS_PENDING },
+    { "scanned",  QRLS_SCANNED },
+    { "approved", QRLS_APPROVED },
+    { "denied",   QRLS_DENIED },
+    { "expired",  QRLS_EXPIRED },
+};
+
+static bool IsJsonWhitespace(__in BYTE b)
+{
+    return (' ' == b) || ('\t' == b) || ('\r' == b) || ('\n' == b);
+}
+
+static int HexDigitValue(__in BYTE b)
+{
+    if (b >= '0' && b <= '9')
+    {
+        return b - '0';
+    }
+    else if (b >= 'a' && b <= 'f')
+    {
+        return b - 'a' + 10;
+    }
+    else if (b >= 'A' && b <= 'F')
+    {
+        return b - 'A' + 10;
+    }
+    return -1;
+}
+
+CQRJsonParser::CQRJsonParser():
+    _pResponse(NULL),
+    _ps(PS_ERROR)
+{
+}
+
+void CQRJsonParser::Reset(__out QR_BACKEND_RESPONSE* pResponse)
+{
+    ZeroMemory(pResponse, sizeof(*pResponse));
+    _pResponse = pResponse;
+    _ps = PS_BEGIN;
+    _jk = JK_OTHER;
+    _cchKey = 0;
+    _pchDest = NULL;
+    _cchDest = 0;
+    _cchDestMax = 0;
+    _cSkipDepth = 0;
+}
+
+HRESULT CQRJsonParser::Feed(__in_bcount(cb) const BYTE* pb, __in DWORD cb)
+{
+    for (DWORD i = 0; (i < cb) && (PS_ERROR != _ps); i++)
+    {
+        if (!_Step(pb[i]))
+        {
+            _ps = PS_ERROR;
+        }
+    }
+
+    HRESULT hr;
+    if (PS_ERROR == _ps)
+    {
+        hr = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+    else
+    {
+        hr = (PS_DONE == _ps) ? S_OK : S_FALSE;
+    }
+    return hr;
+}
+
+HRESULT CQRJsonParser::Finish()
+{
+    return (PS_DONE == _ps) ? S_OK : HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+}
+
+// Advances the state machine by one byte.  Returns false on malformed input.
+bool CQRJsonParser::_Step(__in BYTE b)
+{
+    bool fOk = true;
+
+    switch (_ps)
+    {
+    case PS_BEGIN:
+        if ('{' == b)
+        {
+            _ps = PS_KEY_OR_END;
+        }
+        else
+        {
+            fOk = IsJsonWhitespace(b);
+        }
+        break;
+
+    case PS_KEY_OR_END:
+        if ('"' == b)
+        {
+            _cchKey = 0;
+            _ps = PS_KEY;
+        }
+        else if ('}' == b)
+        {
+            _ps = PS_DONE;
+        }
+        else
+        {
+            fOk = IsJsonWhitespace(b);
+        }
+        break;
+
+    case PS_NEXT_KEY:
+        // A comma must be followed by another member, not the end of the object.
+        if ('"' == b)
+        {
+            _cchKey = 0;
+            _ps = PS_KEY;
+        }
+        else
+        {
+            fOk = IsJsonWhitespace(b);
+        }
+        break;
+
+    case PS_KEY:
+        if ('"' == b)
+        {
+            _EndKey();
+            _ps = PS_COLON;
+        }
+        else if ('\\' == b)
+        {
+            // None of the known keys contain escapes, so any escaped key is JK_OTHER.
+            _cchKey = ARRAYSIZE(_szKey);
+            _ps = PS_KEY_ESCAPE;
+        }
+        else if (b < 0x20)
+        {
+            fOk = false;
+        }
+        else if (_cchKey < ARRAYSIZE(_szKey))
+        {
+            _szKey[_cchKey++] = (CHAR)b;
+        }
+        break;
+
+    case PS_KEY_ESCAPE:
+        // Only the character after the backslash matters for finding the end of the key;
+        // the hex digits of a \u escape are ordinary key characters.
+        _ps = PS_KEY;
+        break;
+
+    case PS_COLON:
+        if (':' == b)
+        {
+            _ps = PS_VALUE;
+        }
+        else
+        {
+            fOk = IsJsonWhitespace(b);
+        }
+        break;
+
+    case PS_VALUE:
+        if (!IsJsonWhitespace(b))
+        {
+            fOk = _BeginValue(b);
+        }
+        break;
+
+    case PS_STRING:
+        if ('"' == b)
+        {
+            _EndString();
+            _ps = PS_COMMA_OR_END;
+        }
+        else if ('\\' == b)
+        {
+            _ps = PS_STRING_ESCAPE;
+        }
+        else if ((b < 0x20) || (_pchDest && (b >= 0x80)))
+        {
+            // Control characters are never valid; the known fields are ASCII by protocol.
+            fOk = false;
+        }
+        else
+        {
+            fOk = _AppendString(b);
+        }
+        break;
+
+    case PS_STRING_ESCAPE:
+        _ps = PS_STRING;
+        switch (b)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            fOk = _AppendString(b);
+            break;
+        case 'b':
+            fOk = _AppendString('\b');
+            break;
+        case 'f':
+            fOk = _AppendString('\f');
+            break;
+        case 'n':
+            fOk = _AppendString('\n');
+            break;
+        case 'r':
+            fOk = _AppendString('\r');
+            break;
+        case 't':
+            fOk = _AppendString('\t');
+            break;
+        case 'u':
+            _cHexDigits = 4;
+            _wchEscape = 0;
+            _ps = PS_STRING_UNICODE;
+            break;
+        default:
+            fOk = false;
+            break;
+        }
+        break;
+
+    case PS_STRING_UNICODE:
+        {
+            int nDigit = HexDigitValue(b);
+            if (nDigit < 0)
+            {
+                fOk = false;
+            }
+            else
+            {
+                _wchEscape = (WCHAR)((_wchEscape << 4) | nDigit);
+                if (0 == --_cHexDigits)
+                {
+                    _ps = PS_STRING;
+                    if (_pchDest)
+                    {
+                        fOk = (_wchEscape >= 0x20) && (_wchEscape < 0x80) && _AppendString((BYTE)_wchEscape);
+                    }
+                }
+            }
+        }
+        break;
+
+    case PS_NUMBER:
+        if (b >= '0' && b <= '9')
+        {
+            if (JK_INTERVAL == _jk)
+            {
+                _ullNumber = _ullNumber * 10 + (b - '0');
+                fOk = (_ullNumber <= QR_JSON_INTERVAL_MAX);
+            }
+            _fNumberDigits = true;
+        }
+        else if (('-' == b) || ('+' == b) || ('.' == b) || ('e' == b) || ('E' == b))
+        {
+            // The interval is a whole number of seconds; other numbers are skipped.
+            fOk = (JK_INTERVAL != _jk);
+        }
+        else
+        {
+            // The delimiter belongs to the enclosing object.
+            fOk = _EndNumber() && _Step(b);
+        }
+        break;
+
+    case PS_LITERAL:
+        if ((BYTE)*_pszLiteral == b)
+        {
+            if ('\0' == *++_pszLiteral)
+            {
+                _ps = PS_COMMA_OR_END;
+            }
+        }
+        else
+        {
+            fOk = false;
+        }
+        break;
+
+    case PS_SKIP:
+        if ('"' == b)
+        {
+            _ps = PS_SKIP_STRING;
+        }
+        else if (('{' == b) || ('[' == b))
+        {
+            _cSkipDepth++;
+        }
+        else if (('}' == b) || (']' == b))
+        {
+            if (0 == --_cSkipDepth)
+            {
+                _ps = PS_COMMA_OR_END;
+            }
+        }
+        break;
+
+    case PS_SKIP_STRING:
+        if ('"' == b)
+        {
+            _ps = PS_SKIP;
+        }
+        else if ('\\' == b)
+        {
+            _ps = PS_SKIP_ESCAPE;
+        }
+        break;
+
+    case PS_SKIP_ESCAPE:
+        _ps = PS_SKIP_STRING;
+        break;
+
+    case PS_COMMA_OR_END:
+        if (',' == b)
+        {
+            _ps = PS_NEXT_KEY;
+        }
+        else if ('}' == b)
+        {
+            _ps = PS_DONE;
+        }
+        else
+        {
+            fOk = IsJsonWhitespace(b);
+        }
+        break;
+
+    case PS_DONE:
+        // Only trailing whitespace may follow the object.
+        fOk = IsJsonWhitespace(b);
+        break;
+
+    default:
+        fOk = false;
+        break;
+    }
+
+    return fOk;
+}
+
+// Dispatches on the first byte of a value.  Known keys must have the type
+// the protocol defines for them.
+bool CQRJsonParser::_BeginValue(__in BYTE b)
+{
+    bool fOk = true;
+
+    if ('"' == b)
+    {
+        _cchDest = 0;
+        switch (_jk)
+        {
+        case JK_STATUS:
+            _pchDest = _szStatus;
+            _cchDestMax = ARRAYSIZE(_szStatus) - 1;
+            break;
+        case JK_TOKEN:
+            _pchDest = _pResponse->szToken;
+            _cchDestMax = ARRAYSIZE(_pResponse->szToken) - 1;
+            break;
+        case JK_SIGNATURE:
+            _pchDest = _pResponse->szSignature;
+            _cchDestMax = ARRAYSIZE(_pResponse->szSignature) - 1;
+            break;
+        case JK_INTERVAL:
+            fOk = false;
+            break;
+        default:
+            _pchDest = NULL;
+            break;
+        }
+        _ps = PS_STRING;
+    }
+    else if ((JK_OTHER != _jk) && (JK_INTERVAL != _jk))
+    {
+        fOk = false;
+    }
+    else if ((b >= '0' && b <= '9') || ('-' == b))
+    {
+        _ullNumber = 0;
+        _fNumberDigits = false;
+        _ps = PS_NUMBER;
+        fOk = _Step(b);
+    }
+    else if (JK_INTERVAL == _jk)
+    {
+        fOk = false;
+    }
+    else if ('t' == b)
+    {
+        _pszLiteral = "rue";
+        _ps = PS_LITERAL;
+    }
+    else if ('f' == b)
+    {
+        _pszLiteral = "alse";
+        _ps = PS_LITERAL;
+    }
+    else if ('n' == b)
+    {
+        _pszLiteral = "ull";
+        _ps = PS_LITERAL;
+    }
+    else if (('{' == b) || ('[' == b))
+    {
+        _cSkipDepth = 1;
+        _ps = PS_SKIP;
+    }
+    else
+    {
+        fOk = false;
+    }
+
+    return fOk;
+}
+
+bool CQRJsonParser::_AppendString(__in BYTE b)
+{
+    bool fOk = true;
+    if (_pchDest)
+    {
+        if (_cchDest < _cchDestMax)
+        {
+            _pchDest[_cchDest++] = (CHAR)b;
+        }
+        else
+        {
+            fOk = false;
+        }
+    }
+    return fOk;
+}
+
+void CQRJsonParser::_EndString()
+{
+    if (_pchDest)
+    {
+        _pchDest[_cchDest] = '\0';
+        switch (_jk)
+        {
+        case JK_STATUS:
+            _pResponse->qrls = QRLS_UNKNOWN;
+            for (DWORD i = 0; i < ARRAYSIZE(s_rgStatusNames); i++)
+            {
+                if (0 == lstrcmpA(_szStatus, s_rgStatusNames[i].pszName))
+                {
+                    _pResponse->qrls = s_rgStatusNames[i].qrls;
+                    break;
+                }
+            }
+            _pResponse->dwFieldsPresent |= QRJF_STATUS;
+            break;
+        case JK_TOKEN:
+            _pResponse->dwFieldsPresent |= QRJF_TOKEN;
+            break;
+        case JK_SIGNATURE:
+            _pResponse->dwFieldsPresent |= QRJF_SIGNATURE;
+            break;
+        default:
+            break;
+        }
+        _pchDest = NULL;
+    }
+}
+
+void CQRJsonParser::_EndKey()
+{
+    static const struct
+    {
+        PCSTR       pszKey;
+        JSON_KEY    jk;
+    } c_rgKeys[] =
+    {
+        { "status",    JK_STATUS },
+        { "token",     JK_TOKEN },
+        { "interval",  JK_INTERVAL },
+        { "signature", JK_SIGNATURE },
+    };
+
+    _jk = JK_OTHER;
+    if (_cchKey < ARRAYSIZE(_szKey))
+    {
+        _szKey[_cchKey] = '\0';
+        for (DWORD i = 0; i < ARRAYSIZE(c_rgKeys); i++)
+        {
+            if (0 == lstrcmpA(_szKey, c_rgKeys[i].pszKey))
+            {
+                _jk = c_rgKeys[i].jk;
+                break;
+            }
+        }
+    }
+}
+
+bool CQRJsonParser::_EndNumber()
+{
+    if (!_fNumberDigits)
+    {
+        return false;
+    }
+    if (JK_INTERVAL == _jk)
+    {
+        _pResponse->dwInterval = (DWORD)_ullNumber;
+        _pResponse->dwFieldsPresent |= QRJF_INTERVAL;
+    }
+    _ps = PS_COMMA_OR_END;
+    return true;
+}
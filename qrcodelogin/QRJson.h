@@ -0,0 +1,122 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRJsonParser is a streaming tokenizer for the JSON objects the QR login
+// backend returns from session creation and status polls.  It never
+// allocates: the known keys (status, token, interval, signature) are copied
+// straight from the receive buffer into a caller-supplied QR_BACKEND_RESPONSE
+// and everything else is skipped.  Input may be fed in any number of pieces,
+// so a response that arrives split across several reads needs no
+// reassembly buffer.
+
+#pragma once
+
+#include <windows.h>
+
+// Capacities, in bytes including the terminator, of the string fields.
+#define QR_JSON_TOKEN_CB        256
+#define QR_JSON_SIGNATURE_CB    128
+
+enum QR_LOGIN_STATUS
+{
+    QRLS_UNKNOWN    = 0,
+    QRLS_PENDING    = 1,    // The QR code has not been scanned yet.
+    QRLS_SCANNED    = 2,    // Scanned, waiting for the user to approve on the phone.
+    QRLS_APPROVED   = 3,
+    QRLS_DENIED     = 4,
+    QRLS_EXPIRED    = 5,
+};
+
+// Bits in QR_BACKEND_RESPONSE::dwFieldsPresent.
+#define QRJF_STATUS     0x1
+#define QRJF_TOKEN      0x2
+#define QRJF_INTERVAL   0x4
+#define QRJF_SIGNATURE  0x8
+
+struct QR_BACKEND_RESPONSE
+{
+    DWORD           dwFieldsPresent;                    // QRJF_* for each key that was seen.
+    QR_LOGIN_STATUS qrls;
+    DWORD           dwInterval;                         // Suggested poll interval in seconds.
+    CHAR            szToken[QR_JSON_TOKEN_CB];          // Session token (ASCII).
+    CHAR            szSignature[QR_JSON_SIGNATURE_CB];  // Base64 signature over the approval (ASCII).
+};
+
+class CQRJsonParser
+{
+  public:
+    CQRJsonParser();
+
+    // Starts a new response.  pResponse is zeroed and filled in as input is fed.
+    void Reset(__out QR_BACKEND_RESPONSE* pResponse);
+
+    // Consumes the next cb bytes of the response.  Returns S_FALSE while more
+    // input is needed, S_OK once the top-level object has been closed, and
+    // HRESULT_FROM_WIN32(ERROR_INVALID_DATA) on malformed input or a known
+    // string value that does not fit its field.
+    HRESULT Feed(__in_bcount(cb) const BYTE* pb, __in DWORD cb);
+
+    // Call after the last Feed.  Fails unless a complete object was parsed.
+    HRESULT Finish();
+
+  private:
+    enum PARSE_STATE
+    {
+        PS_BEGIN,
+        PS_KEY_OR_END,
+        PS_NEXT_KEY,
+        PS_KEY,
+        PS_KEY_ESCAPE,
+        PS_COLON,
+        PS_VALUE,
+        PS_STRING,
+        PS_STRING_ESCAPE,
+        PS_STRING_UNICODE,
+        PS_NUMBER,
+        PS_LITERAL,
+        PS_SKIP,
+        PS_SKIP_STRING,
+        PS_SKIP_ESCAPE,
+        PS_COMMA_OR_END,
+        PS_DONE,
+        PS_ERROR,
+    };
+
+    enum JSON_KEY
+    {
+        JK_OTHER,
+        JK_STATUS,
+        JK_TOKEN,
+        JK_INTERVAL,
+        JK_SIGNATURE,
+    };
+
+    bool _Step(__in BYTE b);
+    bool _BeginValue(__in BYTE b);
+    bool _AppendString(__in BYTE b);
+    void _EndString();
+    void _EndKey();
+    bool _EndNumber();
+
+  private:
+    QR_BACKEND_RESPONSE*    _pResponse;
+    PARSE_STATE             _ps;
+    JSON_KEY                _jk;            // Key whose value is being parsed.
+    CHAR                    _szKey[16];     // Long enough for every known key; longer keys are JK_OTHER.
+    DWORD                   _cchKey;
+    CHAR                    _szStatus[16];  // Scratch for the status value before it is mapped.
+    CHAR*                   _pchDest;       // Destination of the current string value, NULL to discard.
+    DWORD                   _cchDest;
+    DWORD                   _cchDestMax;
+    DWORD                   _cHexDigits;    // Digits left in a \uXXXX escape.
+    WCHAR                   _wchEscape;
+    ULONGLONG               _ullNumber;
+    bool                    _fNumberDigits;
+    PCSTR                   _pszLiteral;    // Remaining characters of true, false or null.
+    DWORD                   _cSkipDepth;    // Nesting depth inside a skipped object or array.
+};
@@ -0,0 +1,372 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Every slot is a single 64 bit word so it can be claimed with one
+// compare-exchange.  Two threads consuming the same nonce at the same moment
+// can both claim a slot; each re-checks after its own claim, and sequential
+// consistency of the interlocked operations guarantees at least one of them
+// sees the other and rejects.  In the worst case both reject, which is the
+// safe direction.
+
+#include "QRReplayCache.h"
+#include "QRApproval.h"
+
+// The exact set's tags are the low 32 bits of the bucket, so a slot only
+// aliases a live bucket after 2^32 buckets (136 years at one second each).
+// That leaves 32 bits of key: a fresh nonce matches a live key in its probe
+// window, and is wrongly rejected, about once in 2^28 consumes.
+#define EXACT_KEY_MASK      0x00000000FFFFFFFFULL
+#define EXACT_TAG_SHIFT     32
+#define EXACT_TAG_MASK      0xFFFFFFFFULL
+
+#define FILTER_TAG_SHIFT    48
+#define FILTER_TAG_MASK     0xFFFFULL
+#define FILTER_LANES        3
+#define FILTER_LANE_MASK    0xFFFFULL
+
+C_ASSERT(QR_REPLAY_FILTER_WORDS <= 0x10000);
+
+C_ASSERT(0 == (QR_REPLAY_EXACT_SLOTS & (QR_REPLAY_EXACT_SLOTS - 1)));
+C_ASSERT(0 == (QR_REPLAY_FILTER_WORDS & (QR_REPLAY_FILTER_WORDS - 1)));
+C_ASSERT(QR_REPLAY_BUCKETS <= EXACT_TAG_MASK);
+
+// A plain load of a 64 bit value is only atomic on 64 bit targets.
+static __inline ULONGLONG ReadSlot(__in volatile LONGLONG* pll)
+{
+#if defined(_M_X64) || defined(_M_ARM64)
+    return (ULONGLONG)*pll;
+#else
+    return (ULONGLONG)InterlockedCompareExchange64(pll, 0, 0);
+#endif
+}
+
+static __inline bool CompareExchangeSlot(__inout volatile LONGLONG* pll, __in ULONGLONG ullNew, __in ULONGLONG ullOld)
+{
+    return (LONGLONG)ullOld == InterlockedCompareExchange64(pll, (LONGLONG)ullNew, (LONGLONG)ullOld);
+}
+
+// FNV-1a over the nonce followed by a 64 bit finalizer.  The nonces are random,
+// so this only has to spread them, not resist a chosen-input attacker.
+static ULONGLONG HashNonce(__in_bcount(cbNonce) const BYTE* pbNonce, __in DWORD cbNonce)
+{
+    ULONGLONG h = 0xCBF29CE484222325ULL;
+    for (DWORD i = 0; i < cbNonce; i++)
+    {
+        h = (h ^ pbNonce[i]) * 0x100000001B3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static CQRReplayCache s_qrReplayCache(QR_APPROVAL_TTL_MAX);
+
+CQRReplayCache* GetQRReplayCache()
+{
+    return &s_qrReplayCache;
+}
+
+CQRReplayCache::CQRReplayCache(__in DWORD dwTtlSeconds):
+    _dwTtlSeconds(dwTtlSeconds),
+    _llNewestBucket(0),
+    _llLastFilterBucket(-1)
+{
+    // Entries stay live for at least (QR_REPLAY_BUCKETS - 1) whole buckets.
+    _dwBucketSeconds = (dwTtlSeconds + QR_REPLAY_BUCKETS - 2) / (QR_REPLAY_BUCKETS - 1);
+    if (0 == _dwBucketSeconds)
+    {
+        _dwBucketSeconds = 1;
+    }
+
+    ZeroMemory(&_stats, sizeof(_stats));
+    ZeroMemory((void*)_rgllExact, sizeof(_rgllExact));
+    ZeroMemory((void*)_rgrgllFilter, sizeof(_rgrgllFilter));
+}
+
+HRESULT CQRReplayCache::Consume(
+    __in_bcount(cbNonce) const BYTE* pbNonce,
+    __in DWORD cbNonce,
+    __in ULONGLONG ullExpiry,
+    __in ULONGLONG ullNow
+    )
+{
+    // An approval that outlives the TTL could also outlive its cache entry.
+    if ((ullExpiry <= ullNow) || (ullExpiry - ullNow > _dwTtlSeconds))
+    {
+        InterlockedIncrement64(&_stats.cExpired);
+        return S_FALSE;
+    }
+
+    ULONGLONG ullKey = HashNonce(pbNonce, cbNonce) & EXACT_KEY_MASK;
+    if (0 == ullKey)
+    {
+        ullKey = 1;
+    }
+    const ULONGLONG ullBucket = _CurrentBucket(ullNow);
+
+    HRESULT hr = S_FALSE;
+    ULONGLONG ullLastFilterBucket;
+    switch (_ExactInsert(ullKey, ullBucket))
+    {
+    case ER_INSERTED:
+        // The key may have gone to the filter earlier while the exact set was
+        // full.  Only look while the filter holds live entries, so its false
+        // positives cannot reject anything in normal operation.
+        ullLastFilterBucket = ReadSlot(&_llLastFilterBucket);
+        if ((MAXULONGLONG != ullLastFilterBucket) &&
+            _IsLive(ullLastFilterBucket, ullBucket, MAXULONGLONG) &&
+            (_FilterCount(ullKey, ullBucket) > 0))
+        {
+            InterlockedIncrement64(&_stats.cFilterRejects);
+        }
+        else
+        {
+            hr = S_OK;
+        }
+        break;
+
+    case ER_PRESENT:
+        InterlockedIncrement64(&_stats.cReplays);
+        break;
+
+    case ER_FULL:
+        InterlockedExchange64(&_llLastFilterBucket, (LONGLONG)ullBucket);
+        if (!_FilterInsert(ullKey, ullBucket))
+        {
+            InterlockedIncrement64(&_stats.cSaturated);
+        }
+        else
+        {
+            InterlockedIncrement64(&_stats.cFilterInserts);
+            if (_FilterCount(ullKey, ullBucket) > 1)
+            {
+                InterlockedIncrement64(&_stats.cFilterRejects);
+            }
+            else if (_ExactContains(ullKey, ullBucket, MAXDWORD))
+            {
+                // A slot freed up and another thread put the key there meanwhile.
+                InterlockedIncrement64(&_stats.cReplays);
+            }
+            else
+            {
+                hr = S_OK;
+            }
+        }
+        break;
+    }
+
+    if (S_OK == hr)
+    {
+        InterlockedIncrement64(&_stats.cConsumed);
+    }
+    return hr;
+}
+
+void CQRReplayCache::GetStats(__out QR_REPLAY_CACHE_STATS* pStats)
+{
+    pStats->cConsumed = InterlockedCompareExchange64(&_stats.cConsumed, 0, 0);
+    pStats->cReplays = InterlockedCompareExchange64(&_stats.cReplays, 0, 0);
+    pStats->cExpired = InterlockedCompareExchange64(&_stats.cExpired, 0, 0);
+    pStats->cFilterInserts = InterlockedCompareExchange64(&_stats.cFilterInserts, 0, 0);
+    pStats->cFilterRejects = InterlockedCompareExchange64(&_stats.cFilterRejects, 0, 0);
+    pStats->cSaturated = InterlockedCompareExchange64(&_stats.cSaturated, 0, 0);
+}
+
+// Callers read the clock on different threads, so one can be a little behind
+// another.  If it worked in its own, older bucket, entries tagged with the
+// newer one would look expired to it and be overwritten, so a slightly late
+// caller works in the newest bucket instead.  A clock set back by more than
+// the whole window is taken as is: anything consumed under the old time then
+// outlives the TTL by the new one and is refused before the cache is asked.
+ULONGLONG CQRReplayCache::_CurrentBucket(__in ULONGLONG ullNow)
+{
+    const ULONGLONG ullBucket = ullNow / _dwBucketSeconds;
+    for (;;)
+    {
+        const ULONGLONG ullNewest = ReadSlot(&_llNewestBucket);
+        if ((ullBucket <= ullNewest) && (ullBucket + QR_REPLAY_BUCKETS > ullNewest))
+        {
+            return ullNewest;
+        }
+        if (CompareExchangeSlot(&_llNewestBucket, ullBucket, ullNewest))
+        {
+            return ullBucket;
+        }
+    }
+}
+
+// A tag is live if it was written in one of the last QR_REPLAY_BUCKETS buckets.
+// Tags are truncated, so the comparison is done modulo the tag width, which
+// must be wide enough that no slot goes untouched for a whole wrap.
+bool CQRReplayCache::_IsLive(__in ULONGLONG ullTag, __in ULONGLONG ullBucket, __in ULONGLONG ullTagMask)
+{
+    return ((ullBucket - ullTag) & ullTagMask) < QR_REPLAY_BUCKETS;
+}
+
+// Looks for a live copy of ullKey in its probe window, skipping slot iSkip.
+bool CQRReplayCache::_ExactContains(__in ULONGLONG ullKey, __in ULONGLONG ullBucket, __in DWORD iSkip)
+{
+    const DWORD iStart = (DWORD)ullKey & (QR_REPLAY_EXACT_SLOTS - 1);
+    for (DWORD iProbe = 0; iProbe < QR_REPLAY_EXACT_PROBES; iProbe++)
+    {
+        const DWORD i = (iStart + iProbe) & (QR_REPLAY_EXACT_SLOTS - 1);
+        const ULONGLONG ull = ReadSlot(&_rgllExact[i]);
+        if ((i != iSkip) &&
+            ((ull & EXACT_KEY_MASK) == ullKey) &&
+            _IsLive(ull >> EXACT_TAG_SHIFT, ullBucket, EXACT_TAG_MASK))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Claims the first empty or expired slot in the probe window, unless the key
+// is already there.  After claiming, the window is checked again for a copy
+// another thread claimed at the same time.
+CQRReplayCache::EXACT_RESULT CQRReplayCache::_ExactInsert(__in ULONGLONG ullKey, __in ULONGLONG ullBucket)
+{
+    const ULONGLONG ullEntry = ((ullBucket & EXACT_TAG_MASK) << EXACT_TAG_SHIFT) | ullKey;
+    const DWORD iStart = (DWORD)ullKey & (QR_REPLAY_EXACT_SLOTS - 1);
+
+    for (;;)
+    {
+        DWORD iFree = MAXDWORD;
+        ULONGLONG ullFree = 0;
+        for (DWORD iProbe = 0; iProbe < QR_REPLAY_EXACT_PROBES; iProbe++)
+        {
+            const DWORD i = (iStart + iProbe) & (QR_REPLAY_EXACT_SLOTS - 1);
+            const ULONGLONG ull = ReadSlot(&_rgllExact[i]);
+            if ((0 != ull) && _IsLive(ull >> EXACT_TAG_SHIFT, ullBucket, EXACT_TAG_MASK))
+            {
+                if ((ull & EXACT_KEY_MASK) == ullKey)
+                {
+                    return ER_PRESENT;
+                }
+            }
+            else if (MAXDWORD == iFree)
+            {
+                iFree = i;
+                ullFree = ull;
+            }
+        }
+
+        if (MAXDWORD == iFree)
+        {
+            return ER_FULL;
+        }
+
+        // If the slot changed under us another thread made progress; rescan.
+        if (CompareExchangeSlot(&_rgllExact[iFree], ullEntry, ullFree))
+        {
+            return _ExactContains(ullKey, ullBucket, iFree) ? ER_PRESENT : ER_INSERTED;
+        }
+    }
+}
+
+// Partial-key cuckoo layout: the second candidate word is derived from the
+// first and the fingerprint alone.  The key is 32 bits; the word comes from
+// the low bits and the fingerprint from the high 16, so they are independent.
+static void FilterPosition(__in ULONGLONG ullKey, __out ULONGLONG* pullFingerprint, __out DWORD rgiWord[2])
+{
+    ULONGLONG ullFingerprint = (ullKey >> 16) & FILTER_LANE_MASK;
+    if (0 == ullFingerprint)
+    {
+        ullFingerprint = 1;
+    }
+    *pullFingerprint = ullFingerprint;
+    rgiWord[0] = (DWORD)ullKey & (QR_REPLAY_FILTER_WORDS - 1);
+    rgiWord[1] = (rgiWord[0] ^ (DWORD)(ullFingerprint * 0x5BD1E995)) & (QR_REPLAY_FILTER_WORDS - 1);
+}
+
+// Counts the fingerprint's occurrences in both candidate words of every live
+// bucket.  A word whose tag is not its bucket's current one is stale.
+DWORD CQRReplayCache::_FilterCount(__in ULONGLONG ullKey, __in ULONGLONG ullBucket)
+{
+    ULONGLONG ullFingerprint;
+    DWORD rgiWord[2];
+    FilterPosition(ullKey, &ullFingerprint, rgiWord);
+
+    DWORD cFound = 0;
+    for (ULONGLONG ullAge = 0; (ullAge < QR_REPLAY_BUCKETS) && (ullAge <= ullBucket); ullAge++)
+    {
+        const ULONGLONG ullLiveBucket = ullBucket - ullAge;
+        volatile LONGLONG* rgllWords = _rgrgllFilter[ullLiveBucket % QR_REPLAY_BUCKETS];
+        for (DWORD iCandidate = 0; iCandidate < ARRAYSIZE(rgiWord); iCandidate++)
+        {
+            if ((1 == iCandidate) && (rgiWord[1] == rgiWord[0]))
+            {
+                break;
+            }
+
+            const ULONGLONG ull = ReadSlot(&rgllWords[rgiWord[iCandidate]]);
+            if ((ull >> FILTER_TAG_SHIFT) == (ullLiveBucket & FILTER_TAG_MASK))
+            {
+                for (DWORD iLane = 0; iLane < FILTER_LANES; iLane++)
+                {
+                    if (((ull >> (iLane * 16)) & FILTER_LANE_MASK) == ullFingerprint)
+                    {
+                        cFound++;
+                    }
+                }
+            }
+        }
+    }
+    return cFound;
+}
+
+// Adds the fingerprint to an empty lane of either candidate word in the
+// current bucket.  There is no cuckoo eviction: relocating a fingerprint
+// cannot be done with a single compare-exchange, so a full pair of words
+// means the filter is saturated and the caller fails closed.
+bool CQRReplayCache::_FilterInsert(__in ULONGLONG ullKey, __in ULONGLONG ullBucket)
+{
+    ULONGLONG ullFingerprint;
+    DWORD rgiWord[2];
+    FilterPosition(ullKey, &ullFingerprint, rgiWord);
+
+    const ULONGLONG ullTag = ullBucket & FILTER_TAG_MASK;
+    volatile LONGLONG* rgllWords = _rgrgllFilter[ullBucket % QR_REPLAY_BUCKETS];
+
+    for (DWORD iCandidate = 0; iCandidate < ARRAYSIZE(rgiWord); iCandidate++)
+    {
+        volatile LONGLONG* pll = &rgllWords[rgiWord[iCandidate]];
+        for (;;)
+        {
+            const ULONGLONG ull = ReadSlot(pll);
+            ULONGLONG ullNew;
+            if ((ull >> FILTER_TAG_SHIFT) != ullTag)
+            {
+                // Left over from an expired bucket: start the word afresh.
+                ullNew = (ullTag << FILTER_TAG_SHIFT) | ullFingerprint;
+            }
+            else
+            {
+                DWORD iLane = 0;
+                while ((iLane < FILTER_LANES) && (0 != ((ull >> (iLane * 16)) & FILTER_LANE_MASK)))
+                {
+                    iLane++;
+                }
+                if (FILTER_LANES == iLane)
+                {
+                    break;
+                }
+                ullNew = ull | (ullFingerprint << (iLane * 16));
+            }
+
+            if (CompareExchangeSlot(pll, ullNew, ull))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,94 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRReplayCache remembers the session nonces of approvals that have already
+// been used, so a replayed approval is rejected even though its signature is
+// valid.  It is fixed size and lock free: every operation is a handful of
+// interlocked compare-exchanges, so a flood of submissions from many threads
+// never blocks on a lock.
+//
+// Entries live in an exact set of 64 bit keys.  If the exact set cannot take
+// an entry (its probe window is full of live keys), the key goes into a
+// time-bucketed cuckoo-layout fingerprint filter instead.  The filter can
+// report false positives, which reject a legitimate approval, so it is only
+// consulted while it holds entries that have not yet expired.  Both
+// structures tag entries with the time bucket they were written in, so expiry
+// needs no sweeping: a slot from an expired bucket simply counts as empty.
+
+#pragma once
+
+#include <windows.h>
+
+// Slots in the exact set, and how many are probed per key.
+#define QR_REPLAY_EXACT_SLOTS       8192
+#define QR_REPLAY_EXACT_PROBES      16
+
+// Time buckets kept alive at once.  An entry survives at least
+// (QR_REPLAY_BUCKETS - 1) bucket lengths, which is set to cover the TTL.
+#define QR_REPLAY_BUCKETS           8
+
+// Filter words per time bucket.  Each word holds a 16 bit bucket tag and three
+// 16 bit fingerprints.
+#define QR_REPLAY_FILTER_WORDS      1024
+
+// Counters, for measuring how the cache behaves under load.
+struct QR_REPLAY_CACHE_STATS
+{
+    LONGLONG    cConsumed;          // Nonces accepted for the first time.
+    LONGLONG    cReplays;           // Nonces rejected as already used.
+    LONGLONG    cExpired;           // Rejected because the approval had expired or outlives the TTL.
+    LONGLONG    cFilterInserts;     // Entries that went to the filter because the exact set was full.
+    LONGLONG    cFilterRejects;     // Rejections that came from the filter (includes false positives).
+    LONGLONG    cSaturated;         // Rejected because neither structure had room.
+};
+
+class CQRReplayCache
+{
+  public:
+    // dwTtlSeconds is the longest an approval may stay valid.
+    CQRReplayCache(__in DWORD dwTtlSeconds);
+
+    // Marks the nonce as used.  Returns S_OK the first time a nonce is seen
+    // and S_FALSE if it was seen before, if ullExpiry has passed or is further
+    // out than the TTL, or if the cache has no room left (failing closed).
+    // Times are Unix seconds; ullNow is passed in so callers and tests
+    // control the clock.
+    HRESULT Consume(__in_bcount(cbNonce) const BYTE* pbNonce,
+                    __in DWORD cbNonce,
+                    __in ULONGLONG ullExpiry,
+                    __in ULONGLONG ullNow);
+
+    void GetStats(__out QR_REPLAY_CACHE_STATS* pStats);
+
+  private:
+    enum EXACT_RESULT
+    {
+        ER_INSERTED,
+        ER_PRESENT,
+        ER_FULL,
+    };
+
+    EXACT_RESULT _ExactInsert(__in ULONGLONG ullKey, __in ULONGLONG ullBucket);
+    bool _ExactContains(__in ULONGLONG ullKey, __in ULONGLONG ullBucket, __in DWORD iSkip);
+    DWORD _FilterCount(__in ULONGLONG ullKey, __in ULONGLONG ullBucket);
+    bool _FilterInsert(__in ULONGLONG ullKey, __in ULONGLONG ullBucket);
+    bool _IsLive(__in ULONGLONG ullTag, __in ULONGLONG ullBucket, __in ULONGLONG ullTagMask);
+    ULONGLONG _CurrentBucket(__in ULONGLONG ullNow);
+
+  private:
+    DWORD                       _dwTtlSeconds;
+    DWORD                       _dwBucketSeconds;
+    volatile LONGLONG           _llNewestBucket;        // Latest bucket any caller's clock has reached.
+    volatile LONGLONG           _llLastFilterBucket;    // Bucket of the newest filter entry, -1 if none.
+    QR_REPLAY_CACHE_STATS       _stats;
+    volatile LONGLONG           _rgllExact[QR_REPLAY_EXACT_SLOTS];                      // tag:32 | key:32, 0 = empty
+    volatile LONGLONG           _rgrgllFilter[QR_REPLAY_BUCKETS][QR_REPLAY_FILTER_WORDS];  // tag:16 | fp:16 x 3
+};
+
+// The cache shared by every credential in the process.
+CQRReplayCache* GetQRReplayCache();
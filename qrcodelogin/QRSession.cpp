@@ -0,0 +1,636 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Timers carry a plain pointer to the session rather than a reference:
+// Shutdown cancels them before the tile lets go, and a cancelled timer's
+// callback is guaranteed not to be running.  Work queued from a timer does
+// hold a reference, since it can run after Shutdown.
+
+#ifndef WIN32_NO_STATUS
+#include <ntstatus.h>
+#define WIN32_NO_STATUS
+#endif
+#include <windows.h>
+#include <wininet.h>
+#include <bcrypt.h>
+#include <strsafe.h>
+#include <helpers.h>
+#include "dll.h"
+#include "QRSession.h"
+#include "QRTranscode.h"
+
+#pragma comment(lib, "wininet.lib")
+
+// Largest payload a QR code can carry in byte mode (version 40, error correction level L).
+#define QR_BYTE_MODE_CB_MAX 2953
+
+// Online mode: the QR code carries the session nonce, and the desktop polls the
+// status of the same session.
+#define QR_BACKEND_SESSION_URL  L"https://example.com/qrcode/?n="
+#define QR_BACKEND_STATUS_URL   L"https://example.com/qrcode/status?n="
+
+// Writes cb bytes as lowercase hex followed by a terminator.  pwsz must hold 2 * cb + 1 characters.
+static void HexEncode(__in_bcount(cb) const BYTE* pb, __in DWORD cb, __out_ecount(2 * cb + 1) PWSTR pwsz)
+{
+    static const WCHAR c_rgwchHex[] = L"0123456789abcdef";
+    for (DWORD i = 0; i < cb; i++)
+    {
+        pwsz[2 * i] = c_rgwchHex[pb[i] >> 4];
+        pwsz[2 * i + 1] = c_rgwchHex[pb[i] & 0xf];
+    }
+    pwsz[2 * cb] = L'\0';
+}
+
+CQRSession::CQRSession():
+    _cRef(1),
+    _fShutdown(false),
+    _hbmp(NULL),
+    _ullTimeStep(0),
+    _fNonce(false),
+    _fResponse(false),
+    _fPolling(false),
+    _dwBackoffMs(0),
+    _pcpce(NULL),
+    _pcpc(NULL),
+    _dwFieldID(0)
+{
+    DllAddRef();
+
+    InitializeCriticalSection(&_cs);
+    ZeroMemory(&_response, sizeof(_response));
+    ZeroMemory(&_timerRefresh, sizeof(_timerRefresh));
+    ZeroMemory(&_timerPoll, sizeof(_timerPoll));
+}
+
+CQRSession::~CQRSession()
+{
+    GetQRTimerService()->Cancel(&_timerRefresh);
+    GetQRTimerService()->Cancel(&_timerPoll);
+
+    if (_hbmp)
+    {
+        DeleteObject(_hbmp);
+    }
+    DestroyThreadpoolEnvironment(&_tpEnv);
+    DeleteCriticalSection(&_cs);
+
+    DllRelease();
+}
+
+HRESULT CQRSession::CreateInstance(__deref_out CQRSession** ppSession)
+{
+    HRESULT hr;
+    CQRSession* pSession = new CQRSession();
+    if (pSession)
+    {
+        hr = pSession->_Initialize();
+        if (SUCCEEDED(hr))
+        {
+            *ppSession = pSession;
+        }
+        else
+        {
+            pSession->Release();
+        }
+    }
+    else
+    {
+        hr = E_OUTOFMEMORY;
+    }
+    return hr;
+}
+
+HRESULT CQRSession::_Initialize()
+{
+    InitializeThreadpoolEnvironment(&_tpEnv);
+    SetThreadpoolCallbackLibrary(&_tpEnv, HINST_THISDLL);
+
+    // Without a provisioned device secret the QR code comes from the server.
+    _challenge.Initialize();
+    return S_OK;
+}
+
+ULONG CQRSession::AddRef()
+{
+    return InterlockedIncrement(&_cRef);
+}
+
+ULONG CQRSession::Release()
+{
+    LONG cRef = InterlockedDecrement(&_cRef);
+    if (!cRef)
+    {
+        delete this;
+    }
+    return cRef;
+}
+
+// The challenge's HMAC object is shared with rendering, which can be running
+// on the thread pool.
+HRESULT CQRSession::VerifyApprovalCode(__in PCWSTR pwzCode)
+{
+    EnterCriticalSection(&_cs);
+    HRESULT hr = _challenge.VerifyApprovalCode(pwzCode);
+    LeaveCriticalSection(&_cs);
+    return hr;
+}
+
+void CQRSession::Advise(
+    __in ICredentialProviderCredentialEvents* pcpce,
+    __in ICredentialProviderCredential* pcpc,
+    __in DWORD dwFieldID
+    )
+{
+    pcpce->AddRef();
+
+    EnterCriticalSection(&_cs);
+    ICredentialProviderCredentialEvents* pcpceOld = _pcpce;
+    _pcpce = pcpce;
+    _pcpc = pcpc;
+    _dwFieldID = dwFieldID;
+    if (IsOffline() && !_fShutdown)
+    {
+        _ScheduleLocked(&_timerRefresh, CQRChallenge::GetTimeStepRemainingMs(), _OnRefreshTimer);
+    }
+    LeaveCriticalSection(&_cs);
+
+    if (pcpceOld)
+    {
+        pcpceOld->Release();
+    }
+}
+
+void CQRSession::UnAdvise()
+{
+    EnterCriticalSection(&_cs);
+    ICredentialProviderCredentialEvents* pcpce = _pcpce;
+    _pcpce = NULL;
+    _pcpc = NULL;
+    GetQRTimerService()->Cancel(&_timerRefresh);
+    LeaveCriticalSection(&_cs);
+
+    if (pcpce)
+    {
+        pcpce->Release();
+    }
+}
+
+void CQRSession::StartPolling()
+{
+    EnterCriticalSection(&_cs);
+    if (!IsOffline() && !_fShutdown && !_fPolling)
+    {
+        _fPolling = true;
+        _dwBackoffMs = 0;
+        _ScheduleLocked(&_timerPoll, 0, _OnPollTimer);
+    }
+    LeaveCriticalSection(&_cs);
+}
+
+void CQRSession::StopPolling()
+{
+    EnterCriticalSection(&_cs);
+    _fPolling = false;
+    GetQRTimerService()->Cancel(&_timerPoll);
+    LeaveCriticalSection(&_cs);
+}
+
+HRESULT CQRSession::GetBitmap(__out HBITMAP* phbmp)
+{
+    EnterCriticalSection(&_cs);
+
+    // The refresh timer normally has the code current already; this covers a
+    // tile that is not advised, or a timer that has yet to run.
+    if (IsOffline() && (_ullTimeStep != CQRChallenge::GetCurrentTimeStep()))
+    {
+        _Render();
+    }
+    if (!_hbmp)
+    {
+        _Render();
+    }
+
+    HRESULT hr = E_FAIL;
+    if (_hbmp)
+    {
+        *phbmp = (HBITMAP)CopyImage(_hbmp, IMAGE_BITMAP, 0, 0, LR_COPYRETURNORG);
+        hr = *phbmp ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    LeaveCriticalSection(&_cs);
+    return hr;
+}
+
+HRESULT CQRSession::GetStatus(__out QR_BACKEND_RESPONSE* pResponse, __out_bcount(QR_APPROVAL_NONCE_CB) BYTE* pbNonce)
+{
+    EnterCriticalSection(&_cs);
+    const bool fResponse = _fNonce && _fResponse;
+    if (fResponse)
+    {
+        CopyMemory(pbNonce, _rgbNonce, sizeof(_rgbNonce));
+        *pResponse = _response;
+    }
+    LeaveCriticalSection(&_cs);
+
+    return fResponse ? S_OK : S_FALSE;
+}
+
+void CQRSession::Renew()
+{
+    EnterCriticalSection(&_cs);
+    _RenewLocked();
+    LeaveCriticalSection(&_cs);
+
+    _NotifyBitmapChanged();
+}
+
+void CQRSession::Shutdown()
+{
+    EnterCriticalSection(&_cs);
+    _fShutdown = true;
+    _fPolling = false;
+    GetQRTimerService()->Cancel(&_timerRefresh);
+    GetQRTimerService()->Cancel(&_timerPoll);
+    ICredentialProviderCredentialEvents* pcpce = _pcpce;
+    _pcpce = NULL;
+    _pcpc = NULL;
+    LeaveCriticalSection(&_cs);
+
+    if (pcpce)
+    {
+        pcpce->Release();
+    }
+}
+
+// Call with the lock held.
+HRESULT CQRSession::_GetURL(__deref_out PWSTR* ppwszURL)
+{
+    // Offline mode needs no round trip: the challenge is computed from the device secret.
+    if (IsOffline())
+    {
+        _ullTimeStep = CQRChallenge::GetCurrentTimeStep();
+        return _challenge.GetChallengeURL(_ullTimeStep, ppwszURL);
+    }
+
+    // Online mode: the QR code carries a fresh session nonce, which the backend's
+    // approval must be bound to.
+    HRESULT hr = S_OK;
+    if (!_fNonce)
+    {
+        hr = HResultFromNtStatus(BCryptGenRandom(NULL, _rgbNonce, sizeof(_rgbNonce), BCRYPT_USE_SYSTEM_PREFERRED_RNG));
+        _fNonce = SUCCEEDED(hr);
+    }
+    if (SUCCEEDED(hr))
+    {
+        WCHAR wszNonce[QR_APPROVAL_NONCE_CB * 2 + 1];
+        HexEncode(_rgbNonce, sizeof(_rgbNonce), wszNonce);
+
+        const size_t cch = ARRAYSIZE(QR_BACKEND_SESSION_URL) + ARRAYSIZE(wszNonce);
+        *ppwszURL = (PWSTR)CoTaskMemAlloc(cch * sizeof(WCHAR));
+        if (*ppwszURL)
+        {
+            hr = StringCchPrintfW(*ppwszURL, cch, QR_BACKEND_SESSION_URL L"%s", wszNonce);
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+    return hr;
+}
+
+// Replaces _hbmp with a rendering of the current URL.  Call with the lock held.
+void CQRSession::_Render()
+{
+    if (_hbmp)
+    {
+        DeleteObject(_hbmp);
+        _hbmp = NULL;
+    }
+
+    PWSTR pszURL = NULL;
+    if (FAILED(_GetURL(&pszURL)) || !pszURL)
+    {
+        return;
+    }
+
+    // QR byte mode carries UTF-8.  Transcode straight into a fixed buffer sized for
+    // the largest byte mode payload (version 40, level L) instead of allocating.
+    BYTE rgbPayload[QR_BYTE_MODE_CB_MAX];
+    DWORD cbPayload = 0;
+    HRESULT hr = Utf16ToUtf8(pszURL, lstrlen(pszURL), 0, rgbPayload, sizeof(rgbPayload), &cbPayload);
+    CoTaskMemFree(pszURL);
+    if (FAILED(hr) || (0 == cbPayload))
+    {
+        return;
+    }
+
+    // Create a simple QR code-like pattern for demonstration
+    // In a real implementation, you would integrate with a QR code library
+    HDC hdcScreen = GetDC(NULL);
+    if (hdcScreen)
+    {
+        // Create a compatible DC and bitmap
+        HDC hdcMem = CreateCompatibleDC(hdcScreen);
+        if (hdcMem)
+        {
+            // Create a 200x200 pixel bitmap for the QR code
+            BITMAPINFO bmi = {0};
+            bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+            bmi.bmiHeader.biWidth = 200;
+            bmi.bmiHeader.biHeight = -200; // Top-down DIB
+            bmi.bmiHeader.biPlanes = 1;
+            bmi.bmiHeader.biBitCount = 24;
+            bmi.bmiHeader.biCompression = BI_RGB;
+
+            void* pBits = NULL;
+            HBITMAP hbm = CreateDIBSection(hdcMem, &bmi, DIB_RGB_COLORS, &pBits, NULL, 0);
+            if (hbm)
+            {
+                HGDIOBJ hbmOld = SelectObject(hdcMem, hbm);
+
+                // Fill with white background
+                RECT rc = {0, 0, 200, 200};
+                HBRUSH hbrWhite = CreateSolidBrush(RGB(255, 255, 255));
+                FillRect(hdcMem, &rc, hbrWhite);
+                DeleteObject(hbrWhite);
+
+                // Draw a simple QR code pattern for demonstration
+                // In a real implementation, you would generate an actual QR code from the URL
+                HPEN hpenBlack = CreatePen(PS_SOLID, 1, RGB(0, 0, 0));
+                HPEN hpenOld = (HPEN)SelectObject(hdcMem, hpenBlack);
+
+                // Draw a simple pattern to represent a QR code
+                // Draw border squares
+                Rectangle(hdcMem, 10, 10, 50, 50);  // Top-left
+                Rectangle(hdcMem, 150, 10, 190, 50); // Top-right
+                Rectangle(hdcMem, 10, 150, 50, 190); // Bottom-left
+
+                // Draw some pattern inside to make it look like a QR code
+                for (int i = 0; i < 10; i++) {
+                    for (int j = 0; j < 10; j++) {
+                        DWORD iBit = (i * 10 + j) % (cbPayload * 8);
+                        if ((rgbPayload[iBit / 8] >> (iBit % 8)) & 1) { // One module per payload bit
+                            RECT rect = {60 + i * 12, 60 + j * 12, 70 + i * 12, 70 + j * 12};
+                            HBRUSH hbrBlack = CreateSolidBrush(RGB(0, 0, 0));
+                            FillRect(hdcMem, &rect, hbrBlack);
+                            DeleteObject(hbrBlack);
+                        }
+                    }
+                }
+
+                SelectObject(hdcMem, hpenOld);
+                DeleteObject(hpenBlack);
+
+                // Store the bitmap once it is no longer selected into the DC
+                SelectObject(hdcMem, hbmOld);
+                _hbmp = hbm;
+            }
+            DeleteDC(hdcMem);
+        }
+        ReleaseDC(NULL, hdcScreen);
+    }
+}
+
+// Switches to a new nonce and renders it.  Call with the lock held.
+void CQRSession::_RenewLocked()
+{
+    _fNonce = false;
+    _fResponse = false;
+    _Render();
+    if (_fPolling)
+    {
+        _dwBackoffMs = 0;
+        _ScheduleLocked(&_timerPoll, QR_SESSION_POLL_MS_DEFAULT, _OnPollTimer);
+    }
+}
+
+// Call with the lock held.  A deadline that cannot be set is dropped; the code
+// is still brought up to date by GetBitmap, and polling starts again the next
+// time the tile is selected.
+void CQRSession::_ScheduleLocked(__inout QR_TIMER* pTimer, __in DWORD dwDelayMs, __in PFN_QR_TIMER pfn)
+{
+    GetQRTimerService()->Schedule(pTimer, dwDelayMs, pfn, this);
+}
+
+// Runs on the timer thread.  Queues the work and, if the pool will not take
+// it, tries again a little later.
+void CQRSession::_Submit(__in PTP_SIMPLE_CALLBACK pfnWork, __inout QR_TIMER* pTimer, __in PFN_QR_TIMER pfnRetry)
+{
+    AddRef();
+    if (!TrySubmitThreadpoolCallback(pfnWork, this, &_tpEnv))
+    {
+        Release();
+        GetQRTimerService()->Schedule(pTimer, QR_SESSION_RETRY_MS, pfnRetry, this);
+    }
+}
+
+// Pushes the current code to LogonUI.  Called without the lock, since LogonUI
+// may call back into the tile.
+void CQRSession::_NotifyBitmapChanged()
+{
+    HBITMAP hbmp = NULL;
+
+    EnterCriticalSection(&_cs);
+    ICredentialProviderCredentialEvents* pcpce = _pcpce;
+    ICredentialProviderCredential* pcpc = _pcpc;
+    const DWORD dwFieldID = _dwFieldID;
+    if (pcpce && _hbmp)
+    {
+        hbmp = (HBITMAP)CopyImage(_hbmp, IMAGE_BITMAP, 0, 0, LR_COPYRETURNORG);
+    }
+    if (hbmp)
+    {
+        pcpce->AddRef();
+        pcpc->AddRef();
+    }
+    LeaveCriticalSection(&_cs);
+
+    if (hbmp)
+    {
+        pcpce->SetFieldBitmap(pcpc, dwFieldID, hbmp);
+        DeleteObject(hbmp);
+        pcpc->Release();
+        pcpce->Release();
+    }
+}
+
+void CQRSession::_OnRefreshTimer(__in QR_TIMER* pTimer, __in void* pv)
+{
+    static_cast<CQRSession*>(pv)->_Submit(_RefreshWork, pTimer, _OnRefreshTimer);
+}
+
+void CQRSession::_OnPollTimer(__in QR_TIMER* pTimer, __in void* pv)
+{
+    static_cast<CQRSession*>(pv)->_Submit(_PollWork, pTimer, _OnPollTimer);
+}
+
+// Offline mode: a new time step has begun.
+void CALLBACK CQRSession::_RefreshWork(__inout PTP_CALLBACK_INSTANCE pInstance, __in void* pv)
+{
+    UNREFERENCED_PARAMETER(pInstance);
+    CQRSession* pThis = static_cast<CQRSession*>(pv);
+
+    EnterCriticalSection(&pThis->_cs);
+    const bool fAdvised = !pThis->_fShutdown && (NULL != pThis->_pcpce);
+    if (fAdvised)
+    {
+        pThis->_Render();
+        pThis->_ScheduleLocked(&pThis->_timerRefresh, CQRChallenge::GetTimeStepRemainingMs(), _OnRefreshTimer);
+    }
+    LeaveCriticalSection(&pThis->_cs);
+
+    if (fAdvised)
+    {
+        pThis->_NotifyBitmapChanged();
+    }
+    pThis->Release();
+}
+
+// Online mode: polls the session once and sets the next deadline.
+void CALLBACK CQRSession::_PollWork(__inout PTP_CALLBACK_INSTANCE pInstance, __in void* pv)
+{
+    UNREFERENCED_PARAMETER(pInstance);
+    CQRSession* pThis = static_cast<CQRSession*>(pv);
+
+    BYTE rgbNonce[QR_APPROVAL_NONCE_CB];
+    EnterCriticalSection(&pThis->_cs);
+    bool fPoll = !pThis->_fShutdown && pThis->_fPolling;
+    if (fPoll && !pThis->_fNonce)
+    {
+        // No code has been shown yet; check back later.
+        pThis->_ScheduleLocked(&pThis->_timerPoll, QR_SESSION_POLL_MS_DEFAULT, _OnPollTimer);
+        fPoll = false;
+    }
+    if (fPoll)
+    {
+        CopyMemory(rgbNonce, pThis->_rgbNonce, sizeof(rgbNonce));
+    }
+    LeaveCriticalSection(&pThis->_cs);
+
+    bool fRenewed = false;
+    if (fPoll)
+    {
+        QR_BACKEND_RESPONSE response;
+        HRESULT hr = _Poll(rgbNonce, &response);
+
+        EnterCriticalSection(&pThis->_cs);
+
+        // If the nonce was renewed meanwhile, the renewal has already set the
+        // next poll.
+        if (!pThis->_fShutdown && pThis->_fPolling && pThis->_fNonce &&
+            (0 == memcmp(rgbNonce, pThis->_rgbNonce, sizeof(rgbNonce))))
+        {
+            if (S_OK == hr)
+            {
+                pThis->_response = response;
+                pThis->_fResponse = true;
+                pThis->_dwBackoffMs = 0;
+
+                DWORD dwDelayMs = QR_SESSION_POLL_MS_DEFAULT;
+                if (response.dwFieldsPresent & QRJF_INTERVAL)
+                {
+                    dwDelayMs = (response.dwInterval < QR_SESSION_POLL_MS_MAX / 1000) ? max(response.dwInterval * 1000, QR_SESSION_POLL_MS_MIN)
+                                                                                     : QR_SESSION_POLL_MS_MAX;
+                }
+
+                if ((QRLS_DENIED == response.qrls) || (QRLS_EXPIRED == response.qrls))
+                {
+                    pThis->_RenewLocked();
+                    fRenewed = true;
+                }
+                else if (QRLS_APPROVED != response.qrls)
+                {
+                    pThis->_ScheduleLocked(&pThis->_timerPoll, dwDelayMs, _OnPollTimer);
+                }
+                // An approval ends the session; GetSerialization collects it.
+            }
+            else
+            {
+                pThis->_dwBackoffMs = pThis->_dwBackoffMs ? min(pThis->_dwBackoffMs * 2, QR_SESSION_BACKOFF_MS_MAX)
+                                                          : QR_SESSION_POLL_MS_DEFAULT;
+                pThis->_ScheduleLocked(&pThis->_timerPoll, pThis->_dwBackoffMs, _OnPollTimer);
+            }
+        }
+        LeaveCriticalSection(&pThis->_cs);
+    }
+
+    if (fRenewed)
+    {
+        pThis->_NotifyBitmapChanged();
+    }
+    pThis->Release();
+}
+
+// Polls the status of the session for pbNonce, on the thread pool.  The JSON
+// response is parsed as it is read, so no buffer holds the whole body and
+// nothing is allocated per poll.  A backend that stops answering costs a poll
+// at most QR_SESSION_TIMEOUT_MS per connect and per read.
+HRESULT CQRSession::_Poll(__in_bcount(QR_APPROVAL_NONCE_CB) const BYTE* pbNonce, __out QR_BACKEND_RESPONSE* pResponse)
+{
+    HRESULT hr;
+    CQRJsonParser parser;
+    parser.Reset(pResponse);
+
+    WCHAR wszNonce[QR_APPROVAL_NONCE_CB * 2 + 1];
+    HexEncode(pbNonce, QR_APPROVAL_NONCE_CB, wszNonce);
+
+    WCHAR wszStatusURL[ARRAYSIZE(QR_BACKEND_STATUS_URL) + ARRAYSIZE(wszNonce)];
+    hr = StringCchPrintfW(wszStatusURL, ARRAYSIZE(wszStatusURL), QR_BACKEND_STATUS_URL L"%s", wszNonce);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    HINTERNET hInternet = InternetOpenW(L"qrcodelogin", INTERNET_OPEN_TYPE_PRECONFIG, NULL, NULL, 0);
+    if (hInternet)
+    {
+        // Requests inherit these from the session handle.
+        DWORD dwTimeoutMs = QR_SESSION_TIMEOUT_MS;
+        InternetSetOptionW(hInternet, INTERNET_OPTION_CONNECT_TIMEOUT, &dwTimeoutMs, sizeof(dwTimeoutMs));
+        InternetSetOptionW(hInternet, INTERNET_OPTION_SEND_TIMEOUT, &dwTimeoutMs, sizeof(dwTimeoutMs));
+        InternetSetOptionW(hInternet, INTERNET_OPTION_RECEIVE_TIMEOUT, &dwTimeoutMs, sizeof(dwTimeoutMs));
+
+        HINTERNET hRequest = InternetOpenUrlW(hInternet, wszStatusURL, NULL, 0,
+                                              INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_CACHE_WRITE | INTERNET_FLAG_NO_COOKIES | INTERNET_FLAG_NO_UI, 0);
+        if (hRequest)
+        {
+            BYTE rgbBuffer[512];
+            hr = S_FALSE;
+            while (S_FALSE == hr)
+            {
+                DWORD cbRead = 0;
+                if (!InternetReadFile(hRequest, rgbBuffer, sizeof(rgbBuffer), &cbRead))
+                {
+                    hr = HRESULT_FROM_WIN32(GetLastError());
+                }
+                else if (0 == cbRead)
+                {
+                    // End of the body; the object must be complete by now.
+                    hr = parser.Finish();
+                }
+                else
+                {
+                    hr = parser.Feed(rgbBuffer, cbRead);
+                }
+            }
+            InternetCloseHandle(hRequest);
+        }
+        else
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        InternetCloseHandle(hInternet);
+    }
+    else
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    return hr;
+}
@@ -0,0 +1,139 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRSession is the QR code half of a tile: it decides what the QR code
+// shows, renders it, and keeps it current.  Every deadline it has is a timer
+// on the process-wide CQRTimerService:
+//
+//   - offline mode: the code is rendered again as each time step begins
+//   - online mode, while the tile is selected: the backend is polled at the
+//     interval it asks for, backing off exponentially while it cannot be
+//     reached; a denied or expired session gets a new nonce and a new code
+//
+// Timer callbacks only queue work to the thread pool, where polls and
+// rendering run.  A changed code is pushed to LogonUI with SetFieldBitmap,
+// and the last response is kept so GetSerialization can act on an approval
+// without another round trip.
+//
+// Queued work holds a reference on the session, so it is reference counted
+// and outlives its tile if it has to.  The tile calls Shutdown before it
+// releases its reference.
+
+#pragma once
+
+#include <windows.h>
+#include <credentialprovider.h>
+#include "QRApproval.h"
+#include "QRChallenge.h"
+#include "QRJson.h"
+#include "QRTimerService.h"
+
+// Poll interval when the backend does not suggest one, and the range a
+// suggested interval is held to.
+#define QR_SESSION_POLL_MS_DEFAULT      2000
+#define QR_SESSION_POLL_MS_MIN          1000
+#define QR_SESSION_POLL_MS_MAX          60000
+
+// Longest wait between polls while the backend cannot be reached.
+#define QR_SESSION_BACKOFF_MS_MAX       30000
+
+// Delay before trying again when work cannot be queued.
+#define QR_SESSION_RETRY_MS             1000
+
+// Longest a poll waits to connect to the backend, or for any one send or read.
+#define QR_SESSION_TIMEOUT_MS           10000
+
+class CQRSession
+{
+  public:
+    static HRESULT CreateInstance(__deref_out CQRSession** ppSession);
+
+    ULONG AddRef();
+    ULONG Release();
+
+    // Offline mode is used when a device secret is provisioned.
+    bool IsOffline() const
+    {
+        return _challenge.IsProvisioned();
+    }
+
+    // Offline mode: see CQRChallenge::VerifyApprovalCode.
+    HRESULT VerifyApprovalCode(__in PCWSTR pwzCode);
+
+    // Where to push a changed code: field dwFieldID of pcpc, through pcpce.
+    // In offline mode this also starts rotating the code at each time step.
+    void Advise(__in ICredentialProviderCredentialEvents* pcpce,
+                __in ICredentialProviderCredential* pcpc,
+                __in DWORD dwFieldID);
+    void UnAdvise();
+
+    // Online mode: polls the backend while the tile is selected.
+    void StartPolling();
+    void StopPolling();
+
+    // Returns a copy of the current code, rendering it if needed.  The caller
+    // deletes it.
+    HRESULT GetBitmap(__out HBITMAP* phbmp);
+
+    // Online mode: returns the last response polling collected for the code
+    // on show, and the nonce it belongs to, or S_FALSE if there is none yet.
+    // It never polls itself: it's called from GetSerialization, on LogonUI's
+    // thread, which a slow backend must not hold up.
+    HRESULT GetStatus(__out QR_BACKEND_RESPONSE* pResponse, __out_bcount(QR_APPROVAL_NONCE_CB) BYTE* pbNonce);
+
+    // Online mode: retires the nonce once its session is decided, and shows
+    // a new code.
+    void Renew();
+
+    // Stops all timers and notifications.  Work already queued finds the
+    // session shut down and does nothing.
+    void Shutdown();
+
+  private:
+    CQRSession();
+    ~CQRSession();
+
+    HRESULT _Initialize();
+    HRESULT _GetURL(__deref_out PWSTR* ppwszURL);
+    void _Render();
+    void _RenewLocked();
+    void _ScheduleLocked(__inout QR_TIMER* pTimer, __in DWORD dwDelayMs, __in PFN_QR_TIMER pfn);
+    void _Submit(__in PTP_SIMPLE_CALLBACK pfnWork, __inout QR_TIMER* pTimer, __in PFN_QR_TIMER pfnRetry);
+    void _NotifyBitmapChanged();
+
+    static void _OnRefreshTimer(__in QR_TIMER* pTimer, __in void* pv);
+    static void _OnPollTimer(__in QR_TIMER* pTimer, __in void* pv);
+    static void CALLBACK _RefreshWork(__inout PTP_CALLBACK_INSTANCE pInstance, __in void* pv);
+    static void CALLBACK _PollWork(__inout PTP_CALLBACK_INSTANCE pInstance, __in void* pv);
+    static HRESULT _Poll(__in_bcount(QR_APPROVAL_NONCE_CB) const BYTE* pbNonce, __out QR_BACKEND_RESPONSE* pResponse);
+
+  private:
+    LONG                                    _cRef;
+    CRITICAL_SECTION                        _cs;                // Guards everything below.  Taken before the
+                                                                // timer service lock, never the other way round.
+    TP_CALLBACK_ENVIRON                     _tpEnv;             // Keeps the DLL loaded while work is queued.
+    CQRChallenge                            _challenge;
+    bool                                    _fShutdown;
+
+    HBITMAP                                 _hbmp;              // The current code, or NULL until rendered.
+    ULONGLONG                               _ullTimeStep;       // Offline: the step _hbmp was rendered for.
+    BYTE                                    _rgbNonce[QR_APPROVAL_NONCE_CB];    // Online: the nonce in the code.
+    bool                                    _fNonce;
+
+    QR_BACKEND_RESPONSE                     _response;          // Online: the last response for _rgbNonce.
+    bool                                    _fResponse;
+    bool                                    _fPolling;
+    DWORD                                   _dwBackoffMs;       // 0 while polls succeed.
+
+    ICredentialProviderCredentialEvents*    _pcpce;
+    ICredentialProviderCredential*          _pcpc;              // Not held; valid while advised.
+    DWORD                                   _dwFieldID;
+
+    QR_TIMER                                _timerRefresh;
+    QR_TIMER                                _timerPoll;
+};
@@ -0,0 +1,141 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The timer thread pins the DLL while it runs and leaves through
+// FreeLibraryAndExitThread, so LogonUI can unload the provider as soon as the
+// last timer is gone without pulling code out from under the thread.
+
+#include "QRTimerService.h"
+
+static CQRTimerService s_qrTimerService;
+
+CQRTimerService* GetQRTimerService()
+{
+    return &s_qrTimerService;
+}
+
+CQRTimerService::CQRTimerService():
+    _wheel(GetTickCount64()),
+    _hThread(NULL)
+{
+    InitializeCriticalSection(&_cs);
+    _hWake = CreateEventW(NULL, FALSE, FALSE, NULL);
+}
+
+// By the time the DLL unloads every timer has fired or been cancelled, so the
+// thread has exited.
+CQRTimerService::~CQRTimerService()
+{
+    if (_hWake)
+    {
+        CloseHandle(_hWake);
+    }
+    DeleteCriticalSection(&_cs);
+}
+
+HRESULT CQRTimerService::Schedule(
+    __inout QR_TIMER* pTimer,
+    __in DWORD dwDelayMs,
+    __in PFN_QR_TIMER pfn,
+    __in_opt void* pvContext
+    )
+{
+    HRESULT hr = S_OK;
+    EnterCriticalSection(&_cs);
+
+    // With nothing pending there is nothing to fire, so the wheel can safely be
+    // brought up to date here; otherwise the timer thread keeps it current.
+    const ULONGLONG ullNow = GetTickCount64();
+    if (0 == _wheel.Count())
+    {
+        _wheel.Advance(ullNow);
+    }
+
+    const ULONGLONG ullExpiry = ullNow + dwDelayMs;
+    const bool fEarlier = (ullExpiry < _wheel.GetNextExpiry());
+    _wheel.Schedule(pTimer, ullExpiry, pfn, pvContext);
+
+    if (!_hThread)
+    {
+        // The thread holds its own reference on the DLL, which it drops as it exits.
+        HMODULE hModule;
+        if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (PCWSTR)&_ThreadProc, &hModule))
+        {
+            _hThread = CreateThread(NULL, 0, _ThreadProc, hModule, 0, NULL);
+            if (!_hThread)
+            {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+                FreeLibrary(hModule);
+            }
+        }
+        else
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        if (FAILED(hr))
+        {
+            _wheel.Cancel(pTimer);
+        }
+    }
+    else if (fEarlier)
+    {
+        SetEvent(_hWake);
+    }
+
+    LeaveCriticalSection(&_cs);
+    return hr;
+}
+
+void CQRTimerService::Cancel(__inout QR_TIMER* pTimer)
+{
+    // No need to wake the thread; it finds nothing due when it next wakes.
+    EnterCriticalSection(&_cs);
+    _wheel.Cancel(pTimer);
+    LeaveCriticalSection(&_cs);
+}
+
+// Call with the lock held.
+DWORD CQRTimerService::_GetWaitMs()
+{
+    const ULONGLONG ullNext = _wheel.GetNextExpiry();
+    const ULONGLONG ullNow = GetTickCount64();
+    if (ullNext <= ullNow)
+    {
+        return 0;
+    }
+    return (ullNext - ullNow < QR_TIMER_SERVICE_WAIT_MS_MAX) ? (DWORD)(ullNext - ullNow) : QR_TIMER_SERVICE_WAIT_MS_MAX;
+}
+
+DWORD WINAPI CQRTimerService::_ThreadProc(__in void* pv)
+{
+    CQRTimerService* pThis = &s_qrTimerService;
+
+    EnterCriticalSection(&pThis->_cs);
+    for (;;)
+    {
+        pThis->_wheel.Advance(GetTickCount64());
+        if (0 == pThis->_wheel.Count())
+        {
+            // Decided under the lock, so a Schedule that comes after this
+            // starts a new thread.
+            CloseHandle(pThis->_hThread);
+            pThis->_hThread = NULL;
+            break;
+        }
+
+        const DWORD dwWaitMs = pThis->_GetWaitMs();
+        LeaveCriticalSection(&pThis->_cs);
+        WaitForSingleObject(pThis->_hWake, dwWaitMs);
+        EnterCriticalSection(&pThis->_cs);
+    }
+    LeaveCriticalSection(&pThis->_cs);
+
+    FreeLibraryAndExitThread((HMODULE)pv, 0);
+    return 0;
+}
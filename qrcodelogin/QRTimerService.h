@@ -0,0 +1,56 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRTimerService runs every QR code deadline in the process (code rotation,
+// poll intervals, backoff) off a single CQRTimerWheel and a single thread,
+// instead of a thread or a sleep per tile.  The thread starts when the first
+// timer is scheduled and exits once no timers are left.
+//
+// Callbacks run on the timer thread with the service lock held.  That is what
+// lets Cancel promise the callback is not running once it returns, but it
+// also means a callback must not block: anything slow (a poll, rendering)
+// belongs on the thread pool, and a callback must not take a lock that is
+// held around calls to Schedule or Cancel.
+
+#pragma once
+
+#include <windows.h>
+#include "QRTimerWheel.h"
+
+// Longest the timer thread sleeps without looking at the clock.  A wait does
+// not count time the machine spends suspended, but the tick count does.
+#define QR_TIMER_SERVICE_WAIT_MS_MAX    60000
+
+class CQRTimerService
+{
+  public:
+    CQRTimerService();
+    ~CQRTimerService();
+
+    // Arms pTimer to call pfn(pTimer, pvContext) on the timer thread dwDelayMs
+    // from now.  A pending timer is moved to the new deadline.  pTimer must
+    // stay valid until it fires or is cancelled.
+    HRESULT Schedule(__inout QR_TIMER* pTimer, __in DWORD dwDelayMs, __in PFN_QR_TIMER pfn, __in_opt void* pvContext);
+
+    // Disarms pTimer.  Once Cancel returns, the callback is not running and
+    // will not run, unless Cancel was called from the callback itself.
+    void Cancel(__inout QR_TIMER* pTimer);
+
+  private:
+    static DWORD WINAPI _ThreadProc(__in void* pv);
+    DWORD _GetWaitMs();
+
+  private:
+    CRITICAL_SECTION    _cs;            // Guards the wheel and _hThread; held while callbacks run.
+    CQRTimerWheel       _wheel;         // Ticks are GetTickCount64 milliseconds.
+    HANDLE              _hWake;         // Set when a deadline earlier than the thread's wait is added.
+    HANDLE              _hThread;
+};
+
+// The process-wide timer service.
+CQRTimerService* GetQRTimerService();
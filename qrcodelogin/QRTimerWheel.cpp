@@ -0,0 +1,272 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The wheel follows the classic cascading layout.  _ullNext is the next tick
+// to process.  When it reaches a multiple of QR_TIMER_WHEEL_SLOTS, the level 1
+// slot for the new block is emptied into level 0, and likewise up the levels
+// whenever the index of the level above wraps to zero.  Every slot is a
+// circular list with a sentinel head, and a bitmap per level records which
+// slots are occupied so Advance can jump over idle ticks instead of visiting
+// them one by one.
+
+#include "QRTimerWheel.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define QR_TIMER_WHEEL_MASK     (QR_TIMER_WHEEL_SLOTS - 1)
+#define QR_TIMER_WHEEL_WORDS    (QR_TIMER_WHEEL_SLOTS / 64)
+
+// Index of the lowest set bit; ull must not be zero.
+static uint32_t LowestBit(uint64_t ull)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    if (_BitScanForward(&i, (unsigned long)ull))
+    {
+        return i;
+    }
+    _BitScanForward(&i, (unsigned long)(ull >> 32));
+    return i + 32;
+#else
+    return (uint32_t)__builtin_ctzll(ull);
+#endif
+}
+
+// The first tick at or after ullTick that is a multiple of 2^cBits.
+static uint64_t AlignUp(uint64_t ullTick, uint32_t cBits)
+{
+    const uint64_t ullMask = (1ULL << cBits) - 1;
+    return (ullTick + ullMask) & ~ullMask;
+}
+
+CQRTimerWheel::CQRTimerWheel(uint64_t ullNow):
+    _ullNext(ullNow + 1),
+    _cTimers(0)
+{
+    for (uint32_t i = 0; i < QR_TIMER_WHEEL_LEVELS * QR_TIMER_WHEEL_SLOTS; i++)
+    {
+        _rgSlot[i].pNext = &_rgSlot[i];
+        _rgSlot[i].pPrev = &_rgSlot[i];
+    }
+    for (uint32_t iLevel = 0; iLevel < QR_TIMER_WHEEL_LEVELS; iLevel++)
+    {
+        for (uint32_t iWord = 0; iWord < QR_TIMER_WHEEL_WORDS; iWord++)
+        {
+            _rgullOccupied[iLevel][iWord] = 0;
+        }
+    }
+}
+
+void CQRTimerWheel::Schedule(QR_TIMER* pTimer, uint64_t ullExpiry, PFN_QR_TIMER pfn, void* pvContext)
+{
+    if (IsPending(pTimer))
+    {
+        _Unlink(pTimer);
+        _cTimers--;
+    }
+    pTimer->ullExpiry = ullExpiry;
+    pTimer->pfn = pfn;
+    pTimer->pvContext = pvContext;
+    _Insert(pTimer);
+    _cTimers++;
+}
+
+void CQRTimerWheel::Cancel(QR_TIMER* pTimer)
+{
+    if (IsPending(pTimer))
+    {
+        _Unlink(pTimer);
+        _cTimers--;
+    }
+}
+
+// Files the timer under the lowest level whose span covers its delay.  A
+// deadline beyond the top level's span is filed at the far end of the top
+// level and placed again when that slot cascades.
+void CQRTimerWheel::_Insert(QR_TIMER* pTimer)
+{
+    uint64_t ullExpiry = (pTimer->ullExpiry < _ullNext) ? _ullNext : pTimer->ullExpiry;
+    uint64_t ullDelta = ullExpiry - _ullNext;
+
+    const uint64_t ullSpan = 1ULL << (QR_TIMER_WHEEL_BITS * QR_TIMER_WHEEL_LEVELS);
+    if (ullDelta >= ullSpan)
+    {
+        ullDelta = ullSpan - 1;
+        ullExpiry = _ullNext + ullDelta;
+    }
+
+    uint32_t iLevel = 0;
+    while ((iLevel + 1 < QR_TIMER_WHEEL_LEVELS) && (ullDelta >= (1ULL << (QR_TIMER_WHEEL_BITS * (iLevel + 1)))))
+    {
+        iLevel++;
+    }
+
+    const uint32_t iSlot = (uint32_t)(ullExpiry >> (QR_TIMER_WHEEL_BITS * iLevel)) & QR_TIMER_WHEEL_MASK;
+    QR_TIMER* pHead = &_rgSlot[iLevel * QR_TIMER_WHEEL_SLOTS + iSlot];
+
+    pTimer->iSlot = iLevel * QR_TIMER_WHEEL_SLOTS + iSlot;
+    pTimer->pNext = pHead;
+    pTimer->pPrev = pHead->pPrev;
+    pHead->pPrev->pNext = pTimer;
+    pHead->pPrev = pTimer;
+    _rgullOccupied[iLevel][iSlot / 64] |= 1ULL << (iSlot % 64);
+}
+
+void CQRTimerWheel::_Unlink(QR_TIMER* pTimer)
+{
+    pTimer->pPrev->pNext = pTimer->pNext;
+    pTimer->pNext->pPrev = pTimer->pPrev;
+    pTimer->pNext = NULL;
+    pTimer->pPrev = NULL;
+
+    QR_TIMER* pHead = &_rgSlot[pTimer->iSlot];
+    if (pHead->pNext == pHead)
+    {
+        const uint32_t iLevel = pTimer->iSlot / QR_TIMER_WHEEL_SLOTS;
+        const uint32_t iSlot = pTimer->iSlot % QR_TIMER_WHEEL_SLOTS;
+        _rgullOccupied[iLevel][iSlot / 64] &= ~(1ULL << (iSlot % 64));
+    }
+}
+
+// Empties the slot of iLevel that _ullNext has just entered into the levels
+// below it.
+void CQRTimerWheel::_Cascade(uint32_t iLevel)
+{
+    const uint32_t iSlot = (uint32_t)(_ullNext >> (QR_TIMER_WHEEL_BITS * iLevel)) & QR_TIMER_WHEEL_MASK;
+    QR_TIMER* pHead = &_rgSlot[iLevel * QR_TIMER_WHEEL_SLOTS + iSlot];
+    if (pHead->pNext == pHead)
+    {
+        return;
+    }
+
+    QR_TIMER* pTimer = pHead->pNext;
+    pHead->pPrev->pNext = NULL;
+    pHead->pNext = pHead;
+    pHead->pPrev = pHead;
+    _rgullOccupied[iLevel][iSlot / 64] &= ~(1ULL << (iSlot % 64));
+
+    while (pTimer)
+    {
+        QR_TIMER* pNext = pTimer->pNext;
+        _Insert(pTimer);
+        pTimer = pNext;
+    }
+}
+
+// Returns the first occupied slot of iLevel at or after iSlotFirst, or -1.
+int CQRTimerWheel::_FindOccupied(uint32_t iLevel, uint32_t iSlotFirst) const
+{
+    for (uint32_t iWord = iSlotFirst / 64; iWord < QR_TIMER_WHEEL_WORDS; iWord++)
+    {
+        uint64_t ull = _rgullOccupied[iLevel][iWord];
+        if (iWord == iSlotFirst / 64)
+        {
+            ull &= ~0ULL << (iSlotFirst % 64);
+        }
+        if (ull)
+        {
+            return (int)(iWord * 64 + LowestBit(ull));
+        }
+    }
+    return -1;
+}
+
+size_t CQRTimerWheel::Advance(uint64_t ullNow)
+{
+    size_t cFired = 0;
+    while (_ullNext <= ullNow)
+    {
+        const uint32_t iSlot = (uint32_t)_ullNext & QR_TIMER_WHEEL_MASK;
+        if (0 == iSlot)
+        {
+            for (uint32_t iLevel = 1; iLevel < QR_TIMER_WHEEL_LEVELS; iLevel++)
+            {
+                _Cascade(iLevel);
+                if (0 != ((_ullNext >> (QR_TIMER_WHEEL_BITS * iLevel)) & QR_TIMER_WHEEL_MASK))
+                {
+                    break;
+                }
+            }
+        }
+
+        // Jump straight to the next tick that has anything to do.  Empty slots
+        // on the way need no processing, and anything scheduled from here on
+        // is filed relative to the new _ullNext.
+        const uint64_t ullTick = GetNextExpiry();
+        if (ullTick != _ullNext)
+        {
+            _ullNext = (ullTick <= ullNow) ? ullTick : ullNow + 1;
+            continue;
+        }
+
+        // Timers the callbacks schedule for this tick or earlier go to the next
+        // slot, and anything else they add to this slot is a full turn out and
+        // sits behind the timers due now.
+        _ullNext++;
+        QR_TIMER* pHead = &_rgSlot[iSlot];
+        while ((pHead->pNext != pHead) && (pHead->pNext->ullExpiry <= ullTick))
+        {
+            QR_TIMER* pTimer = pHead->pNext;
+            _Unlink(pTimer);
+            _cTimers--;
+            cFired++;
+            pTimer->pfn(pTimer, pTimer->pvContext);
+        }
+    }
+    return cFired;
+}
+
+// Walks up the levels.  Level 0 gives an exact tick; a higher level gives the
+// tick its slot cascades at, which is no later than any deadline in it.  Slots
+// behind the current index of a level belong to its next turn, which starts
+// at the next boundary of the level above.  Cascades of empty slots are
+// skipped, which is what lets Advance jump.
+uint64_t CQRTimerWheel::GetNextExpiry() const
+{
+    if (0 == _cTimers)
+    {
+        return UINT64_MAX;
+    }
+
+    uint64_t ullTick = _ullNext;
+    for (uint32_t iLevel = 0; iLevel < QR_TIMER_WHEEL_LEVELS; iLevel++)
+    {
+        // A boundary of the levels above comes before anything further along
+        // in this level.
+        for (uint32_t iUpper = 1; iUpper < QR_TIMER_WHEEL_LEVELS; iUpper++)
+        {
+            const uint32_t cUpperShift = QR_TIMER_WHEEL_BITS * iUpper;
+            if (0 != (ullTick & ((1ULL << cUpperShift) - 1)))
+            {
+                break;
+            }
+            const uint32_t iUpperSlot = (uint32_t)(ullTick >> cUpperShift) & QR_TIMER_WHEEL_MASK;
+            if (_rgullOccupied[iUpper][iUpperSlot / 64] & (1ULL << (iUpperSlot % 64)))
+            {
+                return ullTick;
+            }
+        }
+
+        const uint32_t cShift = QR_TIMER_WHEEL_BITS * iLevel;
+        const uint32_t iSlot = (uint32_t)(ullTick >> cShift) & QR_TIMER_WHEEL_MASK;
+        const int iOccupied = _FindOccupied(iLevel, iSlot);
+        if (iOccupied >= 0)
+        {
+            return ((ullTick >> (cShift + QR_TIMER_WHEEL_BITS)) << (cShift + QR_TIMER_WHEEL_BITS)) | ((uint64_t)iOccupied << cShift);
+        }
+
+        ullTick = AlignUp(ullTick, cShift + QR_TIMER_WHEEL_BITS);
+        if (_FindOccupied(iLevel, 0) >= 0)
+        {
+            return ullTick;
+        }
+    }
+    return ullTick;
+}
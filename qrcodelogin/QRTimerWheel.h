@@ -0,0 +1,109 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRTimerWheel is a hashed hierarchical timing wheel.  Timers are intrusive
+// QR_TIMER records owned by the caller, so scheduling allocates nothing, and
+// both Schedule and Cancel are O(1) however many timers are pending.
+//
+// Time is counted in ticks of whatever unit the caller picks (the QR code
+// uses milliseconds) and only moves when the caller calls Advance, so the
+// same wheel can be driven by a dedicated thread, by an event loop that
+// sleeps until GetNextExpiry, or by a test with a virtual clock.
+//
+// The wheel has QR_TIMER_WHEEL_LEVELS levels of QR_TIMER_WHEEL_SLOTS slots.
+// A timer goes into the lowest level whose span covers its delay and moves
+// down a level each time that level's slot comes round, so a timer is
+// touched at most once per level before it fires.  Deadlines further out
+// than the top level's span are parked in the top level and placed again
+// when they come round.
+//
+// The wheel does no locking; the QR code wraps it in CQRTimerService, and
+// the backend gives every reactor and every session shard its own wheel.
+// The file has no Windows dependencies so the backend can build it as is.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define QR_TIMER_WHEEL_BITS     8
+#define QR_TIMER_WHEEL_SLOTS    (1 << QR_TIMER_WHEEL_BITS)
+#define QR_TIMER_WHEEL_LEVELS   4
+
+struct QR_TIMER;
+
+// Called when a timer fires.  The timer is no longer pending when the
+// callback runs; the callback may schedule it again, schedule or cancel any
+// other timer, or free the memory that holds it.
+typedef void (*PFN_QR_TIMER)(QR_TIMER* pTimer, void* pvContext);
+
+// A zero-filled QR_TIMER is a valid, idle timer.  Do not touch the fields
+// while the timer is pending.
+struct QR_TIMER
+{
+    QR_TIMER*       pNext;          // NULL while the timer is idle.
+    QR_TIMER*       pPrev;
+    uint64_t        ullExpiry;
+    uint32_t        iSlot;          // Level * QR_TIMER_WHEEL_SLOTS + slot.
+    PFN_QR_TIMER    pfn;
+    void*           pvContext;
+};
+
+class CQRTimerWheel
+{
+  public:
+    // ullNow is the tick the wheel starts at.
+    CQRTimerWheel(uint64_t ullNow);
+
+    // Arms pTimer to call pfn(pTimer, pvContext) from the first Advance that
+    // reaches ullExpiry.  A timer that is already pending is moved to the new
+    // deadline.  A deadline at or before the current tick fires on the next
+    // tick.
+    void Schedule(QR_TIMER* pTimer, uint64_t ullExpiry, PFN_QR_TIMER pfn, void* pvContext);
+
+    // Disarms pTimer.  Harmless if the timer is idle.
+    void Cancel(QR_TIMER* pTimer);
+
+    static bool IsPending(const QR_TIMER* pTimer)
+    {
+        return NULL != pTimer->pNext;
+    }
+
+    // Moves the wheel to ullNow, firing every timer due by then in deadline
+    // order.  Returns the number of timers fired.  Time never moves backwards;
+    // an earlier ullNow does nothing.
+    size_t Advance(uint64_t ullNow);
+
+    // Returns a tick at or before the earliest pending deadline, so an event
+    // loop can sleep until then (and advance, and ask again).  UINT64_MAX if
+    // nothing is pending.
+    uint64_t GetNextExpiry() const;
+
+    // The last tick Advance has reached.
+    uint64_t GetNow() const
+    {
+        return _ullNext - 1;
+    }
+
+    size_t Count() const
+    {
+        return _cTimers;
+    }
+
+  private:
+    void _Insert(QR_TIMER* pTimer);
+    void _Unlink(QR_TIMER* pTimer);
+    void _Cascade(uint32_t iLevel);
+    int _FindOccupied(uint32_t iLevel, uint32_t iSlotFirst) const;
+
+  private:
+    uint64_t    _ullNext;           // The next tick Advance will process.
+    size_t      _cTimers;
+    QR_TIMER    _rgSlot[QR_TIMER_WHEEL_LEVELS * QR_TIMER_WHEEL_SLOTS];     // List heads.
+    uint64_t    _rgullOccupied[QR_TIMER_WHEEL_LEVELS][QR_TIMER_WHEEL_SLOTS / 64];
+};
@@ -0,0 +1,401 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Each direction is implemented once, in a worker that counts when it is not
+// given an output buffer and writes when it is, so the length functions and
+// the converters can never disagree about the size of the output.
+
+#include <windows.h>
+#include "QRTranscode.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#define QR_TRANSCODE_SSE2
+#endif
+
+static const char c_rgchHexUpper[] = "0123456789ABCDEF";
+
+static bool IsUnreserved(__in DWORD dwChar)
+{
+    return (dwChar >= 'A' && dwChar <= 'Z') ||
+           (dwChar >= 'a' && dwChar <= 'z') ||
+           (dwChar >= '0' && dwChar <= '9') ||
+           ('-' == dwChar) || ('.' == dwChar) || ('_' == dwChar) || ('~' == dwChar);
+}
+
+#ifdef QR_TRANSCODE_SSE2
+
+// Lanes of v (16 bit, known to be below 0x80) that are within [wLow, wHigh].
+static __m128i InRange16(__in __m128i v, __in short wLow, __in short wHigh)
+{
+    return _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16(wLow - 1)),
+                         _mm_cmplt_epi16(v, _mm_set1_epi16(wHigh + 1)));
+}
+
+// True if all eight code units in v are ASCII and, when percent-encoding,
+// all of them are unreserved, so each becomes exactly one output byte.
+static bool IsPlainAsciiBlock(__in __m128i v, __in bool fPercentEncode)
+{
+    const __m128i vZero = _mm_setzero_si128();
+    __m128i vHigh = _mm_and_si128(v, _mm_set1_epi16((short)0xFF80));
+    if (0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi16(vHigh, vZero)))
+    {
+        return false;
+    }
+    if (!fPercentEncode)
+    {
+        return true;
+    }
+
+    __m128i vUnreserved = _mm_or_si128(InRange16(v, 'A', 'Z'), InRange16(v, 'a', 'z'));
+    vUnreserved = _mm_or_si128(vUnreserved, InRange16(v, '0', '9'));
+    vUnreserved = _mm_or_si128(vUnreserved, _mm_cmpeq_epi16(v, _mm_set1_epi16('-')));
+    vUnreserved = _mm_or_si128(vUnreserved, _mm_cmpeq_epi16(v, _mm_set1_epi16('.')));
+    vUnreserved = _mm_or_si128(vUnreserved, _mm_cmpeq_epi16(v, _mm_set1_epi16('_')));
+    vUnreserved = _mm_or_si128(vUnreserved, _mm_cmpeq_epi16(v, _mm_set1_epi16('~')));
+    return 0xFFFF == _mm_movemask_epi8(vUnreserved);
+}
+
+#endif // QR_TRANSCODE_SSE2
+
+// Counts (pb == NULL) or writes the UTF-8 form of pwz.
+static HRESULT TranscodeUtf16ToUtf8(
+    __in_ecount(cch) PCWSTR pwz,
+    __in DWORD cch,
+    __in DWORD dwFlags,
+    __out_bcount_opt(cb) BYTE* pb,
+    __in DWORD cb,
+    __out DWORD* pcb
+    )
+{
+    const bool fPercentEncode = (0 != (dwFlags & QRTF_PERCENT_ENCODE));
+    DWORD cbOut = 0;
+    DWORD i = 0;
+
+    *pcb = 0;
+
+    while (i < cch)
+    {
+        DWORD iScalarEnd = i + 1;
+
+#ifdef QR_TRANSCODE_SSE2
+        if (i + 8 <= cch)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(pwz + i));
+            if (IsPlainAsciiBlock(v, fPercentEncode))
+            {
+                if (pb)
+                {
+                    if (cb - cbOut < 8)
+                    {
+                        return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+                    }
+                    _mm_storel_epi64((__m128i*)(pb + cbOut), _mm_packus_epi16(v, v));
+                }
+                cbOut += 8;
+                i += 8;
+                continue;
+            }
+
+            // Mixed block: finish it one code point at a time before trying SIMD again,
+            // so non-ASCII text does not pay for a failed block test on every character.
+            iScalarEnd = i + 8;
+        }
+#endif
+
+        while (i < iScalarEnd && i < cch)
+        {
+            DWORD dwChar = pwz[i++];
+            if (dwChar >= 0xD800 && dwChar <= 0xDFFF)
+            {
+                if ((dwChar > 0xDBFF) || (i == cch) || (pwz[i] < 0xDC00) || (pwz[i] > 0xDFFF))
+                {
+                    return HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+                }
+                dwChar = 0x10000 + ((dwChar - 0xD800) << 10) + (pwz[i++] - 0xDC00);
+            }
+
+            BYTE rgbChar[4];
+            DWORD cbChar;
+            if (dwChar < 0x80)
+            {
+                // ASCII needs neither encoding nor a loop over its bytes.
+                const bool fEscape = fPercentEncode && !IsUnreserved(dwChar);
+                const DWORD cbByte = fEscape ? 3 : 1;
+                if (pb)
+                {
+                    if (cb - cbOut < cbByte)
+                    {
+                        return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+                    }
+                    if (cb - cbOut >= 3)
+                    {
+                        // Write all three without branching on the escape; for an
+                        // unescaped byte the other two are scratch the next one overwrites.
+                        pb[cbOut] = fEscape ? '%' : (BYTE)dwChar;
+                        pb[cbOut + 1] = c_rgchHexUpper[dwChar >> 4];
+                        pb[cbOut + 2] = c_rgchHexUpper[dwChar & 0xF];
+                    }
+                    else
+                    {
+                        pb[cbOut] = (BYTE)dwChar;
+                    }
+                }
+                cbOut += cbByte;
+                continue;
+            }
+            else if (dwChar < 0x800)
+            {
+                rgbChar[0] = (BYTE)(0xC0 | (dwChar >> 6));
+                rgbChar[1] = (BYTE)(0x80 | (dwChar & 0x3F));
+                cbChar = 2;
+            }
+            else if (dwChar < 0x10000)
+            {
+                rgbChar[0] = (BYTE)(0xE0 | (dwChar >> 12));
+                rgbChar[1] = (BYTE)(0x80 | ((dwChar >> 6) & 0x3F));
+                rgbChar[2] = (BYTE)(0x80 | (dwChar & 0x3F));
+                cbChar = 3;
+            }
+            else
+            {
+                rgbChar[0] = (BYTE)(0xF0 | (dwChar >> 18));
+                rgbChar[1] = (BYTE)(0x80 | ((dwChar >> 12) & 0x3F));
+                rgbChar[2] = (BYTE)(0x80 | ((dwChar >> 6) & 0x3F));
+                rgbChar[3] = (BYTE)(0x80 | (dwChar & 0x3F));
+                cbChar = 4;
+            }
+
+            for (DWORD j = 0; j < cbChar; j++)
+            {
+                const bool fEscape = fPercentEncode && !IsUnreserved(rgbChar[j]);
+                const DWORD cbByte = fEscape ? 3 : 1;
+                if (pb)
+                {
+                    if (cb - cbOut < cbByte)
+                    {
+                        return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+                    }
+                    if (fEscape)
+                    {
+                        pb[cbOut] = '%';
+                        pb[cbOut + 1] = c_rgchHexUpper[rgbChar[j] >> 4];
+                        pb[cbOut + 2] = c_rgchHexUpper[rgbChar[j] & 0xF];
+                    }
+                    else
+                    {
+                        pb[cbOut] = rgbChar[j];
+                    }
+                }
+                cbOut += cbByte;
+            }
+        }
+    }
+
+    *pcb = cbOut;
+    return S_OK;
+}
+
+// Counts (pwz == NULL) or writes the UTF-16 form of pb.
+static HRESULT TranscodeUtf8ToUtf16(
+    __in_bcount(cb) const BYTE* pb,
+    __in DWORD cb,
+    __out_ecount_opt(cch) PWSTR pwz,
+    __in DWORD cch,
+    __out DWORD* pcch
+    )
+{
+    DWORD cchOut = 0;
+    DWORD i = 0;
+
+    *pcch = 0;
+
+    while (i < cb)
+    {
+#ifdef QR_TRANSCODE_SSE2
+        if (i + 16 <= cb)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(pb + i));
+            if (0 == _mm_movemask_epi8(v))
+            {
+                if (pwz)
+                {
+                    if (cch - cchOut < 16)
+                    {
+                        return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+                    }
+                    const __m128i vZero = _mm_setzero_si128();
+                    _mm_storeu_si128((__m128i*)(pwz + cchOut), _mm_unpacklo_epi8(v, vZero));
+                    _mm_storeu_si128((__m128i*)(pwz + cchOut + 8), _mm_unpackhi_epi8(v, vZero));
+                }
+                cchOut += 16;
+                i += 16;
+                continue;
+            }
+        }
+#endif
+
+        DWORD dwChar = pb[i];
+        DWORD cbChar;
+        DWORD dwMin;
+        if (dwChar < 0x80)
+        {
+            cbChar = 1;
+            dwMin = 0;
+        }
+        else if ((dwChar & 0xE0) == 0xC0)
+        {
+            dwChar &= 0x1F;
+            cbChar = 2;
+            dwMin = 0x80;
+        }
+        else if ((dwChar & 0xF0) == 0xE0)
+        {
+            dwChar &= 0x0F;
+            cbChar = 3;
+            dwMin = 0x800;
+        }
+        else if ((dwChar & 0xF8) == 0xF0)
+        {
+            dwChar &= 0x07;
+            cbChar = 4;
+            dwMin = 0x10000;
+        }
+        else
+        {
+            return HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+        }
+
+        if (cb - i < cbChar)
+        {
+            return HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+        }
+        for (DWORD j = 1; j < cbChar; j++)
+        {
+            BYTE bNext = pb[i + j];
+            if ((bNext & 0xC0) != 0x80)
+            {
+                return HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+            }
+            dwChar = (dwChar << 6) | (bNext & 0x3F);
+        }
+        i += cbChar;
+
+        // Reject overlong forms, encoded surrogates and code points past U+10FFFF.
+        if ((dwChar < dwMin) || (dwChar > 0x10FFFF) || (dwChar >= 0xD800 && dwChar <= 0xDFFF))
+        {
+            return HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+        }
+
+        const DWORD cchChar = (dwChar >= 0x10000) ? 2 : 1;
+        if (pwz)
+        {
+            if (cch - cchOut < cchChar)
+            {
+                return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+            }
+            if (2 == cchChar)
+            {
+                dwChar -= 0x10000;
+                pwz[cchOut] = (WCHAR)(0xD800 + (dwChar >> 10));
+                pwz[cchOut + 1] = (WCHAR)(0xDC00 + (dwChar & 0x3FF));
+            }
+            else
+            {
+                pwz[cchOut] = (WCHAR)dwChar;
+            }
+        }
+        cchOut += cchChar;
+    }
+
+    *pcch = cchOut;
+    return S_OK;
+}
+
+HRESULT Utf16ToUtf8Length(
+    __in_ecount(cch) PCWSTR pwz,
+    __in DWORD cch,
+    __in DWORD dwFlags,
+    __out DWORD* pcb
+    )
+{
+    return TranscodeUtf16ToUtf8(pwz, cch, dwFlags, NULL, 0, pcb);
+}
+
+HRESULT Utf16ToUtf8(
+    __in_ecount(cch) PCWSTR pwz,
+    __in DWORD cch,
+    __in DWORD dwFlags,
+    __out_bcount_part(cb, *pcbWritten) BYTE* pb,
+    __in DWORD cb,
+    __out DWORD* pcbWritten
+    )
+{
+    return TranscodeUtf16ToUtf8(pwz, cch, dwFlags, pb, cb, pcbWritten);
+}
+
+HRESULT Utf8ToUtf16Length(
+    __in_bcount(cb) const BYTE* pb,
+    __in DWORD cb,
+    __out DWORD* pcch
+    )
+{
+    return TranscodeUtf8ToUtf16(pb, cb, NULL, 0, pcch);
+}
+
+HRESULT Utf8ToUtf16(
+    __in_bcount(cb) const BYTE* pb,
+    __in DWORD cb,
+    __out_ecount_part(cch, *pcchWritten) PWSTR pwz,
+    __in DWORD cch,
+    __out DWORD* pcchWritten
+    )
+{
+    return TranscodeUtf8ToUtf16(pb, cb, pwz, cch, pcchWritten);
+}
+
+HRESULT Utf16ToUtf8CoAlloc(
+    __in PCWSTR pwz,
+    __in DWORD dwFlags,
+    __deref_out PSTR* ppsz,
+    __out_opt DWORD* pcb
+    )
+{
+    *ppsz = NULL;
+
+    DWORD cch = lstrlenW(pwz);
+    DWORD cb;
+    HRESULT hr = Utf16ToUtf8Length(pwz, cch, dwFlags, &cb);
+    if (SUCCEEDED(hr))
+    {
+        PSTR psz = (PSTR)CoTaskMemAlloc(cb + 1);
+        if (psz)
+        {
+            DWORD cbWritten;
+            hr = Utf16ToUtf8(pwz, cch, dwFlags, (BYTE*)psz, cb, &cbWritten);
+            if (SUCCEEDED(hr))
+            {
+                psz[cbWritten] = '\0';
+                *ppsz = psz;
+                if (pcb)
+                {
+                    *pcb = cbWritten;
+                }
+            }
+            else
+            {
+                CoTaskMemFree(psz);
+            }
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+    return hr;
+}
@@ -0,0 +1,70 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// UTF-16 <-> UTF-8 transcoding for URLs, QR byte-mode payloads and network
+// bodies.  The *Length functions return the exact size of the output so the
+// caller can size one buffer up front; percent-encoding of query string
+// components is done in the same pass as the transcoding, so a string is
+// never converted and then scanned a second time.  Runs of ASCII are
+// handled eight or sixteen characters at a time with SSE2 where available.
+
+#pragma once
+
+#include <windows.h>
+
+// Percent-encode every byte outside the RFC 3986 unreserved set
+// (A-Z a-z 0-9 - . _ ~), as required for a query string component.
+#define QRTF_PERCENT_ENCODE     0x1
+
+// Number of UTF-8 bytes needed for the cch UTF-16 code units at pwz, not
+// counting a terminator.  Fails with ERROR_NO_UNICODE_TRANSLATION on an
+// unpaired surrogate.
+HRESULT Utf16ToUtf8Length(
+    __in_ecount(cch) PCWSTR pwz,
+    __in DWORD cch,
+    __in DWORD dwFlags,
+    __out DWORD* pcb
+    );
+
+// Converts cch UTF-16 code units to UTF-8.  No terminator is written, and the
+// bytes of pb past *pcbWritten are scratch.  Fails with
+// ERROR_INSUFFICIENT_BUFFER if cb is less than Utf16ToUtf8Length.
+HRESULT Utf16ToUtf8(
+    __in_ecount(cch) PCWSTR pwz,
+    __in DWORD cch,
+    __in DWORD dwFlags,
+    __out_bcount_part(cb, *pcbWritten) BYTE* pb,
+    __in DWORD cb,
+    __out DWORD* pcbWritten
+    );
+
+// Number of UTF-16 code units needed for the cb bytes of UTF-8 at pb.  Fails
+// with ERROR_NO_UNICODE_TRANSLATION on malformed, overlong or surrogate
+// encodings.
+HRESULT Utf8ToUtf16Length(
+    __in_bcount(cb) const BYTE* pb,
+    __in DWORD cb,
+    __out DWORD* pcch
+    );
+
+// Converts cb bytes of UTF-8 to UTF-16.  No terminator is written.
+HRESULT Utf8ToUtf16(
+    __in_bcount(cb) const BYTE* pb,
+    __in DWORD cb,
+    __out_ecount_part(cch, *pcchWritten) PWSTR pwz,
+    __in DWORD cch,
+    __out DWORD* pcchWritten
+    );
+
+// Allocates a NULL terminated UTF-8 copy of pwz with CoTaskMemAlloc.
+HRESULT Utf16ToUtf8CoAlloc(
+    __in PCWSTR pwz,
+    __in DWORD dwFlags,
+    __deref_out PSTR* ppsz,
+    __out_opt DWORD* pcb
+    );
@@ -26,8 +26,9 @@ enum SAMPLE_FIELD_ID
     SFI_QRCODEIMAGE     = 1,  // QR Code image field
     SFI_USERNAME        = 2,
     SFI_PASSWORD        = 3,
-    SFI_SUBMIT_BUTTON   = 4, 
-    SFI_NUM_FIELDS      = 5,  // Note: if new fields are added, keep NUM_FIELDS last.  This is used as a count of the number of fields
+    SFI_APPROVAL_CODE   = 4,  // Offline approval code from the phone companion, hidden unless a device secret is provisioned
+    SFI_SUBMIT_BUTTON   = 5, 
+    SFI_NUM_FIELDS      = 6,  // Note: if new fields are added, keep NUM_FIELDS last.  This is used as a count of the number of fields
 };
 
 // The first value indicates when the tile is displayed (selected, not selected)
@@ -51,6 +52,7 @@ static const FIELD_STATE_PAIR s_rgFieldStatePairs[] =
     { CPFS_DISPLAY_IN_SELECTED_TILE, CPFIS_NONE },          // SFI_QRCODEIMAGE
     { CPFS_DISPLAY_IN_BOTH, CPFIS_NONE },                   // SFI_USERNAME
     { CPFS_DISPLAY_IN_SELECTED_TILE, CPFIS_FOCUSED },       // SFI_PASSWORD
+    { CPFS_DISPLAY_IN_SELECTED_TILE, CPFIS_NONE },          // SFI_APPROVAL_CODE
     { CPFS_DISPLAY_IN_SELECTED_TILE, CPFIS_NONE    },       // SFI_SUBMIT_BUTTON   
 };
 
@@ -64,5 +66,6 @@ static const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR s_rgCredProvFieldDescriptors[]
     { SFI_QRCODEIMAGE, CPFT_TILE_IMAGE, L"QR Code" },
     { SFI_USERNAME, CPFT_LARGE_TEXT, L"Username" },
     { SFI_PASSWORD, CPFT_PASSWORD_TEXT, L"Password" },
+    { SFI_APPROVAL_CODE, CPFT_EDIT_TEXT, L"Approval code" },
     { SFI_SUBMIT_BUTTON, CPFT_SUBMIT_BUTTON, L"Submit" },
 };
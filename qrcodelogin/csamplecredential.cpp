@@ -16,23 +16,20 @@
 #include <wincred.h>
 #include <windows.h>
 #include <gdiplus.h>
-#include <wininet.h>
-#include <strsafe.h>
-#include <thread>
-#include <chrono>
 #include "CSampleCredential.h"
 #include "guid.h"
 
 using namespace Gdiplus;
 #pragma comment(lib, "gdiplus.lib")
-#pragma comment(lib, "wininet.lib")
 
 // CSampleCredential ////////////////////////////////////////////////////////
 
 CSampleCredential::CSampleCredential():
     _cRef(1),
     _pCredProvCredentialEvents(NULL),
-    _hQRCodeBitmap(NULL)
+    _pPool(NULL),
+    _rgcpfdCopied(NULL),
+    _pQRSession(NULL)
 {
     DllAddRef();
 
@@ -54,10 +51,108 @@ CSampleCredential::~CSampleCredential()
         CoTaskMemFree(_rgCredProvFieldDescriptors[i].pszLabel);
     }
 
-    _CleanupQRCodeBitmap();
+    if (_pQRSession)
+    {
+        _pQRSession->Shutdown();
+        _pQRSession->Release();
+    }
+    if (_pPool)
+    {
+        _pPool->Release();
+    }
     DllRelease();
 }
 
+HRESULT CSampleCredential::CreateInstance(__in_opt CRecyclePool* pPool, __deref_out CSampleCredential** ppCred)
+{
+    HRESULT hr = S_OK;
+
+    *ppCred = pPool ? static_cast<CSampleCredential*>(pPool->Take()) : NULL;
+    if (*ppCred == NULL)
+    {
+        *ppCred = new CSampleCredential();
+        if (*ppCred)
+        {
+            if (pPool)
+            {
+                (*ppCred)->_pPool = pPool;
+                pPool->AddRef();
+            }
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
+    return hr;
+}
+
+DWORD CSampleCredential::Recycle(__in void* pv)
+{
+    return static_cast<CSampleCredential*>(pv)->_Reset();
+}
+
+void CSampleCredential::Destroy(__in void* pv)
+{
+    delete static_cast<CSampleCredential*>(pv);
+}
+
+// Called when the last reference goes.
+void CSampleCredential::_Free()
+{
+    if (_pPool)
+    {
+        _pPool->Return(this);
+    }
+    else
+    {
+        delete this;
+    }
+}
+
+// Wipes and frees what the last user of this credential gave it, so it can be
+// initialized again as if it were new.  The field descriptor copies don't
+// depend on the user, so they're kept for Initialize to reuse.  Returns how
+// many allocations were kept.
+DWORD CSampleCredential::_Reset()
+{
+    DWORD cKept = 0;
+    for (int i = 0; i < ARRAYSIZE(_rgFieldStrings); i++)
+    {
+        if (_rgFieldStrings[i])
+        {
+            SecureZeroMemory(_rgFieldStrings[i], lstrlen(_rgFieldStrings[i]) * sizeof(*_rgFieldStrings[i]));
+            CoTaskMemFree(_rgFieldStrings[i]);
+            _rgFieldStrings[i] = NULL;
+        }
+        if (_rgCredProvFieldDescriptors[i].pszLabel)
+        {
+            cKept++;
+        }
+    }
+    ZeroMemory(_rgFieldStatePairs, sizeof(_rgFieldStatePairs));
+
+    if (_pCredProvCredentialEvents)
+    {
+        _pCredProvCredentialEvents->Release();
+        _pCredProvCredentialEvents = NULL;
+    }
+
+    if (_pQRSession)
+    {
+        _pQRSession->Shutdown();
+        _pQRSession->Release();
+        _pQRSession = NULL;
+    }
+    _qrApproval.Uninitialize();
+
+    _cpus = CPUS_INVALID;
+    _dwFlags = 0;
+    _cRef = 1;
+    return cKept;
+}
+
 // Initializes one credential with the field information passed in.
 // Set the value of the SFI_USERNAME field to pwzUsername.
 HRESULT CSampleCredential::Initialize(
@@ -73,12 +168,20 @@ HRESULT CSampleCredential::Initialize(
     _cpus = cpus;
     _dwFlags = dwFlags;
     // Copy the field descriptors for each field. This is useful if you want to vary the 
-    // field descriptors based on what Usage scenario the credential was created for.
+    // field descriptors based on what Usage scenario the credential was created for.  A
+    // credential reused from the pool already has copies of the same descriptors.
+    const bool bCopyDescriptors = (_rgcpfdCopied != rgcpfd);
     for (DWORD i = 0; SUCCEEDED(hr) && i < ARRAYSIZE(_rgCredProvFieldDescriptors); i++)
     {
         _rgFieldStatePairs[i] = rgfsp[i];
-        hr = FieldDescriptorCopy(rgcpfd[i], &_rgCredProvFieldDescriptors[i]);
+        if (bCopyDescriptors)
+        {
+            CoTaskMemFree(_rgCredProvFieldDescriptors[i].pszLabel);
+            _rgCredProvFieldDescriptors[i].pszLabel = NULL;
+            hr = FieldDescriptorCopy(rgcpfd[i], &_rgCredProvFieldDescriptors[i]);
+        }
     }
+    _rgcpfdCopied = SUCCEEDED(hr) ? rgcpfd : NULL;
 
     // Initialize the String values of all the fields.
     if (SUCCEEDED(hr))
@@ -90,11 +193,31 @@ HRESULT CSampleCredential::Initialize(
         hr = SHStrDupW(pwzPassword ? pwzPassword : L"", &_rgFieldStrings[SFI_PASSWORD]);
     }
     if (SUCCEEDED(hr))
+    {
+        hr = SHStrDupW(L"", &_rgFieldStrings[SFI_APPROVAL_CODE]);
+    }
+    if (SUCCEEDED(hr))
     {
         hr = SHStrDupW(L"Submit", &_rgFieldStrings[SFI_SUBMIT_BUTTON]);
     }
 
-    return S_OK;
+    if (SUCCEEDED(hr))
+    {
+        hr = CQRSession::CreateInstance(&_pQRSession);
+    }
+
+    // Without a provisioned device secret the QR code comes from the server and
+    // there is no approval code to type in.
+    if (SUCCEEDED(hr) && !_pQRSession->IsOffline())
+    {
+        _rgFieldStatePairs[SFI_APPROVAL_CODE].cpfs = CPFS_HIDDEN;
+
+        // Online mode.  If the backend's public key is provisioned, approvals are
+        // verified locally before we serialize.
+        _qrApproval.Initialize();
+    }
+
+    return hr;
 }
 
 // LogonUI calls this in order to give us a callback in case we need to notify it of anything.
@@ -106,6 +229,9 @@ HRESULT CSampleCredential::Advise(__in ICredentialProviderCredentialEvents* pcpc
     }
     _pCredProvCredentialEvents = pcpce;
     _pCredProvCredentialEvents->AddRef();
+
+    // Lets the QR session push a new code when it rotates.
+    _pQRSession->Advise(pcpce, this, SFI_QRCODEIMAGE);
     return S_OK;
 }
 
@@ -117,6 +243,7 @@ HRESULT CSampleCredential::UnAdvise()
         _pCredProvCredentialEvents->Release();
     }
     _pCredProvCredentialEvents = NULL;
+    _pQRSession->UnAdvise();
     return S_OK;
 }
 
@@ -130,6 +257,13 @@ HRESULT CSampleCredential::SetSelected(__out BOOL* pbAutoLogon)
 {
     *pbAutoLogon = FALSE;  
 
+    // Only a selected tile watches its online session, and only if the
+    // approval can be verified once it arrives.
+    if (_qrApproval.IsProvisioned())
+    {
+        _pQRSession->StartPolling();
+    }
+
     return S_OK;
 }
 
@@ -139,6 +273,7 @@ HRESULT CSampleCredential::SetSelected(__out BOOL* pbAutoLogon)
 HRESULT CSampleCredential::SetDeselected()
 {
     HRESULT hr = S_OK;
+    _pQRSession->StopPolling();
     if (_rgFieldStrings[SFI_PASSWORD])
     {
         size_t lenPassword = lstrlen(_rgFieldStrings[SFI_PASSWORD]);
@@ -225,27 +360,8 @@ HRESULT CSampleCredential::GetBitmapValue(
     }
     else if ((SFI_QRCODEIMAGE == dwFieldID) && phbmp)
     {
-        // Generate QR code if not already generated
-        if (!_hQRCodeBitmap)
-        {
-            PWSTR pszURL = NULL;
-            HRESULT hrURL = _GetQRCodeURL(&pszURL);
-            if (SUCCEEDED(hrURL) && pszURL)
-            {
-                _GenerateQRCodeBitmap(pszURL);
-                CoTaskMemFree(pszURL);
-            }
-        }
-
-        if (_hQRCodeBitmap)
-        {
-            *phbmp = (HBITMAP)CopyImage(_hQRCodeBitmap, IMAGE_BITMAP, 0, 0, LR_COPYRETURNORG);
-            hr = S_OK;
-        }
-        else
-        {
-            hr = E_FAIL;
-        }
+        // The QR session renders the code and keeps it current.
+        hr = _pQRSession->GetBitmap(phbmp);
     }
     else
     {
@@ -386,11 +502,37 @@ HRESULT CSampleCredential::GetSerialization(
     __out CREDENTIAL_PROVIDER_STATUS_ICON* pcpsiOptionalStatusIcon
     )
 {
-    UNREFERENCED_PARAMETER(ppwzOptionalStatusText);
-    UNREFERENCED_PARAMETER(pcpsiOptionalStatusIcon);
-
     HRESULT hr;
 
+    // In offline mode the phone companion approves the logon by showing an approval code
+    // for the challenge it scanned.  Check it locally before packing anything.
+    if (_pQRSession->IsOffline())
+    {
+        hr = _pQRSession->VerifyApprovalCode(_rgFieldStrings[SFI_APPROVAL_CODE]);
+        if (S_OK != hr)
+        {
+            *pcpgsr = CPGSR_NO_CREDENTIAL_NOT_FINISHED;
+            if (SUCCEEDED(SHStrDupW(L"The approval code is incorrect or has expired.", ppwzOptionalStatusText)))
+            {
+                *pcpsiOptionalStatusIcon = CPSI_ERROR;
+            }
+            return SUCCEEDED(hr) ? S_OK : hr;
+        }
+    }
+    else if (_qrApproval.IsProvisioned())
+    {
+        hr = _CheckOnlineApproval();
+        if (S_OK != hr)
+        {
+            *pcpgsr = CPGSR_NO_CREDENTIAL_NOT_FINISHED;
+            if (SUCCEEDED(SHStrDupW(L"Scan the QR code and approve the sign-in on your phone.", ppwzOptionalStatusText)))
+            {
+                *pcpsiOptionalStatusIcon = CPSI_WARNING;
+            }
+            return SUCCEEDED(hr) ? S_OK : hr;
+        }
+    }
+
     WCHAR wsz[MAX_COMPUTERNAME_LENGTH+1];
     DWORD cch = ARRAYSIZE(wsz);
 
@@ -507,24 +649,10 @@ HRESULT CSampleCredential::GetSerialization(
 
     return hr;
 }
-struct REPORT_RESULT_STATUS_INFO
-{
-    NTSTATUS ntsStatus;
-    NTSTATUS ntsSubstatus;
-    PWSTR     pwzMessage;
-    CREDENTIAL_PROVIDER_STATUS_ICON cpsi;
-};
-
-static const REPORT_RESULT_STATUS_INFO s_rgLogonStatusInfo[] =
-{
-    { STATUS_LOGON_FAILURE, STATUS_SUCCESS, L"Incorrect password or username.", CPSI_ERROR, },
-    { STATUS_ACCOUNT_RESTRICTION, STATUS_ACCOUNT_DISABLED, L"The account is disabled.", CPSI_WARNING },
-};
-
 // ReportResult is completely optional.  Its purpose is to allow a credential to customize the string
-// and the icon displayed in the case of a logon failure.  For example, we have chosen to 
-// customize the error shown in the case of bad username/password and in the case of the account
-// being disabled.
+// and the icon displayed in the case of a logon failure.  We look the result up in the status
+// catalog (see StatusCatalog.h in the helpers), which has messages for the common logon failures
+// and can be localized with a catalog file next to the dll.
 HRESULT CSampleCredential::ReportResult(
     __in NTSTATUS ntsStatus, 
     __in NTSTATUS ntsSubstatus,
@@ -532,28 +660,7 @@ HRESULT CSampleCredential::ReportResult(
     __out CREDENTIAL_PROVIDER_STATUS_ICON* pcpsiOptionalStatusIcon
     )
 {
-    *ppwzOptionalStatusText = NULL;
-    *pcpsiOptionalStatusIcon = CPSI_NONE;
-
-    DWORD dwStatusInfo = (DWORD)-1;
-
-    // Look for a match on status and substatus.
-    for (DWORD i = 0; i < ARRAYSIZE(s_rgLogonStatusInfo); i++)
-    {
-        if (s_rgLogonStatusInfo[i].ntsStatus == ntsStatus && s_rgLogonStatusInfo[i].ntsSubstatus == ntsSubstatus)
-        {
-            dwStatusInfo = i;
-            break;
-        }
-    }
-
-    if ((DWORD)-1 != dwStatusInfo)
-    {
-        if (SUCCEEDED(SHStrDupW(s_rgLogonStatusInfo[dwStatusInfo].pwzMessage, ppwzOptionalStatusText)))
-        {
-            *pcpsiOptionalStatusIcon = s_rgLogonStatusInfo[dwStatusInfo].cpsi;
-        }
-    }
+    StatusCatalogReportResult(ntsStatus, ntsSubstatus, ppwzOptionalStatusText, pcpsiOptionalStatusIcon);
     // If we failed the logon, try to erase the password field.
     if (!SUCCEEDED(HRESULT_FROM_NT(ntsStatus)))
     {
@@ -569,110 +676,53 @@ HRESULT CSampleCredential::ReportResult(
     return S_OK;
 }
 
-// Generate QR code bitmap from URL
-void CSampleCredential::_GenerateQRCodeBitmap(PCWSTR pszURL)
+// Takes the session's last polled status and, if the backend reported it
+// approved, checks the signed assertion locally.  Returns S_OK only for a valid approval of this
+// tile's user, and S_FALSE while the session is not (validly) approved.
+HRESULT CSampleCredential::_CheckOnlineApproval()
 {
-    UNREFERENCED_PARAMETER(pszURL); // todo
-    // Clean up existing bitmap if any
-    _CleanupQRCodeBitmap();
-
-    // Create a simple QR code-like pattern for demonstration
-    // In a real implementation, you would integrate with a QR code library
-    HDC hdcScreen = GetDC(NULL);
-    if (hdcScreen)
-    {
-        // Create a compatible DC and bitmap
-        HDC hdcMem = CreateCompatibleDC(hdcScreen);
-        if (hdcMem)
+    QR_BACKEND_RESPONSE response;
+    BYTE rgbNonce[QR_APPROVAL_NONCE_CB];
+    HRESULT hr = _pQRSession->GetStatus(&response, rgbNonce);
+    if (S_OK == hr)
+    {
+        if (QRLS_APPROVED == response.qrls)
         {
-            // Create a 200x200 pixel bitmap for the QR code
-            BITMAPINFO bmi = {0};
-            bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-            bmi.bmiHeader.biWidth = 200;
-            bmi.bmiHeader.biHeight = -200; // Top-down DIB
-            bmi.bmiHeader.biPlanes = 1;
-            bmi.bmiHeader.biBitCount = 24;
-            bmi.bmiHeader.biCompression = BI_RGB;
-            
-            void* pBits = NULL;
-            HBITMAP hbm = CreateDIBSection(hdcMem, &bmi, DIB_RGB_COLORS, &pBits, NULL, 0);
-            if (hbm)
+            QR_APPROVAL approval;
+            hr = CQRApprovalVerifier::DecodeApproval(&response, &approval);
+            if (SUCCEEDED(hr))
             {
-                HGDIOBJ hbmOld = SelectObject(hdcMem, hbm);
-                
-                // Fill with white background
-                RECT rc = {0, 0, 200, 200};
-                HBRUSH hbrWhite = CreateSolidBrush(RGB(255, 255, 255));
-                FillRect(hdcMem, &rc, hbrWhite);
-                DeleteObject(hbrWhite);
-                
-                // Draw a simple QR code pattern for demonstration
-                // In a real implementation, you would generate an actual QR code from the URL
-                HPEN hpenBlack = CreatePen(PS_SOLID, 1, RGB(0, 0, 0));
-                HPEN hpenOld = (HPEN)SelectObject(hdcMem, hpenBlack);
-                
-                // Draw a simple pattern to represent a QR code
-                // Draw border squares
-                Rectangle(hdcMem, 10, 10, 50, 50);  // Top-left
-                Rectangle(hdcMem, 150, 10, 190, 50); // Top-right
-                Rectangle(hdcMem, 10, 150, 50, 190); // Bottom-left
-                
-                // Draw some pattern inside to make it look like a QR code
-                for (int i = 0; i < 10; i++) {
-                    for (int j = 0; j < 10; j++) {
-                        if ((i + j) % 2 == 0) { // Simple alternating pattern
-                            RECT rect = {60 + i * 12, 60 + j * 12, 70 + i * 12, 70 + j * 12};
-                            HBRUSH hbrBlack = CreateSolidBrush(RGB(0, 0, 0));
-                            FillRect(hdcMem, &rect, hbrBlack);
-                            DeleteObject(hbrBlack);
-                        }
-                    }
+                hr = _qrApproval.Verify(&approval, rgbNonce);
+            }
+            if (S_OK == hr)
+            {
+                // The phone approved a specific user; it has to be the one on this tile.
+                PWSTR pwszUsername;
+                hr = CQRApprovalVerifier::GetUsername(&approval, &pwszUsername);
+                if (SUCCEEDED(hr))
+                {
+                    hr = (CSTR_EQUAL == CompareStringOrdinal(pwszUsername, -1, _rgFieldStrings[SFI_USERNAME], -1, TRUE)) ? S_OK : S_FALSE;
+                    CoTaskMemFree(pwszUsername);
                 }
-                
-                SelectObject(hdcMem, hpenOld);
-                DeleteObject(hpenBlack);
-                
-                // Store the bitmap
-                _hQRCodeBitmap = (HBITMAP)CopyImage(hbm, IMAGE_BITMAP, 0, 0, LR_COPYRETURNORG);
-                
-                SelectObject(hdcMem, hbmOld);
             }
-            DeleteDC(hdcMem);
-        }
-        ReleaseDC(NULL, hdcScreen);
-    }
-}
-
-// Cleanup QR code bitmap
-void CSampleCredential::_CleanupQRCodeBitmap()
-{
-    if (_hQRCodeBitmap)
-    {
-        DeleteObject(_hQRCodeBitmap);
-        _hQRCodeBitmap = NULL;
-    }
-}
+            if (S_OK == hr)
+            {
+                // An approval is good for one logon.  Mark the nonce used so a replayed
+                // approval fails even with a valid signature, and show a fresh QR code
+                // for the next attempt.
+                hr = GetQRReplayCache()->Consume(rgbNonce, sizeof(rgbNonce),
+                                                 CQRApprovalVerifier::GetExpiry(&approval),
+                                                 CQRApprovalVerifier::GetUnixTime());
+            }
 
-// Get QR code URL from server
-HRESULT CSampleCredential::_GetQRCodeURL(PWSTR* ppwszURL)
-{
-    // For demonstration, return a static URL
-    // In a real implementation, this would call an actual API to get a QR code URL
-    PCWSTR staticURL = L"https://example.com/qrcode/12345";
-    size_t cch = wcslen(staticURL) + 1;
-    *ppwszURL = (PWSTR)CoTaskMemAlloc(cch * sizeof(WCHAR));
-    if (*ppwszURL)
-    {
-        wcscpy_s(*ppwszURL, cch, staticURL);
-        return S_OK;
+            // Accepted or not, an approved session is finished; the next
+            // attempt needs a new code.
+            _pQRSession->Renew();
+        }
+        else
+        {
+            hr = S_FALSE;
+        }
     }
-    return E_OUTOFMEMORY;
-}
-
-// Poll login status from server
-HRESULT CSampleCredential::_PollLoginStatus()
-{
-    // For demonstration, return S_OK to simulate successful login
-    // In a real implementation, this would poll an API to check login status
-    return S_OK;
+    return hr;
 }
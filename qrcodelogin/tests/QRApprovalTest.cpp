@@ -0,0 +1,248 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Checks CQRApprovalVerifier against approvals signed by an independent
+// Ed25519 implementation, both built directly and decoded from a response,
+// checks that VerifyBatch gives every approval the same answer as Verify when
+// some are altered, bound to another nonce or expired, then times both.
+// Prints a line per check and returns nonzero if any failed.
+
+#include <windows.h>
+#include <stdio.h>
+#include "QRApproval.h"
+
+// The backend key the approvals below are signed with.
+static const PCSTR c_pszKey = "47cba280aab37aac9d308968271c4aff339fb725a48a15e72f7d7c4f1be20305";
+
+// Signatures over "QRA1" || nonce || expiry || "user<i>", where byte j of
+// approval i's nonce is i * 37 + j.  The last approval expired in 2001; the
+// others expire in 2100.
+static const PCSTR c_rgpszSignature[] =
+{
+    "f8c34a096e1be6630642d9da54a74302208933caf92ffc2c60022cc9e1163347aad2b43ad12c539becaeb18324487fea40a92902b9b28acb5559d2c24ad99801",
+    "38e0f7d03f7fa65b3e58b2f79d84c6330010ef4f2b3ce3b026590cf376152ad8af0fdfb46163737bfab98b4ec0f8e81c9c6b486b50e9c27e407a2d18517cd102",
+    "53c91f6ca0df9d84fd145579a3601e962c9ab0fb9d45a85e78b74d82a3a0a9ad061d8003962a57a704de865d7e462cd6832e2b510ddae2a2535f05819c83ce02",
+    "50e36111b8bf53eb9ce05a5b8eb7e4956a83e838c7bd100481bddaa874a59bf0cc14b4cabac5895bd7c73120571bfd9646040c50ee97c917d407326f4ff62c00",
+    "93ade54b81a6c0625cbe4dc71277a120cd1ac00fbab1bc0312c4a59d9a8c780458fd7c6c647a9a83eb06f9b21162187c120c0ed4ff09ead444d04752142a0101",
+    "20860046859e32cf41465dd3f61d726db850d2177811970810aa332657ebe5e2ec1f7c9f413f088e865e66305ca195d3906b8ddbdc00bb38fd8137e1474e2f08",
+    "c7c587bfb51f131b4d1f00aa98cea62b68ad9a097e8ed346f16db9d21407b5fe3778502b4fdbd31a4133bb8206e75b6fcf86a87c70cbe2b093b7f15ac4e3aa01",
+    "4d85a15241be47dbc9b22ec1f41dc305cc2dd96a28cde4ddd96a994b077d998ca7465a93a475fa892670c66b06706a6300ba972df91aa51ed3bd485eedffdd09",
+};
+
+#define SIGNED_COUNT        ARRAYSIZE(c_rgpszSignature)
+#define EXPIRY_CURRENT      4102444800ULL
+#define EXPIRY_PAST         1000000000ULL
+
+// Longer than two groups so VerifyBatch splits it, and not a multiple of one.
+#define BATCH_COUNT         (2 * ED25519_BATCH_MAX + 5)
+#define MIX_ROUNDS          50
+#define BENCH_ITERATIONS    2000
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, PCSTR pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+// Small deterministic generator so a failure reproduces.
+static ULONG s_ulSeed = 0x2545F491;
+
+static ULONG NextRandom()
+{
+    s_ulSeed ^= s_ulSeed << 13;
+    s_ulSeed ^= s_ulSeed >> 17;
+    s_ulSeed ^= s_ulSeed << 5;
+    return s_ulSeed;
+}
+
+static void FromHex(PCSTR psz, BYTE* pb)
+{
+    for (; psz[0] && psz[1]; psz += 2)
+    {
+        unsigned int b;
+        sscanf(psz, "%2x", &b);
+        *pb++ = (BYTE)b;
+    }
+}
+
+static void ToBase64(const BYTE* pb, DWORD cb, PSTR psz)
+{
+    static const char c_szAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (DWORD i = 0; i < cb; i += 3)
+    {
+        DWORD dw = (pb[i] << 16) | (((i + 1) < cb) ? (pb[i + 1] << 8) : 0) | (((i + 2) < cb) ? pb[i + 2] : 0);
+        *psz++ = c_szAlphabet[(dw >> 18) & 0x3f];
+        *psz++ = c_szAlphabet[(dw >> 12) & 0x3f];
+        *psz++ = ((i + 1) < cb) ? c_szAlphabet[(dw >> 6) & 0x3f] : '=';
+        *psz++ = ((i + 2) < cb) ? c_szAlphabet[dw & 0x3f] : '=';
+    }
+    *psz = '\0';
+}
+
+static void MakeNonce(DWORD i, BYTE* pbNonce)
+{
+    for (DWORD j = 0; j < QR_APPROVAL_NONCE_CB; j++)
+    {
+        pbNonce[j] = (BYTE)(i * 37 + j);
+    }
+}
+
+// Builds signed approval i the way DecodeApproval would leave it.
+static void MakeApproval(DWORD i, QR_APPROVAL* pApproval)
+{
+    ZeroMemory(pApproval, sizeof(*pApproval));
+    MakeNonce(i, pApproval->rgbPayload);
+
+    ULONGLONG ullExpiry = (SIGNED_COUNT - 1 == i) ? EXPIRY_PAST : EXPIRY_CURRENT;
+    for (DWORD j = 0; j < QR_APPROVAL_EXPIRY_CB; j++)
+    {
+        pApproval->rgbPayload[QR_APPROVAL_NONCE_CB + j] = (BYTE)(ullExpiry >> (8 * (QR_APPROVAL_EXPIRY_CB - 1 - j)));
+    }
+
+    int cch = sprintf((char*)pApproval->rgbPayload + QR_APPROVAL_HEADER_CB, "user%u", i);
+    pApproval->cbPayload = QR_APPROVAL_HEADER_CB + cch;
+    FromHex(c_rgpszSignature[i], pApproval->rgbSignature);
+}
+
+static double ElapsedSeconds(const LARGE_INTEGER& liStart)
+{
+    LARGE_INTEGER liEnd, liFrequency;
+    QueryPerformanceCounter(&liEnd);
+    QueryPerformanceFrequency(&liFrequency);
+    return (double)(liEnd.QuadPart - liStart.QuadPart) / liFrequency.QuadPart;
+}
+
+int main()
+{
+    CQRApprovalVerifier verifier;
+    char szWhat[128];
+
+    Check((S_FALSE == verifier.Initialize()) && !verifier.IsProvisioned(), "no key provisioned");
+
+    BYTE rgbKey[ED25519_PUBLIC_KEY_CB];
+    FromHex(c_pszKey, rgbKey);
+    ShimSetRegValue(HKEY_LOCAL_MACHINE, QR_APPROVAL_REGKEY, QR_APPROVAL_REGVALUE, REG_BINARY, rgbKey, sizeof(rgbKey));
+    Check((S_OK == verifier.Initialize()) && verifier.IsProvisioned(), "provisioned key loads");
+
+    QR_APPROVAL rgSigned[SIGNED_COUNT];
+    BYTE rgrgbNonce[SIGNED_COUNT][QR_APPROVAL_NONCE_CB];
+    for (DWORD i = 0; i < SIGNED_COUNT; i++)
+    {
+        MakeApproval(i, &rgSigned[i]);
+        MakeNonce(i, rgrgbNonce[i]);
+
+        HRESULT hrExpected = (SIGNED_COUNT - 1 == i) ? S_FALSE : S_OK;
+        sprintf(szWhat, "approval %u: %s", i, (S_OK == hrExpected) ? "verifies" : "expired is refused");
+        Check(hrExpected == verifier.Verify(&rgSigned[i], rgrgbNonce[i]), szWhat);
+
+        sprintf(szWhat, "approval %u: refused for another session's nonce", i);
+        Check(S_FALSE == verifier.Verify(&rgSigned[i], rgrgbNonce[(i + 1) % SIGNED_COUNT]), szWhat);
+    }
+
+    // The same approval as the backend sends it decodes to the same bytes.
+    QR_BACKEND_RESPONSE response = {};
+    response.dwFieldsPresent = QRJF_STATUS | QRJF_TOKEN | QRJF_SIGNATURE;
+    response.qrls = QRLS_APPROVED;
+    ToBase64(rgSigned[0].rgbPayload, rgSigned[0].cbPayload, response.szToken);
+    ToBase64(rgSigned[0].rgbSignature, ED25519_SIGNATURE_CB, response.szSignature);
+    QR_APPROVAL approval;
+    Check((S_OK == CQRApprovalVerifier::DecodeApproval(&response, &approval)) &&
+          (0 == memcmp(&approval, &rgSigned[0], sizeof(approval))) &&
+          (S_OK == verifier.Verify(&approval, rgrgbNonce[0])), "approval decoded from a response verifies");
+
+    // Batches of the good approvals with a few altered, rebound or expired
+    // ones mixed in must give each approval the answer Verify gives it.
+    QR_APPROVAL rgApproval[BATCH_COUNT];
+    const BYTE* rgpbNonce[BATCH_COUNT];
+    HRESULT rghrResult[BATCH_COUNT];
+    bool fAgree = true;
+    bool fAllGoodPass = true;
+    for (DWORD iRound = 0; iRound <= MIX_ROUNDS; iRound++)
+    {
+        DWORD cBad = 0;
+        for (DWORD i = 0; i < BATCH_COUNT; i++)
+        {
+            DWORD iSigned = i % (SIGNED_COUNT - 1);
+            rgApproval[i] = rgSigned[iSigned];
+            rgpbNonce[i] = rgrgbNonce[iSigned];
+
+            // Round 0 is all good; the others spoil about one in eight.
+            if ((iRound > 0) && (0 == NextRandom() % 8))
+            {
+                cBad++;
+                switch (NextRandom() % 4)
+                {
+                case 0:
+                    rgApproval[i].rgbSignature[NextRandom() % ED25519_SIGNATURE_CB] ^= (BYTE)(1 << (NextRandom() % 8));
+                    break;
+                case 1:
+                    rgApproval[i].rgbPayload[QR_APPROVAL_HEADER_CB] ^= 0x20;
+                    break;
+                case 2:
+                    rgpbNonce[i] = rgrgbNonce[(iSigned + 1) % SIGNED_COUNT];
+                    break;
+                default:
+                    rgApproval[i] = rgSigned[SIGNED_COUNT - 1];
+                    rgpbNonce[i] = rgrgbNonce[SIGNED_COUNT - 1];
+                    break;
+                }
+            }
+        }
+
+        HRESULT hr = verifier.VerifyBatch(BATCH_COUNT, rgApproval, rgpbNonce, rghrResult);
+        for (DWORD i = 0; i < BATCH_COUNT; i++)
+        {
+            if ((S_OK != hr) || (rghrResult[i] != verifier.Verify(&rgApproval[i], rgpbNonce[i])))
+            {
+                fAgree = false;
+            }
+            if ((0 == cBad) && (S_OK != rghrResult[i]))
+            {
+                fAllGoodPass = false;
+            }
+        }
+    }
+    Check(fAllGoodPass, "batch of good approvals all verify");
+    sprintf(szWhat, "%u mixed batches of %u agree with Verify for every approval", MIX_ROUNDS, BATCH_COUNT);
+    Check(fAgree, szWhat);
+
+    verifier.Uninitialize();
+    Check(E_UNEXPECTED == verifier.VerifyBatch(1, rgSigned, rgpbNonce, rghrResult), "batch refused once uninitialized");
+
+    // Approvals verified a second, one at a time and in full batches.
+    verifier.Initialize();
+    for (DWORD i = 0; i < ED25519_BATCH_MAX; i++)
+    {
+        rgApproval[i] = rgSigned[i % (SIGNED_COUNT - 1)];
+        rgpbNonce[i] = rgrgbNonce[i % (SIGNED_COUNT - 1)];
+    }
+
+    LARGE_INTEGER liStart;
+    QueryPerformanceCounter(&liStart);
+    for (DWORD i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        verifier.Verify(&rgApproval[i % ED25519_BATCH_MAX], rgpbNonce[i % ED25519_BATCH_MAX]);
+    }
+    double dSingle = BENCH_ITERATIONS / ElapsedSeconds(liStart);
+
+    QueryPerformanceCounter(&liStart);
+    for (DWORD i = 0; i < BENCH_ITERATIONS / ED25519_BATCH_MAX; i++)
+    {
+        verifier.VerifyBatch(ED25519_BATCH_MAX, rgApproval, rgpbNonce, rghrResult);
+    }
+    double dBatch = (BENCH_ITERATIONS / ED25519_BATCH_MAX) * ED25519_BATCH_MAX / ElapsedSeconds(liStart);
+
+    printf("\napprovals/s: Verify %.0f, VerifyBatch of %u %.0f\n", dSingle, ED25519_BATCH_MAX, dBatch);
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Checks CQRChallenge against the offline scheme in the readme, with the
+// device secret provisioned in the shim's in-memory registry, then times the
+// first challenge after Initialize (what a tile waits for) and how many
+// challenges and approval code checks a second it computes.  The HMAC-SHA256
+// it is built on is checked against RFC 4231 first.  Prints a line per check
+// and returns nonzero if any failed.
+
+#include <windows.h>
+#include <bcrypt.h>
+#include <stdio.h>
+#include "QRChallenge.h"
+
+#define BENCH_ITERATIONS    100000
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, PCSTR pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static void FromHex(PCSTR psz, BYTE* pb)
+{
+    for (; psz[0] && psz[1]; psz += 2)
+    {
+        unsigned int b;
+        sscanf(psz, "%2x", &b);
+        *pb++ = (BYTE)b;
+    }
+}
+
+static void HmacSha256(const BYTE* pbKey, DWORD cbKey, const BYTE* pbData, DWORD cbData, BYTE* pbMac)
+{
+    BCRYPT_ALG_HANDLE hAlg;
+    BCRYPT_HASH_HANDLE hHash;
+    BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_SHA256_ALGORITHM, NULL, BCRYPT_ALG_HANDLE_HMAC_FLAG);
+    BCryptCreateHash(hAlg, &hHash, NULL, 0, (PUCHAR)pbKey, cbKey, 0);
+    BCryptHashData(hHash, (PUCHAR)pbData, cbData, 0);
+    BCryptFinishHash(hHash, pbMac, 32, 0);
+    BCryptDestroyHash(hHash);
+    BCryptCloseAlgorithmProvider(hAlg, 0);
+}
+
+// HMAC-SHA256(secret, "QRL1" || purpose || big-endian step), as the readme gives it.
+static void ComputeMac(const BYTE* pbSecret, DWORD cbSecret, BYTE bPurpose, ULONGLONG ullStep, BYTE* pbMac)
+{
+    BYTE rgbMessage[13] = { 'Q', 'R', 'L', '1', bPurpose };
+    for (int i = 0; i < 8; i++)
+    {
+        rgbMessage[5 + i] = (BYTE)(ullStep >> (56 - 8 * i));
+    }
+    HmacSha256(pbSecret, cbSecret, rgbMessage, sizeof(rgbMessage), pbMac);
+}
+
+static void ApprovalCode(const BYTE* pbSecret, DWORD cbSecret, ULONGLONG ullStep, PWSTR pwzCode)
+{
+    BYTE rgbMac[32];
+    ComputeMac(pbSecret, cbSecret, 'A', ullStep, rgbMac);
+    DWORD dwOffset = rgbMac[31] & 0xf;
+    DWORD dwCode = ((rgbMac[dwOffset] & 0x7f) << 24) | (rgbMac[dwOffset + 1] << 16) |
+                   (rgbMac[dwOffset + 2] << 8) | rgbMac[dwOffset + 3];
+    for (int i = QR_APPROVAL_CODE_DIGITS - 1; i >= 0; i--)
+    {
+        pwzCode[i] = (WCHAR)(L'0' + dwCode % 10);
+        dwCode /= 10;
+    }
+    pwzCode[QR_APPROVAL_CODE_DIGITS] = L'\0';
+}
+
+static double ElapsedSeconds(const LARGE_INTEGER& liStart)
+{
+    LARGE_INTEGER liEnd, liFrequency;
+    QueryPerformanceCounter(&liEnd);
+    QueryPerformanceFrequency(&liFrequency);
+    return (double)(liEnd.QuadPart - liStart.QuadPart) / liFrequency.QuadPart;
+}
+
+int main()
+{
+    // RFC 4231 test cases 1 and 2.
+    BYTE rgbKey[20];
+    BYTE rgbMac[32];
+    BYTE rgbExpected[32];
+    FillMemory(rgbKey, sizeof(rgbKey), 0x0b);
+    HmacSha256(rgbKey, sizeof(rgbKey), (const BYTE*)"Hi There", 8, rgbMac);
+    FromHex("b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7", rgbExpected);
+    Check(0 == memcmp(rgbMac, rgbExpected, sizeof(rgbMac)), "HMAC-SHA256: RFC 4231 test case 1");
+    HmacSha256((const BYTE*)"Jefe", 4, (const BYTE*)"what do ya want for nothing?", 28, rgbMac);
+    FromHex("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843", rgbExpected);
+    Check(0 == memcmp(rgbMac, rgbExpected, sizeof(rgbMac)), "HMAC-SHA256: RFC 4231 test case 2");
+
+    CQRChallenge challenge;
+    Check((S_FALSE == challenge.Initialize()) && !challenge.IsProvisioned(), "no secret: offline mode is unavailable");
+
+    BYTE rgbSecret[32];
+    for (DWORD i = 0; i < sizeof(rgbSecret); i++)
+    {
+        rgbSecret[i] = (BYTE)(i * 7 + 1);
+    }
+    ShimSetRegValue(HKEY_LOCAL_MACHINE, QR_CHALLENGE_REGKEY, QR_CHALLENGE_REGVALUE, REG_BINARY, rgbSecret, QR_CHALLENGE_SECRET_CB_MIN - 1);
+    Check(HRESULT_FROM_WIN32(ERROR_INVALID_DATA) == challenge.Initialize(), "short secret is refused");
+
+    // The first tile waits for Initialize and its first challenge.
+    ShimSetRegValue(HKEY_LOCAL_MACHINE, QR_CHALLENGE_REGKEY, QR_CHALLENGE_REGVALUE, REG_BINARY, rgbSecret, sizeof(rgbSecret));
+    LARGE_INTEGER liStart;
+    QueryPerformanceCounter(&liStart);
+    HRESULT hr = challenge.Initialize();
+    const ULONGLONG ullStep = CQRChallenge::GetCurrentTimeStep();
+    PWSTR pwszURL = NULL;
+    if (SUCCEEDED(hr))
+    {
+        hr = challenge.GetChallengeURL(ullStep, &pwszURL);
+    }
+    double dFirstUs = ElapsedSeconds(liStart) * 1e6;
+    Check(S_OK == hr, "secret provisioned: first challenge computed");
+
+    ComputeMac(rgbSecret, sizeof(rgbSecret), 'C', ullStep, rgbMac);
+    char szExpected[128];
+    int cch = sprintf(szExpected, "https://example.com/qrcode/?c=");
+    for (DWORD i = 0; i < QR_CHALLENGE_CB; i++)
+    {
+        cch += sprintf(szExpected + cch, "%02x", rgbMac[i]);
+    }
+    sprintf(szExpected + cch, "&t=%llu", ullStep);
+    char szURL[128] = "";
+    if (pwszURL != NULL)
+    {
+        ShimWideToNarrow(pwszURL, szURL, ARRAYSIZE(szURL));
+    }
+    Check(0 == strcmp(szURL, szExpected), "challenge URL matches HMAC(secret, \"QRL1\" || 'C' || step)");
+    CoTaskMemFree(pwszURL);
+
+    WCHAR wszCode[QR_APPROVAL_CODE_DIGITS + 1];
+    ApprovalCode(rgbSecret, sizeof(rgbSecret), ullStep, wszCode);
+    Check(S_OK == challenge.VerifyApprovalCode(wszCode), "approval code for the current step is accepted");
+    ApprovalCode(rgbSecret, sizeof(rgbSecret), ullStep - 1, wszCode);
+    Check(S_OK == challenge.VerifyApprovalCode(wszCode), "approval code for the previous step is accepted");
+    ApprovalCode(rgbSecret, sizeof(rgbSecret), ullStep - 1 - QR_APPROVAL_STEP_WINDOW, wszCode);
+    Check(S_FALSE == challenge.VerifyApprovalCode(wszCode), "approval code outside the window is refused");
+    wszCode[QR_APPROVAL_CODE_DIGITS - 1] = L'\0';
+    Check(S_FALSE == challenge.VerifyApprovalCode(wszCode), "approval code of the wrong length is refused");
+
+    QueryPerformanceCounter(&liStart);
+    for (DWORD i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        challenge.GetChallengeURL(ullStep + i, &pwszURL);
+        CoTaskMemFree(pwszURL);
+    }
+    double dChallenges = BENCH_ITERATIONS / ElapsedSeconds(liStart);
+
+    // A valid code, so every check computes both MACs.
+    ApprovalCode(rgbSecret, sizeof(rgbSecret), ullStep, wszCode);
+    QueryPerformanceCounter(&liStart);
+    for (DWORD i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        challenge.VerifyApprovalCode(wszCode);
+    }
+    double dChecks = BENCH_ITERATIONS / ElapsedSeconds(liStart);
+
+    printf("\nfirst challenge after Initialize: %.1f us\n", dFirstUs);
+    printf("challenges/s: %.0f, approval code checks/s: %.0f (each %u MACs)\n", dChallenges, dChecks, QR_APPROVAL_STEP_WINDOW + 1);
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
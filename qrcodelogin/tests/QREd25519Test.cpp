@@ -0,0 +1,241 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Checks QREd25519 against the RFC 8032 test vectors, checks that a batch
+// and its signatures verified one at a time always agree, and that small
+// order keys and R values are refused, then times both paths.  Prints a
+// line per check and returns nonzero if any failed.
+
+#include <windows.h>
+#include <bcrypt.h>
+#include <stdio.h>
+#include "QREd25519.h"
+
+struct ED25519_VECTOR
+{
+    PCSTR   pszKey;
+    PCSTR   pszMessage;
+    PCSTR   pszSignature;
+};
+
+// RFC 8032 section 7.1, tests 1 to 3.
+static const ED25519_VECTOR c_rgVectors[] =
+{
+    {
+        "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a",
+        "",
+        "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e065224901555fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b",
+    },
+    {
+        "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c",
+        "72",
+        "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00",
+    },
+    {
+        "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025",
+        "af82",
+        "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a",
+    },
+};
+
+// Encodings of points of small order: the identity, the point of order 2
+// (y = -1), and one of order 4 (y = 0).
+static const PCSTR c_rgpszSmallOrder[] =
+{
+    "0100000000000000000000000000000000000000000000000000000000000000",
+    "ecffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+    "0000000000000000000000000000000000000000000000000000000000000000",
+};
+
+// The group order L, little endian; S + L is a non-canonical S.
+static const BYTE c_rgbL[32] =
+{
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10,
+};
+
+#define BENCH_ITERATIONS    2000
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, PCSTR pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static DWORD FromHex(PCSTR psz, BYTE* pb)
+{
+    DWORD cb = 0;
+    for (; psz[0] && psz[1]; psz += 2)
+    {
+        unsigned int b;
+        sscanf(psz, "%2x", &b);
+        pb[cb++] = (BYTE)b;
+    }
+    return cb;
+}
+
+// SHA-512(R || A || M), the hash the verifier takes in place of M.
+static void ComputeHram(const BYTE* pbSignature, const BYTE* pbKey, const BYTE* pbMessage, DWORD cbMessage, BYTE* pbHram)
+{
+    BCRYPT_ALG_HANDLE hAlg;
+    BCRYPT_HASH_HANDLE hHash;
+    BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_SHA512_ALGORITHM, NULL, 0);
+    BCryptCreateHash(hAlg, &hHash, NULL, 0, NULL, 0, 0);
+    BCryptHashData(hHash, (PUCHAR)pbSignature, 32, 0);
+    BCryptHashData(hHash, (PUCHAR)pbKey, ED25519_PUBLIC_KEY_CB, 0);
+    BCryptHashData(hHash, (PUCHAR)pbMessage, cbMessage, 0);
+    BCryptFinishHash(hHash, pbHram, ED25519_HRAM_CB, 0);
+    BCryptDestroyHash(hHash);
+    BCryptCloseAlgorithmProvider(hAlg, 0);
+}
+
+// Adds L to the S half of a signature.
+static void AddL(BYTE* pbSignature)
+{
+    UINT uCarry = 0;
+    for (int i = 0; i < 32; i++)
+    {
+        uCarry += pbSignature[32 + i] + c_rgbL[i];
+        pbSignature[32 + i] = (BYTE)uCarry;
+        uCarry >>= 8;
+    }
+}
+
+static double ElapsedSeconds(const LARGE_INTEGER& liStart)
+{
+    LARGE_INTEGER liEnd, liFrequency;
+    QueryPerformanceCounter(&liEnd);
+    QueryPerformanceFrequency(&liFrequency);
+    return (double)(liEnd.QuadPart - liStart.QuadPart) / liFrequency.QuadPart;
+}
+
+int main()
+{
+    const DWORD cVectors = ARRAYSIZE(c_rgVectors);
+
+    ED25519_PUBLIC_KEY rgKey[cVectors];
+    BYTE rgrgbSignature[cVectors][ED25519_SIGNATURE_CB];
+    BYTE rgrgbHram[cVectors][ED25519_HRAM_CB];
+    char szWhat[128];
+
+    for (DWORD i = 0; i < cVectors; i++)
+    {
+        BYTE rgbKey[ED25519_PUBLIC_KEY_CB];
+        BYTE rgbMessage[64];
+        FromHex(c_rgVectors[i].pszKey, rgbKey);
+        DWORD cbMessage = FromHex(c_rgVectors[i].pszMessage, rgbMessage);
+        FromHex(c_rgVectors[i].pszSignature, rgrgbSignature[i]);
+        ComputeHram(rgrgbSignature[i], rgbKey, rgbMessage, cbMessage, rgrgbHram[i]);
+
+        sprintf(szWhat, "RFC 8032 test %u: key decodes", i + 1);
+        Check(S_OK == Ed25519DecodePublicKey(rgbKey, &rgKey[i]), szWhat);
+
+        sprintf(szWhat, "RFC 8032 test %u: signature verifies", i + 1);
+        Check(S_OK == Ed25519Verify(&rgKey[i], rgrgbSignature[i], rgrgbHram[i]), szWhat);
+
+        BYTE rgbBad[ED25519_SIGNATURE_CB];
+        CopyMemory(rgbBad, rgrgbSignature[i], sizeof(rgbBad));
+        rgbBad[40] ^= 0x01;
+        sprintf(szWhat, "RFC 8032 test %u: altered S is rejected", i + 1);
+        Check(S_FALSE == Ed25519Verify(&rgKey[i], rgbBad, rgrgbHram[i]), szWhat);
+
+        BYTE rgbHramBad[ED25519_HRAM_CB];
+        CopyMemory(rgbHramBad, rgrgbHram[i], sizeof(rgbHramBad));
+        rgbHramBad[0] ^= 0x01;
+        sprintf(szWhat, "RFC 8032 test %u: altered message is rejected", i + 1);
+        Check(S_FALSE == Ed25519Verify(&rgKey[i], rgrgbSignature[i], rgbHramBad), szWhat);
+
+        CopyMemory(rgbBad, rgrgbSignature[i], sizeof(rgbBad));
+        AddL(rgbBad);
+        sprintf(szWhat, "RFC 8032 test %u: S + L is rejected", i + 1);
+        Check(S_FALSE == Ed25519Verify(&rgKey[i], rgbBad, rgrgbHram[i]), szWhat);
+    }
+
+    // A batch of copies of one good signature, with one copy optionally
+    // altered, must give the same answer as verifying the copies one by one.
+    BYTE rgbZ[ED25519_BATCH_MAX * ED25519_BATCH_Z_CB];
+    BCryptGenRandom(NULL, rgbZ, sizeof(rgbZ), BCRYPT_USE_SYSTEM_PREFERRED_RNG);
+    for (DWORD i = 0; i < cVectors; i++)
+    {
+        BYTE rgbBad[ED25519_SIGNATURE_CB];
+        CopyMemory(rgbBad, rgrgbSignature[i], sizeof(rgbBad));
+        rgbBad[33] ^= 0x80;
+
+        const BYTE* rgpbSignature[ED25519_BATCH_MAX];
+        const BYTE* rgpbHram[ED25519_BATCH_MAX];
+        for (int iBad = -1; iBad < ED25519_BATCH_MAX; iBad += 5)
+        {
+            HRESULT hrSingle = S_OK;
+            for (int j = 0; j < ED25519_BATCH_MAX; j++)
+            {
+                rgpbSignature[j] = (j == iBad) ? rgbBad : rgrgbSignature[i];
+                rgpbHram[j] = rgrgbHram[i];
+                if (S_OK != Ed25519Verify(&rgKey[i], rgpbSignature[j], rgpbHram[j]))
+                {
+                    hrSingle = S_FALSE;
+                }
+            }
+            HRESULT hrBatch = Ed25519VerifyBatch(&rgKey[i], ED25519_BATCH_MAX, rgpbSignature, rgpbHram, rgbZ);
+            sprintf(szWhat, "RFC 8032 test %u: batch with %s agrees with single", i + 1, (iBad < 0) ? "no bad signature" : "a bad signature");
+            Check((hrBatch == hrSingle) && (hrSingle == ((iBad < 0) ? S_OK : S_FALSE)), szWhat);
+        }
+    }
+
+    for (DWORD i = 0; i < ARRAYSIZE(c_rgpszSmallOrder); i++)
+    {
+        BYTE rgbPoint[32];
+        FromHex(c_rgpszSmallOrder[i], rgbPoint);
+
+        ED25519_PUBLIC_KEY key;
+        sprintf(szWhat, "small order point %u: refused as a key", i + 1);
+        Check(NTE_BAD_KEY == Ed25519DecodePublicKey(rgbPoint, &key), szWhat);
+
+        // With S = 0 and k = 0 the cofactored equation holds for any small
+        // order R, so only the check on R itself refuses these.
+        BYTE rgbSignature[ED25519_SIGNATURE_CB] = { 0 };
+        CopyMemory(rgbSignature, rgbPoint, sizeof(rgbPoint));
+        BYTE rgbHram[ED25519_HRAM_CB] = { 0 };
+        const BYTE* pbSignature = rgbSignature;
+        const BYTE* pbHram = rgbHram;
+        sprintf(szWhat, "small order point %u: refused as R", i + 1);
+        Check((S_FALSE == Ed25519Verify(&rgKey[0], rgbSignature, rgbHram)) &&
+              (S_FALSE == Ed25519VerifyBatch(&rgKey[0], 1, &pbSignature, &pbHram, rgbZ)), szWhat);
+    }
+
+    // Verifications a second, one at a time and in full batches.
+    LARGE_INTEGER liStart;
+    QueryPerformanceCounter(&liStart);
+    for (DWORD i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        Ed25519Verify(&rgKey[0], rgrgbSignature[0], rgrgbHram[0]);
+    }
+    double dSingle = BENCH_ITERATIONS / ElapsedSeconds(liStart);
+
+    const BYTE* rgpbSignature[ED25519_BATCH_MAX];
+    const BYTE* rgpbHram[ED25519_BATCH_MAX];
+    for (DWORD j = 0; j < ED25519_BATCH_MAX; j++)
+    {
+        rgpbSignature[j] = rgrgbSignature[0];
+        rgpbHram[j] = rgrgbHram[0];
+    }
+    QueryPerformanceCounter(&liStart);
+    for (DWORD i = 0; i < BENCH_ITERATIONS / ED25519_BATCH_MAX; i++)
+    {
+        Ed25519VerifyBatch(&rgKey[0], ED25519_BATCH_MAX, rgpbSignature, rgpbHram, rgbZ);
+    }
+    double dBatch = (BENCH_ITERATIONS / ED25519_BATCH_MAX) * ED25519_BATCH_MAX / ElapsedSeconds(liStart);
+
+    printf("\nverifications/s: single %.0f, batch of %u %.0f\n", dSingle, ED25519_BATCH_MAX, dBatch);
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
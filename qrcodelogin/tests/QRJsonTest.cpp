@@ -0,0 +1,355 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Checks CQRJsonParser against known responses fed whole and split at every
+// byte, checks that malformed, truncated and oversized input is refused, and
+// fuzzes it with mutated responses, requiring that feeding a mutant whole and
+// one byte at a time give the same result.  Then times the parser in MB/s and
+// counts the heap allocations it makes per response, which should be none.
+// Prints a line per check and returns nonzero if any failed.
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+#include "QRJson.h"
+
+#define BENCH_ITERATIONS    200000
+#define FUZZ_ITERATIONS     200000
+
+// Every heap allocation in the process goes through malloc, whichever API
+// asked for it, so counting here catches HeapAlloc, CoTaskMemAlloc and new
+// alike.  glibc only; do not build this file with -fsanitize.
+EXTERN_C void* __libc_malloc(size_t cb);
+EXTERN_C void* __libc_calloc(size_t c, size_t cb);
+EXTERN_C void* __libc_realloc(void* pv, size_t cb);
+EXTERN_C void __libc_free(void* pv);
+
+static volatile LONG s_cAllocations = 0;
+
+EXTERN_C void* malloc(size_t cb)
+{
+    __sync_fetch_and_add(&s_cAllocations, 1);
+    return __libc_malloc(cb);
+}
+
+EXTERN_C void* calloc(size_t c, size_t cb)
+{
+    __sync_fetch_and_add(&s_cAllocations, 1);
+    return __libc_calloc(c, cb);
+}
+
+EXTERN_C void* realloc(void* pv, size_t cb)
+{
+    __sync_fetch_and_add(&s_cAllocations, 1);
+    return __libc_realloc(pv, cb);
+}
+
+EXTERN_C void free(void* pv)
+{
+    __libc_free(pv);
+}
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, PCSTR pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static double ElapsedSeconds(const LARGE_INTEGER& liStart)
+{
+    LARGE_INTEGER liEnd, liFrequency;
+    QueryPerformanceCounter(&liEnd);
+    QueryPerformanceFrequency(&liFrequency);
+    return (double)(liEnd.QuadPart - liStart.QuadPart) / (double)liFrequency.QuadPart;
+}
+
+// Feeds pb in pieces of cbPiece bytes (all at once if 0) followed by Finish.
+static HRESULT Parse(const BYTE* pb, DWORD cb, DWORD cbPiece, QR_BACKEND_RESPONSE* pResponse)
+{
+    CQRJsonParser parser;
+    parser.Reset(pResponse);
+
+    HRESULT hr = S_FALSE;
+    if (0 == cbPiece)
+    {
+        cbPiece = cb;
+    }
+    for (DWORD ib = 0; (ib < cb) && SUCCEEDED(hr); ib += cbPiece)
+    {
+        hr = parser.Feed(pb + ib, (cb - ib < cbPiece) ? cb - ib : cbPiece);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = parser.Finish();
+    }
+    return hr;
+}
+
+static HRESULT ParseString(PCSTR psz, DWORD cbPiece, QR_BACKEND_RESPONSE* pResponse)
+{
+    return Parse((const BYTE*)psz, (DWORD)strlen(psz), cbPiece, pResponse);
+}
+
+// Reset zeroes the whole response, so fields that were not seen compare equal.
+static bool SameResponse(const QR_BACKEND_RESPONSE& r1, const QR_BACKEND_RESPONSE& r2)
+{
+    return 0 == memcmp(&r1, &r2, sizeof(r1));
+}
+
+// Parses psz whole and split at every byte, requiring that all of them agree.
+static HRESULT ParseEverySplit(PCSTR psz, QR_BACKEND_RESPONSE* pResponse, bool* pfAgree)
+{
+    const BYTE* pb = (const BYTE*)psz;
+    DWORD cb = (DWORD)strlen(psz);
+    HRESULT hr = Parse(pb, cb, 0, pResponse);
+
+    *pfAgree = true;
+    for (DWORD ibSplit = 1; ibSplit < cb; ibSplit++)
+    {
+        QR_BACKEND_RESPONSE response;
+        CQRJsonParser parser;
+        parser.Reset(&response);
+        HRESULT hrSplit = parser.Feed(pb, ibSplit);
+        if (SUCCEEDED(hrSplit))
+        {
+            hrSplit = parser.Feed(pb + ibSplit, cb - ibSplit);
+        }
+        if (SUCCEEDED(hrSplit))
+        {
+            hrSplit = parser.Finish();
+        }
+        if ((hrSplit != hr) || (SUCCEEDED(hr) && !SameResponse(response, *pResponse)))
+        {
+            *pfAgree = false;
+        }
+    }
+    return hr;
+}
+
+static const CHAR c_szToken[] =
+    "bm9uY2Vub25jZW5vbmNlbm9uY2Vub25jZW5vbmNlAAAAAGZBx0RhbGljZUBleGFtcGxlLmNvbQ";
+static const CHAR c_szSignature[] =
+    "3s1MvbH8fyl0Z+vBJ4xBQkQfTgM0n1Ed0aq8jXzU9i9cq7xLvQ5yUk2v8vYw8k6r0a9s7FqZkR3m1nQp0bXcDg==";
+
+static const CHAR c_szApproved[] =
+    "{\"status\":\"approved\",\"token\":\"bm9uY2Vub25jZW5vbmNlbm9uY2Vub25jZW5vbmNlAAAAAGZBx0RhbGljZUBleGFtcGxlLmNvbQ\","
+    "\"signature\":\"3s1MvbH8fyl0Z+vBJ4xBQkQfTgM0n1Ed0aq8jXzU9i9cq7xLvQ5yUk2v8vYw8k6r0a9s7FqZkR3m1nQp0bXcDg==\","
+    "\"interval\":5}";
+
+static const CHAR c_szNested[] =
+    " {\n  \"meta\" : { \"a\" : [1, -2.5e3, {\"b\": \"x\\\"}]\"}], \"c\": null },\n"
+    "  \"status\" : \"scanned\" , \"extra\" : true, \"flag\": false,\n  \"interval\" : 3\n}\r\n";
+
+static void CheckKnownResponses()
+{
+    QR_BACKEND_RESPONSE response;
+    bool fAgree;
+
+    HRESULT hr = ParseEverySplit("{\"status\":\"pending\",\"interval\":2}", &response, &fAgree);
+    Check(S_OK == hr && (QRJF_STATUS | QRJF_INTERVAL) == response.dwFieldsPresent &&
+          QRLS_PENDING == response.qrls && 2 == response.dwInterval, "pending response");
+    Check(fAgree, "pending response split at every byte");
+
+    hr = ParseEverySplit(c_szApproved, &response, &fAgree);
+    Check(S_OK == hr && (QRJF_STATUS | QRJF_TOKEN | QRJF_SIGNATURE | QRJF_INTERVAL) == response.dwFieldsPresent &&
+          QRLS_APPROVED == response.qrls && 5 == response.dwInterval &&
+          0 == strcmp(response.szToken, c_szToken) && 0 == strcmp(response.szSignature, c_szSignature),
+          "approved response");
+    Check(fAgree, "approved response split at every byte");
+
+    hr = ParseEverySplit(c_szNested, &response, &fAgree);
+    Check(S_OK == hr && (QRJF_STATUS | QRJF_INTERVAL) == response.dwFieldsPresent &&
+          QRLS_SCANNED == response.qrls && 3 == response.dwInterval, "unknown keys and nested values skipped");
+    Check(fAgree, "nested response split at every byte");
+
+    // Escaped keys are never known keys, so the escaped status is skipped.
+    hr = ParseEverySplit("{\"status\":\"\\u0064enied\",\"st\\u0061tus\":\"approved\",\"token\":\"a\\/b\\\\c\"}",
+                         &response, &fAgree);
+    Check(S_OK == hr && QRLS_DENIED == response.qrls && 0 == strcmp(response.szToken, "a/b\\c"),
+          "escapes in keys and values");
+    Check(fAgree, "escapes split at every byte");
+
+    hr = ParseString("{\"status\":\"exploded\"}", 0, &response);
+    Check(S_OK == hr && QRJF_STATUS == response.dwFieldsPresent && QRLS_UNKNOWN == response.qrls,
+          "unrecognized status is QRLS_UNKNOWN");
+
+    hr = ParseString("{}", 0, &response);
+    Check(S_OK == hr && 0 == response.dwFieldsPresent, "empty object");
+}
+
+static void CheckRejected()
+{
+    static const PCSTR c_rgpszMalformed[] =
+    {
+        "",
+        "[1]",
+        "{\"status\":}",
+        "{\"status\" \"pending\"}",
+        "{\"status\":\"pending\",}",
+        "{\"status\":\"pending\"",
+        "{\"status\":pending}",
+        "{\"status\":1}",
+        "{\"interval\":\"2\"}",
+        "{\"interval\":-}",
+        "{\"extra\":tru}",
+        "{\"extra\":[1,2}",
+        "{\"token\":\"\\q\"}",
+        "{\"token\":\"\\u12G4\"}",
+    };
+
+    bool fAllRejected = true;
+    for (DWORD i = 0; i < ARRAYSIZE(c_rgpszMalformed); i++)
+    {
+        QR_BACKEND_RESPONSE response;
+        if (HRESULT_FROM_WIN32(ERROR_INVALID_DATA) != ParseString(c_rgpszMalformed[i], 0, &response))
+        {
+            printf("      accepted: %s\n", c_rgpszMalformed[i]);
+            fAllRejected = false;
+        }
+    }
+    Check(fAllRejected, "malformed and truncated responses refused");
+
+    // A token that fills the field exactly fits; one more character does not.
+    CHAR szResponse[QR_JSON_TOKEN_CB + 32];
+    CHAR szToken[QR_JSON_TOKEN_CB + 1];
+    memset(szToken, 'A', sizeof(szToken) - 2);
+    szToken[QR_JSON_TOKEN_CB - 1] = '\0';
+    sprintf(szResponse, "{\"token\":\"%s\"}", szToken);
+    QR_BACKEND_RESPONSE response;
+    Check(S_OK == ParseString(szResponse, 7, &response) && 0 == strcmp(response.szToken, szToken),
+          "token of QR_JSON_TOKEN_CB - 1 characters accepted");
+
+    szToken[QR_JSON_TOKEN_CB - 1] = 'A';
+    szToken[QR_JSON_TOKEN_CB] = '\0';
+    sprintf(szResponse, "{\"token\":\"%s\"}", szToken);
+    Check(HRESULT_FROM_WIN32(ERROR_INVALID_DATA) == ParseString(szResponse, 7, &response),
+          "token of QR_JSON_TOKEN_CB characters refused");
+
+    // A Feed after the object is closed is an error, as is trailing garbage.
+    CQRJsonParser parser;
+    parser.Reset(&response);
+    HRESULT hr = parser.Feed((const BYTE*)"{} x", 4);
+    Check(HRESULT_FROM_WIN32(ERROR_INVALID_DATA) == hr, "data after the object refused");
+}
+
+// Small deterministic generator so a failure reproduces.
+static ULONG s_ulSeed = 0x2545F491;
+
+static ULONG NextRandom()
+{
+    s_ulSeed ^= s_ulSeed << 13;
+    s_ulSeed ^= s_ulSeed >> 17;
+    s_ulSeed ^= s_ulSeed << 5;
+    return s_ulSeed;
+}
+
+static void Fuzz()
+{
+    static const PCSTR c_rgpszSeeds[] = { c_szApproved, c_szNested, "{\"status\":\"expired\",\"interval\":60}" };
+    static const CHAR c_szInteresting[] = "{}[]\":,\\u0123456789-+.eEtrufalsn \t\r\n";
+
+    DWORD cAccepted = 0;
+    DWORD cDisagreed = 0;
+    for (DWORD iIteration = 0; iIteration < FUZZ_ITERATIONS; iIteration++)
+    {
+        BYTE rgb[512];
+        PCSTR pszSeed = c_rgpszSeeds[NextRandom() % ARRAYSIZE(c_rgpszSeeds)];
+        DWORD cb = (DWORD)strlen(pszSeed);
+        memcpy(rgb, pszSeed, cb);
+
+        DWORD cMutations = 1 + NextRandom() % 4;
+        for (DWORD i = 0; i < cMutations; i++)
+        {
+            DWORD ib = NextRandom() % cb;
+            switch (NextRandom() % 4)
+            {
+            case 0:
+                rgb[ib] = (BYTE)NextRandom();
+                break;
+            case 1:
+                rgb[ib] = c_szInteresting[NextRandom() % (ARRAYSIZE(c_szInteresting) - 1)];
+                break;
+            case 2:
+                if (cb > 1)
+                {
+                    memmove(rgb + ib, rgb + ib + 1, cb - ib - 1);
+                    cb--;
+                }
+                break;
+            default:
+                if (cb < sizeof(rgb))
+                {
+                    memmove(rgb + ib + 1, rgb + ib, cb - ib);
+                    rgb[ib] = c_szInteresting[NextRandom() % (ARRAYSIZE(c_szInteresting) - 1)];
+                    cb++;
+                }
+                break;
+            }
+        }
+
+        QR_BACKEND_RESPONSE responseWhole, responseBytes;
+        HRESULT hrWhole = Parse(rgb, cb, 0, &responseWhole);
+        HRESULT hrBytes = Parse(rgb, cb, 1, &responseBytes);
+        bool fValid = (S_OK == hrWhole) || (HRESULT_FROM_WIN32(ERROR_INVALID_DATA) == hrWhole);
+        if (!fValid || (hrWhole != hrBytes) || (SUCCEEDED(hrWhole) && !SameResponse(responseWhole, responseBytes)) ||
+            (responseWhole.szToken[QR_JSON_TOKEN_CB - 1] != '\0') ||
+            (responseWhole.szSignature[QR_JSON_SIGNATURE_CB - 1] != '\0'))
+        {
+            cDisagreed++;
+        }
+        if (S_OK == hrWhole)
+        {
+            cAccepted++;
+        }
+    }
+
+    printf("      %u mutants, %u accepted\n", FUZZ_ITERATIONS, cAccepted);
+    Check(0 == cDisagreed, "fuzzed responses parse the same whole and a byte at a time");
+}
+
+static void Benchmark()
+{
+    static const PCSTR c_rgpszResponses[] = { c_szApproved, c_szNested };
+    static const PCSTR c_rgpszNames[] = { "approved response", "nested response" };
+
+    for (DWORD i = 0; i < ARRAYSIZE(c_rgpszResponses); i++)
+    {
+        const BYTE* pb = (const BYTE*)c_rgpszResponses[i];
+        DWORD cb = (DWORD)strlen(c_rgpszResponses[i]);
+        QR_BACKEND_RESPONSE response;
+
+        LONG cAllocationsBefore = s_cAllocations;
+        LARGE_INTEGER liStart;
+        QueryPerformanceCounter(&liStart);
+        for (DWORD iIteration = 0; iIteration < BENCH_ITERATIONS; iIteration++)
+        {
+            Parse(pb, cb, 0, &response);
+        }
+        double dSeconds = ElapsedSeconds(liStart);
+        LONG cAllocations = s_cAllocations - cAllocationsBefore;
+
+        printf("      %s: %.1f MB/s, %.2f allocations per response\n", c_rgpszNames[i],
+               (double)cb * BENCH_ITERATIONS / dSeconds / 1e6, (double)cAllocations / BENCH_ITERATIONS);
+        Check(0 == cAllocations, "parsing allocates nothing");
+    }
+}
+
+int main()
+{
+    CheckKnownResponses();
+    CheckRejected();
+    Fuzz();
+    Benchmark();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
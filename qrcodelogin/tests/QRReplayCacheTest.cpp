@@ -0,0 +1,304 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Checks CQRReplayCache: a nonce is accepted once and refused for as long as
+// an approval carrying it could still be valid, expired and over-long
+// approvals are refused, and a cache overflowing into its filter still never
+// accepts a nonce twice.  Then several threads race to consume the same
+// nonces, which must each be accepted at most once, and distinct ones, which
+// must all be accepted.  Prints the filter's false positive rate at the
+// overflow load and consumes a second from one and several threads, and
+// returns nonzero if any check failed.
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include "QRReplayCache.h"
+#include "QRApproval.h"
+
+#define TEST_TTL            QR_APPROVAL_TTL_MAX
+#define TEST_NOW            1700000000ULL
+#define OVERFLOW_NONCES     (QR_REPLAY_EXACT_SLOTS + QR_REPLAY_EXACT_SLOTS / 2)
+#define RACE_THREADS        4
+#define RACE_NONCES         1000
+#define BENCH_NONCES        (QR_REPLAY_EXACT_SLOTS / 2)
+#define BENCH_ROUNDS        50
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, PCSTR pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static double ElapsedSeconds(const LARGE_INTEGER& liStart)
+{
+    LARGE_INTEGER liEnd, liFrequency;
+    QueryPerformanceCounter(&liEnd);
+    QueryPerformanceFrequency(&liFrequency);
+    return (double)(liEnd.QuadPart - liStart.QuadPart) / (double)liFrequency.QuadPart;
+}
+
+// Nonces are random on the wire; a counter run through a mixer stands in for
+// them reproducibly.  dwSpace keeps the sets used by different checks apart.
+static void MakeNonce(DWORD dwSpace, DWORD dwIndex, BYTE rgbNonce[QR_APPROVAL_NONCE_CB])
+{
+    ULONGLONG ull = ((ULONGLONG)dwSpace << 32) | dwIndex;
+    for (DWORD i = 0; i < QR_APPROVAL_NONCE_CB; i += sizeof(ull))
+    {
+        ull += 0x9E3779B97F4A7C15ULL;
+        ULONGLONG z = ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= z >> 31;
+        CopyMemory(rgbNonce + i, &z, sizeof(z));
+    }
+}
+
+static HRESULT Consume(CQRReplayCache* pCache, DWORD dwSpace, DWORD dwIndex, ULONGLONG ullExpiry, ULONGLONG ullNow)
+{
+    BYTE rgbNonce[QR_APPROVAL_NONCE_CB];
+    MakeNonce(dwSpace, dwIndex, rgbNonce);
+    return pCache->Consume(rgbNonce, sizeof(rgbNonce), ullExpiry, ullNow);
+}
+
+static void CheckLifetime()
+{
+    CQRReplayCache* pCache = new CQRReplayCache(TEST_TTL);
+
+    const ULONGLONG ullExpiry = TEST_NOW + TEST_TTL;
+    Check(S_OK == Consume(pCache, 1, 0, ullExpiry, TEST_NOW), "fresh nonce accepted");
+    Check(S_FALSE == Consume(pCache, 1, 0, ullExpiry, TEST_NOW), "same nonce refused");
+
+    // Replayed at every second the approval is still valid.
+    bool fRefused = true;
+    for (ULONGLONG ullNow = TEST_NOW; ullNow < ullExpiry; ullNow++)
+    {
+        fRefused = fRefused && (S_FALSE == Consume(pCache, 1, 0, ullExpiry, ullNow));
+    }
+    Check(fRefused, "replay refused until the approval expires");
+
+    Check(S_FALSE == Consume(pCache, 1, 1, TEST_NOW, TEST_NOW), "approval expiring now refused");
+    Check(S_FALSE == Consume(pCache, 1, 2, TEST_NOW + TEST_TTL + 1, TEST_NOW), "approval outliving the TTL refused");
+    Check(S_OK == Consume(pCache, 1, 3, TEST_NOW + 1, TEST_NOW), "approval expiring next second accepted");
+
+    // Threads read the clock separately, so a replay can arrive with an earlier
+    // time than the consume it repeats, here from the bucket before.
+    Check(S_OK == Consume(pCache, 1, 4, TEST_NOW + 120, TEST_NOW + 60), "nonce accepted by a thread whose clock is ahead");
+    Check(S_FALSE == Consume(pCache, 1, 4, TEST_NOW + 120, TEST_NOW), "replay from a thread whose clock is behind refused");
+
+    // Long after, the old entries have aged out and their slots are reused.
+    const ULONGLONG ullLater = TEST_NOW + 100 * TEST_TTL;
+    bool fAccepted = true;
+    for (DWORD i = 0; i < QR_REPLAY_EXACT_SLOTS / 2; i++)
+    {
+        fAccepted = fAccepted && (S_OK == Consume(pCache, 1, 100 + i, ullLater + TEST_TTL, ullLater));
+    }
+    Check(fAccepted, "expired slots reused without sweeping");
+
+    QR_REPLAY_CACHE_STATS stats;
+    pCache->GetStats(&stats);
+    Check((3 + QR_REPLAY_EXACT_SLOTS / 2 == stats.cConsumed) && (2 == stats.cExpired) &&
+          (2 + (ullExpiry - TEST_NOW) == (ULONGLONG)stats.cReplays), "stats count what happened");
+
+    delete pCache;
+}
+
+// More nonces in one TTL than the exact set has slots: the excess goes to the
+// filter, whose false positives refuse some fresh nonces, but nothing
+// accepted may ever be accepted again.
+static void CheckOverflow()
+{
+    CQRReplayCache* pCache = new CQRReplayCache(TEST_TTL);
+    const ULONGLONG ullExpiry = TEST_NOW + TEST_TTL;
+
+    BYTE* pfAccepted = new BYTE[OVERFLOW_NONCES];
+    DWORD cAccepted = 0;
+    for (DWORD i = 0; i < OVERFLOW_NONCES; i++)
+    {
+        pfAccepted[i] = (S_OK == Consume(pCache, 2, i, ullExpiry, TEST_NOW + (ULONGLONG)i * TEST_TTL / OVERFLOW_NONCES));
+        cAccepted += pfAccepted[i];
+    }
+
+    // Every nonce so far was fresh, so each one the filter refused is a false positive.
+    QR_REPLAY_CACHE_STATS stats;
+    pCache->GetStats(&stats);
+    printf("      %u nonces for %u exact slots: %u accepted, %lld to the filter, %lld saturated\n",
+           OVERFLOW_NONCES, QR_REPLAY_EXACT_SLOTS, cAccepted, stats.cFilterInserts, stats.cSaturated);
+    printf("      false positives: %lld fresh nonces refused by the filter (%.3f%%)\n",
+           stats.cFilterRejects, 100.0 * stats.cFilterRejects / OVERFLOW_NONCES);
+
+    bool fReplaysRefused = true;
+    for (DWORD i = 0; i < OVERFLOW_NONCES; i++)
+    {
+        if (pfAccepted[i])
+        {
+            fReplaysRefused = fReplaysRefused && (S_FALSE == Consume(pCache, 2, i, ullExpiry, TEST_NOW + TEST_TTL - 1));
+        }
+    }
+
+    Check(stats.cFilterInserts > 0, "overflow goes to the filter");
+    Check(stats.cFilterRejects * 1000 < OVERFLOW_NONCES, "filter refuses under 0.1% of fresh nonces");
+    Check(fReplaysRefused, "no accepted nonce accepted again after overflow");
+    Check(cAccepted + stats.cFilterRejects + stats.cSaturated == OVERFLOW_NONCES, "every fresh nonce accounted for");
+
+    delete[] pfAccepted;
+    delete pCache;
+}
+
+struct RACE_PARAMS
+{
+    CQRReplayCache* pCache;
+    HANDLE          hStart;
+    DWORD           iThread;
+    bool            fShared;        // All threads consume the same nonces, or each its own.
+    LONG*           rglAccepted;    // Per nonce, when shared.
+    DWORD           cAccepted;
+    double          dSeconds;
+};
+
+static DWORD WINAPI RaceThreadProc(LPVOID pv)
+{
+    RACE_PARAMS* pParams = (RACE_PARAMS*)pv;
+    WaitForSingleObject(pParams->hStart, INFINITE);
+
+    LARGE_INTEGER liStart;
+    QueryPerformanceCounter(&liStart);
+    for (DWORD n = 0; n < RACE_NONCES; n++)
+    {
+        // Shared nonces are walked in a different order by each thread so they collide all over.
+        DWORD i = pParams->fShared ? (n * (2 * pParams->iThread + 1)) % RACE_NONCES : n;
+        DWORD dwSpace = pParams->fShared ? 3 : 4 + pParams->iThread;
+        if (S_OK == Consume(pParams->pCache, dwSpace, i, TEST_NOW + TEST_TTL, TEST_NOW))
+        {
+            pParams->cAccepted++;
+            if (pParams->fShared)
+            {
+                InterlockedIncrement(&pParams->rglAccepted[i]);
+            }
+        }
+    }
+    pParams->dSeconds = ElapsedSeconds(liStart);
+    return 0;
+}
+
+static void Race(bool fShared)
+{
+    CQRReplayCache* pCache = new CQRReplayCache(TEST_TTL);
+    LONG* rglAccepted = new LONG[RACE_NONCES];
+    ZeroMemory(rglAccepted, RACE_NONCES * sizeof(LONG));
+    HANDLE hStart = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    RACE_PARAMS rgParams[RACE_THREADS];
+    HANDLE rghThreads[RACE_THREADS];
+    for (DWORD i = 0; i < RACE_THREADS; i++)
+    {
+        rgParams[i].pCache = pCache;
+        rgParams[i].hStart = hStart;
+        rgParams[i].iThread = i;
+        rgParams[i].fShared = fShared;
+        rgParams[i].rglAccepted = rglAccepted;
+        rgParams[i].cAccepted = 0;
+        rghThreads[i] = CreateThread(NULL, 0, RaceThreadProc, &rgParams[i], 0, NULL);
+    }
+    SetEvent(hStart);
+
+    DWORD cAccepted = 0;
+    for (DWORD i = 0; i < RACE_THREADS; i++)
+    {
+        WaitForSingleObject(rghThreads[i], INFINITE);
+        CloseHandle(rghThreads[i]);
+        cAccepted += rgParams[i].cAccepted;
+    }
+
+    if (fShared)
+    {
+        DWORD cTwice = 0;
+        for (DWORD i = 0; i < RACE_NONCES; i++)
+        {
+            cTwice += (rglAccepted[i] > 1);
+        }
+        printf("      %u threads racing for %u nonces: %u accepted\n", RACE_THREADS, RACE_NONCES, cAccepted);
+        Check(0 == cTwice, "no nonce accepted by two racing threads");
+        Check(cAccepted > RACE_NONCES * 99 / 100, "raced nonces are still accepted once");
+    }
+    else
+    {
+        Check(RACE_THREADS * RACE_NONCES == cAccepted, "distinct nonces from several threads all accepted");
+    }
+
+    CloseHandle(hStart);
+    delete[] rglAccepted;
+    delete pCache;
+}
+
+// Consumes a second at a steady half full exact set, the load an unattended
+// machine sees, first from one thread and then from several at once.
+static void Benchmark()
+{
+    CQRReplayCache* pCache = new CQRReplayCache(TEST_TTL);
+
+    LARGE_INTEGER liStart;
+    QueryPerformanceCounter(&liStart);
+    for (DWORD iRound = 0; iRound < BENCH_ROUNDS; iRound++)
+    {
+        // Each round is a fresh TTL, so the previous round's entries have expired.
+        const ULONGLONG ullNow = TEST_NOW + (ULONGLONG)iRound * 2 * TEST_TTL;
+        for (DWORD i = 0; i < BENCH_NONCES; i++)
+        {
+            Consume(pCache, 10 + iRound, i, ullNow + TEST_TTL, ullNow);
+        }
+    }
+    double dSingle = (double)BENCH_ROUNDS * BENCH_NONCES / ElapsedSeconds(liStart);
+    delete pCache;
+
+    pCache = new CQRReplayCache(TEST_TTL);
+    HANDLE hStart = CreateEvent(NULL, TRUE, FALSE, NULL);
+    RACE_PARAMS rgParams[RACE_THREADS];
+    HANDLE rghThreads[RACE_THREADS];
+    for (DWORD i = 0; i < RACE_THREADS; i++)
+    {
+        rgParams[i].pCache = pCache;
+        rgParams[i].hStart = hStart;
+        rgParams[i].iThread = i;
+        rgParams[i].fShared = false;
+        rgParams[i].rglAccepted = NULL;
+        rgParams[i].cAccepted = 0;
+        rghThreads[i] = CreateThread(NULL, 0, RaceThreadProc, &rgParams[i], 0, NULL);
+    }
+    SetEvent(hStart);
+    double dSlowest = 0;
+    for (DWORD i = 0; i < RACE_THREADS; i++)
+    {
+        WaitForSingleObject(rghThreads[i], INFINITE);
+        CloseHandle(rghThreads[i]);
+        if (rgParams[i].dSeconds > dSlowest)
+        {
+            dSlowest = rgParams[i].dSeconds;
+        }
+    }
+    double dParallel = (double)RACE_THREADS * RACE_NONCES / dSlowest;
+    CloseHandle(hStart);
+    delete pCache;
+
+    printf("\nconsumes/s: %.0f on one thread, %.0f on %u threads\n", dSingle, dParallel, RACE_THREADS);
+}
+
+int main()
+{
+    CheckLifetime();
+    CheckOverflow();
+    Race(true);
+    Race(false);
+    Benchmark();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
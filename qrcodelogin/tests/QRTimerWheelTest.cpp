@@ -0,0 +1,477 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Drives CQRTimerWheel with a virtual clock.  Timers placed on either side of
+// every level boundary, and past the top level's span, must fire on exactly
+// their tick whether the clock moves a tick at a time or jumps.  Cancelled
+// timers must never fire, and timers re-armed from their callbacks across
+// level boundaries must fire on time.  A random mix of schedules, moves,
+// cancels and advances, with callbacks that schedule and cancel other
+// timers, is checked against a simple model.  Then a million timers are
+// scheduled, half cancelled and the rest fired, and the time per operation
+// printed.  Prints a line per check and returns nonzero if any failed.
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "QRTimerWheel.h"
+
+#define TEST_START          1000003ULL
+#define LEVEL_SPAN(i)       (1ULL << (QR_TIMER_WHEEL_BITS * (i)))
+#define RANDOM_TIMERS       2000
+#define RANDOM_STEPS        200000
+#define REARM_COUNT         20
+#define BENCH_TIMERS        1000000
+#define BENCH_SPAN_TICKS    600000          // Ten minutes of milliseconds.
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, PCSTR pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+// Small deterministic generator so a failure reproduces.
+static ULONG s_ulSeed = 0x2545F491;
+
+static ULONG NextRandom()
+{
+    s_ulSeed ^= s_ulSeed << 13;
+    s_ulSeed ^= s_ulSeed >> 17;
+    s_ulSeed ^= s_ulSeed << 5;
+    return s_ulSeed;
+}
+
+static double ElapsedSeconds(const LARGE_INTEGER& liStart)
+{
+    LARGE_INTEGER liEnd, liFrequency;
+    QueryPerformanceCounter(&liEnd);
+    QueryPerformanceFrequency(&liFrequency);
+    return (double)(liEnd.QuadPart - liStart.QuadPart) / (double)liFrequency.QuadPart;
+}
+
+// A timer and what the model expects of it.
+struct TEST_TIMER
+{
+    QR_TIMER    timer;
+    uint64_t    ullDue;         // The tick it must fire on.
+    uint64_t    ullFired;       // The tick it did fire on, 0 if it has not.
+    bool        fPending;
+    DWORD       cFired;
+    DWORD       cRearm;         // Times left to re-arm itself from the callback.
+    uint64_t    ullRearmDelay;
+};
+
+static CQRTimerWheel* s_pWheel = NULL;
+static uint64_t s_ullLastFired = 0;
+static bool s_fInOrder = true;
+static bool s_fOnTime = true;
+
+// Arms pTest the way the model expects: a deadline already reached fires on
+// the next tick.
+static void ScheduleTest(CQRTimerWheel* pWheel, TEST_TIMER* pTest, uint64_t ullExpiry, PFN_QR_TIMER pfn)
+{
+    pWheel->Schedule(&pTest->timer, ullExpiry, pfn, pTest);
+    pTest->ullDue = (ullExpiry > pWheel->GetNow()) ? ullExpiry : pWheel->GetNow() + 1;
+    pTest->fPending = true;
+}
+
+static void CancelTest(CQRTimerWheel* pWheel, TEST_TIMER* pTest)
+{
+    pWheel->Cancel(&pTest->timer);
+    pTest->fPending = false;
+}
+
+static void OnFired(QR_TIMER* pTimer, void* pvContext)
+{
+    UNREFERENCED_PARAMETER(pTimer);
+    TEST_TIMER* pTest = (TEST_TIMER*)pvContext;
+    const uint64_t ullNow = s_pWheel->GetNow();
+
+    if (!pTest->fPending || (ullNow != pTest->ullDue) || CQRTimerWheel::IsPending(pTimer))
+    {
+        s_fOnTime = false;
+    }
+    if (ullNow < s_ullLastFired)
+    {
+        s_fInOrder = false;
+    }
+    s_ullLastFired = ullNow;
+    pTest->fPending = false;
+    pTest->ullFired = ullNow;
+    pTest->cFired++;
+
+    if (pTest->cRearm > 0)
+    {
+        pTest->cRearm--;
+        ScheduleTest(s_pWheel, pTest, ullNow + pTest->ullRearmDelay, OnFired);
+    }
+}
+
+// Schedules a timer on each side of every level boundary, and past the top
+// level's span, relative to the wheel's start and to ticks just short of a
+// boundary, and checks each fires on exactly its tick.
+static void CheckBoundaries(bool fTickByTick)
+{
+    const uint64_t rgullStart[] = { 0, TEST_START, LEVEL_SPAN(1) - 1, LEVEL_SPAN(2) - 2, LEVEL_SPAN(3) - 1 };
+    bool fAllFired = true;
+    bool fNoneEarly = true;
+
+    for (DWORD iStart = 0; iStart < ARRAYSIZE(rgullStart); iStart++)
+    {
+        CQRTimerWheel wheel(rgullStart[iStart]);
+        s_pWheel = &wheel;
+        s_ullLastFired = 0;
+
+        // Deadlines a level's span less one, exactly, and plus one ahead for
+        // every level, one a tick ahead, one beyond the top level's span, and
+        // one already past.
+        TEST_TIMER rgTest[3 * QR_TIMER_WHEEL_LEVELS + 3] = {};
+        DWORD cTest = 0;
+        uint64_t ullLast = 0;
+        for (DWORD iLevel = 1; iLevel <= QR_TIMER_WHEEL_LEVELS; iLevel++)
+        {
+            for (int iOffset = -1; iOffset <= 1; iOffset++)
+            {
+                ScheduleTest(&wheel, &rgTest[cTest++], rgullStart[iStart] + LEVEL_SPAN(iLevel) + iOffset, OnFired);
+            }
+        }
+        ScheduleTest(&wheel, &rgTest[cTest++], rgullStart[iStart] + 1, OnFired);
+        ScheduleTest(&wheel, &rgTest[cTest++], rgullStart[iStart] + 3 * LEVEL_SPAN(QR_TIMER_WHEEL_LEVELS) + 7, OnFired);
+        ScheduleTest(&wheel, &rgTest[cTest++], rgullStart[iStart] / 2, OnFired);
+        for (DWORD i = 0; i < cTest; i++)
+        {
+            ullLast = (rgTest[i].ullDue > ullLast) ? rgTest[i].ullDue : ullLast;
+        }
+
+        if (fTickByTick)
+        {
+            // Only worth doing tick by tick up to level 2; beyond that, step
+            // to each deadline, one tick short of it, and onto it.
+            for (uint64_t ull = rgullStart[iStart] + 1; ull <= rgullStart[iStart] + LEVEL_SPAN(2) + 2; ull++)
+            {
+                wheel.Advance(ull);
+            }
+            for (DWORD i = 0; i < cTest; i++)
+            {
+                wheel.Advance(rgTest[i].ullDue - 1);
+                for (DWORD j = 0; j < cTest; j++)
+                {
+                    if ((rgTest[j].cFired > 0) && (rgTest[j].ullFired > wheel.GetNow()))
+                    {
+                        fNoneEarly = false;
+                    }
+                }
+                wheel.Advance(rgTest[i].ullDue);
+            }
+        }
+        wheel.Advance(ullLast);
+
+        for (DWORD i = 0; i < cTest; i++)
+        {
+            if ((1 != rgTest[i].cFired) || (rgTest[i].ullFired != rgTest[i].ullDue))
+            {
+                fAllFired = false;
+            }
+        }
+        if (0 != wheel.Count())
+        {
+            fAllFired = false;
+        }
+    }
+
+    char szWhat[128];
+    sprintf(szWhat, "timers at level boundaries fire on their tick, clock %s", fTickByTick ? "stepping" : "jumping");
+    Check(fAllFired && fNoneEarly && s_fOnTime, szWhat);
+}
+
+// Cancels half the timers, a quarter while they wait in every level and a
+// quarter after cascades have moved them down, and checks none of them
+// fires and the rest fire once.
+static void CheckCancel()
+{
+    CQRTimerWheel wheel(TEST_START);
+    s_pWheel = &wheel;
+    s_ullLastFired = 0;
+
+    const DWORD cTest = 4 * QR_TIMER_WHEEL_SLOTS;
+    TEST_TIMER* rgTest = (TEST_TIMER*)calloc(cTest, sizeof(TEST_TIMER));
+    for (DWORD i = 0; i < cTest; i++)
+    {
+        // Spread over every level.
+        uint64_t ullDelay = 1 + ((uint64_t)i * i * i * 257) % (LEVEL_SPAN(QR_TIMER_WHEEL_LEVELS) / 2);
+        ScheduleTest(&wheel, &rgTest[i], TEST_START + ullDelay, OnFired);
+    }
+
+    bool fCount = (cTest == wheel.Count());
+    for (DWORD i = 0; i < cTest; i += 4)
+    {
+        CancelTest(&wheel, &rgTest[i]);
+    }
+    fCount = fCount && ((cTest - cTest / 4) == wheel.Count());
+
+    // Let the clock cross a few boundaries of each level, then cancel
+    // another quarter, which will by then have cascaded lower.
+    wheel.Advance(TEST_START + LEVEL_SPAN(3) + LEVEL_SPAN(2) + 3);
+    for (DWORD i = 2; i < cTest; i += 4)
+    {
+        CancelTest(&wheel, &rgTest[i]);
+    }
+    wheel.Cancel(&rgTest[2].timer);
+    wheel.Advance(TEST_START + LEVEL_SPAN(QR_TIMER_WHEEL_LEVELS));
+
+    bool fOk = fCount && (0 == wheel.Count());
+    for (DWORD i = 0; i < cTest; i++)
+    {
+        bool fCancelledBeforeDue = ((i % 4) == 0) || (((i % 4) == 2) && (rgTest[i].ullDue > TEST_START + LEVEL_SPAN(3) + LEVEL_SPAN(2) + 3));
+        if (fCancelledBeforeDue ? (0 != rgTest[i].cFired) : (1 != rgTest[i].cFired))
+        {
+            fOk = false;
+        }
+    }
+    free(rgTest);
+    Check(fOk && s_fOnTime, "cancelled timers never fire, the others fire once");
+}
+
+// Timers that re-arm themselves from their callbacks with delays that land on
+// and around level boundaries, and a pending timer moved across levels.
+static void CheckRearm()
+{
+    CQRTimerWheel wheel(TEST_START);
+    s_pWheel = &wheel;
+    s_ullLastFired = 0;
+
+    const uint64_t rgullDelay[] = { 1, LEVEL_SPAN(1) - 1, LEVEL_SPAN(1), LEVEL_SPAN(1) + 1, LEVEL_SPAN(2) - 1, LEVEL_SPAN(2),
+                                    LEVEL_SPAN(2) + 1, LEVEL_SPAN(3), 0 };
+    TEST_TIMER rgTest[ARRAYSIZE(rgullDelay)] = {};
+    uint64_t ullLast = 0;
+    for (DWORD i = 0; i < ARRAYSIZE(rgullDelay); i++)
+    {
+        rgTest[i].cRearm = REARM_COUNT;
+        rgTest[i].ullRearmDelay = rgullDelay[i];
+        ScheduleTest(&wheel, &rgTest[i], TEST_START + 1 + i, OnFired);
+        uint64_t ullEnd = TEST_START + 1 + i + REARM_COUNT * ((rgullDelay[i] > 0) ? rgullDelay[i] : 1);
+        ullLast = (ullEnd > ullLast) ? ullEnd : ullLast;
+    }
+
+    // A timer moved from level 3 down to level 0 and back up.
+    TEST_TIMER moved = {};
+    ScheduleTest(&wheel, &moved, TEST_START + LEVEL_SPAN(3) + 5, OnFired);
+    ScheduleTest(&wheel, &moved, TEST_START + 9, OnFired);
+    ScheduleTest(&wheel, &moved, TEST_START + LEVEL_SPAN(2) + LEVEL_SPAN(1), OnFired);
+    bool fMovedCount = (ARRAYSIZE(rgullDelay) + 1 == wheel.Count());
+
+    // Step in uneven strides so some advances stop just short of a boundary.
+    for (uint64_t ull = TEST_START; ull < ullLast; ull += 1 + (NextRandom() % (2 * LEVEL_SPAN(1))))
+    {
+        wheel.Advance(ull);
+    }
+    wheel.Advance(ullLast);
+
+    bool fOk = fMovedCount && (1 == moved.cFired) && (0 == wheel.Count());
+    for (DWORD i = 0; i < ARRAYSIZE(rgullDelay); i++)
+    {
+        if (REARM_COUNT + 1 != rgTest[i].cFired)
+        {
+            fOk = false;
+        }
+    }
+    Check(fOk && s_fOnTime && s_fInOrder, "timers re-armed from their callbacks across level boundaries fire on time");
+}
+
+// Random mix against the model.  Callbacks of some timers schedule or cancel
+// another timer, and the model follows them.
+static TEST_TIMER* s_rgRandom = NULL;
+
+static void OnRandomFired(QR_TIMER* pTimer, void* pvContext)
+{
+    OnFired(pTimer, pvContext);
+
+    const uint64_t ullNow = s_pWheel->GetNow();
+    DWORD iOther = NextRandom() % RANDOM_TIMERS;
+    switch (NextRandom() % 4)
+    {
+    case 0:
+        ScheduleTest(s_pWheel, &s_rgRandom[iOther], ullNow + (NextRandom() % LEVEL_SPAN(2)), OnRandomFired);
+        break;
+    case 1:
+        CancelTest(s_pWheel, &s_rgRandom[iOther]);
+        break;
+    default:
+        break;
+    }
+}
+
+static uint64_t RandomDelay()
+{
+    // Mostly short, as real deadlines are, with some in every level.
+    switch (NextRandom() % 8)
+    {
+    case 0:
+        return 0;
+    case 1:
+        return NextRandom() % LEVEL_SPAN(QR_TIMER_WHEEL_LEVELS);
+    case 2:
+    case 3:
+        return NextRandom() % LEVEL_SPAN(2);
+    default:
+        return NextRandom() % LEVEL_SPAN(1);
+    }
+}
+
+static void CheckRandom()
+{
+    uint64_t ullNow = TEST_START;
+    CQRTimerWheel wheel(ullNow);
+    s_pWheel = &wheel;
+    s_ullLastFired = 0;
+    s_rgRandom = (TEST_TIMER*)calloc(RANDOM_TIMERS, sizeof(TEST_TIMER));
+
+    bool fModel = true;
+    bool fNextExpiry = true;
+    for (DWORD iStep = 0; iStep < RANDOM_STEPS; iStep++)
+    {
+        TEST_TIMER* pTest = &s_rgRandom[NextRandom() % RANDOM_TIMERS];
+        switch (NextRandom() % 8)
+        {
+        case 0:
+        case 1:
+        case 2:
+            ScheduleTest(&wheel, pTest, ullNow + RandomDelay(), OnRandomFired);
+            break;
+        case 3:
+            // Deadlines already reached fire on the next tick.
+            ScheduleTest(&wheel, pTest, ullNow - (NextRandom() % 3), OnRandomFired);
+            break;
+        case 4:
+            CancelTest(&wheel, pTest);
+            break;
+        default:
+        {
+            // Mostly small steps, sometimes straight to the next deadline or a
+            // long way past it.
+            uint64_t ullNext = wheel.GetNextExpiry();
+            ULONG ulKind = NextRandom() % 16;
+            uint64_t ullTo = (0 == ulKind) ? ullNow + (NextRandom() % LEVEL_SPAN(3))
+                           : ((1 == ulKind) && (UINT64_MAX != ullNext)) ? ullNext
+                           : ullNow + (NextRandom() % 64);
+            s_ullLastFired = 0;
+            wheel.Advance(ullTo);
+            ullNow = (ullTo > ullNow) ? ullTo : ullNow;
+            break;
+        }
+        }
+
+        // Nothing due is left behind, the count matches, and the next expiry
+        // is never later than the earliest deadline.
+        size_t cPending = 0;
+        uint64_t ullEarliest = UINT64_MAX;
+        for (DWORD i = 0; i < RANDOM_TIMERS; i++)
+        {
+            if (s_rgRandom[i].fPending)
+            {
+                cPending++;
+                ullEarliest = (s_rgRandom[i].ullDue < ullEarliest) ? s_rgRandom[i].ullDue : ullEarliest;
+                if ((s_rgRandom[i].ullDue <= wheel.GetNow()) || !CQRTimerWheel::IsPending(&s_rgRandom[i].timer))
+                {
+                    fModel = false;
+                }
+            }
+        }
+        if ((cPending != wheel.Count()) || (wheel.GetNow() != ullNow))
+        {
+            fModel = false;
+        }
+        if (wheel.GetNextExpiry() > ullEarliest)
+        {
+            fNextExpiry = false;
+        }
+        if (!fModel || !fNextExpiry || !s_fOnTime)
+        {
+            printf("      diverged from the model at step %u, tick %llu\n", iStep, (unsigned long long)ullNow);
+            break;
+        }
+    }
+    free(s_rgRandom);
+    s_rgRandom = NULL;
+
+    char szWhat[128];
+    sprintf(szWhat, "%u random operations on %u timers match the model", RANDOM_STEPS, RANDOM_TIMERS);
+    Check(fModel && s_fOnTime && s_fInOrder, szWhat);
+    Check(fNextExpiry, "GetNextExpiry is never later than the earliest deadline");
+}
+
+static void OnBenchFired(QR_TIMER* pTimer, void* pvContext)
+{
+    UNREFERENCED_PARAMETER(pTimer);
+    (*(size_t*)pvContext)++;
+}
+
+// A million timers spread over ten minutes of milliseconds.
+static void Bench()
+{
+    QR_TIMER* rgTimer = (QR_TIMER*)calloc(BENCH_TIMERS, sizeof(QR_TIMER));
+    uint64_t* rgullDue = (uint64_t*)malloc(BENCH_TIMERS * sizeof(uint64_t));
+    for (DWORD i = 0; i < BENCH_TIMERS; i++)
+    {
+        rgullDue[i] = TEST_START + 1 + NextRandom() % BENCH_SPAN_TICKS;
+    }
+
+    CQRTimerWheel wheel(TEST_START);
+    size_t cFired = 0;
+
+    LARGE_INTEGER liStart;
+    QueryPerformanceCounter(&liStart);
+    for (DWORD i = 0; i < BENCH_TIMERS; i++)
+    {
+        wheel.Schedule(&rgTimer[i], rgullDue[i], OnBenchFired, &cFired);
+    }
+    double dSchedule = ElapsedSeconds(liStart);
+
+    QueryPerformanceCounter(&liStart);
+    for (DWORD i = 0; i < BENCH_TIMERS; i += 2)
+    {
+        wheel.Cancel(&rgTimer[i]);
+    }
+    double dCancel = ElapsedSeconds(liStart);
+
+    // A millisecond at a time, as the timer thread would see it under load.
+    QueryPerformanceCounter(&liStart);
+    for (uint64_t ull = TEST_START + 1; ull <= TEST_START + BENCH_SPAN_TICKS; ull++)
+    {
+        wheel.Advance(ull);
+    }
+    double dFire = ElapsedSeconds(liStart);
+
+    char szWhat[128];
+    sprintf(szWhat, "%u timers scheduled, half cancelled, the rest all fired", BENCH_TIMERS);
+    Check((BENCH_TIMERS / 2 == cFired) && (0 == wheel.Count()), szWhat);
+    printf("      schedule %.1f ns, cancel %.1f ns, fire %.1f ns a timer; %u ticks advanced in %.1f ms\n",
+           dSchedule * 1e9 / BENCH_TIMERS, dCancel * 1e9 / (BENCH_TIMERS / 2), dFire * 1e9 / (BENCH_TIMERS / 2),
+           BENCH_SPAN_TICKS, dFire * 1e3);
+
+    free(rgullDue);
+    free(rgTimer);
+}
+
+int main()
+{
+    CheckBoundaries(false);
+    CheckBoundaries(true);
+    CheckCancel();
+    CheckRearm();
+    CheckRandom();
+    Bench();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
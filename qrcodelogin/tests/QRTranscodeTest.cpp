@@ -0,0 +1,414 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Checks the transcoder against a plain one code point at a time reference
+// on random ASCII, mixed and supplementary text, with and without
+// percent-encoding and at every length and alignment the SSE2 blocks can
+// see, checks that malformed input in either direction is refused and that
+// short buffers fail rather than overrun, then times both directions against
+// the reference on ASCII and mixed text.  Prints a line per check and
+// returns nonzero if any failed.
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include "QRTranscode.h"
+
+#define MAX_TEXT_CCH        300
+#define RANDOM_ITERATIONS   20000
+#define BENCH_CCH           4096
+#define BENCH_ITERATIONS    20000
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, PCSTR pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static double ElapsedSeconds(const LARGE_INTEGER& liStart)
+{
+    LARGE_INTEGER liEnd, liFrequency;
+    QueryPerformanceCounter(&liEnd);
+    QueryPerformanceFrequency(&liFrequency);
+    return (double)(liEnd.QuadPart - liStart.QuadPart) / (double)liFrequency.QuadPart;
+}
+
+// Small deterministic generator so a failure reproduces.
+static ULONG s_ulSeed = 0x9E3779B9;
+
+static ULONG NextRandom()
+{
+    s_ulSeed ^= s_ulSeed << 13;
+    s_ulSeed ^= s_ulSeed >> 17;
+    s_ulSeed ^= s_ulSeed << 5;
+    return s_ulSeed;
+}
+
+// The reference: decode one code point, encode it, escape each byte.  Returns
+// the byte count, or -1 on an unpaired surrogate.
+static int ReferenceUtf16ToUtf8(const WCHAR* pwz, DWORD cch, bool fPercentEncode, BYTE* pb)
+{
+    static const char c_rgchHex[] = "0123456789ABCDEF";
+    int cb = 0;
+    for (DWORD i = 0; i < cch; i++)
+    {
+        DWORD dwChar = pwz[i];
+        if (dwChar >= 0xDC00 && dwChar <= 0xDFFF)
+        {
+            return -1;
+        }
+        if (dwChar >= 0xD800 && dwChar <= 0xDBFF)
+        {
+            if ((i + 1 == cch) || (pwz[i + 1] < 0xDC00) || (pwz[i + 1] > 0xDFFF))
+            {
+                return -1;
+            }
+            dwChar = 0x10000 + ((dwChar - 0xD800) << 10) + (pwz[++i] - 0xDC00);
+        }
+
+        BYTE rgb[4];
+        int cbChar;
+        if (dwChar < 0x80)
+        {
+            rgb[0] = (BYTE)dwChar;
+            cbChar = 1;
+        }
+        else if (dwChar < 0x800)
+        {
+            rgb[0] = (BYTE)(0xC0 | (dwChar >> 6));
+            rgb[1] = (BYTE)(0x80 | (dwChar & 0x3F));
+            cbChar = 2;
+        }
+        else if (dwChar < 0x10000)
+        {
+            rgb[0] = (BYTE)(0xE0 | (dwChar >> 12));
+            rgb[1] = (BYTE)(0x80 | ((dwChar >> 6) & 0x3F));
+            rgb[2] = (BYTE)(0x80 | (dwChar & 0x3F));
+            cbChar = 3;
+        }
+        else
+        {
+            rgb[0] = (BYTE)(0xF0 | (dwChar >> 18));
+            rgb[1] = (BYTE)(0x80 | ((dwChar >> 12) & 0x3F));
+            rgb[2] = (BYTE)(0x80 | ((dwChar >> 6) & 0x3F));
+            rgb[3] = (BYTE)(0x80 | (dwChar & 0x3F));
+            cbChar = 4;
+        }
+
+        for (int j = 0; j < cbChar; j++)
+        {
+            BYTE b = rgb[j];
+            bool fUnreserved = (b >= 'A' && b <= 'Z') || (b >= 'a' && b <= 'z') || (b >= '0' && b <= '9') ||
+                               ('-' == b) || ('.' == b) || ('_' == b) || ('~' == b);
+            if (fPercentEncode && !fUnreserved)
+            {
+                pb[cb++] = '%';
+                pb[cb++] = c_rgchHex[b >> 4];
+                pb[cb++] = c_rgchHex[b & 0xF];
+            }
+            else
+            {
+                pb[cb++] = b;
+            }
+        }
+    }
+    return cb;
+}
+
+enum TEXT_KIND
+{
+    TK_UNRESERVED,      // Letters and digits only: every SSE2 block takes the fast path.
+    TK_ASCII,           // Any ASCII, so percent-encoding breaks blocks up.
+    TK_MIXED,           // Mostly ASCII with Latin, CJK and the odd surrogate pair.
+    TK_WIDE,            // No ASCII at all.
+};
+
+static DWORD RandomText(TEXT_KIND tk, DWORD cchMax, WCHAR* pwz)
+{
+    static const CHAR c_szUnreserved[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-._~";
+    DWORD cch = 0;
+    while (cch < cchMax)
+    {
+        DWORD dwKind = NextRandom() % 16;
+        if ((TK_UNRESERVED == tk) || ((TK_MIXED == tk) && (dwKind < 10)))
+        {
+            pwz[cch++] = c_szUnreserved[NextRandom() % (ARRAYSIZE(c_szUnreserved) - 1)];
+        }
+        else if ((TK_ASCII == tk) || ((TK_MIXED == tk) && (dwKind < 12)))
+        {
+            pwz[cch++] = (WCHAR)(NextRandom() % 0x80);
+        }
+        else if (dwKind < 13)
+        {
+            pwz[cch++] = (WCHAR)(0x80 + NextRandom() % 0x780);
+        }
+        else if ((dwKind < 15) || (cch + 2 > cchMax))
+        {
+            WCHAR wch = (WCHAR)(0x800 + NextRandom() % 0xF800);
+            pwz[cch++] = (wch >= 0xD800 && wch <= 0xDFFF) ? 0x4E2D : wch;
+        }
+        else
+        {
+            DWORD dwChar = NextRandom() % 0x100000;
+            pwz[cch++] = (WCHAR)(0xD800 + (dwChar >> 10));
+            pwz[cch++] = (WCHAR)(0xDC00 + (dwChar & 0x3FF));
+        }
+    }
+    return cch;
+}
+
+// Converts pwz both ways with every flag and compares with the reference.
+static bool MatchesReference(const WCHAR* pwz, DWORD cch)
+{
+    for (DWORD dwFlags = 0; dwFlags <= QRTF_PERCENT_ENCODE; dwFlags += QRTF_PERCENT_ENCODE)
+    {
+        BYTE rgbExpected[MAX_TEXT_CCH * 12];
+        int cbExpected = ReferenceUtf16ToUtf8(pwz, cch, (0 != dwFlags), rgbExpected);
+
+        DWORD cbLength;
+        HRESULT hr = Utf16ToUtf8Length(pwz, cch, dwFlags, &cbLength);
+        if (cbExpected < 0)
+        {
+            if (HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION) != hr)
+            {
+                return false;
+            }
+            continue;
+        }
+        if (FAILED(hr) || (cbLength != (DWORD)cbExpected))
+        {
+            return false;
+        }
+
+        // The converter must write exactly the reference and nothing past it.
+        BYTE rgb[MAX_TEXT_CCH * 12 + 1];
+        memset(rgb, 0xCC, sizeof(rgb));
+        DWORD cbWritten;
+        hr = Utf16ToUtf8(pwz, cch, dwFlags, rgb, cbLength, &cbWritten);
+        if (FAILED(hr) || (cbWritten != cbLength) || (0 != memcmp(rgb, rgbExpected, cbLength)) || (0xCC != rgb[cbLength]))
+        {
+            return false;
+        }
+
+        if (0 == dwFlags)
+        {
+            DWORD cchBack;
+            WCHAR rgwchBack[MAX_TEXT_CCH + 1];
+            rgwchBack[cch] = 0xCCCC;
+            hr = Utf8ToUtf16Length(rgb, cbWritten, &cchBack);
+            if (FAILED(hr) || (cchBack != cch))
+            {
+                return false;
+            }
+            hr = Utf8ToUtf16(rgb, cbWritten, rgwchBack, cch, &cchBack);
+            if (FAILED(hr) || (cchBack != cch) || (0 != memcmp(rgwchBack, pwz, cch * sizeof(WCHAR))) ||
+                (0xCCCC != rgwchBack[cch]))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void CheckAgainstReference()
+{
+    static const PCSTR c_rgpszKinds[] = { "unreserved", "ASCII", "mixed", "non-ASCII" };
+
+    for (DWORD tk = TK_UNRESERVED; tk <= TK_WIDE; tk++)
+    {
+        bool fMatched = true;
+        for (DWORD iIteration = 0; (iIteration < RANDOM_ITERATIONS) && fMatched; iIteration++)
+        {
+            // Offset the start so the blocks see every alignment.
+            WCHAR rgwch[MAX_TEXT_CCH + 8];
+            DWORD ich = iIteration % 8;
+            DWORD cch = RandomText((TEXT_KIND)tk, iIteration % MAX_TEXT_CCH, rgwch + ich);
+            fMatched = MatchesReference(rgwch + ich, cch);
+            if (!fMatched)
+            {
+                printf("      mismatch at iteration %u, %u code units\n", iIteration, cch);
+            }
+        }
+
+        CHAR szWhat[80];
+        sprintf(szWhat, "%s text matches the reference both ways", c_rgpszKinds[tk]);
+        Check(fMatched, szWhat);
+    }
+
+    // A surrogate pair straddling the end of an eight unit block.
+    WCHAR rgwch[17];
+    for (DWORD i = 0; i < ARRAYSIZE(rgwch); i++)
+    {
+        rgwch[i] = 'a';
+    }
+    rgwch[7] = 0xD83D;
+    rgwch[8] = 0xDE00;
+    Check(MatchesReference(rgwch, ARRAYSIZE(rgwch)), "surrogate pair across a block boundary");
+}
+
+static void CheckMalformed()
+{
+    // Lone and reversed surrogates, at the start, in the middle of a block and at the end.
+    static const WCHAR c_rgwchLow[] = { 'a', 'b', 'c', 0xDC00, 'd', 'e', 'f', 'g', 'h' };
+    static const WCHAR c_rgwchHigh[] = { 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 0xD800 };
+    static const WCHAR c_rgwchReversed[] = { 0xDC00, 0xD800 };
+    DWORD cb;
+    const HRESULT hrBad = HRESULT_FROM_WIN32(ERROR_NO_UNICODE_TRANSLATION);
+    Check(hrBad == Utf16ToUtf8Length(c_rgwchLow, ARRAYSIZE(c_rgwchLow), 0, &cb) &&
+          hrBad == Utf16ToUtf8Length(c_rgwchHigh, ARRAYSIZE(c_rgwchHigh), QRTF_PERCENT_ENCODE, &cb) &&
+          hrBad == Utf16ToUtf8Length(c_rgwchReversed, ARRAYSIZE(c_rgwchReversed), 0, &cb),
+          "unpaired UTF-16 surrogates refused");
+
+    static const struct
+    {
+        PCSTR   psz;
+        PCSTR   pszWhat;
+    } c_rgMalformed[] =
+    {
+        { "\x80",                   "lone continuation byte" },
+        { "abc\xC3",                "truncated sequence" },
+        { "\xC3\x28",               "bad continuation byte" },
+        { "\xC0\xAF",               "overlong two byte form" },
+        { "\xE0\x80\xAF",           "overlong three byte form" },
+        { "\xF0\x80\x80\xAF",       "overlong four byte form" },
+        { "\xED\xA0\x80",           "encoded surrogate" },
+        { "\xF4\x90\x80\x80",       "code point past U+10FFFF" },
+        { "\xF8\x88\x80\x80\x80",   "five byte form" },
+        { "0123456789abcdef\xFF",   "invalid byte after an ASCII block" },
+    };
+
+    bool fAllRefused = true;
+    for (DWORD i = 0; i < ARRAYSIZE(c_rgMalformed); i++)
+    {
+        DWORD cch;
+        WCHAR rgwch[32];
+        const BYTE* pb = (const BYTE*)c_rgMalformed[i].psz;
+        DWORD cbMalformed = (DWORD)strlen(c_rgMalformed[i].psz);
+        if ((hrBad != Utf8ToUtf16Length(pb, cbMalformed, &cch)) ||
+            (hrBad != Utf8ToUtf16(pb, cbMalformed, rgwch, ARRAYSIZE(rgwch), &cch)))
+        {
+            printf("      accepted: %s\n", c_rgMalformed[i].pszWhat);
+            fAllRefused = false;
+        }
+    }
+    Check(fAllRefused, "malformed UTF-8 refused");
+}
+
+static void CheckShortBuffers()
+{
+    WCHAR rgwch[64];
+    DWORD cch = RandomText(TK_MIXED, ARRAYSIZE(rgwch), rgwch);
+
+    bool fRefused = true;
+    for (DWORD dwFlags = 0; dwFlags <= QRTF_PERCENT_ENCODE; dwFlags += QRTF_PERCENT_ENCODE)
+    {
+        DWORD cbNeeded;
+        Utf16ToUtf8Length(rgwch, cch, dwFlags, &cbNeeded);
+        for (DWORD cb = 0; cb < cbNeeded; cb++)
+        {
+            BYTE rgb[ARRAYSIZE(rgwch) * 12 + 1];
+            memset(rgb, 0xCC, sizeof(rgb));
+            DWORD cbWritten;
+            HRESULT hr = Utf16ToUtf8(rgwch, cch, dwFlags, rgb, cb, &cbWritten);
+            if ((HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER) != hr) || (0xCC != rgb[cb]))
+            {
+                fRefused = false;
+            }
+        }
+    }
+    Check(fRefused, "UTF-8 output shorter than the length refused without overrun");
+
+    BYTE rgb[ARRAYSIZE(rgwch) * 4];
+    DWORD cb;
+    Utf16ToUtf8(rgwch, cch, 0, rgb, sizeof(rgb), &cb);
+    fRefused = true;
+    for (DWORD cchShort = 0; cchShort < cch; cchShort++)
+    {
+        WCHAR rgwchBack[ARRAYSIZE(rgwch) + 1];
+        rgwchBack[cchShort] = 0xCCCC;
+        DWORD cchWritten;
+        HRESULT hr = Utf8ToUtf16(rgb, cb, rgwchBack, cchShort, &cchWritten);
+        if ((HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER) != hr) || (0xCCCC != rgwchBack[cchShort]))
+        {
+            fRefused = false;
+        }
+    }
+    Check(fRefused, "UTF-16 output shorter than the length refused without overrun");
+
+    PSTR psz;
+    DWORD cbAlloc;
+    HRESULT hr = Utf16ToUtf8CoAlloc(L"a b/\x00E9", QRTF_PERCENT_ENCODE, &psz, &cbAlloc);
+    Check(SUCCEEDED(hr) && (0 == strcmp(psz, "a%20b%2F%C3%A9")) && (14 == cbAlloc), "Utf16ToUtf8CoAlloc percent-encodes");
+    if (SUCCEEDED(hr))
+    {
+        CoTaskMemFree(psz);
+    }
+}
+
+static void Benchmark()
+{
+    static const PCSTR c_rgpszKinds[] = { "unreserved", "ASCII", "mixed", "non-ASCII" };
+    static WCHAR s_rgwch[BENCH_CCH];
+    static BYTE s_rgb[BENCH_CCH * 12];
+    static WCHAR s_rgwchBack[BENCH_CCH];
+
+    printf("\n%-11s %-9s %12s %12s %8s\n", "text", "direction", "MB/s", "reference", "speedup");
+    for (DWORD tk = TK_UNRESERVED; tk <= TK_WIDE; tk++)
+    {
+        DWORD cch = RandomText((TEXT_KIND)tk, BENCH_CCH, s_rgwch);
+        for (DWORD dwFlags = 0; dwFlags <= QRTF_PERCENT_ENCODE; dwFlags += QRTF_PERCENT_ENCODE)
+        {
+            // One conversion into a buffer known to be big enough, like the reference.
+            LARGE_INTEGER liStart;
+            QueryPerformanceCounter(&liStart);
+            DWORD cb;
+            for (DWORD i = 0; i < BENCH_ITERATIONS; i++)
+            {
+                Utf16ToUtf8(s_rgwch, cch, dwFlags, s_rgb, sizeof(s_rgb), &cb);
+            }
+            double dSeconds = ElapsedSeconds(liStart);
+
+            QueryPerformanceCounter(&liStart);
+            for (DWORD i = 0; i < BENCH_ITERATIONS; i++)
+            {
+                ReferenceUtf16ToUtf8(s_rgwch, cch, (0 != dwFlags), s_rgb);
+            }
+            double dReferenceSeconds = ElapsedSeconds(liStart);
+
+            double dMB = (double)cch * sizeof(WCHAR) * BENCH_ITERATIONS / 1e6;
+            printf("%-11s %-9s %12.0f %12.0f %7.1fx\n", c_rgpszKinds[tk], dwFlags ? "to %UTF8" : "to UTF-8",
+                   dMB / dSeconds, dMB / dReferenceSeconds, dReferenceSeconds / dSeconds);
+        }
+
+        DWORD cb;
+        Utf16ToUtf8(s_rgwch, cch, 0, s_rgb, sizeof(s_rgb), &cb);
+        LARGE_INTEGER liStart;
+        QueryPerformanceCounter(&liStart);
+        for (DWORD i = 0; i < BENCH_ITERATIONS; i++)
+        {
+            DWORD cchBack;
+            Utf8ToUtf16(s_rgb, cb, s_rgwchBack, ARRAYSIZE(s_rgwchBack), &cchBack);
+        }
+        printf("%-11s %-9s %12.0f\n", c_rgpszKinds[tk], "to UTF-16", (double)cb * BENCH_ITERATIONS / 1e6 / ElapsedSeconds(liStart));
+    }
+}
+
+int main()
+{
+    CheckAgainstReference();
+    CheckMalformed();
+    CheckShortBuffers();
+    Benchmark();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
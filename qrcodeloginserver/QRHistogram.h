@@ -0,0 +1,128 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRHistogram records latencies in microseconds into log-linear buckets:
+// each power of two is split into 16 linear sub-buckets, so any percentile
+// is reported to within about 6%.  Recording is a shift and an increment, so
+// every request can be recorded.  Each load generator thread owns one and
+// they are merged when the run ends.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define QR_HISTOGRAM_SUB_BITS   4
+#define QR_HISTOGRAM_SUB        (1 << QR_HISTOGRAM_SUB_BITS)
+#define QR_HISTOGRAM_BUCKETS    (64 * QR_HISTOGRAM_SUB)
+
+class CQRHistogram
+{
+  public:
+    CQRHistogram()
+    {
+        Reset();
+    }
+
+    void Reset()
+    {
+        memset(_rgcBucket, 0, sizeof(_rgcBucket));
+        _cTotal = 0;
+        _ullMax = 0;
+    }
+
+    void Record(uint64_t ullMicroseconds)
+    {
+        _rgcBucket[_BucketOf(ullMicroseconds)]++;
+        _cTotal++;
+        if (ullMicroseconds > _ullMax)
+        {
+            _ullMax = ullMicroseconds;
+        }
+    }
+
+    void Merge(const CQRHistogram& other)
+    {
+        for (int i = 0; i < QR_HISTOGRAM_BUCKETS; i++)
+        {
+            _rgcBucket[i] += other._rgcBucket[i];
+        }
+        _cTotal += other._cTotal;
+        if (other._ullMax > _ullMax)
+        {
+            _ullMax = other._ullMax;
+        }
+    }
+
+    uint64_t Count() const
+    {
+        return _cTotal;
+    }
+
+    uint64_t Max() const
+    {
+        return _ullMax;
+    }
+
+    // Returns the upper bound of the bucket holding the dPercentile'th value.
+    uint64_t Percentile(double dPercentile) const
+    {
+        if (0 == _cTotal)
+        {
+            return 0;
+        }
+
+        uint64_t cRank = (uint64_t)(dPercentile / 100.0 * (double)_cTotal + 0.5);
+        if (cRank < 1)
+        {
+            cRank = 1;
+        }
+
+        uint64_t cSeen = 0;
+        for (int i = 0; i < QR_HISTOGRAM_BUCKETS; i++)
+        {
+            cSeen += _rgcBucket[i];
+            if (cSeen >= cRank)
+            {
+                uint64_t ullUpper = _UpperBoundOf(i);
+                return (ullUpper < _ullMax) ? ullUpper : _ullMax;
+            }
+        }
+        return _ullMax;
+    }
+
+  private:
+    // Values below QR_HISTOGRAM_SUB get a bucket each; above that, the top
+    // QR_HISTOGRAM_SUB_BITS + 1 bits select the bucket.
+    static int _BucketOf(uint64_t ull)
+    {
+        if (ull < QR_HISTOGRAM_SUB)
+        {
+            return (int)ull;
+        }
+        int iMsb = 63 - __builtin_clzll(ull);
+        int iShift = iMsb - QR_HISTOGRAM_SUB_BITS;
+        return ((iShift + 1) << QR_HISTOGRAM_SUB_BITS) + (int)((ull >> iShift) & (QR_HISTOGRAM_SUB - 1));
+    }
+
+    static uint64_t _UpperBoundOf(int iBucket)
+    {
+        if (iBucket < QR_HISTOGRAM_SUB)
+        {
+            return (uint64_t)iBucket;
+        }
+        int iShift = (iBucket >> QR_HISTOGRAM_SUB_BITS) - 1;
+        uint64_t ullSub = (uint64_t)(iBucket & (QR_HISTOGRAM_SUB - 1)) | QR_HISTOGRAM_SUB;
+        return ((ullSub + 1) << iShift) - 1;
+    }
+
+  private:
+    uint64_t    _rgcBucket[QR_HISTOGRAM_BUCKETS];
+    uint64_t    _cTotal;
+    uint64_t    _ullMax;
+};
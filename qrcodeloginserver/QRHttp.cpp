@@ -0,0 +1,278 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "QRHttp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+bool QR_SPAN::Equals(const char* pszOther) const
+{
+    return (strlen(pszOther) == cch) && (0 == memcmp(psz, pszOther, cch));
+}
+
+static bool SpanEqualsNoCase(const char* psz, size_t cch, const char* pszOther)
+{
+    return (strlen(pszOther) == cch) && (0 == strncasecmp(psz, pszOther, cch));
+}
+
+// Finds the blank line that ends the head.
+static long FindHeadEnd(const char* pb, size_t cb)
+{
+    const size_t cbScan = (cb < QR_HTTP_HEAD_CB_MAX) ? cb : QR_HTTP_HEAD_CB_MAX;
+    for (size_t i = 3; i < cbScan; i++)
+    {
+        if (('\n' == pb[i]) && ('\r' == pb[i - 1]) && ('\n' == pb[i - 2]) && ('\r' == pb[i - 3]))
+        {
+            return (long)(i + 1);
+        }
+    }
+    return (cb >= QR_HTTP_HEAD_CB_MAX) ? -1 : 0;
+}
+
+// Walks the header lines after the start line, picking out the two headers
+// that matter here.  fKeepAlive comes in as the protocol default.
+static bool ParseHeaders(const char* pb, const char* pbEnd, size_t* pcbBody, bool* pfKeepAlive)
+{
+    *pcbBody = 0;
+    while (pb < pbEnd)
+    {
+        const char* pbEol = (const char*)memchr(pb, '\r', pbEnd - pb);
+        if (!pbEol)
+        {
+            return false;
+        }
+        if (pbEol == pb)
+        {
+            break;
+        }
+
+        const char* pbColon = (const char*)memchr(pb, ':', pbEol - pb);
+        if (pbColon)
+        {
+            const char* pbValue = pbColon + 1;
+            while ((pbValue < pbEol) && (' ' == *pbValue))
+            {
+                pbValue++;
+            }
+
+            if (SpanEqualsNoCase(pb, pbColon - pb, "Content-Length"))
+            {
+                char* pszEnd;
+                unsigned long ul = strtoul(pbValue, &pszEnd, 10);
+                if ((pszEnd != pbEol) || (ul > QR_HTTP_HEAD_CB_MAX))
+                {
+                    return false;
+                }
+                *pcbBody = ul;
+            }
+            else if (SpanEqualsNoCase(pb, pbColon - pb, "Connection"))
+            {
+                if (SpanEqualsNoCase(pbValue, pbEol - pbValue, "close"))
+                {
+                    *pfKeepAlive = false;
+                }
+                else if (SpanEqualsNoCase(pbValue, pbEol - pbValue, "keep-alive"))
+                {
+                    *pfKeepAlive = true;
+                }
+            }
+        }
+        pb = pbEol + 2;
+    }
+    return true;
+}
+
+long ParseHttpRequest(const char* pb, size_t cb, QR_HTTP_REQUEST* pRequest)
+{
+    long cbHead = FindHeadEnd(pb, cb);
+    if (cbHead <= 0)
+    {
+        return cbHead;
+    }
+
+    const char* pbEnd = pb + cbHead;
+    const char* pbEol = (const char*)memchr(pb, '\r', cbHead);
+    const char* pbSp1 = (const char*)memchr(pb, ' ', pbEol - pb);
+    const char* pbSp2 = pbSp1 ? (const char*)memchr(pbSp1 + 1, ' ', pbEol - pbSp1 - 1) : NULL;
+    if (!pbSp2 || (pbEol - pbSp2 != 9) || (0 != memcmp(pbSp2 + 1, "HTTP/1.", 7)))
+    {
+        return -1;
+    }
+
+    pRequest->method.psz = pb;
+    pRequest->method.cch = pbSp1 - pb;
+
+    const char* pbTarget = pbSp1 + 1;
+    const char* pbQuery = (const char*)memchr(pbTarget, '?', pbSp2 - pbTarget);
+    pRequest->path.psz = pbTarget;
+    pRequest->path.cch = (pbQuery ? pbQuery : pbSp2) - pbTarget;
+    pRequest->query.psz = pbQuery ? pbQuery + 1 : pbSp2;
+    pRequest->query.cch = pbQuery ? (pbSp2 - pbQuery - 1) : 0;
+
+    pRequest->body.psz = pbEnd;
+    pRequest->body.cch = 0;
+    pRequest->fKeepAlive = ('1' == pbSp2[8]);
+    if (!ParseHeaders(pbEol + 2, pbEnd, &pRequest->cbBody, &pRequest->fKeepAlive))
+    {
+        return -1;
+    }
+    return cbHead;
+}
+
+long ParseHttpResponse(const char* pb, size_t cb, QR_HTTP_RESPONSE* pResponse)
+{
+    long cbHead = FindHeadEnd(pb, cb);
+    if (cbHead <= 0)
+    {
+        return cbHead;
+    }
+
+    // "HTTP/1.1 200 ..."
+    if ((cbHead < 16) || (0 != memcmp(pb, "HTTP/1.", 7)) || (' ' != pb[8]))
+    {
+        return -1;
+    }
+    pResponse->iStatus = atoi(pb + 9);
+    pResponse->cbHead = cbHead;
+    pResponse->fKeepAlive = ('1' == pb[7]);
+
+    const char* pbEol = (const char*)memchr(pb, '\r', cbHead);
+    if (!ParseHeaders(pbEol + 2, pb + cbHead, &pResponse->cbBody, &pResponse->fKeepAlive))
+    {
+        return -1;
+    }
+    return cbHead;
+}
+
+static int HexDigit(char ch)
+{
+    if ((ch >= '0') && (ch <= '9'))
+    {
+        return ch - '0';
+    }
+    if ((ch >= 'a') && (ch <= 'f'))
+    {
+        return ch - 'a' + 10;
+    }
+    if ((ch >= 'A') && (ch <= 'F'))
+    {
+        return ch - 'A' + 10;
+    }
+    return -1;
+}
+
+bool GetQueryParam(const QR_SPAN& query, const char* pszName, std::string* pstrValue)
+{
+    const size_t cchName = strlen(pszName);
+    const char* pb = query.psz;
+    const char* pbEnd = query.psz + query.cch;
+
+    while (pb < pbEnd)
+    {
+        const char* pbAmp = (const char*)memchr(pb, '&', pbEnd - pb);
+        const char* pbParamEnd = pbAmp ? pbAmp : pbEnd;
+
+        if ((pbParamEnd - pb > (long)cchName) && ('=' == pb[cchName]) && (0 == memcmp(pb, pszName, cchName)))
+        {
+            pstrValue->clear();
+            for (const char* pbValue = pb + cchName + 1; pbValue < pbParamEnd; pbValue++)
+            {
+                if (('%' == *pbValue) && (pbParamEnd - pbValue >= 3))
+                {
+                    int iHi = HexDigit(pbValue[1]);
+                    int iLo = HexDigit(pbValue[2]);
+                    if ((iHi < 0) || (iLo < 0))
+                    {
+                        return false;
+                    }
+                    pstrValue->push_back((char)((iHi << 4) | iLo));
+                    pbValue += 2;
+                }
+                else
+                {
+                    pstrValue->push_back(('+' == *pbValue) ? ' ' : *pbValue);
+                }
+            }
+            return true;
+        }
+        pb = pbParamEnd + 1;
+    }
+    return false;
+}
+
+bool HexDecode(const char* psz, size_t cch, uint8_t* pb, size_t cb)
+{
+    if (cch != 2 * cb)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < cb; i++)
+    {
+        int iHi = HexDigit(psz[2 * i]);
+        int iLo = HexDigit(psz[2 * i + 1]);
+        if ((iHi < 0) || (iLo < 0))
+        {
+            return false;
+        }
+        pb[i] = (uint8_t)((iHi << 4) | iLo);
+    }
+    return true;
+}
+
+void HexEncode(const uint8_t* pb, size_t cb, char* psz)
+{
+    static const char c_szHex[] = "0123456789abcdef";
+    for (size_t i = 0; i < cb; i++)
+    {
+        psz[2 * i] = c_szHex[pb[i] >> 4];
+        psz[2 * i + 1] = c_szHex[pb[i] & 0xF];
+    }
+    psz[2 * cb] = '\0';
+}
+
+static const char* ReasonPhrase(int iStatus)
+{
+    switch (iStatus)
+    {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 431: return "Request Header Fields Too Large";
+    case 503: return "Service Unavailable";
+    default:  return "Error";
+    }
+}
+
+void AppendHttpResponse(
+    std::string* pstrOut,
+    int iStatus,
+    const char* pszContentType,
+    const char* pbBody,
+    size_t cbBody,
+    bool fKeepAlive
+    )
+{
+    char szHead[256];
+    int cchHead = snprintf(szHead, sizeof(szHead),
+                           "HTTP/1.1 %d %s\r\n"
+                           "Content-Type: %s\r\n"
+                           "Content-Length: %zu\r\n"
+                           "Cache-Control: no-store\r\n"
+                           "%s"
+                           "\r\n",
+                           iStatus, ReasonPhrase(iStatus), pszContentType, cbBody,
+                           fKeepAlive ? "" : "Connection: close\r\n");
+    pstrOut->append(szHead, cchHead);
+    pstrOut->append(pbBody, cbBody);
+}
@@ -0,0 +1,69 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Just enough HTTP/1.1 for the QR login endpoints and the load generator:
+// request and response heads are parsed in place from a connection's input
+// buffer, bodies are delimited by Content-Length only (no chunked encoding),
+// and keep-alive and pipelining are supported.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Heads larger than this are rejected.
+#define QR_HTTP_HEAD_CB_MAX     8192
+
+// A run of bytes inside a connection's input buffer.
+struct QR_SPAN
+{
+    const char* psz;
+    size_t      cch;
+
+    bool Equals(const char* pszOther) const;
+};
+
+struct QR_HTTP_REQUEST
+{
+    QR_SPAN     method;
+    QR_SPAN     path;
+    QR_SPAN     query;          // Without the '?'; empty if there is none.
+    QR_SPAN     body;           // Set by the caller once the whole body has arrived.
+    size_t      cbBody;
+    bool        fKeepAlive;
+};
+
+struct QR_HTTP_RESPONSE
+{
+    int         iStatus;
+    size_t      cbHead;
+    size_t      cbBody;
+    bool        fKeepAlive;
+};
+
+// Each returns the length of the head (body not included) once it is
+// complete, 0 if more input is needed, and -1 if the input is not valid HTTP
+// or the head is too large.
+long ParseHttpRequest(const char* pb, size_t cb, QR_HTTP_REQUEST* pRequest);
+long ParseHttpResponse(const char* pb, size_t cb, QR_HTTP_RESPONSE* pResponse);
+
+// Finds query parameter pszName and percent-decodes its value into pstrValue.
+bool GetQueryParam(const QR_SPAN& query, const char* pszName, std::string* pstrValue);
+
+// Decodes exactly cb bytes from 2 * cb hex digits.
+bool HexDecode(const char* psz, size_t cch, uint8_t* pb, size_t cb);
+void HexEncode(const uint8_t* pb, size_t cb, char* psz);
+
+// Appends a complete response with a Content-Length header.
+void AppendHttpResponse(std::string* pstrOut,
+                        int iStatus,
+                        const char* pszContentType,
+                        const char* pbBody,
+                        size_t cbBody,
+                        bool fKeepAlive);
@@ -0,0 +1,760 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "QRLoadGen.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <deque>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "QRHistogram.h"
+#include "QRHttp.h"
+#include "QRSigner.h"
+
+#define QR_LOAD_EPOLL_EVENTS    256
+#define QR_LOAD_READ_CB         4096
+#define QR_LOAD_WAIT_SECONDS    30
+
+static uint64_t GetMonotonicUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct QR_LOAD_RESULT
+{
+    CQRHistogram    histRequest;
+    CQRHistogram    histPush;
+    uint64_t        cRequests;
+    uint64_t        cLogins;
+    uint64_t        cErrors;
+};
+
+// One worker thread: a share of the kiosks, a pool of phone connections and
+// an epoll loop that drives them all.
+class CQRLoadWorker
+{
+  public:
+    CQRLoadWorker(const QR_LOAD_OPTIONS& options,
+                  const struct sockaddr_in& addrServer,
+                  int iWorker,
+                  int cKiosks,
+                  std::atomic<bool>* pfMeasuring,
+                  std::atomic<bool>* pfStop);
+    ~CQRLoadWorker();
+
+    void Run();
+
+    const QR_LOAD_RESULT& Result() const
+    {
+        return _result;
+    }
+
+  private:
+    enum CONN_KIND
+    {
+        CK_KIOSK,
+        CK_PHONE,
+    };
+
+    // What a connection's outstanding request is, so its response can be
+    // routed.  Every connection has at most one request in flight.
+    enum REQUEST_KIND
+    {
+        RK_NONE,
+        RK_REGISTER,        // Kiosk: first status poll, creates the session.
+        RK_WAIT,            // Kiosk: long poll or interval poll.
+        RK_SCAN,            // Phone: opened the QR code.
+        RK_APPROVE,         // Phone: approved.
+    };
+
+    struct CLIENT_CONN
+    {
+        CONN_KIND       kind;
+        int             index;
+        int             fd;
+        bool            fConnected;
+        REQUEST_KIND    rk;
+        uint64_t        ullSentUs;
+        std::string     strOut;
+        size_t          cbOutSent;
+        std::string     strIn;
+    };
+
+    struct KIOSK
+    {
+        CLIENT_CONN     conn;
+        uint8_t         rgbNonce[QR_NONCE_CB];
+        char            szNonce[2 * QR_NONCE_CB + 1];
+        uint32_t        uSession;           // Bumped per session; stale timers and phones are ignored.
+        uint64_t        ullApproveSentUs;   // 0 until the phone approves.
+    };
+
+    struct PHONE
+    {
+        CLIENT_CONN     conn;
+        int             iKiosk;             // Session being approved, -1 if idle.
+        uint32_t        uSession;
+    };
+
+    struct APPROVAL
+    {
+        int             iKiosk;
+        uint32_t        uSession;
+    };
+
+    enum TIMER_KIND
+    {
+        TK_START,           // Start a kiosk session.
+        TK_PHONE,           // Think time is over; queue the phone.
+        TK_POLL,            // Interval poll is due.
+    };
+
+    struct TIMER
+    {
+        uint64_t    ullDueUs;
+        int         iKiosk;
+        uint32_t    uSession;
+        TIMER_KIND  kind;
+
+        bool operator>(const TIMER& other) const
+        {
+            return ullDueUs > other.ullDueUs;
+        }
+    };
+
+    void _Connect(CLIENT_CONN* pConn);
+    void _Disconnect(CLIENT_CONN* pConn);
+    void _Send(CLIENT_CONN* pConn, REQUEST_KIND rk, const char* pszMethod, const char* pszPathAndQuery);
+    void _Flush(CLIENT_CONN* pConn);
+    void _OnReadable(CLIENT_CONN* pConn);
+    void _OnResponse(CLIENT_CONN* pConn, int iStatus, const char* pbBody, size_t cbBody);
+    void _OnError(CLIENT_CONN* pConn);
+
+    void _StartSession(int iKiosk);
+    void _SendWait(int iKiosk);
+    void _DispatchPhones();
+    void _AddTimer(uint64_t ullDueUs, int iKiosk, TIMER_KIND kind);
+    void _RestartKiosk(int iKiosk);
+    void _RunTimers(uint64_t ullNowUs);
+
+    void _RecordRequest(uint64_t ullSentUs, uint64_t ullNowUs);
+
+  private:
+    const QR_LOAD_OPTIONS&                                          _options;
+    struct sockaddr_in                                              _addrServer;
+    int                                                             _iWorker;
+    int                                                             _epfd;
+    std::vector<KIOSK>                                              _rgKiosk;
+    std::vector<PHONE>                                              _rgPhone;
+    std::deque<APPROVAL>                                            _pendingApprovals;
+    std::priority_queue<TIMER, std::vector<TIMER>, std::greater<TIMER> > _timers;
+    std::mt19937_64                                                 _rng;
+    std::atomic<bool>*                                              _pfMeasuring;
+    std::atomic<bool>*                                              _pfStop;
+    bool                                                            _fMeasuring;
+    QR_LOAD_RESULT                                                  _result;
+};
+
+CQRLoadWorker::CQRLoadWorker(
+    const QR_LOAD_OPTIONS& options,
+    const struct sockaddr_in& addrServer,
+    int iWorker,
+    int cKiosks,
+    std::atomic<bool>* pfMeasuring,
+    std::atomic<bool>* pfStop
+    ):
+    _options(options),
+    _addrServer(addrServer),
+    _iWorker(iWorker),
+    _epfd(epoll_create1(EPOLL_CLOEXEC)),
+    _rgKiosk(cKiosks),
+    _rgPhone(options.cPhonesPerThread),
+    _rng(GetMonotonicUs() ^ ((uint64_t)iWorker << 48)),
+    _pfMeasuring(pfMeasuring),
+    _pfStop(pfStop),
+    _fMeasuring(false)
+{
+    _result.cRequests = 0;
+    _result.cLogins = 0;
+    _result.cErrors = 0;
+
+    for (size_t i = 0; i < _rgKiosk.size(); i++)
+    {
+        _rgKiosk[i].conn.kind = CK_KIOSK;
+        _rgKiosk[i].conn.index = (int)i;
+        _rgKiosk[i].conn.fd = -1;
+        _rgKiosk[i].conn.fConnected = false;
+        _rgKiosk[i].conn.rk = RK_NONE;
+        _rgKiosk[i].conn.cbOutSent = 0;
+        _rgKiosk[i].uSession = 0;
+        _rgKiosk[i].ullApproveSentUs = 0;
+    }
+    for (size_t i = 0; i < _rgPhone.size(); i++)
+    {
+        _rgPhone[i].conn.kind = CK_PHONE;
+        _rgPhone[i].conn.index = (int)i;
+        _rgPhone[i].conn.fd = -1;
+        _rgPhone[i].conn.fConnected = false;
+        _rgPhone[i].conn.rk = RK_NONE;
+        _rgPhone[i].conn.cbOutSent = 0;
+        _rgPhone[i].iKiosk = -1;
+        _rgPhone[i].uSession = 0;
+    }
+}
+
+CQRLoadWorker::~CQRLoadWorker()
+{
+    for (size_t i = 0; i < _rgKiosk.size(); i++)
+    {
+        _Disconnect(&_rgKiosk[i].conn);
+    }
+    for (size_t i = 0; i < _rgPhone.size(); i++)
+    {
+        _Disconnect(&_rgPhone[i].conn);
+    }
+    close(_epfd);
+}
+
+void CQRLoadWorker::_Connect(CLIENT_CONN* pConn)
+{
+    pConn->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (pConn->fd < 0)
+    {
+        return;
+    }
+
+    int iOn = 1;
+    setsockopt(pConn->fd, IPPROTO_TCP, TCP_NODELAY, &iOn, sizeof(iOn));
+
+    // One source address only has ~28k ephemeral ports per server port;
+    // spread connections over several loopback addresses to go beyond that.
+    if (_options.cSources > 0)
+    {
+        setsockopt(pConn->fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &iOn, sizeof(iOn));
+        struct sockaddr_in addrLocal;
+        memset(&addrLocal, 0, sizeof(addrLocal));
+        addrLocal.sin_family = AF_INET;
+        addrLocal.sin_addr.s_addr = htonl(0x7F000002 + (uint32_t)(_rng() % _options.cSources));
+        bind(pConn->fd, (struct sockaddr*)&addrLocal, sizeof(addrLocal));
+    }
+
+    pConn->fConnected = false;
+    pConn->strIn.clear();
+    if ((0 != connect(pConn->fd, (struct sockaddr*)&_addrServer, sizeof(_addrServer))) && (EINPROGRESS != errno))
+    {
+        close(pConn->fd);
+        pConn->fd = -1;
+        return;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = pConn;
+    epoll_ctl(_epfd, EPOLL_CTL_ADD, pConn->fd, &ev);
+}
+
+void CQRLoadWorker::_Disconnect(CLIENT_CONN* pConn)
+{
+    if (pConn->fd >= 0)
+    {
+        close(pConn->fd);
+        pConn->fd = -1;
+    }
+    pConn->fConnected = false;
+    pConn->rk = RK_NONE;
+    pConn->strOut.clear();
+    pConn->cbOutSent = 0;
+    pConn->strIn.clear();
+}
+
+// Queues a request and sends what the socket takes.  Connects first if
+// needed; the request goes out once the connection is established.
+void CQRLoadWorker::_Send(CLIENT_CONN* pConn, REQUEST_KIND rk, const char* pszMethod, const char* pszPathAndQuery)
+{
+    if (pConn->fd < 0)
+    {
+        _Connect(pConn);
+        if (pConn->fd < 0)
+        {
+            _OnError(pConn);
+            return;
+        }
+    }
+
+    char szRequest[512];
+    int cch = snprintf(szRequest, sizeof(szRequest),
+                       "%s %s HTTP/1.1\r\nHost: qrcodelogin\r\n%s\r\n",
+                       pszMethod, pszPathAndQuery,
+                       (0 == strcmp(pszMethod, "POST")) ? "Content-Length: 0\r\n" : "");
+    pConn->strOut.append(szRequest, cch);
+    pConn->rk = rk;
+    pConn->ullSentUs = GetMonotonicUs();
+    if (pConn->fConnected)
+    {
+        _Flush(pConn);
+    }
+}
+
+void CQRLoadWorker::_Flush(CLIENT_CONN* pConn)
+{
+    while (pConn->cbOutSent < pConn->strOut.size())
+    {
+        ssize_t cb = send(pConn->fd, pConn->strOut.data() + pConn->cbOutSent, pConn->strOut.size() - pConn->cbOutSent, MSG_NOSIGNAL);
+        if (cb > 0)
+        {
+            pConn->cbOutSent += cb;
+        }
+        else if ((cb < 0) && (EAGAIN == errno))
+        {
+            return;
+        }
+        else if ((cb < 0) && (EINTR == errno))
+        {
+            continue;
+        }
+        else
+        {
+            _OnError(pConn);
+            return;
+        }
+    }
+    pConn->strOut.clear();
+    pConn->cbOutSent = 0;
+}
+
+void CQRLoadWorker::_OnReadable(CLIENT_CONN* pConn)
+{
+    char rgb[QR_LOAD_READ_CB];
+    for (;;)
+    {
+        ssize_t cb = read(pConn->fd, rgb, sizeof(rgb));
+        if (cb > 0)
+        {
+            pConn->strIn.append(rgb, cb);
+        }
+        else if ((cb < 0) && (EAGAIN == errno))
+        {
+            break;
+        }
+        else if ((cb < 0) && (EINTR == errno))
+        {
+            continue;
+        }
+        else
+        {
+            _OnError(pConn);
+            return;
+        }
+    }
+
+    QR_HTTP_RESPONSE response;
+    long cbHead = ParseHttpResponse(pConn->strIn.data(), pConn->strIn.size(), &response);
+    if (cbHead < 0)
+    {
+        _OnError(pConn);
+    }
+    else if ((cbHead > 0) && (pConn->strIn.size() >= cbHead + response.cbBody))
+    {
+        std::string strBody(pConn->strIn, cbHead, response.cbBody);
+        pConn->strIn.erase(0, cbHead + response.cbBody);
+        if (!response.fKeepAlive)
+        {
+            _Disconnect(pConn);
+        }
+        _OnResponse(pConn, response.iStatus, strBody.data(), strBody.size());
+    }
+}
+
+void CQRLoadWorker::_RecordRequest(uint64_t ullSentUs, uint64_t ullNowUs)
+{
+    if (_fMeasuring)
+    {
+        _result.histRequest.Record(ullNowUs - ullSentUs);
+        _result.cRequests++;
+    }
+}
+
+void CQRLoadWorker::_OnResponse(CLIENT_CONN* pConn, int iStatus, const char* pbBody, size_t cbBody)
+{
+    const uint64_t ullNowUs = GetMonotonicUs();
+    const REQUEST_KIND rk = pConn->rk;
+    pConn->rk = RK_NONE;
+
+    if (200 != iStatus)
+    {
+        _OnError(pConn);
+        return;
+    }
+
+    std::string strBody(pbBody, cbBody);
+    if (CK_KIOSK == pConn->kind)
+    {
+        KIOSK& kiosk = _rgKiosk[pConn->index];
+        const bool fApproved = (std::string::npos != strBody.find("\"status\":\"approved\""));
+        const bool fOpen = (std::string::npos != strBody.find("\"status\":\"pending\"")) ||
+                           (std::string::npos != strBody.find("\"status\":\"scanned\""));
+
+        if ((RK_REGISTER == rk) || (0 != _options.cPollMs))
+        {
+            _RecordRequest(pConn->ullSentUs, ullNowUs);
+        }
+        else if (_fMeasuring)
+        {
+            _result.cRequests++;
+        }
+
+        if (fApproved)
+        {
+            if (_fMeasuring && kiosk.ullApproveSentUs)
+            {
+                _result.histPush.Record(ullNowUs - kiosk.ullApproveSentUs);
+                _result.cLogins++;
+            }
+            _StartSession(pConn->index);
+        }
+        else if (!fOpen)
+        {
+            _OnError(pConn);
+        }
+        else if (RK_REGISTER == rk)
+        {
+            // The session exists now; the phone may scan it.
+            std::exponential_distribution<double> think(1.0 / (_options.cThinkMs > 0 ? _options.cThinkMs : 1));
+            _AddTimer(ullNowUs + (uint64_t)(think(_rng) * 1000), pConn->index, TK_PHONE);
+            _SendWait(pConn->index);
+        }
+        else if (0 != _options.cPollMs)
+        {
+            _AddTimer(ullNowUs + (uint64_t)_options.cPollMs * 1000, pConn->index, TK_POLL);
+        }
+        else
+        {
+            _SendWait(pConn->index);
+        }
+    }
+    else
+    {
+        PHONE& phone = _rgPhone[pConn->index];
+        _RecordRequest(pConn->ullSentUs, ullNowUs);
+        if ((RK_SCAN == rk) && (phone.uSession == _rgKiosk[phone.iKiosk].uSession))
+        {
+            KIOSK& kiosk = _rgKiosk[phone.iKiosk];
+            char szPath[160];
+            snprintf(szPath, sizeof(szPath), "/qrcode/approve?n=%s&u=user%d_%d", kiosk.szNonce, _iWorker, phone.iKiosk);
+            kiosk.ullApproveSentUs = GetMonotonicUs();
+            _Send(pConn, RK_APPROVE, "POST", szPath);
+        }
+        else
+        {
+            phone.iKiosk = -1;
+            _DispatchPhones();
+        }
+    }
+}
+
+// A failed request restarts whatever it belonged to: a kiosk starts a new
+// session on a new connection, a phone drops the approval it was working on
+// (its kiosk will time out and restart).
+void CQRLoadWorker::_OnError(CLIENT_CONN* pConn)
+{
+    if (_fMeasuring)
+    {
+        _result.cErrors++;
+    }
+    _Disconnect(pConn);
+
+    if (CK_KIOSK == pConn->kind)
+    {
+        _RestartKiosk(pConn->index);
+    }
+    else
+    {
+        // Give the kiosk a fresh session rather than leaving it waiting for an
+        // approval that will not come.
+        PHONE& phone = _rgPhone[pConn->index];
+        if ((phone.iKiosk >= 0) && (phone.uSession == _rgKiosk[phone.iKiosk].uSession))
+        {
+            _Disconnect(&_rgKiosk[phone.iKiosk].conn);
+            _RestartKiosk(phone.iKiosk);
+        }
+        phone.iKiosk = -1;
+        _DispatchPhones();
+    }
+}
+
+void CQRLoadWorker::_RestartKiosk(int iKiosk)
+{
+    _AddTimer(GetMonotonicUs() + 100000, iKiosk, TK_START);
+}
+
+void CQRLoadWorker::_StartSession(int iKiosk)
+{
+    KIOSK& kiosk = _rgKiosk[iKiosk];
+    for (size_t i = 0; i < sizeof(kiosk.rgbNonce); i += 8)
+    {
+        uint64_t ull = _rng();
+        memcpy(kiosk.rgbNonce + i, &ull, 8);
+    }
+    HexEncode(kiosk.rgbNonce, sizeof(kiosk.rgbNonce), kiosk.szNonce);
+    kiosk.uSession++;
+    kiosk.ullApproveSentUs = 0;
+
+    char szPath[128];
+    snprintf(szPath, sizeof(szPath), "/qrcode/status?n=%s", kiosk.szNonce);
+    _Send(&kiosk.conn, RK_REGISTER, "GET", szPath);
+}
+
+void CQRLoadWorker::_SendWait(int iKiosk)
+{
+    KIOSK& kiosk = _rgKiosk[iKiosk];
+    char szPath[160];
+    if (0 == _options.cPollMs)
+    {
+        snprintf(szPath, sizeof(szPath), "/qrcode/status?n=%s&wait=%d", kiosk.szNonce, QR_LOAD_WAIT_SECONDS);
+    }
+    else
+    {
+        snprintf(szPath, sizeof(szPath), "/qrcode/status?n=%s", kiosk.szNonce);
+    }
+    _Send(&kiosk.conn, RK_WAIT, "GET", szPath);
+}
+
+// Hands queued approvals to idle phone connections, skipping any whose
+// kiosk has moved on to another session.
+void CQRLoadWorker::_DispatchPhones()
+{
+    for (size_t i = 0; (i < _rgPhone.size()) && !_pendingApprovals.empty(); i++)
+    {
+        PHONE& phone = _rgPhone[i];
+        while ((phone.iKiosk < 0) && !_pendingApprovals.empty())
+        {
+            const APPROVAL approval = _pendingApprovals.front();
+            _pendingApprovals.pop_front();
+            if (approval.uSession == _rgKiosk[approval.iKiosk].uSession)
+            {
+                phone.iKiosk = approval.iKiosk;
+                phone.uSession = approval.uSession;
+
+                char szPath[128];
+                snprintf(szPath, sizeof(szPath), "/qrcode/?n=%s", _rgKiosk[phone.iKiosk].szNonce);
+                _Send(&phone.conn, RK_SCAN, "GET", szPath);
+            }
+        }
+    }
+}
+
+void CQRLoadWorker::_AddTimer(uint64_t ullDueUs, int iKiosk, TIMER_KIND kind)
+{
+    TIMER timer;
+    timer.ullDueUs = ullDueUs;
+    timer.iKiosk = iKiosk;
+    timer.uSession = _rgKiosk[iKiosk].uSession;
+    timer.kind = kind;
+    _timers.push(timer);
+}
+
+void CQRLoadWorker::_RunTimers(uint64_t ullNowUs)
+{
+    bool fPhones = false;
+    while (!_timers.empty() && (_timers.top().ullDueUs <= ullNowUs))
+    {
+        TIMER timer = _timers.top();
+        _timers.pop();
+        if (timer.uSession != _rgKiosk[timer.iKiosk].uSession)
+        {
+            continue;
+        }
+
+        switch (timer.kind)
+        {
+        case TK_START:
+            _StartSession(timer.iKiosk);
+            break;
+        case TK_PHONE:
+            {
+                APPROVAL approval;
+                approval.iKiosk = timer.iKiosk;
+                approval.uSession = timer.uSession;
+                _pendingApprovals.push_back(approval);
+                fPhones = true;
+            }
+            break;
+        case TK_POLL:
+            _SendWait(timer.iKiosk);
+            break;
+        }
+    }
+    if (fPhones)
+    {
+        _DispatchPhones();
+    }
+}
+
+void CQRLoadWorker::Run()
+{
+    // Stagger the kiosks over the ramp so the server sees a steady arrival
+    // of new connections rather than one burst.
+    const uint64_t ullStartUs = GetMonotonicUs();
+    const uint64_t ullRampUs = (uint64_t)_options.cRampSeconds * 1000000;
+    for (size_t i = 0; i < _rgKiosk.size(); i++)
+    {
+        _AddTimer(ullStartUs + ullRampUs * i / _rgKiosk.size(), (int)i, TK_START);
+    }
+
+    struct epoll_event rgev[QR_LOAD_EPOLL_EVENTS];
+    while (!_pfStop->load(std::memory_order_relaxed))
+    {
+        int iTimeoutMs = 10;
+        if (!_timers.empty())
+        {
+            uint64_t ullNowUs = GetMonotonicUs();
+            uint64_t ullDueUs = _timers.top().ullDueUs;
+            iTimeoutMs = (ullDueUs <= ullNowUs) ? 0 : (int)((ullDueUs - ullNowUs + 999) / 1000);
+            if (iTimeoutMs > 10)
+            {
+                iTimeoutMs = 10;
+            }
+        }
+
+        int cev = epoll_wait(_epfd, rgev, QR_LOAD_EPOLL_EVENTS, iTimeoutMs);
+        for (int i = 0; i < cev; i++)
+        {
+            CLIENT_CONN* pConn = (CLIENT_CONN*)rgev[i].data.ptr;
+            if (pConn->fd < 0)
+            {
+                continue;
+            }
+
+            if (!pConn->fConnected && (rgev[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+            {
+                int iErr = 0;
+                socklen_t cbErr = sizeof(iErr);
+                getsockopt(pConn->fd, SOL_SOCKET, SO_ERROR, &iErr, &cbErr);
+                if (0 != iErr)
+                {
+                    _OnError(pConn);
+                    continue;
+                }
+                pConn->fConnected = true;
+            }
+
+            if (rgev[i].events & EPOLLOUT)
+            {
+                _Flush(pConn);
+            }
+            if ((pConn->fd >= 0) && (rgev[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)))
+            {
+                _OnReadable(pConn);
+            }
+        }
+
+        // Start counting once the ramp is over.
+        if (!_fMeasuring && _pfMeasuring->load(std::memory_order_relaxed))
+        {
+            _fMeasuring = true;
+        }
+        _RunTimers(GetMonotonicUs());
+    }
+}
+
+bool CQRLoadGenerator::Run(const QR_LOAD_OPTIONS& options)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* pai = NULL;
+    if ((0 != getaddrinfo(options.pszHost, NULL, &hints, &pai)) || !pai)
+    {
+        fprintf(stderr, "cannot resolve %s\n", options.pszHost);
+        return false;
+    }
+    struct sockaddr_in addrServer;
+    memcpy(&addrServer, pai->ai_addr, sizeof(addrServer));
+    addrServer.sin_port = htons(options.usPort);
+    freeaddrinfo(pai);
+
+    std::atomic<bool> fMeasuring(false);
+    std::atomic<bool> fStop(false);
+
+    std::vector<CQRLoadWorker*> rgpWorker;
+    for (int i = 0; i < options.cThreads; i++)
+    {
+        int cKiosks = options.cKiosks / options.cThreads + ((i < options.cKiosks % options.cThreads) ? 1 : 0);
+        rgpWorker.push_back(new CQRLoadWorker(options, addrServer, i, cKiosks, &fMeasuring, &fStop));
+    }
+
+    std::vector<std::thread> rgThread;
+    for (size_t i = 0; i < rgpWorker.size(); i++)
+    {
+        rgThread.push_back(std::thread(&CQRLoadWorker::Run, rgpWorker[i]));
+    }
+
+    // Let the ramp finish, then measure for the requested window.
+    sleep(options.cRampSeconds);
+    fMeasuring.store(true);
+    const uint64_t ullMeasureStartUs = GetMonotonicUs();
+    sleep(options.cSeconds);
+    fStop.store(true);
+    const double dSeconds = (GetMonotonicUs() - ullMeasureStartUs) / 1e6;
+
+    QR_LOAD_RESULT* pTotal = new QR_LOAD_RESULT();
+    pTotal->cRequests = 0;
+    pTotal->cLogins = 0;
+    pTotal->cErrors = 0;
+    for (size_t i = 0; i < rgThread.size(); i++)
+    {
+        rgThread[i].join();
+        const QR_LOAD_RESULT& result = rgpWorker[i]->Result();
+        pTotal->histRequest.Merge(result.histRequest);
+        pTotal->histPush.Merge(result.histPush);
+        pTotal->cRequests += result.cRequests;
+        pTotal->cLogins += result.cLogins;
+        pTotal->cErrors += result.cErrors;
+        delete rgpWorker[i];
+    }
+
+    printf("sessions      %d concurrent, %s, think %d ms, %.1f s measured\n",
+           options.cKiosks,
+           (0 == options.cPollMs) ? "long poll" : "interval poll",
+           options.cThinkMs,
+           dSeconds);
+    printf("throughput    %.0f requests/s, %.0f logins/s, %llu errors\n",
+           pTotal->cRequests / dSeconds,
+           pTotal->cLogins / dSeconds,
+           (unsigned long long)pTotal->cErrors);
+    printf("request (us)  p50 %llu  p99 %llu  p99.9 %llu  max %llu\n",
+           (unsigned long long)pTotal->histRequest.Percentile(50),
+           (unsigned long long)pTotal->histRequest.Percentile(99),
+           (unsigned long long)pTotal->histRequest.Percentile(99.9),
+           (unsigned long long)pTotal->histRequest.Max());
+    printf("push (us)     p50 %llu  p99 %llu  p99.9 %llu  max %llu\n",
+           (unsigned long long)pTotal->histPush.Percentile(50),
+           (unsigned long long)pTotal->histPush.Percentile(99),
+           (unsigned long long)pTotal->histPush.Percentile(99.9),
+           (unsigned long long)pTotal->histPush.Max());
+    delete pTotal;
+    return true;
+}
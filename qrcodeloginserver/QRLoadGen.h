@@ -0,0 +1,50 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRLoadGenerator drives a CQRServer the way a fleet of kiosks and phones
+// would.  Every simulated kiosk holds one keep-alive connection and loops:
+//
+//   1. pick a fresh nonce and register it with a plain status poll
+//   2. wait for the approval, either with a long poll (push) or by polling
+//      every interval
+//   3. when approved, start again with a new nonce
+//
+// After a think time, a phone opens the QR code URL and approves the
+// session.  Phones share a small pool of connections per thread, since a real
+// phone only talks to the backend briefly.  Each worker thread runs its own
+// epoll loop over its share of the kiosks.
+//
+// The report covers the measurement window after the ramp-up: requests and
+// logins per second, and latency percentiles for ordinary requests and for
+// push delivery (approval sent until the kiosk hears about it).
+
+#pragma once
+
+#include <stdint.h>
+
+struct QR_LOAD_OPTIONS
+{
+    const char* pszHost;            // IPv4 address or host name of the server.
+    uint16_t    usPort;
+    int         cThreads;
+    int         cKiosks;            // Concurrent sessions.
+    int         cPhonesPerThread;   // Phone connections per worker thread.
+    int         cRampSeconds;       // Kiosks start evenly over this period.
+    int         cSeconds;           // Measurement window after the ramp.
+    int         cThinkMs;           // Mean delay before the phone approves.
+    int         cPollMs;            // 0 to long-poll, otherwise the poll interval.
+    int         cSources;           // Loopback source addresses to spread ports over; 0 for the default.
+};
+
+class CQRLoadGenerator
+{
+  public:
+    // Runs the load and prints the report.  Returns false if the target
+    // cannot be resolved.
+    bool Run(const QR_LOAD_OPTIONS& options);
+};
@@ -0,0 +1,702 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// All sockets are non-blocking and registered edge triggered for both
+// directions once, when accepted.  Reads drain the socket, writes go out
+// immediately and only what the kernel refuses is kept for the next
+// EPOLLOUT, so a connection never needs its registration changed.
+
+#include "QRServer.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+
+#define QR_EPOLL_EVENTS         256
+#define QR_READ_CB              4096
+#define QR_LISTEN_BACKLOG       4096
+
+// How often reactor 0 sweeps expired sessions.  Parked requests have their
+// own timers and are answered on time.
+#define QR_HOUSEKEEPING_MS      1000
+
+uint64_t GetMonotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static const char* StateName(QR_SESSION_STATE state)
+{
+    switch (state)
+    {
+    case QSS_PENDING:   return "pending";
+    case QSS_SCANNED:   return "scanned";
+    case QSS_APPROVED:  return "approved";
+    case QSS_DENIED:    return "denied";
+    default:            return "expired";
+    }
+}
+
+// The page the phone sees after scanning.  A real backend would authenticate
+// the user here; the reference one just asks who is signing in.
+static void BuildScanPage(const std::string& strNonce, std::string* pstrBody)
+{
+    pstrBody->assign(
+        "<!DOCTYPE html><html><body>"
+        "<form method=\"post\" action=\"/qrcode/approve\">"
+        "<input type=\"hidden\" name=\"n\" value=\"");
+    pstrBody->append(strNonce);
+    pstrBody->append(
+        "\">User name: <input name=\"u\"> <input type=\"submit\" value=\"Approve\">"
+        "</form></body></html>");
+}
+
+CQRReactor::CQRReactor(CQRServer* pServer, uint32_t iReactor):
+    _pServer(pServer),
+    _iReactor(iReactor),
+    _epfd(-1),
+    _fdListen(-1),
+    _fdWake(-1),
+    _uNextGeneration(1),
+    _wheel(GetMonotonicMs())
+{
+}
+
+CQRReactor::~CQRReactor()
+{
+    for (std::unordered_map<int, QR_CONNECTION*>::iterator it = _connections.begin(); it != _connections.end(); ++it)
+    {
+        close(it->first);
+        delete it->second;
+    }
+    if (_fdWake >= 0)
+    {
+        close(_fdWake);
+    }
+    if (_fdListen >= 0)
+    {
+        close(_fdListen);
+    }
+    if (_epfd >= 0)
+    {
+        close(_epfd);
+    }
+}
+
+bool CQRReactor::Initialize(uint16_t usPort)
+{
+    _epfd = epoll_create1(EPOLL_CLOEXEC);
+    _fdWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    _fdListen = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ((_epfd < 0) || (_fdWake < 0) || (_fdListen < 0))
+    {
+        perror("reactor setup");
+        return false;
+    }
+
+    int iOn = 1;
+    int iOff = 0;
+    setsockopt(_fdListen, SOL_SOCKET, SO_REUSEADDR, &iOn, sizeof(iOn));
+    setsockopt(_fdListen, SOL_SOCKET, SO_REUSEPORT, &iOn, sizeof(iOn));
+    setsockopt(_fdListen, IPPROTO_IPV6, IPV6_V6ONLY, &iOff, sizeof(iOff));
+
+    struct sockaddr_in6 addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_any;
+    addr.sin6_port = htons(usPort);
+    if ((0 != bind(_fdListen, (struct sockaddr*)&addr, sizeof(addr))) || (0 != listen(_fdListen, QR_LISTEN_BACKLOG)))
+    {
+        perror("bind/listen");
+        return false;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = _fdListen;
+    epoll_ctl(_epfd, EPOLL_CTL_ADD, _fdListen, &ev);
+    ev.events = EPOLLIN;
+    ev.data.fd = _fdWake;
+    epoll_ctl(_epfd, EPOLL_CTL_ADD, _fdWake, &ev);
+    return true;
+}
+
+void CQRReactor::Post(const QR_WAITER& waiter)
+{
+    bool fSignal;
+    {
+        std::lock_guard<std::mutex> guard(_inboxLock);
+        fSignal = _inbox.empty();
+        _inbox.push_back(waiter);
+    }
+
+    // One wakeup per batch: if the inbox was already non-empty the reactor
+    // has been signalled and has not drained it yet.
+    if (fSignal)
+    {
+        uint64_t ull = 1;
+        ssize_t cb = write(_fdWake, &ull, sizeof(ull));
+        (void)cb;
+    }
+}
+
+void CQRReactor::Run()
+{
+    struct epoll_event rgev[QR_EPOLL_EVENTS];
+    uint64_t ullNextHousekeepingMs = GetMonotonicMs() + QR_HOUSEKEEPING_MS;
+
+    while (!_pServer->IsStopping())
+    {
+        int cev = epoll_wait(_epfd, rgev, QR_EPOLL_EVENTS, _GetTimeoutMs(ullNextHousekeepingMs));
+        for (int i = 0; i < cev; i++)
+        {
+            const int fd = rgev[i].data.fd;
+            if (fd == _fdListen)
+            {
+                _Accept();
+            }
+            else if (fd == _fdWake)
+            {
+                _DrainInbox();
+            }
+            else
+            {
+                std::unordered_map<int, QR_CONNECTION*>::iterator it = _connections.find(fd);
+                if (it == _connections.end())
+                {
+                    continue;
+                }
+
+                QR_CONNECTION* pConn = it->second;
+                if (rgev[i].events & (EPOLLERR | EPOLLHUP))
+                {
+                    _Close(pConn);
+                    continue;
+                }
+                if (rgev[i].events & EPOLLOUT)
+                {
+                    _Flush(pConn);
+                }
+                if ((rgev[i].events & (EPOLLIN | EPOLLRDHUP)) && (_connections.count(fd)))
+                {
+                    _OnReadable(pConn);
+                }
+            }
+        }
+
+        const uint64_t ullNowMs = GetMonotonicMs();
+        _wheel.Advance(ullNowMs);
+        if (ullNowMs >= ullNextHousekeepingMs)
+        {
+            ullNextHousekeepingMs = ullNowMs + QR_HOUSEKEEPING_MS;
+            if (0 == _iReactor)
+            {
+                std::vector<QR_WAITER> rgWake;
+                _pServer->Store().Sweep(ullNowMs, &rgWake);
+                _pServer->Wake(rgWake);
+            }
+        }
+    }
+}
+
+void CQRReactor::_Accept()
+{
+    for (;;)
+    {
+        int fd = accept4(_fdListen, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if ((EMFILE == errno) || (ENFILE == errno))
+            {
+                perror("accept4");
+            }
+            return;
+        }
+
+        int iOn = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &iOn, sizeof(iOn));
+
+        QR_CONNECTION* pConn = new QR_CONNECTION();
+        pConn->fd = fd;
+        pConn->uGeneration = _uNextGeneration++;
+        pConn->cbOutSent = 0;
+        pConn->fCloseAfterWrite = false;
+        pConn->fWaiting = false;
+        pConn->fWaitKeepAlive = false;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (0 != epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev))
+        {
+            close(fd);
+            delete pConn;
+            continue;
+        }
+
+        _connections[fd] = pConn;
+        _pServer->Stats().cConnections.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void CQRReactor::_OnReadable(QR_CONNECTION* pConn)
+{
+    char rgb[QR_READ_CB];
+    for (;;)
+    {
+        ssize_t cb = read(pConn->fd, rgb, sizeof(rgb));
+        if (cb > 0)
+        {
+            pConn->strIn.append(rgb, cb);
+            if (pConn->strIn.size() > 4 * QR_HTTP_HEAD_CB_MAX)
+            {
+                _Close(pConn);
+                return;
+            }
+        }
+        else if ((cb < 0) && (EAGAIN == errno))
+        {
+            break;
+        }
+        else if ((cb < 0) && (EINTR == errno))
+        {
+            continue;
+        }
+        else
+        {
+            // Peer closed or failed.  A parked request is abandoned with it.
+            _Close(pConn);
+            return;
+        }
+    }
+    _ProcessInput(pConn);
+}
+
+// Handles every complete request in the input buffer, stopping while a
+// status request is parked so responses stay in order.
+void CQRReactor::_ProcessInput(QR_CONNECTION* pConn)
+{
+    const int fd = pConn->fd;
+    size_t ibConsumed = 0;
+
+    while (!pConn->fWaiting && !pConn->fCloseAfterWrite)
+    {
+        QR_HTTP_REQUEST request;
+        long cbHead = ParseHttpRequest(pConn->strIn.data() + ibConsumed, pConn->strIn.size() - ibConsumed, &request);
+        if (0 == cbHead)
+        {
+            break;
+        }
+        if (cbHead < 0)
+        {
+            _Respond(pConn, 400, "text/plain", "bad request\n", false);
+            return;
+        }
+        if (pConn->strIn.size() - ibConsumed < cbHead + request.cbBody)
+        {
+            break;
+        }
+        request.body.cch = request.cbBody;
+
+        _pServer->Stats().cRequests.fetch_add(1, std::memory_order_relaxed);
+        _Dispatch(pConn, request);
+        if (!_connections.count(fd))
+        {
+            return;
+        }
+        ibConsumed += cbHead + request.cbBody;
+    }
+
+    pConn->strIn.erase(0, ibConsumed);
+}
+
+void CQRReactor::_Dispatch(QR_CONNECTION* pConn, const QR_HTTP_REQUEST& request)
+{
+    const bool fKeepAlive = request.fKeepAlive;
+    const bool fGet = request.method.Equals("GET");
+    const bool fPost = request.method.Equals("POST");
+
+    if (request.path.Equals("/stats"))
+    {
+        char szBody[256];
+        QR_SERVER_STATS& stats = _pServer->Stats();
+        int cch = snprintf(szBody, sizeof(szBody),
+                           "{\"sessions\":%zu,\"connections\":%llu,\"requests\":%llu,\"approvals\":%llu,\"wakeups\":%llu,\"wait_timeouts\":%llu}",
+                           _pServer->Store().Count(),
+                           (unsigned long long)stats.cConnections.load(),
+                           (unsigned long long)stats.cRequests.load(),
+                           (unsigned long long)stats.cApprovals.load(),
+                           (unsigned long long)stats.cWakeups.load(),
+                           (unsigned long long)stats.cWaitTimeouts.load());
+        _Respond(pConn, 200, "application/json", std::string(szBody, cch), fKeepAlive);
+        return;
+    }
+
+    if (!request.path.Equals("/qrcode/") && !request.path.Equals("/qrcode/status") &&
+        !request.path.Equals("/qrcode/approve") && !request.path.Equals("/qrcode/deny"))
+    {
+        _Respond(pConn, 404, "text/plain", "not found\n", fKeepAlive);
+        return;
+    }
+
+    // Form posts from the scan page carry their parameters in the body.
+    QR_SPAN params = request.query;
+    if (fPost && (0 == params.cch))
+    {
+        params = request.body;
+    }
+
+    std::string strNonce;
+    QR_NONCE nonce;
+    if (!GetQueryParam(params, "n", &strNonce) || !HexDecode(strNonce.data(), strNonce.size(), nonce.rgb, sizeof(nonce.rgb)))
+    {
+        _Respond(pConn, 400, "text/plain", "missing or malformed nonce\n", fKeepAlive);
+        return;
+    }
+
+    const uint64_t ullNowMs = GetMonotonicMs();
+    if (request.path.Equals("/qrcode/status") && fGet)
+    {
+        _HandleStatus(pConn, request, nonce);
+    }
+    else if (request.path.Equals("/qrcode/") && fGet)
+    {
+        if (_pServer->Store().Scan(nonce, ullNowMs))
+        {
+            std::string strBody;
+            BuildScanPage(strNonce, &strBody);
+            _Respond(pConn, 200, "text/html", strBody, fKeepAlive);
+        }
+        else
+        {
+            _Respond(pConn, 404, "text/plain", "unknown session\n", fKeepAlive);
+        }
+    }
+    else if ((request.path.Equals("/qrcode/approve") || request.path.Equals("/qrcode/deny")) && fPost)
+    {
+        std::vector<QR_WAITER> rgWake;
+        int iErr;
+        if (request.path.Equals("/qrcode/approve"))
+        {
+            std::string strUser;
+            iErr = GetQueryParam(params, "u", &strUser) && !strUser.empty()
+                 ? _pServer->Store().Approve(nonce, strUser.data(), strUser.size(), _pServer->Signer(), ullNowMs, &rgWake)
+                 : EINVAL;
+            if (0 == iErr)
+            {
+                _pServer->Stats().cApprovals.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            iErr = _pServer->Store().Deny(nonce, ullNowMs, &rgWake);
+        }
+        _pServer->Wake(rgWake);
+
+        switch (iErr)
+        {
+        case 0:
+            _Respond(pConn, 200, "application/json", "{\"result\":\"ok\"}", fKeepAlive);
+            break;
+        case ENOENT:
+            _Respond(pConn, 404, "text/plain", "unknown session\n", fKeepAlive);
+            break;
+        case EALREADY:
+            _Respond(pConn, 409, "text/plain", "session already decided\n", fKeepAlive);
+            break;
+        default:
+            _Respond(pConn, 400, "text/plain", "missing or invalid user name\n", fKeepAlive);
+            break;
+        }
+    }
+    else
+    {
+        _Respond(pConn, 405, "text/plain", "method not allowed\n", fKeepAlive);
+    }
+}
+
+void CQRReactor::_HandleStatus(QR_CONNECTION* pConn, const QR_HTTP_REQUEST& request, const QR_NONCE& nonce)
+{
+    const uint64_t ullNowMs = GetMonotonicMs();
+    QR_SESSION_VIEW view;
+
+    std::string strWait;
+    unsigned long ulWaitSeconds = 0;
+    if (GetQueryParam(request.query, "wait", &strWait))
+    {
+        ulWaitSeconds = strtoul(strWait.c_str(), NULL, 10);
+        if (ulWaitSeconds > QR_WAIT_SECONDS_MAX)
+        {
+            ulWaitSeconds = QR_WAIT_SECONDS_MAX;
+        }
+    }
+
+    if (0 == ulWaitSeconds)
+    {
+        if (_pServer->Store().Poll(nonce, ullNowMs, &view))
+        {
+            _RespondStatus(pConn, view, request.fKeepAlive);
+        }
+        else
+        {
+            _Respond(pConn, 503, "text/plain", "too many sessions\n", false);
+        }
+        return;
+    }
+
+    QR_WAITER waiter;
+    waiter.iReactor = _iReactor;
+    waiter.fd = pConn->fd;
+    waiter.uGeneration = pConn->uGeneration;
+
+    bool fFull;
+    if (_pServer->Store().Wait(nonce, ullNowMs, waiter, &view, &fFull))
+    {
+        pConn->fWaiting = true;
+        pConn->fWaitKeepAlive = request.fKeepAlive;
+        pConn->waitNonce = nonce;
+        _wheel.Schedule(pConn, ullNowMs + ulWaitSeconds * 1000, _OnWaitExpired, this);
+    }
+    else if (fFull)
+    {
+        _Respond(pConn, 503, "text/plain", "too many sessions\n", false);
+    }
+    else
+    {
+        _RespondStatus(pConn, view, request.fKeepAlive);
+    }
+}
+
+// The body qrcodelogin's _PollLoginStatus parses.
+void CQRReactor::_RespondStatus(QR_CONNECTION* pConn, const QR_SESSION_VIEW& view, bool fKeepAlive)
+{
+    std::string strBody("{\"status\":\"");
+    strBody.append(StateName(view.state));
+    strBody.append("\"");
+    if (QSS_APPROVED == view.state)
+    {
+        strBody.append(",\"token\":\"");
+        strBody.append(view.strToken);
+        strBody.append("\",\"signature\":\"");
+        strBody.append(view.strSignature);
+        strBody.append("\"");
+    }
+    else if ((QSS_PENDING == view.state) || (QSS_SCANNED == view.state))
+    {
+        char szInterval[32];
+        snprintf(szInterval, sizeof(szInterval), ",\"interval\":%d", QR_POLL_INTERVAL_SECONDS);
+        strBody.append(szInterval);
+    }
+    strBody.append("}");
+    _Respond(pConn, 200, "application/json", strBody, fKeepAlive);
+}
+
+void CQRReactor::_Respond(QR_CONNECTION* pConn, int iStatus, const char* pszContentType, const std::string& strBody, bool fKeepAlive)
+{
+    AppendHttpResponse(&pConn->strOut, iStatus, pszContentType, strBody.data(), strBody.size(), fKeepAlive);
+    if (!fKeepAlive)
+    {
+        pConn->fCloseAfterWrite = true;
+    }
+    _Flush(pConn);
+}
+
+void CQRReactor::_Flush(QR_CONNECTION* pConn)
+{
+    while (pConn->cbOutSent < pConn->strOut.size())
+    {
+        ssize_t cb = send(pConn->fd, pConn->strOut.data() + pConn->cbOutSent, pConn->strOut.size() - pConn->cbOutSent, MSG_NOSIGNAL);
+        if (cb > 0)
+        {
+            pConn->cbOutSent += cb;
+        }
+        else if ((cb < 0) && (EINTR == errno))
+        {
+            continue;
+        }
+        else if ((cb < 0) && (EAGAIN == errno))
+        {
+            return;
+        }
+        else
+        {
+            _Close(pConn);
+            return;
+        }
+    }
+
+    pConn->strOut.clear();
+    pConn->cbOutSent = 0;
+    if (pConn->fCloseAfterWrite)
+    {
+        _Close(pConn);
+    }
+}
+
+void CQRReactor::_Close(QR_CONNECTION* pConn)
+{
+    // Closing the fd removes it from the epoll set.  Any waiter still parked
+    // on a session is ignored later, as no connection matches it.
+    _wheel.Cancel(pConn);
+    _connections.erase(pConn->fd);
+    close(pConn->fd);
+    delete pConn;
+}
+
+void CQRReactor::_DrainInbox()
+{
+    uint64_t ull;
+    ssize_t cb = read(_fdWake, &ull, sizeof(ull));
+    (void)cb;
+
+    {
+        std::lock_guard<std::mutex> guard(_inboxLock);
+        _inboxDrain.swap(_inbox);
+    }
+
+    for (size_t i = 0; i < _inboxDrain.size(); i++)
+    {
+        const QR_WAITER& waiter = _inboxDrain[i];
+        std::unordered_map<int, QR_CONNECTION*>::iterator it = _connections.find(waiter.fd);
+        if ((it == _connections.end()) || (it->second->uGeneration != waiter.uGeneration) || !it->second->fWaiting)
+        {
+            continue;
+        }
+
+        QR_CONNECTION* pConn = it->second;
+        QR_SESSION_VIEW view;
+        _pServer->Store().Peek(pConn->waitNonce, &view);
+        if ((QSS_PENDING == view.state) || (QSS_SCANNED == view.state))
+        {
+            continue;
+        }
+
+        _pServer->Stats().cWakeups.fetch_add(1, std::memory_order_relaxed);
+        _wheel.Cancel(pConn);
+        pConn->fWaiting = false;
+        const int fd = pConn->fd;
+        _RespondStatus(pConn, view, pConn->fWaitKeepAlive);
+        if (_connections.count(fd))
+        {
+            _ProcessInput(pConn);
+        }
+    }
+    _inboxDrain.clear();
+}
+
+// Sleeps until the next wait deadline, but no longer than housekeeping
+// allows.  The wheel's next expiry may be early, never late.
+int CQRReactor::_GetTimeoutMs(uint64_t ullNextHousekeepingMs)
+{
+    uint64_t ullWakeMs = _wheel.GetNextExpiry();
+    if (ullNextHousekeepingMs < ullWakeMs)
+    {
+        ullWakeMs = ullNextHousekeepingMs;
+    }
+
+    const uint64_t ullNowMs = GetMonotonicMs();
+    return (ullWakeMs > ullNowMs) ? (int)(ullWakeMs - ullNowMs) : 0;
+}
+
+// Parked requests that reach their deadline are answered with the current,
+// still undecided state; the kiosk simply asks again.
+void CQRReactor::_OnWaitExpired(QR_TIMER* pTimer, void* pvContext)
+{
+    CQRReactor* pThis = (CQRReactor*)pvContext;
+    QR_CONNECTION* pConn = static_cast<QR_CONNECTION*>(pTimer);
+    const int fd = pConn->fd;
+
+    QR_SESSION_VIEW view;
+    pThis->_pServer->Store().Peek(pConn->waitNonce, &view);
+    pThis->_pServer->Stats().cWaitTimeouts.fetch_add(1, std::memory_order_relaxed);
+    pConn->fWaiting = false;
+    pThis->_RespondStatus(pConn, view, pConn->fWaitKeepAlive);
+    if (pThis->_connections.count(fd))
+    {
+        pThis->_ProcessInput(pConn);
+    }
+}
+
+CQRServer::CQRServer():
+    _pStore(NULL),
+    _fStop(false)
+{
+    memset(&_options, 0, sizeof(_options));
+    _stats.cConnections = 0;
+    _stats.cRequests = 0;
+    _stats.cApprovals = 0;
+    _stats.cWakeups = 0;
+    _stats.cWaitTimeouts = 0;
+}
+
+CQRServer::~CQRServer()
+{
+    for (size_t i = 0; i < _rgpReactor.size(); i++)
+    {
+        delete _rgpReactor[i];
+    }
+    delete _pStore;
+}
+
+bool CQRServer::Initialize(const QR_SERVER_OPTIONS& options)
+{
+    _options = options;
+    if (!_signer.Initialize(options.pszKeyFile))
+    {
+        return false;
+    }
+
+    _pStore = new CQRSessionStore(options.cMaxSessions);
+    for (int i = 0; i < options.cThreads; i++)
+    {
+        CQRReactor* pReactor = new CQRReactor(this, (uint32_t)i);
+        _rgpReactor.push_back(pReactor);
+        if (!pReactor->Initialize(options.usPort))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CQRServer::Run()
+{
+    std::vector<std::thread> rgThread;
+    for (size_t i = 1; i < _rgpReactor.size(); i++)
+    {
+        rgThread.push_back(std::thread(&CQRReactor::Run, _rgpReactor[i]));
+    }
+    _rgpReactor[0]->Run();
+    for (size_t i = 0; i < rgThread.size(); i++)
+    {
+        rgThread[i].join();
+    }
+}
+
+void CQRServer::Stop()
+{
+    _fStop.store(true, std::memory_order_relaxed);
+}
+
+void CQRServer::Wake(const std::vector<QR_WAITER>& rgWaiter)
+{
+    for (size_t i = 0; i < rgWaiter.size(); i++)
+    {
+        _rgpReactor[rgWaiter[i].iReactor]->Post(rgWaiter[i]);
+    }
+}
@@ -0,0 +1,161 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRServer is the reference backend for qrcodelogin.  It runs one
+// CQRReactor per thread; each reactor owns its own epoll instance and its own
+// SO_REUSEPORT listening socket, so the kernel spreads new connections across
+// reactors and a connection never leaves the thread that accepted it.  The
+// only shared state is the session store and the signing key.
+//
+// Endpoints (nonce is the 64 hex digit nonce from the QR code):
+//   GET  /qrcode/?n=<nonce>                 phone opened the QR code
+//   POST /qrcode/approve?n=<nonce>&u=<user> phone approved the logon for user
+//   POST /qrcode/deny?n=<nonce>             phone refused it
+//   GET  /qrcode/status?n=<nonce>[&wait=s]  kiosk poll; with wait the request
+//                                           is held until the session is
+//                                           decided or s seconds pass (push)
+//   GET  /stats                             counters, as JSON
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "QRHttp.h"
+#include "QRSessionStore.h"
+#include "QRSigner.h"
+#include "../qrcodelogin/QRTimerWheel.h"
+
+// Longest a status request may be held.
+#define QR_WAIT_SECONDS_MAX         60
+
+// Poll interval suggested to kiosks that do not long-poll.
+#define QR_POLL_INTERVAL_SECONDS    2
+
+struct QR_SERVER_OPTIONS
+{
+    uint16_t    usPort;
+    int         cThreads;
+    size_t      cMaxSessions;
+    const char* pszKeyFile;         // NULL to sign with a key generated at startup.
+};
+
+struct QR_SERVER_STATS
+{
+    std::atomic<uint64_t>   cConnections;
+    std::atomic<uint64_t>   cRequests;
+    std::atomic<uint64_t>   cApprovals;
+    std::atomic<uint64_t>   cWakeups;
+    std::atomic<uint64_t>   cWaitTimeouts;
+};
+
+class CQRServer;
+
+class CQRReactor
+{
+  public:
+    CQRReactor(CQRServer* pServer, uint32_t iReactor);
+    ~CQRReactor();
+
+    bool Initialize(uint16_t usPort);
+    void Run();
+
+    // Asks the reactor to answer the parked status request of waiter.
+    // Callable from any thread.
+    void Post(const QR_WAITER& waiter);
+
+  private:
+    // The timer holds the deadline of a parked status request.
+    struct QR_CONNECTION : QR_TIMER
+    {
+        int             fd;
+        uint32_t        uGeneration;
+        std::string     strIn;
+        std::string     strOut;
+        size_t          cbOutSent;
+        bool            fCloseAfterWrite;
+        bool            fWaiting;           // A status request is parked on a session.
+        bool            fWaitKeepAlive;
+        QR_NONCE        waitNonce;
+    };
+
+    void _Accept();
+    void _OnReadable(QR_CONNECTION* pConn);
+    void _ProcessInput(QR_CONNECTION* pConn);
+    void _Dispatch(QR_CONNECTION* pConn, const QR_HTTP_REQUEST& request);
+    void _HandleStatus(QR_CONNECTION* pConn, const QR_HTTP_REQUEST& request, const QR_NONCE& nonce);
+    void _RespondStatus(QR_CONNECTION* pConn, const QR_SESSION_VIEW& view, bool fKeepAlive);
+    void _Respond(QR_CONNECTION* pConn, int iStatus, const char* pszContentType, const std::string& strBody, bool fKeepAlive);
+    void _Flush(QR_CONNECTION* pConn);
+    void _Close(QR_CONNECTION* pConn);
+    void _DrainInbox();
+    int _GetTimeoutMs(uint64_t ullNextHousekeepingMs);
+    static void _OnWaitExpired(QR_TIMER* pTimer, void* pvContext);
+
+  private:
+    CQRServer*                                  _pServer;
+    uint32_t                                    _iReactor;
+    int                                         _epfd;
+    int                                         _fdListen;
+    int                                         _fdWake;        // eventfd signalled by Post.
+    uint32_t                                    _uNextGeneration;
+    std::unordered_map<int, QR_CONNECTION*>     _connections;
+    CQRTimerWheel                               _wheel;         // Wait deadlines, in GetMonotonicMs milliseconds.
+    std::mutex                                  _inboxLock;
+    std::vector<QR_WAITER>                      _inbox;
+    std::vector<QR_WAITER>                      _inboxDrain;
+};
+
+class CQRServer
+{
+  public:
+    CQRServer();
+    ~CQRServer();
+
+    bool Initialize(const QR_SERVER_OPTIONS& options);
+
+    // Runs the reactors until Stop is called.
+    void Run();
+    void Stop();
+
+    bool IsStopping() const
+    {
+        return _fStop.load(std::memory_order_relaxed);
+    }
+
+    // Wakes every waiter in rgWaiter on its own reactor.
+    void Wake(const std::vector<QR_WAITER>& rgWaiter);
+
+    CQRSessionStore& Store()
+    {
+        return *_pStore;
+    }
+
+    const CQRSigner& Signer() const
+    {
+        return _signer;
+    }
+
+    QR_SERVER_STATS& Stats()
+    {
+        return _stats;
+    }
+
+  private:
+    QR_SERVER_OPTIONS           _options;
+    CQRSigner                   _signer;
+    CQRSessionStore*            _pStore;
+    std::vector<CQRReactor*>    _rgpReactor;
+    std::atomic<bool>           _fStop;
+    QR_SERVER_STATS             _stats;
+};
+
+uint64_t GetMonotonicMs();
@@ -0,0 +1,270 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "QRSessionStore.h"
+#include "QRServer.h"
+
+#include <errno.h>
+#include <time.h>
+#include <openssl/rand.h>
+
+size_t CQRSessionStore::NONCE_HASH::operator()(const QR_NONCE& nonce) const
+{
+    uint64_t h = ullKey;
+    for (size_t i = 0; i < sizeof(nonce.rgb); i += 8)
+    {
+        uint64_t ull;
+        memcpy(&ull, nonce.rgb + i, sizeof(ull));
+        h = (h ^ ull) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+    }
+    return (size_t)h;
+}
+
+CQRSessionStore::SHARD::SHARD():
+    wheel(GetMonotonicMs()),
+    pSweepWake(NULL)
+{
+}
+
+CQRSessionStore::CQRSessionStore(size_t cMaxSessions):
+    _cMaxSessions(cMaxSessions),
+    _cSessions(0)
+{
+    if (1 != RAND_bytes((unsigned char*)&_hash.ullKey, sizeof(_hash.ullKey)))
+    {
+        _hash.ullKey = (uint64_t)time(NULL) * 0xD6E8FEB86659FD93ULL;
+    }
+
+    for (int i = 0; i < QR_SESSION_SHARDS; i++)
+    {
+        _rgShard[i].map = SESSION_MAP(cMaxSessions / QR_SESSION_SHARDS / 4 + 16, _hash);
+    }
+}
+
+// The shard comes from the top bits, the map's bucket from the bottom ones.
+CQRSessionStore::SHARD& CQRSessionStore::_ShardOf(const QR_NONCE& nonce)
+{
+    return _rgShard[(_hash(nonce) >> 58) % QR_SESSION_SHARDS];
+}
+
+// Call with the shard lock held.
+CQRSessionStore::QR_SESSION* CQRSessionStore::_FindOrCreate(SHARD& shard, const QR_NONCE& nonce, uint64_t ullNowMs, bool fCreate)
+{
+    SESSION_MAP::iterator it = shard.map.find(nonce);
+    if (it != shard.map.end())
+    {
+        QR_SESSION& session = it->second;
+        if ((QSS_PENDING == session.state) || (QSS_SCANNED == session.state))
+        {
+            session.ullExpiresMs = ullNowMs + QR_SESSION_IDLE_MS;
+        }
+        return &session;
+    }
+
+    if (!fCreate || (_cSessions.fetch_add(1, std::memory_order_relaxed) >= _cMaxSessions))
+    {
+        if (fCreate)
+        {
+            _cSessions.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return NULL;
+    }
+
+    QR_SESSION& session = shard.map[nonce];
+    session.nonce = nonce;
+    session.state = QSS_PENDING;
+    session.ullExpiresMs = ullNowMs + QR_SESSION_IDLE_MS;
+    shard.wheel.Schedule(&session, session.ullExpiresMs, _OnExpired, this);
+    return &session;
+}
+
+// Runs from Sweep with the shard lock held.  A session that saw activity
+// since its timer was armed is simply rearmed for its new expiry.
+void CQRSessionStore::_OnExpired(QR_TIMER* pTimer, void* pvContext)
+{
+    CQRSessionStore* pThis = (CQRSessionStore*)pvContext;
+    QR_SESSION* pSession = static_cast<QR_SESSION*>(pTimer);
+    SHARD& shard = pThis->_ShardOf(pSession->nonce);
+
+    if (pSession->ullExpiresMs > pTimer->ullExpiry)
+    {
+        shard.wheel.Schedule(pSession, pSession->ullExpiresMs, _OnExpired, pThis);
+        return;
+    }
+
+    shard.pSweepWake->insert(shard.pSweepWake->end(), pSession->waiters.begin(), pSession->waiters.end());
+    shard.map.erase(pSession->nonce);
+    pThis->_cSessions.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void CQRSessionStore::_FillView(const QR_SESSION& session, QR_SESSION_VIEW* pView)
+{
+    pView->state = session.state;
+    if (QSS_APPROVED == session.state)
+    {
+        pView->strToken = session.strToken;
+        pView->strSignature = session.strSignature;
+    }
+}
+
+bool CQRSessionStore::Poll(const QR_NONCE& nonce, uint64_t ullNowMs, QR_SESSION_VIEW* pView)
+{
+    SHARD& shard = _ShardOf(nonce);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    QR_SESSION* pSession = _FindOrCreate(shard, nonce, ullNowMs, true);
+    if (pSession)
+    {
+        _FillView(*pSession, pView);
+    }
+    return pSession != NULL;
+}
+
+bool CQRSessionStore::Wait(const QR_NONCE& nonce, uint64_t ullNowMs, const QR_WAITER& waiter, QR_SESSION_VIEW* pView, bool* pfFull)
+{
+    SHARD& shard = _ShardOf(nonce);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    QR_SESSION* pSession = _FindOrCreate(shard, nonce, ullNowMs, true);
+    *pfFull = (NULL == pSession);
+    if (!pSession)
+    {
+        return false;
+    }
+
+    if ((QSS_PENDING == pSession->state) || (QSS_SCANNED == pSession->state))
+    {
+        pSession->waiters.push_back(waiter);
+        return true;
+    }
+
+    _FillView(*pSession, pView);
+    return false;
+}
+
+void CQRSessionStore::Peek(const QR_NONCE& nonce, QR_SESSION_VIEW* pView)
+{
+    SHARD& shard = _ShardOf(nonce);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    SESSION_MAP::const_iterator it = shard.map.find(nonce);
+    if (it != shard.map.end())
+    {
+        _FillView(it->second, pView);
+    }
+    else
+    {
+        pView->state = QSS_EXPIRED;
+    }
+}
+
+bool CQRSessionStore::Scan(const QR_NONCE& nonce, uint64_t ullNowMs)
+{
+    SHARD& shard = _ShardOf(nonce);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    QR_SESSION* pSession = _FindOrCreate(shard, nonce, ullNowMs, false);
+    if (pSession && (QSS_PENDING == pSession->state))
+    {
+        pSession->state = QSS_SCANNED;
+    }
+    return pSession != NULL;
+}
+
+int CQRSessionStore::Approve(
+    const QR_NONCE& nonce,
+    const char* pszUsername,
+    size_t cchUsername,
+    const CQRSigner& signer,
+    uint64_t ullNowMs,
+    std::vector<QR_WAITER>* pWake
+    )
+{
+    SHARD& shard = _ShardOf(nonce);
+
+    // Check first, then sign without holding the shard lock; signing is by
+    // far the slowest step and other sessions in the shard should not wait
+    // for it.  The state is checked again before the result is stored.
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        QR_SESSION* pSession = _FindOrCreate(shard, nonce, ullNowMs, false);
+        if (!pSession)
+        {
+            return ENOENT;
+        }
+        if ((QSS_PENDING != pSession->state) && (QSS_SCANNED != pSession->state))
+        {
+            return EALREADY;
+        }
+    }
+
+    std::string strToken;
+    std::string strSignature;
+    if (!signer.Sign(nonce.rgb, pszUsername, cchUsername, (uint64_t)time(NULL) + QR_APPROVAL_LIFETIME, &strToken, &strSignature))
+    {
+        return EINVAL;
+    }
+
+    std::lock_guard<std::mutex> guard(shard.lock);
+    QR_SESSION* pSession = _FindOrCreate(shard, nonce, ullNowMs, false);
+    if (!pSession)
+    {
+        return ENOENT;
+    }
+    if ((QSS_PENDING != pSession->state) && (QSS_SCANNED != pSession->state))
+    {
+        return EALREADY;
+    }
+
+    pSession->state = QSS_APPROVED;
+    pSession->ullExpiresMs = ullNowMs + QR_SESSION_FINISHED_MS;
+    shard.wheel.Schedule(pSession, pSession->ullExpiresMs, _OnExpired, this);
+    pSession->strToken.swap(strToken);
+    pSession->strSignature.swap(strSignature);
+    pWake->insert(pWake->end(), pSession->waiters.begin(), pSession->waiters.end());
+    pSession->waiters.clear();
+    return 0;
+}
+
+int CQRSessionStore::Deny(const QR_NONCE& nonce, uint64_t ullNowMs, std::vector<QR_WAITER>* pWake)
+{
+    SHARD& shard = _ShardOf(nonce);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    QR_SESSION* pSession = _FindOrCreate(shard, nonce, ullNowMs, false);
+    if (!pSession)
+    {
+        return ENOENT;
+    }
+    if ((QSS_PENDING != pSession->state) && (QSS_SCANNED != pSession->state))
+    {
+        return EALREADY;
+    }
+
+    pSession->state = QSS_DENIED;
+    pSession->ullExpiresMs = ullNowMs + QR_SESSION_FINISHED_MS;
+    shard.wheel.Schedule(pSession, pSession->ullExpiresMs, _OnExpired, this);
+    pWake->insert(pWake->end(), pSession->waiters.begin(), pSession->waiters.end());
+    pSession->waiters.clear();
+    return 0;
+}
+
+void CQRSessionStore::Sweep(uint64_t ullNowMs, std::vector<QR_WAITER>* pWake)
+{
+    for (int i = 0; i < QR_SESSION_SHARDS; i++)
+    {
+        SHARD& shard = _rgShard[i];
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        shard.pSweepWake = pWake;
+        shard.wheel.Advance(ullNowMs);
+        shard.pSweepWake = NULL;
+    }
+}
@@ -0,0 +1,164 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRSessionStore holds every live login session, keyed by the 32 byte nonce
+// the kiosk put in its QR code.  The table is split into shards, each with
+// its own lock, so reactors working on different sessions rarely contend.
+//
+// A kiosk that long-polls a session registers a QR_WAITER.  When the phone
+// approves or denies the session, or the session expires, the waiters are
+// handed back to the caller, which wakes the reactors that own them.
+//
+// Each shard keeps its sessions' expiry on a CQRTimerWheel, so Sweep only
+// touches sessions that are due instead of walking every session.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "QRSigner.h"
+#include "../qrcodelogin/QRTimerWheel.h"
+
+#define QR_SESSION_SHARDS           64
+
+// A session nobody has touched for this long is dropped.
+#define QR_SESSION_IDLE_MS          120000
+
+// Once approved or denied, a session only stays around long enough for the
+// kiosk to collect the result.
+#define QR_SESSION_FINISHED_MS      30000
+
+enum QR_SESSION_STATE
+{
+    QSS_PENDING,
+    QSS_SCANNED,
+    QSS_APPROVED,
+    QSS_DENIED,
+    QSS_EXPIRED,
+};
+
+// A kiosk connection parked on a session, identified by the reactor that owns
+// it and the connection's generation so a recycled fd is never woken.
+struct QR_WAITER
+{
+    uint32_t    iReactor;
+    int         fd;
+    uint32_t    uGeneration;
+};
+
+// What a status response needs, copied out under the shard lock.
+struct QR_SESSION_VIEW
+{
+    QR_SESSION_STATE    state;
+    std::string         strToken;
+    std::string         strSignature;
+};
+
+struct QR_NONCE
+{
+    uint8_t rgb[QR_NONCE_CB];
+
+    bool operator==(const QR_NONCE& other) const
+    {
+        return 0 == memcmp(rgb, other.rgb, sizeof(rgb));
+    }
+};
+
+class CQRSessionStore
+{
+  public:
+    CQRSessionStore(size_t cMaxSessions);
+
+    // Kiosk: reports the session's state, creating it on first sight.
+    // Returns false if the session is new and the store is full.
+    bool Poll(const QR_NONCE& nonce, uint64_t ullNowMs, QR_SESSION_VIEW* pView);
+
+    // Kiosk long poll: if the session is still pending or scanned, parks
+    // waiter on it and returns true.  Otherwise fills pView and returns false.
+    // Sets *pfFull if the session would have to be created and cannot be.
+    bool Wait(const QR_NONCE& nonce, uint64_t ullNowMs, const QR_WAITER& waiter, QR_SESSION_VIEW* pView, bool* pfFull);
+
+    // Reports the state of an existing session without creating or touching
+    // it; an unknown session reads as expired.  Used to answer woken waiters.
+    void Peek(const QR_NONCE& nonce, QR_SESSION_VIEW* pView);
+
+    // Phone: the QR code was opened.  Returns false for an unknown session.
+    bool Scan(const QR_NONCE& nonce, uint64_t ullNowMs);
+
+    // Phone: approves (with a signed assertion for pszUsername) or denies the
+    // session.  Returns 0, ENOENT for an unknown session, EALREADY if it is
+    // already decided, or EINVAL if the approval cannot be signed.  Waiters to
+    // wake are appended to pWake.
+    int Approve(const QR_NONCE& nonce,
+                const char* pszUsername,
+                size_t cchUsername,
+                const CQRSigner& signer,
+                uint64_t ullNowMs,
+                std::vector<QR_WAITER>* pWake);
+    int Deny(const QR_NONCE& nonce, uint64_t ullNowMs, std::vector<QR_WAITER>* pWake);
+
+    // Drops expired sessions and appends their waiters to pWake.  The cost is
+    // proportional to the number of sessions due, not the number held.
+    void Sweep(uint64_t ullNowMs, std::vector<QR_WAITER>* pWake);
+
+    size_t Count() const
+    {
+        return _cSessions.load(std::memory_order_relaxed);
+    }
+
+  private:
+    // The timer is armed for ullExpiresMs or earlier.  Activity only moves
+    // ullExpiresMs forward; the timer catches up when it fires, so an active
+    // session is not rescheduled on every poll.
+    struct QR_SESSION : QR_TIMER
+    {
+        QR_NONCE                nonce;
+        QR_SESSION_STATE        state;
+        uint64_t                ullExpiresMs;
+        std::string             strToken;
+        std::string             strSignature;
+        std::vector<QR_WAITER>  waiters;
+    };
+
+    // Nonces come from clients, so the hash is keyed per process to keep a
+    // client from steering them all into one bucket.
+    struct NONCE_HASH
+    {
+        uint64_t ullKey;
+
+        size_t operator()(const QR_NONCE& nonce) const;
+    };
+
+    typedef std::unordered_map<QR_NONCE, QR_SESSION, NONCE_HASH> SESSION_MAP;
+
+    struct SHARD
+    {
+        SHARD();
+
+        std::mutex                  lock;
+        SESSION_MAP                 map;
+        CQRTimerWheel               wheel;      // Ticks are GetMonotonicMs milliseconds.
+        std::vector<QR_WAITER>*     pSweepWake; // Set while Sweep advances the wheel.
+    };
+
+    SHARD& _ShardOf(const QR_NONCE& nonce);
+    QR_SESSION* _FindOrCreate(SHARD& shard, const QR_NONCE& nonce, uint64_t ullNowMs, bool fCreate);
+    static void _FillView(const QR_SESSION& session, QR_SESSION_VIEW* pView);
+    static void _OnExpired(QR_TIMER* pTimer, void* pvContext);
+
+  private:
+    size_t              _cMaxSessions;
+    std::atomic<size_t> _cSessions;
+    NONCE_HASH          _hash;
+    SHARD               _rgShard[QR_SESSION_SHARDS];
+};
@@ -0,0 +1,128 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "QRSigner.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+// Domain separation prefix of the signed message.
+static const uint8_t c_rgbApprovalContext[] = { 'Q', 'R', 'A', '1' };
+
+void Base64Encode(const uint8_t* pb, size_t cb, std::string* pstr)
+{
+    pstr->resize(4 * ((cb + 2) / 3) + 1);
+    int cch = EVP_EncodeBlock((unsigned char*)&(*pstr)[0], pb, (int)cb);
+    pstr->resize(cch);
+}
+
+CQRSigner::CQRSigner():
+    _pKey(NULL)
+{
+    memset(_rgbPublicKey, 0, sizeof(_rgbPublicKey));
+}
+
+CQRSigner::~CQRSigner()
+{
+    EVP_PKEY_free(_pKey);
+}
+
+bool CQRSigner::Initialize(const char* pszKeyFile)
+{
+    uint8_t rgbSeed[QR_ED25519_SEED_CB];
+    if (pszKeyFile)
+    {
+        FILE* pf = fopen(pszKeyFile, "rb");
+        if (!pf)
+        {
+            fprintf(stderr, "cannot open key file %s\n", pszKeyFile);
+            return false;
+        }
+        size_t cbRead = fread(rgbSeed, 1, sizeof(rgbSeed), pf);
+        fclose(pf);
+        if (sizeof(rgbSeed) != cbRead)
+        {
+            fprintf(stderr, "key file %s must hold a %d byte Ed25519 seed\n", pszKeyFile, QR_ED25519_SEED_CB);
+            return false;
+        }
+    }
+    else if (1 != RAND_bytes(rgbSeed, sizeof(rgbSeed)))
+    {
+        fprintf(stderr, "RAND_bytes failed\n");
+        return false;
+    }
+
+    _pKey = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, NULL, rgbSeed, sizeof(rgbSeed));
+    memset(rgbSeed, 0, sizeof(rgbSeed));
+    if (!_pKey)
+    {
+        fprintf(stderr, "cannot load Ed25519 key\n");
+        return false;
+    }
+
+    size_t cbPublic = sizeof(_rgbPublicKey);
+    if ((1 != EVP_PKEY_get_raw_public_key(_pKey, _rgbPublicKey, &cbPublic)) || (sizeof(_rgbPublicKey) != cbPublic))
+    {
+        fprintf(stderr, "cannot derive Ed25519 public key\n");
+        return false;
+    }
+    return true;
+}
+
+bool CQRSigner::Sign(
+    const uint8_t* pbNonce,
+    const char* pszUsername,
+    size_t cchUsername,
+    uint64_t ullExpiry,
+    std::string* pstrToken,
+    std::string* pstrSignature
+    ) const
+{
+    if (cchUsername > QR_USERNAME_CB_MAX)
+    {
+        return false;
+    }
+
+    // "QRA1" || nonce || expiry || username; the token is everything after the prefix.
+    uint8_t rgbMessage[sizeof(c_rgbApprovalContext) + QR_NONCE_CB + 8 + QR_USERNAME_CB_MAX];
+    uint8_t* pb = rgbMessage;
+    memcpy(pb, c_rgbApprovalContext, sizeof(c_rgbApprovalContext));
+    pb += sizeof(c_rgbApprovalContext);
+    memcpy(pb, pbNonce, QR_NONCE_CB);
+    pb += QR_NONCE_CB;
+    for (int i = 7; i >= 0; i--)
+    {
+        *pb++ = (uint8_t)(ullExpiry >> (i * 8));
+    }
+    memcpy(pb, pszUsername, cchUsername);
+    pb += cchUsername;
+    const size_t cbMessage = pb - rgbMessage;
+
+    uint8_t rgbSignature[64];
+    size_t cbSignature = sizeof(rgbSignature);
+    bool fOk = false;
+
+    // EVP_MD_CTX is cheap; one per call keeps Sign thread safe without a lock.
+    EVP_MD_CTX* pCtx = EVP_MD_CTX_new();
+    if (pCtx)
+    {
+        fOk = (1 == EVP_DigestSignInit(pCtx, NULL, NULL, NULL, _pKey)) &&
+              (1 == EVP_DigestSign(pCtx, rgbSignature, &cbSignature, rgbMessage, cbMessage));
+        EVP_MD_CTX_free(pCtx);
+    }
+
+    if (fOk)
+    {
+        Base64Encode(rgbMessage + sizeof(c_rgbApprovalContext), cbMessage - sizeof(c_rgbApprovalContext), pstrToken);
+        Base64Encode(rgbSignature, cbSignature, pstrSignature);
+    }
+    return fOk;
+}
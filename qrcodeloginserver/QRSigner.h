@@ -0,0 +1,62 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CQRSigner issues the approval assertions qrcodelogin verifies (see
+// qrcodelogin\QRApproval.h):
+//   token     = base64(nonce[32] || expiry[8, big endian Unix time] || username[UTF-8])
+//   signature = base64(Ed25519 signature over "QRA1" || decoded token)
+// Signing uses OpenSSL's Ed25519.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#define QR_NONCE_CB             32
+#define QR_ED25519_SEED_CB      32
+#define QR_ED25519_PUBLIC_CB    32
+
+// Matches QR_APPROVAL_PAYLOAD_CB_MAX - QR_APPROVAL_HEADER_CB on the client.
+#define QR_USERNAME_CB_MAX      128
+
+// Lifetime of an issued approval.  Must not exceed QR_APPROVAL_TTL_MAX on the client.
+#define QR_APPROVAL_LIFETIME    120
+
+typedef struct evp_pkey_st EVP_PKEY;
+
+class CQRSigner
+{
+  public:
+    CQRSigner();
+    ~CQRSigner();
+
+    // Loads a 32 byte Ed25519 seed from pszKeyFile, or generates a fresh key
+    // if pszKeyFile is NULL.  Returns false and prints why on failure.
+    bool Initialize(const char* pszKeyFile);
+
+    // The public key to provision as ApprovalPublicKey on the clients.
+    const uint8_t* GetPublicKey() const
+    {
+        return _rgbPublicKey;
+    }
+
+    // Builds and signs an approval for the session nonce and username.
+    // Thread safe.
+    bool Sign(const uint8_t* pbNonce,
+              const char* pszUsername,
+              size_t cchUsername,
+              uint64_t ullExpiry,
+              std::string* pstrToken,
+              std::string* pstrSignature) const;
+
+  private:
+    EVP_PKEY*   _pKey;
+    uint8_t     _rgbPublicKey[QR_ED25519_PUBLIC_CB];
+};
+
+void Base64Encode(const uint8_t* pb, size_t cb, std::string* pstr);
@@ -0,0 +1,256 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// qrcodeloginserver serve   [--port p] [--threads n] [--max-sessions n] [--key file]
+// qrcodeloginserver load    [--host h] [--port p] [--threads n] [--sessions n] [--phones n]
+//                           [--ramp s] [--duration s] [--think ms] [--poll ms] [--sources n]
+// qrcodeloginserver genkey  file
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <thread>
+#include <openssl/rand.h>
+#include "QRHttp.h"
+#include "QRLoadGen.h"
+#include "QRServer.h"
+
+static CQRServer* s_pServer = NULL;
+
+static void OnSignal(int)
+{
+    if (s_pServer)
+    {
+        s_pServer->Stop();
+    }
+}
+
+// Every session is a socket on both sides, so the default limit of 1024
+// descriptors is far too low.  Raise the soft limit as far as allowed.
+static void RaiseFileLimit()
+{
+    struct rlimit rl;
+    if (0 == getrlimit(RLIMIT_NOFILE, &rl))
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+static int DefaultThreads()
+{
+    unsigned int c = std::thread::hardware_concurrency();
+    return (c > 0) ? (int)c : 1;
+}
+
+// Returns the value after argv[i] as a number, advancing i.
+static bool NextNumber(int argc, char** argv, int* pi, long* pl)
+{
+    if (*pi + 1 >= argc)
+    {
+        return false;
+    }
+    char* pszEnd;
+    *pl = strtol(argv[++*pi], &pszEnd, 10);
+    return ('\0' == *pszEnd) && (*pl >= 0);
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "usage: qrcodeloginserver serve [--port p] [--threads n] [--max-sessions n] [--key file]\n"
+            "       qrcodeloginserver load [--host h] [--port p] [--threads n] [--sessions n] [--phones n]\n"
+            "                              [--ramp s] [--duration s] [--think ms] [--poll ms] [--sources n]\n"
+            "       qrcodeloginserver genkey file\n");
+}
+
+static int Serve(int argc, char** argv)
+{
+    QR_SERVER_OPTIONS options;
+    options.usPort = 8080;
+    options.cThreads = DefaultThreads();
+    options.cMaxSessions = 1000000;
+    options.pszKeyFile = NULL;
+
+    for (int i = 2; i < argc; i++)
+    {
+        long l;
+        if (0 == strcmp(argv[i], "--key") && (i + 1 < argc))
+        {
+            options.pszKeyFile = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "--port") && NextNumber(argc, argv, &i, &l) && (l > 0) && (l < 65536))
+        {
+            options.usPort = (uint16_t)l;
+        }
+        else if (0 == strcmp(argv[i], "--threads") && NextNumber(argc, argv, &i, &l) && (l > 0))
+        {
+            options.cThreads = (int)l;
+        }
+        else if (0 == strcmp(argv[i], "--max-sessions") && NextNumber(argc, argv, &i, &l) && (l > 0))
+        {
+            options.cMaxSessions = (size_t)l;
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    CQRServer server;
+    if (!server.Initialize(options))
+    {
+        return 1;
+    }
+
+    char szPublicKey[2 * QR_ED25519_PUBLIC_CB + 1];
+    HexEncode(server.Signer().GetPublicKey(), QR_ED25519_PUBLIC_CB, szPublicKey);
+    printf("listening on port %u with %d reactors\n", options.usPort, options.cThreads);
+    printf("ApprovalPublicKey %s\n", szPublicKey);
+    fflush(stdout);
+
+    s_pServer = &server;
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    server.Run();
+    s_pServer = NULL;
+    return 0;
+}
+
+static int Load(int argc, char** argv)
+{
+    QR_LOAD_OPTIONS options;
+    options.pszHost = "127.0.0.1";
+    options.usPort = 8080;
+    options.cThreads = DefaultThreads();
+    options.cKiosks = 1000;
+    options.cPhonesPerThread = 64;
+    options.cRampSeconds = 5;
+    options.cSeconds = 20;
+    options.cThinkMs = 5000;
+    options.cPollMs = 0;
+    options.cSources = 0;
+
+    for (int i = 2; i < argc; i++)
+    {
+        long l = 0;
+        if (0 == strcmp(argv[i], "--host") && (i + 1 < argc))
+        {
+            options.pszHost = argv[++i];
+        }
+        else if (!NextNumber(argc, argv, &i, &l))
+        {
+            PrintUsage();
+            return 2;
+        }
+        else if (0 == strcmp(argv[i - 1], "--port") && (l > 0) && (l < 65536))
+        {
+            options.usPort = (uint16_t)l;
+        }
+        else if (0 == strcmp(argv[i - 1], "--threads") && (l > 0))
+        {
+            options.cThreads = (int)l;
+        }
+        else if (0 == strcmp(argv[i - 1], "--sessions") && (l > 0))
+        {
+            options.cKiosks = (int)l;
+        }
+        else if (0 == strcmp(argv[i - 1], "--phones") && (l > 0))
+        {
+            options.cPhonesPerThread = (int)l;
+        }
+        else if (0 == strcmp(argv[i - 1], "--ramp"))
+        {
+            options.cRampSeconds = (int)l;
+        }
+        else if (0 == strcmp(argv[i - 1], "--duration") && (l > 0))
+        {
+            options.cSeconds = (int)l;
+        }
+        else if (0 == strcmp(argv[i - 1], "--think"))
+        {
+            options.cThinkMs = (int)l;
+        }
+        else if (0 == strcmp(argv[i - 1], "--poll"))
+        {
+            options.cPollMs = (int)l;
+        }
+        else if (0 == strcmp(argv[i - 1], "--sources") && (l < 250))
+        {
+            options.cSources = (int)l;
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    CQRLoadGenerator generator;
+    return generator.Run(options) ? 0 : 1;
+}
+
+// Writes a new 32 byte Ed25519 seed and prints the public key to provision.
+static int GenerateKey(const char* pszFile)
+{
+    uint8_t rgbSeed[QR_ED25519_SEED_CB];
+    if (1 != RAND_bytes(rgbSeed, sizeof(rgbSeed)))
+    {
+        fprintf(stderr, "RAND_bytes failed\n");
+        return 1;
+    }
+
+    FILE* pf = fopen(pszFile, "wb");
+    if (!pf)
+    {
+        fprintf(stderr, "cannot create %s\n", pszFile);
+        return 1;
+    }
+    bool fWritten = (sizeof(rgbSeed) == fwrite(rgbSeed, 1, sizeof(rgbSeed), pf));
+    fWritten = (0 == fclose(pf)) && fWritten;
+    memset(rgbSeed, 0, sizeof(rgbSeed));
+    if (!fWritten)
+    {
+        fprintf(stderr, "cannot write %s\n", pszFile);
+        return 1;
+    }
+
+    CQRSigner signer;
+    if (!signer.Initialize(pszFile))
+    {
+        return 1;
+    }
+    char szPublicKey[2 * QR_ED25519_PUBLIC_CB + 1];
+    HexEncode(signer.GetPublicKey(), QR_ED25519_PUBLIC_CB, szPublicKey);
+    printf("ApprovalPublicKey %s\n", szPublicKey);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    RaiseFileLimit();
+    signal(SIGPIPE, SIG_IGN);
+
+    if ((argc >= 2) && (0 == strcmp(argv[1], "serve")))
+    {
+        return Serve(argc, argv);
+    }
+    if ((argc >= 2) && (0 == strcmp(argv[1], "load")))
+    {
+        return Load(argc, argv);
+    }
+    if ((argc == 3) && (0 == strcmp(argv[1], "genkey")))
+    {
+        return GenerateKey(argv[2]);
+    }
+    PrintUsage();
+    return 2;
+}
@@ -16,10 +16,55 @@
 #include "CSampleCredential.h"
 #include "guid.h"
 
+// The combobox only shows while the checkbox is checked.
+static void _ComboBoxRule(
+    __in const DWORD* rgdwValue,
+    __out CREDENTIAL_PROVIDER_FIELD_STATE* pcpfs,
+    __out CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE* pcpfis
+    )
+{
+    *pcpfs = rgdwValue[SFI_CHECKBOX] ? CPFS_DISPLAY_IN_SELECTED_TILE : CPFS_HIDDEN;
+    *pcpfis = CPFIS_NONE;
+}
+
+// And the command link only once something past the first item is picked in it.
+static void _CommandLinkRule(
+    __in const DWORD* rgdwValue,
+    __out CREDENTIAL_PROVIDER_FIELD_STATE* pcpfs,
+    __out CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE* pcpfis
+    )
+{
+    *pcpfs = (rgdwValue[SFI_CHECKBOX] && rgdwValue[SFI_COMBOBOX]) ? CPFS_DISPLAY_IN_SELECTED_TILE : CPFS_HIDDEN;
+    *pcpfis = CPFIS_NONE;
+}
+
+// There's nothing to submit without a username.
+static void _SubmitButtonRule(
+    __in const DWORD* rgdwValue,
+    __out CREDENTIAL_PROVIDER_FIELD_STATE* pcpfs,
+    __out CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE* pcpfis
+    )
+{
+    *pcpfs = CPFS_DISPLAY_IN_SELECTED_TILE;
+    *pcpfis = rgdwValue[SFI_EDIT_TEXT] ? CPFIS_NONE : CPFIS_DISABLED;
+}
+
+// The fields whose states follow from other fields' values.  The value of the checkbox is
+// whether it's checked, of the combobox the selected item, and of the edit field whether
+// anything's been typed in it.
+static const FIELD_STATE_RULE s_rgFieldStateRules[] =
+{
+    { SFI_COMBOBOX, FIELD_STATE_INPUT(SFI_CHECKBOX), _ComboBoxRule },
+    { SFI_COMMAND_LINK, FIELD_STATE_INPUT(SFI_CHECKBOX) | FIELD_STATE_INPUT(SFI_COMBOBOX), _CommandLinkRule },
+    { SFI_SUBMIT_BUTTON, FIELD_STATE_INPUT(SFI_EDIT_TEXT), _SubmitButtonRule },
+};
+
 // CSampleCredential ////////////////////////////////////////////////////////
 
 CSampleCredential::CSampleCredential():
     _cRef(1),
+    _cchEditText(0),
+    _pArena(NULL),
     _pCredProvCredentialEvents(NULL)
 {
     DllAddRef();
@@ -37,11 +82,14 @@ CSampleCredential::~CSampleCredential()
     {
         size_t lenPassword = lstrlen(_rgFieldStrings[SFI_PASSWORD]);
         SecureZeroMemory(_rgFieldStrings[SFI_PASSWORD], lenPassword * sizeof(*_rgFieldStrings[SFI_PASSWORD]));
+        CoTaskMemFree(_rgFieldStrings[SFI_PASSWORD]);
     }
-    for (int i = 0; i < ARRAYSIZE(_rgFieldStrings); i++)
+    CoTaskMemFree(_rgFieldStrings[SFI_EDIT_TEXT]);
+
+    // The other strings and the labels go with the arena.
+    if (_pArena != NULL)
     {
-        CoTaskMemFree(_rgFieldStrings[i]);
-        CoTaskMemFree(_rgCredProvFieldDescriptors[i].pszLabel);
+        _pArena->Release();
     }
 
     DllRelease();
@@ -50,61 +98,161 @@ CSampleCredential::~CSampleCredential()
 
 // Initializes one credential with the field information passed in.
 // Set the value of the SFI_LARGE_TEXT field to pwzUsername.
+// If pComboBoxSource isn't NULL, the combobox shows its items instead of s_rgComboBoxStrings.
+// The labels and field strings are allocated from pArena, which the credential holds on to.
 HRESULT CSampleCredential::Initialize(
     __in CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
     __in const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR* rgcpfd,
-    __in const FIELD_STATE_PAIR* rgfsp
+    __in const FIELD_STATE_PAIR* rgfsp,
+    __in_opt CComboBoxSource* pComboBoxSource,
+    __in CScenarioArena* pArena
     )
 {
     HRESULT hr = S_OK;
 
     _cpus = cpus;
 
+    _pArena = pArena;
+    _pArena->AddRef();
+
+    if (pComboBoxSource != NULL)
+    {
+        _comboBoxField.Initialize(pComboBoxSource);
+    }
+
     // Copy the field descriptors for each field. This is useful if you want to vary the field
     // descriptors based on what Usage scenario the credential was created for.
     for (DWORD i = 0; SUCCEEDED(hr) && i < ARRAYSIZE(_rgCredProvFieldDescriptors); i++)
     {
         _rgFieldStatePairs[i] = rgfsp[i];
-        hr = FieldDescriptorCopy(rgcpfd[i], &_rgCredProvFieldDescriptors[i]);
+        _rgCredProvFieldDescriptors[i] = rgcpfd[i];
+        if (rgcpfd[i].pszLabel)
+        {
+            hr = _pArena->StrDup(rgcpfd[i].pszLabel, &_rgCredProvFieldDescriptors[i].pszLabel);
+        }
     }
 
     // Initialize the String value of all the fields. 
     if (SUCCEEDED(hr))
     {
-        hr = SHStrDupW(L"Large Text", &_rgFieldStrings[SFI_LARGE_TEXT]);
+        hr = _SetFieldString(SFI_LARGE_TEXT, L"Large Text");
     }
     if (SUCCEEDED(hr))
     {
-        hr = SHStrDupW(L"Small Text", &_rgFieldStrings[SFI_SMALL_TEXT]);
+        hr = _SetFieldString(SFI_SMALL_TEXT, L"Small Text");
     }
     if (SUCCEEDED(hr))
     {
-        hr = SHStrDupW(L"Edit Text", &_rgFieldStrings[SFI_EDIT_TEXT]);
+        hr = _SetFieldString(SFI_EDIT_TEXT, L"Edit Text");
     }
     if (SUCCEEDED(hr))
     {
-        hr = SHStrDupW(L"", &_rgFieldStrings[SFI_PASSWORD]);
+        hr = _SetFieldString(SFI_PASSWORD, L"");
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = _SetFieldString(SFI_SUBMIT_BUTTON, L"Submit");
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = _SetFieldString(SFI_CHECKBOX, L"Checkbox");
     }
     if (SUCCEEDED(hr))
     {
-        hr = SHStrDupW(L"Submit", &_rgFieldStrings[SFI_SUBMIT_BUTTON]);
+        hr = _SetFieldString(SFI_COMBOBOX, L"Combobox");
     }
     if (SUCCEEDED(hr))
     {
-        hr = SHStrDupW(L"Checkbox", &_rgFieldStrings[SFI_CHECKBOX]);
+        hr = _SetFieldString(SFI_COMMAND_LINK, L"Command Link");
     }
+
+    // Work out the starting states of the fields that have rules.
     if (SUCCEEDED(hr))
     {
-        hr = SHStrDupW(L"Combobox", &_rgFieldStrings[SFI_COMBOBOX]);
+        hr = _fieldStateRules.Initialize(s_rgFieldStateRules, ARRAYSIZE(s_rgFieldStateRules), SFI_NUM_FIELDS);
     }
     if (SUCCEEDED(hr))
     {
-        hr = SHStrDupW(L"Command Link", &_rgFieldStrings[SFI_COMMAND_LINK]);
+        _fieldStateRules.SetValue(SFI_EDIT_TEXT, (_rgFieldStrings[SFI_EDIT_TEXT][0] != L'\0'));
+        _fieldStateRules.SetValue(SFI_CHECKBOX, _bChecked);
+        _fieldStateRules.SetValue(SFI_COMBOBOX, _dwComboIndex);
+        hr = _fieldStateRules.Apply(NULL);
     }
 
     return S_OK;
 }
 
+// Replaces the string value of a field.  The password is the only secret, so it's the only
+// one that's wiped and freed as soon as it's replaced.  The edit field changes on every
+// keystroke, so its value is copied over the last one in a buffer that only grows, doubling
+// when it's too small.  The rest are set once and come from the arena.
+HRESULT CSampleCredential::_SetFieldString(
+    __in DWORD dwFieldID,
+    __in PCWSTR pwz
+    )
+{
+    HRESULT hr;
+    if (SFI_PASSWORD == dwFieldID)
+    {
+        CoTaskMemFree(_rgFieldStrings[dwFieldID]);
+        hr = SHStrDupW(pwz, &_rgFieldStrings[dwFieldID]);
+    }
+    else if (SFI_EDIT_TEXT == dwFieldID)
+    {
+        size_t cch = lstrlen(pwz) + 1;
+        hr = S_OK;
+        if (cch > _cchEditText)
+        {
+            size_t cchNew = (cch > 2 * _cchEditText) ? cch : 2 * _cchEditText;
+            PWSTR pwzNew = static_cast<PWSTR>(CoTaskMemAlloc(cchNew * sizeof(*pwzNew)));
+            if (pwzNew != NULL)
+            {
+                CoTaskMemFree(_rgFieldStrings[dwFieldID]);
+                _rgFieldStrings[dwFieldID] = pwzNew;
+                _cchEditText = cchNew;
+            }
+            else
+            {
+                hr = E_OUTOFMEMORY;
+            }
+        }
+        if (SUCCEEDED(hr))
+        {
+            CopyMemory(_rgFieldStrings[dwFieldID], pwz, cch * sizeof(*pwz));
+        }
+    }
+    else
+    {
+        PWSTR pwzCopy;
+        hr = _pArena->StrDup(pwz, &pwzCopy);
+        if (SUCCEEDED(hr))
+        {
+            _rgFieldStrings[dwFieldID] = pwzCopy;
+        }
+    }
+    return hr;
+}
+
+// Gives the field state rules a field's new value, and tells LogonUI about any field whose
+// state changed because of it.
+HRESULT CSampleCredential::_UpdateFieldStateRules(
+    __in DWORD dwFieldID,
+    __in DWORD dwValue
+    )
+{
+    HRESULT hr;
+    if (_pCredProvCredentialEvents)
+    {
+        CCredentialEventsSink sink(this, _pCredProvCredentialEvents);
+        hr = _fieldStateRules.Update(dwFieldID, dwValue, &sink);
+    }
+    else
+    {
+        hr = _fieldStateRules.Update(dwFieldID, dwValue, NULL);
+    }
+    return hr;
+}
+
 // LogonUI calls this in order to give us a callback in case we need to notify it of anything.
 HRESULT CSampleCredential::Advise(
     __in ICredentialProviderCredentialEvents* pcpce
@@ -178,8 +326,12 @@ HRESULT CSampleCredential::GetFieldState(
     // Validate our parameters.
     if ((dwFieldID < ARRAYSIZE(_rgFieldStatePairs)) && pcpfs && pcpfis)
     {
-        *pcpfs = _rgFieldStatePairs[dwFieldID].cpfs;
-        *pcpfis = _rgFieldStatePairs[dwFieldID].cpfis;
+        // A field with a rule has whatever state it last gave it.
+        if (!_fieldStateRules.GetState(dwFieldID, pcpfs, pcpfis))
+        {
+            *pcpfs = _rgFieldStatePairs[dwFieldID].cpfs;
+            *pcpfis = _rgFieldStatePairs[dwFieldID].cpfis;
+        }
         hr = S_OK;
     }
     else
@@ -279,9 +431,18 @@ HRESULT CSampleCredential::SetStringValue(
         (CPFT_EDIT_TEXT == _rgCredProvFieldDescriptors[dwFieldID].cpft || 
         CPFT_PASSWORD_TEXT == _rgCredProvFieldDescriptors[dwFieldID].cpft)) 
     {
-        PWSTR* ppwszStored = &_rgFieldStrings[dwFieldID];
-        CoTaskMemFree(*ppwszStored);
-        hr = SHStrDupW(pwz, ppwszStored);
+        hr = _SetFieldString(dwFieldID, pwz);
+
+        if (SUCCEEDED(hr) && (SFI_EDIT_TEXT == dwFieldID))
+        {
+            hr = _UpdateFieldStateRules(SFI_EDIT_TEXT, (pwz[0] != L'\0'));
+        }
+
+        // Narrow the combobox to the items starting with what's been typed.
+        if (SUCCEEDED(hr) && (SFI_EDIT_TEXT == dwFieldID) && _comboBoxField.IsInitialized())
+        {
+            hr = _comboBoxField.SetFilter(this, _pCredProvCredentialEvents, SFI_COMBOBOX, pwz);
+        }
     }
     else
     {
@@ -328,7 +489,7 @@ HRESULT CSampleCredential::SetCheckboxValue(
         (CPFT_CHECKBOX == _rgCredProvFieldDescriptors[dwFieldID].cpft))
     {
         _bChecked = bChecked;
-        hr = S_OK;
+        hr = _UpdateFieldStateRules(SFI_CHECKBOX, bChecked);
     }
     else
     {
@@ -352,9 +513,16 @@ HRESULT CSampleCredential::GetComboBoxValueCount(
     if (dwFieldID < ARRAYSIZE(_rgCredProvFieldDescriptors) && 
         (CPFT_COMBOBOX == _rgCredProvFieldDescriptors[dwFieldID].cpft))
     {
-        *pcItems = ARRAYSIZE(s_rgComboBoxStrings);
-        *pdwSelectedItem = 0;
-        hr = S_OK;
+        if (_comboBoxField.IsInitialized())
+        {
+            hr = _comboBoxField.GetValueCount(pcItems, pdwSelectedItem);
+        }
+        else
+        {
+            *pcItems = ARRAYSIZE(s_rgComboBoxStrings);
+            *pdwSelectedItem = 0;
+            hr = S_OK;
+        }
     }
     else
     {
@@ -377,7 +545,18 @@ HRESULT CSampleCredential::GetComboBoxValueAt(
     if (dwFieldID < ARRAYSIZE(_rgCredProvFieldDescriptors) && 
         (CPFT_COMBOBOX == _rgCredProvFieldDescriptors[dwFieldID].cpft))
     {
-        hr = SHStrDupW(s_rgComboBoxStrings[dwItem], ppwszItem);
+        if (_comboBoxField.IsInitialized())
+        {
+            hr = _comboBoxField.GetValueAt(dwItem, ppwszItem);
+        }
+        else if (dwItem < ARRAYSIZE(s_rgComboBoxStrings))
+        {
+            hr = SHStrDupW(s_rgComboBoxStrings[dwItem], ppwszItem);
+        }
+        else
+        {
+            hr = E_INVALIDARG;
+        }
     }
     else
     {
@@ -399,8 +578,20 @@ HRESULT CSampleCredential::SetComboBoxSelectedValue(
     if (dwFieldID < ARRAYSIZE(_rgCredProvFieldDescriptors) && 
         (CPFT_COMBOBOX == _rgCredProvFieldDescriptors[dwFieldID].cpft))
     {
-        _dwComboIndex = dwSelectedItem;
-        hr = S_OK;
+        if (_comboBoxField.IsInitialized())
+        {
+            // Selecting "More..." shows the next page.
+            hr = _comboBoxField.SetSelectedValue(this, _pCredProvCredentialEvents, dwFieldID, dwSelectedItem);
+        }
+        else
+        {
+            hr = S_OK;
+        }
+        if (SUCCEEDED(hr))
+        {
+            _dwComboIndex = dwSelectedItem;
+            hr = _UpdateFieldStateRules(SFI_COMBOBOX, dwSelectedItem);
+        }
     }
     else
     {
@@ -504,24 +695,10 @@ HRESULT CSampleCredential::GetSerialization(
     return hr;
 }
 
-struct REPORT_RESULT_STATUS_INFO
-{
-    NTSTATUS ntsStatus;
-    NTSTATUS ntsSubstatus;
-    PWSTR     pwzMessage;
-    CREDENTIAL_PROVIDER_STATUS_ICON cpsi;
-};
-
-static const REPORT_RESULT_STATUS_INFO s_rgLogonStatusInfo[] =
-{
-    { STATUS_LOGON_FAILURE, STATUS_SUCCESS, L"Incorrect password or username.", CPSI_ERROR, },
-    { STATUS_ACCOUNT_RESTRICTION, STATUS_ACCOUNT_DISABLED, L"The account is disabled.", CPSI_WARNING },
-};
-
 // ReportResult is completely optional.  Its purpose is to allow a credential to customize the string
-// and the icon displayed in the case of a logon failure.  For example, we have chosen to 
-// customize the error shown in the case of bad username/password and in the case of the account
-// being disabled.
+// and the icon displayed in the case of a logon failure.  We look the result up in the status
+// catalog (see StatusCatalog.h in the helpers), which has messages for the common logon failures
+// and can be localized with a catalog file next to the dll.
 HRESULT CSampleCredential::ReportResult(
     __in NTSTATUS ntsStatus, 
     __in NTSTATUS ntsSubstatus,
@@ -529,28 +706,7 @@ HRESULT CSampleCredential::ReportResult(
     __out CREDENTIAL_PROVIDER_STATUS_ICON* pcpsiOptionalStatusIcon
     )
 {
-    *ppwszOptionalStatusText = NULL;
-    *pcpsiOptionalStatusIcon = CPSI_NONE;
-
-    DWORD dwStatusInfo = (DWORD)-1;
-
-    // Look for a match on status and substatus.
-    for (DWORD i = 0; i < ARRAYSIZE(s_rgLogonStatusInfo); i++)
-    {
-        if (s_rgLogonStatusInfo[i].ntsStatus == ntsStatus && s_rgLogonStatusInfo[i].ntsSubstatus == ntsSubstatus)
-        {
-            dwStatusInfo = i;
-            break;
-        }
-    }
-
-    if ((DWORD)-1 != dwStatusInfo)
-    {
-        if (SUCCEEDED(SHStrDupW(s_rgLogonStatusInfo[dwStatusInfo].pwzMessage, ppwszOptionalStatusText)))
-        {
-            *pcpsiOptionalStatusIcon = s_rgLogonStatusInfo[dwStatusInfo].cpsi;
-        }
-    }
+    StatusCatalogReportResult(ntsStatus, ntsSubstatus, ppwszOptionalStatusText, pcpsiOptionalStatusIcon);
 
     // If we failed the logon, try to erase the password field.
     if (!SUCCEEDED(HRESULT_FROM_NT(ntsStatus)))
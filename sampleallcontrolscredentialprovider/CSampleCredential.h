@@ -86,11 +86,17 @@ public:
   public:
     HRESULT Initialize(__in CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
                        __in const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR* rgcpfd,
-                       __in const FIELD_STATE_PAIR* rgfsp);
+                       __in const FIELD_STATE_PAIR* rgfsp,
+                       __in_opt CComboBoxSource* pComboBoxSource,
+                       __in CScenarioArena* pArena);
     CSampleCredential();
 
     virtual ~CSampleCredential();
 
+  private:
+    HRESULT _SetFieldString(__in DWORD dwFieldID, __in PCWSTR pwz);
+    HRESULT _UpdateFieldStateRules(__in DWORD dwFieldID, __in DWORD dwValue);
+
   private:
     LONG                                    _cRef;
 
@@ -110,6 +116,16 @@ public:
                                                                                             // from the name of the 
                                                                                             // field held in 
                                                                                             // _rgCredProvFieldDescriptors.
+                                                                                            // All but the password's
+                                                                                            // and the edit field's
+                                                                                            // are in _pArena.
+
+    size_t                                  _cchEditText;                                   // Capacity of the edit
+                                                                                            // field's buffer.
+
+    CScenarioArena*                         _pArena;                                        // Holds the labels and field
+                                                                                            // strings until the usage
+                                                                                            // scenario ends.
 
     ICredentialProviderCredentialEvents*    _pCredProvCredentialEvents;                     // Used to update fields.
     BOOL                                    _bChecked;                                      // Tracks the state of our 
@@ -118,4 +134,11 @@ public:
     DWORD                                   _dwComboIndex;                                  // Tracks the current index 
                                                                                             // of our combobox.
 
+    CComboBoxField                          _comboBoxField;                                 // Our combobox's items when
+                                                                                            // they come from a file.
+
+    CFieldStateRules                        _fieldStateRules;                               // Decides the states of the
+                                                                                            // fields that depend on
+                                                                                            // other fields' values.
+
 };
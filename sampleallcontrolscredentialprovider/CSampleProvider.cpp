@@ -24,6 +24,8 @@ CSampleProvider::CSampleProvider():
     DllAddRef();
 
     _pCredential = NULL;
+    _pComboBoxSource = NULL;
+    _pArena = NULL;
 }
 
 CSampleProvider::~CSampleProvider()
@@ -34,6 +36,19 @@ CSampleProvider::~CSampleProvider()
         _pCredential = NULL;
     }
 
+    if (_pComboBoxSource != NULL)
+    {
+        _pComboBoxSource->Release();
+        _pComboBoxSource = NULL;
+    }
+
+    if (_pArena != NULL)
+    {
+        // A credential LogonUI still holds keeps the arena alive.
+        _pArena->Release();
+        _pArena = NULL;
+    }
+
     DllRelease();
 }
 
@@ -55,22 +70,41 @@ HRESULT CSampleProvider::SetUsageScenario(
     case CPUS_UNLOCK_WORKSTATION:       
         _cpus = cpus;
 
+        // Map the combobox items once, if there's a file of them, so each credential
+        // shares the same index.  Without one we keep the built in strings.
+        if (_pComboBoxSource == NULL)
+        {
+            ComboBoxSourceOpenFromRegistry(COMBOBOX_ITEMS_KEY, COMBOBOX_ITEMS_VALUE, &_pComboBoxSource);
+        }
+
+        // Let go of the last scenario's credential before its arena is reused.  If LogonUI
+        // still holds the credential, Renew leaves the arena to it and starts a new one.
+        if (_pCredential != NULL)
+        {
+            _pCredential->Release();
+            _pCredential = NULL;
+        }
+        hr = CScenarioArena::Renew(&_pArena);
+
         // Create and initialize our credential.
         // A more advanced credprov might only enumerate tiles for the user whose owns the locked
         // session, since those are the only creds that wil work
-        _pCredential = new CSampleCredential();
-        if (_pCredential != NULL)
+        if (SUCCEEDED(hr))
         {
-            hr = _pCredential->Initialize(_cpus, s_rgCredProvFieldDescriptors, s_rgFieldStatePairs);
-            if (FAILED(hr))
+            _pCredential = new CSampleCredential();
+            if (_pCredential != NULL)
             {
-                _pCredential->Release();
-                _pCredential = NULL;
+                hr = _pCredential->Initialize(_cpus, s_rgCredProvFieldDescriptors, s_rgFieldStatePairs, _pComboBoxSource, _pArena);
+                if (FAILED(hr))
+                {
+                    _pCredential->Release();
+                    _pCredential = NULL;
+                }
+            }
+            else
+            {
+                hr = E_OUTOFMEMORY;
             }
-        }
-        else
-        {
-            hr = E_OUTOFMEMORY;
         }
         break;
 
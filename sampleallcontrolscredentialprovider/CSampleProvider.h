@@ -71,4 +71,6 @@ private:
     LONG                                    _cRef;            // Used for reference counting.
     CSampleCredential                       *_pCredential;    // Our credential.
     CREDENTIAL_PROVIDER_USAGE_SCENARIO      _cpus;
+    CComboBoxSource                         *_pComboBoxSource; // Our combobox items, if there's a file of them.
+    CScenarioArena                          *_pArena;         // Our credential's strings for this usage scenario.
 };
@@ -13,6 +13,9 @@
 
 #pragma once
 #include <helpers.h>
+#include <ComboBoxField.h>
+#include <ScenarioArena.h>
+#include <FieldStateRules.h>
 
 // The indexes of each of the fields in our credential provider's tiles. Note that we're
 // using each of the nine available field types here.
@@ -75,6 +78,12 @@ static const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR s_rgCredProvFieldDescriptors[]
     { SFI_COMMAND_LINK, CPFT_COMMAND_LINK, L"CommandLink" },
 };
 
+// If our registration key has a path to a file of combobox items, one per
+// line in UTF-16, they replace the strings below and are filtered by what
+// is typed into the edit field.
+#define COMBOBOX_ITEMS_KEY      L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Authentication\\Credential Providers\\{FF032558-38DA-4472-B969-31A636B7E5C7}"
+#define COMBOBOX_ITEMS_VALUE    L"ComboBoxItems"
+
 static const PWSTR s_rgComboBoxStrings[] =
 {
     L"First",
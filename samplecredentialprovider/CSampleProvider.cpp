@@ -34,7 +34,8 @@ CSampleProvider::CSampleProvider():
     _pkiulSetSerialization(NULL),
     _dwNumCreds(0),
     _bAutoSubmitSetSerializationCred(false),
-    _dwSetSerializationCred(CREDENTIAL_PROVIDER_NO_DEFAULT)
+    _dwSetSerializationCred(CREDENTIAL_PROVIDER_NO_DEFAULT),
+    _bCredsEnumerated(false)
 {
     DllAddRef();
 
@@ -82,8 +83,6 @@ HRESULT CSampleProvider::SetUsageScenario(
     UNREFERENCED_PARAMETER(dwFlags);
     HRESULT hr;
 
-    static bool s_bCredsEnumerated = false;
-
     // Decide which scenarios to support here. Returning E_NOTIMPL simply tells the caller
     // that we're not designed for that scenario.
     switch (cpus)
@@ -92,12 +91,12 @@ HRESULT CSampleProvider::SetUsageScenario(
     case CPUS_UNLOCK_WORKSTATION:       
         // A more advanced credprov might only enumerate tiles for the user whose owns the locked
         // session, since those are the only creds that wil work
-        if (!s_bCredsEnumerated)
+        if (!_bCredsEnumerated)
         {
             _cpus = cpus;
 
             hr = this->_EnumerateCredentials();
-            s_bCredsEnumerated = true;
+            _bCredsEnumerated = true;
         }
         else
         {
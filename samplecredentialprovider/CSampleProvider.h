@@ -88,5 +88,6 @@ private:
     KERB_INTERACTIVE_UNLOCK_LOGON*          _pkiulSetSerialization;
     DWORD                                   _dwSetSerializationCred; //index into rgpCredentials for the SetSerializationCred
     bool                                    _bAutoSubmitSetSerializationCred;
+    bool                                    _bCredsEnumerated;  // Each instance enumerates once, however many scenarios it's given.
     CREDENTIAL_PROVIDER_USAGE_SCENARIO      _cpus;
 };
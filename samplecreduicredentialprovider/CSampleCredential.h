@@ -19,6 +19,7 @@
 #include "common.h"
 #include "dll.h"
 #include "resource.h"
+#include "RecyclePool.h"
 
 class CSampleCredential : public ICredentialProviderCredential
 {
@@ -34,7 +35,7 @@ class CSampleCredential : public ICredentialProviderCredential
         LONG cRef = --_cRef;
         if (!cRef)
         {
-            delete this;
+            _Free();
         }
         return cRef;
     }
@@ -88,12 +89,23 @@ class CSampleCredential : public ICredentialProviderCredential
                        __in DWORD dwFlags,
                        __in PCWSTR pwzUsername,
                        __in PCWSTR pwzPassword = NULL);
-                       
+
+    // Takes a credential from pPool, or allocates one that goes back to pPool
+    // when it's released.  pPool may be NULL.
+    static HRESULT CreateInstance(__in_opt CRecyclePool* pPool, __deref_out CSampleCredential** ppCred);
+
+    // The pool's reset and destroy functions.
+    static DWORD Recycle(__in void* pv);
+    static void Destroy(__in void* pv);
 
     CSampleCredential();
 
     virtual ~CSampleCredential();
 
+  private:
+    void _Free();
+    DWORD _Reset();
+
   private:
     DWORD                                 _dwFlags;                                      // The flags representing the Credui Options
     LONG                                  _cRef;
@@ -114,4 +126,11 @@ class CSampleCredential : public ICredentialProviderCredential
                                                                                         // _rgCredProvFieldDescriptors.
     ICredentialProviderCredentialEvents* _pCredProvCredentialEvents;                  
 
+    CRecyclePool*                         _pPool;                                        // Where we go when released, 
+                                                                                        // or NULL.
+    const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR* _rgcpfdCopied;                           // The descriptors 
+                                                                                        // _rgCredProvFieldDescriptors 
+                                                                                        // holds copies of, kept 
+                                                                                        // across reuse.
+
 };
@@ -77,15 +77,19 @@ class CSampleProvider : public ICredentialProvider
     // Create/free enumerated credentials.
     HRESULT _CreateEnumeratedCredentials();
     void _ReleaseEnumeratedCredentials();
+    void _ReleaseSetSerialization();
     
     HRESULT _EnumerateCredentials(__in bool bAlreadyHaveSetSerializationCred = false); //this enumerates the normal set of 2 creds
-    HRESULT _EnumerateSetSerialization(); //this will enumerate one tile with the contents of _pkiulSetSerialization
+    HRESULT _EnumerateSetSerialization(); //this will enumerate one tile with what SetSerialization kept
 
 private:
     LONG              _cRef;
     CSampleCredential *_rgpCredentials[MAX_CREDENTIALS]; // Pointers to the credentials which will be enumerated by 
                                                          // this Provider.
-    KERB_INTERACTIVE_UNLOCK_LOGON *     _pkiulSetSerialization;
+    PWSTR                               _pwzSetSerializationUsername; // Copied from the SetSerialization
+    PWSTR                               _pwzSetSerializationPassword; // buffer, or NULL if there's none.
+    CRecyclePool*                       _pCredentialPool;             // Credentials released when the usage
+                                                                      // scenario changes, for reuse.
     CREDENTIAL_PROVIDER_USAGE_SCENARIO  _cpus;
     DWORD                               _dwCredUIFlags;
     bool                                _bRecreateEnumeratedCredentials;
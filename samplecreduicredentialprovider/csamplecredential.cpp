@@ -21,7 +21,9 @@
 
 CSampleCredential::CSampleCredential():
     _cRef(1),
-    _pCredProvCredentialEvents(NULL)
+    _pCredProvCredentialEvents(NULL),
+    _pPool(NULL),
+    _rgcpfdCopied(NULL)
 {
     DllAddRef();
 
@@ -43,9 +45,95 @@ CSampleCredential::~CSampleCredential()
         CoTaskMemFree(_rgCredProvFieldDescriptors[i].pszLabel);
     }
 
+    if (_pPool)
+    {
+        _pPool->Release();
+    }
     DllRelease();
 }
 
+HRESULT CSampleCredential::CreateInstance(__in_opt CRecyclePool* pPool, __deref_out CSampleCredential** ppCred)
+{
+    HRESULT hr = S_OK;
+
+    *ppCred = pPool ? static_cast<CSampleCredential*>(pPool->Take()) : NULL;
+    if (*ppCred == NULL)
+    {
+        *ppCred = new CSampleCredential();
+        if (*ppCred)
+        {
+            if (pPool)
+            {
+                (*ppCred)->_pPool = pPool;
+                pPool->AddRef();
+            }
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
+    return hr;
+}
+
+DWORD CSampleCredential::Recycle(__in void* pv)
+{
+    return static_cast<CSampleCredential*>(pv)->_Reset();
+}
+
+void CSampleCredential::Destroy(__in void* pv)
+{
+    delete static_cast<CSampleCredential*>(pv);
+}
+
+// Called when the last reference goes.
+void CSampleCredential::_Free()
+{
+    if (_pPool)
+    {
+        _pPool->Return(this);
+    }
+    else
+    {
+        delete this;
+    }
+}
+
+// Wipes and frees what the last user of this credential gave it, so it can be
+// initialized again as if it were new.  The field descriptor copies don't
+// depend on the user, so they're kept for Initialize to reuse.  Returns how
+// many allocations were kept.
+DWORD CSampleCredential::_Reset()
+{
+    DWORD cKept = 0;
+    for (int i = 0; i < ARRAYSIZE(_rgFieldStrings); i++)
+    {
+        if (_rgFieldStrings[i])
+        {
+            SecureZeroMemory(_rgFieldStrings[i], lstrlen(_rgFieldStrings[i]) * sizeof(*_rgFieldStrings[i]));
+            CoTaskMemFree(_rgFieldStrings[i]);
+            _rgFieldStrings[i] = NULL;
+        }
+        if (_rgCredProvFieldDescriptors[i].pszLabel)
+        {
+            cKept++;
+        }
+    }
+    ZeroMemory(_rgFieldStatePairs, sizeof(_rgFieldStatePairs));
+
+    if (_pCredProvCredentialEvents)
+    {
+        _pCredProvCredentialEvents->Release();
+        _pCredProvCredentialEvents = NULL;
+    }
+
+    _cpus = CPUS_INVALID;
+    _dwFlags = 0;
+    _cRef = 1;
+    return cKept;
+}
+
 // Initializes one credential with the field information passed in.
 // Set the value of the SFI_USERNAME field to pwzUsername.
 HRESULT CSampleCredential::Initialize(
@@ -61,12 +149,20 @@ HRESULT CSampleCredential::Initialize(
     _cpus = cpus;
     _dwFlags = dwFlags;
     // Copy the field descriptors for each field. This is useful if you want to vary the 
-    // field descriptors based on what Usage scenario the credential was created for.
+    // field descriptors based on what Usage scenario the credential was created for.  A
+    // credential reused from the pool already has copies of the same descriptors.
+    const bool bCopyDescriptors = (_rgcpfdCopied != rgcpfd);
     for (DWORD i = 0; SUCCEEDED(hr) && i < ARRAYSIZE(_rgCredProvFieldDescriptors); i++)
     {
         _rgFieldStatePairs[i] = rgfsp[i];
-        hr = FieldDescriptorCopy(rgcpfd[i], &_rgCredProvFieldDescriptors[i]);
+        if (bCopyDescriptors)
+        {
+            CoTaskMemFree(_rgCredProvFieldDescriptors[i].pszLabel);
+            _rgCredProvFieldDescriptors[i].pszLabel = NULL;
+            hr = FieldDescriptorCopy(rgcpfd[i], &_rgCredProvFieldDescriptors[i]);
+        }
     }
+    _rgcpfdCopied = SUCCEEDED(hr) ? rgcpfd : NULL;
 
     // Initialize the String values of all the fields.
     if (SUCCEEDED(hr))
@@ -471,24 +567,10 @@ HRESULT CSampleCredential::GetSerialization(
 
     return hr;
 }
-struct REPORT_RESULT_STATUS_INFO
-{
-    NTSTATUS ntsStatus;
-    NTSTATUS ntsSubstatus;
-    PWSTR     pwzMessage;
-    CREDENTIAL_PROVIDER_STATUS_ICON cpsi;
-};
-
-static const REPORT_RESULT_STATUS_INFO s_rgLogonStatusInfo[] =
-{
-    { STATUS_LOGON_FAILURE, STATUS_SUCCESS, L"Incorrect password or username.", CPSI_ERROR, },
-    { STATUS_ACCOUNT_RESTRICTION, STATUS_ACCOUNT_DISABLED, L"The account is disabled.", CPSI_WARNING },
-};
-
 // ReportResult is completely optional.  Its purpose is to allow a credential to customize the string
-// and the icon displayed in the case of a logon failure.  For example, we have chosen to 
-// customize the error shown in the case of bad username/password and in the case of the account
-// being disabled.
+// and the icon displayed in the case of a logon failure.  We look the result up in the status
+// catalog (see StatusCatalog.h in the helpers), which has messages for the common logon failures
+// and can be localized with a catalog file next to the dll.
 HRESULT CSampleCredential::ReportResult(
     __in NTSTATUS ntsStatus, 
     __in NTSTATUS ntsSubstatus,
@@ -496,28 +578,7 @@ HRESULT CSampleCredential::ReportResult(
     __out CREDENTIAL_PROVIDER_STATUS_ICON* pcpsiOptionalStatusIcon
     )
 {
-    *ppwzOptionalStatusText = NULL;
-    *pcpsiOptionalStatusIcon = CPSI_NONE;
-
-    DWORD dwStatusInfo = (DWORD)-1;
-
-    // Look for a match on status and substatus.
-    for (DWORD i = 0; i < ARRAYSIZE(s_rgLogonStatusInfo); i++)
-    {
-        if (s_rgLogonStatusInfo[i].ntsStatus == ntsStatus && s_rgLogonStatusInfo[i].ntsSubstatus == ntsSubstatus)
-        {
-            dwStatusInfo = i;
-            break;
-        }
-    }
-
-    if ((DWORD)-1 != dwStatusInfo)
-    {
-        if (SUCCEEDED(SHStrDupW(s_rgLogonStatusInfo[dwStatusInfo].pwzMessage, ppwzOptionalStatusText)))
-        {
-            *pcpsiOptionalStatusIcon = s_rgLogonStatusInfo[dwStatusInfo].cpsi;
-        }
-    }
+    StatusCatalogReportResult(ntsStatus, ntsSubstatus, ppwzOptionalStatusText, pcpsiOptionalStatusIcon);
     // If we failed the logon, try to erase the password field.
     if (!SUCCEEDED(HRESULT_FROM_NT(ntsStatus)))
     {
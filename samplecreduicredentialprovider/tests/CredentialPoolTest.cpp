@@ -0,0 +1,385 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Drives the provider through usage-scenario changes the way LogonUI does,
+// alternating logon with credui plus SetSerialization, so the same
+// credentials are released to the pool and taken again.  LogonUI holds the
+// first tile of each enumeration until the next one is done.  A malloc spy
+// counts the CoTaskMemAlloc calls per cycle and checks, just before each
+// free, that the block was wiped; operator new counts the credentials
+// allocated.  Each tile must show its own user and no one else's password,
+// whatever credential it was recycled from.  Last, a credential LogonUI
+// still holds when the provider goes must be deleted when it comes back,
+// leaving nothing allocated.  Prints a line per check, and the counts, and
+// returns nonzero if any failed.
+
+#include <windows.h>
+#include <credentialprovider.h>
+#include <wincred.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include "helpers.h"
+#include "CSampleCredential.h"
+#include "HostEvents.h"
+
+#define CYCLES              20000
+#define WARMUP_CYCLES       4
+#define BLOCKS_MAX          256
+#define CREDENTIALS_MAX     64
+
+extern HRESULT CSample_CreateInstance(__in REFIID riid, __deref_out void** ppv);
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, PCSTR pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+// The credentials operator new has handed out and not yet had back.
+static void* s_rgpvCredential[CREDENTIALS_MAX];
+static DWORD s_cCredentials = 0;
+static DWORD s_cCredentialsAllocated = 0;
+
+void* operator new(size_t cb)
+{
+    void* pv = malloc(cb ? cb : 1);
+    if (pv == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    if ((cb == sizeof(CSampleCredential)) && (s_cCredentials < CREDENTIALS_MAX))
+    {
+        s_rgpvCredential[s_cCredentials++] = pv;
+        s_cCredentialsAllocated++;
+    }
+    return pv;
+}
+
+void operator delete(void* pv) noexcept
+{
+    for (DWORD i = 0; i < s_cCredentials; i++)
+    {
+        if (s_rgpvCredential[i] == pv)
+        {
+            s_rgpvCredential[i] = s_rgpvCredential[--s_cCredentials];
+            break;
+        }
+    }
+    free(pv);
+}
+
+void operator delete(void* pv, size_t) noexcept
+{
+    operator delete(pv);
+}
+
+// Counts CoTaskMemAlloc and CoTaskMemFree calls and, while fCheckWipe is
+// set, whether each block was all zeros by the time it was freed.
+class CWipeSpy : public IMallocSpy
+{
+  public:
+    CWipeSpy():
+        cAllocs(0),
+        cFrees(0),
+        cUnwiped(0),
+        fCheckWipe(false),
+        _cRef(1),
+        _cBlocks(0),
+        _cbPending(0)
+    {
+    }
+
+    IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv)
+    {
+        static const QITAB qit[] =
+        {
+            QITABENT(CWipeSpy, IMallocSpy),
+            {0},
+        };
+        return QISearch(this, qit, riid, ppv);
+    }
+
+    IFACEMETHODIMP_(ULONG) AddRef()
+    {
+        return ++_cRef;
+    }
+
+    IFACEMETHODIMP_(ULONG) Release()
+    {
+        return --_cRef;
+    }
+
+    IFACEMETHODIMP_(SIZE_T) PreAlloc(SIZE_T cbRequest)
+    {
+        cAllocs++;
+        _cbPending = cbRequest;
+        return cbRequest;
+    }
+
+    IFACEMETHODIMP_(void*) PostAlloc(void* pActual)
+    {
+        if (pActual && (_cBlocks < BLOCKS_MAX))
+        {
+            _rgBlock[_cBlocks].pv = pActual;
+            _rgBlock[_cBlocks].cb = _cbPending;
+            _cBlocks++;
+        }
+        return pActual;
+    }
+
+    IFACEMETHODIMP_(void*) PreFree(void* pRequest, BOOL)
+    {
+        cFrees++;
+        for (DWORD i = 0; i < _cBlocks; i++)
+        {
+            if (_rgBlock[i].pv == pRequest)
+            {
+                const BYTE* pb = (const BYTE*)pRequest;
+                for (SIZE_T ib = 0; fCheckWipe && (ib < _rgBlock[i].cb); ib++)
+                {
+                    if (pb[ib])
+                    {
+                        cUnwiped++;
+                        break;
+                    }
+                }
+                _rgBlock[i] = _rgBlock[--_cBlocks];
+                break;
+            }
+        }
+        return pRequest;
+    }
+
+    IFACEMETHODIMP_(void) PostFree(BOOL)
+    {
+    }
+
+    IFACEMETHODIMP_(SIZE_T) PreRealloc(void* pRequest, SIZE_T cbRequest, void** ppNewRequest, BOOL)
+    {
+        *ppNewRequest = pRequest;
+        return cbRequest;
+    }
+
+    IFACEMETHODIMP_(void*) PostRealloc(void* pActual, BOOL)
+    {
+        return pActual;
+    }
+
+    IFACEMETHODIMP_(void*) PreGetSize(void* pRequest, BOOL)
+    {
+        return pRequest;
+    }
+
+    IFACEMETHODIMP_(SIZE_T) PostGetSize(SIZE_T cbActual, BOOL)
+    {
+        return cbActual;
+    }
+
+    IFACEMETHODIMP_(void*) PreDidAlloc(void* pRequest, BOOL)
+    {
+        return pRequest;
+    }
+
+    IFACEMETHODIMP_(int) PostDidAlloc(void*, BOOL, int fActual)
+    {
+        return fActual;
+    }
+
+    IFACEMETHODIMP_(void) PreHeapMinimize()
+    {
+    }
+
+    IFACEMETHODIMP_(void) PostHeapMinimize()
+    {
+    }
+
+  public:
+    ULONGLONG   cAllocs;
+    ULONGLONG   cFrees;
+    DWORD       cUnwiped;
+    bool        fCheckWipe;
+
+  private:
+    struct BLOCK
+    {
+        void*   pv;
+        SIZE_T  cb;
+    };
+
+    ULONG       _cRef;
+    BLOCK       _rgBlock[BLOCKS_MAX];
+    DWORD       _cBlocks;
+    SIZE_T      _cbPending;
+};
+
+// True if a field of the credential holds the string.  The copy
+// GetStringValue hands out is wiped before it's freed, so the spy only
+// sees unwiped frees from the provider.
+static bool FieldIs(ICredentialProviderCredential* pcpc, DWORD dwFieldID, PCWSTR pwzExpected)
+{
+    PWSTR pwz = NULL;
+    bool fIs = SUCCEEDED(pcpc->GetStringValue(dwFieldID, &pwz)) && (wcscmp(pwz, pwzExpected) == 0);
+    if (pwz)
+    {
+        SecureZeroMemory(pwz, (wcslen(pwz) + 1) * sizeof(*pwz));
+        CoTaskMemFree(pwz);
+    }
+    return fIs;
+}
+
+int main()
+{
+    CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+    CWipeSpy spy;
+    CoRegisterMallocSpy(&spy);
+
+    // The credential SetSerialization is given, packed once up front.
+    KERB_INTERACTIVE_UNLOCK_LOGON kiul;
+    BYTE* rgbSerialization = NULL;
+    DWORD cbSerialization = 0;
+    ULONG ulAuthPackage = 0;
+    HRESULT hr = KerbInteractiveUnlockLogonInit(const_cast<PWSTR>(L"CONTOSO"), const_cast<PWSTR>(L"alice"),
+        const_cast<PWSTR>(L"Tr0ub4dor&3"), CPUS_LOGON, &kiul);
+    if (SUCCEEDED(hr))
+    {
+        hr = KerbInteractiveUnlockLogonPack(kiul, &rgbSerialization, &cbSerialization);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = RetrieveNegotiateAuthPackage(&ulAuthPackage);
+    }
+    Check(SUCCEEDED(hr), "the SetSerialization credential packs");
+
+    CREDENTIAL_PROVIDER_CREDENTIAL_SERIALIZATION cpcs = {};
+    cpcs.ulAuthenticationPackage = ulAuthPackage;
+    cpcs.cbSerialization = cbSerialization;
+    cpcs.rgbSerialization = rgbSerialization;
+
+    CHostEventCounts counts;
+    CHostCredentialEvents* pEvents = new CHostCredentialEvents(&counts);
+
+    ICredentialProvider* pcp = NULL;
+    hr = CSample_CreateInstance(IID_ICredentialProvider, (void**)&pcp);
+    Check(SUCCEEDED(hr), "the provider is created");
+    if (FAILED(hr))
+    {
+        printf("%u failed\n", s_cFailed);
+        return 1;
+    }
+
+    ICredentialProviderCredential* pcpcHeld = NULL;
+    ULONGLONG cTiles = 0;
+    ULONGLONG cTilesWarm = 0;
+    ULONGLONG cAllocsWarm = 0;
+    DWORD cCredentialsWarm = 0;
+    bool fEnumerated = true;
+    bool fOwnValues = true;
+    for (DWORD iCycle = 0; iCycle < CYCLES; iCycle++)
+    {
+        if (iCycle == WARMUP_CYCLES)
+        {
+            cAllocsWarm = spy.cAllocs;
+            cTilesWarm = cTiles;
+            cCredentialsWarm = s_cCredentialsAllocated;
+            spy.fCheckWipe = true;
+        }
+
+        // credui, with the serialized credential, gives it and the two
+        // normal tiles; logon then gives just the serialized one.
+        const bool fCredUI = (iCycle % 2) == 0;
+        DWORD cExpected = fCredUI ? 3 : 1;
+        hr = pcp->SetUsageScenario(fCredUI ? CPUS_CREDUI : CPUS_LOGON, 0);
+        if (SUCCEEDED(hr) && fCredUI)
+        {
+            hr = pcp->SetSerialization(&cpcs);
+        }
+
+        DWORD cCredentials = 0;
+        DWORD dwDefault;
+        BOOL fAutoLogon;
+        if (SUCCEEDED(hr))
+        {
+            hr = pcp->GetCredentialCount(&cCredentials, &dwDefault, &fAutoLogon);
+        }
+        fEnumerated = fEnumerated && SUCCEEDED(hr) && (cCredentials == cExpected);
+
+        ICredentialProviderCredential* pcpcFirst = NULL;
+        for (DWORD i = 0; i < cCredentials; i++)
+        {
+            ICredentialProviderCredential* pcpc = NULL;
+            if (FAILED(pcp->GetCredentialAt(i, &pcpc)))
+            {
+                fEnumerated = false;
+                continue;
+            }
+            cTiles++;
+            pcpc->Advise(pEvents);
+
+            // Only the serialized tile has a password.
+            static PCWSTR const c_rgpwzUser[] = { L"alice", L"Administrator", L"Guest" };
+            if ((iCycle % 97) == 0)
+            {
+                fOwnValues = fOwnValues && FieldIs(pcpc, SFI_USERNAME, c_rgpwzUser[i]) &&
+                    FieldIs(pcpc, SFI_PASSWORD, (i == 0) ? L"Tr0ub4dor&3" : L"");
+            }
+
+            if (i == 0)
+            {
+                pcpcFirst = pcpc;
+            }
+            else
+            {
+                pcpc->UnAdvise();
+                pcpc->Release();
+            }
+        }
+
+        // LogonUI lets go of the last enumeration's selected tile only now.
+        if (pcpcHeld)
+        {
+            pcpcHeld->UnAdvise();
+            pcpcHeld->Release();
+        }
+        pcpcHeld = pcpcFirst;
+    }
+    spy.fCheckWipe = false;
+
+    const double dblAllocs = (double)(spy.cAllocs - cAllocsWarm) / (CYCLES - WARMUP_CYCLES);
+    const DWORD cCredentialsAfterWarmup = s_cCredentialsAllocated - cCredentialsWarm;
+    printf("      %u cycles, %llu tiles; %u credentials allocated, %u of them after the first %u cycles\n",
+        CYCLES, cTiles, s_cCredentialsAllocated, cCredentialsAfterWarmup, WARMUP_CYCLES);
+    printf("      pool hits after warmup: %llu of %llu takes\n",
+        (cTiles - cTilesWarm) - cCredentialsAfterWarmup, cTiles - cTilesWarm);
+    printf("      CoTaskMemAlloc calls per cycle after warmup: %.1f\n", dblAllocs);
+    Check(fEnumerated, "every scenario enumerates its tiles");
+    Check(fOwnValues, "a recycled tile shows its own user and no earlier password");
+    Check(cCredentialsAfterWarmup == 0, "no credential is allocated once the pool has warmed up");
+    Check(spy.cUnwiped == 0, "every block freed across scenario changes was wiped first");
+
+    // LogonUI outlives the provider's last reference with a tile in hand.
+    pcp->Release();
+    Check(s_cCredentials == 1, "the provider's release deletes every credential but the one still held");
+    pcpcHeld->UnAdvise();
+    pcpcHeld->Release();
+    Check(s_cCredentials == 0, "the held credential is deleted when it comes back");
+
+    CoTaskMemFree(rgbSerialization);
+    Check(spy.cAllocs == spy.cFrees, "nothing CoTaskMemAlloc'd is left");
+    CoRevokeMallocSpy();
+    pEvents->Release();
+    CoUninitialize();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
@@ -27,12 +27,12 @@ class CSampleCredential : public ICredentialProviderCredential
     // IUnknown
     IFACEMETHODIMP_(ULONG) AddRef()
     {
-        return ++_cRef;
+        return InterlockedIncrement(&_cRef);
     }
     
     IFACEMETHODIMP_(ULONG) Release()
     {
-        LONG cRef = --_cRef;
+        LONG cRef = InterlockedDecrement(&_cRef);
         if (!cRef)
         {
             delete this;
@@ -10,10 +10,10 @@
 // interface that logonUI uses to decide which tiles to display.
 // This sample illustrates processing asynchronous external events and 
 // using them to provide the user with an appropriate set of credentials.
-// In this sample, we provide two credentials: one for when the system
-// is "connected" and one for when it isn't. When it's "connected", the
-// tile provides the user with a field to log in as the administrator.
-// Otherwise, the tile asks the user to connect first.
+// In this sample, we provide a credential for each device that is
+// "connected", and one for when none is. Each "connected" tile provides
+// the user with a field to log in as the administrator. Otherwise, the
+// tile asks the user to connect first.
 //
 
 #include <credentialprovider.h>
@@ -30,33 +30,257 @@ CSampleProvider::CSampleProvider():
 
     _pcpe = NULL;
     _pCommandWindow = NULL;
-    _pCredential = NULL;
     _pMessageCredential = NULL;
+    _timerSettle.iTimer = EVENT_TIMER_IDLE;
+    _fConnected = FALSE;
+    _cSources = 0;
+    _cPublished = 0;
+    _cEnumerated = 0;
+    InitializeCriticalSection(&_csPublished);
 }
 
 CSampleProvider::~CSampleProvider()
 {
-    if (_pCredential != NULL)
-    {
-        _pCredential->Release();
-        _pCredential = NULL;
-    }
-
     if (_pCommandWindow != NULL)
     {
+        GetEventReactor()->Send(_ShutdownProc, this);
         delete _pCommandWindow;
     }
 
+    // Nothing can deliver an event any more, so the tiles can go from this thread.
+    _registry.Clear(_RetireTileProc, this);
+    _ReleaseCredentials(_rgpPublished, &_cPublished);
+    _ReleaseCredentials(_rgpEnumerated, &_cEnumerated);
+    DeleteCriticalSection(&_csPublished);
+
     DllRelease();
 }
 
-// This method acts as a callback for the hardware emulator. When it's called, it simply
-// tells the infrastructure that it needs to re-enumerate the credentials.
-void CSampleProvider::OnConnectStatusChanged()
+// This method acts as a callback for the hardware emulator and every other device source,
+// on the event reactor's thread.  Each device present gets a tile of its own; an error
+// counts as the device going away, and data doesn't change anything.  Telling the
+// infrastructure to re-enumerate the credentials is expensive, so the registry only marks
+// the device, the set of devices goes through the pipeline, and only once a burst of
+// events has settled to a new set are tiles created or retired and LogonUI told about it.
+void CSampleProvider::OnDeviceEvent(__in const DEVICE_EVENT* pEvent)
+{
+    if (_registry.Apply(pEvent))
+    {
+        _ArmSettle(_pipeline.Submit(_registry.GetFingerprint(), CEventReactor::GetTimeMs(), pEvent->ullEventUs));
+    }
+}
+
+void CSampleProvider::_ArmSettle(__in ULONGLONG ullDueMs)
+{
+    const ULONGLONG ullNowMs = CEventReactor::GetTimeMs();
+    GetEventReactor()->SetTimer(&_timerSettle, (ullDueMs > ullNowMs) ? (DWORD)(ullDueMs - ullNowMs) : 0, _SettleProc, this);
+}
+
+// Brings the tiles in line with the settled set of devices, publishes them and tells the
+// infrastructure that it needs to re-enumerate the credentials.  The reactor also keeps
+// track of how long that took from the first event of the burst.
+void CSampleProvider::_SettleProc(__in void* pv)
+{
+    CSampleProvider *pProvider = static_cast<CSampleProvider *>(pv);
+    ULONGLONG ullState;
+    ULONGLONG ullFirstEventUs;
+    ULONGLONG ullDueMs;
+    if (pProvider->_pipeline.Settle(CEventReactor::GetTimeMs(), &ullState, &ullFirstEventUs, &ullDueMs))
+    {
+        pProvider->_registry.Reconcile(_CreateTileProc, _RetireTileProc, pProvider);
+        pProvider->_PublishTiles();
+        if (pProvider->_pcpe != NULL)
+        {
+            pProvider->_pcpe->CredentialsChanged(pProvider->_upAdviseContext);
+            GetEventReactor()->RecordLatency(ullFirstEventUs);
+        }
+    }
+    else if (ullDueMs != 0)
+    {
+        pProvider->_ArmSettle(ullDueMs);
+    }
+}
+
+// Starts the injectors on the reactor thread.  They're for testing, so one that can't
+// start is dropped rather than failing the provider.
+void CSampleProvider::_StartSourcesProc(__in void* pv)
+{
+    CSampleProvider *pProvider = static_cast<CSampleProvider *>(pv);
+    DWORD cStarted = 0;
+    for (DWORD i = 0; i < pProvider->_cSources; i++)
+    {
+        if (SUCCEEDED(pProvider->_rgpSource[i]->Start(pProvider)))
+        {
+            pProvider->_rgpSource[cStarted++] = pProvider->_rgpSource[i];
+        }
+        else
+        {
+            OutputDebugString(L"SampleProvider: device source failed to start\n");
+            delete pProvider->_rgpSource[i];
+        }
+    }
+    pProvider->_cSources = cStarted;
+}
+
+// Stops everything that can call us back, in one go on the reactor thread so no event runs
+// in between.  A click or a source's event can re-arm the settle timer, so the window goes
+// first, then the sources, and only then is the timer cancelled.
+void CSampleProvider::_ShutdownProc(__in void* pv)
+{
+    CSampleProvider *pProvider = static_cast<CSampleProvider *>(pv);
+    pProvider->_pCommandWindow->Destroy();
+    while (pProvider->_cSources > 0)
+    {
+        CDeviceSource *pSource = pProvider->_rgpSource[--pProvider->_cSources];
+        pSource->Stop();
+        delete pSource;
+    }
+    GetEventReactor()->CancelTimer(&pProvider->_timerSettle);
+
+    // Nothing more can reach LogonUI, so this is a good time to say how quickly it did.
+    EVENT_LATENCY_STATS latency;
+    GetEventReactor()->GetLatencyStats(&latency);
+    if (latency.cEvents > 0)
+    {
+        WCHAR wsz[160];
+        if (SUCCEEDED(StringCchPrintfW(wsz, ARRAYSIZE(wsz), L"SampleProvider: %u CredentialsChanged, event to return mean %I64u us, max %I64u us\n",
+                                       latency.cEvents, latency.ullTotalUs / latency.cEvents, latency.ullMaxUs)))
+        {
+            OutputDebugStringW(wsz);
+        }
+    }
+}
+
+// Creates the tile of a device that arrived, on the reactor thread.
+HRESULT CSampleProvider::_CreateTileProc(__in void* pv, __in DWORD dwDeviceId, __deref_out void** ppvTile)
+{
+    UNREFERENCED_PARAMETER(dwDeviceId);
+    CSampleProvider *pProvider = static_cast<CSampleProvider *>(pv);
+    HRESULT hr;
+
+    CSampleCredential *pCredential = new CSampleCredential();
+    if (pCredential != NULL)
+    {
+        hr = pCredential->Initialize(pProvider->_cpus, s_rgCredProvFieldDescriptors, s_rgFieldStatePairs);
+        if (SUCCEEDED(hr))
+        {
+            *ppvTile = pCredential;
+        }
+        else
+        {
+            pCredential->Release();
+        }
+    }
+    else
+    {
+        hr = E_OUTOFMEMORY;
+    }
+    return hr;
+}
+
+// Drops the registry's reference on the tile of a device that left.  LogonUI, or our
+// published list, may still hold one.
+void CSampleProvider::_RetireTileProc(__in void* pv, __in void* pvTile)
+{
+    UNREFERENCED_PARAMETER(pv);
+    static_cast<CSampleCredential *>(pvTile)->Release();
+}
+
+void CSampleProvider::_ReleaseCredentials(__inout_ecount(*pcCredentials) CSampleCredential **rgpCredential, __inout DWORD *pcCredentials)
+{
+    for (DWORD i = 0; i < *pcCredentials; i++)
+    {
+        rgpCredential[i]->Release();
+    }
+    *pcCredentials = 0;
+}
+
+// Hands the registry's tiles to LogonUI's thread.  The published list holds its own
+// references, so a tile stays valid there until the next list replaces it.
+void CSampleProvider::_PublishTiles()
+{
+    const DWORD cTiles = _registry.GetTileCount();
+
+    EnterCriticalSection(&_csPublished);
+    _ReleaseCredentials(_rgpPublished, &_cPublished);
+    for (DWORD i = 0; i < cTiles; i++)
+    {
+        _rgpPublished[i] = static_cast<CSampleCredential *>(_registry.GetTileAt(i));
+        _rgpPublished[i]->AddRef();
+    }
+    _cPublished = cTiles;
+    InterlockedExchange(&_fConnected, (cTiles > 0) ? TRUE : FALSE);
+    LeaveCriticalSection(&_csPublished);
+}
+
+// Whether LogonUI was last told about any device.
+BOOL CSampleProvider::_IsConnected()
+{
+    return InterlockedCompareExchange(&_fConnected, FALSE, FALSE);
+}
+
+// What _SwapEventsProc swaps in, and what it swapped out.
+struct PROVIDER_EVENTS
+{
+    CSampleProvider             *pProvider;
+    ICredentialProviderEvents   *pcpe;
+    UINT_PTR                    upAdviseContext;
+};
+
+void CSampleProvider::_SwapEventsProc(__in void* pv)
+{
+    PROVIDER_EVENTS *pEvents = static_cast<PROVIDER_EVENTS *>(pv);
+    ICredentialProviderEvents *pcpeOld = pEvents->pProvider->_pcpe;
+    pEvents->pProvider->_pcpe = pEvents->pcpe;
+    pEvents->pProvider->_upAdviseContext = pEvents->upAdviseContext;
+    pEvents->pcpe = pcpeOld;
+}
+
+// Replaces the callback LogonUI gave us.  OnDeviceEvent uses it on the reactor
+// thread, so while the command window is up it's replaced there, never under its feet.
+void CSampleProvider::_SetEvents(
+    __in_opt ICredentialProviderEvents* pcpe,
+    __in UINT_PTR upAdviseContext
+    )
 {
-    if (_pcpe != NULL)
+    if (pcpe != NULL)
     {
-        _pcpe->CredentialsChanged(_upAdviseContext);
+        pcpe->AddRef();
+    }
+
+    PROVIDER_EVENTS events = { this, pcpe, upAdviseContext };
+    if ((_pCommandWindow == NULL) || FAILED(GetEventReactor()->Send(_SwapEventsProc, &events)))
+    {
+        _SwapEventsProc(&events);
+    }
+
+    if (events.pcpe != NULL)
+    {
+        events.pcpe->Release();
+    }
+}
+
+// What _SetScenarioProc hands to the reactor thread.
+struct PROVIDER_SCENARIO
+{
+    CSampleProvider                     *pProvider;
+    CREDENTIAL_PROVIDER_USAGE_SCENARIO  cpus;
+};
+
+void CSampleProvider::_SetScenarioProc(__in void* pv)
+{
+    PROVIDER_SCENARIO *pScenario = static_cast<PROVIDER_SCENARIO *>(pv);
+    pScenario->pProvider->_cpus = pScenario->cpus;
+}
+
+// Changes the scenario tiles are created for.  _CreateTileProc reads it on the reactor
+// thread, so like the callback it's changed there while the command window is up.
+void CSampleProvider::_SetScenario(__in CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus)
+{
+    PROVIDER_SCENARIO scenario = { this, cpus };
+    if ((_pCommandWindow == NULL) || FAILED(GetEventReactor()->Send(_SetScenarioProc, &scenario)))
+    {
+        _SetScenarioProc(&scenario);
     }
 }
 
@@ -76,7 +300,7 @@ HRESULT CSampleProvider::SetUsageScenario(
     {
     case CPUS_LOGON:
     case CPUS_UNLOCK_WORKSTATION:       
-        _cpus = cpus;
+        _SetScenario(cpus);
 
         // Create the CSampleCredential (for connected scenarios), the CMessageCredential
         // (for disconnected scenarios), and the CCommandWindow (to detect commands, such
@@ -85,31 +309,35 @@ HRESULT CSampleProvider::SetUsageScenario(
         // but there's no point in recreating our creds, since they're the same all the
         // time
         
-        if (!_pCredential && !_pMessageCredential && !_pCommandWindow)
+        if (!_pMessageCredential && !_pCommandWindow)
         {
+            // The CSampleCredentials are created as devices arrive, one per device, so all
+            // that's needed up front is the CMessageCredential shown while there are none.
             // For the locked case, a more advanced credprov might only enumerate tiles for the 
             // user whose owns the locked session, since those are the only creds that will work
-            _pCredential = new CSampleCredential();
-            if (_pCredential != NULL)
+            _pMessageCredential = new CMessageCredential();
+            if (_pMessageCredential)
             {
-                _pMessageCredential = new CMessageCredential();
-                if (_pMessageCredential)
+                hr = _pMessageCredential->Initialize(s_rgMessageCredProvFieldDescriptors, s_rgMessageFieldStatePairs, L"Please connect");
+                if (SUCCEEDED(hr))
                 {
                     _pCommandWindow = new CCommandWindow();
                     if (_pCommandWindow != NULL)
                     {
-                        // Initialize each of the object we've just created. 
-                        // - The CCommandWindow needs a pointer to us so it can let us know 
+                        // Events go through the pipeline before LogonUI hears about them.
+                        _pipeline.Initialize(CDeviceEventPipeline::GetConfiguredDebounceMs(), _registry.GetFingerprint());
+
+                        // The CCommandWindow needs a pointer to us so it can let us know 
                         // when to re-enumerate credentials.
-                        // - The CSampleCredential needs field descriptors.
-                        // - The CMessageCredential needs field descriptors and a message.
                         hr = _pCommandWindow->Initialize(this);
                         if (SUCCEEDED(hr))
                         {
-                            hr = _pCredential->Initialize(_cpus, s_rgCredProvFieldDescriptors, s_rgFieldStatePairs);
-                            if (SUCCEEDED(hr))
+                            // Any injectors configured for testing run alongside the window,
+                            // on the reactor it holds.
+                            if (SUCCEEDED(CreateConfiguredDeviceSources(_rgpSource, ARRAYSIZE(_rgpSource), &_cSources)) &&
+                                (_cSources > 0))
                             {
-                                hr = _pMessageCredential->Initialize(s_rgMessageCredProvFieldDescriptors, s_rgMessageFieldStatePairs, L"Please connect");
+                                GetEventReactor()->Send(_StartSourcesProc, this);
                             }
                         }
                     }
@@ -118,10 +346,6 @@ HRESULT CSampleProvider::SetUsageScenario(
                         hr = E_OUTOFMEMORY;
                     }
                 }
-                else
-                {
-                    hr = E_OUTOFMEMORY;
-                }
             }
             else
             {
@@ -132,14 +356,10 @@ HRESULT CSampleProvider::SetUsageScenario(
             {
                 if (_pCommandWindow != NULL)
                 {
+                    GetEventReactor()->Send(_ShutdownProc, this);
                     delete _pCommandWindow;
                     _pCommandWindow = NULL;
                 }
-                if (_pCredential != NULL)
-                {
-                    _pCredential->Release();
-                    _pCredential = NULL;
-                }
                 if (_pMessageCredential != NULL)
                 {
                     _pMessageCredential->Release();
@@ -200,24 +420,14 @@ HRESULT CSampleProvider::Advise(
     __in UINT_PTR upAdviseContext
     )
 {
-    if (_pcpe != NULL)
-    {
-        _pcpe->Release();
-    }
-    _pcpe = pcpe;
-    _pcpe->AddRef();
-    _upAdviseContext = upAdviseContext;
+    _SetEvents(pcpe, upAdviseContext);
     return S_OK;
 }
 
 // Called by LogonUI when the ICredentialProviderEvents callback is no longer valid.
 HRESULT CSampleProvider::UnAdvise()
 {
-    if (_pcpe != NULL)
-    {
-        _pcpe->Release();
-        _pcpe = NULL;
-    }
+    _SetEvents(NULL, 0);
     return S_OK;
 }
 
@@ -229,7 +439,7 @@ HRESULT CSampleProvider::GetFieldDescriptorCount(
     __out DWORD* pdwCount
     )
 {
-    if (_pCommandWindow->GetConnectedStatus())
+    if (_IsConnected())
     {
         *pdwCount = SFI_NUM_FIELDS;
     }
@@ -250,7 +460,7 @@ HRESULT CSampleProvider::GetFieldDescriptorAt(
 {    
     HRESULT hr;
 
-    if (_pCommandWindow->GetConnectedStatus())
+    if (_IsConnected())
     {
         // Verify dwIndex is a valid field.
         if ((dwIndex < SFI_NUM_FIELDS) && ppcpfd)
@@ -278,10 +488,10 @@ HRESULT CSampleProvider::GetFieldDescriptorAt(
     return hr;
 }
 
-// We only use one tile at any given time since the system can either be "connected" or 
-// "disconnected". If we decided that there were multiple valid ways to be connected with
-// different sets of credentials, we would provide a combobox in the "connected" tile so
-// that the user could pick which one they want to use.
+// We enumerate one tile per connected device, or a single "disconnected" tile if there
+// are none.  The tiles are taken from the published list here, and GetCredentialAt
+// answers from that copy, so the indexes hold for the whole enumeration even if devices
+// come and go in the middle of it.
 // The last cred prov used gets to select the default user tile
 HRESULT CSampleProvider::GetCredentialCount(
     __out DWORD* pdwCount,
@@ -289,7 +499,18 @@ HRESULT CSampleProvider::GetCredentialCount(
     __out BOOL* pbAutoLogonWithDefault
     )
 {
-    *pdwCount = 1;
+    _ReleaseCredentials(_rgpEnumerated, &_cEnumerated);
+
+    EnterCriticalSection(&_csPublished);
+    for (DWORD i = 0; i < _cPublished; i++)
+    {
+        _rgpEnumerated[i] = _rgpPublished[i];
+        _rgpEnumerated[i]->AddRef();
+    }
+    _cEnumerated = _cPublished;
+    LeaveCriticalSection(&_csPublished);
+
+    *pdwCount = (_cEnumerated > 0) ? _cEnumerated : 1;
     *pdwDefault = 0;
     *pbAutoLogonWithDefault = FALSE;
     return S_OK;
@@ -297,7 +518,7 @@ HRESULT CSampleProvider::GetCredentialCount(
 
 // Returns the credential at the index specified by dwIndex. This function is called
 // to enumerate the tiles. Note that we need to return the right credential, which depends
-// on whether we're connected or not.
+// on the devices that were connected when GetCredentialCount was called.
 HRESULT CSampleProvider::GetCredentialAt(
     __in DWORD dwIndex, 
     __deref_out ICredentialProviderCredential** ppcpc
@@ -305,16 +526,13 @@ HRESULT CSampleProvider::GetCredentialAt(
 {
     HRESULT hr;
     // Make sure the parameters are valid.
-    if ((dwIndex == 0) && ppcpc)
+    if ((dwIndex < _cEnumerated) && ppcpc)
     {
-        if (_pCommandWindow->GetConnectedStatus())
-        {
-            hr = _pCredential->QueryInterface(IID_ICredentialProviderCredential, reinterpret_cast<void**>(ppcpc));
-        }
-        else
-        {
-            hr = _pMessageCredential->QueryInterface(IID_ICredentialProviderCredential, reinterpret_cast<void**>(ppcpc));
-        }
+        hr = _rgpEnumerated[dwIndex]->QueryInterface(IID_ICredentialProviderCredential, reinterpret_cast<void**>(ppcpc));
+    }
+    else if ((dwIndex == 0) && (_cEnumerated == 0) && ppcpc)
+    {
+        hr = _pMessageCredential->QueryInterface(IID_ICredentialProviderCredential, reinterpret_cast<void**>(ppcpc));
     }
     else
     {
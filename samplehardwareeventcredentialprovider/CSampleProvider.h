@@ -15,6 +15,10 @@
 
 #include "CommandWindow.h"
 #include "CSampleCredential.h"
+#include "DeviceEventPipeline.h"
+#include "DeviceRegistry.h"
+#include "DeviceSource.h"
+#include "EventReactor.h"
 #include "MessageCredential.h"
 #include "helpers.h"
 
@@ -23,18 +27,18 @@ class CCommandWindow;
 class CSampleCredential;
 class CMessageCredential;
 
-class CSampleProvider : public ICredentialProvider
+class CSampleProvider : public ICredentialProvider, public IDeviceEventSink
 {
   public:
     // IUnknown
     IFACEMETHODIMP_(ULONG) AddRef()
     {
-        return ++_cRef;
+        return InterlockedIncrement(&_cRef);
     }
     
     IFACEMETHODIMP_(ULONG) Release()
     {
-        LONG cRef = --_cRef;
+        LONG cRef = InterlockedDecrement(&_cRef);
         if (!cRef)
         {
             delete this;
@@ -71,19 +75,49 @@ class CSampleProvider : public ICredentialProvider
     friend HRESULT CSample_CreateInstance(__in REFIID riid, __deref_out void** ppv);
 
 public:
-    void OnConnectStatusChanged();
+    // IDeviceEventSink
+    void OnDeviceEvent(__in const DEVICE_EVENT* pEvent);
 
   protected:
     CSampleProvider();
     __override ~CSampleProvider();
     
+private:
+    void _SetEvents(__in_opt ICredentialProviderEvents* pcpe, __in UINT_PTR upAdviseContext);
+    void _SetScenario(__in CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus);
+    void _ArmSettle(__in ULONGLONG ullDueMs);
+    void _PublishTiles();
+    BOOL _IsConnected();
+    static void _ReleaseCredentials(__inout_ecount(*pcCredentials) CSampleCredential **rgpCredential, __inout DWORD *pcCredentials);
+    static HRESULT _CreateTileProc(__in void* pv, __in DWORD dwDeviceId, __deref_out void** ppvTile);
+    static void _RetireTileProc(__in void* pv, __in void* pvTile);
+    static void _SwapEventsProc(__in void* pv);
+    static void _SetScenarioProc(__in void* pv);
+    static void _SettleProc(__in void* pv);
+    static void _StartSourcesProc(__in void* pv);
+    static void _ShutdownProc(__in void* pv);
+
 private:
     CCommandWindow              *_pCommandWindow;       // Emulates external events.
     LONG                        _cRef;                  // Reference counter.
-    CSampleCredential           *_pCredential;          // Our "connected" credential.
     CMessageCredential          *_pMessageCredential;   // Our "disconnected" credential.
     ICredentialProviderEvents   *_pcpe;                    // Used to tell our owner to re-enumerate credentials.
+                                                        // Used and changed on the reactor thread while
+                                                        // the command window is up.
     UINT_PTR                    _upAdviseContext;       // Used to tell our owner who we are when asking to 
                                                         // re-enumerate credentials.
-    CREDENTIAL_PROVIDER_USAGE_SCENARIO      _cpus;
+    CREDENTIAL_PROVIDER_USAGE_SCENARIO      _cpus;  // What new tiles are created for, on the reactor thread
+                                                    // while the command window is up.
+    CDeviceEventPipeline        _pipeline;              // Debounces events on the reactor thread.
+    EVENT_TIMER                 _timerSettle;           // Fires when the pipeline's burst settles.
+    volatile LONG               _fConnected;            // Whether LogonUI was last told about any device.
+                                                        // Written on the reactor thread, read without a lock.
+    CDeviceSource               *_rgpSource[DEVICE_SOURCES_MAX];    // Injectors configured in the registry.
+    DWORD                       _cSources;
+    CDeviceRegistry             _registry;              // Devices and their tiles, on the reactor thread.
+    CRITICAL_SECTION            _csPublished;           // Guards the published tiles.
+    CSampleCredential           *_rgpPublished[DEVICE_REGISTRY_DEVICES_MAX];   // The tiles LogonUI was last told about.
+    DWORD                       _cPublished;
+    CSampleCredential           *_rgpEnumerated[DEVICE_REGISTRY_DEVICES_MAX];  // The tiles of the current enumeration,
+    DWORD                       _cEnumerated;                                   // on LogonUI's thread.
 };
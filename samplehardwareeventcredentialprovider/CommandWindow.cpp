@@ -11,65 +11,49 @@
 #include "CommandWindow.h"
 #include <strsafe.h>
 
-// Custom messages for managing the behavior of the window thread.
-#define WM_EXIT_THREAD              WM_USER + 1
-#define WM_TOGGLE_CONNECTED_STATUS  WM_USER + 2
-
 const WCHAR c_szClassName[] = L"EventWindow";
 const WCHAR c_szConnected[] = L"Connected";
 const WCHAR c_szDisconnected[] = L"Disconnected";
 
-CCommandWindow::CCommandWindow() : _hWnd(NULL), _hInst(NULL), _fConnected(FALSE), _pProvider(NULL)
+CCommandWindow::CCommandWindow() : _hWnd(NULL), _hWndButton(NULL), _hInst(NULL), _hrCreate(S_OK), _fReactor(false), _fConnected(FALSE), _pProvider(NULL)
 {
 }
 
 CCommandWindow::~CCommandWindow()
 {
-    // If we have an active window, we want to post it an exit message.
-    if (_hWnd != NULL)
-    {
-        PostMessage(_hWnd, WM_EXIT_THREAD, 0, 0);
-        _hWnd = NULL;
-    }
-
-    // We'll also make sure to release any reference we have to the provider.
-    if (_pProvider != NULL)
+    // The window is destroyed on the reactor thread, so once Send returns no
+    // message of ours is being handled and none will call the provider again.
+    if (_fReactor)
     {
-        _pProvider->Release();
-        _pProvider = NULL;
+        GetEventReactor()->Send(_DestroyProc, this);
+        GetEventReactor()->Release();
     }
 }
 
-// Performs the work required to spin off our message so we can listen for events.
+// Creates our window on the event reactor's thread so it gets pumped with every other
+// event source.
 HRESULT CCommandWindow::Initialize(__in CSampleProvider *pProvider)
 {
-    HRESULT hr = S_OK;
-
-    // Be sure to add a release any existing provider we might have, then add a reference
-    // to the provider we're working with now.
-    if (_pProvider != NULL)
-    {
-        _pProvider->Release();
-    }
+    // The provider owns us and deletes us before it goes away, so we don't hold a
+    // reference on it; one would keep it alive forever.
     _pProvider = pProvider;
-    _pProvider->AddRef();
-    
-    // Create and launch the window thread.
-    HANDLE hThread = CreateThread(NULL, 0, _ThreadProc, this, 0, NULL);
-    if (hThread == NULL)
+
+    HRESULT hr = GetEventReactor()->Acquire();
+    if (SUCCEEDED(hr))
     {
-        hr = HRESULT_FROM_WIN32(GetLastError());
+        _fReactor = true;
+
+        // Send waits for the window, so a failure to create it is reported here.
+        hr = GetEventReactor()->Send(_CreateProc, this);
+        if (SUCCEEDED(hr))
+        {
+            hr = _hrCreate;
+        }
     }
 
     return hr;
 }
 
-// Wraps our internal connected status so callers can easily access it.
-BOOL CCommandWindow::GetConnectedStatus()
-{
-    return _fConnected;
-}
-
 //
 //  FUNCTION: _MyRegisterClass()
 //
@@ -94,7 +78,13 @@ HRESULT CCommandWindow::_MyRegisterClass()
     wcex.hbrBackground    = (HBRUSH)(COLOR_WINDOW + 1);
     wcex.lpszClassName    = c_szClassName;
 
-    return RegisterClassEx(&wcex) ? S_OK : HRESULT_FROM_WIN32(GetLastError());
+    // Every provider instance shares the reactor thread, so the class may already be
+    // registered by another instance's window.
+    if (!RegisterClassEx(&wcex) && (ERROR_CLASS_ALREADY_EXISTS != GetLastError()))
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+    return S_OK;
 }
 
 //
@@ -125,7 +115,7 @@ HRESULT CCommandWindow::_InitInstance()
         WS_DLGFRAME,
         200, 200, 200, 80, 
         NULL,
-        NULL, _hInst, NULL);
+        NULL, _hInst, this);
     if (_hWnd == NULL)
     {
         hr = HRESULT_FROM_WIN32(GetLastError());
@@ -167,66 +157,60 @@ HRESULT CCommandWindow::_InitInstance()
     return hr;
 }
 
-// Called from the separate thread to process the next message in the message queue. If
-// there are no messages, it'll wait for one.
-BOOL CCommandWindow::_ProcessNextMessage()
+// Toggles the connection status, which also involves updating the UI, and tells the
+// provider.  The provider decides when LogonUI hears about it.
+void CCommandWindow::_ToggleConnectedStatus(__in ULONGLONG ullEventUs)
 {
-    // Grab, translate, and process the message.
-    MSG msg;
-    GetMessage(&(msg), _hWnd, 0, 0);
-    TranslateMessage(&(msg));
-    DispatchMessage(&(msg));
-
-    // This section performs some "post-processing" of the message. It's easier to do these
-    // things here because we have the handles to the window, its button, and the provider
-    // handy.
-    switch (msg.message)
+    _fConnected = !_fConnected;
+    if (_fConnected)
     {
-    // Return to the thread loop and let it know to exit.
-    case WM_EXIT_THREAD: return FALSE;
-
-    // Toggle the connection status, which also involves updating the UI.
-    case WM_TOGGLE_CONNECTED_STATUS:
-        _fConnected = !_fConnected;
-        if (_fConnected)
-        {
-            SetWindowText(_hWnd, c_szConnected);
-            SetWindowText(_hWndButton, L"Press to disconnect");
-        }
-        else
-        {
-            SetWindowText(_hWnd, c_szDisconnected);
-            SetWindowText(_hWndButton, L"Press to connect");
-        }
-        _pProvider->OnConnectStatusChanged();
-        break;
+        SetWindowText(_hWnd, c_szConnected);
+        SetWindowText(_hWndButton, L"Press to disconnect");
     }
-    return TRUE;
+    else
+    {
+        SetWindowText(_hWnd, c_szDisconnected);
+        SetWindowText(_hWndButton, L"Press to connect");
+    }
+
+    // The button is device 0, inserted and removed.
+    DEVICE_EVENT event = { _fConnected ? DEK_INSERT : DEK_REMOVE };
+    event.ullEventUs = ullEventUs;
+    _pProvider->OnDeviceEvent(&event);
 }
 
-// Manages window messages on the window thread.
+// Manages window messages on the reactor thread.
 LRESULT CALLBACK CCommandWindow::_WndProc(__in HWND hWnd, __in UINT message, __in WPARAM wParam, __in LPARAM lParam)
 {
+    CCommandWindow *pCommandWindow = reinterpret_cast<CCommandWindow *>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+
     switch (message)
     {
+    // Remember which CCommandWindow this window belongs to.
+    case WM_NCCREATE:
+        SetWindowLongPtr(hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(reinterpret_cast<CREATESTRUCT *>(lParam)->lpCreateParams));
+        return DefWindowProc(hWnd, message, wParam, lParam);
+
     // Originally we were going to work with USB keys being inserted and removed, but it
     // seems as though these events don't get to us on the secure desktop. However, you
-    // might see some messageboxi in CredUI.
-    // TODO: Remove if we can't use from LogonUI.
+    // might see some in CredUI.  Nothing here may block: every event source shares this
+    // thread, so a message box would stall all of them.
     case WM_DEVICECHANGE:
-        MessageBox(NULL, L"Device change", L"Device change", 0);
-        break;
+        OutputDebugString(L"CommandWindow: device change\n");
+        return TRUE;
 
     // We assume this was the button being clicked.
     case WM_COMMAND:
-        PostMessage(hWnd, WM_TOGGLE_CONNECTED_STATUS, 0, 0);
+        if (pCommandWindow != NULL)
+        {
+            pCommandWindow->_ToggleConnectedStatus(CEventReactor::GetTimeUs());
+        }
         break;
 
-    // To play it safe, we hide the window when "closed" and post a message telling the 
-    // thread to exit.
+    // To play it safe, we just hide the window when "closed".  It is destroyed along
+    // with its provider.
     case WM_CLOSE:
         ShowWindow(hWnd, SW_HIDE);
-        PostMessage(hWnd, WM_EXIT_THREAD, 0, 0);
         break;
 
     default:
@@ -235,17 +219,10 @@ LRESULT CALLBACK CCommandWindow::_WndProc(__in HWND hWnd, __in UINT message, __i
     return 0;
 }
 
-// Our thread procedure. We actually do a lot of work here that could be put back on the 
-// main thread, such as setting up the window, etc.
-DWORD WINAPI CCommandWindow::_ThreadProc(__in LPVOID lpParameter)
+// Sets up the window on the reactor thread.
+void CCommandWindow::_CreateProc(__in void *pv)
 {
-    CCommandWindow *pCommandWindow = static_cast<CCommandWindow *>(lpParameter);
-    if (pCommandWindow == NULL)
-    {
-        // TODO: What's the best way to raise this error?
-        return 0;
-    }
-
+    CCommandWindow *pCommandWindow = static_cast<CCommandWindow *>(pv);
     HRESULT hr = S_OK;
 
     // Create the window.
@@ -263,22 +240,29 @@ DWORD WINAPI CCommandWindow::_ThreadProc(__in LPVOID lpParameter)
         hr = HRESULT_FROM_WIN32(GetLastError());
     }
 
-    // ProcessNextMessage will pump our message pump and return false if it comes across
-    // a message telling us to exit the thread.
-    if (SUCCEEDED(hr))
-    {        
-        while (pCommandWindow->_ProcessNextMessage()) 
-        {
-        }
-    }
-    else
+    if (FAILED(hr) && (pCommandWindow->_hWnd != NULL))
     {
-        if (pCommandWindow->_hWnd != NULL)
-        {
-            pCommandWindow->_hWnd = NULL;
-        }
+        DestroyWindow(pCommandWindow->_hWnd);
+        pCommandWindow->_hWnd = NULL;
     }
+    pCommandWindow->_hrCreate = hr;
+}
 
-    return 0;
+// Tears the window down on the reactor thread.
+void CCommandWindow::Destroy()
+{
+    if (_hWnd != NULL)
+    {
+        DestroyWindow(_hWnd);
+        _hWnd = NULL;
+
+        // Our window procedure goes away with the DLL, so the class must not outlive it.
+        // This fails harmlessly while another provider instance still has a window.
+        UnregisterClass(c_szClassName, _hInst);
+    }
 }
 
+void CCommandWindow::_DestroyProc(__in void *pv)
+{
+    static_cast<CCommandWindow *>(pv)->Destroy();
+}
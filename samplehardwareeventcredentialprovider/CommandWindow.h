@@ -7,14 +7,16 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 //
 // CCommandWindow provides a way to emulate external "connect" and "disconnect" 
-// events, which are invoked via toggle button on a window. The window is launched
-// and managed on a separate thread, which is necessary to ensure it gets pumped.
+// events, which are invoked via toggle button on a window. The window lives on
+// the shared CEventReactor thread, which pumps it along with every other event
+// source, so no thread of its own is needed.
 //
 
 #pragma once
 
 #include <windows.h>
 #include "CSampleProvider.h"
+#include "EventReactor.h"
 
 class CCommandWindow
 {
@@ -22,19 +24,25 @@ public:
     CCommandWindow();
     ~CCommandWindow();
     HRESULT Initialize(__in CSampleProvider *pProvider);
-    BOOL GetConnectedStatus();
+
+    // Destroys the window now, on the reactor thread, so the provider can stop everything
+    // else that calls it back before any click gets in.  Otherwise the destructor does it.
+    void Destroy();
 
 private:
     HRESULT _MyRegisterClass();
     HRESULT _InitInstance();
-    BOOL _ProcessNextMessage();
-    
-    static DWORD WINAPI _ThreadProc(__in LPVOID lpParameter);
+    void _ToggleConnectedStatus(__in ULONGLONG ullEventUs);
+
+    static void _CreateProc(__in void *pv);
+    static void _DestroyProc(__in void *pv);
     static LRESULT CALLBACK    _WndProc(__in HWND hWnd, __in UINT message, __in WPARAM wParam, __in LPARAM lParam);
     
-    CSampleProvider            *_pProvider;        // Pointer to our owner.
+    CSampleProvider            *_pProvider;        // Our owner, which outlives us.
     HWND                        _hWnd;             // Handle to our window.
     HWND                        _hWndButton;       // Handle to our window's button.
     HINSTANCE                   _hInst;            // Current instance
-    BOOL                        _fConnected;       // Whether or not we're connected.
+    HRESULT                     _hrCreate;         // Result of creating the window.
+    bool                        _fReactor;         // Whether we hold the event reactor.
+    BOOL                        _fConnected;       // Whether or not the button says we're connected.
 };
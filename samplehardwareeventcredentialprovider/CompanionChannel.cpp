@@ -0,0 +1,231 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "CompanionChannel.h"
+
+#include <string.h>
+#ifdef _WIN32
+#include <sddl.h>
+#include <strsafe.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+CCompanionChannel::CCompanionChannel(DEVICE_SOURCE_PATH pszPipe, DEVICE_SOURCE_PATH pszSection, DWORD cbRing):
+    CPipeDeviceSource(pszPipe),
+#ifdef _WIN32
+    _hSection(NULL),
+#else
+    _fdSection(-1),
+#endif
+    _pvView(NULL),
+    _cbView(sizeof(COMPANION_RING_HEADER) + cbRing),
+    _cRecords(0)
+{
+#ifdef _WIN32
+    StringCchCopyW(_wszSection, ARRAYSIZE(_wszSection), pszSection);
+#else
+    strncpy(_szSection, pszSection, sizeof(_szSection) - 1);
+    _szSection[sizeof(_szSection) - 1] = '\0';
+#endif
+    _timerDrain.iTimer = EVENT_TIMER_IDLE;
+}
+
+CCompanionChannel::~CCompanionChannel()
+{
+    Stop();
+}
+
+HRESULT CCompanionChannel::Start(IDeviceEventSink* pSink)
+{
+    HRESULT hr = _MapSection();
+    if (SUCCEEDED(hr))
+    {
+        hr = _ring.Create(_pvView, _cbView);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = CPipeDeviceSource::Start(pSink);
+    }
+
+    if (FAILED(hr))
+    {
+        _UnmapSection();
+    }
+    return hr;
+}
+
+void CCompanionChannel::Stop()
+{
+    GetEventReactor()->CancelTimer(&_timerDrain);
+    CPipeDeviceSource::Stop();
+    _UnmapSection();
+}
+
+#ifdef _WIN32
+
+// The section is created, never opened: if the name is already taken,
+// someone else got there first and we don't read what they lay out.
+HRESULT CCompanionChannel::_MapSection()
+{
+    HRESULT hr = S_OK;
+    PSECURITY_DESCRIPTOR psd;
+    if (ConvertStringSecurityDescriptorToSecurityDescriptorW(DEVICE_PIPE_SDDL, SDDL_REVISION_1, &psd, NULL))
+    {
+        SECURITY_ATTRIBUTES sa = { sizeof(sa), psd, FALSE };
+        _hSection = CreateFileMappingW(INVALID_HANDLE_VALUE, &sa, PAGE_READWRITE, 0, (DWORD)_cbView, _wszSection);
+        if (_hSection == NULL)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else if (ERROR_ALREADY_EXISTS == GetLastError())
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS);
+        }
+        LocalFree(psd);
+    }
+    else
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        _pvView = MapViewOfFile(_hSection, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, _cbView);
+        if (_pvView == NULL)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+    return hr;
+}
+
+void CCompanionChannel::_UnmapSection()
+{
+    if (_pvView != NULL)
+    {
+        UnmapViewOfFile(_pvView);
+        _pvView = NULL;
+    }
+    if (_hSection != NULL)
+    {
+        CloseHandle(_hSection);
+        _hSection = NULL;
+    }
+}
+
+#else
+
+HRESULT CCompanionChannel::_MapSection()
+{
+    HRESULT hr = S_OK;
+
+    // One left behind by an earlier run would make O_EXCL fail.
+    shm_unlink(_szSection);
+    _fdSection = shm_open(_szSection, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if ((_fdSection < 0) || (0 != ftruncate(_fdSection, (off_t)_cbView)))
+    {
+        hr = E_FAIL;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        _pvView = mmap(NULL, _cbView, PROT_READ | PROT_WRITE, MAP_SHARED, _fdSection, 0);
+        if (_pvView == MAP_FAILED)
+        {
+            _pvView = NULL;
+            hr = E_FAIL;
+        }
+    }
+    return hr;
+}
+
+void CCompanionChannel::_UnmapSection()
+{
+    if (_pvView != NULL)
+    {
+        munmap(_pvView, _cbView);
+        _pvView = NULL;
+    }
+    if (_fdSection >= 0)
+    {
+        close(_fdSection);
+        _fdSection = -1;
+        shm_unlink(_szSection);
+    }
+}
+
+#endif
+
+// Whatever arrives on the pipe is a doorbell; the records are in the ring.
+void CCompanionChannel::_OnReceived(const char* /* pch */, size_t /* cch */)
+{
+    _Drain();
+}
+
+void CCompanionChannel::_Drain()
+{
+    if (COMPANION_DRAIN_BATCH == _ring.Drain(_OnRecord, this, COMPANION_DRAIN_BATCH))
+    {
+        // Still busy, so the companion won't ring again: come back after the
+        // other sources have had their turn.
+        GetEventReactor()->SetTimer(&_timerDrain, 0, _OnDrainTimer, this);
+    }
+}
+
+void CCompanionChannel::_OnDrainTimer(void* pv)
+{
+    static_cast<CCompanionChannel*>(pv)->_Drain();
+}
+
+void CCompanionChannel::_OnRecord(void* pv, DWORD dwType, DWORD dwDeviceId, const BYTE* pbPayload, DWORD cbPayload)
+{
+    CCompanionChannel* pThis = static_cast<CCompanionChannel*>(pv);
+
+    DEVICE_EVENT event;
+    event.dwDeviceId = dwDeviceId;
+    event.hrError = S_OK;
+    event.pbData = pbPayload;
+    event.cbData = 0;
+    switch (dwType)
+    {
+    case CRT_INSERT:
+        event.kind = DEK_INSERT;
+        break;
+
+    case CRT_REMOVE:
+        event.kind = DEK_REMOVE;
+        break;
+
+    case CRT_DATA:
+        event.kind = DEK_DATA;
+        event.cbData = cbPayload;
+        break;
+
+    case CRT_ERROR:
+        if (cbPayload < sizeof(HRESULT))
+        {
+            return;
+        }
+        event.kind = DEK_ERROR;
+        memcpy(&event.hrError, pbPayload, sizeof(HRESULT));
+        break;
+
+    default:
+        // From a newer companion; skip it.
+        return;
+    }
+
+    event.ullEventUs = CEventReactor::GetTimeUs();
+    pThis->_cRecords++;
+    pThis->_pSink->OnDeviceEvent(&event);
+}
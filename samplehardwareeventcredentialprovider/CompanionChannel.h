@@ -0,0 +1,79 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CCompanionChannel lets a companion process push device events and
+// payloads, such as pre-packed credential material, to the provider.  It
+// has two parts:
+//
+//   - a CCompanionRing in a named shared-memory section, which carries the
+//     records, and
+//   - a control pipe, set up like CPipeDeviceSource's, which the companion
+//     connects to and writes a byte to whenever the ring says the provider
+//     has gone idle.  What the byte says doesn't matter; it only wakes the
+//     reactor.
+//
+// The provider creates both, so a companion can't stand in for them, and
+// only SYSTEM and Administrators may open either.  Elsewhere the section is
+// POSIX shared memory and the pipe a Unix domain socket, both private to
+// their owner.
+//
+// Records are drained on the reactor thread, a batch at a time so a busy
+// companion can't hold up the other sources, and data payloads reach the
+// sink where they lie in the ring.
+
+#pragma once
+
+#include "CompanionRing.h"
+#include "PipeDeviceSource.h"
+
+// Records handed to the sink before the reactor gets a turn.
+#define COMPANION_DRAIN_BATCH   256
+
+class CCompanionChannel : public CPipeDeviceSource
+{
+  public:
+    CCompanionChannel(DEVICE_SOURCE_PATH pszPipe, DEVICE_SOURCE_PATH pszSection, DWORD cbRing = COMPANION_RING_CB_DEFAULT);
+    ~CCompanionChannel();
+
+    HRESULT Start(IDeviceEventSink* pSink);
+    void Stop();
+
+    ULONGLONG GetRecordCount() const
+    {
+        return _cRecords;
+    }
+
+    DWORD GetCorruptCount() const
+    {
+        return _ring.GetCorruptCount();
+    }
+
+  protected:
+    void _OnReceived(const char* pch, size_t cch);
+
+  private:
+    HRESULT _MapSection();
+    void _UnmapSection();
+    void _Drain();
+    static void _OnDrainTimer(void* pv);
+    static void _OnRecord(void* pv, DWORD dwType, DWORD dwDeviceId, const BYTE* pbPayload, DWORD cbPayload);
+
+  private:
+#ifdef _WIN32
+    WCHAR           _wszSection[MAX_PATH];
+    HANDLE          _hSection;
+#else
+    char            _szSection[256];
+    int             _fdSection;
+#endif
+    void*           _pvView;
+    size_t          _cbView;
+    CCompanionRing  _ring;
+    EVENT_TIMER     _timerDrain;        // Picks up where a full batch left off.
+    ULONGLONG       _cRecords;
+};
@@ -0,0 +1,253 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The doorbell handshake: the producer publishes the head and then looks at
+// fConsumerIdle; the consumer sets fConsumerIdle and then looks at the head.
+// Both steps are full barriers, so at least one side sees the other's write
+// and a record is never left in the ring with the consumer asleep.
+
+#include "CompanionRing.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+static LONGLONG AtomicLoad64(volatile LONGLONG* pll)
+{
+    return InterlockedCompareExchange64(pll, 0, 0);
+}
+
+static void AtomicStore64(volatile LONGLONG* pll, LONGLONG ll)
+{
+    InterlockedExchange64(pll, ll);
+}
+
+static LONG AtomicExchange(volatile LONG* pl, LONG l)
+{
+    return InterlockedExchange(pl, l);
+}
+
+// Only used right after one of the full barriers above.
+static LONG AtomicLoad(volatile LONG* pl)
+{
+    return *pl;
+}
+#else
+static LONGLONG AtomicLoad64(volatile LONGLONG* pll)
+{
+    return __atomic_load_n(pll, __ATOMIC_SEQ_CST);
+}
+
+static void AtomicStore64(volatile LONGLONG* pll, LONGLONG ll)
+{
+    __atomic_store_n(pll, ll, __ATOMIC_SEQ_CST);
+}
+
+static LONG AtomicExchange(volatile LONG* pl, LONG l)
+{
+    return __atomic_exchange_n(pl, l, __ATOMIC_SEQ_CST);
+}
+
+static LONG AtomicLoad(volatile LONG* pl)
+{
+    return __atomic_load_n(pl, __ATOMIC_SEQ_CST);
+}
+#endif
+
+CCompanionRing::CCompanionRing():
+    _pHeader(NULL),
+    _pbData(NULL),
+    _cbData(0),
+    _llHead(0),
+    _llTailSeen(0),
+    _cbPad(0),
+    _cbReserved(0),
+    _cbPayload(0),
+    _llTail(0),
+    _cCorrupt(0)
+{
+}
+
+HRESULT CCompanionRing::Create(void* pv, size_t cb)
+{
+    if (cb < sizeof(COMPANION_RING_HEADER) + 4096)
+    {
+        return E_INVALIDARG;
+    }
+
+    // The largest power of two that fits.
+    DWORD cbData = 4096;
+    while ((cbData < 0x40000000) && (sizeof(COMPANION_RING_HEADER) + 2 * (size_t)cbData <= cb))
+    {
+        cbData *= 2;
+    }
+
+    _pHeader = (COMPANION_RING_HEADER*)pv;
+    _pbData = (BYTE*)pv + sizeof(COMPANION_RING_HEADER);
+    _cbData = cbData;
+    _llTail = 0;
+
+    memset(_pHeader, 0, sizeof(*_pHeader));
+    _pHeader->dwVersion = COMPANION_RING_VERSION;
+    _pHeader->cbData = cbData;
+    _pHeader->fConsumerIdle = 1;
+    AtomicStore64(&_pHeader->llTail, 0);
+    _pHeader->dwMagic = COMPANION_RING_MAGIC;
+    return S_OK;
+}
+
+HRESULT CCompanionRing::Attach(void* pv, size_t cb)
+{
+    COMPANION_RING_HEADER* pHeader = (COMPANION_RING_HEADER*)pv;
+    if ((cb < sizeof(COMPANION_RING_HEADER)) ||
+        (COMPANION_RING_MAGIC != pHeader->dwMagic) ||
+        (COMPANION_RING_VERSION != pHeader->dwVersion) ||
+        (pHeader->cbData < 4096) ||
+        (pHeader->cbData & (pHeader->cbData - 1)) ||
+        (pHeader->cbData > cb - sizeof(COMPANION_RING_HEADER)))
+    {
+        return E_INVALIDARG;
+    }
+
+    _pHeader = pHeader;
+    _pbData = (BYTE*)pv + sizeof(COMPANION_RING_HEADER);
+    _cbData = pHeader->cbData;
+    _llHead = AtomicLoad64(&pHeader->llHead);
+    _llTailSeen = AtomicLoad64(&pHeader->llTail);
+    _cbReserved = 0;
+    return S_OK;
+}
+
+HRESULT CCompanionRing::Reserve(DWORD cbPayload, BYTE** ppbPayload)
+{
+    if (cbPayload > _cbData / 2 - sizeof(COMPANION_RECORD))
+    {
+        return E_INVALIDARG;
+    }
+
+    const DWORD cbRecord = (sizeof(COMPANION_RECORD) + cbPayload + COMPANION_RECORD_ALIGN - 1) & ~(COMPANION_RECORD_ALIGN - 1);
+    const DWORD dwOffset = (DWORD)_llHead & (_cbData - 1);
+    const DWORD cbPad = (dwOffset + cbRecord > _cbData) ? (_cbData - dwOffset) : 0;
+
+    // Only look at the consumer's tail when our last look says we're full.
+    if (_llHead + cbPad + cbRecord - _llTailSeen > _cbData)
+    {
+        _llTailSeen = AtomicLoad64(&_pHeader->llTail);
+        if (_llHead + cbPad + cbRecord - _llTailSeen > _cbData)
+        {
+            return E_OUTOFMEMORY;
+        }
+    }
+
+    _cbPad = cbPad;
+    _cbReserved = cbRecord;
+    _cbPayload = cbPayload;
+    *ppbPayload = _pbData + ((dwOffset + cbPad) & (_cbData - 1)) + sizeof(COMPANION_RECORD);
+    return S_OK;
+}
+
+void CCompanionRing::Commit(DWORD dwType, DWORD dwDeviceId, bool* pfWake)
+{
+    *pfWake = false;
+    if (0 == _cbReserved)
+    {
+        return;
+    }
+
+    const DWORD dwOffset = (DWORD)_llHead & (_cbData - 1);
+    if (_cbPad != 0)
+    {
+        COMPANION_RECORD* pPad = (COMPANION_RECORD*)(_pbData + dwOffset);
+        pPad->cbRecord = _cbPad;
+        pPad->dwType = CRT_PAD;
+        pPad->dwDeviceId = 0;
+        pPad->cbPayload = 0;
+    }
+
+    COMPANION_RECORD* pRecord = (COMPANION_RECORD*)(_pbData + ((dwOffset + _cbPad) & (_cbData - 1)));
+    pRecord->cbRecord = _cbReserved;
+    pRecord->dwType = dwType;
+    pRecord->dwDeviceId = dwDeviceId;
+    pRecord->cbPayload = _cbPayload;
+
+    _llHead += _cbPad + _cbReserved;
+    _cbReserved = 0;
+    AtomicStore64(&_pHeader->llHead, _llHead);
+
+    // Most of the time the consumer is busy and there is nothing to do.
+    if ((0 != AtomicLoad(&_pHeader->fConsumerIdle)) && (0 != AtomicExchange(&_pHeader->fConsumerIdle, 0)))
+    {
+        *pfWake = true;
+    }
+}
+
+HRESULT CCompanionRing::Push(DWORD dwType, DWORD dwDeviceId, const void* pvPayload, DWORD cbPayload, bool* pfWake)
+{
+    BYTE* pbPayload;
+    HRESULT hr = Reserve(cbPayload, &pbPayload);
+    if (SUCCEEDED(hr))
+    {
+        memcpy(pbPayload, pvPayload, cbPayload);
+        Commit(dwType, dwDeviceId, pfWake);
+    }
+    return hr;
+}
+
+DWORD CCompanionRing::Drain(PFN_COMPANION_RECORD pfn, void* pvContext, DWORD cMax)
+{
+    DWORD cRecords = 0;
+    for (;;)
+    {
+        const LONGLONG llHead = AtomicLoad64(&_pHeader->llHead);
+        if ((ULONGLONG)(llHead - _llTail) > _cbData)
+        {
+            // The head is behind us or laps us: nothing in between can be trusted.
+            _cCorrupt++;
+            _llTail = llHead;
+        }
+
+        while ((_llTail != llHead) && (cRecords < cMax))
+        {
+            // Checked from a copy, since the producer can write the ring at any time.
+            const DWORD dwOffset = (DWORD)_llTail & (_cbData - 1);
+            COMPANION_RECORD record;
+            memcpy(&record, _pbData + dwOffset, sizeof(record));
+            if ((record.cbRecord < sizeof(record)) ||
+                (record.cbRecord % COMPANION_RECORD_ALIGN) ||
+                (record.cbRecord > _cbData - dwOffset) ||
+                (record.cbRecord > (ULONGLONG)(llHead - _llTail)) ||
+                (record.cbPayload > record.cbRecord - sizeof(record)))
+            {
+                _cCorrupt++;
+                _llTail = llHead;
+                break;
+            }
+
+            if (CRT_PAD != record.dwType)
+            {
+                pfn(pvContext, record.dwType, record.dwDeviceId, _pbData + dwOffset + sizeof(record), record.cbPayload);
+                cRecords++;
+            }
+            _llTail += record.cbRecord;
+        }
+        AtomicStore64(&_pHeader->llTail, _llTail);
+
+        if (cRecords == cMax)
+        {
+            return cRecords;
+        }
+
+        // Empty.  Go idle, then look once more for a record that landed before
+        // the producer could see we were idle.
+        AtomicExchange(&_pHeader->fConsumerIdle, 1);
+        if (AtomicLoad64(&_pHeader->llHead) == _llTail)
+        {
+            return cRecords;
+        }
+        AtomicExchange(&_pHeader->fConsumerIdle, 0);
+    }
+}
@@ -0,0 +1,125 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CCompanionRing is a single-producer, single-consumer ring of records in
+// memory shared between two processes: a companion service (a badge reader
+// service, a phone bridge) writes, and the provider reads.  Neither side
+// takes a lock or makes a system call to pass a record; the only system
+// call is the doorbell the producer rings when the consumer has gone idle,
+// which the owner of the ring provides (CCompanionChannel uses a pipe).
+//
+// The memory starts with a COMPANION_RING_HEADER followed by the data area,
+// a power of two in size.  Head and tail count bytes ever written and
+// consumed, so the ring is empty when they are equal and never needs a
+// spare slot.  Each record is a COMPANION_RECORD followed by its payload,
+// padded to COMPANION_RECORD_ALIGN, and never wraps: a record that would
+// is preceded by a CRT_PAD record running to the end of the data area.
+//
+// The consumer hands payloads to its callback where they lie in the ring,
+// so a payload is copied once, by the producer into the ring.  The producer
+// is another process and is not trusted: every record is checked before it
+// is used, a ring that does not add up is emptied, and the payload may
+// still change while the callback reads it.
+
+#pragma once
+
+#include "EventReactor.h"
+
+#define COMPANION_RING_MAGIC        0x474E5243      // 'CRNG'
+#define COMPANION_RING_VERSION      1
+#define COMPANION_RING_CB_DEFAULT   (256 * 1024)
+#define COMPANION_RECORD_ALIGN      16
+
+enum COMPANION_RECORD_TYPE
+{
+    CRT_PAD     = 0,    // Skipped; fills the end of the data area.
+    CRT_INSERT  = 1,
+    CRT_REMOVE  = 2,
+    CRT_DATA    = 3,    // Payload is the data, such as pre-packed credential material.
+    CRT_ERROR   = 4,    // Payload is the HRESULT.
+};
+
+struct COMPANION_RECORD
+{
+    DWORD       cbRecord;       // Header, payload and padding.
+    DWORD       dwType;         // COMPANION_RECORD_TYPE.
+    DWORD       dwDeviceId;
+    DWORD       cbPayload;
+};
+
+// Each counter on its own cache line, so the two sides don't slow each other
+// down writing theirs.
+struct COMPANION_RING_HEADER
+{
+    DWORD               dwMagic;
+    DWORD               dwVersion;
+    DWORD               cbData;
+    DWORD               dwReserved;
+    BYTE                rgbPad0[48];
+    volatile LONGLONG   llHead;             // Written by the producer.
+    BYTE                rgbPad1[56];
+    volatile LONGLONG   llTail;             // Written by the consumer.
+    BYTE                rgbPad2[56];
+    volatile LONG       fConsumerIdle;      // Set by the consumer before it waits for the doorbell.
+    BYTE                rgbPad3[60];
+};
+
+// Called by Drain for each record.  pbPayload points into the ring and is
+// only valid until the callback returns.
+typedef void (*PFN_COMPANION_RECORD)(void* pvContext, DWORD dwType, DWORD dwDeviceId, const BYTE* pbPayload, DWORD cbPayload);
+
+class CCompanionRing
+{
+  public:
+    CCompanionRing();
+
+    // Consumer: lays out an empty ring in cb bytes of fresh shared memory.
+    HRESULT Create(void* pv, size_t cb);
+
+    // Producer: uses a ring laid out by Create.
+    HRESULT Attach(void* pv, size_t cb);
+
+    // Producer: makes room for a record with cbPayload bytes of payload and
+    // returns where to write it.  Returns E_OUTOFMEMORY while the ring is too
+    // full, and E_INVALIDARG for a payload that could never fit.
+    HRESULT Reserve(DWORD cbPayload, BYTE** ppbPayload);
+
+    // Producer: publishes the reserved record.  *pfWake is set when the
+    // consumer has gone idle and the doorbell must be rung.
+    void Commit(DWORD dwType, DWORD dwDeviceId, bool* pfWake);
+
+    // Producer: Reserve, copy and Commit.
+    HRESULT Push(DWORD dwType, DWORD dwDeviceId, const void* pvPayload, DWORD cbPayload, bool* pfWake);
+
+    // Consumer: passes up to cMax records to pfn.  Returns the number of
+    // records taken; fewer than cMax means the ring is empty and the
+    // consumer has been marked idle, so the next record rings the doorbell.
+    DWORD Drain(PFN_COMPANION_RECORD pfn, void* pvContext, DWORD cMax);
+
+    // Consumer: times the ring had to be emptied because it did not add up.
+    DWORD GetCorruptCount() const
+    {
+        return _cCorrupt;
+    }
+
+  private:
+    COMPANION_RING_HEADER*  _pHeader;
+    BYTE*                   _pbData;
+    DWORD                   _cbData;
+
+    // Producer.
+    LONGLONG                _llHead;            // Our copy of the head.
+    LONGLONG                _llTailSeen;        // The tail when we last looked.
+    DWORD                   _cbPad;             // Padding before the reserved record.
+    DWORD                   _cbReserved;        // Size of the reserved record, 0 if none.
+    DWORD                   _cbPayload;
+
+    // Consumer.
+    LONGLONG                _llTail;            // Our copy of the tail.
+    DWORD                   _cCorrupt;
+};
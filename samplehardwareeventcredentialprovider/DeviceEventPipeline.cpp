@@ -0,0 +1,99 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "DeviceEventPipeline.h"
+
+#include <string.h>
+
+CDeviceEventPipeline::CDeviceEventPipeline():
+    _dwDebounceMs(DEVICE_PIPELINE_DEBOUNCE_MS_DEFAULT),
+    _ullReported(0),
+    _ullPending(0),
+    _fPending(false),
+    _ullFirstMs(0),
+    _ullLastMs(0),
+    _ullFirstEventUs(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void CDeviceEventPipeline::Initialize(DWORD dwDebounceMs, ULONGLONG ullState)
+{
+    _dwDebounceMs = dwDebounceMs;
+    _ullReported = ullState;
+    _ullPending = ullState;
+    _fPending = false;
+}
+
+// The burst ends after the debounce window of quiet, but no later than the
+// settle limit after it began.
+ULONGLONG CDeviceEventPipeline::_GetDueMs() const
+{
+    const ULONGLONG ullQuietMs = _ullLastMs + _dwDebounceMs;
+    const ULONGLONG ullLimitMs = _ullFirstMs + (ULONGLONG)_dwDebounceMs * DEVICE_PIPELINE_SETTLE_FACTOR;
+    return (ullQuietMs < ullLimitMs) ? ullQuietMs : ullLimitMs;
+}
+
+ULONGLONG CDeviceEventPipeline::Submit(ULONGLONG ullState, ULONGLONG ullNowMs, ULONGLONG ullEventUs)
+{
+    _stats.cEvents++;
+    if (!_fPending)
+    {
+        _fPending = true;
+        _ullFirstMs = ullNowMs;
+        _ullFirstEventUs = ullEventUs;
+    }
+    _ullPending = ullState;
+    _ullLastMs = ullNowMs;
+    return _GetDueMs();
+}
+
+bool CDeviceEventPipeline::Settle(ULONGLONG ullNowMs, ULONGLONG* pullState, ULONGLONG* pullFirstEventUs, ULONGLONG* pullDueMs)
+{
+    *pullDueMs = 0;
+    if (!_fPending)
+    {
+        return false;
+    }
+
+    const ULONGLONG ullDueMs = _GetDueMs();
+    if (ullNowMs < ullDueMs)
+    {
+        *pullDueMs = ullDueMs;
+        return false;
+    }
+
+    _fPending = false;
+    _stats.cBursts++;
+    if (_ullPending == _ullReported)
+    {
+        _stats.cRedundant++;
+        return false;
+    }
+
+    _ullReported = _ullPending;
+    _stats.cChanges++;
+    *pullState = _ullReported;
+    *pullFirstEventUs = _ullFirstEventUs;
+    return true;
+}
+
+#ifdef _WIN32
+DWORD CDeviceEventPipeline::GetConfiguredDebounceMs()
+{
+    DWORD dwDebounceMs;
+    DWORD cb = sizeof(dwDebounceMs);
+    if (ERROR_SUCCESS != RegGetValueW(HKEY_LOCAL_MACHINE, DEVICE_PIPELINE_REGKEY, DEVICE_PIPELINE_REGVALUE,
+                                      RRF_RT_REG_DWORD, NULL, &dwDebounceMs, &cb))
+    {
+        dwDebounceMs = DEVICE_PIPELINE_DEBOUNCE_MS_DEFAULT;
+    }
+    return dwDebounceMs;
+}
+#endif
@@ -0,0 +1,96 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CDeviceEventPipeline sits between device events and CredentialsChanged.
+// Every CredentialsChanged makes LogonUI call GetCredentialCount and query
+// every field again, so a flapping reader or dock must not cause one per
+// event.
+//
+// Events are reported with the device state they leave behind, as a 64 bit
+// value the owner chooses (the connected flag, or a fingerprint of the set
+// of connected devices).  The pipeline waits until no event has arrived for
+// the debounce window, or until the settle limit has passed since the first
+// event of the burst, and then reports one change if the settled state
+// differs from the last one reported.  A burst that ends where it started
+// reports nothing.
+//
+// The pipeline has no clock or timer of its own: callers pass the time in,
+// and arm a timer for the time Submit returns.  That keeps it usable with
+// the event reactor in the provider and with a virtual clock in tests.
+
+#pragma once
+
+#include "EventReactor.h"
+
+// Quiet time that ends a burst of events.
+#define DEVICE_PIPELINE_DEBOUNCE_MS_DEFAULT     250
+
+// Longest a burst can hold back a change, as a multiple of the debounce
+// window, so a device that never stops flapping is still reported.
+#define DEVICE_PIPELINE_SETTLE_FACTOR           4
+
+// Optional REG_DWORD overriding the debounce window; 0 turns debouncing off.
+#define DEVICE_PIPELINE_REGKEY                  L"SOFTWARE\\SampleHardwareEventCredentialProvider"
+#define DEVICE_PIPELINE_REGVALUE                L"DebounceMs"
+
+struct DEVICE_PIPELINE_STATS
+{
+    DWORD   cEvents;        // Events submitted.
+    DWORD   cBursts;        // Bursts that have settled.
+    DWORD   cChanges;       // Bursts that changed the state, each one CredentialsChanged.
+    DWORD   cRedundant;     // Bursts that settled back to the reported state.
+};
+
+class CDeviceEventPipeline
+{
+  public:
+    CDeviceEventPipeline();
+
+    // ullState is the state last reported to LogonUI.
+    void Initialize(DWORD dwDebounceMs, ULONGLONG ullState);
+
+    // Records an event that left the device state at ullState.  ullEventUs
+    // is carried to the change it ends up in, for latency measurements.
+    // Returns the time Settle should next be called.
+    ULONGLONG Submit(ULONGLONG ullState, ULONGLONG ullNowMs, ULONGLONG ullEventUs);
+
+    // Ends the burst if it has settled by ullNowMs.  Returns true if the
+    // state changed, with the new state and the time of the burst's first
+    // event.  Returns false if there is nothing to report, and if the burst
+    // has not settled yet sets *pullDueMs to when to try again, otherwise to
+    // 0.
+    bool Settle(ULONGLONG ullNowMs, ULONGLONG* pullState, ULONGLONG* pullFirstEventUs, ULONGLONG* pullDueMs);
+
+    ULONGLONG GetState() const
+    {
+        return _ullReported;
+    }
+
+    void GetStats(DEVICE_PIPELINE_STATS* pStats) const
+    {
+        *pStats = _stats;
+    }
+
+#ifdef _WIN32
+    // The debounce window configured in the registry, or the default.
+    static DWORD GetConfiguredDebounceMs();
+#endif
+
+  private:
+    ULONGLONG _GetDueMs() const;
+
+  private:
+    DWORD                   _dwDebounceMs;
+    ULONGLONG               _ullReported;       // Last state reported.
+    ULONGLONG               _ullPending;        // State after the latest event.
+    bool                    _fPending;          // A burst is in progress.
+    ULONGLONG               _ullFirstMs;        // When the burst began.
+    ULONGLONG               _ullLastMs;         // When its latest event arrived.
+    ULONGLONG               _ullFirstEventUs;
+    DEVICE_PIPELINE_STATS   _stats;
+};
@@ -0,0 +1,232 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// An entry lives from the first insert of its device until Reconcile finds
+// the device gone and its tile, if any, retired.  Entries that are only in
+// the arrival queue are freed there too, so an index in the queue or the
+// tile list always names the device it was put there for.
+
+#include "DeviceRegistry.h"
+
+#include <string.h>
+
+#define DEVICE_REGISTRY_NONE    ((DWORD)-1)
+
+CDeviceRegistry::CDeviceRegistry()
+{
+    Clear(NULL, NULL);
+}
+
+void CDeviceRegistry::Clear(PFN_DEVICE_TILE_RETIRE pfnRetire, void* pvContext)
+{
+    if (pfnRetire != NULL)
+    {
+        for (DWORD i = 0; i < _cTiles; i++)
+        {
+            pfnRetire(pvContext, GetTileAt(i));
+        }
+    }
+
+    memset(_rgEntry, 0, sizeof(_rgEntry));
+    memset(_rgiBucket, 0, sizeof(_rgiBucket));
+    for (DWORD i = 0; i < DEVICE_REGISTRY_DEVICES_MAX; i++)
+    {
+        _rgiFree[i] = DEVICE_REGISTRY_DEVICES_MAX - 1 - i;
+    }
+    _cFree = DEVICE_REGISTRY_DEVICES_MAX;
+    _cTiles = 0;
+    _cArrived = 0;
+    _cPresent = 0;
+    _ullFingerprint = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+// splitmix64, so neighbouring ids land far apart in the table and in the
+// fingerprint.
+ULONGLONG CDeviceRegistry::_Mix(DWORD dwDeviceId)
+{
+    ULONGLONG ull = dwDeviceId + 0x9E3779B97F4A7C15ULL;
+    ull = (ull ^ (ull >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    ull = (ull ^ (ull >> 27)) * 0x94D049BB133111EBULL;
+    return ull ^ (ull >> 31);
+}
+
+DWORD CDeviceRegistry::_Find(DWORD dwDeviceId) const
+{
+    for (DWORD iBucket = (DWORD)_Mix(dwDeviceId) & (DEVICE_REGISTRY_BUCKETS - 1);
+         _rgiBucket[iBucket] != 0;
+         iBucket = (iBucket + 1) & (DEVICE_REGISTRY_BUCKETS - 1))
+    {
+        const DWORD iEntry = _rgiBucket[iBucket] - 1;
+        if (_rgEntry[iEntry].dwDeviceId == dwDeviceId)
+        {
+            return iEntry;
+        }
+    }
+    return DEVICE_REGISTRY_NONE;
+}
+
+DWORD CDeviceRegistry::_Add(DWORD dwDeviceId)
+{
+    if (0 == _cFree)
+    {
+        return DEVICE_REGISTRY_NONE;
+    }
+
+    const DWORD iEntry = _rgiFree[--_cFree];
+    DEVICE_ENTRY* pEntry = &_rgEntry[iEntry];
+    pEntry->dwDeviceId = dwDeviceId;
+    pEntry->fPresent = false;
+    pEntry->fQueued = false;
+    pEntry->pvTile = NULL;
+
+    // The table is never more than half full, so there is always an empty bucket.
+    DWORD iBucket = (DWORD)_Mix(dwDeviceId) & (DEVICE_REGISTRY_BUCKETS - 1);
+    while (_rgiBucket[iBucket] != 0)
+    {
+        iBucket = (iBucket + 1) & (DEVICE_REGISTRY_BUCKETS - 1);
+    }
+    _rgiBucket[iBucket] = iEntry + 1;
+    return iEntry;
+}
+
+// Takes the entry out of the table, moving later entries of the same run
+// back so every entry stays reachable from its home bucket.
+void CDeviceRegistry::_Free(DWORD iEntry)
+{
+    DWORD iHole = (DWORD)_Mix(_rgEntry[iEntry].dwDeviceId) & (DEVICE_REGISTRY_BUCKETS - 1);
+    while (_rgiBucket[iHole] != iEntry + 1)
+    {
+        iHole = (iHole + 1) & (DEVICE_REGISTRY_BUCKETS - 1);
+    }
+    _rgiBucket[iHole] = 0;
+
+    for (DWORD iBucket = (iHole + 1) & (DEVICE_REGISTRY_BUCKETS - 1);
+         _rgiBucket[iBucket] != 0;
+         iBucket = (iBucket + 1) & (DEVICE_REGISTRY_BUCKETS - 1))
+    {
+        // An entry can fill the hole if its home is not between the hole and
+        // where it sits now.
+        const DWORD iHome = (DWORD)_Mix(_rgEntry[_rgiBucket[iBucket] - 1].dwDeviceId) & (DEVICE_REGISTRY_BUCKETS - 1);
+        const DWORD cFromHome = (iBucket - iHome) & (DEVICE_REGISTRY_BUCKETS - 1);
+        const DWORD cFromHole = (iBucket - iHole) & (DEVICE_REGISTRY_BUCKETS - 1);
+        if (cFromHome >= cFromHole)
+        {
+            _rgiBucket[iHole] = _rgiBucket[iBucket];
+            _rgiBucket[iBucket] = 0;
+            iHole = iBucket;
+        }
+    }
+
+    _rgiFree[_cFree++] = iEntry;
+}
+
+bool CDeviceRegistry::Apply(const DEVICE_EVENT* pEvent)
+{
+    DWORD iEntry = _Find(pEvent->dwDeviceId);
+    switch (pEvent->kind)
+    {
+    case DEK_INSERT:
+        if (DEVICE_REGISTRY_NONE == iEntry)
+        {
+            iEntry = _Add(pEvent->dwDeviceId);
+            if (DEVICE_REGISTRY_NONE == iEntry)
+            {
+                _stats.cDropped++;
+                return false;
+            }
+        }
+        if (_rgEntry[iEntry].fPresent)
+        {
+            return false;
+        }
+
+        _rgEntry[iEntry].fPresent = true;
+        if (_rgEntry[iEntry].pvTile != NULL)
+        {
+            _stats.cKept++;
+        }
+        else if (!_rgEntry[iEntry].fQueued)
+        {
+            _rgEntry[iEntry].fQueued = true;
+            _rgiArrived[_cArrived++] = iEntry;
+        }
+        break;
+
+    case DEK_REMOVE:
+    case DEK_ERROR:
+        if ((DEVICE_REGISTRY_NONE == iEntry) || !_rgEntry[iEntry].fPresent)
+        {
+            return false;
+        }
+        _rgEntry[iEntry].fPresent = false;
+        break;
+
+    default:
+        return false;
+    }
+
+    // Inserting and removing both flip the device in the set.
+    _cPresent += _rgEntry[iEntry].fPresent ? 1 : -1;
+    _ullFingerprint ^= _Mix(pEvent->dwDeviceId);
+    return true;
+}
+
+bool CDeviceRegistry::Reconcile(PFN_DEVICE_TILE_CREATE pfnCreate, PFN_DEVICE_TILE_RETIRE pfnRetire, void* pvContext)
+{
+    bool fChanged = false;
+
+    // Retire the tiles of devices that are gone, keeping the others in order.
+    DWORD cTiles = 0;
+    for (DWORD i = 0; i < _cTiles; i++)
+    {
+        const DWORD iEntry = _rgiTile[i];
+        DEVICE_ENTRY* pEntry = &_rgEntry[iEntry];
+        if (pEntry->fPresent)
+        {
+            _rgiTile[cTiles++] = iEntry;
+        }
+        else
+        {
+            pfnRetire(pvContext, pEntry->pvTile);
+            pEntry->pvTile = NULL;
+            _Free(iEntry);
+            _stats.cRetired++;
+            fChanged = true;
+        }
+    }
+    _cTiles = cTiles;
+
+    // Then add tiles for the devices that arrived, after them.
+    DWORD cArrived = 0;
+    for (DWORD i = 0; i < _cArrived; i++)
+    {
+        const DWORD iEntry = _rgiArrived[i];
+        DEVICE_ENTRY* pEntry = &_rgEntry[iEntry];
+        if (!pEntry->fPresent)
+        {
+            // Came and went within the burst.
+            _Free(iEntry);
+        }
+        else if (SUCCEEDED(pfnCreate(pvContext, pEntry->dwDeviceId, &pEntry->pvTile)))
+        {
+            pEntry->fQueued = false;
+            _rgiTile[_cTiles++] = iEntry;
+            _stats.cCreated++;
+            fChanged = true;
+        }
+        else
+        {
+            pEntry->pvTile = NULL;
+            _rgiArrived[cArrived++] = iEntry;
+        }
+    }
+    _cArrived = cArrived;
+
+    return fChanged;
+}
@@ -0,0 +1,125 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CDeviceRegistry keeps track of which devices are present and of the tile
+// each one has.  It is updated in two steps, to go with the debouncing
+// pipeline:
+//
+//   Apply      records an event as it arrives.  It only marks the device
+//              present or absent, and keeps a fingerprint of the set of
+//              present devices for the pipeline to compare.
+//   Reconcile  brings the tiles in line with the devices once a burst has
+//              settled: it retires the tiles of devices that are gone and
+//              creates tiles for devices that arrived, and leaves every other
+//              tile alone.  A device that left and came back within the burst
+//              keeps the tile it had.
+//
+// Tiles are kept in the order their devices arrived, and a tile that stays
+// keeps its place relative to the others, so the tiles LogonUI shows do not
+// shuffle when a device comes or goes.
+//
+// The registry does not know what a tile is: the owner creates and retires
+// them through callbacks.  Devices are found by id in an open-addressed hash
+// table, so an event costs the same with one device or hundreds.
+
+#pragma once
+
+#include "DeviceSource.h"
+
+// Most devices tracked at once, and the size of the table that finds them.
+#define DEVICE_REGISTRY_DEVICES_MAX     1024
+#define DEVICE_REGISTRY_BUCKETS         (2 * DEVICE_REGISTRY_DEVICES_MAX)
+
+// Creates the tile for a device.  A device whose tile cannot be created is
+// tried again at the next Reconcile.
+typedef HRESULT (*PFN_DEVICE_TILE_CREATE)(void* pvContext, DWORD dwDeviceId, void** ppvTile);
+typedef void (*PFN_DEVICE_TILE_RETIRE)(void* pvContext, void* pvTile);
+
+struct DEVICE_REGISTRY_STATS
+{
+    DWORD   cCreated;       // Tiles created.
+    DWORD   cRetired;       // Tiles retired.
+    DWORD   cKept;          // Tiles whose device left and came back within a burst.
+    DWORD   cDropped;       // Inserts ignored because the registry was full.
+};
+
+class CDeviceRegistry
+{
+  public:
+    CDeviceRegistry();
+
+    // Records an event.  Returns true if it changed the set of present
+    // devices; data events never do, and an error counts as a removal.
+    bool Apply(const DEVICE_EVENT* pEvent);
+
+    // Order-independent fingerprint of the present devices, 0 for none.
+    ULONGLONG GetFingerprint() const
+    {
+        return _ullFingerprint;
+    }
+
+    DWORD GetPresentCount() const
+    {
+        return _cPresent;
+    }
+
+    // Creates and retires tiles to match the present devices.  Returns true
+    // if the tiles changed.
+    bool Reconcile(PFN_DEVICE_TILE_CREATE pfnCreate, PFN_DEVICE_TILE_RETIRE pfnRetire, void* pvContext);
+
+    // Retires every tile and forgets every device.
+    void Clear(PFN_DEVICE_TILE_RETIRE pfnRetire, void* pvContext);
+
+    // The tiles as of the last Reconcile, in order.
+    DWORD GetTileCount() const
+    {
+        return _cTiles;
+    }
+
+    void* GetTileAt(DWORD iTile) const
+    {
+        return _rgEntry[_rgiTile[iTile]].pvTile;
+    }
+
+    DWORD GetTileDeviceId(DWORD iTile) const
+    {
+        return _rgEntry[_rgiTile[iTile]].dwDeviceId;
+    }
+
+    void GetStats(DEVICE_REGISTRY_STATS* pStats) const
+    {
+        *pStats = _stats;
+    }
+
+  private:
+    struct DEVICE_ENTRY
+    {
+        DWORD   dwDeviceId;
+        bool    fPresent;
+        bool    fQueued;        // In _rgiArrived.
+        void*   pvTile;
+    };
+
+    static ULONGLONG _Mix(DWORD dwDeviceId);
+    DWORD _Find(DWORD dwDeviceId) const;
+    DWORD _Add(DWORD dwDeviceId);
+    void _Free(DWORD iEntry);
+
+  private:
+    DEVICE_ENTRY            _rgEntry[DEVICE_REGISTRY_DEVICES_MAX];
+    DWORD                   _rgiFree[DEVICE_REGISTRY_DEVICES_MAX];      // Stack of unused entries.
+    DWORD                   _cFree;
+    DWORD                   _rgiBucket[DEVICE_REGISTRY_BUCKETS];        // Entry index + 1, or 0 for empty.
+    DWORD                   _rgiTile[DEVICE_REGISTRY_DEVICES_MAX];      // Entries with tiles, in order.
+    DWORD                   _cTiles;
+    DWORD                   _rgiArrived[DEVICE_REGISTRY_DEVICES_MAX];   // Entries inserted since Reconcile.
+    DWORD                   _cArrived;
+    DWORD                   _cPresent;
+    ULONGLONG               _ullFingerprint;
+    DEVICE_REGISTRY_STATS   _stats;
+};
@@ -0,0 +1,337 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "DeviceSource.h"
+#include "CompanionChannel.h"
+#include "DeviceEventPipeline.h"
+#include "PipeDeviceSource.h"
+#include "ReplayDeviceSource.h"
+#include "SyntheticDeviceSource.h"
+
+#include <string.h>
+#ifdef _WIN32
+#include <strsafe.h>
+#endif
+
+static bool IsSpace(char ch)
+{
+    return (' ' == ch) || ('\t' == ch) || ('\r' == ch);
+}
+
+static int HexDigit(char ch)
+{
+    if ((ch >= '0') && (ch <= '9'))
+    {
+        return ch - '0';
+    }
+    if ((ch >= 'a') && (ch <= 'f'))
+    {
+        return ch - 'a' + 10;
+    }
+    if ((ch >= 'A') && (ch <= 'F'))
+    {
+        return ch - 'A' + 10;
+    }
+    return -1;
+}
+
+// Returns the next word of [*ppch, pchEnd) and moves *ppch past it.
+static size_t NextWord(const char** ppch, const char* pchEnd, const char** ppchWord)
+{
+    const char* pch = *ppch;
+    while ((pch < pchEnd) && IsSpace(*pch))
+    {
+        pch++;
+    }
+    *ppchWord = pch;
+    while ((pch < pchEnd) && !IsSpace(*pch))
+    {
+        pch++;
+    }
+    *ppch = pch;
+    return pch - *ppchWord;
+}
+
+static bool WordIs(const char* pchWord, size_t cchWord, const char* psz)
+{
+    return (strlen(psz) == cchWord) && (0 == memcmp(pchWord, psz, cchWord));
+}
+
+// Parses a number of up to 32 bits in the given base.
+static bool ParseNumber(const char* pch, size_t cch, DWORD dwBase, DWORD* pdw)
+{
+    if ((0 == cch) || (cch > ((16 == dwBase) ? 8U : 10U)))
+    {
+        return false;
+    }
+
+    ULONGLONG ull = 0;
+    for (size_t i = 0; i < cch; i++)
+    {
+        const int iDigit = HexDigit(pch[i]);
+        if ((iDigit < 0) || ((DWORD)iDigit >= dwBase))
+        {
+            return false;
+        }
+        ull = ull * dwBase + iDigit;
+    }
+    if (ull > 0xFFFFFFFF)
+    {
+        return false;
+    }
+    *pdw = (DWORD)ull;
+    return true;
+}
+
+HRESULT ParseDeviceEventLine(const char* pch, size_t cch, DEVICE_EVENT* pEvent)
+{
+    const char* pchEnd = pch + cch;
+    const char* pchWord;
+    size_t cchWord = NextWord(&pch, pchEnd, &pchWord);
+    if ((0 == cchWord) || ('#' == *pchWord))
+    {
+        return S_FALSE;
+    }
+
+    if (WordIs(pchWord, cchWord, "insert"))
+    {
+        pEvent->kind = DEK_INSERT;
+    }
+    else if (WordIs(pchWord, cchWord, "remove"))
+    {
+        pEvent->kind = DEK_REMOVE;
+    }
+    else if (WordIs(pchWord, cchWord, "data"))
+    {
+        pEvent->kind = DEK_DATA;
+    }
+    else if (WordIs(pchWord, cchWord, "error"))
+    {
+        pEvent->kind = DEK_ERROR;
+    }
+    else
+    {
+        return E_INVALIDARG;
+    }
+
+    cchWord = NextWord(&pch, pchEnd, &pchWord);
+    if (!ParseNumber(pchWord, cchWord, 10, &pEvent->dwDeviceId))
+    {
+        return E_INVALIDARG;
+    }
+
+    pEvent->hrError = S_OK;
+    pEvent->pbData = pEvent->rgbData;
+    pEvent->cbData = 0;
+    if (DEK_DATA == pEvent->kind)
+    {
+        cchWord = NextWord(&pch, pchEnd, &pchWord);
+        if ((cchWord % 2) || (cchWord / 2 > sizeof(pEvent->rgbData)))
+        {
+            return E_INVALIDARG;
+        }
+        for (size_t i = 0; i < cchWord; i += 2)
+        {
+            const int iHigh = HexDigit(pchWord[i]);
+            const int iLow = HexDigit(pchWord[i + 1]);
+            if ((iHigh < 0) || (iLow < 0))
+            {
+                return E_INVALIDARG;
+            }
+            pEvent->rgbData[i / 2] = (BYTE)((iHigh << 4) | iLow);
+        }
+        pEvent->cbData = (DWORD)(cchWord / 2);
+    }
+    else if (DEK_ERROR == pEvent->kind)
+    {
+        DWORD dwError;
+        cchWord = NextWord(&pch, pchEnd, &pchWord);
+        if ((cchWord > 2) && ('0' == pchWord[0]) && (('x' == pchWord[1]) || ('X' == pchWord[1])))
+        {
+            pchWord += 2;
+            cchWord -= 2;
+        }
+        if (!ParseNumber(pchWord, cchWord, 16, &dwError))
+        {
+            return E_INVALIDARG;
+        }
+        pEvent->hrError = (HRESULT)dwError;
+    }
+
+    // Nothing may follow.
+    cchWord = NextWord(&pch, pchEnd, &pchWord);
+    return (0 == cchWord) ? S_OK : E_INVALIDARG;
+}
+
+CDeviceLineReader::CDeviceLineReader():
+    _cchLine(0),
+    _fOverflow(false),
+    _cMalformed(0)
+{
+}
+
+void CDeviceLineReader::Reset()
+{
+    _cchLine = 0;
+    _fOverflow = false;
+}
+
+void CDeviceLineReader::_Line(const char* pch, size_t cch, IDeviceEventSink* pSink)
+{
+    DEVICE_EVENT event;
+    const HRESULT hr = ParseDeviceEventLine(pch, cch, &event);
+    if (S_OK == hr)
+    {
+        event.ullEventUs = CEventReactor::GetTimeUs();
+        pSink->OnDeviceEvent(&event);
+    }
+    else if (FAILED(hr))
+    {
+        _cMalformed++;
+    }
+}
+
+// Complete lines are parsed straight out of the caller's buffer; only a line
+// split across two reads is copied.
+void CDeviceLineReader::Feed(const char* pch, size_t cch, IDeviceEventSink* pSink)
+{
+    const char* pchEnd = pch + cch;
+    while (pch < pchEnd)
+    {
+        const char* pchNewline = (const char*)memchr(pch, '\n', pchEnd - pch);
+        const char* pchLineEnd = pchNewline ? pchNewline : pchEnd;
+        const size_t cchPart = pchLineEnd - pch;
+
+        if (_fOverflow)
+        {
+            // Skip to the end of the overlong line.
+        }
+        else if (_cchLine + cchPart > sizeof(_rgchLine))
+        {
+            _fOverflow = true;
+            _cMalformed++;
+        }
+        else if (pchNewline && (0 == _cchLine))
+        {
+            _Line(pch, cchPart, pSink);
+        }
+        else
+        {
+            memcpy(_rgchLine + _cchLine, pch, cchPart);
+            _cchLine += cchPart;
+            if (pchNewline)
+            {
+                _Line(_rgchLine, _cchLine, pSink);
+            }
+        }
+
+        if (pchNewline)
+        {
+            _cchLine = 0;
+            _fOverflow = false;
+            pch = pchNewline + 1;
+        }
+        else
+        {
+            pch = pchEnd;
+        }
+    }
+}
+
+#ifdef _WIN32
+HRESULT CreateConfiguredDeviceSources(CDeviceSource** rgpSource, DWORD cSourcesMax, DWORD* pcSources)
+{
+    HRESULT hr = S_OK;
+    *pcSources = 0;
+
+    WCHAR wszPath[MAX_PATH];
+    DWORD cb = sizeof(wszPath);
+    if ((*pcSources < cSourcesMax) &&
+        (ERROR_SUCCESS == RegGetValueW(HKEY_LOCAL_MACHINE, DEVICE_PIPELINE_REGKEY, DEVICE_SOURCE_REGVALUE_PIPE,
+                                       RRF_RT_REG_SZ, NULL, wszPath, &cb)))
+    {
+        rgpSource[*pcSources] = new CPipeDeviceSource(wszPath);
+        hr = rgpSource[*pcSources] ? S_OK : E_OUTOFMEMORY;
+        if (SUCCEEDED(hr))
+        {
+            (*pcSources)++;
+        }
+    }
+
+    cb = sizeof(wszPath);
+    if (SUCCEEDED(hr) && (*pcSources < cSourcesMax) &&
+        (ERROR_SUCCESS == RegGetValueW(HKEY_LOCAL_MACHINE, DEVICE_PIPELINE_REGKEY, DEVICE_SOURCE_REGVALUE_REPLAY,
+                                       RRF_RT_REG_SZ, NULL, wszPath, &cb)))
+    {
+        CReplayDeviceSource* pReplay = new CReplayDeviceSource(wszPath);
+        hr = pReplay ? S_OK : E_OUTOFMEMORY;
+        if (SUCCEEDED(hr))
+        {
+            // A trace that can't be read is left out, not fatal.
+            if (SUCCEEDED(pReplay->Load()))
+            {
+                rgpSource[(*pcSources)++] = pReplay;
+            }
+            else
+            {
+                OutputDebugString(L"DeviceSource: cannot load replay trace\n");
+                delete pReplay;
+            }
+        }
+    }
+
+    DWORD dwRate;
+    cb = sizeof(dwRate);
+    if (SUCCEEDED(hr) && (*pcSources < cSourcesMax) &&
+        (ERROR_SUCCESS == RegGetValueW(HKEY_LOCAL_MACHINE, DEVICE_PIPELINE_REGKEY, DEVICE_SOURCE_REGVALUE_SYNTHETIC,
+                                       RRF_RT_REG_DWORD, NULL, &dwRate, &cb)) &&
+        (dwRate > 0))
+    {
+        rgpSource[*pcSources] = new CSyntheticDeviceSource(dwRate, DEVICE_SYNTHETIC_DEVICES_DEFAULT);
+        hr = rgpSource[*pcSources] ? S_OK : E_OUTOFMEMORY;
+        if (SUCCEEDED(hr))
+        {
+            (*pcSources)++;
+        }
+    }
+
+    cb = sizeof(wszPath);
+    if (SUCCEEDED(hr) && (*pcSources < cSourcesMax) &&
+        (ERROR_SUCCESS == RegGetValueW(HKEY_LOCAL_MACHINE, DEVICE_PIPELINE_REGKEY, DEVICE_SOURCE_REGVALUE_COMPANION,
+                                       RRF_RT_REG_SZ, NULL, wszPath, &cb)))
+    {
+        // The companion finds both under the one name.
+        WCHAR wszPipe[MAX_PATH];
+        WCHAR wszSection[MAX_PATH];
+        hr = StringCchPrintfW(wszPipe, ARRAYSIZE(wszPipe), L"\\\\.\\pipe\\%s", wszPath);
+        if (SUCCEEDED(hr))
+        {
+            hr = StringCchPrintfW(wszSection, ARRAYSIZE(wszSection), L"Global\\%s", wszPath);
+        }
+        if (SUCCEEDED(hr))
+        {
+            rgpSource[*pcSources] = new CCompanionChannel(wszPipe, wszSection);
+            hr = rgpSource[*pcSources] ? S_OK : E_OUTOFMEMORY;
+            if (SUCCEEDED(hr))
+            {
+                (*pcSources)++;
+            }
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        while (*pcSources > 0)
+        {
+            delete rgpSource[--(*pcSources)];
+        }
+    }
+    return hr;
+}
+#endif
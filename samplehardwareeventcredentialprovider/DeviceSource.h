@@ -0,0 +1,131 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// A device source is anything that reports devices coming, going, having
+// data ready or failing: real hardware, or one of the injectors used to
+// drive the provider without it.  Sources run on the event reactor and hand
+// their events to an IDeviceEventSink, which for the provider is the
+// debouncing pipeline in front of CredentialsChanged.
+//
+// Built-in sources:
+//   CPipeDeviceSource       events written to a named pipe (a Unix socket
+//                           elsewhere), one per line
+//   CReplayDeviceSource     a recorded trace of timestamped lines
+//   CSyntheticDeviceSource  random events at a fixed rate
+//
+// The pipe and the replay trace share a text format, one event per line:
+//   insert <id>
+//   remove <id>
+//   data <id> <hex bytes>
+//   error <id> <hex HRESULT>
+// where id is a decimal device number.  Blank lines and lines starting with
+// # are ignored.
+
+#pragma once
+
+#include "EventReactor.h"
+
+#ifdef _WIN32
+typedef PCWSTR DEVICE_SOURCE_PATH;
+#else
+typedef const char* DEVICE_SOURCE_PATH;
+#endif
+
+// Longest line of the text format, and most data an event carries.
+#define DEVICE_SOURCE_LINE_CCH_MAX  256
+#define DEVICE_EVENT_DATA_CB_MAX    64
+
+// Most sources a provider runs besides its command window.
+#define DEVICE_SOURCES_MAX          4
+
+// Optional values under DEVICE_PIPELINE_REGKEY that turn the injectors on.
+#define DEVICE_SOURCE_REGVALUE_PIPE         L"EventPipe"        // REG_SZ pipe name
+#define DEVICE_SOURCE_REGVALUE_REPLAY       L"ReplayTrace"      // REG_SZ trace file
+#define DEVICE_SOURCE_REGVALUE_SYNTHETIC    L"SyntheticRate"    // REG_DWORD events per second
+#define DEVICE_SOURCE_REGVALUE_COMPANION    L"CompanionChannel" // REG_SZ name of the pipe and section
+
+enum DEVICE_EVENT_KIND
+{
+    DEK_INSERT,
+    DEK_REMOVE,
+    DEK_DATA,
+    DEK_ERROR,
+};
+
+struct DEVICE_EVENT
+{
+    DEVICE_EVENT_KIND   kind;
+    DWORD               dwDeviceId;
+    HRESULT             hrError;                            // DEK_ERROR only.
+    const BYTE*         pbData;                             // DEK_DATA only: rgbData, or the source's own
+    DWORD               cbData;                             // buffer for the length of OnDeviceEvent.
+    BYTE                rgbData[DEVICE_EVENT_DATA_CB_MAX];
+    ULONGLONG           ullEventUs;                         // CEventReactor::GetTimeUs when the source saw it.
+};
+
+class IDeviceEventSink
+{
+  public:
+    // Called on the reactor thread.
+    virtual void OnDeviceEvent(const DEVICE_EVENT* pEvent) = 0;
+};
+
+class CDeviceSource
+{
+  public:
+    CDeviceSource() : _pSink(NULL)
+    {
+    }
+
+    virtual ~CDeviceSource()
+    {
+    }
+
+    // Reactor thread only.  A source delivers events to pSink from Start
+    // until Stop, and must be stopped before it is deleted.
+    virtual HRESULT Start(IDeviceEventSink* pSink) = 0;
+    virtual void Stop() = 0;
+
+  protected:
+    IDeviceEventSink*   _pSink;
+};
+
+// Parses one line of the text format, which need not be terminated.
+// Returns S_OK for an event, S_FALSE for a blank or comment line, and
+// E_INVALIDARG for anything else.
+HRESULT ParseDeviceEventLine(const char* pch, size_t cch, DEVICE_EVENT* pEvent);
+
+// Splits a byte stream into lines and hands each event in it to a sink.
+// Lines longer than DEVICE_SOURCE_LINE_CCH_MAX are dropped.
+class CDeviceLineReader
+{
+  public:
+    CDeviceLineReader();
+
+    void Feed(const char* pch, size_t cch, IDeviceEventSink* pSink);
+    void Reset();
+
+    DWORD GetMalformedCount() const
+    {
+        return _cMalformed;
+    }
+
+  private:
+    void _Line(const char* pch, size_t cch, IDeviceEventSink* pSink);
+
+  private:
+    char    _rgchLine[DEVICE_SOURCE_LINE_CCH_MAX];
+    size_t  _cchLine;
+    bool    _fOverflow;         // Discarding the rest of an overlong line.
+    DWORD   _cMalformed;
+};
+
+#ifdef _WIN32
+// Creates the injectors configured in the registry.  None is the usual case.
+HRESULT CreateConfiguredDeviceSources(CDeviceSource** rgpSource, DWORD cSourcesMax, DWORD* pcSources);
+#endif
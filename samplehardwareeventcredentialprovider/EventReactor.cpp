@@ -0,0 +1,614 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Each pass of the reactor loop runs posted work, then due timers, then
+// waits for the next handle, message, post or timer.  On Windows the thread
+// pins the DLL while it runs and leaves through FreeLibraryAndExitThread, so
+// LogonUI can unload the provider as soon as the last client is gone.
+
+#include "EventReactor.h"
+
+#include <string.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+static CEventReactor s_eventReactor;
+
+CEventReactor* GetEventReactor()
+{
+    return &s_eventReactor;
+}
+
+// What a Send waits on.
+struct EVENT_SEND
+{
+    PFN_EVENT_CALLBACK  pfn;
+    void*               pvContext;
+    EVENT_HANDLE        hDone;
+};
+
+static void SendProc(void* pv)
+{
+    EVENT_SEND* pSend = (EVENT_SEND*)pv;
+    pSend->pfn(pSend->pvContext);
+#ifdef _WIN32
+    SetEvent(pSend->hDone);
+#else
+    uint64_t ull = 1;
+    ssize_t cb = write(pSend->hDone, &ull, sizeof(ull));
+    (void)cb;
+#endif
+}
+
+CEventReactor::CEventReactor():
+    _fThread(false),
+    _cClients(0),
+    _pPostHead(NULL),
+    _pPostTail(NULL),
+    _cSources(0),
+    _iFirstSource(0),
+    _cTimers(0)
+{
+    memset(&_latency, 0, sizeof(_latency));
+#ifdef _WIN32
+    InitializeCriticalSection(&_cs);
+    _hThread = NULL;
+    _dwThreadId = 0;
+    _hModule = NULL;
+    _hWake = CreateEventW(NULL, FALSE, FALSE, NULL);
+#else
+    pthread_mutex_init(&_mutex, NULL);
+    _epfd = epoll_create1(EPOLL_CLOEXEC);
+    _hWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((_epfd >= 0) && (_hWake >= 0))
+    {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = _hWake;
+        epoll_ctl(_epfd, EPOLL_CTL_ADD, _hWake, &ev);
+    }
+#endif
+}
+
+// By the time the reactor is destroyed every client has released it, so the
+// thread has exited or is on its way out.
+CEventReactor::~CEventReactor()
+{
+#ifdef _WIN32
+    if (_hWake)
+    {
+        CloseHandle(_hWake);
+    }
+    DeleteCriticalSection(&_cs);
+#else
+    if (_hWake >= 0)
+    {
+        close(_hWake);
+    }
+    if (_epfd >= 0)
+    {
+        close(_epfd);
+    }
+    pthread_mutex_destroy(&_mutex);
+#endif
+}
+
+void CEventReactor::_Lock()
+{
+#ifdef _WIN32
+    EnterCriticalSection(&_cs);
+#else
+    pthread_mutex_lock(&_mutex);
+#endif
+}
+
+void CEventReactor::_Unlock()
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&_cs);
+#else
+    pthread_mutex_unlock(&_mutex);
+#endif
+}
+
+void CEventReactor::_Wake()
+{
+#ifdef _WIN32
+    SetEvent(_hWake);
+#else
+    uint64_t ull = 1;
+    ssize_t cb = write(_hWake, &ull, sizeof(ull));
+    (void)cb;
+#endif
+}
+
+HRESULT CEventReactor::Acquire()
+{
+    HRESULT hr = S_OK;
+    _Lock();
+    _cClients++;
+    if (!_fThread)
+    {
+        hr = _StartThread();
+        if (FAILED(hr))
+        {
+            _cClients--;
+        }
+    }
+    _Unlock();
+    return hr;
+}
+
+void CEventReactor::Release()
+{
+    _Lock();
+    _cClients--;
+    const bool fLast = (0 == _cClients);
+    _Unlock();
+
+    if (fLast)
+    {
+        _Wake();
+    }
+}
+
+// Call with the lock held.
+HRESULT CEventReactor::_StartThread()
+{
+    HRESULT hr = S_OK;
+#ifdef _WIN32
+    if (!_hWake)
+    {
+        return E_UNEXPECTED;
+    }
+
+    // The thread holds its own reference on the DLL, which it drops as it exits.
+    if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (PCWSTR)&_ThreadProc, &_hModule))
+    {
+        _hThread = CreateThread(NULL, 0, _ThreadProc, this, 0, &_dwThreadId);
+        if (!_hThread)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            FreeLibrary(_hModule);
+            _hModule = NULL;
+        }
+    }
+    else
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+#else
+    if ((_epfd < 0) || (_hWake < 0))
+    {
+        return E_UNEXPECTED;
+    }
+
+    if (0 == pthread_create(&_thread, NULL, _ThreadProc, this))
+    {
+        pthread_detach(_thread);
+    }
+    else
+    {
+        hr = E_FAIL;
+    }
+#endif
+
+    if (SUCCEEDED(hr))
+    {
+        _fThread = true;
+    }
+    return hr;
+}
+
+bool CEventReactor::IsReactorThread() const
+{
+#ifdef _WIN32
+    return _fThread && (GetCurrentThreadId() == _dwThreadId);
+#else
+    return _fThread && pthread_equal(pthread_self(), _thread);
+#endif
+}
+
+HRESULT CEventReactor::Post(PFN_EVENT_CALLBACK pfn, void* pvContext)
+{
+    EVENT_POST* pPost = new EVENT_POST;
+    if (!pPost)
+    {
+        return E_OUTOFMEMORY;
+    }
+    pPost->pNext = NULL;
+    pPost->pfn = pfn;
+    pPost->pvContext = pvContext;
+
+    HRESULT hr = S_OK;
+    bool fWake = false;
+    _Lock();
+    if (_cClients > 0)
+    {
+        // Only the first post of a batch needs to wake the thread.
+        fWake = (NULL == _pPostHead);
+        if (_pPostTail)
+        {
+            _pPostTail->pNext = pPost;
+        }
+        else
+        {
+            _pPostHead = pPost;
+        }
+        _pPostTail = pPost;
+    }
+    else
+    {
+        hr = E_UNEXPECTED;
+    }
+    _Unlock();
+
+    if (fWake)
+    {
+        _Wake();
+    }
+    if (FAILED(hr))
+    {
+        delete pPost;
+    }
+    return hr;
+}
+
+HRESULT CEventReactor::Send(PFN_EVENT_CALLBACK pfn, void* pvContext)
+{
+    if (IsReactorThread())
+    {
+        pfn(pvContext);
+        return S_OK;
+    }
+
+    EVENT_SEND send;
+    send.pfn = pfn;
+    send.pvContext = pvContext;
+
+#ifdef _WIN32
+    send.hDone = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!send.hDone)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+    HRESULT hr = Post(SendProc, &send);
+    if (SUCCEEDED(hr))
+    {
+        WaitForSingleObject(send.hDone, INFINITE);
+    }
+    CloseHandle(send.hDone);
+#else
+    send.hDone = eventfd(0, EFD_CLOEXEC);
+    if (send.hDone < 0)
+    {
+        return E_FAIL;
+    }
+    HRESULT hr = Post(SendProc, &send);
+    if (SUCCEEDED(hr))
+    {
+        uint64_t ull;
+        while ((read(send.hDone, &ull, sizeof(ull)) < 0) && (EINTR == errno))
+        {
+        }
+    }
+    close(send.hDone);
+#endif
+    return hr;
+}
+
+int CEventReactor::_FindSource(EVENT_HANDLE h) const
+{
+    for (DWORD i = 0; i < _cSources; i++)
+    {
+        if (_rgSource[i].h == h)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+HRESULT CEventReactor::AddHandle(EVENT_HANDLE h, PFN_EVENT_CALLBACK pfn, void* pvContext)
+{
+    if (_FindSource(h) >= 0)
+    {
+        return E_INVALIDARG;
+    }
+    if (EVENT_REACTOR_HANDLES_MAX == _cSources)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+#ifndef _WIN32
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = h;
+    if (0 != epoll_ctl(_epfd, EPOLL_CTL_ADD, h, &ev))
+    {
+        return E_INVALIDARG;
+    }
+#endif
+
+    _rgSource[_cSources].h = h;
+    _rgSource[_cSources].pfn = pfn;
+    _rgSource[_cSources].pvContext = pvContext;
+    _cSources++;
+    return S_OK;
+}
+
+void CEventReactor::RemoveHandle(EVENT_HANDLE h)
+{
+    const int iSource = _FindSource(h);
+    if (iSource >= 0)
+    {
+#ifndef _WIN32
+        epoll_ctl(_epfd, EPOLL_CTL_DEL, h, NULL);
+#endif
+        _rgSource[iSource] = _rgSource[--_cSources];
+    }
+}
+
+HRESULT CEventReactor::SetTimer(EVENT_TIMER* pTimer, DWORD dwDelayMs, PFN_EVENT_CALLBACK pfn, void* pvContext)
+{
+    if (EVENT_TIMER_IDLE == pTimer->iTimer)
+    {
+        if (EVENT_REACTOR_TIMERS_MAX == _cTimers)
+        {
+            return E_OUTOFMEMORY;
+        }
+        pTimer->iTimer = _cTimers;
+        _rgpTimer[_cTimers++] = pTimer;
+    }
+    pTimer->ullDueMs = GetTimeMs() + dwDelayMs;
+    pTimer->pfn = pfn;
+    pTimer->pvContext = pvContext;
+    return S_OK;
+}
+
+void CEventReactor::CancelTimer(EVENT_TIMER* pTimer)
+{
+    if (EVENT_TIMER_IDLE != pTimer->iTimer)
+    {
+        EVENT_TIMER* pLast = _rgpTimer[--_cTimers];
+        _rgpTimer[pTimer->iTimer] = pLast;
+        pLast->iTimer = pTimer->iTimer;
+        pTimer->iTimer = EVENT_TIMER_IDLE;
+    }
+}
+
+void CEventReactor::RecordLatency(ULONGLONG ullEventUs)
+{
+    const ULONGLONG ullUs = GetTimeUs() - ullEventUs;
+    _latency.cEvents++;
+    _latency.ullTotalUs += ullUs;
+    _latency.ullLastUs = ullUs;
+    if (ullUs > _latency.ullMaxUs)
+    {
+        _latency.ullMaxUs = ullUs;
+    }
+}
+
+void CEventReactor::GetLatencyStats(EVENT_LATENCY_STATS* pStats) const
+{
+    *pStats = _latency;
+}
+
+ULONGLONG CEventReactor::GetTimeMs()
+{
+#ifdef _WIN32
+    return GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ULONGLONG)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+ULONGLONG CEventReactor::GetTimeUs()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER s_liFrequency;
+    if (0 == s_liFrequency.QuadPart)
+    {
+        QueryPerformanceFrequency(&s_liFrequency);
+    }
+    LARGE_INTEGER li;
+    QueryPerformanceCounter(&li);
+    const ULONGLONG ullFrequency = (ULONGLONG)s_liFrequency.QuadPart;
+    return ((ULONGLONG)li.QuadPart / ullFrequency) * 1000000 + ((ULONGLONG)li.QuadPart % ullFrequency) * 1000000 / ullFrequency;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ULONGLONG)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+// Returns whether there was anything to run.
+bool CEventReactor::_RunPosted()
+{
+    _Lock();
+    EVENT_POST* pPost = _pPostHead;
+    _pPostHead = NULL;
+    _pPostTail = NULL;
+    _Unlock();
+
+    const bool fRan = (NULL != pPost);
+    while (pPost)
+    {
+        EVENT_POST* pNext = pPost->pNext;
+        pPost->pfn(pPost->pvContext);
+        delete pPost;
+        pPost = pNext;
+    }
+    return fRan;
+}
+
+// Runs the timers that are due.  A timer rearmed by its callback waits for
+// the next pass, even with no delay, so the loop always gets back to waiting.
+void CEventReactor::_RunTimers()
+{
+    const ULONGLONG ullNowMs = GetTimeMs();
+    for (DWORD cPasses = _cTimers; cPasses > 0; cPasses--)
+    {
+        EVENT_TIMER* pDue = NULL;
+        for (DWORD i = 0; i < _cTimers; i++)
+        {
+            if ((_rgpTimer[i]->ullDueMs <= ullNowMs) && (!pDue || (_rgpTimer[i]->ullDueMs < pDue->ullDueMs)))
+            {
+                pDue = _rgpTimer[i];
+            }
+        }
+        if (!pDue)
+        {
+            break;
+        }
+
+        CancelTimer(pDue);
+        pDue->pfn(pDue->pvContext);
+    }
+}
+
+DWORD CEventReactor::_GetWaitMs()
+{
+    if (0 == _cTimers)
+    {
+        return EVENT_WAIT_INFINITE;
+    }
+
+    ULONGLONG ullDueMs = _rgpTimer[0]->ullDueMs;
+    for (DWORD i = 1; i < _cTimers; i++)
+    {
+        if (_rgpTimer[i]->ullDueMs < ullDueMs)
+        {
+            ullDueMs = _rgpTimer[i]->ullDueMs;
+        }
+    }
+
+    const ULONGLONG ullNowMs = GetTimeMs();
+    if (ullDueMs <= ullNowMs)
+    {
+        return 0;
+    }
+    return (ullDueMs - ullNowMs < EVENT_WAIT_INFINITE) ? (DWORD)(ullDueMs - ullNowMs) : EVENT_WAIT_INFINITE - 1;
+}
+
+// Waits for one round of activity and dispatches it.
+void CEventReactor::_Wait(DWORD dwWaitMs)
+{
+#ifdef _WIN32
+    // The wake event goes first; the sources follow in rotating order.
+    HANDLE rgh[1 + EVENT_REACTOR_HANDLES_MAX];
+    EVENT_SOURCE rgSource[EVENT_REACTOR_HANDLES_MAX];
+    const DWORD cSources = _cSources;
+    rgh[0] = _hWake;
+    for (DWORD i = 0; i < cSources; i++)
+    {
+        rgSource[i] = _rgSource[(_iFirstSource + i) % cSources];
+        rgh[1 + i] = rgSource[i].h;
+    }
+    _iFirstSource = cSources ? (_iFirstSource + 1) % cSources : 0;
+
+    const DWORD dw = MsgWaitForMultipleObjectsEx(1 + cSources, rgh, dwWaitMs, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+    if ((dw > WAIT_OBJECT_0) && (dw <= WAIT_OBJECT_0 + cSources))
+    {
+        const EVENT_SOURCE& source = rgSource[dw - WAIT_OBJECT_0 - 1];
+        source.pfn(source.pvContext);
+    }
+    else if ((dw > WAIT_ABANDONED_0) && (dw <= WAIT_ABANDONED_0 + cSources))
+    {
+        const EVENT_SOURCE& source = rgSource[dw - WAIT_ABANDONED_0 - 1];
+        source.pfn(source.pvContext);
+    }
+    else if (WAIT_OBJECT_0 + 1 + cSources == dw)
+    {
+        // Every message for this thread, not only those of one window.
+        // Messages posted to the thread itself have no window to go to and
+        // are simply taken off the queue.
+        MSG msg;
+        while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE))
+        {
+            TranslateMessage(&msg);
+            DispatchMessageW(&msg);
+        }
+    }
+#else
+    struct epoll_event rgev[1 + EVENT_REACTOR_HANDLES_MAX];
+    const int cev = epoll_wait(_epfd, rgev, 1 + EVENT_REACTOR_HANDLES_MAX, (EVENT_WAIT_INFINITE == dwWaitMs) ? -1 : (int)dwWaitMs);
+    for (int i = 0; i < cev; i++)
+    {
+        const int fd = rgev[i].data.fd;
+        if (fd == _hWake)
+        {
+            uint64_t ull;
+            ssize_t cb = read(_hWake, &ull, sizeof(ull));
+            (void)cb;
+            continue;
+        }
+
+        // An earlier callback of this round may have removed the source.
+        const int iSource = _FindSource(fd);
+        if (iSource >= 0)
+        {
+            const EVENT_SOURCE source = _rgSource[iSource];
+            source.pfn(source.pvContext);
+        }
+    }
+#endif
+}
+
+void CEventReactor::_Run()
+{
+    for (;;)
+    {
+        _RunPosted();
+        _RunTimers();
+
+        // Decided under the lock, so an Acquire that comes after this starts
+        // a new thread.
+        _Lock();
+        const bool fExit = (0 == _cClients) && (NULL == _pPostHead);
+        if (fExit)
+        {
+            _fThread = false;
+#ifdef _WIN32
+            CloseHandle(_hThread);
+            _hThread = NULL;
+#endif
+        }
+        _Unlock();
+
+        if (fExit)
+        {
+            break;
+        }
+        _Wait(_GetWaitMs());
+    }
+}
+
+#ifdef _WIN32
+DWORD WINAPI CEventReactor::_ThreadProc(void* pv)
+{
+    CEventReactor* pThis = (CEventReactor*)pv;
+    HMODULE hModule = pThis->_hModule;
+    pThis->_Run();
+    FreeLibraryAndExitThread(hModule, 0);
+    return 0;
+}
+#else
+void* CEventReactor::_ThreadProc(void* pv)
+{
+    ((CEventReactor*)pv)->_Run();
+    return NULL;
+}
+#endif
@@ -0,0 +1,187 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CEventReactor is the one thread in the process that watches for hardware
+// events, shared by every provider instance and every event source.  It
+// waits on everything at once: waitable handles (device notifications,
+// pipes, events), timers, work posted from other threads and, on Windows,
+// the messages of any window created on it.
+//
+// Handles, timers and windows belong to the reactor thread: add and remove
+// them from a callback, or from another thread through Send.  Post and Send
+// may be called from any thread.  A callback runs on the reactor thread and
+// must not block, since every other source waits behind it.
+//
+// The thread starts with the first Acquire and exits after the last
+// Release.  On Windows it waits with MsgWaitForMultipleObjectsEx and pumps
+// every message queued to it, thread messages included.  Elsewhere it waits
+// with epoll, so sources can be exercised without LogonUI.
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef HANDLE EVENT_HANDLE;
+
+#else
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// Just enough of the Windows types for the epoll backend.
+typedef int EVENT_HANDLE;
+typedef int32_t HRESULT;
+typedef uint8_t BYTE;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+
+#define S_OK            ((HRESULT)0)
+#define S_FALSE         ((HRESULT)1)
+#define E_FAIL          ((HRESULT)0x80004005)
+#define E_OUTOFMEMORY   ((HRESULT)0x8007000E)
+#define E_INVALIDARG    ((HRESULT)0x80070057)
+#define E_UNEXPECTED    ((HRESULT)0x8000FFFF)
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+#endif
+
+// Most handles the reactor waits on, not counting its own.  This is the
+// MsgWaitForMultipleObjects limit.
+#define EVENT_REACTOR_HANDLES_MAX   62
+
+// Most timers armed at once.
+#define EVENT_REACTOR_TIMERS_MAX    64
+
+#define EVENT_TIMER_IDLE            ((DWORD)-1)
+#define EVENT_WAIT_INFINITE         ((DWORD)-1)
+
+typedef void (*PFN_EVENT_CALLBACK)(void* pvContext);
+
+// A zero-filled EVENT_TIMER is not valid; set iTimer to EVENT_TIMER_IDLE.
+struct EVENT_TIMER
+{
+    ULONGLONG           ullDueMs;
+    PFN_EVENT_CALLBACK  pfn;
+    void*               pvContext;
+    DWORD               iTimer;         // Slot in the reactor, or EVENT_TIMER_IDLE.
+};
+
+// How long hardware events take to reach LogonUI: from the moment the reactor
+// sees an event to the return of the CredentialsChanged it causes.
+struct EVENT_LATENCY_STATS
+{
+    DWORD       cEvents;
+    ULONGLONG   ullTotalUs;
+    ULONGLONG   ullMaxUs;
+    ULONGLONG   ullLastUs;
+};
+
+class CEventReactor
+{
+  public:
+    CEventReactor();
+    ~CEventReactor();
+
+    // A client holds the reactor running.  Acquire starts the thread if
+    // needed; the thread exits once every client has released it.  A client
+    // must remove its handles and timers before it releases.
+    HRESULT Acquire();
+    void Release();
+
+    // Runs pfn(pvContext) on the reactor thread.  Post returns at once; Send
+    // waits until pfn has run, and runs it directly on the reactor thread.
+    // Both fail unless the reactor has been acquired.
+    HRESULT Post(PFN_EVENT_CALLBACK pfn, void* pvContext);
+    HRESULT Send(PFN_EVENT_CALLBACK pfn, void* pvContext);
+
+    bool IsReactorThread() const;
+
+    // Reactor thread only.  pfn runs whenever h is signalled; on Windows an
+    // auto-reset handle is reset by the wait, otherwise the callback must
+    // consume what signalled it.
+    HRESULT AddHandle(EVENT_HANDLE h, PFN_EVENT_CALLBACK pfn, void* pvContext);
+    void RemoveHandle(EVENT_HANDLE h);
+
+    // Reactor thread only.  Arms pTimer to run pfn once, dwDelayMs from now;
+    // an armed timer is moved to the new time.
+    HRESULT SetTimer(EVENT_TIMER* pTimer, DWORD dwDelayMs, PFN_EVENT_CALLBACK pfn, void* pvContext);
+    void CancelTimer(EVENT_TIMER* pTimer);
+
+    // Reactor thread only.  Records one event delivered to LogonUI, given the
+    // GetTimeUs at which the event was seen.
+    void RecordLatency(ULONGLONG ullEventUs);
+    void GetLatencyStats(EVENT_LATENCY_STATS* pStats) const;
+
+    static ULONGLONG GetTimeMs();
+    static ULONGLONG GetTimeUs();
+
+  private:
+    struct EVENT_POST
+    {
+        EVENT_POST*         pNext;
+        PFN_EVENT_CALLBACK  pfn;
+        void*               pvContext;
+    };
+
+    struct EVENT_SOURCE
+    {
+        EVENT_HANDLE        h;
+        PFN_EVENT_CALLBACK  pfn;
+        void*               pvContext;
+    };
+
+    void _Lock();
+    void _Unlock();
+    void _Wake();
+    HRESULT _StartThread();
+    void _Run();
+    bool _RunPosted();
+    void _RunTimers();
+    DWORD _GetWaitMs();
+    int _FindSource(EVENT_HANDLE h) const;
+    void _Wait(DWORD dwWaitMs);
+
+#ifdef _WIN32
+    static DWORD WINAPI _ThreadProc(void* pv);
+#else
+    static void* _ThreadProc(void* pv);
+#endif
+
+  private:
+#ifdef _WIN32
+    CRITICAL_SECTION    _cs;
+    HANDLE              _hThread;
+    DWORD               _dwThreadId;
+    HMODULE             _hModule;           // Pins the DLL while the thread runs.
+#else
+    pthread_mutex_t     _mutex;
+    pthread_t           _thread;
+    int                 _epfd;
+#endif
+    bool                _fThread;           // A thread is running or about to.
+    EVENT_HANDLE        _hWake;             // Signalled by Post and Release.
+
+    // Guarded by the lock.
+    LONG                _cClients;
+    EVENT_POST*         _pPostHead;
+    EVENT_POST*         _pPostTail;
+
+    // Reactor thread only.
+    EVENT_SOURCE        _rgSource[EVENT_REACTOR_HANDLES_MAX];
+    DWORD               _cSources;
+    DWORD               _iFirstSource;      // Rotates so a busy handle cannot starve the others.
+    EVENT_TIMER*        _rgpTimer[EVENT_REACTOR_TIMERS_MAX];
+    DWORD               _cTimers;
+    EVENT_LATENCY_STATS _latency;
+};
+
+// The process-wide reactor.
+CEventReactor* GetEventReactor();
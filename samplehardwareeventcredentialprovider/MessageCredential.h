@@ -24,12 +24,12 @@ class CMessageCredential : public ICredentialProviderCredential
     // IUnknown
     IFACEMETHODIMP_(ULONG) AddRef()
     {
-        return ++_cRef;
+        return InterlockedIncrement(&_cRef);
     }
     
     IFACEMETHODIMP_(ULONG) Release()
     {
-        LONG cRef = --_cRef;
+        LONG cRef = InterlockedDecrement(&_cRef);
         if (!cRef)
         {
             delete this;
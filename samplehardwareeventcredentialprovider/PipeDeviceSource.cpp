@@ -0,0 +1,341 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// On Windows the pipe is a single overlapped instance whose event the reactor
+// waits on.  Every step, connecting or reading, is one overlapped operation;
+// when it completes the reactor calls _OnSignalled, which starts the next.
+// The instance is created once and reused for each writer, so nobody else can
+// take the name between two of them.
+
+#include "PipeDeviceSource.h"
+
+#include <string.h>
+#ifdef _WIN32
+#include <sddl.h>
+#include <strsafe.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#endif
+
+void CPipeDeviceSource::_OnReceived(const char* pch, size_t cch)
+{
+    _reader.Feed(pch, cch, _pSink);
+}
+
+#ifdef _WIN32
+
+CPipeDeviceSource::CPipeDeviceSource(PCWSTR pszName):
+    _hPipe(INVALID_HANDLE_VALUE),
+    _hEvent(NULL),
+    _fConnected(false),
+    _fPending(false)
+{
+    StringCchCopyW(_wszName, ARRAYSIZE(_wszName), pszName);
+    ZeroMemory(&_ov, sizeof(_ov));
+}
+
+CPipeDeviceSource::~CPipeDeviceSource()
+{
+    Stop();
+}
+
+HRESULT CPipeDeviceSource::Start(IDeviceEventSink* pSink)
+{
+    _pSink = pSink;
+
+    HRESULT hr = S_OK;
+    _hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (_hEvent == NULL)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        PSECURITY_DESCRIPTOR psd;
+        if (ConvertStringSecurityDescriptorToSecurityDescriptorW(DEVICE_PIPE_SDDL, SDDL_REVISION_1, &psd, NULL))
+        {
+            SECURITY_ATTRIBUTES sa = { sizeof(sa), psd, FALSE };
+            _hPipe = CreateNamedPipeW(_wszName,
+                                      PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                      PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                      1, 0, DEVICE_PIPE_BUFFER_CB, 0, &sa);
+            if (_hPipe == INVALID_HANDLE_VALUE)
+            {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+            }
+            LocalFree(psd);
+        }
+        else
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = GetEventReactor()->AddHandle(_hEvent, _OnSignalled, this);
+        if (SUCCEEDED(hr))
+        {
+            hr = _Listen();
+            if (FAILED(hr))
+            {
+                GetEventReactor()->RemoveHandle(_hEvent);
+            }
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        Stop();
+    }
+    return hr;
+}
+
+void CPipeDeviceSource::Stop()
+{
+    if (_hEvent != NULL)
+    {
+        GetEventReactor()->RemoveHandle(_hEvent);
+    }
+    if (_hPipe != INVALID_HANDLE_VALUE)
+    {
+        if (_fPending)
+        {
+            // The operation writes into us, so wait for the cancellation to land.
+            DWORD cb;
+            CancelIoEx(_hPipe, &_ov);
+            GetOverlappedResult(_hPipe, &_ov, &cb, TRUE);
+            _fPending = false;
+        }
+        CloseHandle(_hPipe);
+        _hPipe = INVALID_HANDLE_VALUE;
+    }
+    if (_hEvent != NULL)
+    {
+        CloseHandle(_hEvent);
+        _hEvent = NULL;
+    }
+    _fConnected = false;
+    _reader.Reset();
+}
+
+// Waits for the next writer.  One that connected before we asked is picked up
+// by signalling the event ourselves.
+HRESULT CPipeDeviceSource::_Listen()
+{
+    HRESULT hr = S_OK;
+    ZeroMemory(&_ov, sizeof(_ov));
+    _ov.hEvent = _hEvent;
+    if (ConnectNamedPipe(_hPipe, &_ov))
+    {
+        _fConnected = true;
+        SetEvent(_hEvent);
+    }
+    else
+    {
+        switch (GetLastError())
+        {
+        case ERROR_IO_PENDING:
+            _fPending = true;
+            break;
+
+        case ERROR_PIPE_CONNECTED:
+            _fConnected = true;
+            SetEvent(_hEvent);
+            break;
+
+        default:
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            break;
+        }
+    }
+    return hr;
+}
+
+// Reads whatever the writer has sent.  A read that completes at once still
+// signals the event, so it is handled the same way as one that pends.
+void CPipeDeviceSource::_Read()
+{
+    if (ReadFile(_hPipe, _rgbBuffer, sizeof(_rgbBuffer), NULL, &_ov) || (ERROR_IO_PENDING == GetLastError()))
+    {
+        _fPending = true;
+    }
+    else
+    {
+        _Disconnect();
+    }
+}
+
+// Drops the writer and listens for the next one.
+void CPipeDeviceSource::_Disconnect()
+{
+    _fConnected = false;
+    _reader.Reset();
+    DisconnectNamedPipe(_hPipe);
+    if (FAILED(_Listen()))
+    {
+        // Nothing left to wait for; the source stays quiet until it is stopped.
+        OutputDebugString(L"PipeDeviceSource: cannot listen\n");
+        ResetEvent(_hEvent);
+    }
+}
+
+void CPipeDeviceSource::_OnSignalled(void* pv)
+{
+    CPipeDeviceSource* pThis = static_cast<CPipeDeviceSource*>(pv);
+    if (pThis->_fPending)
+    {
+        DWORD cb;
+        const BOOL fOk = GetOverlappedResult(pThis->_hPipe, &pThis->_ov, &cb, FALSE);
+        pThis->_fPending = false;
+        if (!fOk)
+        {
+            // A broken pipe: the writer went away.
+            pThis->_Disconnect();
+            return;
+        }
+
+        if (pThis->_fConnected)
+        {
+            pThis->_OnReceived(pThis->_rgbBuffer, cb);
+        }
+        else
+        {
+            pThis->_fConnected = true;
+        }
+    }
+    else
+    {
+        // Signalled by _Listen, or left over from a failure.
+        ResetEvent(pThis->_hEvent);
+        if (!pThis->_fConnected)
+        {
+            return;
+        }
+    }
+    pThis->_Read();
+}
+
+#else
+
+CPipeDeviceSource::CPipeDeviceSource(const char* pszName):
+    _fdListen(-1),
+    _fdClient(-1)
+{
+    strncpy(_szPath, pszName, sizeof(_szPath) - 1);
+    _szPath[sizeof(_szPath) - 1] = '\0';
+}
+
+CPipeDeviceSource::~CPipeDeviceSource()
+{
+    Stop();
+}
+
+HRESULT CPipeDeviceSource::Start(IDeviceEventSink* pSink)
+{
+    _pSink = pSink;
+
+    HRESULT hr = S_OK;
+    _fdListen = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (_fdListen < 0)
+    {
+        hr = E_FAIL;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, _szPath, sizeof(_szPath));
+
+        // A socket left behind by an earlier run would make bind fail.
+        unlink(_szPath);
+        if ((0 != bind(_fdListen, (struct sockaddr*)&addr, sizeof(addr))) ||
+            (0 != chmod(_szPath, S_IRUSR | S_IWUSR)) ||
+            (0 != listen(_fdListen, 1)))
+        {
+            hr = E_FAIL;
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = GetEventReactor()->AddHandle(_fdListen, _OnAccept, this);
+    }
+
+    if (FAILED(hr) && (_fdListen >= 0))
+    {
+        close(_fdListen);
+        _fdListen = -1;
+    }
+    return hr;
+}
+
+void CPipeDeviceSource::Stop()
+{
+    if (_fdClient >= 0)
+    {
+        _Disconnect();
+    }
+    if (_fdListen >= 0)
+    {
+        GetEventReactor()->RemoveHandle(_fdListen);
+        close(_fdListen);
+        _fdListen = -1;
+        unlink(_szPath);
+    }
+}
+
+void CPipeDeviceSource::_Disconnect()
+{
+    GetEventReactor()->RemoveHandle(_fdClient);
+    close(_fdClient);
+    _fdClient = -1;
+    _reader.Reset();
+}
+
+// One writer at a time, as with a single pipe instance: later ones are turned away.
+void CPipeDeviceSource::_OnAccept(void* pv)
+{
+    CPipeDeviceSource* pThis = static_cast<CPipeDeviceSource*>(pv);
+    const int fd = accept4(pThis->_fdListen, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd >= 0)
+    {
+        if ((pThis->_fdClient < 0) && SUCCEEDED(GetEventReactor()->AddHandle(fd, _OnRead, pThis)))
+        {
+            pThis->_fdClient = fd;
+        }
+        else
+        {
+            close(fd);
+        }
+    }
+}
+
+// One read per wakeup; the reactor comes back while more is waiting, after
+// giving every other source its turn.
+void CPipeDeviceSource::_OnRead(void* pv)
+{
+    CPipeDeviceSource* pThis = static_cast<CPipeDeviceSource*>(pv);
+    const ssize_t cb = read(pThis->_fdClient, pThis->_rgbBuffer, sizeof(pThis->_rgbBuffer));
+    if (cb > 0)
+    {
+        pThis->_OnReceived(pThis->_rgbBuffer, (size_t)cb);
+    }
+    else if ((0 == cb) || ((EAGAIN != errno) && (EINTR != errno)))
+    {
+        pThis->_Disconnect();
+    }
+}
+
+#endif
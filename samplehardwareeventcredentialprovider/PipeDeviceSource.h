@@ -0,0 +1,80 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CPipeDeviceSource reads device events, in the text format of
+// DeviceSource.h, from whatever connects to a named pipe, so a script or a
+// test harness can play hardware:
+//
+//   echo insert 1 > \\.\pipe\SampleHardwareEvents
+//
+// One writer is served at a time; when it disconnects the pipe listens for
+// the next.  Only SYSTEM and Administrators may connect, and never from
+// another machine, since whoever writes here decides which tiles LogonUI
+// shows.  Elsewhere the pipe is a Unix domain socket only its owner may use.
+
+#pragma once
+
+#include "DeviceSource.h"
+
+#ifndef _WIN32
+#include <sys/un.h>
+#endif
+
+// Read buffer; a read returns whatever has been written, up to this much.
+#define DEVICE_PIPE_BUFFER_CB   4096
+
+// Full control for SYSTEM and Administrators, nobody else.
+#define DEVICE_PIPE_SDDL        L"D:P(A;;GA;;;SY)(A;;GA;;;BA)"
+
+class CPipeDeviceSource : public CDeviceSource
+{
+  public:
+    CPipeDeviceSource(DEVICE_SOURCE_PATH pszName);
+    ~CPipeDeviceSource();
+
+    HRESULT Start(IDeviceEventSink* pSink);
+    void Stop();
+
+    DWORD GetMalformedCount() const
+    {
+        return _reader.GetMalformedCount();
+    }
+
+  protected:
+    // Called on the reactor thread with whatever the writer sent.  Parses it
+    // as text events unless a derived source speaks another protocol.
+    virtual void _OnReceived(const char* pch, size_t cch);
+
+  private:
+#ifdef _WIN32
+    HRESULT _Listen();
+    void _Read();
+    void _Disconnect();
+    static void _OnSignalled(void* pv);
+#else
+    void _Disconnect();
+    static void _OnAccept(void* pv);
+    static void _OnRead(void* pv);
+#endif
+
+  private:
+#ifdef _WIN32
+    WCHAR               _wszName[MAX_PATH];
+    HANDLE              _hPipe;
+    HANDLE              _hEvent;            // Manual reset, signalled when _ov completes.
+    OVERLAPPED          _ov;
+    bool                _fConnected;        // Reading, rather than waiting for a writer.
+    bool                _fPending;          // _ov is in flight.
+#else
+    char                _szPath[sizeof(((struct sockaddr_un*)0)->sun_path)];
+    int                 _fdListen;
+    int                 _fdClient;
+#endif
+    CDeviceLineReader   _reader;
+    char                _rgbBuffer[DEVICE_PIPE_BUFFER_CB];
+};
@@ -0,0 +1,224 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "ReplayDeviceSource.h"
+
+#include <string.h>
+#ifdef _WIN32
+#include <strsafe.h>
+#else
+#include <stdio.h>
+#endif
+
+// Most steps played in one timer callback, so a trace with thousands of
+// events at the same millisecond does not hold up the other sources.
+#define DEVICE_REPLAY_BATCH_MAX     256
+
+CReplayDeviceSource::CReplayDeviceSource(DEVICE_SOURCE_PATH pszPath, bool fLoop):
+    _fLoop(fLoop),
+    _rgStep(NULL),
+    _cSteps(0),
+    _cMalformed(0),
+    _iNext(0),
+    _ullStartMs(0)
+{
+#ifdef _WIN32
+    StringCchCopyW(_wszPath, ARRAYSIZE(_wszPath), pszPath);
+#else
+    strncpy(_szPath, pszPath, sizeof(_szPath) - 1);
+    _szPath[sizeof(_szPath) - 1] = '\0';
+#endif
+    _timer.iTimer = EVENT_TIMER_IDLE;
+}
+
+CReplayDeviceSource::~CReplayDeviceSource()
+{
+    delete[] _rgStep;
+}
+
+HRESULT CReplayDeviceSource::Load()
+{
+    HRESULT hr = S_OK;
+    char* pch = NULL;
+    size_t cch = 0;
+
+#ifdef _WIN32
+    HANDLE hFile = CreateFileW(_wszPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+    else
+    {
+        LARGE_INTEGER liSize;
+        if (!GetFileSizeEx(hFile, &liSize))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+        else if (liSize.QuadPart > DEVICE_REPLAY_FILE_CB_MAX)
+        {
+            hr = E_INVALIDARG;
+        }
+        else
+        {
+            pch = new char[(size_t)liSize.QuadPart + 1];
+            if (pch == NULL)
+            {
+                hr = E_OUTOFMEMORY;
+            }
+            else
+            {
+                DWORD cbRead;
+                if (!ReadFile(hFile, pch, (DWORD)liSize.QuadPart, &cbRead, NULL))
+                {
+                    hr = HRESULT_FROM_WIN32(GetLastError());
+                }
+                cch = cbRead;
+            }
+        }
+        CloseHandle(hFile);
+    }
+#else
+    FILE* pFile = fopen(_szPath, "rb");
+    if (pFile == NULL)
+    {
+        hr = E_INVALIDARG;
+    }
+    else
+    {
+        pch = new char[DEVICE_REPLAY_FILE_CB_MAX + 1];
+        cch = fread(pch, 1, DEVICE_REPLAY_FILE_CB_MAX + 1, pFile);
+        if (cch > DEVICE_REPLAY_FILE_CB_MAX)
+        {
+            hr = E_INVALIDARG;
+        }
+        fclose(pFile);
+    }
+#endif
+
+    if (SUCCEEDED(hr))
+    {
+        hr = _Parse(pch, cch);
+    }
+    delete[] pch;
+    return hr;
+}
+
+HRESULT CReplayDeviceSource::_Parse(const char* pch, size_t cch)
+{
+    // One step at most per line.
+    DWORD cLines = 1;
+    for (size_t i = 0; i < cch; i++)
+    {
+        if ('\n' == pch[i])
+        {
+            cLines++;
+        }
+    }
+
+    delete[] _rgStep;
+    _rgStep = new REPLAY_STEP[cLines];
+    _cSteps = 0;
+    _cMalformed = 0;
+    if (_rgStep == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    const char* pchEnd = pch + cch;
+    ULONGLONG ullLastMs = 0;
+    while (pch < pchEnd)
+    {
+        const char* pchNewline = (const char*)memchr(pch, '\n', pchEnd - pch);
+        const char* pchLineEnd = pchNewline ? pchNewline : pchEnd;
+
+        const char* pchEvent = pch;
+        while ((pchEvent < pchLineEnd) && ((' ' == *pchEvent) || ('\t' == *pchEvent)))
+        {
+            pchEvent++;
+        }
+
+        if ((pchEvent < pchLineEnd) && ('#' != *pchEvent) && ('\r' != *pchEvent))
+        {
+            // The time, then the event.
+            ULONGLONG ullAtMs = 0;
+            DWORD cDigits = 0;
+            while ((pchEvent < pchLineEnd) && (*pchEvent >= '0') && (*pchEvent <= '9') && (cDigits < 12))
+            {
+                ullAtMs = ullAtMs * 10 + (*pchEvent - '0');
+                pchEvent++;
+                cDigits++;
+            }
+
+            REPLAY_STEP* pStep = &_rgStep[_cSteps];
+            if ((cDigits > 0) && (S_OK == ParseDeviceEventLine(pchEvent, pchLineEnd - pchEvent, &pStep->event)))
+            {
+                // Steps play in order; one out of order plays with the one before it.
+                ullLastMs = (ullAtMs > ullLastMs) ? ullAtMs : ullLastMs;
+                pStep->ullAtMs = ullLastMs;
+                _cSteps++;
+            }
+            else
+            {
+                _cMalformed++;
+            }
+        }
+
+        pch = pchNewline ? pchNewline + 1 : pchEnd;
+    }
+    return S_OK;
+}
+
+HRESULT CReplayDeviceSource::Start(IDeviceEventSink* pSink)
+{
+    _pSink = pSink;
+    _iNext = 0;
+    _ullStartMs = CEventReactor::GetTimeMs();
+    _Arm();
+    return S_OK;
+}
+
+void CReplayDeviceSource::Stop()
+{
+    GetEventReactor()->CancelTimer(&_timer);
+}
+
+// Arms the timer for the next step, starting the trace over if it loops.
+void CReplayDeviceSource::_Arm()
+{
+    const ULONGLONG ullNowMs = CEventReactor::GetTimeMs();
+    if (_iNext == _cSteps)
+    {
+        if (!_fLoop || (0 == _cSteps))
+        {
+            return;
+        }
+        _iNext = 0;
+        _ullStartMs = ullNowMs;
+    }
+
+    const ULONGLONG ullDueMs = _ullStartMs + _rgStep[_iNext].ullAtMs;
+    GetEventReactor()->SetTimer(&_timer, (ullDueMs > ullNowMs) ? (DWORD)(ullDueMs - ullNowMs) : 0, _OnTimer, this);
+}
+
+void CReplayDeviceSource::_OnTimer(void* pv)
+{
+    CReplayDeviceSource* pThis = static_cast<CReplayDeviceSource*>(pv);
+    const ULONGLONG ullNowMs = CEventReactor::GetTimeMs();
+    for (DWORD cPlayed = 0;
+         (cPlayed < DEVICE_REPLAY_BATCH_MAX) && (pThis->_iNext < pThis->_cSteps) &&
+         (pThis->_ullStartMs + pThis->_rgStep[pThis->_iNext].ullAtMs <= ullNowMs);
+         cPlayed++)
+    {
+        DEVICE_EVENT* pEvent = &pThis->_rgStep[pThis->_iNext++].event;
+        pEvent->ullEventUs = CEventReactor::GetTimeUs();
+        pThis->_pSink->OnDeviceEvent(pEvent);
+    }
+    pThis->_Arm();
+}
@@ -0,0 +1,77 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CReplayDeviceSource plays back a recorded trace, so a problem seen with
+// real hardware (a bouncing contact, a dock that drops off the bus) can be
+// reproduced as often as needed.  Each line of the trace is a time in
+// milliseconds from the start of the trace followed by an event in the
+// format of DeviceSource.h:
+//
+//   # reader bounces twice, then settles
+//   0    insert 1
+//   3    remove 1
+//   5    insert 1
+//   900  data 1 0a0b
+//
+// The trace is read and parsed once by Load, and replayed from a reactor
+// timer, so playing it costs no file I/O.
+
+#pragma once
+
+#include "DeviceSource.h"
+
+// Largest trace Load accepts.
+#define DEVICE_REPLAY_FILE_CB_MAX   (1024 * 1024)
+
+class CReplayDeviceSource : public CDeviceSource
+{
+  public:
+    CReplayDeviceSource(DEVICE_SOURCE_PATH pszPath, bool fLoop = false);
+    ~CReplayDeviceSource();
+
+    // Reads the trace.  Lines that do not parse are counted and skipped.
+    HRESULT Load();
+
+    HRESULT Start(IDeviceEventSink* pSink);
+    void Stop();
+
+    DWORD GetStepCount() const
+    {
+        return _cSteps;
+    }
+
+    DWORD GetMalformedCount() const
+    {
+        return _cMalformed;
+    }
+
+  private:
+    struct REPLAY_STEP
+    {
+        ULONGLONG       ullAtMs;        // From the start of the trace.
+        DEVICE_EVENT    event;
+    };
+
+    HRESULT _Parse(const char* pch, size_t cch);
+    void _Arm();
+    static void _OnTimer(void* pv);
+
+  private:
+#ifdef _WIN32
+    WCHAR           _wszPath[MAX_PATH];
+#else
+    char            _szPath[4096];
+#endif
+    bool            _fLoop;
+    REPLAY_STEP*    _rgStep;
+    DWORD           _cSteps;
+    DWORD           _cMalformed;
+    DWORD           _iNext;             // Next step to play.
+    ULONGLONG       _ullStartMs;        // When this pass of the trace began.
+    EVENT_TIMER     _timer;
+};
@@ -0,0 +1,123 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "SyntheticDeviceSource.h"
+
+#define DEVICE_SYNTHETIC_SEED   0x2545F491
+
+CSyntheticDeviceSource::CSyntheticDeviceSource(DWORD dwEventsPerSecond, DWORD cDevices):
+    _dwEventsPerSecond(dwEventsPerSecond),
+    _cDevices(cDevices),
+    _ullPresent(0),
+    _dwSeed(DEVICE_SYNTHETIC_SEED),
+    _ullStartMs(0),
+    _cScheduled(0),
+    _cEmitted(0)
+{
+    if (_cDevices == 0)
+    {
+        _cDevices = 1;
+    }
+    else if (_cDevices > DEVICE_SYNTHETIC_DEVICES_MAX)
+    {
+        _cDevices = DEVICE_SYNTHETIC_DEVICES_MAX;
+    }
+    _timer.iTimer = EVENT_TIMER_IDLE;
+}
+
+HRESULT CSyntheticDeviceSource::Start(IDeviceEventSink* pSink)
+{
+    _pSink = pSink;
+    _ullStartMs = CEventReactor::GetTimeMs();
+    _cScheduled = 0;
+    _cEmitted = 0;
+    return GetEventReactor()->SetTimer(&_timer, DEVICE_SYNTHETIC_TICK_MS, _OnTick, this);
+}
+
+void CSyntheticDeviceSource::Stop()
+{
+    GetEventReactor()->CancelTimer(&_timer);
+}
+
+// xorshift32.
+DWORD CSyntheticDeviceSource::_Random()
+{
+    _dwSeed ^= _dwSeed << 13;
+    _dwSeed ^= _dwSeed >> 17;
+    _dwSeed ^= _dwSeed << 5;
+    return _dwSeed;
+}
+
+// One event in sixteen is an error, three are data from a device that is
+// present, and the rest insert or remove a device.
+void CSyntheticDeviceSource::_Emit(ULONGLONG ullEventUs)
+{
+    const DWORD dwRandom = _Random();
+    const DWORD dwDevice = (dwRandom >> 4) % _cDevices;
+    const ULONGLONG ullBit = 1ULL << dwDevice;
+    const DWORD dwKind = dwRandom & 0xF;
+
+    DEVICE_EVENT event;
+    event.dwDeviceId = dwDevice;
+    event.hrError = S_OK;
+    event.pbData = event.rgbData;
+    event.cbData = 0;
+    event.ullEventUs = ullEventUs;
+
+    if (0 == dwKind)
+    {
+        event.kind = DEK_ERROR;
+        event.hrError = E_FAIL;
+        _ullPresent &= ~ullBit;
+    }
+    else if ((dwKind <= 3) && (_ullPresent & ullBit))
+    {
+        const DWORD dwData = _Random();
+        event.kind = DEK_DATA;
+        event.cbData = sizeof(dwData);
+        for (DWORD i = 0; i < sizeof(dwData); i++)
+        {
+            event.rgbData[i] = (BYTE)(dwData >> (i * 8));
+        }
+    }
+    else
+    {
+        event.kind = (_ullPresent & ullBit) ? DEK_REMOVE : DEK_INSERT;
+        _ullPresent ^= ullBit;
+    }
+
+    _pSink->OnDeviceEvent(&event);
+    _cEmitted++;
+}
+
+// Catches up with the rate since Start, so the count stays exact however late
+// the timer fires.
+void CSyntheticDeviceSource::_OnTick(void* pv)
+{
+    CSyntheticDeviceSource* pThis = static_cast<CSyntheticDeviceSource*>(pv);
+    const ULONGLONG ullElapsedMs = CEventReactor::GetTimeMs() - pThis->_ullStartMs;
+    const ULONGLONG cDue = ullElapsedMs * pThis->_dwEventsPerSecond / 1000;
+    if (cDue > pThis->_cScheduled)
+    {
+        // Forget what we cannot deliver.
+        ULONGLONG cBatch = cDue - pThis->_cScheduled;
+        if (cBatch > DEVICE_SYNTHETIC_BATCH_MAX)
+        {
+            cBatch = DEVICE_SYNTHETIC_BATCH_MAX;
+        }
+        pThis->_cScheduled = cDue;
+
+        const ULONGLONG ullEventUs = CEventReactor::GetTimeUs();
+        while (cBatch-- > 0)
+        {
+            pThis->_Emit(ullEventUs);
+        }
+    }
+    GetEventReactor()->SetTimer(&pThis->_timer, DEVICE_SYNTHETIC_TICK_MS, _OnTick, pThis);
+}
@@ -0,0 +1,57 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CSyntheticDeviceSource makes up events at a fixed rate for a set of
+// imaginary devices: mostly devices coming and going, some data, the odd
+// error.  It is the load generator for the event path, from the reactor
+// through the pipeline to CredentialsChanged.
+//
+// Events are produced in batches from a periodic timer, as many per tick as
+// the rate calls for, so rates far above the tick frequency are met.  The
+// sequence is pseudo-random from a fixed seed and repeats from run to run.
+
+#pragma once
+
+#include "DeviceSource.h"
+
+#define DEVICE_SYNTHETIC_DEVICES_DEFAULT    8
+#define DEVICE_SYNTHETIC_DEVICES_MAX        64
+#define DEVICE_SYNTHETIC_TICK_MS            10
+
+// Most events in one tick.  A reactor that falls behind drops the backlog
+// rather than flooding the sink with it.
+#define DEVICE_SYNTHETIC_BATCH_MAX          16384
+
+class CSyntheticDeviceSource : public CDeviceSource
+{
+  public:
+    CSyntheticDeviceSource(DWORD dwEventsPerSecond, DWORD cDevices);
+
+    HRESULT Start(IDeviceEventSink* pSink);
+    void Stop();
+
+    ULONGLONG GetEmittedCount() const
+    {
+        return _cEmitted;
+    }
+
+  private:
+    DWORD _Random();
+    void _Emit(ULONGLONG ullEventUs);
+    static void _OnTick(void* pv);
+
+  private:
+    DWORD           _dwEventsPerSecond;
+    DWORD           _cDevices;
+    ULONGLONG       _ullPresent;        // Bit per device that is inserted.
+    DWORD           _dwSeed;
+    ULONGLONG       _ullStartMs;
+    ULONGLONG       _cScheduled;        // Events the rate has called for since Start, delivered or not.
+    ULONGLONG       _cEmitted;
+    EVENT_TIMER     _timer;
+};
@@ -0,0 +1,348 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Loopback test of the companion channel.  The test starts a
+// CCompanionChannel on the reactor, then forks a companion that maps the
+// section, connects to the control socket and pushes records as a badge
+// reader service would.  Each payload carries a sequence number, the time it
+// was pushed and a pattern, which the sink checks where the payload lies in
+// the ring.  The companion first pushes as fast as it can, with small and
+// with large payloads, for messages a second and MB/s; then one record at a
+// time with the provider idle in between, so each one rings the doorbell, for
+// the latency from Push to the sink.  Last it moves the head past the tail,
+// which the provider must count as corrupt and recover from.  Prints a line
+// per check and returns nonzero if any failed.
+
+#include "CompanionChannel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define SMALL_PAYLOAD_CB        64
+#define SMALL_RECORDS           1000000
+#define LARGE_PAYLOAD_CB        1024
+#define LARGE_RECORDS           200000
+#define PING_RECORDS            10000
+#define PING_INTERVAL_US        100
+#define WAIT_MS_MAX             30000
+
+// The device id says which part of the run a record belongs to.
+enum PHASE
+{
+    PHASE_SMALL = 1,
+    PHASE_LARGE,
+    PHASE_PING,
+    PHASE_AFTER_CORRUPT,
+    PHASE_COUNT
+};
+
+struct PAYLOAD
+{
+    ULONGLONG   ullSequence;
+    ULONGLONG   ullPushedUs;
+    BYTE        rgbPattern[1];      // The rest of the payload.
+};
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, const char* pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static BYTE PatternByte(ULONGLONG ullSequence, DWORD i)
+{
+    return (BYTE)(ullSequence * 31 + i);
+}
+
+// Checks what the companion pushed, in place.  Only the reactor thread
+// touches it; the test reads it through Send.
+class CLoopbackSink : public IDeviceEventSink
+{
+  public:
+    CLoopbackSink()
+    {
+        memset(rgcRecords, 0, sizeof(rgcRecords));
+        memset(rgullFirstUs, 0, sizeof(rgullFirstUs));
+        memset(rgullLastUs, 0, sizeof(rgullLastUs));
+        cBad = 0;
+    }
+
+    void OnDeviceEvent(const DEVICE_EVENT* pEvent)
+    {
+        const DWORD iPhase = pEvent->dwDeviceId;
+        const DWORD cbExpected = (PHASE_LARGE == iPhase) ? LARGE_PAYLOAD_CB : SMALL_PAYLOAD_CB;
+        if ((iPhase < PHASE_SMALL) || (iPhase >= PHASE_COUNT) || (DEK_DATA != pEvent->kind) ||
+            (pEvent->cbData != cbExpected))
+        {
+            cBad++;
+            return;
+        }
+
+        const PAYLOAD* pPayload = (const PAYLOAD*)pEvent->pbData;
+        bool fGood = (pPayload->ullSequence == rgcRecords[iPhase]);
+        for (DWORD i = offsetof(PAYLOAD, rgbPattern); fGood && (i < pEvent->cbData); i++)
+        {
+            fGood = (pEvent->pbData[i] == PatternByte(pPayload->ullSequence, i));
+        }
+        if (!fGood)
+        {
+            cBad++;
+        }
+
+        if (PHASE_PING == iPhase)
+        {
+            rgullLatencyUs[rgcRecords[iPhase]] = pEvent->ullEventUs - pPayload->ullPushedUs;
+        }
+        if (0 == rgcRecords[iPhase])
+        {
+            rgullFirstUs[iPhase] = pPayload->ullPushedUs;
+        }
+        rgullLastUs[iPhase] = pEvent->ullEventUs;
+        rgcRecords[iPhase]++;
+    }
+
+  public:
+    DWORD       rgcRecords[PHASE_COUNT];
+    ULONGLONG   rgullFirstUs[PHASE_COUNT];  // When the first record of the phase was pushed.
+    ULONGLONG   rgullLastUs[PHASE_COUNT];   // When the last one reached the sink.
+    ULONGLONG   rgullLatencyUs[PING_RECORDS];
+    DWORD       cBad;                       // Out of order, damaged, or not ours.
+};
+
+struct CHANNEL_CALL
+{
+    CCompanionChannel*  pChannel;
+    CLoopbackSink*      pSink;
+    HRESULT             hr;
+    DWORD               iPhase;
+    DWORD               cRecords;
+};
+
+static void StartOnReactor(void* pv)
+{
+    CHANNEL_CALL* pCall = static_cast<CHANNEL_CALL*>(pv);
+    pCall->hr = pCall->pChannel->Start(pCall->pSink);
+}
+
+static void StopOnReactor(void* pv)
+{
+    CHANNEL_CALL* pCall = static_cast<CHANNEL_CALL*>(pv);
+    pCall->pChannel->Stop();
+}
+
+static void CountOnReactor(void* pv)
+{
+    CHANNEL_CALL* pCall = static_cast<CHANNEL_CALL*>(pv);
+    pCall->cRecords = pCall->pSink->rgcRecords[pCall->iPhase];
+}
+
+static bool WaitForRecords(CHANNEL_CALL* pCall, DWORD iPhase, DWORD cRecords)
+{
+    const ULONGLONG ullStartMs = CEventReactor::GetTimeMs();
+    pCall->iPhase = iPhase;
+    for (;;)
+    {
+        GetEventReactor()->Send(CountOnReactor, pCall);
+        if (pCall->cRecords >= cRecords)
+        {
+            return true;
+        }
+        if (CEventReactor::GetTimeMs() - ullStartMs > WAIT_MS_MAX)
+        {
+            return false;
+        }
+        usleep(1000);
+    }
+}
+
+//
+// The companion, in its own process.
+//
+
+struct COMPANION
+{
+    CCompanionRing          ring;
+    COMPANION_RING_HEADER*  pHeader;
+    int                     fdControl;
+};
+
+static bool Push(COMPANION* pCompanion, DWORD iPhase, ULONGLONG ullSequence, DWORD cbPayload)
+{
+    BYTE* pb;
+    HRESULT hr;
+    while (E_OUTOFMEMORY == (hr = pCompanion->ring.Reserve(cbPayload, &pb)))
+    {
+        sched_yield();
+    }
+    if (FAILED(hr))
+    {
+        return false;
+    }
+
+    PAYLOAD* pPayload = (PAYLOAD*)pb;
+    pPayload->ullSequence = ullSequence;
+    for (DWORD i = offsetof(PAYLOAD, rgbPattern); i < cbPayload; i++)
+    {
+        pb[i] = PatternByte(ullSequence, i);
+    }
+    pPayload->ullPushedUs = CEventReactor::GetTimeUs();
+
+    bool fWake;
+    pCompanion->ring.Commit(CRT_DATA, iPhase, &fWake);
+    const char chDoorbell = 1;
+    return !fWake || (1 == write(pCompanion->fdControl, &chDoorbell, 1));
+}
+
+static int RunCompanion(const char* pszSocket, const char* pszSection, size_t cbView)
+{
+    COMPANION companion;
+    const int fdSection = shm_open(pszSection, O_RDWR, 0);
+    void* pvView = (fdSection >= 0) ? mmap(NULL, cbView, PROT_READ | PROT_WRITE, MAP_SHARED, fdSection, 0) : MAP_FAILED;
+    if ((MAP_FAILED == pvView) || FAILED(companion.ring.Attach(pvView, cbView)))
+    {
+        return 2;
+    }
+    companion.pHeader = (COMPANION_RING_HEADER*)pvView;
+
+    companion.fdControl = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, pszSocket, sizeof(addr.sun_path) - 1);
+    if (0 != connect(companion.fdControl, (struct sockaddr*)&addr, sizeof(addr)))
+    {
+        return 3;
+    }
+
+    bool fOk = true;
+    for (DWORD i = 0; fOk && (i < SMALL_RECORDS); i++)
+    {
+        fOk = Push(&companion, PHASE_SMALL, i, SMALL_PAYLOAD_CB);
+    }
+    for (DWORD i = 0; fOk && (i < LARGE_RECORDS); i++)
+    {
+        fOk = Push(&companion, PHASE_LARGE, i, LARGE_PAYLOAD_CB);
+    }
+
+    // Far enough apart that the provider is idle before each.
+    for (DWORD i = 0; fOk && (i < PING_RECORDS); i++)
+    {
+        const ULONGLONG ullDueUs = CEventReactor::GetTimeUs() + PING_INTERVAL_US;
+        while (CEventReactor::GetTimeUs() < ullDueUs)
+        {
+        }
+        fOk = Push(&companion, PHASE_PING, i, SMALL_PAYLOAD_CB);
+    }
+
+    // A head that laps the tail, as a broken companion might write.  Once the
+    // provider has caught up with it, attach again and carry on.
+    const LONGLONG llBadHead = __atomic_load_n(&companion.pHeader->llTail, __ATOMIC_ACQUIRE) +
+                               3 * (LONGLONG)companion.pHeader->cbData;
+    __atomic_store_n(&companion.pHeader->llHead, llBadHead, __ATOMIC_RELEASE);
+    const char chDoorbell = 1;
+    fOk = fOk && (1 == write(companion.fdControl, &chDoorbell, 1));
+    const ULONGLONG ullStartUs = CEventReactor::GetTimeUs();
+    while (fOk && (__atomic_load_n(&companion.pHeader->llTail, __ATOMIC_ACQUIRE) != llBadHead))
+    {
+        fOk = (CEventReactor::GetTimeUs() - ullStartUs < (ULONGLONG)WAIT_MS_MAX * 1000);
+        usleep(100);
+    }
+    fOk = fOk && SUCCEEDED(companion.ring.Attach(pvView, cbView)) &&
+          Push(&companion, PHASE_AFTER_CORRUPT, 0, SMALL_PAYLOAD_CB);
+
+    close(companion.fdControl);
+    return fOk ? 0 : 1;
+}
+
+static int CompareLatency(const void* pv1, const void* pv2)
+{
+    const ULONGLONG ull1 = *(const ULONGLONG*)pv1;
+    const ULONGLONG ull2 = *(const ULONGLONG*)pv2;
+    return (ull1 < ull2) ? -1 : (ull1 > ull2) ? 1 : 0;
+}
+
+int main()
+{
+    char szSocket[64];
+    char szSection[64];
+    snprintf(szSocket, sizeof(szSocket), "/tmp/CompanionChannelTest.%d.sock", (int)getpid());
+    snprintf(szSection, sizeof(szSection), "/CompanionChannelTest.%d", (int)getpid());
+
+    if (FAILED(GetEventReactor()->Acquire()))
+    {
+        printf("FAIL  reactor starts\n");
+        return 1;
+    }
+
+    CCompanionChannel* pChannel = new CCompanionChannel(szSocket, szSection);
+    static CLoopbackSink s_sink;
+    CLoopbackSink* pSink = &s_sink;
+    CHANNEL_CALL call = { pChannel, pSink, E_FAIL, 0, 0 };
+    GetEventReactor()->Send(StartOnReactor, &call);
+    Check(SUCCEEDED(call.hr), "channel creates its section and socket");
+    if (FAILED(call.hr))
+    {
+        return 1;
+    }
+
+    // The companion must not share the reactor's thread, so it is forked
+    // before it could touch it.
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (0 == pid)
+    {
+        _exit(RunCompanion(szSocket, szSection, sizeof(COMPANION_RING_HEADER) + COMPANION_RING_CB_DEFAULT));
+    }
+
+    const bool fSmall = WaitForRecords(&call, PHASE_SMALL, SMALL_RECORDS);
+    const bool fLarge = fSmall && WaitForRecords(&call, PHASE_LARGE, LARGE_RECORDS);
+    const bool fPing = fLarge && WaitForRecords(&call, PHASE_PING, PING_RECORDS);
+    const bool fRecovered = fPing && WaitForRecords(&call, PHASE_AFTER_CORRUPT, 1);
+
+    int iStatus = -1;
+    waitpid(pid, &iStatus, 0);
+    GetEventReactor()->Send(StopOnReactor, &call);
+    GetEventReactor()->Release();
+
+    Check(WIFEXITED(iStatus) && (0 == WEXITSTATUS(iStatus)), "companion attaches, connects and pushes");
+    Check(fSmall && fLarge && fPing, "every record arrives");
+    Check(0 == pSink->cBad, "records arrive in order and intact, in place in the ring");
+    Check(fRecovered && (1 == pChannel->GetCorruptCount()), "a head that laps the tail is counted and recovered from");
+    Check(pChannel->GetRecordCount() == (ULONGLONG)SMALL_RECORDS + LARGE_RECORDS + PING_RECORDS + 1,
+          "channel counts what it delivered");
+
+    if (fPing)
+    {
+        const double dSmallSeconds = (pSink->rgullLastUs[PHASE_SMALL] - pSink->rgullFirstUs[PHASE_SMALL]) / 1e6;
+        const double dLargeSeconds = (pSink->rgullLastUs[PHASE_LARGE] - pSink->rgullFirstUs[PHASE_LARGE]) / 1e6;
+        printf("\n%u byte payloads: %.0f messages/s, %.0f MB/s\n", SMALL_PAYLOAD_CB,
+               SMALL_RECORDS / dSmallSeconds, SMALL_RECORDS * (double)SMALL_PAYLOAD_CB / dSmallSeconds / 1e6);
+        printf("%u byte payloads: %.0f messages/s, %.0f MB/s\n", LARGE_PAYLOAD_CB,
+               LARGE_RECORDS / dLargeSeconds, LARGE_RECORDS * (double)LARGE_PAYLOAD_CB / dLargeSeconds / 1e6);
+
+        qsort(pSink->rgullLatencyUs, PING_RECORDS, sizeof(ULONGLONG), CompareLatency);
+        printf("latency from an idle provider, Push to sink: median %llu us, 99%% %llu us, max %llu us\n",
+               (unsigned long long)pSink->rgullLatencyUs[PING_RECORDS / 2],
+               (unsigned long long)pSink->rgullLatencyUs[PING_RECORDS * 99 / 100],
+               (unsigned long long)pSink->rgullLatencyUs[PING_RECORDS - 1]);
+    }
+
+    delete pChannel;
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Replays recorded device event traces through CDeviceRegistry and
+// CDeviceEventPipeline on a virtual clock, the way the provider drives them
+// from the reactor, and counts the enumerations LogonUI would have run with
+// one CredentialsChanged per state flip against the ones the pipeline lets
+// through.  Each trace names the number of changes it must produce in an
+// "# expect <n>" line.  The settled state must always match the devices
+// present, the tiles must match it after every change, no change may be held
+// back longer than the settle limit, and with debouncing off every flip must
+// be reported.  A generated trace of many flapping devices then gives events
+// a second and the enumerations avoided at scale.  Prints a line per check
+// and returns nonzero if any failed.
+//
+// Usage: DeviceEventPipelineTest <trace>...
+
+#include "DeviceEventPipeline.h"
+#include "DeviceRegistry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_EVENTS_MAX        4096
+#define SCALE_DEVICES           64
+#define SCALE_EVENTS            1000000
+
+// Where the virtual clock starts.  Settle reports "no timer" as 0, so trace
+// time 0 must not be clock time 0.
+#define VIRTUAL_EPOCH_MS        1000000
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, const char* pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+struct TRACE_STEP
+{
+    ULONGLONG       ullAtMs;
+    DEVICE_EVENT    event;
+};
+
+struct REPLAY_RESULT
+{
+    DWORD       cEvents;
+    DWORD       cFlips;             // Events that changed the set of devices: the old CredentialsChanged count.
+    DWORD       cChanges;           // CredentialsChanged after the pipeline.
+    ULONGLONG   ullMaxLatencyMs;    // Longest from the first event of a burst to its change.
+    bool        fConsistent;        // Tiles matched the devices at every change, and the end state was reported.
+};
+
+// Stand-ins for the provider's tiles: the tile is the device id.
+static HRESULT CreateTileProc(void* pvContext, DWORD dwDeviceId, void** ppvTile)
+{
+    (void)pvContext;
+    *ppvTile = (void*)(size_t)(dwDeviceId + 1);
+    return S_OK;
+}
+
+static void RetireTileProc(void* pvContext, void* pvTile)
+{
+    (void)pvContext;
+    (void)pvTile;
+}
+
+// Settles the burst if the timer the provider would have armed is due by
+// ullNowMs, as the reactor runs timers before the events that arrive after
+// them.
+static void RunDueSettle(CDeviceEventPipeline* pPipeline, CDeviceRegistry* pRegistry, ULONGLONG* pullDueMs,
+                         ULONGLONG ullNowMs, REPLAY_RESULT* pResult)
+{
+    while ((0 != *pullDueMs) && (*pullDueMs <= ullNowMs))
+    {
+        const ULONGLONG ullAtMs = *pullDueMs;
+        ULONGLONG ullState;
+        ULONGLONG ullFirstEventUs;
+        if (pPipeline->Settle(ullAtMs, &ullState, &ullFirstEventUs, pullDueMs))
+        {
+            pResult->cChanges++;
+            pRegistry->Reconcile(CreateTileProc, RetireTileProc, NULL);
+            if ((ullState != pRegistry->GetFingerprint()) || (pRegistry->GetTileCount() != pRegistry->GetPresentCount()))
+            {
+                pResult->fConsistent = false;
+            }
+
+            // Event times are the virtual clock in microseconds.
+            const ULONGLONG ullLatencyMs = ullAtMs - ullFirstEventUs / 1000;
+            if (ullLatencyMs > pResult->ullMaxLatencyMs)
+            {
+                pResult->ullMaxLatencyMs = ullLatencyMs;
+            }
+        }
+    }
+}
+
+static void Replay(const TRACE_STEP* rgStep, DWORD cSteps, DWORD dwDebounceMs, REPLAY_RESULT* pResult)
+{
+    CDeviceRegistry* pRegistry = new CDeviceRegistry();
+    CDeviceEventPipeline pipeline;
+    pipeline.Initialize(dwDebounceMs, pRegistry->GetFingerprint());
+
+    memset(pResult, 0, sizeof(*pResult));
+    pResult->fConsistent = true;
+
+    ULONGLONG ullDueMs = 0;
+    for (DWORD i = 0; i < cSteps; i++)
+    {
+        RunDueSettle(&pipeline, pRegistry, &ullDueMs, rgStep[i].ullAtMs, pResult);
+
+        DEVICE_EVENT event = rgStep[i].event;
+        event.ullEventUs = rgStep[i].ullAtMs * 1000;
+        pResult->cEvents++;
+        if (pRegistry->Apply(&event))
+        {
+            pResult->cFlips++;
+            ullDueMs = pipeline.Submit(pRegistry->GetFingerprint(), rgStep[i].ullAtMs, event.ullEventUs);
+        }
+    }
+    RunDueSettle(&pipeline, pRegistry, &ullDueMs, ~0ULL, pResult);
+
+    if (pipeline.GetState() != pRegistry->GetFingerprint())
+    {
+        pResult->fConsistent = false;
+    }
+    pRegistry->Clear(RetireTileProc, NULL);
+    delete pRegistry;
+}
+
+// Reads a trace in the format of ReplayDeviceSource.h, and its "# expect" line.
+static bool LoadTrace(const char* pszPath, TRACE_STEP* rgStep, DWORD* pcSteps, long* plExpected)
+{
+    FILE* pFile = fopen(pszPath, "r");
+    if (!pFile)
+    {
+        return false;
+    }
+
+    bool fOk = true;
+    char szLine[DEVICE_SOURCE_LINE_CCH_MAX];
+    *pcSteps = 0;
+    *plExpected = -1;
+    while (fOk && fgets(szLine, sizeof(szLine), pFile))
+    {
+        if (1 == sscanf(szLine, "# expect %ld", plExpected))
+        {
+            continue;
+        }
+
+        char* pszEvent;
+        ULONGLONG ullAtMs = strtoull(szLine, &pszEvent, 10);
+        if ((pszEvent != szLine) && (*pcSteps < TRACE_EVENTS_MAX))
+        {
+            TRACE_STEP* pStep = &rgStep[*pcSteps];
+            pStep->ullAtMs = VIRTUAL_EPOCH_MS + ullAtMs;
+            fOk = (S_OK == ParseDeviceEventLine(pszEvent, strcspn(pszEvent, "\r\n"), &pStep->event));
+            (*pcSteps)++;
+        }
+    }
+    fclose(pFile);
+    return fOk && (*plExpected >= 0);
+}
+
+static void CheckTrace(const char* pszPath)
+{
+    static TRACE_STEP s_rgStep[TRACE_EVENTS_MAX];
+    const char* pszName = strrchr(pszPath, '/') ? strrchr(pszPath, '/') + 1 : pszPath;
+    char szWhat[256];
+
+    DWORD cSteps;
+    long lExpected;
+    if (!LoadTrace(pszPath, s_rgStep, &cSteps, &lExpected))
+    {
+        snprintf(szWhat, sizeof(szWhat), "%s loads, with an expect line", pszName);
+        Check(false, szWhat);
+        return;
+    }
+
+    REPLAY_RESULT result;
+    Replay(s_rgStep, cSteps, DEVICE_PIPELINE_DEBOUNCE_MS_DEFAULT, &result);
+    printf("      %s: %u events, %u flips, %u enumerations (%u avoided), longest hold %llu ms\n",
+           pszName, result.cEvents, result.cFlips, result.cChanges, result.cFlips - result.cChanges,
+           (unsigned long long)result.ullMaxLatencyMs);
+
+    snprintf(szWhat, sizeof(szWhat), "%s settles in %ld change(s)", pszName, lExpected);
+    Check((DWORD)lExpected == result.cChanges, szWhat);
+    snprintf(szWhat, sizeof(szWhat), "%s tiles and reported state match the devices", pszName);
+    Check(result.fConsistent, szWhat);
+    snprintf(szWhat, sizeof(szWhat), "%s holds no change past the settle limit", pszName);
+    Check(result.ullMaxLatencyMs <= (ULONGLONG)DEVICE_PIPELINE_DEBOUNCE_MS_DEFAULT * DEVICE_PIPELINE_SETTLE_FACTOR, szWhat);
+
+    REPLAY_RESULT resultUndebounced;
+    Replay(s_rgStep, cSteps, 0, &resultUndebounced);
+    snprintf(szWhat, sizeof(szWhat), "%s with debouncing off reports every flip", pszName);
+    Check(resultUndebounced.fConsistent && (resultUndebounced.cChanges == resultUndebounced.cFlips), szWhat);
+}
+
+// Many devices, each flapping now and then: a bus full of loose connectors.
+static void CheckScale()
+{
+    TRACE_STEP* rgStep = new TRACE_STEP[SCALE_EVENTS];
+    bool rgfPresent[SCALE_DEVICES] = {};
+    unsigned int uSeed = 0x2545F491;
+    ULONGLONG ullAtMs = VIRTUAL_EPOCH_MS;
+    for (DWORD i = 0; i < SCALE_EVENTS; i++)
+    {
+        uSeed = uSeed * 1103515245 + 12345;
+        const DWORD iDevice = (uSeed >> 8) % SCALE_DEVICES;
+
+        // Mostly a few milliseconds apart, with an occasional quiet spell so bursts end.
+        ullAtMs += (0 == (uSeed >> 20) % 64) ? 2000 : (uSeed >> 16) % 8;
+
+        memset(&rgStep[i].event, 0, sizeof(rgStep[i].event));
+        rgStep[i].ullAtMs = ullAtMs;
+        rgStep[i].event.kind = rgfPresent[iDevice] ? DEK_REMOVE : DEK_INSERT;
+        rgStep[i].event.dwDeviceId = iDevice;
+        rgfPresent[iDevice] = !rgfPresent[iDevice];
+    }
+
+    const ULONGLONG ullStartUs = CEventReactor::GetTimeUs();
+    REPLAY_RESULT result;
+    Replay(rgStep, SCALE_EVENTS, DEVICE_PIPELINE_DEBOUNCE_MS_DEFAULT, &result);
+    const double dSeconds = (double)(CEventReactor::GetTimeUs() - ullStartUs) / 1e6;
+
+    printf("\n%u devices, %u events: %u enumerations instead of %u (%.1f%% avoided)\n",
+           SCALE_DEVICES, result.cEvents, result.cChanges, result.cFlips,
+           100.0 * (result.cFlips - result.cChanges) / result.cFlips);
+    printf("events/s through registry and pipeline: %.0f\n", result.cEvents / dSeconds);
+    Check(result.fConsistent, "generated trace: tiles and reported state match the devices");
+
+    delete[] rgStep;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: DeviceEventPipelineTest <trace>...\n");
+        return 2;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        CheckTrace(argv[i]);
+    }
+    CheckScale();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
@@ -0,0 +1,381 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Attaches and detaches hundreds of simulated devices in random bursts and
+// reconciles the registry after each, as the provider does when a burst
+// settles, checking it against a plain model of the devices: there must be a
+// tile for exactly the present devices, tiles that stay must keep their
+// order with new ones after them, no tile may leak or be retired twice, and
+// a tile whose creation failed must be retried.  Then fills the registry
+// past its limit.  Finally it times a burst and the enumeration that follows
+// (GetCredentialCount and a GetCredentialAt per tile) with hundreds of
+// devices attached, against rebuilding every tile as a single tile swap
+// would.  Prints a line per check and returns nonzero if any failed.
+
+#include "DeviceRegistry.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define STRESS_DEVICES          600         // Device ids in play.
+#define STRESS_BURSTS           20000
+#define STRESS_BURST_EVENTS_MAX 64
+#define STRESS_CREATE_FAIL      50          // One create in this many fails.
+#define TIMING_DEVICES          500
+#define TIMING_BURSTS           20000
+#define TIMING_BURST_EVENTS     4
+#define TILE_MAGIC              0x54494C45
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, const char* pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static DWORD s_dwRandom = 0x2545F491;
+
+static DWORD NextRandom()
+{
+    s_dwRandom ^= s_dwRandom << 13;
+    s_dwRandom ^= s_dwRandom >> 17;
+    s_dwRandom ^= s_dwRandom << 5;
+    return s_dwRandom;
+}
+
+// Stand-in for the provider's tiles, which LogonUI holds by reference.
+struct TILE
+{
+    DWORD       dwMagic;
+    DWORD       dwDeviceId;
+    ULONGLONG   ullSerial;                  // Order of creation.
+};
+
+struct TILE_CONTEXT
+{
+    DWORD       cLive;
+    DWORD       cBadRetires;                // Retires of something that was not a live tile.
+    DWORD       dwFailEvery;                // Fail one create in this many, or 0 for never.
+    ULONGLONG   ullSerial;
+};
+
+static HRESULT CreateTileProc(void* pvContext, DWORD dwDeviceId, void** ppvTile)
+{
+    TILE_CONTEXT* pContext = static_cast<TILE_CONTEXT*>(pvContext);
+    if ((0 != pContext->dwFailEvery) && (0 == NextRandom() % pContext->dwFailEvery))
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    TILE* pTile = new TILE;
+    pTile->dwMagic = TILE_MAGIC;
+    pTile->dwDeviceId = dwDeviceId;
+    pTile->ullSerial = pContext->ullSerial++;
+    pContext->cLive++;
+    *ppvTile = pTile;
+    return S_OK;
+}
+
+static void RetireTileProc(void* pvContext, void* pvTile)
+{
+    TILE_CONTEXT* pContext = static_cast<TILE_CONTEXT*>(pvContext);
+    TILE* pTile = static_cast<TILE*>(pvTile);
+    if ((NULL == pTile) || (TILE_MAGIC != pTile->dwMagic))
+    {
+        pContext->cBadRetires++;
+        return;
+    }
+    pTile->dwMagic = 0;
+    pContext->cLive--;
+    delete pTile;
+}
+
+static void MakeEvent(DEVICE_EVENT_KIND kind, DWORD dwDeviceId, DEVICE_EVENT* pEvent)
+{
+    memset(pEvent, 0, sizeof(*pEvent));
+    pEvent->kind = kind;
+    pEvent->dwDeviceId = dwDeviceId;
+    pEvent->pbData = pEvent->rgbData;
+}
+
+// Device ids spread out, as real ones are, rather than 0, 1, 2...
+#define DEVICE_ID_STRIDE        7919
+
+static DWORD DeviceId(DWORD iDevice)
+{
+    return iDevice * DEVICE_ID_STRIDE + 1;
+}
+
+struct STRESS_RESULT
+{
+    DWORD   cWrongSet;                      // Reconciles after which tiles and devices differ.
+    DWORD   cReordered;                     // Reconciles after which a kept tile moved ahead of an older one.
+    DWORD   cNotRetried;                    // Present devices with no tile after a Reconcile that could create it.
+    DWORD   cWrongCount;                    // Present count or fingerprint differ from the model.
+};
+
+// Compares the tiles against the devices the model says are present.
+static void CheckTiles(const CDeviceRegistry* pRegistry, const bool* rgfPresent, DWORD cDevices, bool fAllCreated,
+                       STRESS_RESULT* pResult)
+{
+    static bool s_rgfTiled[STRESS_DEVICES];
+    memset(s_rgfTiled, 0, sizeof(s_rgfTiled));
+
+    bool fWrongSet = false;
+    bool fReordered = false;
+    ULONGLONG ullLastSerial = 0;
+    for (DWORD i = 0; i < pRegistry->GetTileCount(); i++)
+    {
+        const TILE* pTile = static_cast<const TILE*>(pRegistry->GetTileAt(i));
+        const DWORD iDevice = (pTile->dwDeviceId - 1) / DEVICE_ID_STRIDE;
+        if ((TILE_MAGIC != pTile->dwMagic) || (pTile->dwDeviceId != pRegistry->GetTileDeviceId(i)) ||
+            (iDevice >= cDevices) || (DeviceId(iDevice) != pTile->dwDeviceId) ||
+            !rgfPresent[iDevice] || s_rgfTiled[iDevice])
+        {
+            fWrongSet = true;
+            continue;
+        }
+        s_rgfTiled[iDevice] = true;
+
+        // Older tiles come first, whatever came and went between them.
+        if ((i > 0) && (pTile->ullSerial < ullLastSerial))
+        {
+            fReordered = true;
+        }
+        ullLastSerial = pTile->ullSerial;
+    }
+
+    DWORD cPresent = 0;
+    for (DWORD i = 0; i < cDevices; i++)
+    {
+        if (rgfPresent[i])
+        {
+            cPresent++;
+            if (!s_rgfTiled[i] && fAllCreated)
+            {
+                pResult->cNotRetried++;
+            }
+        }
+    }
+
+    pResult->cWrongSet += fWrongSet ? 1 : 0;
+    pResult->cReordered += fReordered ? 1 : 0;
+    pResult->cWrongCount += (cPresent != pRegistry->GetPresentCount()) ? 1 : 0;
+    pResult->cWrongCount += ((0 == cPresent) != (0 == pRegistry->GetFingerprint())) ? 1 : 0;
+}
+
+static void CheckStress()
+{
+    static bool s_rgfPresent[STRESS_DEVICES];
+    memset(s_rgfPresent, 0, sizeof(s_rgfPresent));
+
+    CDeviceRegistry* pRegistry = new CDeviceRegistry();
+    TILE_CONTEXT context = {};
+    context.dwFailEvery = STRESS_CREATE_FAIL;
+    STRESS_RESULT result = {};
+    DWORD cFlips = 0;
+    DWORD cWrongFlips = 0;
+
+    for (DWORD iBurst = 0; iBurst < STRESS_BURSTS; iBurst++)
+    {
+        // Mostly small bursts, now and then a whole hub coming or going.
+        const DWORD cEvents = (0 == NextRandom() % 16) ? STRESS_DEVICES / 2 : 1 + NextRandom() % STRESS_BURST_EVENTS_MAX;
+        for (DWORD i = 0; i < cEvents; i++)
+        {
+            const DWORD iDevice = NextRandom() % STRESS_DEVICES;
+            const DWORD dwKind = NextRandom() % 8;
+            DEVICE_EVENT event;
+            MakeEvent((dwKind < 3) ? DEK_INSERT : (dwKind < 5) ? DEK_REMOVE : (dwKind < 6) ? DEK_ERROR : DEK_DATA,
+                      DeviceId(iDevice), &event);
+
+            bool fFlips = false;
+            if (DEK_INSERT == event.kind)
+            {
+                fFlips = !s_rgfPresent[iDevice];
+                s_rgfPresent[iDevice] = true;
+            }
+            else if (DEK_DATA != event.kind)
+            {
+                fFlips = s_rgfPresent[iDevice];
+                s_rgfPresent[iDevice] = false;
+            }
+
+            const bool fFlipped = pRegistry->Apply(&event);
+            cFlips += fFlipped ? 1 : 0;
+            cWrongFlips += (fFlipped != fFlips) ? 1 : 0;
+        }
+
+        pRegistry->Reconcile(CreateTileProc, RetireTileProc, &context);
+        CheckTiles(pRegistry, s_rgfPresent, STRESS_DEVICES, false, &result);
+    }
+
+    // One more Reconcile with nothing failing picks up every device left without a tile.
+    context.dwFailEvery = 0;
+    pRegistry->Reconcile(CreateTileProc, RetireTileProc, &context);
+    CheckTiles(pRegistry, s_rgfPresent, STRESS_DEVICES, true, &result);
+
+    DEVICE_REGISTRY_STATS stats;
+    pRegistry->GetStats(&stats);
+    printf("      %u bursts over %u devices: %u flips, %u tiles created, %u retired, %u kept, %u live\n",
+           STRESS_BURSTS, STRESS_DEVICES, cFlips, stats.cCreated, stats.cRetired, stats.cKept, context.cLive);
+
+    Check(0 == cWrongFlips, "stress: Apply reports exactly the events that change the devices");
+    Check(0 == result.cWrongSet, "stress: tiles are exactly the present devices that have them");
+    Check(0 == result.cReordered, "stress: tiles keep their order, new ones after");
+    Check(0 == result.cWrongCount, "stress: present count and fingerprint follow the devices");
+    Check(0 == result.cNotRetried, "stress: failed creates are retried");
+    Check((context.cLive == pRegistry->GetTileCount()) && (stats.cCreated - stats.cRetired == context.cLive) &&
+          (0 == context.cBadRetires),
+          "stress: no tile leaks or is retired twice");
+
+    pRegistry->Clear(RetireTileProc, &context);
+    Check((0 == context.cLive) && (0 == context.cBadRetires), "stress: Clear retires every tile once");
+    delete pRegistry;
+}
+
+static void CheckFull()
+{
+    CDeviceRegistry* pRegistry = new CDeviceRegistry();
+    TILE_CONTEXT context = {};
+
+    const DWORD cDevices = DEVICE_REGISTRY_DEVICES_MAX + 100;
+    for (DWORD i = 0; i < cDevices; i++)
+    {
+        DEVICE_EVENT event;
+        MakeEvent(DEK_INSERT, DeviceId(i), &event);
+        pRegistry->Apply(&event);
+    }
+    pRegistry->Reconcile(CreateTileProc, RetireTileProc, &context);
+
+    DEVICE_REGISTRY_STATS stats;
+    pRegistry->GetStats(&stats);
+    Check((DEVICE_REGISTRY_DEVICES_MAX == pRegistry->GetTileCount()) && (100 == stats.cDropped),
+          "full: devices past the limit are dropped and counted");
+
+    // Room is made as devices go, once their tiles are retired.
+    for (DWORD i = 0; i < 10; i++)
+    {
+        DEVICE_EVENT event;
+        MakeEvent(DEK_REMOVE, DeviceId(i), &event);
+        pRegistry->Apply(&event);
+    }
+    pRegistry->Reconcile(CreateTileProc, RetireTileProc, &context);
+    for (DWORD i = DEVICE_REGISTRY_DEVICES_MAX; i < DEVICE_REGISTRY_DEVICES_MAX + 10; i++)
+    {
+        DEVICE_EVENT event;
+        MakeEvent(DEK_INSERT, DeviceId(i), &event);
+        pRegistry->Apply(&event);
+    }
+    pRegistry->Reconcile(CreateTileProc, RetireTileProc, &context);
+    Check((DEVICE_REGISTRY_DEVICES_MAX == pRegistry->GetTileCount()) &&
+          (DeviceId(DEVICE_REGISTRY_DEVICES_MAX + 9) == pRegistry->GetTileDeviceId(DEVICE_REGISTRY_DEVICES_MAX - 1)),
+          "full: freed entries take new devices");
+
+    pRegistry->Clear(RetireTileProc, &context);
+    Check((0 == context.cLive) && (0 == context.cBadRetires), "full: Clear retires every tile once");
+    delete pRegistry;
+}
+
+// What LogonUI does after CredentialsChanged: count the tiles, then ask for each.
+static ULONGLONG Enumerate(const CDeviceRegistry* pRegistry)
+{
+    ULONGLONG ullSum = 0;
+    const DWORD cTiles = pRegistry->GetTileCount();
+    for (DWORD i = 0; i < cTiles; i++)
+    {
+        ullSum += static_cast<const TILE*>(pRegistry->GetTileAt(i))->ullSerial;
+    }
+    return ullSum;
+}
+
+static void CheckTiming()
+{
+    CDeviceRegistry* pRegistry = new CDeviceRegistry();
+    TILE_CONTEXT context = {};
+    static bool s_rgfPresent[TIMING_DEVICES];
+    for (DWORD i = 0; i < TIMING_DEVICES; i++)
+    {
+        DEVICE_EVENT event;
+        MakeEvent(DEK_INSERT, DeviceId(i), &event);
+        pRegistry->Apply(&event);
+        s_rgfPresent[i] = true;
+    }
+    pRegistry->Reconcile(CreateTileProc, RetireTileProc, &context);
+
+    // A few devices come and go per burst, with hundreds attached.
+    ULONGLONG ullSum = 0;
+    const DWORD cCreatedBefore = (DWORD)context.ullSerial;
+    ULONGLONG ullStartUs = CEventReactor::GetTimeUs();
+    for (DWORD iBurst = 0; iBurst < TIMING_BURSTS; iBurst++)
+    {
+        for (DWORD i = 0; i < TIMING_BURST_EVENTS; i++)
+        {
+            const DWORD iDevice = NextRandom() % TIMING_DEVICES;
+            DEVICE_EVENT event;
+            MakeEvent(s_rgfPresent[iDevice] ? DEK_REMOVE : DEK_INSERT, DeviceId(iDevice), &event);
+            s_rgfPresent[iDevice] = !s_rgfPresent[iDevice];
+            pRegistry->Apply(&event);
+        }
+        pRegistry->Reconcile(CreateTileProc, RetireTileProc, &context);
+        ullSum += Enumerate(pRegistry);
+    }
+    const double dIncrementalUs = (double)(CEventReactor::GetTimeUs() - ullStartUs) / TIMING_BURSTS;
+    const double dCreatedPerBurst = (double)((DWORD)context.ullSerial - cCreatedBefore) / TIMING_BURSTS;
+
+    // The same bursts, rebuilding every tile each time.
+    ullStartUs = CEventReactor::GetTimeUs();
+    for (DWORD iBurst = 0; iBurst < TIMING_BURSTS; iBurst++)
+    {
+        for (DWORD i = 0; i < TIMING_BURST_EVENTS; i++)
+        {
+            const DWORD iDevice = NextRandom() % TIMING_DEVICES;
+            DEVICE_EVENT event;
+            MakeEvent(s_rgfPresent[iDevice] ? DEK_REMOVE : DEK_INSERT, DeviceId(iDevice), &event);
+            s_rgfPresent[iDevice] = !s_rgfPresent[iDevice];
+            pRegistry->Apply(&event);
+        }
+        pRegistry->Reconcile(CreateTileProc, RetireTileProc, &context);
+        const DWORD cPresent = pRegistry->GetTileCount();
+        pRegistry->Clear(RetireTileProc, &context);
+        for (DWORD i = 0; i < TIMING_DEVICES; i++)
+        {
+            if (s_rgfPresent[i])
+            {
+                DEVICE_EVENT event;
+                MakeEvent(DEK_INSERT, DeviceId(i), &event);
+                pRegistry->Apply(&event);
+            }
+        }
+        pRegistry->Reconcile(CreateTileProc, RetireTileProc, &context);
+        ullSum += Enumerate(pRegistry) + cPresent;
+    }
+    const double dRebuildUs = (double)(CEventReactor::GetTimeUs() - ullStartUs) / TIMING_BURSTS;
+
+    printf("\n%u devices, %u flips a burst (checksum %llu):\n", TIMING_DEVICES, TIMING_BURST_EVENTS,
+           (unsigned long long)ullSum);
+    printf("  incremental: %.2f us a burst and enumeration, %.1f tiles created\n", dIncrementalUs, dCreatedPerBurst);
+    printf("  rebuild:     %.2f us a burst and enumeration, %u tiles created\n", dRebuildUs,
+           pRegistry->GetTileCount());
+    Check(dIncrementalUs < dRebuildUs, "timing: incremental reconcile beats rebuilding every tile");
+
+    pRegistry->Clear(RetireTileProc, &context);
+    Check(0 == context.cLive, "timing: every tile retired");
+    delete pRegistry;
+}
+
+int main()
+{
+    CheckStress();
+    CheckFull();
+    CheckTiming();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
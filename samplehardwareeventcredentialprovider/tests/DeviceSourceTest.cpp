@@ -0,0 +1,486 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Runs each device source on the reactor into a counting sink.  Recorded
+// traces must replay every step in order and close to its time, and a large
+// generated trace gives the events a second replay can deliver.  A writer
+// thread floods the pipe source, on Linux a Unix domain socket, with lines
+// that are sometimes malformed; every good line must arrive, every bad one
+// must be counted, and a second writer must be turned away.  The synthetic
+// source must keep up with its rate and never remove a device it has not
+// inserted, then is driven past what it can deliver to give its ceiling.
+// The sink records each event's latency with the reactor, as the provider
+// does for each CredentialsChanged, and the reactor's statistics are printed
+// for each source.  Prints a line per check and returns nonzero if any
+// failed.
+//
+// Usage: DeviceSourceTest <trace>...
+
+#include "PipeDeviceSource.h"
+#include "ReplayDeviceSource.h"
+#include "SyntheticDeviceSource.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define REPLAY_LATE_MS_MAX      50          // A step may play this long after its time.
+#define REPLAY_GENERATED_STEPS  50000
+#define REPLAY_GENERATED_MS     500
+#define PIPE_LINES              500000
+#define PIPE_MALFORMED_EVERY    97
+#define SYNTHETIC_RATE          200000
+#define SYNTHETIC_RATE_FLOOD    100000000
+#define SYNTHETIC_RUN_MS        1000
+#define WAIT_MS_MAX             20000
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, const char* pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+// Counts what a source delivers.  Only the reactor thread touches it; the
+// test reads it through Send.
+class CCountingSink : public IDeviceEventSink
+{
+  public:
+    CCountingSink(const DEVICE_EVENT* rgExpected, const ULONGLONG* rgullExpectedMs, DWORD cExpected) :
+        _rgExpected(rgExpected),
+        _rgullExpectedMs(rgullExpectedMs),
+        _cExpected(cExpected),
+        _ullStartMs(0),
+        _ullPresent(0),
+        cEvents(0),
+        cMismatched(0),
+        cStrayRemoves(0),
+        ullLateMsMax(0)
+    {
+    }
+
+    void Begin()
+    {
+        _ullStartMs = CEventReactor::GetTimeMs();
+    }
+
+    void OnDeviceEvent(const DEVICE_EVENT* pEvent)
+    {
+        if (_rgExpected)
+        {
+            if ((cEvents >= _cExpected) ||
+                (pEvent->kind != _rgExpected[cEvents].kind) ||
+                (pEvent->dwDeviceId != _rgExpected[cEvents].dwDeviceId))
+            {
+                cMismatched++;
+            }
+            else
+            {
+                const ULONGLONG ullAtMs = pEvent->ullEventUs / 1000 - _ullStartMs;
+                const ULONGLONG ullExpectedMs = _rgullExpectedMs[cEvents];
+                if ((ullAtMs > ullExpectedMs) && (ullAtMs - ullExpectedMs > ullLateMsMax))
+                {
+                    ullLateMsMax = ullAtMs - ullExpectedMs;
+                }
+            }
+        }
+
+        if (pEvent->dwDeviceId < 64)
+        {
+            const ULONGLONG ullBit = 1ULL << pEvent->dwDeviceId;
+            if (DEK_INSERT == pEvent->kind)
+            {
+                _ullPresent |= ullBit;
+            }
+            else if (DEK_REMOVE == pEvent->kind)
+            {
+                if (!(_ullPresent & ullBit))
+                {
+                    cStrayRemoves++;
+                }
+                _ullPresent &= ~ullBit;
+            }
+            else if (DEK_ERROR == pEvent->kind)
+            {
+                _ullPresent &= ~ullBit;
+            }
+        }
+        GetEventReactor()->RecordLatency(pEvent->ullEventUs);
+        cEvents++;
+    }
+
+  private:
+    const DEVICE_EVENT* _rgExpected;
+    const ULONGLONG*    _rgullExpectedMs;
+    DWORD               _cExpected;
+    ULONGLONG           _ullStartMs;
+    ULONGLONG           _ullPresent;
+
+  public:
+    DWORD               cEvents;
+    DWORD               cMismatched;        // Out of order, or not in the trace.
+    DWORD               cStrayRemoves;      // Removes of a device that was not present.
+    ULONGLONG           ullLateMsMax;
+};
+
+// Starts and stops a source on the reactor thread, as the provider does.
+struct SOURCE_CALL
+{
+    CDeviceSource*  pSource;
+    CCountingSink*  pSink;
+    HRESULT         hr;
+    DWORD           cEvents;
+};
+
+static void StartOnReactor(void* pv)
+{
+    SOURCE_CALL* pCall = static_cast<SOURCE_CALL*>(pv);
+    pCall->pSink->Begin();
+    pCall->hr = pCall->pSource->Start(pCall->pSink);
+}
+
+static void StopOnReactor(void* pv)
+{
+    SOURCE_CALL* pCall = static_cast<SOURCE_CALL*>(pv);
+    pCall->pSource->Stop();
+}
+
+static void CountOnReactor(void* pv)
+{
+    SOURCE_CALL* pCall = static_cast<SOURCE_CALL*>(pv);
+    pCall->cEvents = pCall->pSink->cEvents;
+}
+
+static void GetLatencyOnReactor(void* pv)
+{
+    GetEventReactor()->GetLatencyStats(static_cast<EVENT_LATENCY_STATS*>(pv));
+}
+
+static EVENT_LATENCY_STATS GetLatency()
+{
+    EVENT_LATENCY_STATS latency;
+    GetEventReactor()->Send(GetLatencyOnReactor, &latency);
+    return latency;
+}
+
+// Prints what the reactor recorded for a source's events since latencyBefore, and checks
+// that it recorded every one the sink was given.
+static void CheckLatency(const char* pszName, const EVENT_LATENCY_STATS& latencyBefore, DWORD cEvents)
+{
+    const EVENT_LATENCY_STATS latency = GetLatency();
+    const DWORD cRecorded = latency.cEvents - latencyBefore.cEvents;
+
+    char szWhat[128];
+    snprintf(szWhat, sizeof(szWhat), "%s events all have their latency recorded", pszName);
+    Check(cRecorded == cEvents, szWhat);
+    if (cRecorded > 0)
+    {
+        printf("      %s: event to sink mean %llu us (longest of the run so far %llu us)\n", pszName,
+               (unsigned long long)((latency.ullTotalUs - latencyBefore.ullTotalUs) / cRecorded),
+               (unsigned long long)latency.ullMaxUs);
+    }
+}
+
+// Waits until the sink has seen cEvents, or WAIT_MS_MAX has passed.
+static bool WaitForEvents(SOURCE_CALL* pCall, DWORD cEvents)
+{
+    const ULONGLONG ullStartMs = CEventReactor::GetTimeMs();
+    for (;;)
+    {
+        GetEventReactor()->Send(CountOnReactor, pCall);
+        if (pCall->cEvents >= cEvents)
+        {
+            return true;
+        }
+        if (CEventReactor::GetTimeMs() - ullStartMs > WAIT_MS_MAX)
+        {
+            return false;
+        }
+        usleep(1000);
+    }
+}
+
+// Reads a trace the way the source should see it: steps in order, with the
+// time of each from the start of the trace.
+static DWORD LoadExpected(const char* pszPath, DEVICE_EVENT* rgEvent, ULONGLONG* rgullAtMs, DWORD cMax)
+{
+    FILE* pFile = fopen(pszPath, "r");
+    if (!pFile)
+    {
+        return 0;
+    }
+
+    DWORD cSteps = 0;
+    ULONGLONG ullLastMs = 0;
+    char szLine[DEVICE_SOURCE_LINE_CCH_MAX];
+    while ((cSteps < cMax) && fgets(szLine, sizeof(szLine), pFile))
+    {
+        char* pszEvent;
+        const ULONGLONG ullAtMs = strtoull(szLine, &pszEvent, 10);
+        if ((pszEvent != szLine) &&
+            (S_OK == ParseDeviceEventLine(pszEvent, strcspn(pszEvent, "\r\n"), &rgEvent[cSteps])))
+        {
+            ullLastMs = (ullAtMs > ullLastMs) ? ullAtMs : ullLastMs;
+            rgullAtMs[cSteps++] = ullLastMs;
+        }
+    }
+    fclose(pFile);
+    return cSteps;
+}
+
+// Replays the trace into a sink that knows what to expect, and returns how
+// long the replay took in microseconds.
+static ULONGLONG ReplayTrace(const char* pszPath, const char* pszName, DWORD* pcSteps)
+{
+    static DEVICE_EVENT s_rgEvent[REPLAY_GENERATED_STEPS];
+    static ULONGLONG s_rgullAtMs[REPLAY_GENERATED_STEPS];
+    char szWhat[256];
+
+    const DWORD cExpected = LoadExpected(pszPath, s_rgEvent, s_rgullAtMs, REPLAY_GENERATED_STEPS);
+    CReplayDeviceSource source(pszPath);
+    snprintf(szWhat, sizeof(szWhat), "%s loads every step", pszName);
+    Check(SUCCEEDED(source.Load()) && (cExpected > 0) && (source.GetStepCount() == cExpected), szWhat);
+
+    CCountingSink sink(s_rgEvent, s_rgullAtMs, cExpected);
+    SOURCE_CALL call = { &source, &sink, E_FAIL, 0 };
+    const ULONGLONG ullStartUs = CEventReactor::GetTimeUs();
+    GetEventReactor()->Send(StartOnReactor, &call);
+    const bool fDone = SUCCEEDED(call.hr) && WaitForEvents(&call, cExpected);
+    const ULONGLONG ullElapsedUs = CEventReactor::GetTimeUs() - ullStartUs;
+    GetEventReactor()->Send(StopOnReactor, &call);
+
+    snprintf(szWhat, sizeof(szWhat), "%s replays every step in order", pszName);
+    Check(fDone && (sink.cEvents == cExpected) && (0 == sink.cMismatched), szWhat);
+    snprintf(szWhat, sizeof(szWhat), "%s plays no step more than %u ms late (%llu ms)", pszName,
+             REPLAY_LATE_MS_MAX, (unsigned long long)sink.ullLateMsMax);
+    Check(sink.ullLateMsMax <= REPLAY_LATE_MS_MAX, szWhat);
+
+    *pcSteps = cExpected;
+    return ullElapsedUs;
+}
+
+static void CheckReplay(int cTraces, char** rgpszTrace)
+{
+    DWORD cSteps;
+    for (int i = 0; i < cTraces; i++)
+    {
+        const char* pszName = strrchr(rgpszTrace[i], '/') ? strrchr(rgpszTrace[i], '/') + 1 : rgpszTrace[i];
+        ReplayTrace(rgpszTrace[i], pszName, &cSteps);
+    }
+
+    // Many steps a millisecond, with a malformed line now and then, which the
+    // source must skip and count.
+    char szPath[] = "/tmp/DeviceSourceTestXXXXXX";
+    const int fd = mkstemp(szPath);
+    FILE* pFile = (fd >= 0) ? fdopen(fd, "w") : NULL;
+    if (!pFile)
+    {
+        Check(false, "generated trace is written");
+        return;
+    }
+    DWORD cMalformed = 0;
+    for (DWORD i = 0; i < REPLAY_GENERATED_STEPS; i++)
+    {
+        if (0 == i % 1000)
+        {
+            fprintf(pFile, "%u bogus %u\n", i * REPLAY_GENERATED_MS / REPLAY_GENERATED_STEPS, i);
+            cMalformed++;
+        }
+        fprintf(pFile, "%u %s %u\n", i * REPLAY_GENERATED_MS / REPLAY_GENERATED_STEPS,
+                (i / 64) % 2 ? "remove" : "insert", i % 64);
+    }
+    fclose(pFile);
+
+    CReplayDeviceSource source(szPath);
+    source.Load();
+    Check(source.GetMalformedCount() == cMalformed, "generated trace: malformed lines are counted and skipped");
+
+    const ULONGLONG ullElapsedUs = ReplayTrace(szPath, "generated trace", &cSteps);
+    printf("      replay: %u steps over %u ms played in %.0f ms, %.0f events/s\n", cSteps, REPLAY_GENERATED_MS,
+           ullElapsedUs / 1000.0, cSteps * 1e6 / ullElapsedUs);
+    unlink(szPath);
+}
+
+struct PIPE_WRITER
+{
+    const char* pszPath;
+    DWORD       cLines;
+    DWORD       cGood;
+    DWORD       cMalformed;
+    bool        fConnected;
+};
+
+static int Connect(const char* pszPath)
+{
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, pszPath, sizeof(addr.sun_path) - 1);
+    if ((fd >= 0) && (0 != connect(fd, (struct sockaddr*)&addr, sizeof(addr))))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Writes lines in chunks that split them anywhere, as a real writer would.
+static void* PipeWriterThread(void* pv)
+{
+    PIPE_WRITER* pWriter = static_cast<PIPE_WRITER*>(pv);
+    const int fd = Connect(pWriter->pszPath);
+    pWriter->fConnected = (fd >= 0);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    static char s_rgch[64 * 1024];
+    size_t cch = 0;
+    for (DWORD i = 0; i < pWriter->cLines; i++)
+    {
+        if (0 == i % PIPE_MALFORMED_EVERY)
+        {
+            cch += sprintf(s_rgch + cch, "unplug %u\n", i % 64);
+            pWriter->cMalformed++;
+        }
+        else
+        {
+            switch (i % 4)
+            {
+            case 0:  cch += sprintf(s_rgch + cch, "insert %u\n", i % 64); break;
+            case 1:  cch += sprintf(s_rgch + cch, "data %u %08x\n", i % 64, i); break;
+            case 2:  cch += sprintf(s_rgch + cch, "remove %u\n", i % 64); break;
+            default: cch += sprintf(s_rgch + cch, "error %u 80070015\n", i % 64); break;
+            }
+            pWriter->cGood++;
+        }
+
+        if ((cch > sizeof(s_rgch) - DEVICE_SOURCE_LINE_CCH_MAX) || (i + 1 == pWriter->cLines))
+        {
+            for (size_t ich = 0; ich < cch;)
+            {
+                const ssize_t cbWritten = write(fd, s_rgch + ich, cch - ich);
+                if (cbWritten <= 0)
+                {
+                    close(fd);
+                    return NULL;
+                }
+                ich += (size_t)cbWritten;
+            }
+            cch = 0;
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+static void CheckPipe()
+{
+    char szPath[64];
+    snprintf(szPath, sizeof(szPath), "/tmp/DeviceSourceTest.%d.sock", (int)getpid());
+
+    CPipeDeviceSource source(szPath);
+    CCountingSink sink(NULL, NULL, 0);
+    SOURCE_CALL call = { &source, &sink, E_FAIL, 0 };
+    GetEventReactor()->Send(StartOnReactor, &call);
+    Check(SUCCEEDED(call.hr), "pipe source listens");
+    if (FAILED(call.hr))
+    {
+        return;
+    }
+
+    PIPE_WRITER writer = { szPath, PIPE_LINES, 0, 0, false };
+    const EVENT_LATENCY_STATS latencyBefore = GetLatency();
+    const ULONGLONG ullStartUs = CEventReactor::GetTimeUs();
+    pthread_t thread;
+    pthread_create(&thread, NULL, PipeWriterThread, &writer);
+
+    // Once the first writer is being read, a second one is hung up on.
+    while (!writer.fConnected && (CEventReactor::GetTimeUs() - ullStartUs < 1000000))
+    {
+        usleep(100);
+    }
+    WaitForEvents(&call, 1);
+    const int fdSecond = Connect(szPath);
+    char ch;
+    const bool fTurnedAway = (fdSecond >= 0) && (0 == read(fdSecond, &ch, 1));
+    if (fdSecond >= 0)
+    {
+        close(fdSecond);
+    }
+
+    pthread_join(thread, NULL);
+    const bool fDone = WaitForEvents(&call, writer.cGood);
+    const double dSeconds = (CEventReactor::GetTimeUs() - ullStartUs) / 1e6;
+    GetEventReactor()->Send(StopOnReactor, &call);
+
+    Check(writer.fConnected, "pipe source accepts a writer");
+    Check(fDone && (sink.cEvents == writer.cGood), "pipe source delivers every good line");
+    Check(source.GetMalformedCount() == writer.cMalformed, "pipe source counts every malformed line");
+    Check(fTurnedAway, "pipe source turns away a second writer");
+    printf("      pipe: %u lines, %.0f events/s\n", writer.cLines, sink.cEvents / dSeconds);
+    CheckLatency("pipe", latencyBefore, sink.cEvents);
+}
+
+// Runs the synthetic source for SYNTHETIC_RUN_MS and returns its events a second.
+static double RunSynthetic(DWORD dwRate, CCountingSink* pSink, ULONGLONG* pcEmitted)
+{
+    CSyntheticDeviceSource source(dwRate, DEVICE_SYNTHETIC_DEVICES_MAX);
+    SOURCE_CALL call = { &source, pSink, E_FAIL, 0 };
+    const ULONGLONG ullStartUs = CEventReactor::GetTimeUs();
+    GetEventReactor()->Send(StartOnReactor, &call);
+    usleep(SYNTHETIC_RUN_MS * 1000);
+    GetEventReactor()->Send(StopOnReactor, &call);
+    const double dSeconds = (CEventReactor::GetTimeUs() - ullStartUs) / 1e6;
+
+    *pcEmitted = source.GetEmittedCount();
+    return pSink->cEvents / dSeconds;
+}
+
+static void CheckSynthetic()
+{
+    CCountingSink sink(NULL, NULL, 0);
+    ULONGLONG cEmitted;
+    const EVENT_LATENCY_STATS latencyBefore = GetLatency();
+    const double dRate = RunSynthetic(SYNTHETIC_RATE, &sink, &cEmitted);
+    Check(sink.cEvents == cEmitted, "synthetic source delivers what it counts");
+    Check(dRate >= SYNTHETIC_RATE * 0.9, "synthetic source keeps up with its rate");
+    Check(0 == sink.cStrayRemoves, "synthetic source only removes devices it inserted");
+    printf("      synthetic at %u/s: %.0f events/s\n", SYNTHETIC_RATE, dRate);
+    CheckLatency("synthetic", latencyBefore, sink.cEvents);
+
+    CCountingSink sinkFlood(NULL, NULL, 0);
+    const double dRateFlood = RunSynthetic(SYNTHETIC_RATE_FLOOD, &sinkFlood, &cEmitted);
+    Check((sinkFlood.cEvents == cEmitted) && (0 == sinkFlood.cStrayRemoves),
+          "synthetic source past its ceiling stays consistent");
+    printf("      synthetic at %u/s: %.0f events/s (ceiling %u/s)\n", SYNTHETIC_RATE_FLOOD, dRateFlood,
+           DEVICE_SYNTHETIC_BATCH_MAX * (1000 / DEVICE_SYNTHETIC_TICK_MS));
+}
+
+int main(int argc, char** argv)
+{
+    if (FAILED(GetEventReactor()->Acquire()))
+    {
+        printf("FAIL  reactor starts\n");
+        return 1;
+    }
+
+    CheckReplay(argc - 1, argv + 1);
+    CheckPipe();
+    CheckSynthetic();
+
+    GetEventReactor()->Release();
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "CFieldEventBatch.h"
+
+#include <string.h>
+
+CFieldEventBatch::CFieldEventBatch():
+    _cEvents(0)
+{
+}
+
+CFieldEventBatch::~CFieldEventBatch()
+{
+    Clear();
+}
+
+void CFieldEventBatch::Clear()
+{
+    for (DWORD i = 0; i < _cEvents; i++)
+    {
+        delete [] _rgEvent[i].pwsz;
+    }
+    _cEvents = 0;
+}
+
+HRESULT CFieldEventBatch::Add(DWORD fek, DWORD dwFieldID, DWORD dwValue, PCWSTR pwsz)
+{
+    PWSTR pwszCopy = NULL;
+    if (pwsz != NULL)
+    {
+        const size_t cch = wcslen(pwsz) + 1;
+        pwszCopy = new WCHAR[cch];
+        if (pwszCopy == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+        memcpy(pwszCopy, pwsz, cch * sizeof(WCHAR));
+    }
+
+    // Look back for the last event of this kind for this field, but not past a
+    // change to the field's combobox items.
+    FIELD_EVENT *pEvent = NULL;
+    if ((FEK_COMBOBOX_DELETE_ITEM != fek) && (FEK_COMBOBOX_APPEND_ITEM != fek))
+    {
+        for (DWORD i = _cEvents; i > 0; i--)
+        {
+            FIELD_EVENT *pEarlier = &_rgEvent[i - 1];
+            if (pEarlier->dwFieldID == dwFieldID)
+            {
+                if (pEarlier->fek == fek)
+                {
+                    pEvent = pEarlier;
+                    break;
+                }
+                if ((FEK_COMBOBOX_DELETE_ITEM == pEarlier->fek) || (FEK_COMBOBOX_APPEND_ITEM == pEarlier->fek))
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    if (pEvent != NULL)
+    {
+        delete [] pEvent->pwsz;
+    }
+    else if (_cEvents < FIELD_EVENT_BATCH_MAX)
+    {
+        pEvent = &_rgEvent[_cEvents++];
+        pEvent->fek = fek;
+        pEvent->dwFieldID = dwFieldID;
+    }
+    else
+    {
+        delete [] pwszCopy;
+        return S_FALSE;
+    }
+
+    pEvent->dwValue = dwValue;
+    pEvent->pwsz = pwszCopy;
+    return S_OK;
+}
@@ -0,0 +1,74 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CFieldEventBatch collects the field events a wrapped credential raises
+// while we are calling into it, so they can go to LogonUI together once the
+// call returns.  A credential often sets the same field more than once in a
+// burst (clearing a string, then refilling it; hiding, then showing), and
+// only the last value matters, so an event replaces an earlier one of the
+// same kind for the same field and keeps that one's place in the order.
+//
+// Adding and removing combobox items can't be collapsed, since each one
+// moves the items after it, so they are kept in order, and a selection made
+// after one of them doesn't replace a selection made before.
+//
+// It has no COM or LogonUI dependencies, so it also builds elsewhere.
+
+#pragma once
+
+#include "wincompat.h"
+
+// Most events held before the batch has to be flushed to make room.
+#define FIELD_EVENT_BATCH_MAX   64
+
+enum FIELD_EVENT_KIND
+{
+    FEK_STATE = 0,                  // dwValue is the CREDENTIAL_PROVIDER_FIELD_STATE.
+    FEK_INTERACTIVE_STATE,          // dwValue is the CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE.
+    FEK_STRING,                     // pwsz is the string.
+    FEK_CHECKBOX,                   // dwValue is whether it's checked, pwsz the label.
+    FEK_COMBOBOX_SELECTED_ITEM,     // dwValue is the item.
+    FEK_COMBOBOX_DELETE_ITEM,       // dwValue is the item.
+    FEK_COMBOBOX_APPEND_ITEM,       // pwsz is the item.
+    FEK_SUBMIT_BUTTON,              // dwValue is the field it's next to.
+};
+
+struct FIELD_EVENT
+{
+    DWORD   fek;                    // FIELD_EVENT_KIND.
+    DWORD   dwFieldID;
+    DWORD   dwValue;
+    PWSTR   pwsz;                   // Our copy, or NULL.
+};
+
+class CFieldEventBatch
+{
+  public:
+    CFieldEventBatch();
+    ~CFieldEventBatch();
+
+    // Adds an event, or folds it into an earlier one.  Returns S_FALSE if the
+    // batch is full and has to be flushed first.
+    HRESULT Add(DWORD fek, DWORD dwFieldID, DWORD dwValue, PCWSTR pwsz);
+
+    void Clear();
+
+    DWORD GetCount() const
+    {
+        return _cEvents;
+    }
+
+    const FIELD_EVENT& GetAt(DWORD i) const
+    {
+        return _rgEvent[i];
+    }
+
+  private:
+    FIELD_EVENT     _rgEvent[FIELD_EVENT_BATCH_MAX];
+    DWORD           _cEvents;
+};
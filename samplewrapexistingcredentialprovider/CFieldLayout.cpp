@@ -0,0 +1,193 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "CFieldLayout.h"
+
+CFieldLayout::CFieldLayout():
+    _rgcpfd(NULL),
+    _rgdwType(NULL),
+    _cFields(0),
+    _cWrapped(0),
+    _fStale(FALSE)
+{
+    _rgdwWrappedFirst[0] = 0;
+}
+
+CFieldLayout::~CFieldLayout()
+{
+    Clear();
+}
+
+HRESULT CFieldLayout::ReadWrapped(
+    __in ICredentialProvider *pProvider,
+    __out WRAPPED_FIELDS *pwf
+    )
+{
+    pwf->rgpcpfd = NULL;
+    pwf->cFields = 0;
+
+    DWORD cFields;
+    HRESULT hr = pProvider->GetFieldDescriptorCount(&cFields);
+    if (SUCCEEDED(hr))
+    {
+        hr = (cFields <= FIELD_ROUTER_FIELDS_MAX) ? S_OK : E_UNEXPECTED;
+    }
+    if (SUCCEEDED(hr) && (cFields > 0))
+    {
+        pwf->rgpcpfd = new CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR*[cFields];
+        if (pwf->rgpcpfd == NULL)
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < cFields); i++)
+    {
+        hr = pProvider->GetFieldDescriptorAt(i, &pwf->rgpcpfd[i]);
+        if (SUCCEEDED(hr))
+        {
+            pwf->cFields++;
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        FreeWrapped(pwf);
+    }
+    return hr;
+}
+
+void CFieldLayout::FreeWrapped(__inout WRAPPED_FIELDS *pwf)
+{
+    if (pwf->rgpcpfd != NULL)
+    {
+        for (DWORD i = 0; i < pwf->cFields; i++)
+        {
+            CoTaskMemFree(pwf->rgpcpfd[i]->pszLabel);
+            CoTaskMemFree(pwf->rgpcpfd[i]);
+        }
+        delete [] pwf->rgpcpfd;
+        pwf->rgpcpfd = NULL;
+    }
+    pwf->cFields = 0;
+}
+
+void CFieldLayout::Clear()
+{
+    if (_rgcpfd != NULL)
+    {
+        for (DWORD i = 0; i < _cFields; i++)
+        {
+            CoTaskMemFree(_rgcpfd[i].pszLabel);
+        }
+        delete [] _rgcpfd;
+        _rgcpfd = NULL;
+    }
+    delete [] _rgdwType;
+    _rgdwType = NULL;
+    _cFields = 0;
+    _cWrapped = 0;
+    _rgdwWrappedFirst[0] = 0;
+    InterlockedExchange(&_fStale, FALSE);
+}
+
+HRESULT CFieldLayout::Build(
+    __in_ecount(cWrapped) const WRAPPED_FIELDS *rgwf,
+    __in DWORD cWrapped,
+    __in_ecount(cOwn) const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *rgcpfdOwn,
+    __in DWORD cOwn
+    )
+{
+    // Clear forgets invalidations before we read, so one that arrives while we
+    // build makes us build again next time.
+    Clear();
+
+    HRESULT hr = (cWrapped <= WRAPPED_PROVIDERS_MAX) ? S_OK : E_INVALIDARG;
+    DWORD cFields = cOwn;
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < cWrapped); i++)
+    {
+        cFields += rgwf[i].cFields;
+    }
+    if (SUCCEEDED(hr) && (cFields > FIELD_ROUTER_FIELDS_MAX))
+    {
+        hr = E_UNEXPECTED;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        _rgcpfd = new CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR[cFields];
+        _rgdwType = new DWORD[cFields];
+        if ((_rgcpfd != NULL) && (_rgdwType != NULL))
+        {
+            ZeroMemory(_rgcpfd, cFields * sizeof(*_rgcpfd));
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
+    // Every field ID, wrapped or ours, is its index in the merged list.
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < cWrapped); i++)
+    {
+        _rgdwWrappedFirst[i] = _cFields;
+        for (DWORD j = 0; SUCCEEDED(hr) && (j < rgwf[i].cFields); j++)
+        {
+            hr = FieldDescriptorCopy(*rgwf[i].rgpcpfd[j], &_rgcpfd[_cFields]);
+            if (SUCCEEDED(hr))
+            {
+                _rgcpfd[_cFields].dwFieldID = _cFields;
+                _rgdwType[_cFields] = _rgcpfd[_cFields].cpft;
+                _cFields++;
+            }
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        _rgdwWrappedFirst[cWrapped] = _cFields;
+    }
+
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < cOwn); i++)
+    {
+        hr = FieldDescriptorCopy(rgcpfdOwn[i], &_rgcpfd[_cFields]);
+        if (SUCCEEDED(hr))
+        {
+            _rgcpfd[_cFields].dwFieldID = _cFields;
+            _rgdwType[_cFields] = _rgcpfd[_cFields].cpft;
+            _cFields++;
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        _cWrapped = cWrapped;
+    }
+    else
+    {
+        Clear();
+    }
+
+    return hr;
+}
+
+HRESULT CFieldLayout::GetAt(
+    __in DWORD dwIndex,
+    __deref_out CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **ppcpfd
+    ) const
+{
+    HRESULT hr = E_INVALIDARG;
+
+    if ((dwIndex < _cFields) && (ppcpfd != NULL))
+    {
+        hr = FieldDescriptorCoAllocCopy(_rgcpfd[dwIndex], ppcpfd);
+    }
+
+    return hr;
+}
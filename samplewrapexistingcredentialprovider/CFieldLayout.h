@@ -0,0 +1,113 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CFieldLayout holds the field descriptors our tiles show: each wrapped
+// provider's in turn, then our own, every one with its field ID moved past
+// the fields before it.  The wrapped providers' descriptors are read once
+// per usage scenario into a WRAPPED_FIELDS, on whichever thread owns the
+// provider, and the layout answers from its copy until it is invalidated,
+// which happens when the usage scenario changes or a wrapped provider says
+// its credentials have changed.
+
+#pragma once
+
+#include <credentialprovider.h>
+#include <windows.h>
+#include "helpers.h"
+#include "common.h"
+#include "CFieldRouter.h"
+
+// One wrapped provider's descriptors, as its GetFieldDescriptorAt handed them out.
+struct WRAPPED_FIELDS
+{
+    CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR    **rgpcpfd;
+    DWORD                                   cFields;
+};
+
+class CFieldLayout
+{
+  public:
+    CFieldLayout();
+    ~CFieldLayout();
+
+    // Reads all of pProvider's descriptors into pwf, or none of them.
+    static HRESULT ReadWrapped(__in ICredentialProvider *pProvider, __out WRAPPED_FIELDS *pwf);
+    static void FreeWrapped(__inout WRAPPED_FIELDS *pwf);
+
+    // Copies the descriptors of cWrapped providers, in order, and appends cOwn
+    // of ours.  A provider with no fields on our tiles has an empty entry.
+    HRESULT Build(__in_ecount(cWrapped) const WRAPPED_FIELDS *rgwf,
+                  __in DWORD cWrapped,
+                  __in_ecount(cOwn) const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR *rgcpfdOwn,
+                  __in DWORD cOwn);
+
+    // Marks the copy out of date.  Safe to call from any thread: the copy is
+    // only freed by the next Build or Clear, on the thread that uses the layout.
+    void Invalidate()
+    {
+        InterlockedExchange(&_fStale, TRUE);
+    }
+
+    // Frees the copy and forgets any invalidation; the next Build starts afresh.
+    void Clear();
+
+    bool IsBuilt() const
+    {
+        return _rgcpfd != NULL;
+    }
+
+    bool IsValid() const
+    {
+        return (_rgcpfd != NULL) && !_fStale;
+    }
+
+    // Whether Invalidate has been called since the last Build or Clear, so the
+    // wrapped providers' descriptors have to be read again.
+    bool IsStale() const
+    {
+        return _fStale != FALSE;
+    }
+
+    DWORD GetCount() const
+    {
+        return _cFields;
+    }
+
+    DWORD GetWrappedFirst(__in DWORD iWrapped) const
+    {
+        return _rgdwWrappedFirst[iWrapped];
+    }
+
+    DWORD GetWrappedCount(__in DWORD iWrapped) const
+    {
+        return _rgdwWrappedFirst[iWrapped + 1] - _rgdwWrappedFirst[iWrapped];
+    }
+
+    DWORD GetLocalFirst() const
+    {
+        return _rgdwWrappedFirst[_cWrapped];
+    }
+
+    // The CREDENTIAL_PROVIDER_FIELD_TYPE of every field, for CFieldRouter.
+    const DWORD* GetTypes() const
+    {
+        return _rgdwType;
+    }
+
+    // Returns a CoTaskMemAlloc'd copy of the descriptor at dwIndex, as
+    // GetFieldDescriptorAt hands it to LogonUI.
+    HRESULT GetAt(__in DWORD dwIndex, __deref_out CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR **ppcpfd) const;
+
+  private:
+    CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR    *_rgcpfd;       // Wrapped fields, then ours.
+    DWORD                                   *_rgdwType;
+    DWORD                                   _cFields;
+    DWORD                                   _rgdwWrappedFirst[WRAPPED_PROVIDERS_MAX + 1];   // The last is where ours start.
+    DWORD                                   _cWrapped;
+    volatile LONG                           _fStale;
+};
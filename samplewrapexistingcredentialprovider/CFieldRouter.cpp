@@ -0,0 +1,56 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include "CFieldRouter.h"
+
+CFieldRouter::CFieldRouter():
+    _cRoutes(0)
+{
+    _rgRoute[0].frt = FRT_INVALID;
+    _rgRoute[0].dwID = 0;
+    _rgRoute[0].dwType = 0;
+}
+
+HRESULT CFieldRouter::Initialize(const DWORD* rgdwType, DWORD cFields, DWORD dwWrappedFirst, DWORD cWrapped, DWORD dwLocalFirst)
+{
+    if ((cFields > FIELD_ROUTER_FIELDS_MAX) ||
+        (dwWrappedFirst > dwLocalFirst) ||
+        (cWrapped > dwLocalFirst - dwWrappedFirst) ||
+        (dwLocalFirst > cFields))
+    {
+        return E_INVALIDARG;
+    }
+
+    for (DWORD i = 0; i < cFields; i++)
+    {
+        if ((i >= dwWrappedFirst) && (i - dwWrappedFirst < cWrapped))
+        {
+            _rgRoute[i].frt = FRT_WRAPPED;
+            _rgRoute[i].dwID = i - dwWrappedFirst;
+        }
+        else if (i >= dwLocalFirst)
+        {
+            _rgRoute[i].frt = FRT_LOCAL;
+            _rgRoute[i].dwID = i - dwLocalFirst;
+        }
+        else
+        {
+            _rgRoute[i].frt = FRT_HIDDEN;
+            _rgRoute[i].dwID = i;
+        }
+        _rgRoute[i].dwType = rgdwType[i];
+    }
+
+    // Where every out-of-range ID lands.
+    _rgRoute[cFields].frt = FRT_INVALID;
+    _rgRoute[cFields].dwID = 0;
+    _rgRoute[cFields].dwType = 0;
+    _cRoutes = cFields;
+    return S_OK;
+}
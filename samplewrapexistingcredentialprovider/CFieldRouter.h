@@ -0,0 +1,66 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CFieldRouter tells a wrapper credential, from a field ID alone, where the
+// field lives: in the wrapped credential, under which ID, among our own
+// fields, at which index, or on the tiles of another wrapped provider, in
+// which case this tile keeps it hidden.  The table is built once when the
+// credential is initialized, so every field call is a single indexed load
+// rather than a range check and an offset, and a field ID that belongs to
+// nobody comes back as FRT_INVALID instead of reaching the wrapped
+// credential.
+//
+// It has no COM or LogonUI dependencies, so it also builds elsewhere.
+
+#pragma once
+
+#include "wincompat.h"
+
+// Most fields all the wrapped providers and ours can have between them.
+#define FIELD_ROUTER_FIELDS_MAX     256
+
+enum FIELD_ROUTE_TARGET
+{
+    FRT_INVALID = 0,
+    FRT_WRAPPED = 1,    // dwID is the wrapped credential's field ID.
+    FRT_LOCAL   = 2,    // dwID is the index into our own fields.
+    FRT_HIDDEN  = 3,    // Another wrapped provider's field.
+};
+
+struct FIELD_ROUTE
+{
+    DWORD   frt;        // FIELD_ROUTE_TARGET.
+    DWORD   dwID;
+    DWORD   dwType;     // The CREDENTIAL_PROVIDER_FIELD_TYPE.
+};
+
+class CFieldRouter
+{
+  public:
+    CFieldRouter();
+
+    // Routes cWrapped field IDs from dwWrappedFirst to the wrapped credential
+    // and those from dwLocalFirst on to our own fields.  The rest of the
+    // cFields, whose types are in rgdwType, belong to other providers.
+    HRESULT Initialize(const DWORD* rgdwType, DWORD cFields, DWORD dwWrappedFirst, DWORD cWrapped, DWORD dwLocalFirst);
+
+    // Always returns a route; one for a field nobody has is FRT_INVALID.
+    const FIELD_ROUTE& Lookup(DWORD dwFieldID) const
+    {
+        return _rgRoute[(dwFieldID < _cRoutes) ? dwFieldID : _cRoutes];
+    }
+
+    DWORD GetCount() const
+    {
+        return _cRoutes;
+    }
+
+  private:
+    FIELD_ROUTE     _rgRoute[FIELD_ROUTER_FIELDS_MAX + 1];  // The last used entry is FRT_INVALID.
+    DWORD           _cRoutes;
+};
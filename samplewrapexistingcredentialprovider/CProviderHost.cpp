@@ -0,0 +1,392 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The host is busy from Queue until its job returns, and only the host
+// thread clears that, so a job that runs late can't be overlapped by the
+// next one.  The late callback runs after the host has gone idle, so an
+// owner that hears about it and asks again finds the host ready.
+
+#include "CProviderHost.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <time.h>
+#endif
+
+CProviderHost::CProviderHost():
+    _pfnAttach(NULL),
+    _pfnDetach(NULL),
+    _pfnLate(NULL),
+    _pvContext(NULL),
+    _pfnJob(NULL),
+    _pvJob(NULL),
+    _fBusy(true),
+    _fLate(false),
+    _fStop(false)
+{
+#ifdef _WIN32
+    InitializeCriticalSection(&_cs);
+    _hThread = NULL;
+    _hJob = CreateEventW(NULL, FALSE, FALSE, NULL);
+    _hIdle = CreateEventW(NULL, TRUE, FALSE, NULL);
+#else
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_condJob, &attr);
+    pthread_cond_init(&_condIdle, &attr);
+    pthread_condattr_destroy(&attr);
+    _fThread = false;
+#endif
+}
+
+CProviderHost::~CProviderHost()
+{
+    Stop();
+#ifdef _WIN32
+    if (_hJob != NULL)
+    {
+        CloseHandle(_hJob);
+    }
+    if (_hIdle != NULL)
+    {
+        CloseHandle(_hIdle);
+    }
+    DeleteCriticalSection(&_cs);
+#else
+    pthread_cond_destroy(&_condIdle);
+    pthread_cond_destroy(&_condJob);
+    pthread_mutex_destroy(&_mutex);
+#endif
+}
+
+// Runs the job queued, if any.  Returns false once the host has been told to
+// stop.
+bool CProviderHost::_RunJob()
+{
+#ifdef _WIN32
+    EnterCriticalSection(&_cs);
+#else
+    pthread_mutex_lock(&_mutex);
+    while ((_pfnJob == NULL) && !_fStop)
+    {
+        pthread_cond_wait(&_condJob, &_mutex);
+    }
+#endif
+    PFN_HOST_JOB pfn = _pfnJob;
+    void* pvJob = _pvJob;
+    _pfnJob = NULL;
+    const bool fStop = _fStop;
+#ifdef _WIN32
+    LeaveCriticalSection(&_cs);
+#else
+    pthread_mutex_unlock(&_mutex);
+#endif
+
+    if (pfn == NULL)
+    {
+        return !fStop;
+    }
+
+    pfn(pvJob);
+
+#ifdef _WIN32
+    EnterCriticalSection(&_cs);
+    const bool fLate = _fLate;
+    const bool fRun = !_fStop;
+    _fLate = false;
+    _fBusy = false;
+    SetEvent(_hIdle);
+    LeaveCriticalSection(&_cs);
+#else
+    pthread_mutex_lock(&_mutex);
+    const bool fLate = _fLate;
+    const bool fRun = !_fStop;
+    _fLate = false;
+    _fBusy = false;
+    pthread_cond_broadcast(&_condIdle);
+    pthread_mutex_unlock(&_mutex);
+#endif
+
+    if (fLate && (_pfnLate != NULL))
+    {
+        _pfnLate(_pvContext);
+    }
+
+    // Stop's wakeup may have been taken by this job's.
+    return fRun;
+}
+
+#ifdef _WIN32
+
+HRESULT CProviderHost::Start(PFN_HOST_JOB pfnAttach, PFN_HOST_JOB pfnDetach, PFN_HOST_JOB pfnLate, void* pvContext)
+{
+    HRESULT hr = ((_hJob != NULL) && (_hIdle != NULL)) ? S_OK : E_OUTOFMEMORY;
+    if (SUCCEEDED(hr))
+    {
+        _pfnAttach = pfnAttach;
+        _pfnDetach = pfnDetach;
+        _pfnLate = pfnLate;
+        _pvContext = pvContext;
+
+        _hThread = CreateThread(NULL, 0, _ThreadProc, this, 0, NULL);
+        if (_hThread != NULL)
+        {
+            // Attaching is the first thing the thread does, and it goes idle after.
+            WaitForSingleObject(_hIdle, INFINITE);
+        }
+        else
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+    return hr;
+}
+
+void CProviderHost::Stop()
+{
+    if (_hThread != NULL)
+    {
+        EnterCriticalSection(&_cs);
+        _fStop = true;
+        SetEvent(_hJob);
+        LeaveCriticalSection(&_cs);
+
+        // The thread may be in a late callback, calling LogonUI's thread through a
+        // proxy, so we have to keep taking COM calls until it's done, as WaitIdle does.
+        DWORD dwIndex;
+        CoWaitForMultipleHandles(0, INFINITE, 1, &_hThread, &dwIndex);
+        CloseHandle(_hThread);
+        _hThread = NULL;
+    }
+}
+
+HRESULT CProviderHost::Queue(PFN_HOST_JOB pfn, void* pvJob)
+{
+    HRESULT hr = S_OK;
+    EnterCriticalSection(&_cs);
+    if (_fBusy || (_hThread == NULL))
+    {
+        hr = E_PENDING;
+    }
+    else
+    {
+        _pfnJob = pfn;
+        _pvJob = pvJob;
+        _fBusy = true;
+        ResetEvent(_hIdle);
+        SetEvent(_hJob);
+    }
+    LeaveCriticalSection(&_cs);
+    return hr;
+}
+
+bool CProviderHost::IsIdle()
+{
+    EnterCriticalSection(&_cs);
+    const bool fIdle = !_fBusy;
+    LeaveCriticalSection(&_cs);
+    return fIdle;
+}
+
+// The waiting thread is usually LogonUI's, which must keep taking COM calls,
+// such as a wrapped provider's events, while it waits.
+DWORD CProviderHost::WaitIdle(CProviderHost** rgpHost, DWORD cHosts, DWORD dwTimeoutMs)
+{
+    const ULONGLONG ullDeadline = GetTickCount64() + dwTimeoutMs;
+    for (DWORD i = 0; i < cHosts; i++)
+    {
+        const ULONGLONG ullNow = GetTickCount64();
+        DWORD dwIndex;
+        CoWaitForMultipleHandles(0, (ullNow < ullDeadline) ? (DWORD)(ullDeadline - ullNow) : 0, 1, &rgpHost[i]->_hIdle, &dwIndex);
+    }
+
+    DWORD cIdle = 0;
+    for (DWORD i = 0; i < cHosts; i++)
+    {
+        EnterCriticalSection(&rgpHost[i]->_cs);
+        if (rgpHost[i]->_fBusy)
+        {
+            rgpHost[i]->_fLate = true;
+        }
+        else
+        {
+            cIdle++;
+        }
+        LeaveCriticalSection(&rgpHost[i]->_cs);
+    }
+    return cIdle;
+}
+
+// Between jobs the thread dispatches whatever messages arrive, which is how
+// COM delivers calls made through proxies to the provider living here.
+void CProviderHost::_Run()
+{
+    _pfnAttach(_pvContext);
+
+    EnterCriticalSection(&_cs);
+    _fBusy = false;
+    SetEvent(_hIdle);
+    LeaveCriticalSection(&_cs);
+
+    bool fRun = true;
+    while (fRun)
+    {
+        const DWORD dwWait = MsgWaitForMultipleObjectsEx(1, &_hJob, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        if (WAIT_OBJECT_0 == dwWait)
+        {
+            fRun = _RunJob();
+        }
+        else if (WAIT_OBJECT_0 + 1 == dwWait)
+        {
+            MSG msg;
+            while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE))
+            {
+                TranslateMessage(&msg);
+                DispatchMessageW(&msg);
+            }
+        }
+        else
+        {
+            fRun = false;
+        }
+    }
+
+    _pfnDetach(_pvContext);
+}
+
+DWORD WINAPI CProviderHost::_ThreadProc(void* pv)
+{
+    static_cast<CProviderHost*>(pv)->_Run();
+    return 0;
+}
+
+#else
+
+HRESULT CProviderHost::Start(PFN_HOST_JOB pfnAttach, PFN_HOST_JOB pfnDetach, PFN_HOST_JOB pfnLate, void* pvContext)
+{
+    _pfnAttach = pfnAttach;
+    _pfnDetach = pfnDetach;
+    _pfnLate = pfnLate;
+    _pvContext = pvContext;
+
+    if (0 != pthread_create(&_thread, NULL, _ThreadProc, this))
+    {
+        return E_FAIL;
+    }
+    _fThread = true;
+
+    pthread_mutex_lock(&_mutex);
+    while (_fBusy)
+    {
+        pthread_cond_wait(&_condIdle, &_mutex);
+    }
+    pthread_mutex_unlock(&_mutex);
+    return S_OK;
+}
+
+void CProviderHost::Stop()
+{
+    if (_fThread)
+    {
+        pthread_mutex_lock(&_mutex);
+        _fStop = true;
+        pthread_cond_signal(&_condJob);
+        pthread_mutex_unlock(&_mutex);
+
+        pthread_join(_thread, NULL);
+        _fThread = false;
+    }
+}
+
+HRESULT CProviderHost::Queue(PFN_HOST_JOB pfn, void* pvJob)
+{
+    HRESULT hr = S_OK;
+    pthread_mutex_lock(&_mutex);
+    if (_fBusy || !_fThread)
+    {
+        hr = E_PENDING;
+    }
+    else
+    {
+        _pfnJob = pfn;
+        _pvJob = pvJob;
+        _fBusy = true;
+        pthread_cond_signal(&_condJob);
+    }
+    pthread_mutex_unlock(&_mutex);
+    return hr;
+}
+
+bool CProviderHost::IsIdle()
+{
+    pthread_mutex_lock(&_mutex);
+    const bool fIdle = !_fBusy;
+    pthread_mutex_unlock(&_mutex);
+    return fIdle;
+}
+
+DWORD CProviderHost::WaitIdle(CProviderHost** rgpHost, DWORD cHosts, DWORD dwTimeoutMs)
+{
+    struct timespec tsDeadline;
+    clock_gettime(CLOCK_MONOTONIC, &tsDeadline);
+    tsDeadline.tv_sec += dwTimeoutMs / 1000;
+    tsDeadline.tv_nsec += (long)(dwTimeoutMs % 1000) * 1000000;
+    if (tsDeadline.tv_nsec >= 1000000000)
+    {
+        tsDeadline.tv_sec++;
+        tsDeadline.tv_nsec -= 1000000000;
+    }
+
+    DWORD cIdle = 0;
+    for (DWORD i = 0; i < cHosts; i++)
+    {
+        CProviderHost* pHost = rgpHost[i];
+        pthread_mutex_lock(&pHost->_mutex);
+        int iErr = 0;
+        while (pHost->_fBusy && (ETIMEDOUT != iErr))
+        {
+            iErr = pthread_cond_timedwait(&pHost->_condIdle, &pHost->_mutex, &tsDeadline);
+        }
+        if (pHost->_fBusy)
+        {
+            pHost->_fLate = true;
+        }
+        else
+        {
+            cIdle++;
+        }
+        pthread_mutex_unlock(&pHost->_mutex);
+    }
+    return cIdle;
+}
+
+void CProviderHost::_Run()
+{
+    _pfnAttach(_pvContext);
+
+    pthread_mutex_lock(&_mutex);
+    _fBusy = false;
+    pthread_cond_broadcast(&_condIdle);
+    pthread_mutex_unlock(&_mutex);
+
+    while (_RunJob())
+    {
+    }
+
+    _pfnDetach(_pvContext);
+}
+
+void* CProviderHost::_ThreadProc(void* pv)
+{
+    static_cast<CProviderHost*>(pv)->_Run();
+    return NULL;
+}
+
+#endif
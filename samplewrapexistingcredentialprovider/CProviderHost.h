@@ -0,0 +1,94 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CProviderHost is a thread of its own for one wrapped provider.  The
+// provider is created on it and lives there, so the slow calls (setting the
+// usage scenario, counting credentials) can be handed to every wrapped
+// provider's host at once and the caller can wait for all of them together,
+// for no longer than it is willing to.
+//
+// A host runs one job at a time.  A job the caller stopped waiting for
+// keeps running; when it finishes the host calls the late callback, on the
+// host thread, so the owner can pick up the result.  Until then Queue
+// refuses new jobs.
+//
+// On Windows the thread is a single-threaded apartment that pumps messages
+// while it has no job, so calls made through proxies from other apartments
+// reach the provider there, and WaitIdle pumps COM calls for the waiting
+// thread too.  Elsewhere it is a plain thread, so the fan-out can be
+// exercised with stand-in providers.
+
+#pragma once
+
+#include "wincompat.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+typedef void (*PFN_HOST_JOB)(void* pvContext);
+
+class CProviderHost
+{
+  public:
+    CProviderHost();
+    ~CProviderHost();
+
+    // Starts the thread.  pfnAttach runs on it first, before Start returns,
+    // and pfnDetach last; pfnLate runs on it after a late job.
+    HRESULT Start(PFN_HOST_JOB pfnAttach, PFN_HOST_JOB pfnDetach, PFN_HOST_JOB pfnLate, void* pvContext);
+
+    // Waits for the job in hand, however long it takes, and ends the thread.
+    // On Windows it keeps taking COM calls while it waits, as WaitIdle does.
+    void Stop();
+
+    // Hands pfn to the thread.  Returns E_PENDING while a job is running.
+    HRESULT Queue(PFN_HOST_JOB pfn, void* pvJob);
+
+    bool IsIdle();
+
+    // Waits until every one of the hosts is idle or dwTimeoutMs has passed,
+    // and returns how many are idle.  Those that aren't have their job
+    // marked late.
+    static DWORD WaitIdle(CProviderHost** rgpHost, DWORD cHosts, DWORD dwTimeoutMs);
+
+  private:
+    void _Run();
+    bool _RunJob();
+#ifdef _WIN32
+    static DWORD WINAPI _ThreadProc(void* pv);
+#else
+    static void* _ThreadProc(void* pv);
+#endif
+
+  private:
+    PFN_HOST_JOB        _pfnAttach;
+    PFN_HOST_JOB        _pfnDetach;
+    PFN_HOST_JOB        _pfnLate;
+    void*               _pvContext;
+
+    // Guarded by the lock.
+    PFN_HOST_JOB        _pfnJob;            // Queued, not yet picked up.
+    void*               _pvJob;
+    bool                _fBusy;             // From Queue until the job returns.
+    bool                _fLate;             // WaitIdle gave up on the running job.
+    bool                _fStop;
+
+#ifdef _WIN32
+    CRITICAL_SECTION    _cs;
+    HANDLE              _hThread;
+    HANDLE              _hJob;              // Auto-reset: a job or Stop is waiting.
+    HANDLE              _hIdle;             // Manual-reset: no job is running.
+#else
+    pthread_mutex_t     _mutex;
+    pthread_cond_t      _condJob;
+    pthread_cond_t      _condIdle;
+    pthread_t           _thread;
+    bool                _fThread;
+#endif
+};
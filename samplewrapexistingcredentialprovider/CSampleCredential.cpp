@@ -35,6 +35,7 @@ CSampleCredential::CSampleCredential():
     _pWrappedCredentialEvents = NULL;
     _pCredProvCredentialEvents = NULL;
 
+    _dwWrappedFirst = 0;
     _dwWrappedDescriptorCount = 0;
     _dwDatabaseIndex = 0;
 }
@@ -58,16 +59,26 @@ CSampleCredential::~CSampleCredential()
 }
 
 // Initializes one credential with the field information passed in. We also keep track
-// of our wrapped credential and how many fields it has.
+// of our wrapped credential and where the layout puts its fields: the iWrapped'th
+// provider's block, which our tile shows, among the other wrapped providers', which
+// it keeps hidden.  If pDatabases isn't NULL, our combobox pages through it rather
+// than showing s_rgDatabases.
 HRESULT CSampleCredential::Initialize(
     __in const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR* rgcpfd,
     __in const FIELD_STATE_PAIR* rgfsp,
     __in ICredentialProviderCredential *pWrappedCredential,
-    __in DWORD dwWrappedDescriptorCount
+    __in const CFieldLayout& layout,
+    __in DWORD iWrapped,
+    __in_opt CComboBoxSource* pDatabases
     )
 {
     HRESULT hr = S_OK;
 
+    if (pDatabases != NULL)
+    {
+        _databaseField.Initialize(pDatabases);
+    }
+
     // Grab the credential we're wrapping for future reference.
     if (_pWrappedCredential != NULL)
     {
@@ -76,8 +87,9 @@ HRESULT CSampleCredential::Initialize(
     _pWrappedCredential = pWrappedCredential;
     _pWrappedCredential->AddRef();
 
-    // We also need to remember how many fields the inner credential has.
-    _dwWrappedDescriptorCount = dwWrappedDescriptorCount;
+    // We also need to remember where the inner credential's fields are.
+    _dwWrappedFirst = layout.GetWrappedFirst(iWrapped);
+    _dwWrappedDescriptorCount = layout.GetWrappedCount(iWrapped);
 
     // Copy the field descriptors for each field. This is useful if you want to vary the field
     // descriptors based on what Usage scenario the credential was created for.
@@ -87,6 +99,12 @@ HRESULT CSampleCredential::Initialize(
         hr = FieldDescriptorCopy(rgcpfd[i], &_rgCredProvFieldDescriptors[i]);
     }
 
+    // Work out once where each field ID goes.
+    if (SUCCEEDED(hr))
+    {
+        hr = _router.Initialize(layout.GetTypes(), layout.GetCount(), _dwWrappedFirst, _dwWrappedDescriptorCount, layout.GetLocalFirst());
+    }
+
     // Initialize the String value of all of our fields.
     if (SUCCEEDED(hr))
     {
@@ -119,7 +137,7 @@ HRESULT CSampleCredential::Advise(
     
     if (_pWrappedCredentialEvents != NULL)
     {
-        _pWrappedCredentialEvents->Initialize(this, pcpce);
+        _pWrappedCredentialEvents->Initialize(this, pcpce, _dwWrappedFirst);
     
         if (_pWrappedCredential != NULL)
         {
@@ -161,7 +179,9 @@ HRESULT CSampleCredential::SetSelected(__out BOOL* pbAutoLogon)
 
     if (_pWrappedCredential != NULL)
     {
+        CWrappedCredentialEvents *pEvents = _BeginEventBatch();
         hr = _pWrappedCredential->SetSelected(pbAutoLogon);
+        _EndEventBatch(pEvents);
     }
 
     return hr;
@@ -175,7 +195,9 @@ HRESULT CSampleCredential::SetDeselected()
 
     if (_pWrappedCredential != NULL)
     {
+        CWrappedCredentialEvents *pEvents = _BeginEventBatch();
         hr = _pWrappedCredential->SetDeselected();
+        _EndEventBatch(pEvents);
     }
 
     return hr;
@@ -195,30 +217,35 @@ HRESULT CSampleCredential::GetFieldState(
     // Make sure we have a wrapped credential.
     if (_pWrappedCredential != NULL)
     {
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+
         // Validate parameters.
         if ((pcpfs != NULL) && (pcpfis != NULL))
         {
             // If the field is in the wrapped credential, hand it off.
-            if (_IsFieldInWrappedCredential(dwFieldID))
+            if (FRT_WRAPPED == route.frt)
             {
-                hr = _pWrappedCredential->GetFieldState(dwFieldID, pcpfs, pcpfis);
+                hr = _pWrappedCredential->GetFieldState(route.dwID, pcpfs, pcpfis);
+            }
+            // Otherwise, if it's one of ours, give it info it needs.
+            else if (FRT_LOCAL == route.frt)
+            {
+                *pcpfs = _rgFieldStatePairs[route.dwID].cpfs;
+                *pcpfis = _rgFieldStatePairs[route.dwID].cpfis;
+
+                hr = S_OK;
+            }
+            // Another wrapped provider's fields never show on this tile.
+            else if (FRT_HIDDEN == route.frt)
+            {
+                *pcpfs = CPFS_HIDDEN;
+                *pcpfis = CPFIS_NONE;
+
+                hr = S_OK;
             }
-            // Otherwise, we need to see if it's one of ours.
             else
             {
-                FIELD_STATE_PAIR *pfsp = _LookupLocalFieldStatePair(dwFieldID);
-                // If the field ID is valid, give it info it needs.
-                if (pfsp != NULL)
-                {
-                    *pcpfs = pfsp->cpfs;
-                    *pcpfis = pfsp->cpfis;
-
-                    hr = S_OK;
-                }
-                else
-                {
-                    hr = E_INVALIDARG;
-                }
+                hr = E_INVALIDARG;
             }
         }
         else
@@ -241,23 +268,25 @@ HRESULT CSampleCredential::GetStringValue(
     // Make sure we have a wrapped credential.
     if (_pWrappedCredential != NULL)
     {
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+
         // If this field belongs to the wrapped credential, hand it off.
-        if (_IsFieldInWrappedCredential(dwFieldID))
+        if (FRT_WRAPPED == route.frt)
         {
-            hr = _pWrappedCredential->GetStringValue(dwFieldID, ppwsz);
+            hr = _pWrappedCredential->GetStringValue(route.dwID, ppwsz);
         }
         // Otherwise determine if we need to handle it.
+        else if (FRT_LOCAL == route.frt)
+        {
+            hr = SHStrDupW(_rgFieldStrings[route.dwID], ppwsz);
+        }
+        else if (FRT_HIDDEN == route.frt)
+        {
+            hr = SHStrDupW(L"", ppwsz);
+        }
         else
         {
-            FIELD_STATE_PAIR *pfsp = _LookupLocalFieldStatePair(dwFieldID);
-            if (pfsp != NULL)
-            {
-                hr = SHStrDupW(_rgFieldStrings[SFI_I_WORK_IN_STATIC], ppwsz);
-            }
-            else
-            {
-                hr = E_INVALIDARG;
-            }
+            hr = E_INVALIDARG;
         }
     }
     return hr;
@@ -277,25 +306,33 @@ HRESULT CSampleCredential::GetComboBoxValueCount(
     // Make sure we have a wrapped credential.
     if (_pWrappedCredential != NULL)
     {
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+
         // If this field belongs to the wrapped credential, hand it off.
-        if (_IsFieldInWrappedCredential(dwFieldID))
+        if (FRT_WRAPPED == route.frt)
         {
-            hr = _pWrappedCredential->GetComboBoxValueCount(dwFieldID, pcItems, pdwSelectedItem);
+            hr = _pWrappedCredential->GetComboBoxValueCount(route.dwID, pcItems, pdwSelectedItem);
         }
         // Otherwise determine if we need to handle it.
+        else if ((FRT_LOCAL == route.frt) && (CPFT_COMBOBOX == route.dwType) && _databaseField.IsInitialized())
+        {
+            hr = _databaseField.GetValueCount(pcItems, pdwSelectedItem);
+        }
+        else if ((FRT_LOCAL == route.frt) && (CPFT_COMBOBOX == route.dwType))
+        {
+            *pcItems = ARRAYSIZE(s_rgDatabases);
+            *pdwSelectedItem = _dwDatabaseIndex;
+            hr = S_OK;
+        }
+        else if ((FRT_HIDDEN == route.frt) && (CPFT_COMBOBOX == route.dwType))
+        {
+            *pcItems = 0;
+            *pdwSelectedItem = 0;
+            hr = S_OK;
+        }
         else
         {
-            FIELD_STATE_PAIR *pfsp = _LookupLocalFieldStatePair(dwFieldID);
-            if (pfsp != NULL)
-            {
-                *pcItems = ARRAYSIZE(s_rgDatabases);
-                *pdwSelectedItem = _dwDatabaseIndex;
-                hr = S_OK;
-            }
-            else
-            {
-                hr = E_INVALIDARG;
-            }
+            hr = E_INVALIDARG;
         }
     }
 
@@ -316,23 +353,25 @@ HRESULT CSampleCredential::GetComboBoxValueAt(
     // Make sure we have a wrapped credential.
     if (_pWrappedCredential != NULL)
     {
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+
         // If this field belongs to the wrapped credential, hand it off.
-        if (_IsFieldInWrappedCredential(dwFieldID))
+        if (FRT_WRAPPED == route.frt)
         {
-            hr = _pWrappedCredential->GetComboBoxValueAt(dwFieldID, dwItem, ppwszItem);
+            hr = _pWrappedCredential->GetComboBoxValueAt(route.dwID, dwItem, ppwszItem);
         }
         // Otherwise determine if we need to handle it.
+        else if ((FRT_LOCAL == route.frt) && (CPFT_COMBOBOX == route.dwType) && _databaseField.IsInitialized())
+        {
+            hr = _databaseField.GetValueAt(dwItem, ppwszItem);
+        }
+        else if ((FRT_LOCAL == route.frt) && (CPFT_COMBOBOX == route.dwType) && (dwItem < ARRAYSIZE(s_rgDatabases)))
+        {
+            hr = SHStrDupW(s_rgDatabases[dwItem], ppwszItem);
+        }
         else
         {
-            FIELD_STATE_PAIR *pfsp = _LookupLocalFieldStatePair(dwFieldID);
-            if ((pfsp != NULL) && (dwItem < ARRAYSIZE(s_rgDatabases)))
-            {
-                hr = SHStrDupW(s_rgDatabases[dwItem], ppwszItem);
-            }
-            else
-            {
-                hr = E_INVALIDARG;
-            }
+            hr = E_INVALIDARG;
         }
     }
 
@@ -351,24 +390,29 @@ HRESULT CSampleCredential::SetComboBoxSelectedValue(
     // Make sure we have a wrapped credential.
     if (_pWrappedCredential != NULL)
     {
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+
         // If this field belongs to the wrapped credential, hand it off.
-        if (_IsFieldInWrappedCredential(dwFieldID))
+        if (FRT_WRAPPED == route.frt)
         {
-            hr = _pWrappedCredential->SetComboBoxSelectedValue(dwFieldID, dwSelectedItem);
+            CWrappedCredentialEvents *pEvents = _BeginEventBatch();
+            hr = _pWrappedCredential->SetComboBoxSelectedValue(route.dwID, dwSelectedItem);
+            _EndEventBatch(pEvents);
         }
         // Otherwise determine if we need to handle it.
+        else if ((FRT_LOCAL == route.frt) && (CPFT_COMBOBOX == route.dwType) && _databaseField.IsInitialized())
+        {
+            // Selecting "More..." shows the next page.
+            hr = _databaseField.SetSelectedValue(this, _pCredProvCredentialEvents, dwFieldID, dwSelectedItem);
+        }
+        else if ((FRT_LOCAL == route.frt) && (CPFT_COMBOBOX == route.dwType) && (dwSelectedItem < ARRAYSIZE(s_rgDatabases)))
+        {
+            _dwDatabaseIndex = dwSelectedItem;
+            hr = S_OK;
+        }
         else
         {
-            FIELD_STATE_PAIR *pfsp = _LookupLocalFieldStatePair(dwFieldID);
-            if ((pfsp != NULL) && (dwSelectedItem < ARRAYSIZE(s_rgDatabases)))
-            {
-                _dwDatabaseIndex = dwSelectedItem;
-                hr = S_OK;
-            }
-            else
-            {
-                hr = E_INVALIDARG;
-            }
+            hr = E_INVALIDARG;
         }
     }
 
@@ -379,7 +423,8 @@ HRESULT CSampleCredential::SetComboBoxSelectedValue(
 // The following methods are for logonUI to get the values of various UI elements and 
 // then communicate to the credential about what the user did in that field. Even though
 // we don't offer these field types ourselves, we need to pass along the request to the
-// wrapped credential.
+// wrapped credential, and turn away the IDs of our own fields.  Those of the other
+// wrapped providers' fields that LogonUI reads get empty values, since they are hidden.
 
 HRESULT CSampleCredential::GetBitmapValue(
     __in DWORD dwFieldID, 
@@ -390,7 +435,15 @@ HRESULT CSampleCredential::GetBitmapValue(
 
     if (_pWrappedCredential != NULL)
     {
-        hr = _pWrappedCredential->GetBitmapValue(dwFieldID, phbmp);
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+        if (FRT_WRAPPED == route.frt)
+        {
+            hr = _pWrappedCredential->GetBitmapValue(route.dwID, phbmp);
+        }
+        else
+        {
+            hr = E_INVALIDARG;
+        }
     }
 
     return hr;
@@ -405,7 +458,20 @@ HRESULT CSampleCredential::GetSubmitButtonValue(
 
     if (_pWrappedCredential != NULL)
     {
-        hr = _pWrappedCredential->GetSubmitButtonValue(dwFieldID, pdwAdjacentTo);
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+        if (FRT_WRAPPED == route.frt)
+        {
+            hr = _pWrappedCredential->GetSubmitButtonValue(route.dwID, pdwAdjacentTo);
+        }
+        else if ((FRT_HIDDEN == route.frt) && (CPFT_SUBMIT_BUTTON == route.dwType))
+        {
+            *pdwAdjacentTo = (dwFieldID > 0) ? dwFieldID - 1 : 0;
+            hr = S_OK;
+        }
+        else
+        {
+            hr = E_INVALIDARG;
+        }
     }
 
     return hr;
@@ -420,7 +486,17 @@ HRESULT CSampleCredential::SetStringValue(
 
     if (_pWrappedCredential != NULL)
     {
-        hr = _pWrappedCredential->SetStringValue(dwFieldID, pwz);
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+        if (FRT_WRAPPED == route.frt)
+        {
+            CWrappedCredentialEvents *pEvents = _BeginEventBatch();
+            hr = _pWrappedCredential->SetStringValue(route.dwID, pwz);
+            _EndEventBatch(pEvents);
+        }
+        else
+        {
+            hr = E_INVALIDARG;
+        }
     }
 
     return hr;
@@ -437,9 +513,19 @@ HRESULT CSampleCredential::GetCheckboxValue(
 
     if (_pWrappedCredential != NULL)
     {
-        if (_IsFieldInWrappedCredential(dwFieldID))
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+        if (FRT_WRAPPED == route.frt)
+        {
+            hr = _pWrappedCredential->GetCheckboxValue(route.dwID, pbChecked, ppwszLabel);
+        }
+        else if ((FRT_HIDDEN == route.frt) && (CPFT_CHECKBOX == route.dwType))
+        {
+            *pbChecked = FALSE;
+            hr = SHStrDupW(L"", ppwszLabel);
+        }
+        else
         {
-            hr = _pWrappedCredential->GetCheckboxValue(dwFieldID, pbChecked, ppwszLabel);
+            hr = E_INVALIDARG;
         }
     }
 
@@ -455,7 +541,17 @@ HRESULT CSampleCredential::SetCheckboxValue(
 
     if (_pWrappedCredential != NULL)
     {
-        hr = _pWrappedCredential->SetCheckboxValue(dwFieldID, bChecked);
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+        if (FRT_WRAPPED == route.frt)
+        {
+            CWrappedCredentialEvents *pEvents = _BeginEventBatch();
+            hr = _pWrappedCredential->SetCheckboxValue(route.dwID, bChecked);
+            _EndEventBatch(pEvents);
+        }
+        else
+        {
+            hr = E_INVALIDARG;
+        }
     }
 
     return hr;
@@ -467,7 +563,17 @@ HRESULT CSampleCredential::CommandLinkClicked(__in DWORD dwFieldID)
 
     if (_pWrappedCredential != NULL)
     {
-        hr = _pWrappedCredential->CommandLinkClicked(dwFieldID);
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+        if (FRT_WRAPPED == route.frt)
+        {
+            CWrappedCredentialEvents *pEvents = _BeginEventBatch();
+            hr = _pWrappedCredential->CommandLinkClicked(route.dwID);
+            _EndEventBatch(pEvents);
+        }
+        else
+        {
+            hr = E_INVALIDARG;
+        }
     }
 
     return hr;
@@ -491,7 +597,9 @@ HRESULT CSampleCredential::GetSerialization(
 
     if (_pWrappedCredential != NULL)
     {
+        CWrappedCredentialEvents *pEvents = _BeginEventBatch();
         hr = _pWrappedCredential->GetSerialization(pcpgsr, pcpcs, ppwszOptionalStatusText, pcpsiOptionalStatusIcon);
+        _EndEventBatch(pEvents);
     }
 
     return hr;
@@ -510,33 +618,35 @@ HRESULT CSampleCredential::ReportResult(
 
     if (_pWrappedCredential != NULL)
     {
+        CWrappedCredentialEvents *pEvents = _BeginEventBatch();
         hr = _pWrappedCredential->ReportResult(ntsStatus, ntsSubstatus, ppwszOptionalStatusText, pcpsiOptionalStatusIcon);
+        _EndEventBatch(pEvents);
     }
 
     return hr;
 }
 
-BOOL CSampleCredential::_IsFieldInWrappedCredential(
-    __in DWORD dwFieldID
-    )
+// The field events the wrapped credential raises while we call into it are held back
+// until it returns, so that LogonUI gets each field's last value once.  The events
+// object is held on to in case LogonUI advises us again in the meantime.
+CWrappedCredentialEvents* CSampleCredential::_BeginEventBatch()
 {
-    return (dwFieldID < _dwWrappedDescriptorCount);
+    CWrappedCredentialEvents *pEvents = _pWrappedCredentialEvents;
+    if (pEvents != NULL)
+    {
+        pEvents->AddRef();
+        pEvents->BeginBatch();
+    }
+    return pEvents;
 }
 
-FIELD_STATE_PAIR *CSampleCredential::_LookupLocalFieldStatePair(
-    __in DWORD dwFieldID
-    )
+void CSampleCredential::_EndEventBatch(__in_opt CWrappedCredentialEvents *pEvents)
 {
-    // Offset into the ID to account for the wrapped fields.
-    dwFieldID -= _dwWrappedDescriptorCount;
-
-    // If the index if valid, give it the info it wants.
-    if (dwFieldID < SFI_NUM_FIELDS)
+    if (pEvents != NULL)
     {
-        return &(_rgFieldStatePairs[dwFieldID]);
+        pEvents->EndBatch();
+        pEvents->Release();
     }
-    
-    return NULL;
 }
 
 void CSampleCredential::_CleanupEvents()
@@ -20,6 +20,9 @@
 #include "dll.h"
 #include "resource.h"
 #include "CWrappedCredentialEvents.h"
+#include "CFieldRouter.h"
+#include "CFieldLayout.h"
+#include <ComboBoxField.h>
 
 class CSampleCredential : public ICredentialProviderCredential
 {
@@ -86,15 +89,28 @@ class CSampleCredential : public ICredentialProviderCredential
     HRESULT Initialize(__in const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR* rgcpfd,
                        __in const FIELD_STATE_PAIR* rgfsp,
                        __in ICredentialProviderCredential *pWrappedCredential,
-                       __in DWORD dwWrappedDescriptorCount);
+                       __in const CFieldLayout& layout,
+                       __in DWORD iWrapped,
+                       __in_opt CComboBoxSource* pDatabases);
     CSampleCredential();
 
     virtual ~CSampleCredential();
 
+    // Whether this wraps pWrappedCredential with its fields where the layout puts the
+    // iWrapped'th provider's, in which case the provider can keep it rather than build
+    // a new one.
+    bool IsWrapping(__in ICredentialProviderCredential *pWrappedCredential, __in const CFieldLayout& layout, __in DWORD iWrapped) const
+    {
+        return (_pWrappedCredential == pWrappedCredential) && 
+               (_dwWrappedFirst == layout.GetWrappedFirst(iWrapped)) &&
+               (_dwWrappedDescriptorCount == layout.GetWrappedCount(iWrapped)) &&
+               (_router.GetCount() == layout.GetCount());
+    }
+
   private:
-    BOOL                                  _IsFieldInWrappedCredential(__in DWORD dwFieldID);
-    FIELD_STATE_PAIR                     *_LookupLocalFieldStatePair(__in DWORD dwFieldID);
     void                                  _CleanupEvents(); 
+    CWrappedCredentialEvents*             _BeginEventBatch();
+    void                                  _EndEventBatch(__in_opt CWrappedCredentialEvents *pEvents);
 
   private:
     LONG                                  _cRef;
@@ -119,9 +135,16 @@ class CSampleCredential : public ICredentialProviderCredential
                                                                                         // changed.
 
     ICredentialProviderCredential        *_pWrappedCredential;                           // Our wrapped credential.
+    DWORD                                _dwWrappedFirst;                                // Our field ID of the wrapped
+                                                                                         // credential's first field.
     DWORD                                _dwWrappedDescriptorCount;                      // The number of fields in our
                                                                                          // wrapped credential.
 
+    CFieldRouter                         _router;                                        // Where each field ID goes.
+
     DWORD                                _dwDatabaseIndex;                               // The current selected item
                                                                                         // in our combobox.
+
+    CComboBoxField                       _databaseField;                                 // Our combobox's items when
+                                                                                         // they come from a file.
 };
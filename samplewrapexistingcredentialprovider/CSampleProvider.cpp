@@ -8,11 +8,12 @@
 //
 // CSampleProvider implements ICredentialProvider, which is the main
 // interface that logonUI uses to decide which tiles to display.
-// In this sample, we are wrapping the default password provider with
-// an extra small text and combobox. We pass nearly all requests to the
-// wrapped provider, except for the ones that are for fields we're
-// responsible for ourselves. As far as the owner is concerned, we are a
-// unique provider, so they never know we're wrapping another provider.
+// In this sample, we are wrapping the default password provider, or the
+// providers listed under our registration key, with an extra small text and
+// combobox. We pass nearly all requests to the wrapped provider, except for
+// the ones that are for fields we're responsible for ourselves. As far as the
+// owner is concerned, we are a unique provider, so they never know we're
+// wrapping other providers.
 
 #include <credentialprovider.h>
 #include "CSampleProvider.h"
@@ -29,17 +30,22 @@ CSampleProvider::CSampleProvider():
     _rgpCredentials = NULL;
     _dwCredentialCount = 0;
 
-    _pWrappedProvider = NULL;
-    _dwWrappedDescriptorCount = 0;
+    ZeroMemory(_rgpWrapped, sizeof(_rgpWrapped));
+    _cWrapped = 0;
+    _dwTimeout = WRAPPED_PROVIDERS_TIMEOUT;
+    _pDatabases = NULL;
 }
 
 CSampleProvider::~CSampleProvider()
 {
     _CleanUpAllCredentials();
-    
-    if (_pWrappedProvider)
+    _ReleaseProviderEvents();
+    _ReleaseWrappedProviders();
+
+    if (_pDatabases != NULL)
     {
-        _pWrappedProvider->Release();
+        _pDatabases->Release();
+        _pDatabases = NULL;
     }
 
     DllRelease();
@@ -62,11 +68,369 @@ void CSampleProvider::_CleanUpAllCredentials()
         delete [] _rgpCredentials;
         _rgpCredentials = NULL;
     }
+    _dwCredentialCount = 0;
+}
+
+// Creates the providers listed under our registration key, or the password provider if
+// there is no list, each on a thread of its own.  One that can't have a thread is
+// created on ours instead and called in turn with the others' jobs under way.
+HRESULT CSampleProvider::_CreateWrappedProviders()
+{
+    HRESULT hr = S_OK;
+    CLSID rgclsid[WRAPPED_PROVIDERS_MAX];
+    DWORD cclsid = 0;
+
+    WCHAR wszList[WRAPPED_PROVIDERS_MAX * 40 + 1];
+    DWORD cb = sizeof(wszList);
+    if (ERROR_SUCCESS == RegGetValueW(HKEY_LOCAL_MACHINE, WRAPPED_PROVIDERS_KEY, WRAPPED_PROVIDERS_VALUE, RRF_RT_REG_MULTI_SZ, NULL, wszList, &cb))
+    {
+        for (PWSTR pwsz = wszList; (*pwsz != L'\0') && (cclsid < ARRAYSIZE(rgclsid)); pwsz += wcslen(pwsz) + 1)
+        {
+            // We never wrap ourselves, and each provider only once.
+            CLSID clsid;
+            if (SUCCEEDED(CLSIDFromString(pwsz, &clsid)) && !IsEqualCLSID(clsid, CLSID_CSample))
+            {
+                bool fListed = false;
+                for (DWORD i = 0; i < cclsid; i++)
+                {
+                    fListed = fListed || IsEqualCLSID(clsid, rgclsid[i]);
+                }
+                if (!fListed)
+                {
+                    rgclsid[cclsid++] = clsid;
+                }
+            }
+        }
+    }
+    if (cclsid == 0)
+    {
+        rgclsid[cclsid++] = CLSID_PasswordCredentialProvider;
+    }
+
+    DWORD dwTimeout;
+    cb = sizeof(dwTimeout);
+    if (ERROR_SUCCESS == RegGetValueW(HKEY_LOCAL_MACHINE, WRAPPED_PROVIDERS_KEY, WRAPPED_PROVIDERS_TIMEOUT_VALUE, RRF_RT_REG_DWORD, NULL, &dwTimeout, &cb))
+    {
+        _dwTimeout = dwTimeout;
+    }
+
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < cclsid); i++)
+    {
+        WRAPPED_PROVIDER *pwp = new WRAPPED_PROVIDER;
+        if (pwp != NULL)
+        {
+            pwp->clsid = rgclsid[i];
+            pwp->fHosted = false;
+            pwp->fComInitialized = false;
+            pwp->hrCreate = E_FAIL;
+            pwp->pProvider = NULL;
+            pwp->pstmProvider = NULL;
+            pwp->pProxy = NULL;
+            pwp->pEvents = NULL;
+            pwp->dwEventsCookie = 0;
+            pwp->upAdviseContext = 0;
+            pwp->fInScenario = false;
+            pwp->wf.rgpcpfd = NULL;
+            pwp->wf.cFields = 0;
+
+            HRESULT hrHost = pwp->host.Start(_AttachJob, _DetachJob, _LateJob, pwp);
+            if (SUCCEEDED(hrHost))
+            {
+                hrHost = pwp->hrCreate;
+            }
+            if (SUCCEEDED(hrHost))
+            {
+                hrHost = CoGetInterfaceAndReleaseStream(pwp->pstmProvider, IID_PPV_ARGS(&pwp->pProxy));
+                pwp->pstmProvider = NULL;
+            }
+
+            if (SUCCEEDED(hrHost))
+            {
+                pwp->fHosted = true;
+            }
+            else
+            {
+                // Stopping the host lets go of whatever it did create.
+                pwp->host.Stop();
+                if (SUCCEEDED(CoCreateInstance(pwp->clsid, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pwp->pProvider))))
+                {
+                    pwp->pProxy = pwp->pProvider;
+                    pwp->pProxy->AddRef();
+                }
+            }
+
+            // A provider that isn't installed is left out; the others carry on.
+            if (pwp->pProxy != NULL)
+            {
+                _rgpWrapped[_cWrapped++] = pwp;
+            }
+            else
+            {
+                delete pwp;
+            }
+        }
+        else
+        {
+            hr = E_OUTOFMEMORY;
+        }
+    }
+
+    if (SUCCEEDED(hr) && (_cWrapped == 0))
+    {
+        hr = E_UNEXPECTED;
+    }
+
+    return hr;
+}
+
+// The proxies go first: once its host has stopped there is nothing for them to reach.
+// Stopping a host waits for a job that ran late to finish.
+void CSampleProvider::_ReleaseWrappedProviders()
+{
+    for (DWORD i = 0; i < _cWrapped; i++)
+    {
+        WRAPPED_PROVIDER *pwp = _rgpWrapped[i];
+        pwp->pProxy->Release();
+        pwp->pProxy = NULL;
+        if (pwp->fHosted)
+        {
+            pwp->host.Stop();
+        }
+        else
+        {
+            pwp->pProvider->Release();
+            pwp->pProvider = NULL;
+        }
+        CFieldLayout::FreeWrapped(&pwp->wf);
+        delete pwp;
+        _rgpWrapped[i] = NULL;
+    }
+    _cWrapped = 0;
+}
+
+// Lets go of the events objects we gave the wrapped providers.  They may hold on to them
+// for a while yet, so they must no longer point at our layout.
+void CSampleProvider::_ReleaseProviderEvents()
+{
+    IGlobalInterfaceTable *pgit = NULL;
+    for (DWORD i = 0; i < _cWrapped; i++)
+    {
+        WRAPPED_PROVIDER *pwp = _rgpWrapped[i];
+        const DWORD dwCookie = (DWORD)InterlockedExchange((LONG volatile*)&pwp->dwEventsCookie, 0);
+        if (dwCookie != 0)
+        {
+            if ((pgit != NULL) || SUCCEEDED(CoCreateInstance(CLSID_StdGlobalInterfaceTable, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pgit))))
+            {
+                pgit->RevokeInterfaceFromGlobal(dwCookie);
+            }
+        }
+        if (pwp->pEvents != NULL)
+        {
+            pwp->pEvents->Uninitialize();
+            pwp->pEvents->Release();
+            pwp->pEvents = NULL;
+        }
+    }
+    if (pgit != NULL)
+    {
+        pgit->Release();
+    }
+}
+
+// Merges the field descriptors the wrapped providers in this scenario gave us last,
+// unless we're up to date.  The ones a provider gave us are its job's results, so we
+// only look at them once every provider has gone idle; until then the old layout stands.
+HRESULT CSampleProvider::_EnsureLayout()
+{
+    HRESULT hr = S_OK;
+
+    if (!_layout.IsValid())
+    {
+        WRAPPED_FIELDS rgwf[WRAPPED_PROVIDERS_MAX];
+        bool fAny = false;
+        bool fIdle = true;
+        for (DWORD i = 0; i < _cWrapped; i++)
+        {
+            WRAPPED_PROVIDER *pwp = _rgpWrapped[i];
+            if (pwp->fInScenario)
+            {
+                fAny = true;
+                fIdle = fIdle && (!pwp->fHosted || pwp->host.IsIdle());
+                rgwf[i] = pwp->wf;
+            }
+            else
+            {
+                rgwf[i].rgpcpfd = NULL;
+                rgwf[i].cFields = 0;
+            }
+        }
+
+        if (!fAny)
+        {
+            hr = E_UNEXPECTED;
+        }
+        else if (fIdle)
+        {
+            hr = _layout.Build(rgwf, _cWrapped, s_rgCredProvFieldDescriptors, SFI_NUM_FIELDS);
+        }
+        else if (!_layout.IsBuilt())
+        {
+            hr = E_PENDING;
+        }
+    }
+
+    return hr;
+}
+
+// Hands pfnJob to the wrapped providers, or just those in this scenario, all at once,
+// and waits for them, for no longer than we were told to.  If fWaitForOne is set and
+// none of them has answered by then, we wait for all of them, as we would have for the
+// one provider we used to wrap.  Returns a mask of those that finished.
+DWORD CSampleProvider::_RunJobs(
+    __in PFN_HOST_JOB pfnJob,
+    __in bool fInScenarioOnly,
+    __in bool fWaitForOne
+    )
+{
+    CProviderHost *rgpHost[WRAPPED_PROVIDERS_MAX];
+    DWORD rgiHost[WRAPPED_PROVIDERS_MAX];
+    DWORD cHosts = 0;
+    DWORD dwFinished = 0;
+
+    for (DWORD i = 0; i < _cWrapped; i++)
+    {
+        WRAPPED_PROVIDER *pwp = _rgpWrapped[i];
+        if (pwp->fHosted && (pwp->fInScenario || !fInScenarioOnly))
+        {
+            // A host still busy with a late job sits this one out.
+            if (SUCCEEDED(pwp->host.Queue(pfnJob, pwp)))
+            {
+                rgpHost[cHosts] = &pwp->host;
+                rgiHost[cHosts] = i;
+                cHosts++;
+            }
+        }
+    }
+
+    // The ones without a thread of their own run while the others do.
+    for (DWORD i = 0; i < _cWrapped; i++)
+    {
+        WRAPPED_PROVIDER *pwp = _rgpWrapped[i];
+        if (!pwp->fHosted && (pwp->fInScenario || !fInScenarioOnly))
+        {
+            pfnJob(pwp);
+            dwFinished |= (1 << i);
+        }
+    }
+
+    if (cHosts > 0)
+    {
+        DWORD cIdle = CProviderHost::WaitIdle(rgpHost, cHosts, _dwTimeout);
+        if ((cIdle == 0) && (dwFinished == 0) && fWaitForOne)
+        {
+            CProviderHost::WaitIdle(rgpHost, cHosts, INFINITE);
+        }
+
+        for (DWORD i = 0; i < cHosts; i++)
+        {
+            if (rgpHost[i]->IsIdle())
+            {
+                dwFinished |= (1 << rgiHost[i]);
+            }
+        }
+    }
+
+    return dwFinished;
+}
+
+// The host threads' side of things.  Each wrapped provider is created in a single-
+// threaded apartment of its own and marshaled for LogonUI's thread.
+void CSampleProvider::_AttachJob(__in void *pv)
+{
+    WRAPPED_PROVIDER *pwp = static_cast<WRAPPED_PROVIDER*>(pv);
+
+    pwp->hrCreate = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+    if (SUCCEEDED(pwp->hrCreate))
+    {
+        pwp->fComInitialized = true;
+        pwp->hrCreate = CoCreateInstance(pwp->clsid, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pwp->pProvider));
+    }
+    if (SUCCEEDED(pwp->hrCreate))
+    {
+        pwp->hrCreate = CoMarshalInterThreadInterfaceInStream(IID_ICredentialProvider, pwp->pProvider, &pwp->pstmProvider);
+    }
+}
+
+void CSampleProvider::_DetachJob(__in void *pv)
+{
+    WRAPPED_PROVIDER *pwp = static_cast<WRAPPED_PROVIDER*>(pv);
+
+    if (pwp->pProvider != NULL)
+    {
+        pwp->pProvider->Release();
+        pwp->pProvider = NULL;
+    }
+    if (pwp->fComInitialized)
+    {
+        CoUninitialize();
+        pwp->fComInitialized = false;
+    }
+}
+
+// A job we stopped waiting for has finished.  Whatever it found out, LogonUI has our
+// answer without it, so we tell LogonUI our credentials have changed and it asks again.
+void CSampleProvider::_LateJob(__in void *pv)
+{
+    WRAPPED_PROVIDER *pwp = static_cast<WRAPPED_PROVIDER*>(pv);
+
+    // LogonUI's thread may be revoking it right now, in which case GetInterfaceFromGlobal
+    // just fails.
+    const DWORD dwCookie = (DWORD)InterlockedCompareExchange((LONG volatile*)&pwp->dwEventsCookie, 0, 0);
+    if (dwCookie != 0)
+    {
+        IGlobalInterfaceTable *pgit;
+        if (SUCCEEDED(CoCreateInstance(CLSID_StdGlobalInterfaceTable, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pgit))))
+        {
+            ICredentialProviderEvents *pcpe;
+            if (SUCCEEDED(pgit->GetInterfaceFromGlobal(dwCookie, IID_PPV_ARGS(&pcpe))))
+            {
+                pcpe->CredentialsChanged(pwp->upAdviseContext);
+                pcpe->Release();
+            }
+            pgit->Release();
+        }
+    }
+}
+
+void CSampleProvider::_ScenarioJob(__in void *pv)
+{
+    WRAPPED_PROVIDER *pwp = static_cast<WRAPPED_PROVIDER*>(pv);
+
+    CFieldLayout::FreeWrapped(&pwp->wf);
+    pwp->hrJob = pwp->pProvider->SetUsageScenario(pwp->cpus, pwp->dwFlags);
+    if (SUCCEEDED(pwp->hrJob))
+    {
+        pwp->hrJob = CFieldLayout::ReadWrapped(pwp->pProvider, &pwp->wf);
+    }
+}
+
+void CSampleProvider::_CountJob(__in void *pv)
+{
+    WRAPPED_PROVIDER *pwp = static_cast<WRAPPED_PROVIDER*>(pv);
+
+    pwp->hrJob = pwp->pProvider->GetCredentialCount(&pwp->dwCount, &pwp->dwDefault, &pwp->bAutoLogonWithDefault);
+    if (SUCCEEDED(pwp->hrJob) && pwp->fReadFields)
+    {
+        CFieldLayout::FreeWrapped(&pwp->wf);
+        pwp->hrJob = CFieldLayout::ReadWrapped(pwp->pProvider, &pwp->wf);
+    }
 }
 
 // Ordinarily we would look at the CPUS and decide whether or not we support this scenario.
-// However, in this scenario we're going to create our internal provider and let it answer
-// questions like this for us.
+// However, in this scenario we're going to create our internal providers and let them
+// answer questions like this for us.  They all answer at once, on their own threads; one
+// that takes longer than we're willing to wait has no part in this scenario.  We support
+// the scenario if any of them does.
 HRESULT CSampleProvider::SetUsageScenario(
     __in CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus,
     __in DWORD dwFlags
@@ -74,70 +438,165 @@ HRESULT CSampleProvider::SetUsageScenario(
 {
     HRESULT hr = S_OK;
 
-    // Create the password credential provider if we don't already have one,
-    // and query its interface for an ICredentialProvider we can use.
-    if (_pWrappedProvider == NULL)
+    // The wrapped providers' fields may differ from one scenario to the next.  The
+    // layout is cleared before they read them, so a change one reports after reading
+    // marks it stale again.
+    _layout.Clear();
+
+    // Create the wrapped providers if we don't already have them.
+    if (_cWrapped == 0)
     {
-        hr = CoCreateInstance(CLSID_PasswordCredentialProvider, NULL, CLSCTX_ALL, IID_PPV_ARGS(&_pWrappedProvider));
+        hr = _CreateWrappedProviders();
     }
 
-    // Once the provider is up and running, ask it about the usage scenario
-    // being provided.
-    if (SUCCEEDED(hr))
+    // Map our databases once, if there's a file of them; every credential pages
+    // through the same one.  Without it we keep s_rgDatabases.
+    if (SUCCEEDED(hr) && (_pDatabases == NULL))
     {
-        hr = _pWrappedProvider->SetUsageScenario(cpus, dwFlags);
+        ComboBoxSourceOpenFromRegistry(WRAPPED_PROVIDERS_KEY, DATABASES_VALUE, &_pDatabases);
     }
 
-    if (FAILED(hr))
+    // Once the providers are up and running, ask them about the usage scenario
+    // being provided.
+    if (SUCCEEDED(hr))
     {
-        if (_pWrappedProvider != NULL)
+        for (DWORD i = 0; i < _cWrapped; i++)
+        {
+            _rgpWrapped[i]->cpus = cpus;
+            _rgpWrapped[i]->dwFlags = dwFlags;
+            _rgpWrapped[i]->fInScenario = false;
+        }
+
+        const DWORD dwFinished = _RunJobs(_ScenarioJob, false, true);
+
+        hr = E_NOTIMPL;
+        bool fAny = false;
+        for (DWORD i = 0; i < _cWrapped; i++)
         {
-            _pWrappedProvider->Release();
-            _pWrappedProvider = NULL;
+            WRAPPED_PROVIDER *pwp = _rgpWrapped[i];
+            if (dwFinished & (1 << i))
+            {
+                pwp->fInScenario = SUCCEEDED(pwp->hrJob);
+                if (pwp->fInScenario)
+                {
+                    fAny = true;
+                }
+                else if (hr == E_NOTIMPL)
+                {
+                    hr = pwp->hrJob;
+                }
+            }
+        }
+        if (fAny)
+        {
+            hr = S_OK;
         }
     }
 
     return hr;
 }
 
-// We pass this along to the wrapped provider.
+// We pass this along to the wrapped providers.
 HRESULT CSampleProvider::SetSerialization(
     __in const CREDENTIAL_PROVIDER_CREDENTIAL_SERIALIZATION* pcpcs
     )
 {
     HRESULT hr = E_UNEXPECTED;
-    
-    if (_pWrappedProvider != NULL)
+    bool fAny = false;
+
+    for (DWORD i = 0; i < _cWrapped; i++)
     {
-        hr = _pWrappedProvider->SetSerialization(pcpcs);
+        if (_rgpWrapped[i]->fInScenario)
+        {
+            HRESULT hrWrapped = _rgpWrapped[i]->pProxy->SetSerialization(pcpcs);
+            if (SUCCEEDED(hrWrapped))
+            {
+                fAny = true;
+            }
+            else if (!fAny)
+            {
+                hr = hrWrapped;
+            }
+        }
     }
 
-    return hr;
+    return fAny ? S_OK : hr;
 }
 
-// Called by LogonUI to give you a callback. We pass this along to the wrapped provider.
+// Called by LogonUI to give you a callback. We pass this along to the wrapped providers,
+// each through an object of our own so we hear when its credentials change.  The objects
+// also go in the global interface table, from where a host thread can reach them after a
+// late job.
 HRESULT CSampleProvider::Advise(
     __in ICredentialProviderEvents* pcpe,
     __in UINT_PTR upAdviseContext
     )
 {
     HRESULT hr = E_UNEXPECTED;
-    if (_pWrappedProvider != NULL)
+
+    _ReleaseProviderEvents();
+
+    IGlobalInterfaceTable *pgit = NULL;
+    CoCreateInstance(CLSID_StdGlobalInterfaceTable, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pgit));
+
+    for (DWORD i = 0; (hr != E_OUTOFMEMORY) && (i < _cWrapped); i++)
+    {
+        WRAPPED_PROVIDER *pwp = _rgpWrapped[i];
+        if (pwp->fInScenario)
+        {
+            pwp->pEvents = new CWrappedProviderEvents();
+            if (pwp->pEvents != NULL)
+            {
+                pwp->pEvents->Initialize(&_layout, pcpe);
+                pwp->upAdviseContext = upAdviseContext;
+                if (SUCCEEDED(pwp->pProxy->Advise(pwp->pEvents, upAdviseContext)))
+                {
+                    hr = S_OK;
+                    DWORD dwCookie;
+                    if (pwp->fHosted && (pgit != NULL) &&
+                        SUCCEEDED(pgit->RegisterInterfaceInGlobal(pwp->pEvents, IID_ICredentialProviderEvents, &dwCookie)))
+                    {
+                        InterlockedExchange((LONG volatile*)&pwp->dwEventsCookie, (LONG)dwCookie);
+                    }
+                }
+                else
+                {
+                    pwp->pEvents->Uninitialize();
+                    pwp->pEvents->Release();
+                    pwp->pEvents = NULL;
+                }
+            }
+            else
+            {
+                hr = E_OUTOFMEMORY;
+            }
+        }
+    }
+
+    if (pgit != NULL)
     {
-        hr = _pWrappedProvider->Advise(pcpe, upAdviseContext);
+        pgit->Release();
+    }
+    if (FAILED(hr))
+    {
+        UnAdvise();
     }
     return hr;
 }
 
 // Called by LogonUI when the ICredentialProviderEvents callback is no longer valid. 
-// We pass this along to the wrapped provider.
+// We pass this along to the wrapped providers we advised.
 HRESULT CSampleProvider::UnAdvise()
 {
     HRESULT hr = E_UNEXPECTED;
-    if (_pWrappedProvider != NULL)
+    for (DWORD i = 0; i < _cWrapped; i++)
     {
-        hr = _pWrappedProvider->UnAdvise();
+        if (_rgpWrapped[i]->pEvents != NULL)
+        {
+            hr = _rgpWrapped[i]->pProxy->UnAdvise();
+        }
     }
+    _ReleaseProviderEvents();
     return hr;
 }
 
@@ -146,68 +605,35 @@ HRESULT CSampleProvider::UnAdvise()
 // This number must include both visible and invisible fields. If you want a tile
 // to have different fields from the other tiles you enumerate for a given usage
 // scenario you must include them all in this count and then hide/show them as desired 
-// using the field descriptors. We pass this along to the wrapped provider and then append
-// our own credential count.
+// using the field descriptors. That is what we do: every tile has every wrapped
+// provider's fields and ours, and shows its own provider's and ours.  We work the
+// layout out once per usage scenario along with the descriptors.
 HRESULT CSampleProvider::GetFieldDescriptorCount(
     __out DWORD* pdwCount
     )
 {
-    HRESULT hr = E_UNEXPECTED;
-
-    if (_pWrappedProvider != NULL)
+    HRESULT hr = _EnsureLayout();
+    if (SUCCEEDED(hr))
     {
-        hr = _pWrappedProvider->GetFieldDescriptorCount(&(_dwWrappedDescriptorCount));
-        if (SUCCEEDED(hr))
-        {
-            // Note that we need to add our own credential count to the wrapped credential's
-            // total count.
-            *pdwCount = _dwWrappedDescriptorCount + SFI_NUM_FIELDS;
-        }
+        *pdwCount = _layout.GetCount();
     }
 
     return hr;
 }
 
-// Gets the field descriptor for a particular field. If this descriptor refers to one owned
-// by our wrapped provider, we'll pass it along. Otherwise we provide our own.
+// Gets the field descriptor for a particular field: a wrapped provider's own for its
+// fields and ours for the rest, each with the field ID moved past the fields before it.
+// Both come from the copy we took, so LogonUI doesn't cause calls into the wrapped
+// providers for each field.
 HRESULT CSampleProvider::GetFieldDescriptorAt(
     __in DWORD dwIndex, 
     __deref_out CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR** ppcpfd
     )
 {    
-    HRESULT hr = E_UNEXPECTED;
-
-    if (_pWrappedProvider != NULL)
+    HRESULT hr = _EnsureLayout();
+    if (SUCCEEDED(hr))
     {
-        if (ppcpfd != NULL)
-        {
-            // If this field maps to one in the wrapped provider, hand it off.
-            if (dwIndex < _dwWrappedDescriptorCount)
-            {
-                hr = _pWrappedProvider->GetFieldDescriptorAt(dwIndex, ppcpfd);
-            }
-            // Otherwise, check to see if it's ours and then handle it here.
-            else
-            {
-                // Offset into the descriptor count so we can index our own fields.
-                dwIndex -= _dwWrappedDescriptorCount;
-
-                // Verify dwIndex is still a valid field.
-                if (dwIndex < SFI_NUM_FIELDS)
-                {
-                    hr = FieldDescriptorCoAllocCopy(s_rgCredProvFieldDescriptors[dwIndex], ppcpfd);
-                    (*ppcpfd)->dwFieldID += _dwWrappedDescriptorCount;
-                }
-                else
-                { 
-                    hr = E_INVALIDARG;
-                }
-            }
-        }
-        else
-        { 
-            hr = E_INVALIDARG;
-        }
+        hr = _layout.GetAt(dwIndex, ppcpfd);
     }
 
     return hr;
@@ -222,107 +648,191 @@ HRESULT CSampleProvider::GetFieldDescriptorAt(
 // on the credential you've specified as the default and will submit that credential
 // for authentication without showing any further UI.
 // While we're here, we'll create credentials to wrap each of the credentials created by
-// our wrapped provider. The key is to make everything transparent to the owner.
+// our wrapped providers. The key is to make everything transparent to the owner.
+// The wrapped providers are all asked at once; our tiles are theirs, in the order the
+// providers are listed and then in the order each gave them.  One that hasn't answered
+// in time has no tiles this time round, and LogonUI hears our credentials have changed
+// when it does.  The default is the first provider's default that has one.
+// LogonUI calls this often and the wrapped providers usually hand back the same
+// credentials each time, so a wrapper is only built for a credential we haven't seen;
+// the ones we have keep their wrappers, and the wrappers of credentials that are gone
+// are released.
 HRESULT CSampleProvider::GetCredentialCount(
     __out DWORD* pdwCount,
     __out_range(<,*pdwCount) DWORD* pdwDefault,
     __out BOOL* pbAutoLogonWithDefault
     )
 {
-    HRESULT hr = E_UNEXPECTED;
-    DWORD dwDefault = 0;
+    HRESULT hr = S_OK;
+    DWORD dwDefault = CREDENTIAL_PROVIDER_NO_DEFAULT;
     BOOL bAutoLogonWithDefault = FALSE;
+    DWORD dwCredentialCount = 0;
+    CSampleCredential **rgpCredentials = NULL;
+
+    // If a wrapped provider has said its credentials changed since the descriptors were
+    // read, the wrapped providers read them again along with the count.  Those read with
+    // the usage scenario are still current, so the first count of a scenario doesn't.
+    const bool fReadFields = _layout.IsStale();
+    for (DWORD i = 0; i < _cWrapped; i++)
+    {
+        _rgpWrapped[i]->fReadFields = fReadFields;
+    }
 
-    // Make sure we've created the provider.
-    if (_pWrappedProvider != NULL)
+    const DWORD dwFinished = _RunJobs(_CountJob, true, false);
+    DWORD dwCounted = 0;
+    for (DWORD i = 0; i < _cWrapped; i++)
     {
-        // This probably shouldn't happen, but in the event that this gets called after
-        // we've already been through once, we want to clean up everything before 
-        // allocating new stuff all over again.
-        if (_rgpCredentials != NULL)
+        if ((dwFinished & (1 << i)) && _rgpWrapped[i]->fInScenario && SUCCEEDED(_rgpWrapped[i]->hrJob))
         {
-            _CleanUpAllCredentials();
+            dwCounted |= (1 << i);
+            dwCredentialCount += _rgpWrapped[i]->dwCount;
         }
+    }
 
-        // We need to know how many fields each credential has in order to initialize
-        // our wrapper credentials, so we might as well do that here before anything else.
-        DWORD count;
-        hr = GetFieldDescriptorCount(&(count));
+    // We need to know where each provider's fields are in order to initialize our
+    // wrapper credentials, so we might as well do that here before anything else.
+    hr = _EnsureLayout();
 
-        if (SUCCEEDED(hr))
+    if (SUCCEEDED(hr))
+    {
+        // The new list is built beside the old one, which stays as it was if we fail.
+        rgpCredentials = new CSampleCredential*[dwCredentialCount];
+        if (rgpCredentials != NULL)
+        {
+            ZeroMemory(rgpCredentials, dwCredentialCount * sizeof(*rgpCredentials));
+        }
+        else
         {
-            // Grab the credential count of the wrapped provider. We'll simply wrap each.
-            hr = _pWrappedProvider->GetCredentialCount(&(_dwCredentialCount), &(dwDefault), &(bAutoLogonWithDefault));
+            hr = E_OUTOFMEMORY;
+        }
+    }
 
-            if (SUCCEEDED(hr))
+    // Iterate each credential and find or make a wrapper.
+    DWORD dwIndex = 0;
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < _cWrapped); i++)
+    {
+        WRAPPED_PROVIDER *pwp = _rgpWrapped[i];
+        if (dwCounted & (1 << i))
+        {
+            const DWORD dwFirst = dwIndex;
+            HRESULT hrWrapped = S_OK;
+            for (DWORD lcv = 0; SUCCEEDED(hrWrapped) && (lcv < pwp->dwCount); lcv++)
             {
-                // Create an array of credentials for use.
-                _rgpCredentials = new CSampleCredential*[_dwCredentialCount];
-                if (_rgpCredentials != NULL)
+                ICredentialProviderCredential *pCredential;
+                hrWrapped = pwp->pProxy->GetCredentialAt(lcv, &(pCredential));
+                if (SUCCEEDED(hrWrapped))
                 {
-                    // Iterate each credential and make a wrapper.
-                    for (DWORD lcv = 0; SUCCEEDED(hr) && (lcv < _dwCredentialCount); lcv++)
+                    rgpCredentials[dwIndex] = _FindWrapper(pCredential, i, dwIndex);
+                    if (rgpCredentials[dwIndex] != NULL)
+                    {
+                        rgpCredentials[dwIndex]->AddRef();
+                    }
+                    else
                     {
                         // Allocate memory for the new credential.
-                        _rgpCredentials[lcv] = new CSampleCredential();
-                        if (_rgpCredentials[lcv] != NULL)
+                        rgpCredentials[dwIndex] = new CSampleCredential();
+                        if (rgpCredentials[dwIndex] != NULL)
                         {
-                            ICredentialProviderCredential *pCredential;
-                            hr = _pWrappedProvider->GetCredentialAt(lcv, &(pCredential));
-                            if (SUCCEEDED(hr))
-                            {
-                                // Set the Field State Pair and Field Descriptors for ppc's 
-                                // fields to the defaults (s_rgCredProvFieldDescriptors, 
-                                // and s_rgFieldStatePairs) and the value of SFI_USERNAME
-                                // to pwzUsername.
-                                hr = _rgpCredentials[lcv]->Initialize(s_rgCredProvFieldDescriptors, s_rgFieldStatePairs, pCredential, _dwWrappedDescriptorCount);
-                                if (FAILED(hr))
-                                {
-                                    // If initialization failed, clean everything up.
-                                    for (lcv = 0; lcv < _dwCredentialCount; lcv++)
-                                    {
-                                        if (_rgpCredentials[lcv] != NULL)
-                                        {
-                                            // Release the pointer to account for the local reference.
-                                            _rgpCredentials[lcv]->Release();
-                                            _rgpCredentials[lcv] = NULL;
-                                        }
-                                    }
-                                }
-                                pCredential->Release();
-                            } // (End if _pWrappedProvider->GetCredentialAt succeeded.)
-                        } // (End if allocating _rgpCredentials[lcv] succeeded.)
+                            // Set the Field State Pair and Field Descriptors for ppc's 
+                            // fields to the defaults (s_rgCredProvFieldDescriptors, 
+                            // and s_rgFieldStatePairs), and tell it where its
+                            // provider's fields are.
+                            hrWrapped = rgpCredentials[dwIndex]->Initialize(s_rgCredProvFieldDescriptors, s_rgFieldStatePairs, pCredential, _layout, i, _pDatabases);
+                        }
                         else
                         {
                             hr = E_OUTOFMEMORY;
-                        } 
-                    } // (End of _rgpCredentials allocation loop.)
-                } // (End if for allocating _rgpCredentials succeeded.)
-                else
+                            hrWrapped = hr;
+                        }
+                    }
+                    dwIndex++;
+                    pCredential->Release();
+                } // (End if GetCredentialAt succeeded.)
+            } // (End of this provider's credentials.)
+
+            if (SUCCEEDED(hrWrapped))
+            {
+                if ((dwDefault == CREDENTIAL_PROVIDER_NO_DEFAULT) && (pwp->dwDefault < pwp->dwCount))
                 {
-                    hr = E_OUTOFMEMORY;
+                    dwDefault = dwFirst + pwp->dwDefault;
+                    bAutoLogonWithDefault = pwp->bAutoLogonWithDefault;
                 }
-            } // (End if _pWrappedProvider->GetCredentialCount succeeded.)
-        } // (End if GetFieldDescriptorCount succeeded.)
+            }
+            else
+            {
+                // A provider that fails us loses its tiles, not everyone else's.
+                while (dwIndex > dwFirst)
+                {
+                    dwIndex--;
+                    if (rgpCredentials[dwIndex] != NULL)
+                    {
+                        rgpCredentials[dwIndex]->Release();
+                        rgpCredentials[dwIndex] = NULL;
+                    }
+                }
+            }
+        }
     }
 
-    if (FAILED(hr))
+    if (SUCCEEDED(hr))
+    {
+        // Releasing the old list frees the wrappers of the credentials that went away.
+        _CleanUpAllCredentials();
+        _rgpCredentials = rgpCredentials;
+        _dwCredentialCount = dwIndex;
+
+        *pdwCount = _dwCredentialCount;
+        *pdwDefault = dwDefault;
+        *pbAutoLogonWithDefault = bAutoLogonWithDefault;
+    }
+    else if (rgpCredentials != NULL)
     {
         // Clean up.
-        if (_rgpCredentials != NULL)
+        for (DWORD lcv = 0; lcv < dwCredentialCount; lcv++)
         {
-            delete _rgpCredentials;
-            _rgpCredentials = NULL;
+            if (rgpCredentials[lcv] != NULL)
+            {
+                rgpCredentials[lcv]->Release();
+            }
         }
+        delete [] rgpCredentials;
     }
-    else
+
+    return hr;
+}
+
+// Returns the wrapper from the last enumeration around pCredential, from the
+// iWrapped'th provider, or NULL if there is none.  Each wrapper holds a reference on
+// its credential, so a match can't be a new credential that took over a freed one's
+// address.  The wrapped providers mostly return their credentials in the same order, so
+// the wrapper at the same index is tried first.
+CSampleCredential* CSampleProvider::_FindWrapper(
+    __in ICredentialProviderCredential *pCredential, 
+    __in DWORD iWrapped,
+    __in DWORD dwIndex
+    )
+{
+    CSampleCredential *pWrapper = NULL;
+
+    if (_rgpCredentials != NULL)
     {
-        *pdwCount = _dwCredentialCount;
-        *pdwDefault = dwDefault;
-        *pbAutoLogonWithDefault = bAutoLogonWithDefault;
+        if ((dwIndex < _dwCredentialCount) && 
+            (_rgpCredentials[dwIndex] != NULL) &&
+            _rgpCredentials[dwIndex]->IsWrapping(pCredential, _layout, iWrapped))
+        {
+            pWrapper = _rgpCredentials[dwIndex];
+        }
+
+        for (DWORD lcv = 0; (pWrapper == NULL) && (lcv < _dwCredentialCount); lcv++)
+        {
+            if ((_rgpCredentials[lcv] != NULL) && _rgpCredentials[lcv]->IsWrapping(pCredential, _layout, iWrapped))
+            {
+                pWrapper = _rgpCredentials[lcv];
+            }
+        }
     }
 
-    return hr;
+    return pWrapper;
 }
 
 // Returns the credential at the index specified by dwIndex. This function is called by 
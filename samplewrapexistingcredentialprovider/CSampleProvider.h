@@ -14,8 +14,45 @@
 #include <strsafe.h>
 
 #include "CSampleCredential.h"
+#include "CFieldLayout.h"
+#include "CWrappedProviderEvents.h"
+#include "CProviderHost.h"
 #include "helpers.h"
 
+// One provider we wrap.  Each has a thread of its own, where it is created and called
+// for the slow work, so all of them can do it at once; LogonUI's thread reaches it
+// through a proxy for everything else.
+struct WRAPPED_PROVIDER
+{
+    CLSID                   clsid;
+    CProviderHost           host;
+    bool                    fHosted;            // False if it lives on LogonUI's thread instead.
+    bool                    fComInitialized;    // On the host thread.
+    HRESULT                 hrCreate;
+    ICredentialProvider     *pProvider;         // Only called on the thread it was created on.
+    IStream                 *pstmProvider;      // pProvider, marshaled for LogonUI's thread.
+    ICredentialProvider     *pProxy;            // What LogonUI's thread calls.
+    CWrappedProviderEvents  *pEvents;           // Passes its events on to LogonUI.
+    DWORD                   dwEventsCookie;     // pEvents in the global interface table.  The
+                                                // late job reads it on the host thread, so it's
+                                                // only read and set with interlocked calls.
+    UINT_PTR                upAdviseContext;
+
+    // Set by SetUsageScenario: whether its tiles are part of ours in this scenario.
+    bool                    fInScenario;
+
+    // The jobs' arguments and results, which belong to the host thread from Queue until
+    // it goes idle.
+    CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus;
+    DWORD                   dwFlags;
+    bool                    fReadFields;
+    HRESULT                 hrJob;
+    WRAPPED_FIELDS          wf;
+    DWORD                   dwCount;
+    DWORD                   dwDefault;
+    BOOL                    bAutoLogonWithDefault;
+};
+
 class CSampleProvider : public ICredentialProvider
 {
   public:
@@ -69,15 +106,30 @@ class CSampleProvider : public ICredentialProvider
     
   private:
       void _CleanUpAllCredentials();
+      HRESULT _CreateWrappedProviders();
+      void _ReleaseWrappedProviders();
+      void _ReleaseProviderEvents();
+      HRESULT _EnsureLayout();
+      DWORD _RunJobs(__in PFN_HOST_JOB pfnJob, __in bool fInScenarioOnly, __in bool fWaitForOne);
+      CSampleCredential* _FindWrapper(__in ICredentialProviderCredential *pCredential, __in DWORD iWrapped, __in DWORD dwIndex);
+
+      static void _AttachJob(__in void *pv);
+      static void _DetachJob(__in void *pv);
+      static void _LateJob(__in void *pv);
+      static void _ScenarioJob(__in void *pv);
+      static void _CountJob(__in void *pv);
     
 private:
     LONG                _cRef;
     CSampleCredential   **_rgpCredentials;          // Pointers to the credentials which will be enumerated by this 
                                                     // Provider.
 
-    ICredentialProvider *_pWrappedProvider;         // Our wrapped provider.
-    DWORD               _dwCredentialCount;         // The number of credentials provided by our wrapped provider.
-    DWORD               _dwWrappedDescriptorCount;  // The number of fields on each tile of our wrapped provider's 
-                                                    // credentials.
+    WRAPPED_PROVIDER    *_rgpWrapped[WRAPPED_PROVIDERS_MAX]; // Our wrapped providers, in the order their
+                                                    // tiles are shown.
+    DWORD               _cWrapped;
+    DWORD               _dwTimeout;                 // How long, in ms, we wait for them to answer.
+    DWORD               _dwCredentialCount;         // The number of credentials provided by our wrapped providers.
+    CFieldLayout        _layout;                    // The wrapped providers' field descriptors followed by ours.
+    CComboBoxSource     *_pDatabases;               // Our databases, if there's a file of them.
     bool                _bEnumeratedSetSerialization;
 };
@@ -25,7 +25,11 @@ HRESULT CWrappedCredentialEvents::SetFieldState(__in ICredentialProviderCredenti
 
     if (_pWrapperCredential && _pEvents)
     {
-        hr = _pEvents->SetFieldState(_pWrapperCredential, dwFieldID, cpfs);
+        hr = _Batch(FEK_STATE, dwFieldID, cpfs, NULL);
+        if (S_FALSE == hr)
+        {
+            hr = _pEvents->SetFieldState(_pWrapperCredential, dwFieldID + _dwFieldOffset, cpfs);
+        }
     }
 
     return hr;
@@ -39,7 +43,11 @@ HRESULT CWrappedCredentialEvents::SetFieldInteractiveState(__in ICredentialProvi
 
     if (_pWrapperCredential && _pEvents)
     {
-        hr = _pEvents->SetFieldInteractiveState(_pWrapperCredential, dwFieldID, cpfis);
+        hr = _Batch(FEK_INTERACTIVE_STATE, dwFieldID, cpfis, NULL);
+        if (S_FALSE == hr)
+        {
+            hr = _pEvents->SetFieldInteractiveState(_pWrapperCredential, dwFieldID + _dwFieldOffset, cpfis);
+        }
     }
 
     return hr;
@@ -53,7 +61,11 @@ HRESULT CWrappedCredentialEvents::SetFieldString(__in ICredentialProviderCredent
 
     if (_pWrapperCredential && _pEvents)
     {
-        hr = _pEvents->SetFieldString(_pWrapperCredential, dwFieldID, psz);
+        hr = _Batch(FEK_STRING, dwFieldID, 0, psz);
+        if (S_FALSE == hr)
+        {
+            hr = _pEvents->SetFieldString(_pWrapperCredential, dwFieldID + _dwFieldOffset, psz);
+        }
     }
 
     return hr;
@@ -67,7 +79,9 @@ HRESULT CWrappedCredentialEvents::SetFieldBitmap(__in ICredentialProviderCredent
 
     if (_pWrapperCredential && _pEvents)
     {
-        hr = _pEvents->SetFieldBitmap(_pWrapperCredential, dwFieldID, hbmp);
+        // LogonUI has to have the bitmap while its owner still does.
+        _Flush();
+        hr = _pEvents->SetFieldBitmap(_pWrapperCredential, dwFieldID + _dwFieldOffset, hbmp);
     }
 
     return hr;
@@ -81,7 +95,11 @@ HRESULT CWrappedCredentialEvents::SetFieldCheckbox(__in ICredentialProviderCrede
 
     if (_pWrapperCredential && _pEvents)
     {
-        hr = _pEvents->SetFieldCheckbox(_pWrapperCredential, dwFieldID, bChecked, pszLabel);
+        hr = _Batch(FEK_CHECKBOX, dwFieldID, bChecked, pszLabel);
+        if (S_FALSE == hr)
+        {
+            hr = _pEvents->SetFieldCheckbox(_pWrapperCredential, dwFieldID + _dwFieldOffset, bChecked, pszLabel);
+        }
     }
 
     return hr;
@@ -95,7 +113,11 @@ HRESULT CWrappedCredentialEvents::SetFieldComboBoxSelectedItem(__in ICredentialP
 
     if (_pWrapperCredential && _pEvents)
     {
-        hr = _pEvents->SetFieldComboBoxSelectedItem(_pWrapperCredential, dwFieldID, dwSelectedItem);
+        hr = _Batch(FEK_COMBOBOX_SELECTED_ITEM, dwFieldID, dwSelectedItem, NULL);
+        if (S_FALSE == hr)
+        {
+            hr = _pEvents->SetFieldComboBoxSelectedItem(_pWrapperCredential, dwFieldID + _dwFieldOffset, dwSelectedItem);
+        }
     }
 
     return hr;
@@ -109,7 +131,11 @@ HRESULT CWrappedCredentialEvents::DeleteFieldComboBoxItem(__in ICredentialProvid
 
     if (_pWrapperCredential && _pEvents)
     {
-        hr = _pEvents->DeleteFieldComboBoxItem(_pWrapperCredential, dwFieldID, dwItem);
+        hr = _Batch(FEK_COMBOBOX_DELETE_ITEM, dwFieldID, dwItem, NULL);
+        if (S_FALSE == hr)
+        {
+            hr = _pEvents->DeleteFieldComboBoxItem(_pWrapperCredential, dwFieldID + _dwFieldOffset, dwItem);
+        }
     }
 
     return hr;
@@ -123,7 +149,11 @@ HRESULT CWrappedCredentialEvents::AppendFieldComboBoxItem(__in ICredentialProvid
 
     if (_pWrapperCredential && _pEvents)
     {
-        hr = _pEvents->AppendFieldComboBoxItem(_pWrapperCredential, dwFieldID, pszItem);
+        hr = _Batch(FEK_COMBOBOX_APPEND_ITEM, dwFieldID, 0, pszItem);
+        if (S_FALSE == hr)
+        {
+            hr = _pEvents->AppendFieldComboBoxItem(_pWrapperCredential, dwFieldID + _dwFieldOffset, pszItem);
+        }
     }
 
     return hr;
@@ -137,7 +167,11 @@ HRESULT CWrappedCredentialEvents::SetFieldSubmitButton(__in ICredentialProviderC
 
     if (_pWrapperCredential && _pEvents)
     {
-        hr = _pEvents->SetFieldSubmitButton(_pWrapperCredential, dwFieldID, dwAdjacentTo);
+        hr = _Batch(FEK_SUBMIT_BUTTON, dwFieldID, dwAdjacentTo, NULL);
+        if (S_FALSE == hr)
+        {
+            hr = _pEvents->SetFieldSubmitButton(_pWrapperCredential, dwFieldID + _dwFieldOffset, dwAdjacentTo);
+        }
     }
 
     return hr;
@@ -149,16 +183,25 @@ HRESULT CWrappedCredentialEvents::OnCreatingWindow(__out HWND* phwndOwner)
 
     if (_pWrapperCredential && _pEvents)
     {
+        _Flush();
         hr = _pEvents->OnCreatingWindow(phwndOwner);
     }
 
     return hr;
 }
 
+CWrappedCredentialEvents* CWrappedCredentialEvents::s_pArmed = NULL;
+
 CWrappedCredentialEvents::CWrappedCredentialEvents() :
-    _cRef(1), _pWrapperCredential(NULL), _pEvents(NULL)
+    _cRef(1), _pWrapperCredential(NULL), _pEvents(NULL), _dwFieldOffset(0),
+    _cBatchDepth(0), _dwBatchStart(0), _idTimer(0), _pNextArmed(NULL), _fFlushing(false)
 {}
 
+CWrappedCredentialEvents::~CWrappedCredentialEvents()
+{
+    _DisarmDeadline();
+}
+
 // 
 // Save a copy of LogonUI's ICredentialProviderCredentialEvents pointer for doing callbacks
 // and the "this" pointer of the wrapper credential to specify events as coming from.
@@ -170,10 +213,14 @@ CWrappedCredentialEvents::CWrappedCredentialEvents() :
 // the lifetime of our weak references through calls to Initialize and Uninitialize to
 // prevent our weak references from becoming invalid.
 //
-void CWrappedCredentialEvents::Initialize(__in ICredentialProviderCredential* pWrapperCredential, __in ICredentialProviderCredentialEvents* pEvents)
+// The wrapped credential's field IDs become ours by adding dwFieldOffset, which is where
+// the wrapper's tile puts its fields.
+//
+void CWrappedCredentialEvents::Initialize(__in ICredentialProviderCredential* pWrapperCredential, __in ICredentialProviderCredentialEvents* pEvents, __in DWORD dwFieldOffset)
 {
     _pWrapperCredential = pWrapperCredential;
     _pEvents = pEvents;
+    _dwFieldOffset = dwFieldOffset;
 }
 
 //
@@ -182,6 +229,171 @@ void CWrappedCredentialEvents::Initialize(__in ICredentialProviderCredential* pW
 //
 void CWrappedCredentialEvents::Uninitialize()
 {
+    _DisarmDeadline();
+    _batch.Clear();
     _pWrapperCredential = NULL;
     _pEvents = NULL;
 }
+
+void CWrappedCredentialEvents::BeginBatch()
+{
+    _cBatchDepth++;
+}
+
+void CWrappedCredentialEvents::EndBatch()
+{
+    if ((_cBatchDepth > 0) && (--_cBatchDepth == 0))
+    {
+        _Flush();
+    }
+}
+
+//
+// Returns S_FALSE if the event should be passed on now: we aren't batching, or we are
+// flushing and LogonUI's handling of an event led the wrapped credential to raise
+// another.  Anything already batched goes first if this one can't be.
+//
+HRESULT CWrappedCredentialEvents::_Batch(__in DWORD fek, __in DWORD dwFieldID, __in DWORD dwValue, __in_opt PCWSTR pwsz)
+{
+    HRESULT hr = S_FALSE;
+
+    if ((_cBatchDepth > 0) && !_fFlushing)
+    {
+        hr = _batch.Add(fek, dwFieldID, dwValue, pwsz);
+        if (S_FALSE == hr)
+        {
+            _Flush();
+            hr = _batch.Add(fek, dwFieldID, dwValue, pwsz);
+        }
+
+        if (S_OK == hr)
+        {
+            if (_batch.GetCount() == 1)
+            {
+                _dwBatchStart = GetTickCount();
+                _ArmDeadline();
+            }
+            else if (GetTickCount() - _dwBatchStart >= FIELD_EVENT_BATCH_DEADLINE_MS)
+            {
+                _Flush();
+            }
+        }
+        else
+        {
+            _Flush();
+            hr = S_FALSE;
+        }
+    }
+
+    return hr;
+}
+
+void CWrappedCredentialEvents::_Flush()
+{
+    // LogonUI's handling of an event can lead back here; the outer flush carries on.
+    if (!_fFlushing)
+    {
+        _fFlushing = true;
+        for (DWORD i = 0; _pWrapperCredential && _pEvents && (i < _batch.GetCount()); i++)
+        {
+            const FIELD_EVENT& event = _batch.GetAt(i);
+            const DWORD dwFieldID = event.dwFieldID + _dwFieldOffset;
+            switch (event.fek)
+            {
+            case FEK_STATE:
+                _pEvents->SetFieldState(_pWrapperCredential, dwFieldID, (CREDENTIAL_PROVIDER_FIELD_STATE)event.dwValue);
+                break;
+
+            case FEK_INTERACTIVE_STATE:
+                _pEvents->SetFieldInteractiveState(_pWrapperCredential, dwFieldID, (CREDENTIAL_PROVIDER_FIELD_INTERACTIVE_STATE)event.dwValue);
+                break;
+
+            case FEK_STRING:
+                _pEvents->SetFieldString(_pWrapperCredential, dwFieldID, event.pwsz);
+                break;
+
+            case FEK_CHECKBOX:
+                _pEvents->SetFieldCheckbox(_pWrapperCredential, dwFieldID, (BOOL)event.dwValue, event.pwsz);
+                break;
+
+            case FEK_COMBOBOX_SELECTED_ITEM:
+                _pEvents->SetFieldComboBoxSelectedItem(_pWrapperCredential, dwFieldID, event.dwValue);
+                break;
+
+            case FEK_COMBOBOX_DELETE_ITEM:
+                _pEvents->DeleteFieldComboBoxItem(_pWrapperCredential, dwFieldID, event.dwValue);
+                break;
+
+            case FEK_COMBOBOX_APPEND_ITEM:
+                _pEvents->AppendFieldComboBoxItem(_pWrapperCredential, dwFieldID, event.pwsz);
+                break;
+
+            case FEK_SUBMIT_BUTTON:
+                _pEvents->SetFieldSubmitButton(_pWrapperCredential, dwFieldID, event.dwValue);
+                break;
+            }
+        }
+        _batch.Clear();
+        _DisarmDeadline();
+        _fFlushing = false;
+    }
+}
+
+//
+// The timer fires only while LogonUI's thread pumps messages, which it does while a wrapped
+// credential shows a window, say, but not while it computes.  The next event raised checks
+// the deadline too, so a call that's busy but still raising events is covered either way.
+//
+void CWrappedCredentialEvents::_ArmDeadline()
+{
+    if (0 == _idTimer)
+    {
+        _idTimer = SetTimer(NULL, 0, FIELD_EVENT_BATCH_DEADLINE_MS, _DeadlineProc);
+        if (_idTimer != 0)
+        {
+            _pNextArmed = s_pArmed;
+            s_pArmed = this;
+        }
+    }
+}
+
+void CWrappedCredentialEvents::_DisarmDeadline()
+{
+    if (_idTimer != 0)
+    {
+        KillTimer(NULL, _idTimer);
+        _idTimer = 0;
+
+        CWrappedCredentialEvents** ppArmed = &s_pArmed;
+        while (*ppArmed != this)
+        {
+            ppArmed = &(*ppArmed)->_pNextArmed;
+        }
+        *ppArmed = _pNextArmed;
+        _pNextArmed = NULL;
+    }
+}
+
+// A thread timer has no window to say whose it is, so we look it up.
+void CALLBACK CWrappedCredentialEvents::_DeadlineProc(__in HWND hwnd, __in UINT uMsg, __in UINT_PTR idEvent, __in DWORD dwTime)
+{
+    UNREFERENCED_PARAMETER(hwnd);
+    UNREFERENCED_PARAMETER(uMsg);
+    UNREFERENCED_PARAMETER(dwTime);
+
+    CWrappedCredentialEvents* pArmed = s_pArmed;
+    while ((pArmed != NULL) && (pArmed->_idTimer != idEvent))
+    {
+        pArmed = pArmed->_pNextArmed;
+    }
+
+    if (pArmed != NULL)
+    {
+        // A flush already under way, which this interrupted, disarms the timer when it's done.
+        pArmed->_Flush();
+    }
+    else
+    {
+        KillTimer(NULL, idEvent);
+    }
+}
@@ -11,7 +11,15 @@
 // but a credential provider that wraps another (as this sample does) must.
 // The wrapped credential will pass its "this" pointer into any calls to ICPCE,
 // but LogonUI will not recognize the wrapped "this" pointer as a valid credential.
-// Our implementation translates from the wrapped "this" pointer to the wrapper "this".
+// Our implementation translates from the wrapped "this" pointer to the wrapper "this",
+// and from the wrapped credential's field IDs to the wrapper's.
+//
+// While the wrapper credential is calling into the wrapped one, between BeginBatch and
+// EndBatch, the field events it raises are collected rather than passed on, and go to
+// LogonUI, with repeats for the same field collapsed, when the call returns.  A call
+// that runs long has what it raised so far passed on once FIELD_EVENT_BATCH_DEADLINE_MS
+// has gone by since the first of it: by a thread timer if the call leaves LogonUI's
+// thread pumping messages, as a message box does, or else by the next event raised.
 
 #pragma once
 
@@ -21,6 +29,10 @@
 #include "helpers.h"
 #include "dll.h"
 #include "resource.h"
+#include "CFieldEventBatch.h"
+
+// The longest an event waits in a batch while LogonUI's thread pumps messages.
+#define FIELD_EVENT_BATCH_DEADLINE_MS   50
 
 class CWrappedCredentialEvents : public ICredentialProviderCredentialEvents
 {
@@ -65,12 +77,34 @@ public:
 
     // Local
     CWrappedCredentialEvents();
+    ~CWrappedCredentialEvents();
 
-    void Initialize(__in ICredentialProviderCredential* pWrapperCredential, __in ICredentialProviderCredentialEvents* pEvents);
+    void Initialize(__in ICredentialProviderCredential* pWrapperCredential, __in ICredentialProviderCredentialEvents* pEvents, __in DWORD dwFieldOffset);
     void Uninitialize();
 
+    // Batches nest; the events go out when the outermost one ends.
+    void BeginBatch();
+    void EndBatch();
+
+private:
+    HRESULT _Batch(__in DWORD fek, __in DWORD dwFieldID, __in DWORD dwValue, __in_opt PCWSTR pwsz);
+    void _Flush();
+    void _ArmDeadline();
+    void _DisarmDeadline();
+    static void CALLBACK _DeadlineProc(__in HWND hwnd, __in UINT uMsg, __in UINT_PTR idEvent, __in DWORD dwTime);
+
 private:
     LONG                                 _cRef;
     ICredentialProviderCredential*       _pWrapperCredential;
     ICredentialProviderCredentialEvents* _pEvents;
+    DWORD                                _dwFieldOffset;
+    CFieldEventBatch                     _batch;
+    DWORD                                _cBatchDepth;
+    DWORD                                _dwBatchStart;  // When the first event in the batch came.
+    UINT_PTR                             _idTimer;       // The deadline's thread timer, or 0.
+    CWrappedCredentialEvents*            _pNextArmed;    // The next in s_pArmed.
+    bool                                 _fFlushing;
+
+    // Those with a deadline timer running.  Timers and events are all on LogonUI's thread.
+    static CWrappedCredentialEvents*     s_pArmed;
 };
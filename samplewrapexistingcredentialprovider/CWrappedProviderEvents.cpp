@@ -0,0 +1,64 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+
+#include <unknwn.h>
+
+#include "CWrappedProviderEvents.h"
+
+CWrappedProviderEvents::CWrappedProviderEvents() :
+    _cRef(1), _pLayout(NULL), _pEvents(NULL)
+{
+    DllAddRef();
+}
+
+CWrappedProviderEvents::~CWrappedProviderEvents()
+{
+    Uninitialize();
+    DllRelease();
+}
+
+// The wrapped provider may call this from any thread, so all we do with the layout is
+// mark it stale; the provider rebuilds it the next time LogonUI asks for a descriptor
+// or for its credentials.
+HRESULT CWrappedProviderEvents::CredentialsChanged(__in UINT_PTR upAdviseContext)
+{
+    HRESULT hr = E_FAIL;
+
+    if (_pLayout && _pEvents)
+    {
+        _pLayout->Invalidate();
+        hr = _pEvents->CredentialsChanged(upAdviseContext);
+    }
+
+    return hr;
+}
+
+//
+// The layout is a weak reference: it belongs to the provider, which calls Uninitialize
+// in UnAdvise and before it goes away.  LogonUI's ICredentialProviderEvents is held
+// with a reference, since the wrapped provider may keep us past UnAdvise.
+//
+void CWrappedProviderEvents::Initialize(__in CFieldLayout* pLayout, __in ICredentialProviderEvents* pEvents)
+{
+    Uninitialize();
+
+    _pLayout = pLayout;
+    _pEvents = pEvents;
+    _pEvents->AddRef();
+}
+
+void CWrappedProviderEvents::Uninitialize()
+{
+    _pLayout = NULL;
+    if (_pEvents != NULL)
+    {
+        _pEvents->Release();
+        _pEvents = NULL;
+    }
+}
@@ -0,0 +1,67 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// CWrappedProviderEvents is our implementation of ICredentialProviderEvents (ICPE).
+// We hand it to the wrapped provider in place of LogonUI's, so that when the wrapped
+// provider says its credentials have changed we can throw away the field layout we
+// cached from it before passing the news on to LogonUI.
+
+#pragma once
+
+#include <windows.h>
+#include <credentialprovider.h>
+#include "helpers.h"
+#include "dll.h"
+#include "CFieldLayout.h"
+
+class CWrappedProviderEvents : public ICredentialProviderEvents
+{
+public:
+    // IUnknown
+    IFACEMETHODIMP_(ULONG) AddRef()
+    {
+        return InterlockedIncrement(&_cRef);
+    }
+
+    IFACEMETHODIMP_(ULONG) Release()
+    {
+        LONG cRef = InterlockedDecrement(&_cRef);
+        if (!cRef)
+        {
+            delete this;
+        }
+        return cRef;
+    }
+
+    IFACEMETHODIMP QueryInterface(__in REFIID riid, __in void** ppv)
+    {
+        static const QITAB qit[] =
+        {
+            QITABENT(CWrappedProviderEvents, ICredentialProviderEvents), // IID_ICredentialProviderEvents
+            {0},
+        };
+        return QISearch(this, qit, riid, ppv);
+    }
+
+    // ICredentialProviderEvents
+    IFACEMETHODIMP CredentialsChanged(__in UINT_PTR upAdviseContext);
+
+    // Local
+    CWrappedProviderEvents();
+
+    void Initialize(__in CFieldLayout* pLayout, __in ICredentialProviderEvents* pEvents);
+    void Uninitialize();
+
+private:
+    ~CWrappedProviderEvents();
+
+private:
+    LONG                        _cRef;
+    CFieldLayout*               _pLayout;
+    ICredentialProviderEvents*  _pEvents;
+};
@@ -19,6 +19,16 @@
 
 #define MAX_ULONG  ((ULONG)(-1))
 
+// The providers we wrap are listed, by CLSID, in this REG_MULTI_SZ under our
+// registration key; the password provider is wrapped if there's no list.
+// How long, in milliseconds, we wait for all of them to answer a call made
+// to each at once is in the REG_DWORD below it.
+#define WRAPPED_PROVIDERS_KEY           L"SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Authentication\\Credential Providers\\{ACFC407B-266C-4085-8DAE-F3E276336E4B}"
+#define WRAPPED_PROVIDERS_VALUE         L"WrappedProviders"
+#define WRAPPED_PROVIDERS_TIMEOUT_VALUE L"WrappedProviderTimeout"
+#define WRAPPED_PROVIDERS_TIMEOUT       2000
+#define WRAPPED_PROVIDERS_MAX           8
+
 // The indexes of each of the fields in our credential provider's appended tiles.
 enum SAMPLE_FIELD_ID 
 {
@@ -58,6 +68,10 @@ static const CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR s_rgCredProvFieldDescriptors[]
     { SFI_DATABASE_COMBOBOX, CPFT_COMBOBOX, L"Database" },
 };
 
+// A file of databases, one per line in UTF-16, can stand in for the list below;
+// its path is in this REG_SZ under our registration key.
+#define DATABASES_VALUE                 L"DatabaseItems"
+
 // Our database of departments. Perfectly normalized.
 static const PWSTR s_rgDatabases[] =
 {
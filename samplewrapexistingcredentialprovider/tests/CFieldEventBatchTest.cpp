@@ -0,0 +1,408 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Plays recorded bursts of field events, the ones wrapped credentials raise
+// from SetSelected, ReportResult and the like, through CFieldEventBatch the
+// way CWrappedCredentialEvents batches and flushes them, into a mock events
+// sink that keeps each field as LogonUI would.  The fields must end up
+// exactly as they do when every event is passed straight on, and the test
+// counts the calls that reach the sink each way.  Random bursts, with
+// combobox items added and removed, more events than the batch holds and
+// strings that change, then check the same on many more events.  Prints a
+// line per check and returns nonzero if any failed.
+
+#include "CFieldEventBatch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FIELDS_MAX          16
+#define ITEMS_MAX           64
+#define VALUE_CCH_MAX       32
+#define RANDOM_BURSTS       100000
+#define RANDOM_BURST_MAX    (2 * FIELD_EVENT_BATCH_MAX)
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, const char* pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static DWORD s_dwRandom = 0x2545F491;
+
+static DWORD NextRandom()
+{
+    s_dwRandom ^= s_dwRandom << 13;
+    s_dwRandom ^= s_dwRandom >> 17;
+    s_dwRandom ^= s_dwRandom << 5;
+    return s_dwRandom;
+}
+
+// What LogonUI knows about a field.
+struct MOCK_FIELD
+{
+    DWORD   dwState;
+    DWORD   dwInteractiveState;
+    WCHAR   wszString[VALUE_CCH_MAX];
+    DWORD   fChecked;
+    WCHAR   wszCheckboxLabel[VALUE_CCH_MAX];
+    WCHAR   rgwszItem[ITEMS_MAX][VALUE_CCH_MAX];
+    DWORD   cItems;
+    DWORD   dwSelectedItem;
+    DWORD   dwSubmitNextTo;
+};
+
+// Stands in for ICredentialProviderCredentialEvents: applies each call to
+// its fields and counts them.
+class CMockEventsSink
+{
+  public:
+    CMockEventsSink()
+    {
+        memset(_rgField, 0, sizeof(_rgField));
+        cCalls = 0;
+        cBadItems = 0;
+    }
+
+    void Apply(DWORD fek, DWORD dwFieldID, DWORD dwValue, PCWSTR pwsz)
+    {
+        MOCK_FIELD* pField = &_rgField[dwFieldID];
+        cCalls++;
+        switch (fek)
+        {
+        case FEK_STATE:
+            pField->dwState = dwValue;
+            break;
+
+        case FEK_INTERACTIVE_STATE:
+            pField->dwInteractiveState = dwValue;
+            break;
+
+        case FEK_STRING:
+            wcsncpy(pField->wszString, pwsz, VALUE_CCH_MAX - 1);
+            break;
+
+        case FEK_CHECKBOX:
+            pField->fChecked = dwValue;
+            wcsncpy(pField->wszCheckboxLabel, pwsz, VALUE_CCH_MAX - 1);
+            break;
+
+        case FEK_COMBOBOX_SELECTED_ITEM:
+            pField->dwSelectedItem = dwValue;
+            break;
+
+        case FEK_COMBOBOX_DELETE_ITEM:
+            if (dwValue < pField->cItems)
+            {
+                memmove(pField->rgwszItem[dwValue], pField->rgwszItem[dwValue + 1],
+                        (pField->cItems - dwValue - 1) * sizeof(pField->rgwszItem[0]));
+                pField->cItems--;
+            }
+            else
+            {
+                cBadItems++;
+            }
+            break;
+
+        case FEK_COMBOBOX_APPEND_ITEM:
+            if (pField->cItems < ITEMS_MAX)
+            {
+                memset(pField->rgwszItem[pField->cItems], 0, sizeof(pField->rgwszItem[0]));
+                wcsncpy(pField->rgwszItem[pField->cItems++], pwsz, VALUE_CCH_MAX - 1);
+            }
+            else
+            {
+                cBadItems++;
+            }
+            break;
+
+        case FEK_SUBMIT_BUTTON:
+            pField->dwSubmitNextTo = dwValue;
+            break;
+        }
+    }
+
+    bool IsSameAs(const CMockEventsSink& other) const
+    {
+        return 0 == memcmp(_rgField, other._rgField, sizeof(_rgField));
+    }
+
+    DWORD GetItemCount(DWORD dwFieldID) const
+    {
+        return _rgField[dwFieldID].cItems;
+    }
+
+  private:
+    MOCK_FIELD  _rgField[FIELDS_MAX];
+
+  public:
+    DWORD       cCalls;
+    DWORD       cBadItems;      // Items deleted that weren't there, or appended past the end.
+};
+
+// CWrappedCredentialEvents' side: batch while in a call, and flush when it
+// returns or the batch is full.
+class CMockForwarder
+{
+  public:
+    CMockForwarder(CMockEventsSink* pSink) :
+        _pSink(pSink),
+        cFlushes(0)
+    {
+    }
+
+    void Raise(DWORD fek, DWORD dwFieldID, DWORD dwValue, PCWSTR pwsz)
+    {
+        HRESULT hr = _batch.Add(fek, dwFieldID, dwValue, pwsz);
+        if (S_FALSE == hr)
+        {
+            Flush();
+            hr = _batch.Add(fek, dwFieldID, dwValue, pwsz);
+        }
+        if (S_OK != hr)
+        {
+            Flush();
+            _pSink->Apply(fek, dwFieldID, dwValue, pwsz);
+        }
+    }
+
+    void Flush()
+    {
+        for (DWORD i = 0; i < _batch.GetCount(); i++)
+        {
+            const FIELD_EVENT& event = _batch.GetAt(i);
+            _pSink->Apply(event.fek, event.dwFieldID, event.dwValue, event.pwsz);
+        }
+        _batch.Clear();
+        cFlushes++;
+    }
+
+  private:
+    CMockEventsSink*    _pSink;
+    CFieldEventBatch    _batch;
+
+  public:
+    DWORD               cFlushes;
+};
+
+struct TRACE_EVENT
+{
+    DWORD   fek;
+    DWORD   dwFieldID;
+    DWORD   dwValue;
+    PCWSTR  pwsz;
+};
+
+// Field IDs as the password provider numbers them.
+enum
+{
+    FID_TILEIMAGE = 0, FID_USERNAME, FID_PASSWORD, FID_SUBMIT, FID_MESSAGE, FID_DOMAIN, FID_DATABASE
+};
+
+#define CPFS_HIDDEN             0
+#define CPFS_DISPLAY_IN_SELECTED_TILE   1
+#define CPFS_DISPLAY_IN_BOTH    3
+#define CPFIS_NONE              0
+#define CPFIS_READONLY          1
+#define CPFIS_DISABLED          2
+#define CPFIS_FOCUSED           3
+
+// ReportResult after a wrong password: clear it, show the message, focus.
+static const TRACE_EVENT s_rgReportResult[] =
+{
+    { FEK_STRING,               FID_PASSWORD,   0,                              L"" },
+    { FEK_INTERACTIVE_STATE,    FID_PASSWORD,   CPFIS_NONE,                     NULL },
+    { FEK_STATE,                FID_MESSAGE,    CPFS_HIDDEN,                    NULL },
+    { FEK_STRING,               FID_MESSAGE,    0,                              L"" },
+    { FEK_STRING,               FID_MESSAGE,    0,                              L"The password is incorrect." },
+    { FEK_STATE,                FID_MESSAGE,    CPFS_DISPLAY_IN_SELECTED_TILE,  NULL },
+    { FEK_INTERACTIVE_STATE,    FID_USERNAME,   CPFIS_NONE,                     NULL },
+    { FEK_INTERACTIVE_STATE,    FID_PASSWORD,   CPFIS_FOCUSED,                  NULL },
+    { FEK_SUBMIT_BUTTON,        FID_SUBMIT,     FID_PASSWORD,                   NULL },
+};
+
+// SetSelected: show the selected tile's fields, one at a time.
+static const TRACE_EVENT s_rgSetSelected[] =
+{
+    { FEK_STATE,                FID_USERNAME,   CPFS_HIDDEN,                    NULL },
+    { FEK_STATE,                FID_PASSWORD,   CPFS_HIDDEN,                    NULL },
+    { FEK_STATE,                FID_DOMAIN,     CPFS_HIDDEN,                    NULL },
+    { FEK_STRING,               FID_USERNAME,   0,                              L"" },
+    { FEK_STRING,               FID_USERNAME,   0,                              L"contoso\\kiosk" },
+    { FEK_STATE,                FID_USERNAME,   CPFS_DISPLAY_IN_SELECTED_TILE,  NULL },
+    { FEK_STATE,                FID_PASSWORD,   CPFS_DISPLAY_IN_SELECTED_TILE,  NULL },
+    { FEK_INTERACTIVE_STATE,    FID_USERNAME,   CPFIS_READONLY,                 NULL },
+    { FEK_INTERACTIVE_STATE,    FID_PASSWORD,   CPFIS_FOCUSED,                  NULL },
+    { FEK_STATE,                FID_DOMAIN,     CPFS_DISPLAY_IN_SELECTED_TILE,  NULL },
+    { FEK_STRING,               FID_DOMAIN,     0,                              L"Sign in to: CONTOSO" },
+};
+
+// Refilling a combobox: select nothing, delete the items, append new ones, select one.
+static const TRACE_EVENT s_rgRefillComboBox[] =
+{
+    { FEK_COMBOBOX_APPEND_ITEM, FID_DATABASE,   0,                              L"Personnel" },
+    { FEK_COMBOBOX_APPEND_ITEM, FID_DATABASE,   0,                              L"Payroll" },
+    { FEK_COMBOBOX_APPEND_ITEM, FID_DATABASE,   0,                              L"Finance" },
+    { FEK_COMBOBOX_SELECTED_ITEM, FID_DATABASE, 1,                              NULL },
+    { FEK_COMBOBOX_SELECTED_ITEM, FID_DATABASE, (DWORD)-1,                      NULL },
+    { FEK_COMBOBOX_DELETE_ITEM, FID_DATABASE,   2,                              NULL },
+    { FEK_COMBOBOX_DELETE_ITEM, FID_DATABASE,   1,                              NULL },
+    { FEK_COMBOBOX_DELETE_ITEM, FID_DATABASE,   0,                              NULL },
+    { FEK_COMBOBOX_APPEND_ITEM, FID_DATABASE,   0,                              L"Sales" },
+    { FEK_COMBOBOX_APPEND_ITEM, FID_DATABASE,   0,                              L"Support" },
+    { FEK_COMBOBOX_SELECTED_ITEM, FID_DATABASE, 0,                              NULL },
+    { FEK_COMBOBOX_SELECTED_ITEM, FID_DATABASE, 1,                              NULL },
+    { FEK_STATE,                FID_DATABASE,   CPFS_DISPLAY_IN_BOTH,           NULL },
+};
+
+// A smart card reader polling: the message flickers between two strings.
+static const TRACE_EVENT s_rgStatusFlicker[] =
+{
+    { FEK_STRING,               FID_MESSAGE,    0,                              L"Reading card..." },
+    { FEK_STRING,               FID_MESSAGE,    0,                              L"Insert a card" },
+    { FEK_STRING,               FID_MESSAGE,    0,                              L"Reading card..." },
+    { FEK_STRING,               FID_MESSAGE,    0,                              L"Insert a card" },
+    { FEK_STRING,               FID_MESSAGE,    0,                              L"Reading card..." },
+    { FEK_STRING,               FID_MESSAGE,    0,                              L"Card read" },
+    { FEK_CHECKBOX,             FID_DOMAIN,     0,                              L"Remember me" },
+    { FEK_CHECKBOX,             FID_DOMAIN,     1,                              L"Remember me" },
+    { FEK_INTERACTIVE_STATE,    FID_PASSWORD,   CPFIS_DISABLED,                 NULL },
+    { FEK_INTERACTIVE_STATE,    FID_PASSWORD,   CPFIS_FOCUSED,                  NULL },
+};
+
+// Plays a trace once straight through and once batched, and compares.
+static void CheckTrace(const char* pszName, const TRACE_EVENT* rgEvent, DWORD cEvents, DWORD* pcStraight, DWORD* pcBatched)
+{
+    CMockEventsSink sinkStraight;
+    CMockEventsSink sinkBatched;
+    CMockForwarder forwarder(&sinkBatched);
+    for (DWORD i = 0; i < cEvents; i++)
+    {
+        sinkStraight.Apply(rgEvent[i].fek, rgEvent[i].dwFieldID, rgEvent[i].dwValue, rgEvent[i].pwsz);
+        forwarder.Raise(rgEvent[i].fek, rgEvent[i].dwFieldID, rgEvent[i].dwValue, rgEvent[i].pwsz);
+    }
+    forwarder.Flush();
+
+    printf("      %s: %u calls straight through, %u batched\n", pszName, sinkStraight.cCalls, sinkBatched.cCalls);
+    char szWhat[128];
+    snprintf(szWhat, sizeof(szWhat), "%s: batched leaves the fields as passing every event on does", pszName);
+    Check(sinkBatched.IsSameAs(sinkStraight) && (0 == sinkBatched.cBadItems), szWhat);
+    *pcStraight += sinkStraight.cCalls;
+    *pcBatched += sinkBatched.cCalls;
+}
+
+static void CheckTraces()
+{
+    DWORD cStraight = 0;
+    DWORD cBatched = 0;
+    CheckTrace("ReportResult", s_rgReportResult, sizeof(s_rgReportResult) / sizeof(s_rgReportResult[0]), &cStraight, &cBatched);
+    CheckTrace("SetSelected", s_rgSetSelected, sizeof(s_rgSetSelected) / sizeof(s_rgSetSelected[0]), &cStraight, &cBatched);
+    CheckTrace("combobox refill", s_rgRefillComboBox, sizeof(s_rgRefillComboBox) / sizeof(s_rgRefillComboBox[0]), &cStraight, &cBatched);
+    CheckTrace("status flicker", s_rgStatusFlicker, sizeof(s_rgStatusFlicker) / sizeof(s_rgStatusFlicker[0]), &cStraight, &cBatched);
+    printf("      all traces: %u calls forwarded instead of %u (%.0f%% fewer)\n",
+           cBatched, cStraight, 100.0 * (cStraight - cBatched) / cStraight);
+    Check(cBatched < cStraight, "traces: batching forwards fewer calls");
+}
+
+// Many random bursts, some longer than the batch holds.
+static void CheckRandom()
+{
+    static const PCWSTR s_rgpwsz[] = { L"", L"a", L"contoso", L"kiosk", L"Payroll", L"The password is incorrect." };
+    CMockEventsSink sinkStraight;
+    CMockEventsSink sinkBatched;
+    CMockForwarder forwarder(&sinkBatched);
+    bool fSame = true;
+    DWORD cEvents = 0;
+
+    for (DWORD iBurst = 0; iBurst < RANDOM_BURSTS; iBurst++)
+    {
+        const DWORD cBurst = 1 + NextRandom() % RANDOM_BURST_MAX;
+        for (DWORD i = 0; i < cBurst; i++)
+        {
+            // A few fields, so events collide often.
+            const DWORD dwFieldID = NextRandom() % 6;
+            DWORD fek = NextRandom() % (FEK_SUBMIT_BUTTON + 1);
+            DWORD dwValue = NextRandom() % 4;
+            PCWSTR pwsz = s_rgpwsz[NextRandom() % (sizeof(s_rgpwsz) / sizeof(s_rgpwsz[0]))];
+
+            // Only delete items that are there and append where there is room,
+            // as a credential would.
+            const DWORD cItems = sinkStraight.GetItemCount(dwFieldID);
+            if (FEK_COMBOBOX_DELETE_ITEM == fek)
+            {
+                if (0 == cItems)
+                {
+                    fek = FEK_COMBOBOX_APPEND_ITEM;
+                }
+                else
+                {
+                    dwValue = NextRandom() % cItems;
+                }
+            }
+            if ((FEK_COMBOBOX_APPEND_ITEM == fek) && (cItems == ITEMS_MAX))
+            {
+                fek = FEK_COMBOBOX_DELETE_ITEM;
+                dwValue = 0;
+            }
+            if ((FEK_STRING != fek) && (FEK_CHECKBOX != fek) && (FEK_COMBOBOX_APPEND_ITEM != fek))
+            {
+                pwsz = NULL;
+            }
+
+            sinkStraight.Apply(fek, dwFieldID, dwValue, pwsz);
+            forwarder.Raise(fek, dwFieldID, dwValue, pwsz);
+            cEvents++;
+        }
+        forwarder.Flush();
+        fSame = fSame && sinkBatched.IsSameAs(sinkStraight);
+    }
+
+    printf("      random: %u events in %u bursts, %u calls forwarded, %u flushes\n",
+           cEvents, RANDOM_BURSTS, sinkBatched.cCalls, forwarder.cFlushes);
+    Check(fSame && (0 == sinkBatched.cBadItems) && (0 == sinkStraight.cBadItems),
+          "random: batched leaves the fields as passing every event on does, after every burst");
+    Check(forwarder.cFlushes > RANDOM_BURSTS, "random: bursts longer than the batch flush to make room");
+}
+
+static void CheckBatch()
+{
+    CFieldEventBatch batch;
+    batch.Add(FEK_STRING, 1, 0, L"one");
+    batch.Add(FEK_STATE, 2, 1, NULL);
+    batch.Add(FEK_STRING, 1, 0, L"two");
+    Check((2 == batch.GetCount()) && (FEK_STRING == batch.GetAt(0).fek) && (0 == wcscmp(L"two", batch.GetAt(0).pwsz)),
+          "batch: a later event replaces an earlier one and keeps its place");
+
+    batch.Clear();
+    batch.Add(FEK_COMBOBOX_SELECTED_ITEM, 3, 1, NULL);
+    batch.Add(FEK_COMBOBOX_DELETE_ITEM, 3, 0, NULL);
+    batch.Add(FEK_COMBOBOX_SELECTED_ITEM, 3, 0, NULL);
+    Check(3 == batch.GetCount(), "batch: a selection after an item change doesn't replace one before it");
+
+    batch.Clear();
+    HRESULT hr = S_OK;
+    for (DWORD i = 0; (S_OK == hr) && (i <= FIELD_EVENT_BATCH_MAX); i++)
+    {
+        hr = batch.Add(FEK_STATE, i, 0, NULL);
+    }
+    Check((S_FALSE == hr) && (FIELD_EVENT_BATCH_MAX == batch.GetCount()), "batch: a full batch asks to be flushed");
+    Check(S_OK == batch.Add(FEK_STATE, 0, 1, NULL), "batch: a full batch still folds an event into an earlier one");
+}
+
+int main()
+{
+    CheckBatch();
+    CheckTraces();
+    CheckRandom();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
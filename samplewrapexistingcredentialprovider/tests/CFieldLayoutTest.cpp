@@ -0,0 +1,605 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// Counts the calls the sample makes into a wrapped provider for each usage
+// scenario, before and after CFieldLayout.  A mock wrapped provider counts
+// GetFieldDescriptorCount, GetFieldDescriptorAt and GetCredentialCount and
+// has different fields in each scenario.  LogonUI's side is played twice:
+// once against the old forwarding code, and once against the cached path,
+// which reads descriptors with ReadWrapped, merges them with Build and hears
+// of changes through CWrappedProviderEvents, as CSampleProvider does without
+// its host threads.  LogonUI must see the same descriptors either way,
+// including new ones after the wrapped provider raises CredentialsChanged.
+// Prints a line per check and the calls each way, and returns nonzero if any
+// check failed.
+
+#include <windows.h>
+#include <stdio.h>
+#include "CFieldLayout.h"
+#include "CWrappedProviderEvents.h"
+
+// The number of fields the wrapped provider has in each scenario, before it
+// raises CredentialsChanged and adds one.
+struct TEST_SCENARIO
+{
+    CREDENTIAL_PROVIDER_USAGE_SCENARIO  cpus;
+    PCSTR                               pszName;
+    DWORD                               cFields;
+};
+
+static const TEST_SCENARIO c_rgScenarios[] =
+{
+    { CPUS_LOGON,               "logon",            5 },
+    { CPUS_UNLOCK_WORKSTATION,  "unlock",           3 },
+    { CPUS_CHANGE_PASSWORD,     "change password",  7 },
+    { CPUS_CREDUI,              "credui",           4 },
+};
+
+// How often LogonUI reads the descriptors and the tile count once a scenario
+// is set up, and how many times the wrapped provider's credentials change.
+#define DESCRIPTOR_PASSES   3
+#define COUNT_CALLS         4
+#define CHANGES             2
+#define WRAPPED_FIELDS_MAX  16
+#define LABEL_CCH           32
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, PCSTR pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+// CWrappedProviderEvents holds a reference on the module; here the test is
+// the module.
+void DllAddRef()
+{
+}
+
+void DllRelease()
+{
+}
+
+// The calls a wrapped provider sees that depend on how we cache its fields.
+struct CALL_COUNTS
+{
+    DWORD   cGetFieldDescriptorCount;
+    DWORD   cGetFieldDescriptorAt;
+    DWORD   cGetCredentialCount;
+
+    DWORD Total() const
+    {
+        return cGetFieldDescriptorCount + cGetFieldDescriptorAt + cGetCredentialCount;
+    }
+};
+
+// Counts CredentialsChanged as LogonUI would receive it.
+class CLogonUIEvents : public ICredentialProviderEvents
+{
+  public:
+    CLogonUIEvents() : _cChanged(0)
+    {
+    }
+
+    IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv)
+    {
+        UNREFERENCED_PARAMETER(riid);
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+
+    IFACEMETHODIMP_(ULONG) AddRef()
+    {
+        return 2;
+    }
+
+    IFACEMETHODIMP_(ULONG) Release()
+    {
+        return 1;
+    }
+
+    IFACEMETHODIMP CredentialsChanged(UINT_PTR upAdviseContext)
+    {
+        UNREFERENCED_PARAMETER(upAdviseContext);
+        _cChanged++;
+        return S_OK;
+    }
+
+    DWORD   _cChanged;
+};
+
+// A wrapped provider with a number of fields per scenario, counting the calls
+// it gets.  AddField adds a field and tells whoever it was advised of.
+class CCountingProvider : public ICredentialProvider
+{
+  public:
+    CCountingProvider() : _cFields(0), _pEvents(NULL), _upAdviseContext(0)
+    {
+        ZeroMemory(&_counts, sizeof(_counts));
+    }
+
+    IFACEMETHODIMP QueryInterface(__in REFIID riid, __deref_out void** ppv)
+    {
+        UNREFERENCED_PARAMETER(riid);
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+
+    IFACEMETHODIMP_(ULONG) AddRef()
+    {
+        return 2;
+    }
+
+    IFACEMETHODIMP_(ULONG) Release()
+    {
+        return 1;
+    }
+
+    IFACEMETHODIMP SetUsageScenario(CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus, DWORD dwFlags)
+    {
+        UNREFERENCED_PARAMETER(dwFlags);
+        _cFields = 0;
+        for (DWORD i = 0; i < ARRAYSIZE(c_rgScenarios); i++)
+        {
+            if (c_rgScenarios[i].cpus == cpus)
+            {
+                _cFields = c_rgScenarios[i].cFields;
+            }
+        }
+        return (_cFields > 0) ? S_OK : E_NOTIMPL;
+    }
+
+    IFACEMETHODIMP SetSerialization(const CREDENTIAL_PROVIDER_CREDENTIAL_SERIALIZATION* pcpcs)
+    {
+        UNREFERENCED_PARAMETER(pcpcs);
+        return E_NOTIMPL;
+    }
+
+    IFACEMETHODIMP Advise(ICredentialProviderEvents* pcpe, UINT_PTR upAdviseContext)
+    {
+        _pEvents = pcpe;
+        _upAdviseContext = upAdviseContext;
+        return S_OK;
+    }
+
+    IFACEMETHODIMP UnAdvise()
+    {
+        _pEvents = NULL;
+        return S_OK;
+    }
+
+    IFACEMETHODIMP GetFieldDescriptorCount(DWORD* pdwCount)
+    {
+        _counts.cGetFieldDescriptorCount++;
+        *pdwCount = _cFields;
+        return S_OK;
+    }
+
+    IFACEMETHODIMP GetFieldDescriptorAt(DWORD dwIndex, CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR** ppcpfd)
+    {
+        _counts.cGetFieldDescriptorAt++;
+        if (dwIndex >= _cFields)
+        {
+            return E_INVALIDARG;
+        }
+
+        WCHAR wszLabel[LABEL_CCH];
+        StringCchPrintfW(wszLabel, ARRAYSIZE(wszLabel), L"Wrapped %u of %u", dwIndex, _cFields);
+        CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR cpfd = { dwIndex, (dwIndex % 2) ? CPFT_EDIT_TEXT : CPFT_LARGE_TEXT, wszLabel };
+        return FieldDescriptorCoAllocCopy(cpfd, ppcpfd);
+    }
+
+    IFACEMETHODIMP GetCredentialCount(DWORD* pdwCount, DWORD* pdwDefault, BOOL* pbAutoLogonWithDefault)
+    {
+        _counts.cGetCredentialCount++;
+        *pdwCount = 1;
+        *pdwDefault = CREDENTIAL_PROVIDER_NO_DEFAULT;
+        *pbAutoLogonWithDefault = FALSE;
+        return S_OK;
+    }
+
+    IFACEMETHODIMP GetCredentialAt(DWORD dwIndex, ICredentialProviderCredential** ppcpc)
+    {
+        UNREFERENCED_PARAMETER(dwIndex);
+        *ppcpc = NULL;
+        return E_NOTIMPL;
+    }
+
+    void AddField()
+    {
+        _cFields++;
+        if (_pEvents != NULL)
+        {
+            _pEvents->CredentialsChanged(_upAdviseContext);
+        }
+    }
+
+    CALL_COUNTS                 _counts;
+    DWORD                       _cFields;
+    ICredentialProviderEvents*  _pEvents;
+    UINT_PTR                    _upAdviseContext;
+};
+
+// The calls CSampleProvider makes into the wrapped provider, one way or the other.
+class CProviderModel
+{
+  public:
+    virtual ~CProviderModel()
+    {
+    }
+
+    virtual HRESULT SetUsageScenario(__in CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus) = 0;
+    virtual HRESULT Advise(__in ICredentialProviderEvents* pcpe) = 0;
+    virtual void UnAdvise() = 0;
+    virtual HRESULT GetFieldDescriptorCount(__out DWORD* pdwCount) = 0;
+    virtual HRESULT GetFieldDescriptorAt(__in DWORD dwIndex, __deref_out CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR** ppcpfd) = 0;
+    virtual HRESULT GetCredentialCount(__out DWORD* pdwCount) = 0;
+};
+
+// What the sample did before CFieldLayout: every call is passed on, and our
+// own descriptors are copied with their field IDs moved each time.
+class CForwardingModel : public CProviderModel
+{
+  public:
+    CForwardingModel(__in ICredentialProvider* pWrapped) : _pWrapped(pWrapped), _dwWrappedDescriptorCount(0)
+    {
+    }
+
+    HRESULT SetUsageScenario(__in CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus)
+    {
+        return _pWrapped->SetUsageScenario(cpus, 0);
+    }
+
+    HRESULT Advise(__in ICredentialProviderEvents* pcpe)
+    {
+        return _pWrapped->Advise(pcpe, 0);
+    }
+
+    void UnAdvise()
+    {
+        _pWrapped->UnAdvise();
+    }
+
+    HRESULT GetFieldDescriptorCount(__out DWORD* pdwCount)
+    {
+        HRESULT hr = _pWrapped->GetFieldDescriptorCount(&_dwWrappedDescriptorCount);
+        if (SUCCEEDED(hr))
+        {
+            *pdwCount = _dwWrappedDescriptorCount + SFI_NUM_FIELDS;
+        }
+        return hr;
+    }
+
+    HRESULT GetFieldDescriptorAt(__in DWORD dwIndex, __deref_out CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR** ppcpfd)
+    {
+        HRESULT hr = E_INVALIDARG;
+        if (dwIndex < _dwWrappedDescriptorCount)
+        {
+            hr = _pWrapped->GetFieldDescriptorAt(dwIndex, ppcpfd);
+        }
+        else if (dwIndex - _dwWrappedDescriptorCount < SFI_NUM_FIELDS)
+        {
+            hr = FieldDescriptorCoAllocCopy(s_rgCredProvFieldDescriptors[dwIndex - _dwWrappedDescriptorCount], ppcpfd);
+            if (SUCCEEDED(hr))
+            {
+                (*ppcpfd)->dwFieldID += _dwWrappedDescriptorCount;
+            }
+        }
+        return hr;
+    }
+
+    HRESULT GetCredentialCount(__out DWORD* pdwCount)
+    {
+        DWORD dwDefault;
+        BOOL bAutoLogonWithDefault;
+        return _pWrapped->GetCredentialCount(pdwCount, &dwDefault, &bAutoLogonWithDefault);
+    }
+
+  private:
+    ICredentialProvider*    _pWrapped;
+    DWORD                   _dwWrappedDescriptorCount;
+};
+
+// What the sample does now, for one wrapped provider: _ScenarioJob reads the
+// descriptors along with SetUsageScenario, _CountJob reads them again with
+// the tile count if the layout has gone stale, and _EnsureLayout builds the
+// layout from the last ones read.
+class CCachedModel : public CProviderModel
+{
+  public:
+    CCachedModel(__in ICredentialProvider* pWrapped) : _pWrapped(pWrapped), _pEvents(NULL)
+    {
+        _wf.rgpcpfd = NULL;
+        _wf.cFields = 0;
+    }
+
+    ~CCachedModel()
+    {
+        UnAdvise();
+        CFieldLayout::FreeWrapped(&_wf);
+    }
+
+    HRESULT SetUsageScenario(__in CREDENTIAL_PROVIDER_USAGE_SCENARIO cpus)
+    {
+        _layout.Clear();
+        CFieldLayout::FreeWrapped(&_wf);
+        HRESULT hr = _pWrapped->SetUsageScenario(cpus, 0);
+        if (SUCCEEDED(hr))
+        {
+            hr = CFieldLayout::ReadWrapped(_pWrapped, &_wf);
+        }
+        return hr;
+    }
+
+    HRESULT Advise(__in ICredentialProviderEvents* pcpe)
+    {
+        UnAdvise();
+        _pEvents = new CWrappedProviderEvents();
+        _pEvents->Initialize(&_layout, pcpe);
+        return _pWrapped->Advise(_pEvents, 0);
+    }
+
+    void UnAdvise()
+    {
+        if (_pEvents != NULL)
+        {
+            _pWrapped->UnAdvise();
+            _pEvents->Uninitialize();
+            _pEvents->Release();
+            _pEvents = NULL;
+        }
+    }
+
+    HRESULT GetFieldDescriptorCount(__out DWORD* pdwCount)
+    {
+        HRESULT hr = _EnsureLayout();
+        if (SUCCEEDED(hr))
+        {
+            *pdwCount = _layout.GetCount();
+        }
+        return hr;
+    }
+
+    HRESULT GetFieldDescriptorAt(__in DWORD dwIndex, __deref_out CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR** ppcpfd)
+    {
+        HRESULT hr = _EnsureLayout();
+        if (SUCCEEDED(hr))
+        {
+            hr = _layout.GetAt(dwIndex, ppcpfd);
+        }
+        return hr;
+    }
+
+    HRESULT GetCredentialCount(__out DWORD* pdwCount)
+    {
+        const bool fReadFields = _layout.IsStale();
+
+        DWORD dwDefault;
+        BOOL bAutoLogonWithDefault;
+        HRESULT hr = _pWrapped->GetCredentialCount(pdwCount, &dwDefault, &bAutoLogonWithDefault);
+        if (SUCCEEDED(hr) && fReadFields)
+        {
+            CFieldLayout::FreeWrapped(&_wf);
+            hr = CFieldLayout::ReadWrapped(_pWrapped, &_wf);
+        }
+        if (SUCCEEDED(hr))
+        {
+            hr = _EnsureLayout();
+        }
+        return hr;
+    }
+
+  private:
+    HRESULT _EnsureLayout()
+    {
+        HRESULT hr = S_OK;
+        if (!_layout.IsValid())
+        {
+            hr = _layout.Build(&_wf, 1, s_rgCredProvFieldDescriptors, SFI_NUM_FIELDS);
+        }
+        return hr;
+    }
+
+    ICredentialProvider*        _pWrapped;
+    CWrappedProviderEvents*     _pEvents;
+    WRAPPED_FIELDS              _wf;
+    CFieldLayout                _layout;
+};
+
+// The descriptors LogonUI was last given, to compare one model with the other.
+struct SEEN_FIELDS
+{
+    DWORD   cFields;
+    DWORD   rgdwFieldID[WRAPPED_FIELDS_MAX + SFI_NUM_FIELDS];
+    DWORD   rgcpft[WRAPPED_FIELDS_MAX + SFI_NUM_FIELDS];
+    WCHAR   rgwszLabel[WRAPPED_FIELDS_MAX + SFI_NUM_FIELDS][LABEL_CCH];
+};
+
+// One pass of LogonUI over the descriptors.
+static HRESULT ReadDescriptors(__in CProviderModel* pModel, __out SEEN_FIELDS* pSeen)
+{
+    ZeroMemory(pSeen, sizeof(*pSeen));
+    HRESULT hr = pModel->GetFieldDescriptorCount(&pSeen->cFields);
+    if (SUCCEEDED(hr) && (pSeen->cFields > ARRAYSIZE(pSeen->rgdwFieldID)))
+    {
+        hr = E_UNEXPECTED;
+    }
+    for (DWORD i = 0; SUCCEEDED(hr) && (i < pSeen->cFields); i++)
+    {
+        CREDENTIAL_PROVIDER_FIELD_DESCRIPTOR* pcpfd;
+        hr = pModel->GetFieldDescriptorAt(i, &pcpfd);
+        if (SUCCEEDED(hr))
+        {
+            pSeen->rgdwFieldID[i] = pcpfd->dwFieldID;
+            pSeen->rgcpft[i] = pcpfd->cpft;
+            StringCchCopyW(pSeen->rgwszLabel[i], LABEL_CCH, pcpfd->pszLabel);
+            CoTaskMemFree(pcpfd->pszLabel);
+            CoTaskMemFree(pcpfd);
+        }
+    }
+    return hr;
+}
+
+static bool SameFields(__in const SEEN_FIELDS* pA, __in const SEEN_FIELDS* pB)
+{
+    bool fSame = (pA->cFields == pB->cFields);
+    for (DWORD i = 0; fSame && (i < pA->cFields); i++)
+    {
+        fSame = (pA->rgdwFieldID[i] == pB->rgdwFieldID[i]) && (pA->rgdwFieldID[i] == i) &&
+                (pA->rgcpft[i] == pB->rgcpft[i]) && (0 == wcscmp(pA->rgwszLabel[i], pB->rgwszLabel[i]));
+    }
+    return fSame;
+}
+
+// LogonUI's calls for one scenario: descriptor passes and tile counts once it
+// is set up, then again after each CredentialsChanged.  The calls into the
+// wrapped provider are counted separately for setting up, SetUsageScenario
+// included, and for each change.
+struct SCENARIO_RESULT
+{
+    CALL_COUNTS     setup;
+    CALL_COUNTS     rgChange[CHANGES];
+    SEEN_FIELDS     rgSeen[1 + CHANGES];
+    DWORD           cChanged;
+    bool            fOk;
+};
+
+static CALL_COUNTS Since(__in const CALL_COUNTS& now, __in const CALL_COUNTS& start)
+{
+    CALL_COUNTS counts;
+    counts.cGetFieldDescriptorCount = now.cGetFieldDescriptorCount - start.cGetFieldDescriptorCount;
+    counts.cGetFieldDescriptorAt = now.cGetFieldDescriptorAt - start.cGetFieldDescriptorAt;
+    counts.cGetCredentialCount = now.cGetCredentialCount - start.cGetCredentialCount;
+    return counts;
+}
+
+static void PlayLogonUI(__in CProviderModel* pModel, __in CCountingProvider* pWrapped, __in const TEST_SCENARIO* pScenario, __out SCENARIO_RESULT* pResult)
+{
+    CLogonUIEvents events;
+    ZeroMemory(pResult, sizeof(*pResult));
+    CALL_COUNTS start = pWrapped->_counts;
+    pResult->fOk = SUCCEEDED(pModel->SetUsageScenario(pScenario->cpus)) && SUCCEEDED(pModel->Advise(&events));
+
+    for (DWORD iRound = 0; pResult->fOk && (iRound <= CHANGES); iRound++)
+    {
+        if (iRound > 0)
+        {
+            start = pWrapped->_counts;
+            pWrapped->AddField();
+        }
+
+        for (DWORD i = 0; pResult->fOk && (i < COUNT_CALLS); i++)
+        {
+            DWORD dwCount;
+            pResult->fOk = SUCCEEDED(pModel->GetCredentialCount(&dwCount)) && (1 == dwCount);
+        }
+        for (DWORD i = 0; pResult->fOk && (i < DESCRIPTOR_PASSES); i++)
+        {
+            pResult->fOk = SUCCEEDED(ReadDescriptors(pModel, &pResult->rgSeen[iRound]));
+        }
+
+        if (0 == iRound)
+        {
+            pResult->setup = Since(pWrapped->_counts, start);
+        }
+        else
+        {
+            pResult->rgChange[iRound - 1] = Since(pWrapped->_counts, start);
+        }
+    }
+
+    pModel->UnAdvise();
+    pResult->cChanged = events._cChanged;
+}
+
+static void PrintCounts(__in PCSTR pszWhen, __in const CALL_COUNTS& before, __in const CALL_COUNTS& after)
+{
+    printf("        %-22s before %3u (count %u, at %2u, tiles %u)   after %3u (count %u, at %2u, tiles %u)\n",
+           pszWhen,
+           before.Total(), before.cGetFieldDescriptorCount, before.cGetFieldDescriptorAt, before.cGetCredentialCount,
+           after.Total(), after.cGetFieldDescriptorCount, after.cGetFieldDescriptorAt, after.cGetCredentialCount);
+}
+
+int main()
+{
+    char szWhat[128];
+
+    printf("      calls into the wrapped provider, with %u descriptor passes and %u tile counts from LogonUI each time\n",
+           DESCRIPTOR_PASSES, COUNT_CALLS);
+
+    // One wrapped provider and one sample across every scenario, as LogonUI
+    // keeps them, so the layout of one scenario must not leak into the next.
+    CCountingProvider wrappedBefore;
+    CCountingProvider wrappedAfter;
+    CForwardingModel before(&wrappedBefore);
+    CCachedModel* pAfter = new CCachedModel(&wrappedAfter);
+    for (DWORD iScenario = 0; iScenario < ARRAYSIZE(c_rgScenarios); iScenario++)
+    {
+        const TEST_SCENARIO* pScenario = &c_rgScenarios[iScenario];
+        SCENARIO_RESULT resultBefore;
+        SCENARIO_RESULT resultAfter;
+        PlayLogonUI(&before, &wrappedBefore, pScenario, &resultBefore);
+        PlayLogonUI(pAfter, &wrappedAfter, pScenario, &resultAfter);
+
+        printf("      %s, %u wrapped fields:\n", pScenario->pszName, pScenario->cFields);
+        PrintCounts("set up", resultBefore.setup, resultAfter.setup);
+        for (DWORD i = 0; i < CHANGES; i++)
+        {
+            char szWhen[32];
+            sprintf(szWhen, "CredentialsChanged %u", i + 1);
+            PrintCounts(szWhen, resultBefore.rgChange[i], resultAfter.rgChange[i]);
+        }
+
+        bool fSame = resultBefore.fOk && resultAfter.fOk;
+        for (DWORD i = 0; fSame && (i <= CHANGES); i++)
+        {
+            fSame = SameFields(&resultBefore.rgSeen[i], &resultAfter.rgSeen[i]) &&
+                    (resultAfter.rgSeen[i].cFields == pScenario->cFields + i + SFI_NUM_FIELDS);
+        }
+        sprintf(szWhat, "%s: LogonUI sees the same descriptors either way, new fields included", pScenario->pszName);
+        Check(fSame, szWhat);
+
+        sprintf(szWhat, "%s: CredentialsChanged still reaches LogonUI", pScenario->pszName);
+        Check((CHANGES == resultBefore.cChanged) && (CHANGES == resultAfter.cChanged), szWhat);
+
+        // The descriptors are read once along with SetUsageScenario, however
+        // often LogonUI asks, and once more after each change.
+        bool fOnce = (1 == resultAfter.setup.cGetFieldDescriptorCount) && (pScenario->cFields == resultAfter.setup.cGetFieldDescriptorAt);
+        for (DWORD i = 0; i < CHANGES; i++)
+        {
+            fOnce = fOnce && (1 == resultAfter.rgChange[i].cGetFieldDescriptorCount) &&
+                    (pScenario->cFields + i + 1 == resultAfter.rgChange[i].cGetFieldDescriptorAt);
+        }
+        sprintf(szWhat, "%s: descriptors are read once per scenario and once per change", pScenario->pszName);
+        Check(fOnce, szWhat);
+
+        sprintf(szWhat, "%s: fewer calls into the wrapped provider than before", pScenario->pszName);
+        Check(resultAfter.setup.Total() < resultBefore.setup.Total(), szWhat);
+    }
+
+    printf("      all scenarios: before %u calls, after %u\n", wrappedBefore._counts.Total(), wrappedAfter._counts.Total());
+
+    // The events object outlives the layout's owner if the wrapped provider
+    // keeps it, and must not touch the layout once it has been let go of.
+    CLogonUIEvents events;
+    pAfter->SetUsageScenario(CPUS_LOGON);
+    pAfter->Advise(&events);
+    ICredentialProviderEvents* pKept = wrappedAfter._pEvents;
+    pKept->AddRef();
+    pAfter->UnAdvise();
+    delete pAfter;
+    Check(E_FAIL == pKept->CredentialsChanged(0), "CredentialsChanged after UnAdvise goes nowhere");
+    pKept->Release();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
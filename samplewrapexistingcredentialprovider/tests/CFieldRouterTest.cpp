@@ -0,0 +1,376 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Checks CFieldRouter against a mock inner credential, the way
+// CSampleCredential::GetFieldState uses it.  With one wrapped provider every
+// field ID must route as the old range check and offset did; with several,
+// each tile must hand its provider's fields to the inner credential under
+// that provider's IDs, hide the others' and never pass on an ID the inner
+// credential doesn't have.  A wrapper wrapping a wrapper must reach the
+// innermost field with one lookup a level.  Initialize must refuse layouts
+// that don't add up.  Then it times a field call through the table, through
+// the old range check, and through two and three levels of wrappers.  Prints
+// a line per check and returns nonzero if any failed.
+
+#include "CFieldRouter.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define OWN_FIELDS          10          // As SFI_NUM_FIELDS.
+#define DISPATCH_CALLS      20000000
+#define STATE_WRAPPED       1000        // A mock's state for its field n is STATE_WRAPPED + n.
+#define STATE_LOCAL         2000        // A wrapper's state for its own field n is STATE_LOCAL + n.
+#define STATE_HIDDEN        3000
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, const char* pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static double NowSeconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Stands in for ICredentialProviderCredential: a virtual call per field.
+class CMockCredential
+{
+  public:
+    virtual ~CMockCredential()
+    {
+    }
+
+    virtual HRESULT GetFieldState(DWORD dwFieldID, DWORD* pdwState) = 0;
+};
+
+// The wrapped provider's credential.  Counts IDs it was never given.
+class CMockInnerCredential : public CMockCredential
+{
+  public:
+    CMockInnerCredential(DWORD cFields) :
+        _cFields(cFields),
+        cCalls(0),
+        cForeign(0)
+    {
+    }
+
+    HRESULT GetFieldState(DWORD dwFieldID, DWORD* pdwState)
+    {
+        cCalls++;
+        if (dwFieldID >= _cFields)
+        {
+            cForeign++;
+            return E_INVALIDARG;
+        }
+        *pdwState = STATE_WRAPPED + dwFieldID;
+        return S_OK;
+    }
+
+  private:
+    DWORD   _cFields;
+
+  public:
+    DWORD   cCalls;
+    DWORD   cForeign;
+};
+
+// CSampleCredential::GetFieldState, with the table.
+class CRoutedWrapper : public CMockCredential
+{
+  public:
+    CRoutedWrapper(CMockCredential* pInner) :
+        _pInner(pInner)
+    {
+    }
+
+    HRESULT Initialize(const DWORD* rgdwType, DWORD cFields, DWORD dwWrappedFirst, DWORD cWrapped, DWORD dwLocalFirst)
+    {
+        return _router.Initialize(rgdwType, cFields, dwWrappedFirst, cWrapped, dwLocalFirst);
+    }
+
+    HRESULT GetFieldState(DWORD dwFieldID, DWORD* pdwState)
+    {
+        const FIELD_ROUTE& route = _router.Lookup(dwFieldID);
+        if (FRT_WRAPPED == route.frt)
+        {
+            return _pInner->GetFieldState(route.dwID, pdwState);
+        }
+        else if (FRT_LOCAL == route.frt)
+        {
+            *pdwState = STATE_LOCAL + route.dwID;
+            return S_OK;
+        }
+        else if (FRT_HIDDEN == route.frt)
+        {
+            *pdwState = STATE_HIDDEN;
+            return S_OK;
+        }
+        return E_INVALIDARG;
+    }
+
+  private:
+    CMockCredential*    _pInner;
+    CFieldRouter        _router;
+};
+
+// CSampleCredential::GetFieldState as it was, with _IsFieldInWrappedCredential
+// and _LookupLocalFieldStatePair.  It only knew one wrapped provider.
+class COffsetWrapper : public CMockCredential
+{
+  public:
+    COffsetWrapper(CMockCredential* pInner, DWORD dwWrappedDescriptorCount) :
+        _pInner(pInner),
+        _dwWrappedDescriptorCount(dwWrappedDescriptorCount)
+    {
+    }
+
+    HRESULT GetFieldState(DWORD dwFieldID, DWORD* pdwState)
+    {
+        if (dwFieldID < _dwWrappedDescriptorCount)
+        {
+            return _pInner->GetFieldState(dwFieldID, pdwState);
+        }
+        dwFieldID -= _dwWrappedDescriptorCount;
+        if (dwFieldID < OWN_FIELDS)
+        {
+            *pdwState = STATE_LOCAL + dwFieldID;
+            return S_OK;
+        }
+        return E_INVALIDARG;
+    }
+
+  private:
+    CMockCredential*    _pInner;
+    DWORD               _dwWrappedDescriptorCount;
+};
+
+static DWORD s_rgdwType[FIELD_ROUTER_FIELDS_MAX + 1];
+
+// One wrapped provider ahead of our fields: the old layout.
+static void CheckSingle()
+{
+    bool fSame = true;
+    bool fNoForeign = true;
+    for (DWORD cWrapped = 0; cWrapped <= 32; cWrapped++)
+    {
+        CMockInnerCredential inner(cWrapped);
+        CRoutedWrapper routed(&inner);
+        COffsetWrapper offset(&inner, cWrapped);
+        if (FAILED(routed.Initialize(s_rgdwType, cWrapped + OWN_FIELDS, 0, cWrapped, cWrapped)))
+        {
+            fSame = false;
+            continue;
+        }
+
+        for (DWORD dwFieldID = 0; dwFieldID < FIELD_ROUTER_FIELDS_MAX + 8; dwFieldID++)
+        {
+            DWORD dwRouted = 0;
+            DWORD dwOffset = 0;
+            const HRESULT hrRouted = routed.GetFieldState(dwFieldID, &dwRouted);
+            const HRESULT hrOffset = offset.GetFieldState(dwFieldID, &dwOffset);
+            if ((hrRouted != hrOffset) || (SUCCEEDED(hrRouted) && (dwRouted != dwOffset)))
+            {
+                fSame = false;
+            }
+        }
+        fNoForeign = fNoForeign && (0 == inner.cForeign);
+    }
+    Check(fSame, "one wrapped provider: every field ID routes as the range check and offset did");
+    Check(fNoForeign, "one wrapped provider: the inner credential only sees its own IDs");
+}
+
+// Three wrapped providers' fields, then ours, as CFieldLayout lays them out.
+static void CheckSeveral()
+{
+    static const DWORD rgcWrapped[] = { 5, 0, 9 };
+    DWORD rgdwFirst[3];
+    DWORD cFields = 0;
+    for (DWORD i = 0; i < 3; i++)
+    {
+        rgdwFirst[i] = cFields;
+        cFields += rgcWrapped[i];
+    }
+    const DWORD dwLocalFirst = cFields;
+    cFields += OWN_FIELDS;
+
+    bool fRight = true;
+    bool fNoForeign = true;
+    for (DWORD iWrapped = 0; iWrapped < 3; iWrapped++)
+    {
+        CMockInnerCredential inner(rgcWrapped[iWrapped]);
+        CRoutedWrapper routed(&inner);
+        fRight = fRight && SUCCEEDED(routed.Initialize(s_rgdwType, cFields, rgdwFirst[iWrapped], rgcWrapped[iWrapped], dwLocalFirst));
+
+        for (DWORD dwFieldID = 0; dwFieldID < cFields + 8; dwFieldID++)
+        {
+            DWORD dwExpected;
+            HRESULT hrExpected = S_OK;
+            if ((dwFieldID >= rgdwFirst[iWrapped]) && (dwFieldID < rgdwFirst[iWrapped] + rgcWrapped[iWrapped]))
+            {
+                dwExpected = STATE_WRAPPED + dwFieldID - rgdwFirst[iWrapped];
+            }
+            else if (dwFieldID < dwLocalFirst)
+            {
+                dwExpected = STATE_HIDDEN;
+            }
+            else if (dwFieldID < cFields)
+            {
+                dwExpected = STATE_LOCAL + dwFieldID - dwLocalFirst;
+            }
+            else
+            {
+                hrExpected = E_INVALIDARG;
+            }
+
+            DWORD dwState = 0;
+            const HRESULT hr = routed.GetFieldState(dwFieldID, &dwState);
+            if ((hr != hrExpected) || (SUCCEEDED(hr) && (dwState != dwExpected)))
+            {
+                fRight = false;
+            }
+        }
+        fNoForeign = fNoForeign && (0 == inner.cForeign) && (inner.cCalls == rgcWrapped[iWrapped]);
+    }
+    Check(fRight, "several wrapped providers: own fields pass through, others' are hidden, the rest refused");
+    Check(fNoForeign, "several wrapped providers: each inner credential is called once per field it has");
+}
+
+// A wrapper around a wrapper around the inner credential, each adding its own fields.
+static void CheckNested()
+{
+    const DWORD cInner = 7;
+    CMockInnerCredential inner(cInner);
+    CRoutedWrapper middle(&inner);
+    CRoutedWrapper outer(&middle);
+    bool fRight = SUCCEEDED(middle.Initialize(s_rgdwType, cInner + OWN_FIELDS, 0, cInner, cInner)) &&
+                  SUCCEEDED(outer.Initialize(s_rgdwType, cInner + 2 * OWN_FIELDS, 0, cInner + OWN_FIELDS, cInner + OWN_FIELDS));
+
+    for (DWORD dwFieldID = 0; dwFieldID < cInner + 2 * OWN_FIELDS + 4; dwFieldID++)
+    {
+        DWORD dwExpected = 0;
+        HRESULT hrExpected = S_OK;
+        if (dwFieldID < cInner)
+        {
+            dwExpected = STATE_WRAPPED + dwFieldID;
+        }
+        else if (dwFieldID < cInner + 2 * OWN_FIELDS)
+        {
+            // The middle wrapper's fields, then the outer's, both numbered from 0.
+            dwExpected = STATE_LOCAL + (dwFieldID - cInner) % OWN_FIELDS;
+        }
+        else
+        {
+            hrExpected = E_INVALIDARG;
+        }
+
+        DWORD dwState = 0;
+        const DWORD cCalls = inner.cCalls;
+        const HRESULT hr = outer.GetFieldState(dwFieldID, &dwState);
+        if ((hr != hrExpected) || (SUCCEEDED(hr) && (dwState != dwExpected)) ||
+            ((dwFieldID < cInner) != (inner.cCalls == cCalls + 1)))
+        {
+            fRight = false;
+        }
+    }
+    Check(fRight && (0 == inner.cForeign), "nested wrappers: each level resolves its fields in one lookup");
+}
+
+static void CheckLimits()
+{
+    CFieldRouter router;
+    Check(E_INVALIDARG == router.Initialize(s_rgdwType, FIELD_ROUTER_FIELDS_MAX + 1, 0, 0, 0),
+          "limits: more fields than the table holds are refused");
+    Check(E_INVALIDARG == router.Initialize(s_rgdwType, 10, 6, 0, 5),
+          "limits: wrapped fields after our own are refused");
+    Check(E_INVALIDARG == router.Initialize(s_rgdwType, 10, 2, 4, 5),
+          "limits: wrapped fields running into our own are refused");
+    Check(E_INVALIDARG == router.Initialize(s_rgdwType, 10, 0, 0, 11),
+          "limits: our fields past the end are refused");
+
+    const bool fFull = SUCCEEDED(router.Initialize(s_rgdwType, FIELD_ROUTER_FIELDS_MAX, 0, 100, 100));
+    Check(fFull && (FRT_WRAPPED == router.Lookup(99).frt) && (99 == router.Lookup(99).dwID) &&
+          (FRT_LOCAL == router.Lookup(FIELD_ROUTER_FIELDS_MAX - 1).frt) &&
+          (FRT_INVALID == router.Lookup(FIELD_ROUTER_FIELDS_MAX).frt) &&
+          (FRT_INVALID == router.Lookup((DWORD)-1).frt),
+          "limits: a full table routes its last field and nothing past it");
+
+    // The field types come through for the type checks the combobox methods make.
+    for (DWORD i = 0; i < FIELD_ROUTER_FIELDS_MAX; i++)
+    {
+        s_rgdwType[i] = i % 13;
+    }
+    router.Initialize(s_rgdwType, 40, 0, 20, 20);
+    bool fTypes = true;
+    for (DWORD i = 0; i < 40; i++)
+    {
+        fTypes = fTypes && (router.Lookup(i).dwType == i % 13);
+    }
+    Check(fTypes && (0 == router.Lookup(40).dwType), "limits: each route carries its field's type");
+}
+
+// Field IDs spread over the tile, as LogonUI asks for them.
+static double TimeDispatch(CMockCredential* pCredential, DWORD cFields)
+{
+    DWORD dwRandom = 0x2545F491;
+    DWORD dwSum = 0;
+    const double dStart = NowSeconds();
+    for (DWORD i = 0; i < DISPATCH_CALLS; i++)
+    {
+        dwRandom ^= dwRandom << 13;
+        dwRandom ^= dwRandom >> 17;
+        dwRandom ^= dwRandom << 5;
+        DWORD dwState = 0;
+        pCredential->GetFieldState(dwRandom % cFields, &dwState);
+        dwSum += dwState;
+    }
+    const double dSeconds = NowSeconds() - dStart;
+    if (0 == dwSum)
+    {
+        printf("(no calls)\n");
+    }
+    return dSeconds * 1e9 / DISPATCH_CALLS;
+}
+
+static void Benchmark()
+{
+    const DWORD cInner = 12;
+    CMockInnerCredential inner(cInner);
+    CRoutedWrapper routed(&inner);
+    COffsetWrapper offset(&inner, cInner);
+    routed.Initialize(s_rgdwType, cInner + OWN_FIELDS, 0, cInner, cInner);
+
+    CRoutedWrapper outer2(&routed);
+    outer2.Initialize(s_rgdwType, cInner + 2 * OWN_FIELDS, 0, cInner + OWN_FIELDS, cInner + OWN_FIELDS);
+    CRoutedWrapper outer3(&outer2);
+    outer3.Initialize(s_rgdwType, cInner + 3 * OWN_FIELDS, 0, cInner + 2 * OWN_FIELDS, cInner + 2 * OWN_FIELDS);
+
+    printf("\nGetFieldState through a wrapper, %u inner and %u own fields, random field IDs:\n", cInner, OWN_FIELDS);
+    printf("  range check and offset: %.2f ns a call\n", TimeDispatch(&offset, cInner + OWN_FIELDS));
+    printf("  routing table:          %.2f ns a call\n", TimeDispatch(&routed, cInner + OWN_FIELDS));
+    printf("  two wrappers deep:      %.2f ns a call\n", TimeDispatch(&outer2, cInner + 2 * OWN_FIELDS));
+    printf("  three wrappers deep:    %.2f ns a call\n", TimeDispatch(&outer3, cInner + 3 * OWN_FIELDS));
+}
+
+int main()
+{
+    CheckSingle();
+    CheckSeveral();
+    CheckNested();
+    CheckLimits();
+    Benchmark();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Fans calls out to mock wrapped providers on CProviderHost threads, the way
+// CSampleProvider::_RunJobs does, with latencies injected into their
+// SetUsageScenario and GetCredentialCount.  Each provider must be attached,
+// called and detached on its own thread; the providers must run at once, so
+// the fan-out takes as long as the slowest and not the sum; a provider that
+// misses the deadline must not hold up the others, must turn away the next
+// job until it finishes, and must then report late; and the merged tiles must
+// come in configuration order whatever order the providers finish in.  Then
+// it prints the speedup over calling the providers in turn for a growing
+// number of providers, and what a fan-out costs when the providers answer at
+// once.  Prints a line per check and returns nonzero if any failed.
+
+#include "CProviderHost.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PROVIDERS_MAX           16
+#define TILES_PER_PROVIDER      3
+#define LATENCY_MS              20
+#define SLOW_LATENCY_MS         400
+#define DEADLINE_MS             100
+#define SLACK_MS                50          // Scheduling allowance on a loaded machine.
+#define EMPTY_FANOUTS           20000
+
+static DWORD s_cFailed = 0;
+
+static void Check(bool fPassed, const char* pszWhat)
+{
+    printf("%s  %s\n", fPassed ? "PASS" : "FAIL", pszWhat);
+    if (!fPassed)
+    {
+        s_cFailed++;
+    }
+}
+
+static double NowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Stands in for a wrapped provider and its host's WRAPPED_PROVIDER.
+struct MOCK_PROVIDER
+{
+    CProviderHost   host;
+    DWORD           iConfig;            // Where the configuration lists it.
+    DWORD           dwLatencyMs;        // Each call takes this long.
+    pthread_t       thread;             // Set by attach.
+    bool            fAttached;
+    bool            fWrongThread;       // A call came on another thread.
+    DWORD           cCalls;
+    DWORD           cTiles;             // From the last GetCredentialCount.
+    volatile LONG   cLate;              // Late callbacks.
+};
+
+static void AttachJob(void* pv)
+{
+    MOCK_PROVIDER* pmp = static_cast<MOCK_PROVIDER*>(pv);
+    pmp->thread = pthread_self();
+    pmp->fAttached = true;
+}
+
+static void DetachJob(void* pv)
+{
+    MOCK_PROVIDER* pmp = static_cast<MOCK_PROVIDER*>(pv);
+    pmp->fWrongThread = pmp->fWrongThread || !pthread_equal(pmp->thread, pthread_self());
+    pmp->fAttached = false;
+}
+
+static void LateJob(void* pv)
+{
+    MOCK_PROVIDER* pmp = static_cast<MOCK_PROVIDER*>(pv);
+    __sync_fetch_and_add(&pmp->cLate, 1);
+}
+
+static void Call(MOCK_PROVIDER* pmp)
+{
+    pmp->fWrongThread = pmp->fWrongThread || !pthread_equal(pmp->thread, pthread_self());
+    pmp->cCalls++;
+    if (pmp->dwLatencyMs > 0)
+    {
+        usleep(pmp->dwLatencyMs * 1000);
+    }
+}
+
+static void SetUsageScenarioJob(void* pv)
+{
+    Call(static_cast<MOCK_PROVIDER*>(pv));
+}
+
+static void GetCredentialCountJob(void* pv)
+{
+    MOCK_PROVIDER* pmp = static_cast<MOCK_PROVIDER*>(pv);
+    Call(pmp);
+    pmp->cTiles = TILES_PER_PROVIDER;
+}
+
+static bool StartAll(MOCK_PROVIDER* rgmp, DWORD cProviders)
+{
+    bool fOk = true;
+    for (DWORD i = 0; i < cProviders; i++)
+    {
+        rgmp[i].iConfig = i;
+        fOk = fOk && SUCCEEDED(rgmp[i].host.Start(AttachJob, DetachJob, LateJob, &rgmp[i])) && rgmp[i].fAttached;
+    }
+    return fOk;
+}
+
+static void StopAll(MOCK_PROVIDER* rgmp, DWORD cProviders)
+{
+    for (DWORD i = 0; i < cProviders; i++)
+    {
+        rgmp[i].host.Stop();
+    }
+}
+
+// CSampleProvider::_RunJobs: queue pfnJob on every host, wait for them
+// together, and return a mask of those that finished.
+static DWORD RunJobs(MOCK_PROVIDER* rgmp, DWORD cProviders, PFN_HOST_JOB pfnJob, DWORD dwTimeoutMs)
+{
+    CProviderHost* rgpHost[PROVIDERS_MAX];
+    DWORD rgiHost[PROVIDERS_MAX];
+    DWORD cHosts = 0;
+    for (DWORD i = 0; i < cProviders; i++)
+    {
+        if (SUCCEEDED(rgmp[i].host.Queue(pfnJob, &rgmp[i])))
+        {
+            rgpHost[cHosts] = &rgmp[i].host;
+            rgiHost[cHosts] = i;
+            cHosts++;
+        }
+    }
+
+    DWORD dwFinished = 0;
+    CProviderHost::WaitIdle(rgpHost, cHosts, dwTimeoutMs);
+    for (DWORD i = 0; i < cHosts; i++)
+    {
+        if (rgpHost[i]->IsIdle())
+        {
+            dwFinished |= (1 << rgiHost[i]);
+        }
+    }
+    return dwFinished;
+}
+
+// The tiles of the providers that answered, in configuration order, as
+// GetCredentialAt numbers them.
+static DWORD MergeTiles(const MOCK_PROVIDER* rgmp, DWORD cProviders, DWORD dwFinished, DWORD* rgiProvider)
+{
+    DWORD cTiles = 0;
+    for (DWORD i = 0; i < cProviders; i++)
+    {
+        if (dwFinished & (1 << i))
+        {
+            for (DWORD j = 0; j < rgmp[i].cTiles; j++)
+            {
+                rgiProvider[cTiles++] = rgmp[i].iConfig;
+            }
+        }
+    }
+    return cTiles;
+}
+
+static void CheckFanOut()
+{
+    const DWORD cProviders = 4;
+    MOCK_PROVIDER* rgmp = new MOCK_PROVIDER[cProviders]();
+    Check(StartAll(rgmp, cProviders), "fan-out: each provider is attached on its host before Start returns");
+
+    // Finishing in the reverse of configuration order.
+    for (DWORD i = 0; i < cProviders; i++)
+    {
+        rgmp[i].dwLatencyMs = LATENCY_MS * (cProviders - i);
+    }
+
+    const double dStart = NowMs();
+    const DWORD dwScenario = RunJobs(rgmp, cProviders, SetUsageScenarioJob, 10000);
+    const DWORD dwCount = RunJobs(rgmp, cProviders, GetCredentialCountJob, 10000);
+    const double dElapsed = NowMs() - dStart;
+
+    Check(((1u << cProviders) - 1 == dwScenario) && (dwScenario == dwCount), "fan-out: every provider answers");
+    Check(dElapsed < 2 * LATENCY_MS * cProviders + SLACK_MS,
+          "fan-out: the providers run at once, so it takes as long as the slowest");
+
+    DWORD rgiProvider[PROVIDERS_MAX * TILES_PER_PROVIDER];
+    const DWORD cTiles = MergeTiles(rgmp, cProviders, dwCount, rgiProvider);
+    bool fOrdered = (cTiles == cProviders * TILES_PER_PROVIDER);
+    for (DWORD i = 1; fOrdered && (i < cTiles); i++)
+    {
+        fOrdered = (rgiProvider[i - 1] <= rgiProvider[i]);
+    }
+    Check(fOrdered, "fan-out: tiles merge in configuration order, not finishing order");
+
+    StopAll(rgmp, cProviders);
+    bool fOwnThread = true;
+    for (DWORD i = 0; i < cProviders; i++)
+    {
+        fOwnThread = fOwnThread && !rgmp[i].fWrongThread && !rgmp[i].fAttached && (2 == rgmp[i].cCalls);
+    }
+    Check(fOwnThread, "fan-out: every call and the detach run on the provider's own host");
+    delete[] rgmp;
+}
+
+static void CheckDeadline()
+{
+    const DWORD cProviders = 4;
+    MOCK_PROVIDER* rgmp = new MOCK_PROVIDER[cProviders]();
+    StartAll(rgmp, cProviders);
+    for (DWORD i = 0; i < cProviders; i++)
+    {
+        rgmp[i].dwLatencyMs = (1 == i) ? SLOW_LATENCY_MS : LATENCY_MS;
+    }
+
+    double dStart = NowMs();
+    const DWORD dwFinished = RunJobs(rgmp, cProviders, GetCredentialCountJob, DEADLINE_MS);
+    const double dElapsed = NowMs() - dStart;
+    Check(0xD == dwFinished, "deadline: the providers that answered in time are used");
+    Check((dElapsed >= DEADLINE_MS - 1) && (dElapsed < DEADLINE_MS + SLACK_MS),
+          "deadline: the slow provider holds the others up for no longer than the deadline");
+
+    // The next fan-out goes ahead without the slow one, which is still busy.
+    const DWORD dwNext = RunJobs(rgmp, cProviders, SetUsageScenarioJob, DEADLINE_MS);
+    Check((0xD == dwNext) && (1 == rgmp[1].cCalls) && (0 == rgmp[1].cLate),
+          "deadline: a provider still running late is left out of the next fan-out");
+
+    // It reports late once it finishes, and then takes jobs again.
+    dStart = NowMs();
+    while ((0 == rgmp[1].cLate) && (NowMs() - dStart < 10 * SLOW_LATENCY_MS))
+    {
+        usleep(1000);
+    }
+    Check((1 == rgmp[1].cLate) && (TILES_PER_PROVIDER == rgmp[1].cTiles),
+          "deadline: the late provider's callback runs when it finishes, with its result");
+    Check(0xF == RunJobs(rgmp, cProviders, SetUsageScenarioJob, SLOW_LATENCY_MS + SLACK_MS),
+          "deadline: a late provider takes jobs again once it has finished");
+
+    // Stop waits out a job in hand.
+    rgmp[2].dwLatencyMs = LATENCY_MS * 3;
+    rgmp[2].host.Queue(SetUsageScenarioJob, &rgmp[2]);
+    dStart = NowMs();
+    rgmp[2].host.Stop();
+    Check((NowMs() - dStart >= LATENCY_MS * 3 - 5) && !rgmp[2].fAttached, "stop: waits for the job in hand, then detaches");
+
+    StopAll(rgmp, cProviders);
+    delete[] rgmp;
+}
+
+static void Benchmark()
+{
+    printf("\nfan-out of SetUsageScenario and GetCredentialCount, %u ms a call:\n", LATENCY_MS);
+    for (DWORD cProviders = 1; cProviders <= PROVIDERS_MAX; cProviders *= 2)
+    {
+        MOCK_PROVIDER* rgmp = new MOCK_PROVIDER[cProviders]();
+        StartAll(rgmp, cProviders);
+        for (DWORD i = 0; i < cProviders; i++)
+        {
+            rgmp[i].dwLatencyMs = LATENCY_MS;
+        }
+
+        // In turn on this thread, as the single wrapped provider was called.
+        double dStart = NowMs();
+        for (DWORD i = 0; i < cProviders; i++)
+        {
+            usleep(2 * rgmp[i].dwLatencyMs * 1000);
+        }
+        const double dSerial = NowMs() - dStart;
+
+        dStart = NowMs();
+        RunJobs(rgmp, cProviders, SetUsageScenarioJob, 10000);
+        RunJobs(rgmp, cProviders, GetCredentialCountJob, 10000);
+        const double dParallel = NowMs() - dStart;
+
+        printf("  %2u providers: %6.1f ms in turn, %5.1f ms at once, speedup %.1f\n",
+               cProviders, dSerial, dParallel, dSerial / dParallel);
+        StopAll(rgmp, cProviders);
+        delete[] rgmp;
+    }
+
+    // What the hosts add when the providers answer at once.
+    const DWORD cProviders = 4;
+    MOCK_PROVIDER* rgmp = new MOCK_PROVIDER[cProviders]();
+    StartAll(rgmp, cProviders);
+    const double dStart = NowMs();
+    for (DWORD i = 0; i < EMPTY_FANOUTS; i++)
+    {
+        RunJobs(rgmp, cProviders, SetUsageScenarioJob, 10000);
+    }
+    printf("  fan-out to %u providers that answer at once: %.1f us\n", cProviders,
+           (NowMs() - dStart) * 1000 / EMPTY_FANOUTS);
+    StopAll(rgmp, cProviders);
+    delete[] rgmp;
+}
+
+int main()
+{
+    CheckFanOut();
+    CheckDeadline();
+    Benchmark();
+
+    printf("%u failed\n", s_cFailed);
+    return (0 == s_cFailed) ? 0 : 1;
+}
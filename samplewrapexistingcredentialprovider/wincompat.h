@@ -0,0 +1,39 @@
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//
+// The pieces of this sample that don't talk to COM or LogonUI (field routing,
+// provider host threads, event batching) also build on other platforms, so
+// they can be tested and measured there.  This header gives them the few
+// Windows types they use.
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <stdint.h>
+#include <stddef.h>
+#include <wchar.h>
+
+typedef int32_t HRESULT;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef wchar_t WCHAR;
+typedef WCHAR* PWSTR;
+typedef const WCHAR* PCWSTR;
+
+#define S_OK            ((HRESULT)0)
+#define E_FAIL          ((HRESULT)0x80004005)
+#define E_OUTOFMEMORY   ((HRESULT)0x8007000E)
+#define E_INVALIDARG    ((HRESULT)0x80070057)
+#define E_UNEXPECTED    ((HRESULT)0x8000FFFF)
+#define E_PENDING       ((HRESULT)0x8000000A)
+#define S_FALSE         ((HRESULT)1)
+#define SUCCEEDED(hr)   (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+#endif